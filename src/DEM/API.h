@@ -24,6 +24,7 @@
 #include <DEM/BdrsAndObjs.h>
 #include <DEM/Models.h>
 #include <DEM/AuxClasses.h>
+#include <DEM/utils/BinaryIO.hpp>
 
 /// Main namespace for the DEM-Engine package.
 namespace deme {
@@ -32,6 +33,8 @@ namespace deme {
 // class DEMDynamicThread;
 // class ThreadManager;
 class DEMInspector;
+class DEMInspectorGroup;
+class DEMAsyncResult;
 class DEMTracker;
 
 //////////////////////////////////////////////////////////////
@@ -77,6 +80,15 @@ class DEMSolver {
         m_bounding_box_material = mat;
     }
 
+    /// @brief Make the simulation world periodic in some directions. An entity leaving the domain (as instructed by
+    /// InstructBoxDomainDimension) through one end of a periodic direction enters from the other end, and spheres near
+    /// one end are in contact with those near the other. A periodic direction gets no bounding BC planes.
+    /// @details Only sphere--sphere contacts are periodic; meshes and analytical objects are not wrapped. The period
+    /// (the domain length) should be larger than the largest sphere's (contact-margin-inflated) diameter. Periodic
+    /// directions cannot be used with hierarchical bins. Call it before initialization.
+    /// @param dirs The periodic directions, such as "X", "XY" or "XYZ"; or "none".
+    void InstructBoxDomainPeriodicBC(const std::string& dirs);
+
     /// Set gravitational pull.
     void SetGravitationalAcceleration(float3 g) { G = g; }
     void SetGravitationalAcceleration(const std::vector<float>& g) {
@@ -91,8 +103,12 @@ class DEMSolver {
     /// @brief Get the number of kT-reported potential contact pairs.
     /// @return Number of potential contact pairs.
     size_t GetNumContacts() const { return dT->getNumContacts(); }
-    /// Get the current time step size in simulation.
-    double GetTimeStepSize() const { return m_ts_size; }
+    /// Get the number of time steps dT has executed since the collaboration stats were last cleared.
+    size_t GetNumDynamicSteps() const { return dT->nTotalSteps; }
+    /// Get the current time step size in simulation. If the step size is adapted, this is the size of the last step.
+    double GetTimeStepSize() const {
+        return (sys_initialized && adapt_ts_type != ADAPT_TS_TYPE::NONE) ? (double)dT->simParams->h : m_ts_size;
+    }
     /// Get the current expand factor in simulation.
     float GetExpandFactor() const;
     /// Set the number of dT steps before it waits for a contact-pair info update from kT.
@@ -107,9 +123,24 @@ class DEMSolver {
     double GetSimTime() const;
     /// Set the simulation time manually.
     void SetSimTime(double time);
-    /// @brief Set the strategy for auto-adapting time step size (NOT implemented, no effect yet).
+    /// @brief Set the strategy for auto-adapting time step size. The step size is then decided on device every step.
+    /// @details "max_vel" limits the step size so that the fastest owner travels no more than a safety factor times the
+    /// smallest sphere radius in a step. "int_diff" also limits it so the distance an owner covers due to its
+    /// acceleration in one step is no more than that. The step size is always kept in the bounds set by
+    /// SetAdaptiveTimeStepBounds.
     /// @param type "none" or "max_vel" or "int_diff".
     void SetAdaptiveTimeStepType(const std::string& type);
+    /// @brief Set the bounds for the adapted time step size.
+    /// @param min_ts Minimum step size.
+    /// @param max_ts Maximum step size. This should be no larger than what contact stiffness allows for a stable step.
+    /// If not positive (default), the initial time step size is used.
+    void SetAdaptiveTimeStepBounds(double min_ts, double max_ts) {
+        adapt_ts_min = min_ts;
+        adapt_ts_max = max_ts;
+    }
+    /// Set the fraction of the smallest sphere radius that an owner is allowed to travel in one adapted step (default
+    /// 0.05).
+    void SetAdaptiveTimeStepSafetyFactor(float safety) { adapt_ts_safety = safety; }
 
     /// @brief Set the time integrator for this simulator.
     /// @param intg "forward_euler" or "extended_taylor" or "centered_difference".
@@ -159,10 +190,39 @@ class DEMSolver {
     std::shared_ptr<DEMForceModel> ReadContactForceModel(const std::string& filename);
     /// Get the current force model.
     std::shared_ptr<DEMForceModel> GetContactForceModel() { return m_force_model; }
+    /// @brief Add an extra contact force model, defined by a string, which is used by the contacts that
+    /// SetFamilyPairContactForceModel or SetMaterialPairContactForceModel assign to it. The other contacts use the main
+    /// force model (the one set by DefineContactForceModel and the like).
+    /// @details The contacts are grouped by model, and each model runs in its own force kernel over its own contacts.
+    /// The models share the solver's wildcard arrays, which hold the wildcards and material properties that any of the
+    /// models asks for (the given model objects themselves are not changed).
+    /// @return The extra force model, whose wildcards and material properties can then be set.
+    std::shared_ptr<DEMForceModel> AddContactForceModel(const std::string& model);
+    /// @brief Add an extra contact force model read from a file (which by default should reside in
+    /// kernel/DEMUserScripts). See AddContactForceModel.
+    std::shared_ptr<DEMForceModel> AddContactForceModelFromFile(const std::string& filename);
+    /// @brief Have the contacts between owners of family ID1 and family ID2 use a force model.
+    /// @details Family-pair assignments have precedence over material-pair ones, and among assignments of the same
+    /// kind, the one made last wins. They must be made before initialization.
+    /// @param model The main force model, or one added by AddContactForceModel.
+    void SetFamilyPairContactForceModel(unsigned int ID1,
+                                        unsigned int ID2,
+                                        const std::shared_ptr<DEMForceModel>& model);
+    /// @brief Have the contacts between geometries of material mat1 and material mat2 use a force model. See
+    /// SetFamilyPairContactForceModel.
+    void SetMaterialPairContactForceModel(const std::shared_ptr<DEMMaterial>& mat1,
+                                          const std::shared_ptr<DEMMaterial>& mat2,
+                                          const std::shared_ptr<DEMForceModel>& model);
 
     /// Instruct the solver if contact pair arrays should be sorted (based on the types of contacts) before usage.
     void SetSortContactPairs(bool use_sort) { should_sort_contacts = use_sort; }
 
+    /// Instruct the solver to map the contacts to those of the last contact detection (to carry over contact history)
+    /// using a GPU hash table keyed on the contact geometries and type, instead of sorting and run-length encoding the
+    /// contact arrays. This makes each map update a single pass over the contacts. It has no effect in historyless
+    /// simulations.
+    void UseHashHistoryMapping(bool use = true) { use_hash_history_mapping = use; }
+
     /// Instruct the solver to rearrange and consolidate clump templates information, then jitify it into GPU kernels
     /// (if set to true), rather than using flattened sphere component configuration arrays whose entries are associated
     /// with individual spheres.
@@ -203,6 +263,7 @@ class DEMSolver {
     // void SetExpandSafetyType(const std::shared_ptr<DEMInspector>& insp) {
     //     m_max_v_finder_type = MARGIN_FINDER_TYPE::DEM_INSPECTOR;
     //     m_approx_max_vel_func = insp;
+    //     m_approx_max_vel_func_is_default = false;
     // }
 
     /// Assign a multiplier to our estimated maximum system velocity, when deriving the thinckness of the contact
@@ -214,11 +275,31 @@ class DEMSolver {
     /// significantly in one kT update cycle.
     void SetExpandSafetyAdder(float vel) { m_expand_base_vel = vel; }
 
-    /// @brief Used to force the solver to error out when there are too many spheres in a bin. A huge number can be used
-    /// to discourage this error type.
+    /// @brief Set the number of spheres in a bin that the bin size adaptation tries to stay below. Bins denser than
+    /// that are still resolved (by a slower, multi-block sweep), so this is no longer a hard limit.
     /// @param max_sph Max number of spheres in a bin.
     void SetMaxSphereInBin(unsigned int max_sph) { threshold_too_many_spheres_in_bin = max_sph; }
 
+    /// @brief Use a 2-level bin hierarchy, which helps polydisperse systems with a few spheres much larger than the
+    /// rest. Spheres larger than coarse_radius are not put into the bins, but into a coarse grid whose cells follow the
+    /// size of the largest of them, and all spheres find their contacts with them by querying that grid. The bins (and
+    /// the bin size adaptation) then only need to care about the smaller spheres.
+    /// @param coarse_radius Spheres with a radius larger than this go to the coarse level. A non-positive number
+    /// disables this (default).
+    void UseHierarchicalBins(float coarse_radius) { hierarchical_bin_coarse_radius = coarse_radius; }
+
+    /// @brief Stage sphere positions in the shared memory of the sphere--sphere contact detection kernels as float
+    /// offsets from the corner of the bin, instead of double global positions. This halves their shared memory use and
+    /// keeps the pair sweep off the FP64 path. The pairs passing the float test are confirmed in double precision, so
+    /// the contacts found are not affected. Call it before initialization.
+    void UseBinLocalCDCoordinates(bool use = true) { use_bin_local_cd_coords = use; }
+
+    /// @brief Run a 2D simulation in the XZ plane (entities placed at a fixed Y). The kernels are then specialized at
+    /// compile time: only one layer of bins is used in the Y direction, owners get no Y velocity, and they rotate about
+    /// the Y axis only (unless the motion is prescribed). A 3D contact force model can then be used as it is. Call it
+    /// before initialization.
+    void UseTwoDimensionalMode(bool use = true) { use_2d_mode = use; }
+
     /// @brief Used to force the solver to error out when there are too many spheres in a bin. A huge number can be used
     /// to discourage this error type.
     /// @param max_tri Max number of triangles in a bin.
@@ -248,6 +329,12 @@ class DEMSolver {
     void UseAdaptiveUpdateFreq(bool use = true) { auto_adjust_update_freq = use; }
     /// @brief Disable the use of adaptive max update step count (always use initial update frequency).
     void DisableAdaptiveUpdateFreq() { auto_adjust_update_freq = false; }
+    /// @brief Let the adaptive update frequency be chosen by a cost model (off by default).
+    /// @details kT's contact detection and one dT step are timed with CUDA events, and the future drift is set to
+    /// about the number of dT steps that fit in one contact detection, so dT seldom waits and kT seldom idles. Only
+    /// takes effect when adaptive update frequency is in use. The choices are shown in ShowThreadCollaborationStats.
+    /// @param use Enable or disable.
+    void UseCostModelUpdateFreq(bool use = true) { use_cost_model_update_freq = use; }
     /// @brief Adjust how frequent kT updates the bin size.
     /// @param n Number of contact detections before kT makes one adjustment to bin size.
     void SetAdaptiveBinSizeDelaySteps(unsigned int n) {
@@ -302,6 +389,11 @@ class DEMSolver {
 
     /// Set the number of threads per block in force calculation (default 256).
     void SetForceCalcThreadsPerBlock(unsigned int nTh) { dT->DT_FORCE_CALC_NTHREADS_PER_BLOCK = nTh; }
+    /// @brief Autotune the number of threads per block in force calculation at Initialize: after the dry-run, a few
+    /// candidates are timed on the real contact array and the fastest is used (overriding
+    /// SetForceCalcThreadsPerBlock). The winner is stored in the JIT cache directory (see SetJitCacheDir) per GPU
+    /// architecture and force kernel source, so later runs with the same force model skip the benchmark.
+    void UseLaunchConfigAutotune(bool use = true) { autotune_launch_config = use; }
 
     /// @brief Load a clump type into the API-level cache.
     /// @return the shared ptr to the clump type just loaded.
@@ -435,6 +527,47 @@ class DEMSolver {
     /// @param ownerID The owner's ID.
     /// @return The moment of inertia (in principal axis frame).
     float3 GetOwnerMOI(bodyID_t ownerID) const;
+    /// @brief Get one quantity of many owners at once.
+    /// @details The values are gathered on the device and copied to the host in one go, instead of touching the
+    /// solver arrays once per owner.
+    /// @param quantity Which quantity (position, velocity, local angular velocity or quaternion).
+    /// @param ownerIDs The owners to query.
+    /// @return 3 floats per owner (4 for quaternions, in (x, y, z, w) order), in the order of ownerIDs.
+    std::vector<float> GetOwnerStates(OWNER_QUANTITY quantity, const std::vector<bodyID_t>& ownerIDs);
+    /// @brief Get one quantity of n owners starting from start at once.
+    /// @param families If not empty, only the owners that are in one of these families are queried.
+    /// @param selected If given, the IDs of the queried owners are put in it.
+    std::vector<float> GetOwnerStates(OWNER_QUANTITY quantity,
+                                      bodyID_t start,
+                                      size_t n,
+                                      const std::set<unsigned int>& families = {},
+                                      std::vector<bodyID_t>* selected = nullptr);
+    /// @brief Same as GetOwnerStates, but leave the values on the device, for consumers that run on the GPU.
+    /// @return A device pointer to the values, valid until the next bulk owner state query or the next simulation call.
+    const float* GetOwnerStatesDevice(OWNER_QUANTITY quantity, const std::vector<bodyID_t>& ownerIDs);
+    /// @brief Queue a query of one quantity of n owners starting from start, without waiting for it.
+    /// @details The query runs on the device behind the work already queued there, and its values go to pinned host
+    /// memory, so the caller (and the simulation) does not have to wait for it.
+    /// @return A handle whose GetValues gives 3 floats per owner (4 for quaternions) once they arrive.
+    std::shared_ptr<DEMAsyncResult> GetOwnerStatesAsync(OWNER_QUANTITY quantity, bodyID_t start, size_t n);
+    const float* GetOwnerStatesDevice(OWNER_QUANTITY quantity,
+                                      bodyID_t start,
+                                      size_t n,
+                                      const std::set<unsigned int>& families = {},
+                                      std::vector<bodyID_t>* selected = nullptr);
+    /// @brief View a solver array in device memory without copying it, for GPU consumers (such as DLPack tensors or
+    /// __cuda_array_interface__ objects made by a Python binding).
+    /// @details Only VEL and ANG_VEL views are writable. Simulation calls return with the dynamics thread idle, which
+    /// is when views can be made; see DEMDeviceArrayView for how long they last.
+    /// @param dir The component, for the owner vector arrays (VEL, ANG_VEL, ACC, ANG_ACC), which are stored by
+    /// component. The contact vector arrays are viewed as n by 3.
+    DEMDeviceArrayView GetDeviceArrayView(DEVICE_ARRAY array, SPATIAL_DIR dir = SPATIAL_DIR::NONE);
+    /// @brief View an owner wildcard array in device memory without copying it. The view is writable.
+    DEMDeviceArrayView GetOwnerWildcardDeviceView(const std::string& name);
+    /// @brief View one quantity of n owners starting from start in device memory, as n by 3 (n by 4 for quaternions).
+    /// @details Positions and quaternions are not stored as floats, so this is a read-only view of a device buffer they
+    /// are gathered in (see GetOwnerStatesDevice), valid until the next bulk owner state query or simulation call.
+    DEMDeviceArrayView GetOwnerStatesDeviceView(OWNER_QUANTITY quantity, bodyID_t start, size_t n);
     /// Set position of a owner
     void SetOwnerPosition(bodyID_t ownerID, float3 pos);
     /// Set angular velocity of a owner
@@ -451,6 +584,31 @@ class DEMSolver {
     void SetTriNodeRelPos(size_t owner, size_t triID, const std::vector<float3>& new_nodes);
     /// @brief Update the relative positions of the flattened triangle soup.
     void UpdateTriNodeRelPos(size_t owner, size_t triID, const std::vector<float3>& updates);
+    /// @brief Rewrite the relative positions of a mesh's nodes using a device buffer, without a round trip through the
+    /// host.
+    /// @details The update is a kernel launched on the given stream, which must be on the GPU that dT uses; the solver
+    /// orders its own work after it, and does not block the stream. The buffer must stay valid until that kernel is
+    /// done. The cached (host) copy of the mesh is not modified, so GetMeshNodesGlobal and the like do not reflect
+    /// the update, but mesh output does. It can only be called after initialization.
+    /// @param owner The owner ID of the mesh.
+    /// @param triID The ID of the first facet of the mesh.
+    /// @param device_nodes Device pointer to the new node positions (in the mesh's own frame).
+    /// @param per_vertex If true, device_nodes holds one position per mesh vertex (GetNumNodes() of them), which is
+    /// expanded to the facets' nodes on device. If false, it holds 3 nodes per facet (3 * GetNumTriangles() of them),
+    /// in the order the simulation stores them.
+    /// @param stream The CUDA stream to apply the update on.
+    void SetTriNodeRelPos(size_t owner,
+                          size_t triID,
+                          const float3* device_nodes,
+                          bool per_vertex = true,
+                          cudaStream_t stream = 0);
+    /// @brief Add to the relative positions of a mesh's nodes using a device buffer. See the device-buffer
+    /// SetTriNodeRelPos for details.
+    void UpdateTriNodeRelPos(size_t owner,
+                             size_t triID,
+                             const float3* device_updates,
+                             bool per_vertex = true,
+                             cudaStream_t stream = 0);
     /// @brief Get a handle for the mesh this tracker is tracking.
     /// @return Pointer to the mesh.
     std::shared_ptr<DEMMeshConnected>& GetCachedMesh(bodyID_t ownerID);
@@ -528,6 +686,14 @@ class DEMSolver {
         }
         return AddClumps(input_type, loc_xyz);
     }
+    /// @brief Load clumps from a clump file written by this solver, in OUTPUT_FORMAT::BINARY or CSV.
+    /// @details The file is memory-mapped; a binary file's columns are used where they are, and a CSV file is parsed
+    /// in parallel. Clump types are matched by name to the loaded clump templates. Quaternions, velocities, angular
+    /// velocities and families are loaded if the file has them; other columns (such as wildcards) are not.
+    /// @param filename The clump file.
+    /// @param num_threads Number of threads to parse the file and fill the batch with (0 means hardware threads).
+    /// @return Handle to the loaded batch of clumps.
+    std::shared_ptr<DEMClumpBatch> AddClumpsFromFile(const std::string& filename, unsigned int num_threads = 0);
 
     /// Load a mesh-represented object
     std::shared_ptr<DEMMeshConnected> AddWavefrontMeshObject(const std::string& filename,
@@ -538,6 +704,14 @@ class DEMSolver {
                                                              bool load_normals = true,
                                                              bool load_uv = false);
     std::shared_ptr<DEMMeshConnected> AddWavefrontMeshObject(DEMMeshConnected& mesh);
+    /// @brief Add a mesh object that is an instance of a mesh already added.
+    /// @details The instance has the same facets, materials, mass and MOI as mesh, yet its own position, orientation
+    /// and family (set them via the returned handle). The facets are stored on the device once for mesh and all its
+    /// instances, much like clumps of one clump template. Meshes sharing facets this way cannot be deformed.
+    /// @param mesh The mesh to instance. It must be added to this solver via AddWavefrontMeshObject (or be an
+    /// instance itself).
+    /// @return The handle of the instance.
+    std::shared_ptr<DEMMeshConnected> AddMeshInstance(const std::shared_ptr<DEMMeshConnected>& mesh);
 
     /// @brief Create a DEMTracker to allow direct control/modification/query to this external object/batch of
     /// clumps/triangle mesh object.
@@ -569,6 +743,14 @@ class DEMSolver {
     /// Create a inspector object that can help query some statistical info of the clumps in the simulation
     std::shared_ptr<DEMInspector> CreateInspector(const std::string& quantity = "clump_max_z");
     std::shared_ptr<DEMInspector> CreateInspector(const std::string& quantity, const std::string& region);
+    /// @brief Create a group of inspectors that are evaluated together.
+    /// @details All inspectors of the group are computed in one kernel pass over owners (and one over spheres, if some
+    /// of them inspect spheres), reduced together, and their values come back in one transfer. This is cheaper than
+    /// calling GetValue on each of them. They all must be reductions (not absv, for example).
+    /// @param inspectors The inspectors to evaluate together. They can still be used on their own.
+    /// @return The inspector group. Its GetValues gives the values in the order of inspectors.
+    std::shared_ptr<DEMInspectorGroup> CreateInspectorGroup(
+        const std::vector<std::shared_ptr<DEMInspector>>& inspectors);
 
     /// @brief Add an extra acceleration to a owner for the next time step.
     /// @param ownerID The number of that owner.
@@ -748,6 +930,12 @@ class DEMSolver {
     /// @brief Set the names for the extra quantities that will be associated with each geometry entity (such as sphere,
     /// triangle).
     void SetGeometryWildcards(const std::set<std::string>& wildcards);
+    /// @brief Store a contact wildcard of the force model in 16 bits instead of as a float. See
+    /// DEMForceModel::SetContactWildcardPrecision.
+    void SetContactWildcardPrecision(const std::string& name,
+                                     WILDCARD_PRECISION precision,
+                                     float max_abs = 0.f,
+                                     float max_error = 0.f);
 
     /// @brief Change the value of contact wildcards to val if either of the contact geometries is in family N.
     /// @param N Family number. If one contact geometry is in N, this contact wildcard is modified.
@@ -791,6 +979,30 @@ class DEMSolver {
                                  std::vector<float3>& torques,
                                  bool torque_in_local = false);
 
+    /// @brief Get all contact forces that concern many owners, in one go.
+    /// @details The contacts of all these owners are found, and their points, forces and torques worked out, in one
+    /// pass on the device, then copied to the host at once. So it is much cheaper than GetOwnerContactForces per owner.
+    /// @param ownerIDs The IDs of the owners. No owner can be in it twice.
+    /// @param offsets Filled with ownerIDs.size() + 1 numbers: the contacts of ownerIDs[i] are from offsets[i] to
+    /// offsets[i + 1] (not included) in points, forces and torques.
+    /// @param torques The torques, in each owner's local frame if torque_in_local, or else in the global frame.
+    /// @return Number of force pairs of all these owners.
+    size_t GetOwnersContactForces(const std::vector<bodyID_t>& ownerIDs,
+                                  std::vector<size_t>& offsets,
+                                  std::vector<float3>& points,
+                                  std::vector<float3>& forces,
+                                  std::vector<float3>& torques,
+                                  bool torque_in_local = false);
+    /// @brief Get all contact forces that concern the owners in family N, in one go. See GetOwnersContactForces.
+    /// @param ownerIDs Filled with the IDs of the owners in family N, which offsets refer to.
+    size_t GetFamilyContactForces(unsigned int N,
+                                  std::vector<bodyID_t>& ownerIDs,
+                                  std::vector<size_t>& offsets,
+                                  std::vector<float3>& points,
+                                  std::vector<float3>& forces,
+                                  std::vector<float3>& torques,
+                                  bool torque_in_local = false);
+
     /// @brief Set the wildcard values of some triangles.
     /// @param geoID The ID of the starting (first) triangle that needs to be modified.
     /// @param name The name of the wildcard.
@@ -845,6 +1057,43 @@ class DEMSolver {
     /// @param extra_size The thickness of the extra contact margin.
     void SetFamilyExtraMargin(unsigned int N, float extra_size);
 
+    /// @brief Let a family advance with a time step ratio times the solver's time step size (multi-rate stepping).
+    /// @details The solver time step size should then be what the fastest, stiffest families need. A family with ratio
+    /// r is integrated once every r steps, using a step size of r times the time step size, and the contact forces that
+    /// involve only owners that are not integrated in a step are not calculated in that step; the history of such a
+    /// contact (e.g. its tangential displacement) is advanced over all the skipped steps when it is next calculated.
+    /// A contact between a slow and a fast owner is still calculated at every step, and acts on the fast owner at every
+    /// step, but the slow owner only takes the force sampled at its own integration step, scaled to its whole step
+    /// size. The forces it receives in between are not accumulated: they come from the same slow-moving contacts, so
+    /// they differ from the sampled one by no more than what its own large step already neglects. A slow bulk material
+    /// can so take a much larger step than the few stiff bodies in contact with it.
+    /// @param N Family number.
+    /// @param ratio The number of solver time steps this family takes as one step. 1 (default) means every step.
+    void SetFamilyStepRatio(unsigned int N, unsigned int ratio);
+
+    /// @brief Let owners that have come to rest fall asleep, so they are no longer integrated and the contacts among
+    /// sleeping owners are not resolved.
+    /// @details An owner falls asleep after its velocity, angular velocity and acceleration stay below the thresholds
+    /// for num_steps steps in a row. When an awake owner touches it, all its contacts are resolved in the next step,
+    /// and it wakes up if its net acceleration (including gravity) is then above acc_threshold; it also wakes up when
+    /// the user sets its position, orientation or velocities. Owners with prescribed motion are always integrated.
+    /// @param lin_vel_threshold Velocity magnitude below which an owner is considered quiet.
+    /// @param ang_vel_threshold Angular velocity magnitude below which an owner is considered quiet.
+    /// @param acc_threshold Acceleration (including gravity) magnitude below which an owner is considered quiet.
+    /// @param num_steps Number of quiet steps in a row before an owner falls asleep.
+    void EnableSleeping(float lin_vel_threshold,
+                        float ang_vel_threshold,
+                        float acc_threshold,
+                        unsigned int num_steps = 100) {
+        use_sleeping = true;
+        sleep_lin_vel_threshold = lin_vel_threshold;
+        sleep_ang_vel_threshold = ang_vel_threshold;
+        sleep_acc_threshold = acc_threshold;
+        sleep_num_steps = DEME_MIN(DEME_MAX(num_steps, 1u), SLEEP_COUNT_MASK);
+    }
+    /// Disable the sleeping mechanism (see EnableSleeping).
+    void DisableSleeping() { use_sleeping = false; }
+
     /// @brief Get the owner wildcard's values of a owner.
     /// @param ownerID Owner's ID.
     /// @param name Wildcard's name.
@@ -876,8 +1125,14 @@ class DEMSolver {
 
     /// Change all entities with family number ID_from to have a new number ID_to, when the condition defined by the
     /// string is satisfied by the entities in question. This should be called before initialization, and will be baked
-    /// into the solver, so the conditions will be checked and changes applied every time step.
-    void ChangeFamilyWhen(unsigned int ID_from, unsigned int ID_to, const std::string& condition);
+    /// into the solver, so the conditions will be checked and changes applied every every_n_steps time steps (every
+    /// time step by default). Conditions that need not be exact in time, such as outlet removal, can be checked less
+    /// often to save a sweep over the owners; if every rule is checked only every few steps, the steps in between do
+    /// not sweep at all.
+    void ChangeFamilyWhen(unsigned int ID_from,
+                          unsigned int ID_to,
+                          const std::string& condition,
+                          unsigned int every_n_steps = 1);
 
     /// Change all entities with family number ID_from to have a new number ID_to, immediately. This is callable when kT
     /// and dT are hanging, not when they are actively working, or the behavior is not defined.
@@ -907,15 +1162,37 @@ class DEMSolver {
     /// of some random number)
     void EnsureKernelErrMsgLineNum(bool flag = true) { ensure_kernel_line_num = flag; }
 
-    /// Whether the force collection (acceleration calc and reduction) process should be using CUB. If true, the
-    /// acceleration array is flattened and reduced using CUB; if false, the acceleration is computed and directly
-    /// applied to each body through atomic operations.
+    /// Set a directory for caching jitified kernels on disk. Later runs that build the same kernels (same substituted
+    /// source, compile flags and GPU architecture) load them from there instead of compiling again. An empty path
+    /// disables the disk cache. If not set, the DEME_JIT_CACHE_DIR environment variable is used, if it exists. The
+    /// directory may be shared by concurrent processes. Note this setting is global, not per-solver.
+    void SetJitCacheDir(const std::filesystem::path& dir) { JitHelper::SetCacheDir(dir); }
+
+    /// Whether the force collection (acceleration calc and reduction) process should be using CUB. If true, an
+    /// owner-indexed segmentation of the contact array is built with CUB each time kT delivers contacts, and each step
+    /// reduces the forces over these segments without atomic operations; if false, the acceleration is computed and
+    /// directly applied to each body through atomic operations.
     void UseCubForceCollection(bool flag = true) { use_cub_to_reduce_force = flag; }
 
     /// Reduce contact forces to accelerations right after calculating them, in the same kernel. This may give some
     /// performance boost if you have only polydisperse spheres, no clumps.
     void SetCollectAccRightAfterForceCalc(bool flag = true) { collect_force_in_force_kernel = flag; }
 
+    /// When contact forces are reduced to accelerations in the force calculation kernel (see
+    /// SetCollectAccRightAfterForceCalc and SetNoForceRecord), first sum up the contributions to the same owner within
+    /// each warp, so only one atomic operation per owner per warp reaches the global memory. This helps in dense packs,
+    /// where many contacts of a warp share an owner and the atomics contend.
+    void UseWarpAggregatedForceReduction(bool flag = true) { use_warp_agg_force_reduction = flag; }
+
+    /// Let the integration kernel record the velocity magnitude of each owner, which kT needs for deciding contact
+    /// margins, rather than running a separate inspection pass over owner velocities whenever dT sends kT a work order.
+    void UseFusedVelocityMagnitudePass(bool flag = true) { use_fused_absv_pass = flag; }
+
+    /// Evaluate the ChangeFamilyWhen conditions in the integration kernel, right before each owner is integrated,
+    /// rather than in a separate sweep over the owners. The conditions see the same owner states either way, so the
+    /// family changes are the same. Helps when there are many conditions, or many owners.
+    void SetFamilyChangeInIntegration(bool flag = true) { family_change_in_integration = flag; }
+
     /// Instruct the solver that there is no need to record the contact force (and contact point location etc.) in an
     /// array. If set to true, the contact forces must be reduced to accelerations right in the force calculation kernel
     /// (meaning SetCollectAccRightAfterForceCalc is effectively called too). Calling this method could reduce some
@@ -926,6 +1203,101 @@ class DEMSolver {
             collect_force_in_force_kernel = flag;
     }
 
+    /// Capture the kernel sequence of a dT time step into a CUDA graph and replay it at each step, rather than
+    /// launching and synchronizing kernels one by one. This reduces the launch overhead, which can dominate the step
+    /// time for small-to-medium sized problems. The graph is re-captured only when the number of contacts or owners
+    /// changes. It has no effect if CUB-based force collection (UseCubForceCollection) is used.
+    void UseCudaGraphs(bool flag = true) { use_cuda_graphs = flag; }
+
+    /// Do not synchronize the worker streams after each kernel. Kernels that depend on each other are simply queued on
+    /// the same stream, and the host only waits where it needs a device-computed value (such as the number of
+    /// contacts), plus once per dT step. Solver timers then use CUDA events. Kernel errors may be reported later than
+    /// the kernel that caused them, so it is best used on well-tested scripts.
+    void UseNoSyncMode(bool flag = true) { use_no_sync_mode = flag; }
+
+    /// Time the solver phases (those reported by ShowTimingStats) with CUDA events recorded on the worker streams,
+    /// instead of host wall time. The timings then measure the device work of each phase and do not rely on the
+    /// stream being synchronized at the end of it, so they stay meaningful in no-sync mode (which implies it). Host-side
+    /// waits, such as for the other worker's update, show up as (nearly) 0 in this mode.
+    void UseEventTiming(bool flag = true) { use_event_timing = flag; }
+
+    /// @brief Have kT measure how spheres, triangles and sphere--sphere contacts are spread over the bins, as
+    /// histograms over the active bins, to help pick the bin size, the max number of spheres per bin and the margins.
+    /// The profiling pass is a few small kernels plus a sync, counted in the contact detection time.
+    /// @param use Whether to profile.
+    /// @param every_n_updates Profile at every this many contact detections.
+    void UseBinOccupancyProfiler(bool use = true, unsigned int every_n_updates = 1) {
+        bin_profile_freq = use ? (every_n_updates > 0 ? every_n_updates : 1) : 0;
+    }
+
+    /// Serve the worker threads' scratch space and the temporary arrays only the device touches (binning, sorting and
+    /// history mapping arrays) from a stream-ordered device memory pool per thread (cudaMallocAsync) rather than from
+    /// managed memory. Those arrays then grow geometrically and never migrate between host and device, which helps on
+    /// nodes where page migration is costly. The solver data arrays and the temporary arrays the host reads (such as
+    /// scan results whose totals size the next step) stay in managed memory. It must be set before Initialize.
+    void UseDeviceMemoryPool(bool flag = true) { use_device_mem_pool = flag; }
+
+    /// Advise the driver to keep the solver's hot managed arrays on the device (and the rarely changing ones, such as
+    /// clump template data, read-mostly), and prefetch them back to the device at the start of every user call. This
+    /// way the first steps after host-side access (trackers, output, SetOwnerPosition etc.) do not stall on page
+    /// faults. It has no effect on devices without concurrent managed access.
+    void UseManagedMemoryHints(bool flag = true) { use_managed_mem_hints = flag; }
+
+    /// Set a budget (in bytes) for the device memory that the solver's arrays and scratch space take, counting both
+    /// worker threads (0, the default, means no budget). Under a budget, the initial over-allocation of the contact
+    /// arrays is lowered to what fits, the bin size is steered larger when the memory use nears the budget, and an
+    /// allocation that does not fit errors out (telling which array it was for) before it is attempted, rather than
+    /// running out of device memory mid-simulation. It should be set before Initialize.
+    void SetMemoryBudget(size_t bytes) { m_mem_budget = bytes; }
+
+    /// @brief Tell the solver how many contacts the simulation is expected to have.
+    /// @details The contact arrays of both worker threads, and the buffers between them, are then sized for that many
+    /// contacts at Initialize (and UpdateClumps), rather than grown over the first few contact detections. Contacts
+    /// loaded with clump batches or from a checkpoint are always sized for, with some room to spare. Under a memory
+    /// budget, the sizes are lowered to what fits.
+    void SetContactNumHint(size_t num_contacts) { m_cnt_num_hint = num_contacts; }
+
+    /// Calculate contact forces with one kernel per contact class (sphere--sphere, sphere--mesh, sphere--analytical)
+    /// rather than one kernel that branches on the contact type. Each kernel is compiled with only the code for its
+    /// class, which lowers register use and avoids warp divergence. It needs type-sorted contact pairs
+    /// (SetSortContactPairs(true), the default), and if concurrent_streams is true, the class-specific kernels run on
+    /// separate streams so small classes can overlap with the large ones. dT steps are not captured in CUDA graphs
+    /// (UseCudaGraphs) when this is in use.
+    void UseSegmentedForceKernels(bool use = true, bool concurrent_streams = false) {
+        use_segmented_force_kernels = use;
+        use_segmented_force_streams = concurrent_streams;
+    }
+
+    /// Let kT send dT only the contacts that are new in each contact detection update, rather than the entire contact
+    /// array. dT rebuilds the persistent contacts from its own arrays using the persistent contact map. This moves far
+    /// fewer bytes for slow-moving systems (packing, settling beds) where most contacts persist across updates. It only
+    /// works with history-based contact models; for historyless runs it is ignored.
+    void UseDeltaContactTransfer(bool flag = true) { use_delta_contact_transfer = flag; }
+
+    /// @brief Let kT skip contact detection and reuse the last contact list, if no sphere has moved far enough since
+    /// the last contact detection to use up its contact margin (the Verlet skin approach). This helps settled or slowly
+    /// sheared systems, where most updates would find the same contacts.
+    /// @param flag Whether to reuse contact lists.
+    /// @param skin Extra thickness added to the contact margin when contact detection actually runs, so that it lasts
+    /// for more updates. A thicker skin means more skipped updates, but also more contact pairs to process.
+    void UseContactListReuse(bool flag = true, float skin = 0.f) {
+        use_contact_list_reuse = flag;
+        contact_list_skin = skin;
+    }
+    /// @brief Periodically re-order the sphere components in memory along the Z-order (Morton) curve of their owners'
+    /// locations, so spheres that are close in space are also close in memory. This improves the memory access
+    /// pattern of contact detection and force calculation in systems where particles mix a lot over time.
+    /// Contact history is kept. A custom force model whose contact wildcards change sign when the two spheres of a
+    /// contact are swapped should mark them with SetAntisymmetricContactWildcards.
+    /// @param n The re-ordering happens at the first kT--dT sync point after every n kT updates. 0 disables it.
+    void SetSphereReorderFreq(unsigned int n) { sphere_reorder_freq = n; }
+    /// @brief Enable or disable caching the bin touches of the spheres in fixed families (by default it is on).
+    /// @details Spheres of families set with SetFamilyFixed do not move, so contact detection works out which bins
+    /// they touch once, and reuses that till they are moved or change family. This helps when the container is made of
+    /// many fixed spheres.
+    /// @param use Enable or disable.
+    void UseFixedFamilyBinCache(bool use = true) { use_fixed_bin_cache = use; }
+
     /// Add an (analytical or clump-represented) external object to the simulation system.
     std::shared_ptr<DEMExternObj> AddExternalObject();
     /// @brief Add an analytical plane to the simulation.
@@ -959,9 +1331,74 @@ class DEMSolver {
     /// @param outfilename Output filename.
     /// @param force_thres Forces with magnitude smaller than this amount will not be outputted.
     void WriteContactFile(const std::string& outfilename, float force_thres = DEME_TINY_FLOAT) const;
+    /// @brief Only write the contacts that involve an owner of one of these families in WriteContactFile.
+    /// @details Like the force threshold, this is tested on the GPU, and only the contacts that pass are copied back.
+    /// @param families The families. Empty means all families.
+    void SetContactOutputFamilies(const std::vector<unsigned int>& families);
+    /// @brief Only write the contacts whose contact point is in the box [min, max] in WriteContactFile.
+    void SetContactOutputRegion(const float3& min, const float3& max);
+    /// Remove the family and region filters of contact output
+    void ClearContactOutputFilters();
+    /// @brief Only write the owners whose CoM is in a region in WriteClumpFile and WriteSphereFile (WriteSphereFile
+    /// then writes the spheres of these owners).
+    /// @details The region is tested on the GPU, like an inspector's region, and only the owners that pass are copied
+    /// back. It is a CSV and binary output feature.
+    /// @param region Code that returns a bool which is a result of logical operations involving X, Y and Z, the same as
+    /// the region of CreateInspector.
+    void SetOutputRegion(const std::string& region);
+    /// @brief Only write the owners whose CoM is in the box [min, max] in WriteClumpFile and WriteSphereFile.
+    void SetOutputRegion(const float3& min, const float3& max);
+    /// @brief Make an output region that can be switched to with SetOutputRegion any number of times.
+    /// @details Each SetOutputRegion(region) call builds a new region test, which is jitified at its first use. If the
+    /// output region changes often between a few fixed regions, make them once with this instead.
+    /// @param region The same as that of SetOutputRegion.
+    /// @return The region, which is an inspector that inspects nothing.
+    std::shared_ptr<DEMInspector> CreateOutputRegion(const std::string& region);
+    /// @brief Only write the owners in a region made by CreateOutputRegion in WriteClumpFile and WriteSphereFile.
+    void SetOutputRegion(const std::shared_ptr<DEMInspector>& region);
+    /// @brief Only write one in every stride owners (by owner ID) in WriteClumpFile and WriteSphereFile, for a lighter
+    /// look at a large system. It is applied together with the output region, if there is one.
+    void SetOutputStride(unsigned int stride);
+    /// Remove the region and stride filters of clump and sphere output
+    void ClearOutputFilters();
     /// Write the current status of all meshes to a file
     void WriteMeshFile(const std::string& outfilename) const;
 
+    /// @brief Write the full simulation state to a binary checkpoint file, for restarting the simulation later.
+    /// @details Unlike a clump file, the checkpoint has the exact owner states, all wildcards (including contact
+    /// history), the family masks and the contact list, and it is quick to write and read. The sections of the file
+    /// are aligned, so it can also be memory-mapped. The model itself (clump templates, materials, prescribed motions,
+    /// force model) is not in it: it is the script that sets it up.
+    void WriteCheckpoint(const std::string& filename);
+    /// @brief Load the simulation state from a checkpoint file written by WriteCheckpoint.
+    /// @details Call it after Initialize, on a simulation set up the same way as the one which wrote the checkpoint
+    /// (the same clumps, meshes and analytical objects). The first contact detection after this maps onto the stored
+    /// contacts, so the contact history carries over.
+    void ReadCheckpoint(const std::string& filename);
+
+    /// @brief Make WriteSphereFile, WriteClumpFile and WriteContactFile return right after taking a snapshot of the
+    /// data they need, with the formatting and writing done by a background thread.
+    /// @param use_async Whether to write files in the background.
+    /// @param max_pending Max number of files that can be waiting to be written. If there are many, the next write call
+    /// blocks until one of them finishes.
+    void SetAsyncOutput(bool use_async = true, unsigned int max_pending = 2);
+    /// Block until all output files submitted so far are written. Errors in background writing are reported here.
+    void WaitForPendingOutputs();
+
+    /// @brief Start a time-series output file, which WriteTimeSeriesFrame then appends frames of owner states to.
+    /// @details A frame has the positions (at the solver's own sub-voxel resolution), orientations, families and clump
+    /// types of all owners. Frames are stored as the changes to the previous frame and are compressed, so movie-rate
+    /// output of a long run stays small. Any frame can be read back by its index with DEMTimeSeriesFileReader.
+    /// @param filename Output filename.
+    /// @param keyframe_interval Every this many frames, a frame is stored in full. Reading a frame decodes at most
+    /// this many frames.
+    void OpenTimeSeriesOutput(const std::string& filename, unsigned int keyframe_interval = 64);
+    /// Append the current owner states as a frame to the time-series file. Like other output files, it can be written
+    /// in the background (see SetAsyncOutput).
+    void WriteTimeSeriesFrame();
+    /// Finish the time-series file, writing its frame index. It also happens when the solver is destroyed.
+    void CloseTimeSeriesOutput();
+
     /// @brief Read 3 columns of your choice from a CSV filem and group them by clump_header.
     /// @param infilename CSV filename.
     /// @param x_header CSV header for the first col.
@@ -1089,6 +1526,29 @@ class DEMSolver {
         return w_vals;
     }
 
+    /// @brief Read a sphere, clump or contact file written in OUTPUT_FORMAT::BINARY.
+    /// @details Columns are named the same as in the CSV counterparts, and can be retrieved using GetFloatColumn,
+    /// GetUintColumn or GetStringColumn of the returned table.
+    /// @param infilename Binary output filename.
+    /// @return A table holding all columns in the file.
+    static DEMBinaryTable ReadBinaryOutputFile(const std::string& infilename) {
+        return DEMBinaryTable::Read(infilename);
+    }
+    /// Read clump coordinates from a binary file (whose format is consistent with this solver's clump output file).
+    /// Returns an unordered_map which maps each unique clump type name to a vector of float3 (XYZ coordinates).
+    static std::unordered_map<std::string, std::vector<float3>> ReadClumpXyzFromBinary(const std::string& infilename) {
+        DEMBinaryTable table = DEMBinaryTable::Read(infilename);
+        std::vector<std::string> types = table.GetStringColumn(OUTPUT_FILE_CLUMP_TYPE_NAME);
+        std::vector<float> X = table.GetFloatColumn(OUTPUT_FILE_X_COL_NAME);
+        std::vector<float> Y = table.GetFloatColumn(OUTPUT_FILE_Y_COL_NAME);
+        std::vector<float> Z = table.GetFloatColumn(OUTPUT_FILE_Z_COL_NAME);
+        std::unordered_map<std::string, std::vector<float3>> type_xyz_map;
+        for (size_t i = 0; i < types.size(); i++) {
+            type_xyz_map[types[i]].push_back(host_make_float3(X[i], Y[i], Z[i]));
+        }
+        return type_xyz_map;
+    }
+
     /// Intialize the simulation system.
     void Initialize();
 
@@ -1107,10 +1567,25 @@ class DEMSolver {
     /// initialization.
     void UpdateSimParams();
 
-    /// @brief TTransfer newly loaded clumps to the GPU-side in mid-simulation.
+    /// @brief TTransfer newly loaded clumps to the GPU-side in mid-simulation. New clump templates, materials and
+    /// family prescriptions can be loaded before calling it: then only the kernels whose jitified sources are affected
+    /// get re-compiled, and the existing simulation entities stay as they are.
     void UpdateClumps();
 
-    /// @brief Update the time step size. Used after system initialization.
+    /// @brief Insert a batch of clumps into the simulation, without kT and dT having to be synced.
+    /// @details The batch is packed into pinned host memory right away, then dT appends it to the device arrays with
+    /// async copies at its next handoff with kT (or when kT and dT are synced, whichever comes first). This is much
+    /// cheaper than UpdateClumps for adding clumps often, such as from an inlet. The templates of these clumps must
+    /// already be in the system, and the batch may not carry contact pairs; for those cases, use UpdateClumps. The new
+    /// clumps get contacts from the first contact detection that sees them.
+    /// @param input_batch The batch of clumps to insert. It is not cached, so UpdateClumps will not add it again.
+    /// @return A tracker of the inserted clumps. It can be used once the clumps are in the simulation.
+    std::shared_ptr<DEMTracker> InsertClumps(DEMClumpBatch& input_batch);
+    std::shared_ptr<DEMTracker> InsertClumps(const std::vector<std::shared_ptr<DEMClumpTemplate>>& input_types,
+                                             const std::vector<float3>& input_xyz);
+
+    /// @brief Update the time step size. Used after system initialization. If the step size is adapted and no max bound
+    /// is set, this becomes the new max bound.
     /// @param ts Time step size.
     void UpdateStepSize(double ts);
 
@@ -1120,10 +1595,51 @@ class DEMSolver {
 
     /// Show the wall time and percentages of wall time spend on various solver tasks.
     void ShowTimingStats();
+    /// @brief Get the wall time (in seconds) each solver timer of kT and dT has recorded, the same numbers that
+    /// ShowTimingStats prints.
+    /// @param kT_names Names of kT's timers.
+    /// @param kT_seconds Wall time recorded by each kT timer.
+    /// @param dT_names Names of dT's timers.
+    /// @param dT_seconds Wall time recorded by each dT timer.
+    void GetTimingStats(std::vector<std::string>& kT_names,
+                        std::vector<double>& kT_seconds,
+                        std::vector<std::string>& dT_names,
+                        std::vector<double>& dT_seconds);
 
     /// Show potential anomalies that may have been there in the simulation, then clear the anomaly log.
     void ShowAnomalies();
 
+    /// @brief Get the latest bin occupancy profile kT has taken (see UseBinOccupancyProfiler).
+    /// @return The profile. Its valid field is false if none has been taken yet.
+    DEMBinOccupancyProfile GetBinOccupancyProfile();
+
+    /// Print the latest bin occupancy profile kT has taken (see UseBinOccupancyProfiler).
+    void ShowBinOccupancyProfile();
+
+    /// @brief Get a snapshot of the solver's performance-related numbers: the per-phase timings, kT--dT collaboration
+    /// stats, contact and bin numbers (with the recent bin size changes), device memory use per subsystem, the current
+    /// future drift and the anomaly flags. Unlike ShowAnomalies, this does not clear the anomaly log.
+    /// @return The report, which can be written as JSON using its ToJson method.
+    DEMPerformanceReport GetPerformanceReport();
+
+    /// @brief Have a performance report made and handed to a callback every so often in simulated time, for example to
+    /// feed cluster monitoring. To make this happen mid-run, DoDynamics calls are cut at the report times, which costs
+    /// a little dT--main thread handshake at each report.
+    /// @param callback The function to call with each report. An empty function switches the reports off.
+    /// @param interval Simulated time (s) between two reports.
+    void SetPerformanceReportCallback(const std::function<void(const DEMPerformanceReport&)>& callback,
+                                      double interval);
+
+    /// Show the current and peak device memory use of the solver, by worker thread and subsystem (owner, sphere,
+    /// contact, scratch etc.), plus the memory budget if one is set.
+    void ShowMemStats();
+
+    /// Get the number of bytes the solver's arrays and scratch space currently take on the device(s).
+    size_t GetDeviceMemUsage() const;
+    /// Get the peak number of bytes the solver's arrays and scratch space have taken (the sum of peaks of the two
+    /// worker threads).
+    size_t GetDeviceMemPeak() const;
+
     /// Reset the collaboration stats between dT and kT back to the initial value (0). You should call this if you want
     /// to start over and re-inspect the stats of the new run; otherwise, it is generally not needed, you can go ahead
     /// and destroy DEMSolver.
@@ -1132,7 +1648,10 @@ class DEMSolver {
     /// Reset the recordings of the wall time and percentages of wall time spend on various solver tasks.
     void ClearTimingStats();
 
-    /// Removes all entities associated with a family from the arrays (to save memory space).
+    /// Removes all clumps of a family, with their spheres and contacts, from the arrays (to save memory space and
+    /// bandwidth). The arrays are compacted on the device, and trackers are remapped; a tracker all of whose owners are
+    /// removed becomes broken. Analytical objects and meshes in this family are not removed. Call it after kT and dT
+    /// are synced (such as after DoDynamicsThenSync). Clump and sphere IDs after the removed ones shift down.
     void PurgeFamily(unsigned int family_num);
 
     /// Release the memory for the flattened arrays (which are used for initialization pre-processing and transferring
@@ -1155,7 +1674,9 @@ class DEMSolver {
     // call.
     // void SetClumpOutputMode(OUTPUT_MODE mode) { m_clump_out_mode = mode; }
 
-    /// Choose output format.
+    /// Choose output format. OUTPUT_FORMAT::BINARY writes a versioned columnar binary file, which is much smaller and
+    /// faster to write than CSV, and can be read back using ReadBinaryOutputFile. OUTPUT_FORMAT::VTP writes the same
+    /// columns as a binary VTK XML poly data file, which ParaView opens directly.
     void SetOutputFormat(OUTPUT_FORMAT format) { m_out_format = format; }
     /// Specify the information that needs to go into the clump or sphere output files.
     void SetOutputContent(unsigned int content) { m_out_content = content; }
@@ -1163,7 +1684,8 @@ class DEMSolver {
     void SetContactOutputFormat(OUTPUT_FORMAT format) { m_cnt_out_format = format; }
     /// Specify the information that needs to go into the contact pair output files.
     void SetContactOutputContent(unsigned int content) { m_cnt_out_content = content; }
-    /// Specify the file format of meshes.
+    /// Specify the file format of meshes. MESH_FORMAT::VTU writes a binary VTK XML unstructured grid, with the vertices
+    /// moved to the global frame on the device.
     void SetMeshOutputFormat(MESH_FORMAT format) { m_mesh_out_format = format; }
     /// Enable/disable outputting owner wildcard values to file.
     void EnableOwnerWildcardOutput(bool enable = true) { m_is_out_owner_wildcards = enable; }
@@ -1177,7 +1699,7 @@ class DEMSolver {
     /// Recommend "INFO".
     void SetVerbosity(const std::string& verbose);
     /// @brief Choose sphere and clump output file format.
-    /// @param format Choice among "CSV", "BINARY".
+    /// @param format Choice among "CSV", "BINARY", "VTP".
     void SetOutputFormat(const std::string& format);
     /// @brief Specify the information that needs to go into the clump or sphere output files.
     /// @param content A list of "XYZ", "QUAT", "ABSV", "VEL", "ANG_VEL", "ABS_ACC", "ACC", "ANG_ACC", "FAMILY", "MAT",
@@ -1191,7 +1713,7 @@ class DEMSolver {
     /// "GEO_ID" and/or "NICKNAME".
     void SetContactOutputContent(const std::vector<std::string>& content);
     /// @brief Specify the output file format of meshes.
-    /// @param format A choice between "VTK", "OBJ".
+    /// @param format Choice among "VTK", "OBJ", "VTU".
     void SetMeshOutputFormat(const std::string& format);
 
     // void SetOutputContent(const std::string& content) { SetOutputContent({content}); }
@@ -1208,16 +1730,24 @@ class DEMSolver {
     void RemoveKernelInclude() { kernel_includes = " "; }
 
     /// Let dT do this call and return the reduce value of the inspected quantity.
-    float dTInspectReduce(const std::shared_ptr<jitify::Program>& inspection_kernel,
+    float dTInspectReduce(const std::shared_ptr<JitProgram>& inspection_kernel,
                           const std::string& kernel_name,
                           INSPECT_ENTITY_TYPE thing_to_insp,
                           CUB_REDUCE_FLAVOR reduce_flavor,
                           bool all_domain);
-    float* dTInspectNoReduce(const std::shared_ptr<jitify::Program>& inspection_kernel,
+    float* dTInspectNoReduce(const std::shared_ptr<JitProgram>& inspection_kernel,
                              const std::string& kernel_name,
                              INSPECT_ENTITY_TYPE thing_to_insp,
                              CUB_REDUCE_FLAVOR reduce_flavor,
                              bool all_domain);
+    /// Let dT evaluate a fused inspector group and return the reduced value of each of its slots.
+    std::vector<float> dTInspectGroupReduce(const std::shared_ptr<JitProgram>& fused_kernel,
+                                            unsigned int n_owner_slots,
+                                            unsigned int n_sphere_slots);
+    /// Same, but queue it on dT's stream and return a handle to the values, without waiting for them.
+    std::shared_ptr<DEMAsyncResult> dTInspectGroupReduceAsync(const std::shared_ptr<JitProgram>& fused_kernel,
+                                                              unsigned int n_owner_slots,
+                                                              unsigned int n_sphere_slots);
 
   private:
     ////////////////////////////////////////////////////////////////////////////////
@@ -1228,6 +1758,8 @@ class DEMSolver {
     VERBOSITY verbosity = INFO;
     // If true, dT should sort contact arrays (based on contact type) before usage
     bool should_sort_contacts = true;
+    // If true, kT maps contact history with a hash table rather than a sort-based pipeline
+    bool use_hash_history_mapping = false;
     // If true, the solvers may need to do a per-step sweep to apply family number changes
     bool famnum_can_change_conditionally = false;
 
@@ -1244,6 +1776,8 @@ class DEMSolver {
     // Whether to auto-adjust the bin size and the max update frequency
     bool auto_adjust_bin_size = true;
     bool auto_adjust_update_freq = true;
+    // Whether the adaptive update frequency is driven by the measured kT and dT costs
+    bool use_cost_model_update_freq = false;
     // User-instructed initial bin size as a multiple of smallest sphere radius
     float m_binSize_as_multiple = 8.0;
     // Target initial bin number
@@ -1328,6 +1862,8 @@ class DEMSolver {
     float m_approx_max_vel = DEME_HUGE_FLOAT;
     // The inspector that will be used for querying system max velocity
     std::shared_ptr<DEMInspector> m_approx_max_vel_func;
+    // Whether m_approx_max_vel_func is the one created from the DEFAULT strategy
+    bool m_approx_max_vel_func_is_default = false;
 
     // The number of user-estimated (max) number of owners that will be present in the simulation. If 0, then the arrays
     // will just be resized at intialization based on the input size.
@@ -1367,6 +1903,16 @@ class DEMSolver {
     unsigned int threshold_too_many_spheres_in_bin = 32768;
     // If the solver sees there are more triangles in a bin than a this `maximum', it errors out
     unsigned int threshold_too_many_tri_in_bin = 32768;
+    // See UseHierarchicalBins
+    float hierarchical_bin_coarse_radius = 0.f;
+    // See UseBinLocalCDCoordinates
+    bool use_bin_local_cd_coords = false;
+    // See UseTwoDimensionalMode
+    bool use_2d_mode = false;
+    // See InstructBoxDomainPeriodicBC
+    bool m_periodic_x = false;
+    bool m_periodic_y = false;
+    bool m_periodic_z = false;
     // The max velocity at which the simulation should error out
     float threshold_error_out_vel = 1e3;
     // Num of steps that kT takes average before making a conclusion on the performance of this bin size
@@ -1385,6 +1931,64 @@ class DEMSolver {
     bool no_recording_contact_forces = false;
     // See SetCollectAccRightAfterForceCalc
     bool collect_force_in_force_kernel = false;
+    // See UseWarpAggregatedForceReduction
+    bool use_warp_agg_force_reduction = false;
+    // See UseFusedVelocityMagnitudePass
+    bool use_fused_absv_pass = false;
+    // See SetFamilyChangeInIntegration
+    bool family_change_in_integration = false;
+    // See EnableSleeping
+    bool use_sleeping = false;
+    float sleep_lin_vel_threshold = 0.f;
+    float sleep_ang_vel_threshold = 0.f;
+    float sleep_acc_threshold = 0.f;
+    unsigned int sleep_num_steps = 100;
+    // See UseCudaGraphs
+    bool use_cuda_graphs = false;
+    // See UseNoSyncMode
+    bool use_no_sync_mode = false;
+    // See UseEventTiming
+    bool use_event_timing = false;
+    // See UseBinOccupancyProfiler
+    unsigned int bin_profile_freq = 0;
+    // See SetPerformanceReportCallback
+    std::function<void(const DEMPerformanceReport&)> m_perf_report_callback;
+    double m_perf_report_interval = 0.;
+    double m_next_perf_report_time = 0.;
+    // See UseDeviceMemoryPool
+    bool use_device_mem_pool = false;
+    // See UseManagedMemoryHints
+    bool use_managed_mem_hints = false;
+    // See SetMemoryBudget
+    size_t m_mem_budget = 0;
+    // See SetContactNumHint
+    size_t m_cnt_num_hint = 0;
+    // Family and region filters of contact output (the force threshold is given at each WriteContactFile call)
+    DEMContactOutputFilter m_cnt_out_filter;
+    // Region and stride filters of clump and sphere output
+    DEMOwnerOutputFilter m_owner_out_filter;
+    // Whether the output region was made by SetOutputRegion(string), not CreateOutputRegion, and so is dropped when
+    // the region changes
+    bool m_owner_out_region_is_temp = false;
+    // See UseLaunchConfigAutotune
+    bool autotune_launch_config = false;
+    // See UseSegmentedForceKernels
+    bool use_segmented_force_kernels = false;
+    bool use_segmented_force_streams = false;
+    // See UseDeltaContactTransfer
+    bool use_delta_contact_transfer = false;
+    // See UseContactListReuse
+    bool use_contact_list_reuse = false;
+    float contact_list_skin = 0.f;
+    // See SetSphereReorderFreq
+    unsigned int sphere_reorder_freq = 0;
+    // See UseFixedFamilyBinCache
+    bool use_fixed_bin_cache = true;
+
+    // Background writer of output files, if SetAsyncOutput is used
+    std::shared_ptr<DEMAsyncOutputWriter> m_output_writer;
+    // See OpenTimeSeriesOutput
+    std::shared_ptr<DEMTimeSeriesFileWriter> m_time_series_writer;
 
     // Error-out avg num contacts
     float threshold_error_out_num_cnts = 100.;
@@ -1395,9 +1999,23 @@ class DEMSolver {
     // The force model which will be used
     std::shared_ptr<DEMForceModel> m_force_model =
         std::make_shared<DEMForceModel>(std::move(DEMForceModel(FORCE_MODEL::HERTZIAN)));
+    // A copy of the main force model with the requirements (wildcards, material properties) of the extra models merged
+    // in. It is what the solver arrays and kernels are built from; made at each initialization.
+    std::shared_ptr<DEMForceModel> m_merged_force_model;
+    // Extra force models (model i + 1 in the force kernel; the main one is model 0), and the family and material pairs
+    // assigned to them
+    std::vector<std::shared_ptr<DEMForceModel>> m_extra_force_models;
+    std::vector<std::pair<familyPair_t, std::shared_ptr<DEMForceModel>>> m_family_pair_force_models;
+    std::vector<std::pair<std::pair<std::shared_ptr<DEMMaterial>, std::shared_ptr<DEMMaterial>>,
+                          std::shared_ptr<DEMForceModel>>>
+        m_mat_pair_force_models;
 
     // Strategy for auto-adapting time steps size
     ADAPT_TS_TYPE adapt_ts_type = ADAPT_TS_TYPE::NONE;
+    // See SetAdaptiveTimeStepBounds and SetAdaptiveTimeStepSafetyFactor
+    double adapt_ts_min = 0.;
+    double adapt_ts_max = -1.;
+    float adapt_ts_safety = 0.05;
 
     ////////////////////////////////////////////////////////////////////////////////
     // No user method is provided to modify the following key quantities, even if
@@ -1418,11 +2036,14 @@ class DEMSolver {
 
     // Cached inspectors that can be used to query the simulation system
     std::vector<std::shared_ptr<DEMInspector>> m_inspectors;
+    std::vector<std::shared_ptr<DEMInspectorGroup>> m_inspector_groups;
 
     // Total number of spheres
     size_t nSpheresGM = 0;
     // Total number of triangle facets
     size_t nTriGM = 0;
+    // Total number of facets whose nodes are stored on the device. Mesh instances do not add to it.
+    size_t nTriNodeGM = 0;
     // Number of analytical entites (as components of some external objects)
     unsigned int nAnalGM = 0;
     // Total number of owner bodies
@@ -1497,6 +2118,8 @@ class DEMSolver {
     std::unordered_map<std::string, unsigned int> m_geo_wc_num;
     // A map that records the numbering for user-defined per-contact wildcards
     std::unordered_map<std::string, unsigned int> m_cnt_wc_num;
+    // How each per-contact wildcard is stored, in the order of their numbering
+    std::vector<DEMContactWildcardStorage> m_cnt_wc_storage;
 
     // Meshes cached on dT side that has corresponding owner number associated. Useful for modifying meshes.
     std::vector<std::shared_ptr<DEMMeshConnected>> m_meshes;
@@ -1542,6 +2165,8 @@ class DEMSolver {
     std::vector<familyPair_t> m_family_change_pairs;
     // Corrsponding family number changing conditions
     std::vector<std::string> m_family_change_conditions;
+    // Corrsponding number of steps between checks of the conditions
+    std::vector<unsigned int> m_family_change_intervals;
     // Cached user-input no-contact family pairs
     std::vector<familyPair_t> m_input_no_contact_pairs;
     // TODO: add APIs to allow specification of prescribed motions for each family. This information is only needed by
@@ -1568,6 +2193,7 @@ class DEMSolver {
     std::vector<float3> m_input_mesh_obj_xyz;
     std::vector<float4> m_input_mesh_obj_rot;
     std::vector<unsigned int> m_input_mesh_obj_family;
+    std::vector<notStupidBool_t> m_input_mesh_obj_use_bvh;
 
     // Processed unique family prescription info
     std::vector<familyPrescription_t> m_unique_family_prescription;
@@ -1605,6 +2231,8 @@ class DEMSolver {
     std::vector<materialsOffset_t> m_mesh_facet_materials;
     // Material types of these mesh facets
     std::vector<DEMTriangle> m_mesh_facets;
+    // Where the nodes of these mesh facets are in the device-side node arrays
+    std::vector<bodyID_t> m_mesh_facet_node_offsets;
 
     // Clump templates will be flatten and transferred into kernels upon Initialize()
     std::vector<float> m_template_clump_mass;
@@ -1670,12 +2298,18 @@ class DEMSolver {
     /// Flatten some input clump information, to figure out the size of the input, and their associated family numbers
     /// (to make jitifying family policies easier)
     void preprocessClumps();
-    /// Flatten cached clump templates (from ClumpTemplate structs to float arrays)
-    void preprocessClumpTemplates();
+    /// Flatten cached clump templates (from ClumpTemplate structs to float arrays). If allow_reorder is false, the
+    /// templates are not re-ordered for jitification, which is needed when existing clumps already refer to them.
+    void preprocessClumpTemplates(bool allow_reorder = true);
     /// Count the number of `things' that should be in the simulation now
     void updateTotalEntityNum();
     /// Jitify GPU kernels, based on pre-processed user inputs
     void jitifyKernels();
+    /// Re-jitify after new clump templates, materials or family prescriptions are brought in mid-simulation: only the
+    /// substitutions derived from those (and the force model) are re-generated, and only the affected programs rebuilt
+    void rejitifyKernels();
+    /// Build (or bring up to date) the worker threads' and inspectors' programs using the current substitutions
+    void buildJitPrograms();
     /// Figure out the unit length l and numbers of voxels along each direction, based on domain size X, Y, Z
     void figureOutNV();
     /// Set the default bin (for contact detection) size to be the same of the smallest sphere
@@ -1693,6 +2327,8 @@ class DEMSolver {
     void initializeGPUArrays();
     /// Allocate memory space for GPU-side arrays
     void allocateGPUArrays();
+    /// Size the contact arrays of kT and dT for the contact number hint, or the loaded contacts, whichever is more
+    void reserveContactArrays(size_t nLoadedContacts);
     /// Pack array pointers to a struct so they can be easily used as kernel arguments
     void packDataPointers();
     /// Warn users if the data types defined in Defines.h do not blend well with the user inputs (fist-round
@@ -1708,6 +2344,9 @@ class DEMSolver {
     void reportInitStats() const;
     /// Based on user input, prepare family_mask_matrix (family contact map matrix)
     void figureOutFamilyMasks();
+    /// Let dT run this amount of time and wait till it is done; the body of DoDynamics, without report emission
+    void runDynamics(double thisCallDuration);
+
     /// Reset kT and dT back to a status like when the simulation system is constructed. I decided to make this a
     /// private method because it can be dangerous, as if it is called when kT is waiting at the outer loop, it will
     /// stall the siumulation. So perhaps the user should not call it without knowing what they are doing. Also note
@@ -1752,6 +2391,8 @@ class DEMSolver {
                           std::vector<family_t>& famA,
                           std::vector<family_t>& famB,
                           std::function<bool(contact_t)> type_func) const;
+    /// Run this output job right away, or hand it to the background writer if SetAsyncOutput is used
+    void submitOutputJob(std::function<void()>&& job) const;
 
     // Some JIT packaging helpers
     inline void equipClumpTemplates(std::unordered_map<std::string, std::string>& strMap);
@@ -1763,6 +2404,19 @@ class DEMSolver {
     inline void equipFamilyPrescribedMotions(std::unordered_map<std::string, std::string>& strMap);
     inline void equipFamilyOnFlyChanges(std::unordered_map<std::string, std::string>& strMap);
     inline void equipForceModel(std::unordered_map<std::string, std::string>& strMap);
+    // Make the solver's copy of the main force model, with the wildcards and material properties the extra force models
+    // need merged in
+    void mergeForceModelRequirements();
+    // Check the declared ranges of 16-bit contact wildcards, and decide which arrays they are in
+    void decideContactWildcardStorage();
+    // The force model code that goes into the force kernel: the main model, or the dispatch to all models
+    std::string assembleForceModels();
+    // The code that picks the force model of a contact, from the family and material pair assignments
+    std::string assembleForceModelSelection();
+    // The force kernels that each run one force model, if there are several models
+    std::string assembleForceModelKernels();
+    // The number of a force model in the force kernel
+    unsigned int getForceModelIndex(const std::shared_ptr<DEMForceModel>& model);
     inline void equipIntegrationScheme(std::unordered_map<std::string, std::string>& strMap);
     inline void equipKernelIncludes(std::unordered_map<std::string, std::string>& strMap);
 };
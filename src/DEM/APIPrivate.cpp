@@ -11,6 +11,7 @@
 #include <iostream>
 #include <fstream>
 #include <thread>
+#include <future>
 #include <chrono>
 #include <cstring>
 #include <limits>
@@ -216,8 +217,36 @@ void DEMSolver::jitifyKernels() {
     equipForceModel(m_subs);
     equipIntegrationScheme(m_subs);
     equipKernelIncludes(m_subs);
-    kT->jitifyKernels(m_subs);
+    buildJitPrograms();
+}
+
+void DEMSolver::rejitifyKernels() {
+    // The wildcards decide the sizes of solver arrays, so changing them needs a re-initialization
+    mergeForceModelRequirements();
+    if (m_merged_force_model->m_contact_wildcards.size() != dT->m_contact_wildcard_names.size() ||
+        m_merged_force_model->m_owner_wildcards.size() != dT->simParams->nOwnerWildcards ||
+        m_merged_force_model->m_geo_wildcards.size() != dT->simParams->nGeoWildcards) {
+        DEME_ERROR(
+            "The number of wildcards in the force model changed since the system was initialized.\nThis cannot be "
+            "handled by UpdateClumps; consider re-initializing the system.");
+    }
+    // The other substitutions are kept from the last jitification. Their inputs (such as analytical object info) could
+    // have been released since then, and they do not change when clumps are added anyway.
+    equipClumpTemplates(m_subs);
+    equipSimParams(m_subs);
+    equipMassMoiVolume(m_subs);
+    equipMaterials(m_subs);
+    equipFamilyPrescribedMotions(m_subs);
+    equipForceModel(m_subs);
+    buildJitPrograms();
+}
+
+void DEMSolver::buildJitPrograms() {
+    // kT and dT programs are built at the same time. Each of them farms out its programs to more threads. The programs
+    // they had before and whose substituted sources are unchanged are kept.
+    auto kT_jit = std::async(std::launch::async, [this]() { kT->jitifyKernels(m_subs); });
     dT->jitifyKernels(m_subs);
+    kT_jit.get();
 
     // Now, inspectors need to be jitified too... but the current design jitify inspector kernels at the first time they
     // are used. for (auto& insp : m_inspectors) {
@@ -229,6 +258,19 @@ void DEMSolver::jitifyKernels() {
     // init).
     m_approx_max_vel_func->Initialize(m_subs, true);
     dT->approxMaxVelFunc = m_approx_max_vel_func;
+    dT->approxMaxVelFuncIsDefault = m_approx_max_vel_func_is_default;
+
+    // If this is a re-jitification, the inspectors that are already in use are brought up to date
+    for (auto& insp : m_inspectors) {
+        if (insp->initialized) {
+            insp->Initialize(m_subs, true);
+        }
+    }
+    for (auto& group : m_inspector_groups) {
+        if (group->initialized) {
+            group->Initialize(m_subs, true);
+        }
+    }
 }
 
 bodyID_t DEMSolver::getGeoOwnerID(const bodyID_t& geoID, const contact_t& cnt_type) const {
@@ -276,6 +318,19 @@ void DEMSolver::getContacts_impl(std::vector<bodyID_t>& idA,
 }
 
 void DEMSolver::figureOutNV() {
+    // In a periodic direction, the world starts exactly where the user box does, so the period starts at LBF
+    if (m_periodic_x) {
+        m_target_box_min.x = m_user_box_min.x;
+        m_target_box_max.x = DEME_MAX(m_target_box_max.x, m_user_box_max.x);
+    }
+    if (m_periodic_y) {
+        m_target_box_min.y = m_user_box_min.y;
+        m_target_box_max.y = DEME_MAX(m_target_box_max.y, m_user_box_max.y);
+    }
+    if (m_periodic_z) {
+        m_target_box_min.z = m_user_box_min.z;
+        m_target_box_max.z = DEME_MAX(m_target_box_max.z, m_user_box_max.z);
+    }
     m_boxLBF = m_target_box_min;
     float3 boxSize = m_target_box_max - m_target_box_min;
 
@@ -421,7 +476,7 @@ void DEMSolver::decideBinSize() {
         }
     }
 
-    m_num_bins = hostCalcBinNum(nbX, nbY, nbZ, m_voxelSize, m_binSize, nvXp2, nvYp2, nvZp2);
+    m_num_bins = hostCalcBinNum(nbX, nbY, nbZ, m_voxelSize, m_binSize, nvXp2, nvYp2, nvZp2, use_2d_mode);
     // It's better to compute num of bins this way, rather than...
     // (uint64_t)(m_boxX / m_binSize + 1) * (uint64_t)(m_boxY / m_binSize + 1) * (uint64_t)(m_boxZ / m_binSize + 1);
     // because the space bins and voxels can cover may be larger than the user-defined sim domain
@@ -435,7 +490,7 @@ void DEMSolver::decideBinSize() {
             } else {
                 m_binSize *= 1.2;
             }
-            m_num_bins = hostCalcBinNum(nbX, nbY, nbZ, m_voxelSize, m_binSize, nvXp2, nvYp2, nvZp2);
+            m_num_bins = hostCalcBinNum(nbX, nbY, nbZ, m_voxelSize, m_binSize, nvXp2, nvYp2, nvZp2, use_2d_mode);
             // If changed size relationship, good enough.
             if ((prev_num < m_target_init_bin_num && m_num_bins >= m_target_init_bin_num) ||
                 (prev_num >= m_target_init_bin_num && m_num_bins < m_target_init_bin_num)) {
@@ -453,7 +508,7 @@ void DEMSolver::decideBinSize() {
                 m_num_bins, m_binSize, (size_t)(std::numeric_limits<binID_t>::max() - 1));
             while (m_num_bins > std::numeric_limits<binID_t>::max() - 1) {
                 m_binSize *= 1.5;
-                m_num_bins = hostCalcBinNum(nbX, nbY, nbZ, m_voxelSize, m_binSize, nvXp2, nvYp2, nvZp2);
+                m_num_bins = hostCalcBinNum(nbX, nbY, nbZ, m_voxelSize, m_binSize, nvXp2, nvYp2, nvZp2, use_2d_mode);
             }
             DEME_WARNING(
                 "Bin size auto-adjusted to %.6g, now we have %zu initial bins. Note this number may be large and it "
@@ -477,6 +532,7 @@ void DEMSolver::decideCDMarginStrat() {
         case (MARGIN_FINDER_TYPE::DEFAULT):
             // Default strategy is to use an inspector
             m_approx_max_vel_func = this->CreateInspector("absv");
+            m_approx_max_vel_func_is_default = true;
             m_max_v_finder_type = MARGIN_FINDER_TYPE::DEM_INSPECTOR;
             break;
     }
@@ -522,6 +578,10 @@ void DEMSolver::reportInitStats() const {
         default:
             DEME_INFO("An unknown force model is in use, this is probably not going well...");
     }
+    if (m_extra_force_models.size() > 0) {
+        DEME_INFO("%zu extra force model(s) are in use, assigned to %zu family pair(s) and %zu material pair(s).",
+                  m_extra_force_models.size(), m_family_pair_force_models.size(), m_mat_pair_force_models.size());
+    }
 
     if (use_user_defined_expand_factor) {
         DEME_INFO(
@@ -596,9 +656,9 @@ void DEMSolver::preprocessAnalyticalObjs() {
     }
 }
 
-void DEMSolver::preprocessClumpTemplates() {
+void DEMSolver::preprocessClumpTemplates(bool allow_reorder) {
     // We really only have to sort clump templates if we wish to jitify clump templates
-    if (jitify_clump_templates) {
+    if (jitify_clump_templates && allow_reorder) {
         // A sort based on the number of components of each clump type is needed, so larger clumps are near the end of
         // the array, so we can always jitify the smaller clumps, and leave larger ones in GPU global memory
         std::sort(m_templates.begin(), m_templates.end(),
@@ -611,9 +671,9 @@ void DEMSolver::preprocessClumpTemplates() {
             DEME_DEBUG_PRINTF("Clump template re-order: %u->%u, nComp: %u", m_templates.at(i)->mark, i,
                               m_templates.at(i)->nComp);
         }
-        // If the user then add more clumps to the system (without adding templates, which mandates a
-        // re-initialization), mapping again is not needed, because now we redefine each template's mark to be the same
-        // as their current position in template array
+        // If the user then add more clumps to the system, mapping again is not needed, because now we redefine each
+        // template's mark to be the same as their current position in template array. Templates added after that land
+        // at the end of the array (not re-ordered), and their marks are their positions too.
         for (unsigned int i = 0; i < m_templates.size(); i++) {
             m_templates.at(i)->mark = i;
         }
@@ -682,6 +742,7 @@ void DEMSolver::preprocessTriangleObjs() {
         m_input_mesh_obj_xyz.push_back(mesh_obj->init_pos);
         m_input_mesh_obj_rot.push_back(mesh_obj->init_oriQ);
         m_input_mesh_obj_family.push_back(mesh_obj->family_code);
+        m_input_mesh_obj_use_bvh.push_back(mesh_obj->use_bvh);
         m_mesh_facet_owner.insert(m_mesh_facet_owner.end(), mesh_obj->GetNumTriangles(), thisMeshObj);
         for (unsigned int i = 0; i < mesh_obj->GetNumTriangles(); i++) {
             m_mesh_facet_materials.push_back(mesh_obj->materials.at(i)->load_order);
@@ -705,6 +766,16 @@ void DEMSolver::preprocessTriangleObjs() {
             }
             m_mesh_facets.push_back(tri);
         }
+        // An instance uses the nodes of the mesh it instances (which is loaded before it); other meshes get their own
+        if (mesh_obj->instance_of) {
+            mesh_obj->node_offset = mesh_obj->instance_of->node_offset;
+        } else {
+            mesh_obj->node_offset = nTriNodeGM;
+            nTriNodeGM += mesh_obj->GetNumTriangles();
+        }
+        for (size_t i = 0; i < mesh_obj->GetNumTriangles(); i++) {
+            m_mesh_facet_node_offsets.push_back(mesh_obj->node_offset + i);
+        }
 
         nTriGM += mesh_obj->GetNumTriangles();
         thisMeshObj++;
@@ -882,6 +953,15 @@ void DEMSolver::addWorldBoundingBox() {
             DEME_ERROR("Domain bounding BC instruction %s is unknown.", m_user_add_bounding_box.c_str());
     }
 
+    // No planes bound a periodic direction
+    bottom = bottom && !m_periodic_z;
+    top = top && !m_periodic_z;
+    const bool sides_x = sides && !m_periodic_x;
+    const bool sides_y = sides && !m_periodic_y;
+    if (!bottom && !top && !sides_x && !sides_y) {
+        return;
+    }
+
     auto box = this->AddExternalObject();
     if (bottom) {
         float3 bottom_loc = (m_user_box_min + m_user_box_max) / 2.;
@@ -889,24 +969,28 @@ void DEMSolver::addWorldBoundingBox() {
         box->AddPlane(bottom_loc, host_make_float3(0, 0, 1), m_bounding_box_material);
     }
 
-    if (sides) {
+    if (sides_x || sides_y) {
         float3 center = (m_user_box_min + m_user_box_max) / 2.;
 
-        float3 left = center;
-        left.x = m_user_box_min.x;
-        box->AddPlane(left, host_make_float3(1, 0, 0), m_bounding_box_material);
+        if (sides_x) {
+            float3 left = center;
+            left.x = m_user_box_min.x;
+            box->AddPlane(left, host_make_float3(1, 0, 0), m_bounding_box_material);
 
-        float3 right = center;
-        right.x = m_user_box_max.x;
-        box->AddPlane(right, host_make_float3(-1, 0, 0), m_bounding_box_material);
+            float3 right = center;
+            right.x = m_user_box_max.x;
+            box->AddPlane(right, host_make_float3(-1, 0, 0), m_bounding_box_material);
+        }
 
-        float3 front = center;
-        front.y = m_user_box_min.y;
-        box->AddPlane(front, host_make_float3(0, 1, 0), m_bounding_box_material);
+        if (sides_y) {
+            float3 front = center;
+            front.y = m_user_box_min.y;
+            box->AddPlane(front, host_make_float3(0, 1, 0), m_bounding_box_material);
 
-        float3 the_back = center;
-        the_back.y = m_user_box_max.y;
-        box->AddPlane(the_back, host_make_float3(0, -1, 0), m_bounding_box_material);
+            float3 the_back = center;
+            the_back.y = m_user_box_max.y;
+            box->AddPlane(the_back, host_make_float3(0, -1, 0), m_bounding_box_material);
+        }
     }
 
     if (top) {
@@ -942,8 +1026,8 @@ void DEMSolver::transferSolverParams() {
     dT->solverFlags.cntOutFlags = output_level;
 
     // Transfer historyless-ness
-    kT->solverFlags.isHistoryless = (m_force_model->m_contact_wildcards.size() == 0);
-    dT->solverFlags.isHistoryless = (m_force_model->m_contact_wildcards.size() == 0);
+    kT->solverFlags.isHistoryless = (m_merged_force_model->m_contact_wildcards.size() == 0);
+    dT->solverFlags.isHistoryless = (m_merged_force_model->m_contact_wildcards.size() == 0);
 
     // Time step constant-ness and expand factor constant-ness
     dT->solverFlags.isStepConst = ts_size_is_const;
@@ -975,27 +1059,128 @@ void DEMSolver::transferSolverParams() {
     // Tell kT and dT whether the user enforeced potential on-the-fly family number changes
     kT->solverFlags.canFamilyChange = famnum_can_change_conditionally;
     dT->solverFlags.canFamilyChange = famnum_can_change_conditionally;
+    dT->solverFlags.useFamilyChangeInIntegration = famnum_can_change_conditionally && family_change_in_integration;
+    // If no rule is checked every step, the steps where none is due need no sweep
+    dT->familyChangeStride = 0;
+    for (const auto& n_steps : m_family_change_intervals) {
+        dT->familyChangeStride = std::gcd(dT->familyChangeStride, n_steps);
+    }
+    if (dT->familyChangeStride == 0) {
+        dT->familyChangeStride = 1;
+    }
+
+    // With several force models, dT runs one force kernel per model, over the contacts grouped by model
+    dT->nForceModels = m_extra_force_models.size() + 1;
+    dT->forceModelsByFamily = (m_family_pair_force_models.size() > 0);
 
     // Force reduction strategy
     kT->solverFlags.useCubForceCollect = use_cub_to_reduce_force;
     dT->solverFlags.useCubForceCollect = use_cub_to_reduce_force;
     dT->solverFlags.useNoContactRecord = no_recording_contact_forces;
     dT->solverFlags.useForceCollectInPlace = collect_force_in_force_kernel;
+    dT->solverFlags.useCudaGraphs = use_cuda_graphs;
+    dT->solverFlags.useFusedAbsvPass = use_fused_absv_pass;
+    kT->solverFlags.useNoSyncMode = use_no_sync_mode;
+    dT->solverFlags.useNoSyncMode = use_no_sync_mode;
+    kT->solverFlags.useEventTiming = use_event_timing;
+    dT->solverFlags.useEventTiming = use_event_timing;
+    kT->solverFlags.binProfileFreq = bin_profile_freq;
+    kT->solverFlags.useManagedMemHints = use_managed_mem_hints;
+    dT->solverFlags.useManagedMemHints = use_managed_mem_hints;
+
+    // Stream-ordered memory pools for the scratch space and temp arrays. Once enabled for a thread, it stays on.
+    if (use_device_mem_pool) {
+        kT->stateOfSolver_resources.enableDevicePool(kT->streamInfo.device, kT->streamInfo.stream);
+        dT->stateOfSolver_resources.enableDevicePool(dT->streamInfo.device, dT->streamInfo.stream);
+    }
+
+    // Both threads check their allocations against the same budget
+    kT->m_mem_registry.SetBudget(m_mem_budget);
+    dT->m_mem_registry.SetBudget(m_mem_budget);
+
+    // If kT and dT are on different devices, they send buffers to each other using peer copies, if supported
+    bool use_peer_transfer = false;
+    if (kT->streamInfo.device != dT->streamInfo.device) {
+        use_peer_transfer = dTkT_GpuManager->enablePeerAccess(kT->streamInfo.device, dT->streamInfo.device) &&
+                            dTkT_GpuManager->enablePeerAccess(dT->streamInfo.device, kT->streamInfo.device);
+        if (use_peer_transfer) {
+            DEME_INFO("kT (device %d) and dT (device %d) exchange buffers using peer-to-peer copies.",
+                      kT->streamInfo.device, dT->streamInfo.device);
+        } else {
+            DEME_WARNING(
+                "kT and dT are on devices %d and %d, which do not support peer access to each other.\nBuffer exchange "
+                "between them will be staged by the driver, which is considerably slower.",
+                kT->streamInfo.device, dT->streamInfo.device);
+        }
+    }
+    kT->solverFlags.usePeerTransfer = use_peer_transfer;
+    dT->solverFlags.usePeerTransfer = use_peer_transfer;
+
+    // Delta-encoded contact transfer relies on the persistent contact map, which only history-based runs build
+    if (use_delta_contact_transfer && kT->solverFlags.isHistoryless) {
+        DEME_WARNING(
+            "UseDeltaContactTransfer is called, but the contact model is historyless.\nThe persistent contact map is "
+            "not built in historyless runs, so the entire contact array will still be sent from kT to dT.");
+    }
+    kT->solverFlags.useContactDelta = use_delta_contact_transfer && !kT->solverFlags.isHistoryless;
+    dT->solverFlags.useContactDelta = use_delta_contact_transfer && !kT->solverFlags.isHistoryless;
+    kT->solverFlags.useContactListReuse = use_contact_list_reuse;
+    kT->solverFlags.useFixedBinCache =
+        use_fixed_bin_cache && std::any_of(m_unique_family_prescription.begin(), m_unique_family_prescription.end(),
+                                           [](const familyPrescription_t& info) { return info.IsFixed(); });
+    kT->solverFlags.contactListSkin = contact_list_skin;
+    // Sphere re-ordering is carried out by dT, while kT is idle
+    dT->solverFlags.sphereReorderFreq = sphere_reorder_freq;
+    if (use_cuda_graphs && use_cub_to_reduce_force) {
+        DEME_WARNING(
+            "UseCudaGraphs is called along with UseCubForceCollection.\nCUB-based force collection cannot be captured "
+            "in a CUDA graph, so dT steps will still be launched kernel by kernel.");
+    }
 
     // Whether sorts contact before using them (not implemented)
     kT->solverFlags.should_sort_pairs = should_sort_contacts;
     dT->solverFlags.should_sort_pairs = should_sort_contacts;
+    // Only kT builds the persistent contact map
+    kT->solverFlags.useHashHistoryMapping = use_hash_history_mapping;
+    // Segmented force calculation relies on kT telling where each contact class starts in a type-sorted array
+    if (use_segmented_force_kernels && !should_sort_contacts) {
+        DEME_WARNING(
+            "UseSegmentedForceKernels is called but contact pairs are not sorted by type "
+            "(SetSortContactPairs(false)).\nContact forces will be calculated by the usual single kernel.");
+    }
+    dT->solverFlags.useSegmentedForceCalc = use_segmented_force_kernels && should_sort_contacts;
+    dT->solverFlags.useSegmentedForceStreams = dT->solverFlags.useSegmentedForceCalc && use_segmented_force_streams;
 
     // Error out policies
     kT->simParams->errOutBinSphNum = threshold_too_many_spheres_in_bin;
     dT->simParams->errOutBinSphNum = threshold_too_many_spheres_in_bin;
     kT->simParams->errOutBinTriNum = threshold_too_many_tri_in_bin;
     dT->simParams->errOutBinTriNum = threshold_too_many_tri_in_bin;
+    kT->simParams->coarseSphereRadius =
+        (hierarchical_bin_coarse_radius > 0.f) ? hierarchical_bin_coarse_radius : DEME_HUGE_FLOAT;
+    dT->simParams->coarseSphereRadius = kT->simParams->coarseSphereRadius;
+    kT->simParams->twoDimensional = use_2d_mode;
+    dT->simParams->twoDimensional = use_2d_mode;
     kT->simParams->errOutVel = threshold_error_out_vel;
     dT->simParams->errOutVel = threshold_error_out_vel;
     kT->solverFlags.errOutAvgSphCnts = threshold_error_out_num_cnts;
     dT->solverFlags.errOutAvgSphCnts = threshold_error_out_num_cnts;
 
+    // Sleeping of resting owners
+    dT->simParams->useSleeping = use_sleeping;
+    dT->simParams->sleepLinVelThres = sleep_lin_vel_threshold;
+    dT->simParams->sleepAngVelThres = sleep_ang_vel_threshold;
+    dT->simParams->sleepAccThres = sleep_acc_threshold;
+    dT->simParams->sleepNumSteps = sleep_num_steps;
+
+    // Step size adapted on the device
+    dT->simParams->adaptTSByVel = (adapt_ts_type != ADAPT_TS_TYPE::NONE);
+    dT->simParams->adaptTSByAcc = (adapt_ts_type == ADAPT_TS_TYPE::INT_DIFF);
+    dT->simParams->adaptTSSafety = adapt_ts_safety;
+    dT->simParams->adaptTSLength = m_smallest_radius;
+    dT->simParams->adaptTSMax = (adapt_ts_max > 0.) ? adapt_ts_max : m_ts_size;
+    dT->simParams->adaptTSMin = DEME_MIN(adapt_ts_min, (double)dT->simParams->adaptTSMax);
+
     // Whether the solver should auto-update bin sizes
     kT->solverFlags.autoBinSize = auto_adjust_bin_size;
     {
@@ -1014,6 +1199,8 @@ void DEMSolver::transferSolverParams() {
     // CDFreq auto-adapt related
     kT->solverFlags.autoUpdateFreq = auto_adjust_update_freq;
     dT->solverFlags.autoUpdateFreq = auto_adjust_update_freq;
+    kT->solverFlags.useCostModelDrift = use_cost_model_update_freq;
+    dT->solverFlags.useCostModelDrift = use_cost_model_update_freq;
     dT->solverFlags.upperBoundFutureDrift = upper_bound_future_drift;
     dT->solverFlags.targetDriftMoreThanAvg = max_drift_ahead_of_avg_drift;
     dT->solverFlags.targetDriftMultipleOfAvg = max_drift_multiple_of_avg_drift;
@@ -1039,9 +1226,9 @@ void DEMSolver::transferSimParams() {
             m_suggestedFutureDrift, m_expand_safety_multi, m_expand_base_vel);
     }
     // Compute the number of wildcards in our force model
-    unsigned int nContactWildcards = m_force_model->m_contact_wildcards.size();
-    unsigned int nOwnerWildcards = m_force_model->m_owner_wildcards.size();
-    unsigned int nGeoWildcards = m_force_model->m_geo_wildcards.size();
+    unsigned int nContactWildcards = m_merged_force_model->m_contact_wildcards.size();
+    unsigned int nOwnerWildcards = m_merged_force_model->m_owner_wildcards.size();
+    unsigned int nGeoWildcards = m_merged_force_model->m_geo_wildcards.size();
     if (nContactWildcards > DEME_MAX_WILDCARD_NUM || nOwnerWildcards > DEME_MAX_WILDCARD_NUM ||
         nGeoWildcards > DEME_MAX_WILDCARD_NUM) {
         DEME_ERROR(
@@ -1051,15 +1238,17 @@ void DEMSolver::transferSimParams() {
             DEME_MAX_WILDCARD_NUM);
     }
     DEME_DEBUG_PRINTF("%u contact wildcards are in the force model.", nContactWildcards);
+    decideContactWildcardStorage();
 
     dT->setSimParams(nvXp2, nvYp2, nvZp2, l, m_voxelSize, m_binSize, nbX, nbY, nbZ, m_boxLBF, m_user_box_min,
                      m_user_box_max, G, m_ts_size, m_expand_factor, m_approx_max_vel, m_expand_safety_multi,
-                     m_expand_base_vel, m_force_model->m_contact_wildcards, m_force_model->m_owner_wildcards,
-                     m_force_model->m_geo_wildcards);
+                     m_expand_base_vel, m_merged_force_model->m_contact_wildcards,
+                     m_merged_force_model->m_owner_wildcards, m_merged_force_model->m_geo_wildcards);
+    dT->setContactWildcardStorage(m_cnt_wc_storage);
     kT->setSimParams(nvXp2, nvYp2, nvZp2, l, m_voxelSize, m_binSize, nbX, nbY, nbZ, m_boxLBF, m_user_box_min,
                      m_user_box_max, G, m_ts_size, m_expand_factor, m_approx_max_vel, m_expand_safety_multi,
-                     m_expand_base_vel, m_force_model->m_contact_wildcards, m_force_model->m_owner_wildcards,
-                     m_force_model->m_geo_wildcards);
+                     m_expand_base_vel, m_merged_force_model->m_contact_wildcards,
+                     m_merged_force_model->m_owner_wildcards, m_merged_force_model->m_geo_wildcards);
 }
 
 void DEMSolver::allocateGPUArrays() {
@@ -1067,17 +1256,29 @@ void DEMSolver::allocateGPUArrays() {
     std::thread dThread = std::move(std::thread([this]() {
         this->dT->allocateManagedArrays(
             this->nOwnerBodies, this->nOwnerClumps, this->nExtObj, this->nTriMeshes, this->nSpheresGM, this->nTriGM,
-            this->nAnalGM, this->nExtraContacts, this->nDistinctMassProperties, this->nDistinctClumpBodyTopologies,
-            this->nDistinctClumpComponents, this->nJitifiableClumpComponents, this->nMatTuples);
+            this->nTriNodeGM, this->nAnalGM, this->nExtraContacts, this->nDistinctMassProperties,
+            this->nDistinctClumpBodyTopologies, this->nDistinctClumpComponents, this->nJitifiableClumpComponents,
+            this->nMatTuples);
     }));
     std::thread kThread = std::move(std::thread([this]() {
         this->kT->allocateManagedArrays(
             this->nOwnerBodies, this->nOwnerClumps, this->nExtObj, this->nTriMeshes, this->nSpheresGM, this->nTriGM,
-            this->nAnalGM, this->nExtraContacts, this->nDistinctMassProperties, this->nDistinctClumpBodyTopologies,
-            this->nDistinctClumpComponents, this->nJitifiableClumpComponents, this->nMatTuples);
+            this->nTriNodeGM, this->nAnalGM, this->nExtraContacts, this->nDistinctMassProperties,
+            this->nDistinctClumpBodyTopologies, this->nDistinctClumpComponents, this->nJitifiableClumpComponents,
+            this->nMatTuples);
     }));
     dThread.join();
     kThread.join();
+    reserveContactArrays(*(dT->stateOfSolver_resources.pNumContacts) + nExtraContacts);
+}
+
+void DEMSolver::reserveContactArrays(size_t nLoadedContacts) {
+    size_t nContacts = DEME_MAX(m_cnt_num_hint, (size_t)((double)nLoadedContacts * DEME_LOADED_CNT_HEADROOM));
+    if (nContacts == 0) {
+        return;
+    }
+    kT->reserveContactArrays(nContacts);
+    dT->reserveContactArrays(nContacts);
 }
 
 void DEMSolver::initializeGPUArrays() {
@@ -1093,7 +1294,7 @@ void DEMSolver::initializeGPUArrays() {
         m_input_ext_obj_xyz, m_input_ext_obj_rot, m_input_ext_obj_family,
         // Meshed objects' initial stats
         cached_mesh_objs, m_input_mesh_obj_xyz, m_input_mesh_obj_rot, m_input_mesh_obj_family, m_mesh_facet_owner,
-        m_mesh_facet_materials, m_mesh_facets,
+        m_mesh_facet_materials, m_mesh_facets, m_mesh_facet_node_offsets,
         // Clump template name mapping
         m_template_number_name_map,
         // Clump template info (mass, sphere components, materials etc.)
@@ -1115,7 +1316,7 @@ void DEMSolver::initializeGPUArrays() {
         // Analytical objects' initial stats
         m_input_ext_obj_family,
         // Meshed objects' initial stats
-        m_input_mesh_obj_family, m_mesh_facet_owner, m_mesh_facets,
+        m_input_mesh_obj_family, m_input_mesh_obj_use_bvh, m_mesh_facet_owner, m_mesh_facets, m_mesh_facet_node_offsets,
         // Family mask
         m_family_mask_matrix,
         // Templates and misc.
@@ -1143,7 +1344,7 @@ void DEMSolver::updateClumpMeshArrays(size_t nOwners,
         m_input_ext_obj_xyz, m_input_ext_obj_rot, m_input_ext_obj_family,
         // Meshed objects' initial stats
         cached_mesh_objs, m_input_mesh_obj_xyz, m_input_mesh_obj_rot, m_input_mesh_obj_family, m_mesh_facet_owner,
-        m_mesh_facet_materials, m_mesh_facets,
+        m_mesh_facet_materials, m_mesh_facets, m_mesh_facet_node_offsets,
         // Clump template info (mass, sphere components, materials etc.)
         flattened_clump_templates,
         // Analytical obj `template' properties
@@ -1164,7 +1365,7 @@ void DEMSolver::updateClumpMeshArrays(size_t nOwners,
         // Analytical objects' initial stats
         m_input_ext_obj_family,
         // Meshed objects' initial stats
-        m_input_mesh_obj_family, m_mesh_facet_owner, m_mesh_facets,
+        m_input_mesh_obj_family, m_input_mesh_obj_use_bvh, m_mesh_facet_owner, m_mesh_facets, m_mesh_facet_node_offsets,
         // Family mask
         m_family_mask_matrix,
         // Templates and misc.
@@ -1217,6 +1418,16 @@ void DEMSolver::validateUserInputs() {
             user_box_size.x, user_box_size.y, user_box_size.z);
     }
 
+    // Periodic BCs
+    if ((m_periodic_x || m_periodic_y || m_periodic_z) && hierarchical_bin_coarse_radius > 0.f) {
+        DEME_ERROR(
+            "Periodic BCs (InstructBoxDomainPeriodicBC) cannot be used with hierarchical bins (UseHierarchicalBins), "
+            "as the coarse level does not see periodic images.");
+    }
+    if (m_periodic_y && use_2d_mode) {
+        DEME_ERROR("In 2D mode (UseTwoDimensionalMode), the simulation is in the XZ plane and Y cannot be periodic.");
+    }
+
     if (m_suggestedFutureDrift < 0) {
         DEME_WARNING(
             "The physics of the DEM system can drift into the future as much as it wants compared to contact "
@@ -1256,16 +1467,206 @@ bool DEMSolver::goThroughWorkerAnomalies() {
 //     }
 // }
 
+void DEMSolver::mergeForceModelRequirements() {
+    // A copy, so the user's force model objects stay as they are given, and merging again (at a re-initialization)
+    // starts from the user's main model
+    m_merged_force_model = std::make_shared<DEMForceModel>(*m_force_model);
+    for (const auto& extra_model : m_extra_force_models) {
+        m_merged_force_model->m_contact_wildcards.insert(extra_model->m_contact_wildcards.begin(),
+                                                         extra_model->m_contact_wildcards.end());
+        m_merged_force_model->m_owner_wildcards.insert(extra_model->m_owner_wildcards.begin(),
+                                                       extra_model->m_owner_wildcards.end());
+        m_merged_force_model->m_geo_wildcards.insert(extra_model->m_geo_wildcards.begin(),
+                                                     extra_model->m_geo_wildcards.end());
+        m_merged_force_model->m_must_have_mat_props.insert(extra_model->m_must_have_mat_props.begin(),
+                                                           extra_model->m_must_have_mat_props.end());
+        m_merged_force_model->m_pairwise_mat_props.insert(extra_model->m_pairwise_mat_props.begin(),
+                                                          extra_model->m_pairwise_mat_props.end());
+        // If both set the precision of a wildcard, the main model's setting stays
+        m_merged_force_model->m_contact_wildcard_storage.insert(extra_model->m_contact_wildcard_storage.begin(),
+                                                                extra_model->m_contact_wildcard_storage.end());
+        m_merged_force_model->m_antisymmetric_contact_wildcards.insert(
+            extra_model->m_antisymmetric_contact_wildcards.begin(),
+            extra_model->m_antisymmetric_contact_wildcards.end());
+    }
+}
+
+void DEMSolver::decideContactWildcardStorage() {
+    for (const auto& name_storage : m_merged_force_model->m_contact_wildcard_storage) {
+        if (m_merged_force_model->m_contact_wildcards.find(name_storage.first) ==
+            m_merged_force_model->m_contact_wildcards.end()) {
+            DEME_ERROR("The precision of contact wildcard %s is set, but no contact wildcard in the force model is "
+                       "named so.",
+                       name_storage.first.c_str());
+        }
+    }
+    for (const auto& name : m_merged_force_model->m_antisymmetric_contact_wildcards) {
+        if (m_merged_force_model->m_contact_wildcards.find(name) == m_merged_force_model->m_contact_wildcards.end()) {
+            DEME_ERROR("Contact wildcard %s is marked antisymmetric, but no contact wildcard in the force model is "
+                       "named so.",
+                       name.c_str());
+        }
+    }
+    m_cnt_wc_storage.clear();
+    // 16-bit wildcards are paired up in the order they come, each pair sharing one array
+    unsigned int n_arrays = 0;
+    bool half_array_open = false;
+    for (const auto& name : m_merged_force_model->m_contact_wildcards) {
+        DEMContactWildcardStorage storage;
+        auto it = m_merged_force_model->m_contact_wildcard_storage.find(name);
+        if (it != m_merged_force_model->m_contact_wildcard_storage.end()) {
+            storage = it->second;
+        }
+        storage.antisymmetric = (m_merged_force_model->m_antisymmetric_contact_wildcards.count(name) > 0);
+        // The max storage error in the declared range: half the spacing between representable values near max_abs
+        float max_error = 0.f;
+        switch (storage.precision) {
+            case WILDCARD_PRECISION::FP16:
+                if (!(storage.max_abs > 0.f) || storage.max_abs > 65504.f) {
+                    DEME_ERROR("Contact wildcard %s is to be stored in FP16, which needs a declared max magnitude in "
+                               "(0, 65504], but it is %.6g.\nConsider BF16 or SCALED_INT16 for it.",
+                               name.c_str(), storage.max_abs);
+                }
+                // 11 significant bits, and a floor from the subnormals
+                max_error = std::max(storage.max_abs * std::ldexp(1.f, -11), std::ldexp(1.f, -25));
+                break;
+            case WILDCARD_PRECISION::BF16:
+                if (!(storage.max_abs > 0.f) && storage.max_error > 0.f) {
+                    DEME_ERROR("Contact wildcard %s is to be stored in BF16 with a max error of %.6g, which needs a "
+                               "declared max magnitude to check.",
+                               name.c_str(), storage.max_error);
+                }
+                // 8 significant bits
+                max_error = storage.max_abs * std::ldexp(1.f, -8);
+                break;
+            case WILDCARD_PRECISION::SCALED_INT16:
+                if (!(storage.max_abs > 0.f)) {
+                    DEME_ERROR("Contact wildcard %s is to be stored in SCALED_INT16, which needs a positive declared "
+                               "max magnitude, but it is %.6g.",
+                               name.c_str(), storage.max_abs);
+                }
+                max_error = storage.max_abs / 32767.f / 2.f;
+                break;
+            default:
+                break;
+        }
+        if (storage.max_error > 0.f && max_error > storage.max_error) {
+            DEME_ERROR("Contact wildcard %s, as stored in 16 bits, can be off by up to %.6g in its declared range of "
+                       "[-%.6g, %.6g], more than the acceptable %.6g.",
+                       name.c_str(), max_error, storage.max_abs, storage.max_abs, storage.max_error);
+        }
+
+        if (storage.precision == WILDCARD_PRECISION::FP32) {
+            storage.slot = n_arrays++;
+            storage.half = 0;
+        } else {
+            if (storage.max_abs > 0.f) {
+                DEME_INFO("Contact wildcard %s is stored in 16 bits, with a max error of %.6g in [-%.6g, %.6g].",
+                          name.c_str(), max_error, storage.max_abs, storage.max_abs);
+            } else {
+                DEME_INFO("Contact wildcard %s is stored in BF16, with a max relative error of %.6g.", name.c_str(),
+                          std::ldexp(1.f, -8));
+            }
+            if (half_array_open) {
+                storage.slot = n_arrays - 1;
+                storage.half = 1;
+            } else {
+                storage.slot = n_arrays++;
+                storage.half = 0;
+            }
+            half_array_open = !half_array_open;
+        }
+        m_cnt_wc_storage.push_back(storage);
+    }
+}
+
+unsigned int DEMSolver::getForceModelIndex(const std::shared_ptr<DEMForceModel>& model) {
+    if (model == m_force_model) {
+        return 0;
+    }
+    auto it = std::find(m_extra_force_models.begin(), m_extra_force_models.end(), model);
+    if (it == m_extra_force_models.end()) {
+        DEME_ERROR(
+            "A family or material pair is assigned a force model that is neither the main force model nor one added by "
+            "AddContactForceModel.");
+    }
+    return (unsigned int)(it - m_extra_force_models.begin()) + 1;
+}
+
+std::string DEMSolver::assembleForceModelSelection() {
+    // Pick the model of a contact. Material pairs go first, so that family pairs override them.
+    std::string selection = " ";
+    for (const auto& rule : m_mat_pair_force_models) {
+        const auto& mat1 = rule.first.first;
+        const auto& mat2 = rule.first.second;
+        for (const auto& mat : {mat1, mat2}) {
+            if (std::find(m_loaded_materials.begin(), m_loaded_materials.end(), mat) == m_loaded_materials.end()) {
+                DEME_ERROR("SetMaterialPairContactForceModel is given a material that is not loaded via LoadMaterial.");
+            }
+        }
+        const std::string m1 = std::to_string(mat1->load_order), m2 = std::to_string(mat2->load_order);
+        selection += "if ((bodyAMatType == " + m1 + " && bodyBMatType == " + m2 + ") || (bodyAMatType == " + m2 +
+                     " && bodyBMatType == " + m1 + ")) { forceModelID = " +
+                     std::to_string(getForceModelIndex(rule.second)) + "; }\n";
+    }
+    for (const auto& rule : m_family_pair_force_models) {
+        const std::string f1 = std::to_string(rule.first.ID1), f2 = std::to_string(rule.first.ID2);
+        selection += "if ((AOwnerFamily == " + f1 + " && BOwnerFamily == " + f2 + ") || (AOwnerFamily == " + f2 +
+                     " && BOwnerFamily == " + f1 + ")) { forceModelID = " +
+                     std::to_string(getForceModelIndex(rule.second)) + "; }\n";
+    }
+    return selection;
+}
+
+std::string DEMSolver::assembleForceModels() {
+    if (m_extra_force_models.size() == 0) {
+        return m_force_model->m_force_model;
+    }
+    // A force kernel instance made for one model has its number as FORCE_MODEL_ID, and the switch below is folded to
+    // that model's branch at compile time. The instances for all models pick the model of each contact at run time.
+    std::string model =
+        "const unsigned int forceModelID = (FORCE_MODEL_ID < 0) ? forceModelOfContact(AOwnerFamily, BOwnerFamily, "
+        "bodyAMatType, bodyBMatType) : FORCE_MODEL_ID;\n";
+    model += "switch (forceModelID) {\n";
+    for (unsigned int i = 0; i < m_extra_force_models.size(); i++) {
+        model += "case " + std::to_string(i + 1) + ": {\n" + m_extra_force_models[i]->m_force_model + "\n} break;\n";
+    }
+    model += "default: {\n" + m_force_model->m_force_model + "\n}\n}\n";
+    return model;
+}
+
+std::string DEMSolver::assembleForceModelKernels() {
+    if (m_extra_force_models.size() == 0) {
+        return " ";
+    }
+    // One kernel per model. Each goes through contacts grouped by model, given as the list of their indices.
+    std::string kernels = " ";
+    for (unsigned int i = 0; i <= m_extra_force_models.size(); i++) {
+        const std::string id = std::to_string(i);
+        kernels += "__global__ void calculateContactForcesOfModel" + id +
+                   "(deme::DEMSimParams* simParams, deme::DEMDataDT* granData, const deme::contactPairs_t* "
+                   "contactIDs, size_t startID, size_t endID) {\n"
+                   "size_t myEntry = startID + blockIdx.x * blockDim.x + threadIdx.x;\n"
+                   "if (myEntry < endID) {\n"
+                   "calculateContactForce<true, true, true, " +
+                   id +
+                   ">(simParams, granData, contactIDs[myEntry]);\n"
+                   "}\n"
+                   "}\n";
+    }
+    return kernels;
+}
+
 inline void DEMSolver::equipForceModel(std::unordered_map<std::string, std::string>& strMap) {
     // Empty ingr list
     auto added_ingredients = force_kernel_ingredient_stats;
     //// TODO: Reassemble geo and owner wildcards here again in a set is not needed... Since set is ordered.
     std::set<std::string> added_owner_wildcards, added_geo_wildcards;
-    // Analyze this model... what does it require?
-    std::string model = m_force_model->m_force_model;
-    const std::set<std::string> contact_wildcard_names = m_force_model->m_contact_wildcards;
-    const std::set<std::string> owner_wildcard_names = m_force_model->m_owner_wildcards;
-    const std::set<std::string> geo_wildcard_names = m_force_model->m_geo_wildcards;
+    // Analyze this model (all the models, if there are several)... what does it require?
+    std::string model = assembleForceModels();
+    const std::set<std::string> contact_wildcard_names = m_merged_force_model->m_contact_wildcards;
+    const std::set<std::string> owner_wildcard_names = m_merged_force_model->m_owner_wildcards;
+    const std::set<std::string> geo_wildcard_names = m_merged_force_model->m_geo_wildcards;
     std::set<std::string> geo_wildcard_names_error_checking;
     // geo_wildcard_names needs some treatments: Add _A and _B to them for error checking...
     if (geo_wildcard_names.size() > 0) {
@@ -1400,12 +1801,13 @@ inline void DEMSolver::equipForceModel(std::unordered_map<std::string, std::stri
     // For contact wildcards, it needs to be brought from the global memory, and we expect the user's force model to use
     // and modify them, and in the end we will write them back to global mem.
     equip_contact_wildcards(cnt_wildcard_acquisition, cnt_wildcard_write_back, cnt_wildcard_destroy_record,
-                            contact_wildcard_names);
+                            contact_wildcard_names, m_cnt_wc_storage);
 
     // If the user wants to reduce force in the calculation kernel...
     std::string whether_reduce_in_kernel = " ";
     if (collect_force_in_force_kernel) {
-        whether_reduce_in_kernel = FORCE_REDUCTION_RIGHT_AFTER_CALC_STRAT();
+        whether_reduce_in_kernel = use_warp_agg_force_reduction ? FORCE_REDUCTION_RIGHT_AFTER_CALC_WARP_AGG_STRAT()
+                                                                : FORCE_REDUCTION_RIGHT_AFTER_CALC_STRAT();
     }
 
     // If the user doesn't want to keep tab of contact forces...
@@ -1414,8 +1816,10 @@ inline void DEMSolver::equipForceModel(std::unordered_map<std::string, std::stri
         contact_info_write_strat = FORCE_INFO_WRITE_BACK_STRAT();
     }
 
+    std::string force_model_selection = assembleForceModelSelection();
     if (ensure_kernel_line_num) {
         model = compact_code(model);
+        force_model_selection = compact_code(force_model_selection);
         ingredient_definition = compact_code(ingredient_definition);
         ingredient_acquisition_A = compact_code(ingredient_acquisition_A);
         ingredient_acquisition_B = compact_code(ingredient_acquisition_B);
@@ -1423,6 +1827,8 @@ inline void DEMSolver::equipForceModel(std::unordered_map<std::string, std::stri
         contact_info_write_strat = compact_code(contact_info_write_strat);
     }
     strMap["_DEMForceModel_"] = model;
+    strMap["_forceModelSelection_"] = force_model_selection;
+    strMap["_forceModelKernels_"] = assembleForceModelKernels();
     strMap["_forceModelIngredientDefinition_"] = ingredient_definition;
     strMap["_forceModelIngredientAcqForA_"] = ingredient_acquisition_A;
     strMap["_forceModelIngredientAcqForB_"] = ingredient_acquisition_B;
@@ -1459,7 +1865,12 @@ inline void DEMSolver::equipFamilyOnFlyChanges(std::unordered_map<std::string, s
         unsigned int implID2 = m_family_change_pairs.at(i).ID2;
 
         // The conditions will be handled by a series of if statements
-        std::string cond = "if (family_code == " + std::to_string(implID1) + ") { bool shouldMakeChange = false;";
+        std::string cond = "if (family_code == " + std::to_string(implID1);
+        const unsigned int n_steps = m_family_change_intervals.at(i);
+        if (n_steps > 1) {
+            cond += " && simParams->nStepsElapsed % " + std::to_string(n_steps) + " == 0";
+        }
+        cond += ") { bool shouldMakeChange = false;";
         std::string user_str = replace_pattern(m_family_change_conditions.at(i), "return", "shouldMakeChange = ");
         if (ensure_kernel_line_num) {
             user_str = compact_code(user_str);
@@ -1472,6 +1883,8 @@ inline void DEMSolver::equipFamilyOnFlyChanges(std::unordered_map<std::string, s
 
     strMap["_nRulesOfChange_"] = std::to_string(n_rules);
     strMap["_familyChangeRules_"] = condStr;
+    strMap["_familyChangeInIntegration_"] =
+        (famnum_can_change_conditionally && family_change_in_integration) ? "true" : "false";
 }
 
 inline void DEMSolver::equipFamilyPrescribedMotions(std::unordered_map<std::string, std::string>& strMap) {
@@ -1581,6 +1994,18 @@ inline void DEMSolver::equipFamilyPrescribedMotions(std::unordered_map<std::stri
     strMap["_velPrescriptionStrategy_"] = velStr;
     strMap["_posPrescriptionStrategy_"] = posStr;
     strMap["_accPrescriptionStrategy_"] = accStr;
+
+    // Families that are just fixed, whose owners can skip integration and have their bin touches cached
+    std::string fixedStr = " ";
+    for (const auto& preInfo : m_unique_family_prescription) {
+        if (preInfo.IsFixed()) {
+            fixedStr += "case " + std::to_string(preInfo.family) + ": ";
+        }
+    }
+    if (fixedStr != " ") {
+        fixedStr += "return true";
+    }
+    strMap["_fixedFamilyCases_"] = fixedStr;
 }
 
 // Family mask is no longer jitified... but stored in global array
@@ -1752,11 +2177,11 @@ inline void DEMSolver::equipMassMoiVolume(std::unordered_map<std::string, std::s
 
 inline void DEMSolver::equipMaterials(std::unordered_map<std::string, std::string>& strMap) {
     // Force model gives us info on what mat props should be pairwise
-    const std::set<std::string> mat_prop_that_are_pairwise = m_force_model->m_pairwise_mat_props;
+    const std::set<std::string> mat_prop_that_are_pairwise = m_merged_force_model->m_pairwise_mat_props;
     m_pairwise_material_prop_names.insert(mat_prop_that_are_pairwise.begin(), mat_prop_that_are_pairwise.end());
 
     // Depending on the force model, there could be a few material properties that should be specified by the user
-    const std::set<std::string> mat_prop_that_must_exist = m_force_model->m_must_have_mat_props;
+    const std::set<std::string> mat_prop_that_must_exist = m_merged_force_model->m_must_have_mat_props;
     // Those must-haves will be added to the pool (which is a set of material prop names that we know)
     m_material_prop_names.insert(mat_prop_that_must_exist.begin(), mat_prop_that_must_exist.end());
     m_material_prop_names.insert(m_pairwise_material_prop_names.begin(), m_pairwise_material_prop_names.end());
@@ -1995,6 +2420,19 @@ inline void DEMSolver::equipSimParams(std::unordered_map<std::string, std::strin
     strMap["_LBFY_"] = to_string_with_precision(m_boxLBF.y);
     strMap["_LBFZ_"] = to_string_with_precision(m_boxLBF.z);
 
+    // The type of the sphere positions staged for the bin-wise sphere--sphere contact detection
+    strMap["_cdPositionType_"] = use_bin_local_cd_coords ? "float" : "double";
+    // Whether the kernels are specialized for a 2D (XZ-plane) simulation
+    strMap["_twoDimensional_"] = use_2d_mode ? "true" : "false";
+    // Periodic directions, and their periods (the user box sizes)
+    const float3 period = m_user_box_max - m_user_box_min;
+    strMap["_periodicX_"] = m_periodic_x ? "true" : "false";
+    strMap["_periodicY_"] = m_periodic_y ? "true" : "false";
+    strMap["_periodicZ_"] = m_periodic_z ? "true" : "false";
+    strMap["_periodLenX_"] = to_string_with_precision(period.x);
+    strMap["_periodLenY_"] = to_string_with_precision(period.y);
+    strMap["_periodLenZ_"] = to_string_with_precision(period.z);
+
     // Some constants that we should consider using or not using
     // strMap["_nAnalGM_"] = std::to_string(nAnalGM);
     strMap["_nActiveLoadingThreads_"] = std::to_string(NUM_ACTIVE_TEMPLATE_LOADING_THREADS);
@@ -8,6 +8,7 @@
 #include <DEM/Defines.h>
 #include <DEM/HostSideHelpers.hpp>
 #include <DEM/AuxClasses.h>
+#include <DEM/utils/ColumnFileReader.hpp>
 
 #include <iostream>
 #include <fstream>
@@ -33,9 +34,20 @@ DEMSolver::DEMSolver(unsigned int nGPUs) {
     // Make friends
     dT->kT = kT;
     kT->dT = dT;
+    dT->m_mem_registry.SetPeer(&kT->m_mem_registry);
+    kT->m_mem_registry.SetPeer(&dT->m_mem_registry);
 }
 
 DEMSolver::~DEMSolver() {
+    // Pending output files are finished before the writer is destroyed. A failed write can't be thrown from here.
+    if (m_output_writer) {
+        try {
+            m_output_writer->WaitAll();
+        } catch (const std::exception& e) {
+            DEME_WARNING("An output file failed to be written in the background:\n%s", e.what());
+        }
+        m_output_writer.reset();
+    }
     if (sys_initialized)
         DoDynamicsThenSync(0.0);
     delete kT;
@@ -86,6 +98,9 @@ void DEMSolver::SetOutputFormat(const std::string& format) {
         case ("BINARY"_):
             m_out_format = OUTPUT_FORMAT::BINARY;
             break;
+        case ("VTP"_):
+            m_out_format = OUTPUT_FORMAT::VTP;
+            break;
         case ("CHPF"_):
 #ifdef DEME_USE_CHPF
             m_out_format = OUTPUT_FORMAT::CHPF;
@@ -126,6 +141,9 @@ void DEMSolver::SetMeshOutputFormat(const std::string& format) {
         case ("OBJ"_):
             m_mesh_out_format = MESH_FORMAT::OBJ;
             break;
+        case ("VTU"_):
+            m_mesh_out_format = MESH_FORMAT::VTU;
+            break;
         default:
             DEME_ERROR("Instruction %s is unknown in SetMeshOutputFormat call.", format.c_str());
     }
@@ -384,6 +402,64 @@ float3 DEMSolver::GetOwnerAcc(bodyID_t ownerID) const {
 float3 DEMSolver::GetOwnerAngAcc(bodyID_t ownerID) const {
     return dT->getOwnerAngAcc(ownerID);
 }
+std::vector<float> DEMSolver::GetOwnerStates(OWNER_QUANTITY quantity, const std::vector<bodyID_t>& ownerIDs) {
+    assertSysInit("GetOwnerStates");
+    const size_t nComp = (quantity == OWNER_QUANTITY::ORI_Q) ? 4 : 3;
+    const float* res = dT->gatherOwnerStates(quantity, ownerIDs, true);
+    return std::vector<float>(res, res + nComp * ownerIDs.size());
+}
+std::vector<float> DEMSolver::GetOwnerStates(OWNER_QUANTITY quantity,
+                                             bodyID_t start,
+                                             size_t n,
+                                             const std::set<unsigned int>& families,
+                                             std::vector<bodyID_t>* selected) {
+    assertSysInit("GetOwnerStates");
+    const size_t nComp = (quantity == OWNER_QUANTITY::ORI_Q) ? 4 : 3;
+    std::vector<bodyID_t> ids;
+    const float* res = dT->gatherOwnerStatesInRange(quantity, start, n, families, &ids, true);
+    std::vector<float> vals(res, res + nComp * ids.size());
+    if (selected) {
+        *selected = std::move(ids);
+    }
+    return vals;
+}
+const float* DEMSolver::GetOwnerStatesDevice(OWNER_QUANTITY quantity, const std::vector<bodyID_t>& ownerIDs) {
+    assertSysInit("GetOwnerStatesDevice");
+    return dT->gatherOwnerStates(quantity, ownerIDs, false);
+}
+const float* DEMSolver::GetOwnerStatesDevice(OWNER_QUANTITY quantity,
+                                             bodyID_t start,
+                                             size_t n,
+                                             const std::set<unsigned int>& families,
+                                             std::vector<bodyID_t>* selected) {
+    assertSysInit("GetOwnerStatesDevice");
+    return dT->gatherOwnerStatesInRange(quantity, start, n, families, selected, false);
+}
+
+DEMDeviceArrayView DEMSolver::GetDeviceArrayView(DEVICE_ARRAY array, SPATIAL_DIR dir) {
+    assertSysInit("GetDeviceArrayView");
+    return dT->getDeviceArrayView(array, dir);
+}
+DEMDeviceArrayView DEMSolver::GetOwnerWildcardDeviceView(const std::string& name) {
+    assertSysInit("GetOwnerWildcardDeviceView");
+    if (m_owner_wc_num.find(name) == m_owner_wc_num.end()) {
+        DEME_ERROR(
+            "No owner wildcard in the force model is named %s.\nIf you need to use it, declare it via "
+            "SetPerOwnerWildcards first.",
+            name.c_str());
+    }
+    return dT->getOwnerWildcardDeviceView(m_owner_wc_num.at(name));
+}
+DEMDeviceArrayView DEMSolver::GetOwnerStatesDeviceView(OWNER_QUANTITY quantity, bodyID_t start, size_t n) {
+    assertSysInit("GetOwnerStatesDeviceView");
+    return dT->getOwnerStatesDeviceView(quantity, start, n);
+}
+
+std::shared_ptr<DEMAsyncResult> DEMSolver::GetOwnerStatesAsync(OWNER_QUANTITY quantity, bodyID_t start, size_t n) {
+    assertSysInit("GetOwnerStatesAsync");
+    return dT->gatherOwnerStatesAsync(quantity, start, n);
+}
+
 unsigned int DEMSolver::GetOwnerFamily(bodyID_t ownerID) const {
     return (unsigned int)(+(dT->familyID.at(ownerID)));
 }
@@ -443,6 +519,12 @@ float3 DEMSolver::GetOwnerMOI(bodyID_t ownerID) const {
 
 void DEMSolver::SetTriNodeRelPos(size_t owner, size_t triID, const std::vector<float3>& new_nodes) {
     auto& mesh = m_meshes.at(m_owner_mesh_map.at(owner));
+    if (mesh->shares_facets) {
+        DEME_ERROR(
+            "Mesh (owner %zu) shares its facets with its instances (or the mesh it instances), so it cannot be "
+            "deformed.\nLoad it via AddWavefrontMeshObject, not AddMeshInstance, if it is to deform.",
+            owner);
+    }
     if (mesh->GetNumNodes() != new_nodes.size()) {
         DEME_ERROR(
             "To deform a mesh, provided vector must have the same length as the number of nodes in mesh.\nThe mesh has "
@@ -457,14 +539,20 @@ void DEMSolver::SetTriNodeRelPos(size_t owner, size_t triID, const std::vector<f
     for (size_t i = 0; i < mesh->GetNumTriangles(); i++) {
         new_triangles[i] = mesh->GetTriangle(i);
     }
+    // dT records the modified nodes, and sends only them to kT
     dT->setTriNodeRelPos(triID, new_triangles);
-    dT->solverFlags.willMeshDeform = true;
 
     // kT just received update from dT, to avoid mem hazards
     // kT->setTriNodeRelPos(triID, new_triangles);
 }
 void DEMSolver::UpdateTriNodeRelPos(size_t owner, size_t triID, const std::vector<float3>& updates) {
     auto& mesh = m_meshes.at(m_owner_mesh_map.at(owner));
+    if (mesh->shares_facets) {
+        DEME_ERROR(
+            "Mesh (owner %zu) shares its facets with its instances (or the mesh it instances), so it cannot be "
+            "deformed.\nLoad it via AddWavefrontMeshObject, not AddMeshInstance, if it is to deform.",
+            owner);
+    }
     if (mesh->GetNumNodes() != updates.size()) {
         DEME_ERROR(
             "To deform a mesh, provided vector must have the same length as the number of nodes in mesh.\nThe mesh has "
@@ -480,12 +568,50 @@ void DEMSolver::UpdateTriNodeRelPos(size_t owner, size_t triID, const std::vecto
     for (size_t i = 0; i < mesh->GetNumTriangles(); i++) {
         new_triangles[i] = mesh->GetTriangle(i);
     }
+    // dT records the modified nodes, and sends only them to kT
     dT->setTriNodeRelPos(triID, new_triangles);
-    dT->solverFlags.willMeshDeform = true;
 
     // kT just received update from dT, to avoid mem hazards
     // kT->setTriNodeRelPos(triID, new_triangles);
 }
+void DEMSolver::SetTriNodeRelPos(size_t owner,
+                                 size_t triID,
+                                 const float3* device_nodes,
+                                 bool per_vertex,
+                                 cudaStream_t stream) {
+    if (!sys_initialized) {
+        DEME_ERROR("SetTriNodeRelPos with a device buffer can only be called after initialization.");
+    }
+    auto& mesh = m_meshes.at(m_owner_mesh_map.at(owner));
+    if (mesh->shares_facets) {
+        DEME_ERROR(
+            "Mesh (owner %zu) shares its facets with its instances (or the mesh it instances), so it cannot be "
+            "deformed.\nLoad it via AddWavefrontMeshObject, not AddMeshInstance, if it is to deform.",
+            owner);
+    }
+    // The cached mesh is not modified, since the data is on device; dT records the modified nodes, and sends only them
+    // to kT
+    dT->applyTriNodeRelPosFromDevice(mesh->cache_offset, triID, mesh->GetNumTriangles(), device_nodes, per_vertex,
+                                     false, stream);
+}
+void DEMSolver::UpdateTriNodeRelPos(size_t owner,
+                                    size_t triID,
+                                    const float3* device_updates,
+                                    bool per_vertex,
+                                    cudaStream_t stream) {
+    if (!sys_initialized) {
+        DEME_ERROR("UpdateTriNodeRelPos with a device buffer can only be called after initialization.");
+    }
+    auto& mesh = m_meshes.at(m_owner_mesh_map.at(owner));
+    if (mesh->shares_facets) {
+        DEME_ERROR(
+            "Mesh (owner %zu) shares its facets with its instances (or the mesh it instances), so it cannot be "
+            "deformed.\nLoad it via AddWavefrontMeshObject, not AddMeshInstance, if it is to deform.",
+            owner);
+    }
+    dT->applyTriNodeRelPosFromDevice(mesh->cache_offset, triID, mesh->GetNumTriangles(), device_updates, per_vertex,
+                                     true, stream);
+}
 std::shared_ptr<DEMMeshConnected>& DEMSolver::GetCachedMesh(bodyID_t ownerID) {
     if (m_owner_mesh_map.find(ownerID) == m_owner_mesh_map.end()) {
         DEME_ERROR("Owner %zu is not a mesh, you therefore cannot retrive a handle to mesh using it.", (size_t)ownerID);
@@ -535,8 +661,6 @@ void DEMSolver::SetIntegrator(const std::string& intg) {
 }
 
 void DEMSolver::SetAdaptiveTimeStepType(const std::string& type) {
-    DEME_WARNING(
-        "SetAdaptiveTimeStepType is currently not implemented and has no effect, time step size is still fixed.");
     switch (hash_charr(type.c_str())) {
         case ("none"_):
             adapt_ts_type = ADAPT_TS_TYPE::NONE;
@@ -639,6 +763,29 @@ void DEMSolver::InstructBoxDomainDimension(const std::pair<float, float>& x,
     }
 }
 
+void DEMSolver::InstructBoxDomainPeriodicBC(const std::string& dirs) {
+    const std::string dirs_upper = str_to_upper(dirs);
+    m_periodic_x = m_periodic_y = m_periodic_z = false;
+    if (dirs_upper == "NONE") {
+        return;
+    }
+    for (const char dir : dirs_upper) {
+        switch (dir) {
+            case 'X':
+                m_periodic_x = true;
+                break;
+            case 'Y':
+                m_periodic_y = true;
+                break;
+            case 'Z':
+                m_periodic_z = true;
+                break;
+            default:
+                DEME_ERROR("Unknown '%s' parameter in InstructBoxDomainPeriodicBC call.", dirs.c_str());
+        }
+    }
+}
+
 std::shared_ptr<DEMForceModel> DEMSolver::DefineContactForceModel(const std::string& model) {
     DEMForceModel force_model;  // Custom
     force_model.DefineCustomModel(model);
@@ -658,6 +805,50 @@ std::shared_ptr<DEMForceModel> DEMSolver::ReadContactForceModel(const std::strin
     return m_force_model;
 }
 
+std::shared_ptr<DEMForceModel> DEMSolver::AddContactForceModel(const std::string& model) {
+    DEMForceModel force_model;  // Custom
+    force_model.DefineCustomModel(model);
+    m_extra_force_models.push_back(std::make_shared<DEMForceModel>(std::move(force_model)));
+    return m_extra_force_models.back();
+}
+
+std::shared_ptr<DEMForceModel> DEMSolver::AddContactForceModelFromFile(const std::string& filename) {
+    DEMForceModel force_model;  // Custom
+    std::filesystem::path sourcefile = USER_SCRIPT_PATH / filename;
+    if (force_model.ReadCustomModelFile(std::filesystem::path(filename))) {
+        if (force_model.ReadCustomModelFile(sourcefile))
+            DEME_ERROR("The force model file %s is not found.", filename.c_str());
+    }
+    m_extra_force_models.push_back(std::make_shared<DEMForceModel>(std::move(force_model)));
+    return m_extra_force_models.back();
+}
+
+void DEMSolver::SetFamilyPairContactForceModel(unsigned int ID1,
+                                               unsigned int ID2,
+                                               const std::shared_ptr<DEMForceModel>& model) {
+    if (sys_initialized) {
+        DEME_ERROR("SetFamilyPairContactForceModel must be called before initialization.");
+    }
+    if (ID1 > std::numeric_limits<family_t>::max() || ID2 > std::numeric_limits<family_t>::max()) {
+        DEME_ERROR("SetFamilyPairContactForceModel is given family %u and %u, but family number should not be larger "
+                   "than %u.",
+                   ID1, ID2, std::numeric_limits<family_t>::max());
+    }
+    familyPair_t a_pair;
+    a_pair.ID1 = ID1;
+    a_pair.ID2 = ID2;
+    m_family_pair_force_models.push_back(std::make_pair(a_pair, model));
+}
+
+void DEMSolver::SetMaterialPairContactForceModel(const std::shared_ptr<DEMMaterial>& mat1,
+                                                 const std::shared_ptr<DEMMaterial>& mat2,
+                                                 const std::shared_ptr<DEMForceModel>& model) {
+    if (sys_initialized) {
+        DEME_ERROR("SetMaterialPairContactForceModel must be called before initialization.");
+    }
+    m_mat_pair_force_models.push_back(std::make_pair(std::make_pair(mat1, mat2), model));
+}
+
 std::shared_ptr<DEMForceModel> DEMSolver::UseFrictionalHertzianModel() {
     m_force_model->SetForceModelType(FORCE_MODEL::HERTZIAN);
     return m_force_model;
@@ -668,13 +859,21 @@ std::shared_ptr<DEMForceModel> DEMSolver::UseFrictionlessHertzianModel() {
     return m_force_model;
 }
 
-void DEMSolver::ChangeFamilyWhen(unsigned int ID_from, unsigned int ID_to, const std::string& condition) {
+void DEMSolver::ChangeFamilyWhen(unsigned int ID_from,
+                                 unsigned int ID_to,
+                                 const std::string& condition,
+                                 unsigned int every_n_steps) {
     assertSysNotInit("ChangeFamilyWhen");
     if (ID_from > std::numeric_limits<family_t>::max() || ID_to > std::numeric_limits<family_t>::max()) {
         DEME_ERROR(
             "You instructed family number %u should change to %u, but family number should not be larger than %u.",
             ID_from, ID_to, std::numeric_limits<family_t>::max());
     }
+    if (every_n_steps == 0) {
+        DEME_ERROR("The condition for family %u to change to %u is to be checked every 0 steps, but it should be at "
+                   "least 1.",
+                   ID_from, ID_to);
+    }
 
     // If one such user call is made, then the solver needs to prepare for per-step family number-changing sweeps
     famnum_can_change_conditionally = true;
@@ -684,6 +883,7 @@ void DEMSolver::ChangeFamilyWhen(unsigned int ID_from, unsigned int ID_to, const
 
     m_family_change_pairs.push_back(a_pair);
     m_family_change_conditions.push_back(condition);
+    m_family_change_intervals.push_back(every_n_steps);
 }
 
 void DEMSolver::ChangeFamily(unsigned int ID_from, unsigned int ID_to) {
@@ -1416,6 +1616,36 @@ size_t DEMSolver::GetOwnerContactForces(bodyID_t ownerID,
     return dT->getOwnerContactForces(ownerID, points, forces, torques, torque_in_local);
 }
 
+size_t DEMSolver::GetOwnersContactForces(const std::vector<bodyID_t>& ownerIDs,
+                                        std::vector<size_t>& offsets,
+                                        std::vector<float3>& points,
+                                        std::vector<float3>& forces,
+                                        std::vector<float3>& torques,
+                                        bool torque_in_local) {
+    assertSysInit("GetOwnersContactForces");
+    if (GetWhetherForceCollectInKernel()) {
+        DEME_ERROR(
+            "The solver is currently set to not record force pair info, so you cannot query force pairs using "
+            "GetOwnersContactForces.\nYou can call SetCollectAccRightAfterForceCalc(false) before system "
+            "initialization and try again.");
+    }
+    return dT->getOwnersContactForces(ownerIDs, offsets, points, forces, torques, torque_in_local);
+}
+size_t DEMSolver::GetFamilyContactForces(unsigned int N,
+                                        std::vector<bodyID_t>& ownerIDs,
+                                        std::vector<size_t>& offsets,
+                                        std::vector<float3>& points,
+                                        std::vector<float3>& forces,
+                                        std::vector<float3>& torques,
+                                        bool torque_in_local) {
+    assertSysInit("GetFamilyContactForces");
+    if (N >= NUM_AVAL_FAMILIES) {
+        DEME_ERROR("Family %u is queried, but family numbers go up to %zu.", N, NUM_AVAL_FAMILIES - 1);
+    }
+    ownerIDs = dT->getFamilyOwnerIDs(N);
+    return GetOwnersContactForces(ownerIDs, offsets, points, forces, torques, torque_in_local);
+}
+
 std::vector<float> DEMSolver::GetFamilyOwnerWildcardValue(unsigned int N, const std::string& name) {
     assertSysInit("GetFamilyOwnerWildcardValue");
     if (m_owner_wc_num.find(name) == m_owner_wc_num.end()) {
@@ -1433,6 +1663,13 @@ void DEMSolver::SetContactWildcards(const std::set<std::string>& wildcards) {
     m_force_model->SetPerContactWildcards(wildcards);
 }
 
+void DEMSolver::SetContactWildcardPrecision(const std::string& name,
+                                            WILDCARD_PRECISION precision,
+                                            float max_abs,
+                                            float max_error) {
+    m_force_model->SetContactWildcardPrecision(name, precision, max_abs, max_error);
+}
+
 void DEMSolver::SetOwnerWildcards(const std::set<std::string>& wildcards) {
     m_force_model->SetPerOwnerWildcards(wildcards);
 }
@@ -1672,6 +1909,19 @@ void DEMSolver::SetFamilyExtraMargin(unsigned int N, float extra_size) {
     dT->familyExtraMarginSize.at(N) = extra_size;
 }
 
+void DEMSolver::SetFamilyStepRatio(unsigned int N, unsigned int ratio) {
+    if (N > std::numeric_limits<family_t>::max()) {
+        DEME_ERROR("You are setting the step ratio of family %u, but family number should not be larger than %u.", N,
+                   std::numeric_limits<family_t>::max());
+    }
+    if (ratio == 0) {
+        DEME_ERROR("The step ratio of family %u should be at least 1.", N);
+    }
+    dT->familyStepRatio.at(N) = ratio;
+    dT->simParams->useFamilyStepRatio =
+        std::any_of(dT->familyStepRatio.begin(), dT->familyStepRatio.end(), [](unsigned int r) { return r > 1; });
+}
+
 void DEMSolver::ClearCache() {
     deallocate_array(cached_input_clump_batches);
     deallocate_array(cached_extern_objs);
@@ -1691,6 +1941,7 @@ void DEMSolver::ClearCache() {
     // m_no_output_families;
     // m_family_change_pairs;
     // m_family_change_conditions;
+    // m_family_change_intervals;
 }
 
 std::shared_ptr<DEMClumpBatch> DEMSolver::AddClumps(DEMClumpBatch& input_batch) {
@@ -1723,6 +1974,79 @@ std::shared_ptr<DEMClumpBatch> DEMSolver::AddClumps(const std::vector<std::share
     return AddClumps(a_batch);
 }
 
+std::shared_ptr<DEMClumpBatch> DEMSolver::AddClumpsFromFile(const std::string& filename, unsigned int num_threads) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    DEMColumnFileReader reader(filename, {OUTPUT_FILE_CLUMP_TYPE_NAME}, num_threads);
+    const size_t nClumps = reader.NumRows();
+    if (!reader.HasColumn(OUTPUT_FILE_CLUMP_TYPE_NAME) || !reader.HasColumn(OUTPUT_FILE_X_COL_NAME) ||
+        !reader.HasColumn(OUTPUT_FILE_Y_COL_NAME) || !reader.HasColumn(OUTPUT_FILE_Z_COL_NAME)) {
+        DEME_ERROR("Clump file %s must at least have columns %s, %s, %s and %s.", filename.c_str(),
+                   OUTPUT_FILE_CLUMP_TYPE_NAME.c_str(), OUTPUT_FILE_X_COL_NAME.c_str(),
+                   OUTPUT_FILE_Y_COL_NAME.c_str(), OUTPUT_FILE_Z_COL_NAME.c_str());
+    }
+
+    // Clump type names are matched to templates once per name in the file, not once per clump
+    const auto& typeCol = reader.GetColumn(OUTPUT_FILE_CLUMP_TYPE_NAME);
+    std::vector<std::shared_ptr<DEMClumpTemplate>> typeTemplates;
+    for (const auto& name : typeCol.dictionary) {
+        auto it = std::find_if(m_templates.begin(), m_templates.end(),
+                               [&](const std::shared_ptr<DEMClumpTemplate>& tmp) { return tmp->m_name == name; });
+        if (it == m_templates.end()) {
+            DEME_ERROR("Clump type %s in file %s is not the name of any loaded clump template.", name.c_str(),
+                       filename.c_str());
+        }
+        typeTemplates.push_back(*it);
+    }
+
+    // The optional columns, as triplets (or a quadruplet), or nullptr if the file does not have them
+    auto getCols = [&](const std::vector<std::string>& names) {
+        std::vector<const DEMColumnFileReader::Column*> cols;
+        for (const auto& name : names) {
+            if (!reader.HasColumn(name))
+                return std::vector<const DEMColumnFileReader::Column*>();
+            cols.push_back(&reader.GetColumn(name));
+        }
+        return cols;
+    };
+    const auto xyzCols = getCols({OUTPUT_FILE_X_COL_NAME, OUTPUT_FILE_Y_COL_NAME, OUTPUT_FILE_Z_COL_NAME});
+    const auto qCols = getCols(
+        {OUTPUT_FILE_QW_COL_NAME, OUTPUT_FILE_QX_COL_NAME, OUTPUT_FILE_QY_COL_NAME, OUTPUT_FILE_QZ_COL_NAME});
+    const auto velCols =
+        getCols({OUTPUT_FILE_VEL_X_COL_NAME, OUTPUT_FILE_VEL_Y_COL_NAME, OUTPUT_FILE_VEL_Z_COL_NAME});
+    const auto angVelCols =
+        getCols({OUTPUT_FILE_ANGVEL_X_COL_NAME, OUTPUT_FILE_ANGVEL_Y_COL_NAME, OUTPUT_FILE_ANGVEL_Z_COL_NAME});
+    const auto familyCols = getCols({"family"});
+
+    DEMClumpBatch a_batch(nClumps);
+    DEMColumnFileReader::ParallelFor(nClumps, num_threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            a_batch.types[i] = typeTemplates.at(typeCol.GetStringID(i));
+            a_batch.xyz[i] =
+                host_make_float3(xyzCols[0]->GetFloat(i), xyzCols[1]->GetFloat(i), xyzCols[2]->GetFloat(i));
+            if (!qCols.empty()) {
+                a_batch.oriQ[i] = host_make_float4(qCols[1]->GetFloat(i), qCols[2]->GetFloat(i),
+                                                   qCols[3]->GetFloat(i), qCols[0]->GetFloat(i));
+            }
+            if (!velCols.empty()) {
+                a_batch.vel[i] =
+                    host_make_float3(velCols[0]->GetFloat(i), velCols[1]->GetFloat(i), velCols[2]->GetFloat(i));
+            }
+            if (!angVelCols.empty()) {
+                a_batch.angVel[i] = host_make_float3(angVelCols[0]->GetFloat(i), angVelCols[1]->GetFloat(i),
+                                                     angVelCols[2]->GetFloat(i));
+            }
+            if (!familyCols.empty()) {
+                a_batch.families[i] = (unsigned int)familyCols[0]->GetFloat(i);
+            }
+        }
+    });
+    a_batch.family_isSpecified = !familyCols.empty();
+    DEME_DEBUG_PRINTF("Loaded %zu clumps from file %s.", nClumps, filename.c_str());
+    return AddClumps(a_batch);
+}
+
 std::shared_ptr<DEMMeshConnected> DEMSolver::AddWavefrontMeshObject(DEMMeshConnected& mesh) {
     if (mesh.GetNumTriangles() == 0) {
         DEME_WARNING("It seems that a mesh contains 0 triangle facet at the time it is loaded.");
@@ -1737,6 +2061,19 @@ std::shared_ptr<DEMMeshConnected> DEMSolver::AddWavefrontMeshObject(DEMMeshConne
     return cached_mesh_objs.back();
 }
 
+std::shared_ptr<DEMMeshConnected> DEMSolver::AddMeshInstance(const std::shared_ptr<DEMMeshConnected>& mesh) {
+    if (std::find(cached_mesh_objs.begin(), cached_mesh_objs.end(), mesh) == cached_mesh_objs.end() &&
+        std::find(m_meshes.begin(), m_meshes.end(), mesh) == m_meshes.end()) {
+        DEME_ERROR("AddMeshInstance needs a mesh that is added to this solver via AddWavefrontMeshObject.");
+    }
+    DEMMeshConnected instance(*mesh);
+    instance.instance_of = mesh->instance_of ? mesh->instance_of : mesh;
+    instance.owner = NULL_BODYID;
+    instance.shares_facets = true;
+    instance.instance_of->shares_facets = true;
+    return AddWavefrontMeshObject(instance);
+}
+
 std::shared_ptr<DEMMeshConnected> DEMSolver::AddWavefrontMeshObject(const std::string& filename,
                                                                     const std::shared_ptr<DEMMaterial>& mat,
                                                                     bool load_normals,
@@ -1773,26 +2110,73 @@ std::shared_ptr<DEMInspector> DEMSolver::CreateInspector(const std::string& quan
     return m_inspectors.back();
 }
 
+std::shared_ptr<DEMInspectorGroup> DEMSolver::CreateInspectorGroup(
+    const std::vector<std::shared_ptr<DEMInspector>>& inspectors) {
+    DEMInspectorGroup group(this, this->dT, inspectors);
+    m_inspector_groups.push_back(std::make_shared<DEMInspectorGroup>(std::move(group)));
+    return m_inspector_groups.back();
+}
+
+void DEMSolver::SetAsyncOutput(bool use_async, unsigned int max_pending) {
+    if (m_output_writer) {
+        // Whatever was submitted before should go to disk, before the writer is replaced
+        m_output_writer->WaitAll();
+        m_output_writer.reset();
+    }
+    if (use_async) {
+        m_output_writer = std::make_shared<DEMAsyncOutputWriter>(max_pending, verbosity);
+    }
+}
+
+void DEMSolver::WaitForPendingOutputs() {
+    if (m_output_writer) {
+        m_output_writer->WaitAll();
+    }
+}
+
+void DEMSolver::submitOutputJob(std::function<void()>&& job) const {
+    if (m_output_writer) {
+        m_output_writer->Submit(std::move(job));
+    } else {
+        job();
+    }
+}
+
 void DEMSolver::WriteSphereFile(const std::string& outfilename) const {
+    // The output region inspector is jitified the first time it is used
+    if (m_owner_out_filter.region) {
+        m_owner_out_filter.region->assertInit();
+    }
     switch (m_out_format) {
 #ifdef DEME_USE_CHPF
         case (OUTPUT_FORMAT::CHPF): {
-            std::ofstream ptFile(outfilename, std::ios::out | std::ios::binary);
+            std::ofstream ptFile = openOutputFile(outfilename, std::ios::out | std::ios::binary);
             dT->writeSpheresAsChpf(ptFile);
             break;
         }
 #endif
         case (OUTPUT_FORMAT::CSV): {
-            std::ofstream ptFile(outfilename, std::ios::out);
-            dT->writeSpheresAsCsv(ptFile);
+            std::shared_ptr<DEMOutputSnapshot> snap = dT->takeOutputSnapshot(true, false, nullptr, &m_owner_out_filter);
+            submitOutputJob([snap, outfilename]() {
+                std::ofstream ptFile = openOutputFile(outfilename, std::ios::out);
+                snap->writeSpheresAsCsv(ptFile);
+            });
             break;
         }
         case (OUTPUT_FORMAT::BINARY): {
-            // std::ofstream ptFile(outfilename, std::ios::out | std::ios::binary);
-            //// TODO: Implement it
-            std::ofstream ptFile(outfilename, std::ios::out);
-            DEME_WARNING("Binary sphere output is not implemented yet, using CSV...");
-            dT->writeSpheresAsCsv(ptFile);
+            std::shared_ptr<DEMOutputSnapshot> snap = dT->takeOutputSnapshot(true, false, nullptr, &m_owner_out_filter);
+            submitOutputJob([snap, outfilename]() {
+                std::ofstream ptFile = openOutputFile(outfilename, std::ios::out | std::ios::binary);
+                snap->writeSpheresAsBinary(ptFile);
+            });
+            break;
+        }
+        case (OUTPUT_FORMAT::VTP): {
+            std::shared_ptr<DEMOutputSnapshot> snap = dT->takeOutputSnapshot(true, false, nullptr, &m_owner_out_filter);
+            submitOutputJob([snap, outfilename]() {
+                std::ofstream ptFile = openOutputFile(outfilename, std::ios::out | std::ios::binary);
+                snap->writeSpheresAsVtp(ptFile);
+            });
             break;
         }
         default:
@@ -1801,25 +2185,44 @@ void DEMSolver::WriteSphereFile(const std::string& outfilename) const {
 }
 
 void DEMSolver::WriteClumpFile(const std::string& outfilename, unsigned int accuracy) const {
+    // The output region inspector is jitified the first time it is used
+    if (m_owner_out_filter.region) {
+        m_owner_out_filter.region->assertInit();
+    }
     switch (m_out_format) {
 #ifdef DEME_USE_CHPF
         case (OUTPUT_FORMAT::CHPF): {
-            std::ofstream ptFile(outfilename, std::ios::out | std::ios::binary);
+            std::ofstream ptFile = openOutputFile(outfilename, std::ios::out | std::ios::binary);
             dT->writeClumpsAsChpf(ptFile, accuracy);
             break;
         }
 #endif
         case (OUTPUT_FORMAT::CSV): {
-            std::ofstream ptFile(outfilename, std::ios::out);
-            dT->writeClumpsAsCsv(ptFile, accuracy);
+            std::shared_ptr<DEMOutputSnapshot> snap =
+                dT->takeOutputSnapshot(false, false, nullptr, &m_owner_out_filter);
+            submitOutputJob([snap, outfilename, accuracy]() {
+                std::ofstream ptFile = openOutputFile(outfilename, std::ios::out);
+                snap->writeClumpsAsCsv(ptFile, accuracy);
+            });
             break;
         }
         case (OUTPUT_FORMAT::BINARY): {
-            // std::ofstream ptFile(outfilename, std::ios::out | std::ios::binary);
-            //// TODO: Implement it
-            std::ofstream ptFile(outfilename, std::ios::out);
-            DEME_WARNING("Binary clump output is not implemented yet, using CSV...");
-            dT->writeClumpsAsCsv(ptFile, accuracy);
+            // Binary output stores floats as they are, so accuracy is not relevant
+            std::shared_ptr<DEMOutputSnapshot> snap =
+                dT->takeOutputSnapshot(false, false, nullptr, &m_owner_out_filter);
+            submitOutputJob([snap, outfilename]() {
+                std::ofstream ptFile = openOutputFile(outfilename, std::ios::out | std::ios::binary);
+                snap->writeClumpsAsBinary(ptFile);
+            });
+            break;
+        }
+        case (OUTPUT_FORMAT::VTP): {
+            std::shared_ptr<DEMOutputSnapshot> snap =
+                dT->takeOutputSnapshot(false, false, nullptr, &m_owner_out_filter);
+            submitOutputJob([snap, outfilename]() {
+                std::ofstream ptFile = openOutputFile(outfilename, std::ios::out | std::ios::binary);
+                snap->writeClumpsAsVtp(ptFile);
+            });
             break;
         }
         default:
@@ -1834,18 +2237,24 @@ void DEMSolver::WriteContactFile(const std::string& outfilename, float force_thr
             "call.");
         return;
     }
+    // The contacts are filtered on the device, so only those to be written are copied
+    DEMContactOutputFilter filter = m_cnt_out_filter;
+    filter.force_thres = force_thres;
     switch (m_cnt_out_format) {
         case (OUTPUT_FORMAT::CSV): {
-            std::ofstream ptFile(outfilename, std::ios::out);
-            dT->writeContactsAsCsv(ptFile, force_thres);
+            std::shared_ptr<DEMOutputSnapshot> snap = dT->takeOutputSnapshot(false, true, &filter);
+            submitOutputJob([snap, outfilename, force_thres]() {
+                std::ofstream ptFile = openOutputFile(outfilename, std::ios::out);
+                snap->writeContactsAsCsv(ptFile, force_thres);
+            });
             break;
         }
         case (OUTPUT_FORMAT::BINARY): {
-            // std::ofstream ptFile(outfilename, std::ios::out | std::ios::binary);
-            //// TODO: Implement it
-            DEME_WARNING("Binary contact pair output is not implemented yet, using CSV...");
-            std::ofstream ptFile(outfilename, std::ios::out);
-            dT->writeContactsAsCsv(ptFile, force_thres);
+            std::shared_ptr<DEMOutputSnapshot> snap = dT->takeOutputSnapshot(false, true, &filter);
+            submitOutputJob([snap, outfilename, force_thres]() {
+                std::ofstream ptFile = openOutputFile(outfilename, std::ios::out | std::ios::binary);
+                snap->writeContactsAsBinary(ptFile, force_thres);
+            });
             break;
         }
         default:
@@ -1854,13 +2263,144 @@ void DEMSolver::WriteContactFile(const std::string& outfilename, float force_thr
     }
 }
 
+void DEMSolver::SetContactOutputFamilies(const std::vector<unsigned int>& families) {
+    for (const auto& family : families) {
+        if (family >= NUM_AVAL_FAMILIES) {
+            DEME_ERROR("Family %u cannot be used in a contact output filter, as it is not a valid family number.",
+                       family);
+        }
+    }
+    m_cnt_out_filter.families = families;
+}
+
+void DEMSolver::SetContactOutputRegion(const float3& min, const float3& max) {
+    if (min.x > max.x || min.y > max.y || min.z > max.z) {
+        DEME_ERROR(
+            "The contact output region's min corner (%.6g, %.6g, %.6g) is not below its max corner (%.6g, %.6g, %.6g).",
+            min.x, min.y, min.z, max.x, max.y, max.z);
+    }
+    m_cnt_out_filter.use_region = true;
+    m_cnt_out_filter.region_min = min;
+    m_cnt_out_filter.region_max = max;
+}
+
+void DEMSolver::ClearContactOutputFilters() {
+    m_cnt_out_filter = DEMContactOutputFilter();
+}
+
+void DEMSolver::SetOutputRegion(const std::string& region) {
+    SetOutputRegion(CreateOutputRegion(region));
+    m_owner_out_region_is_temp = true;
+}
+
+std::shared_ptr<DEMInspector> DEMSolver::CreateOutputRegion(const std::string& region) {
+    // The region test is done by an inspector that does not inspect anything. It is one of m_inspectors, so it is kept
+    // up to date if the solver re-jitifies.
+    auto insp = CreateInspector("absv", region);
+    insp->SetInspectionCode(" ");
+    return insp;
+}
+
+void DEMSolver::SetOutputRegion(const std::shared_ptr<DEMInspector>& region) {
+    if (m_owner_out_filter.region && m_owner_out_region_is_temp && m_owner_out_filter.region != region) {
+        m_inspectors.erase(std::remove(m_inspectors.begin(), m_inspectors.end(), m_owner_out_filter.region),
+                           m_inspectors.end());
+    }
+    m_owner_out_filter.region = region;
+    m_owner_out_region_is_temp = false;
+}
+
+void DEMSolver::SetOutputRegion(const float3& min, const float3& max) {
+    if (min.x > max.x || min.y > max.y || min.z > max.z) {
+        DEME_ERROR("The output region's min corner (%.6g, %.6g, %.6g) is not below its max corner (%.6g, %.6g, %.6g).",
+                   min.x, min.y, min.z, max.x, max.y, max.z);
+    }
+    char region[512];
+    snprintf(region, sizeof(region),
+             "return (X >= %.9g && X <= %.9g && Y >= %.9g && Y <= %.9g && Z >= %.9g && Z <= %.9g);", min.x, max.x,
+             min.y, max.y, min.z, max.z);
+    SetOutputRegion(std::string(region));
+}
+
+void DEMSolver::SetOutputStride(unsigned int stride) {
+    if (stride == 0) {
+        DEME_ERROR("The output stride must be at least 1.");
+    }
+    m_owner_out_filter.stride = stride;
+}
+
+void DEMSolver::ClearOutputFilters() {
+    if (m_owner_out_filter.region && m_owner_out_region_is_temp) {
+        m_inspectors.erase(std::remove(m_inspectors.begin(), m_inspectors.end(), m_owner_out_filter.region),
+                           m_inspectors.end());
+    }
+    m_owner_out_filter = DEMOwnerOutputFilter();
+    m_owner_out_region_is_temp = false;
+}
+
+void DEMSolver::OpenTimeSeriesOutput(const std::string& filename, unsigned int keyframe_interval) {
+    assertSysInit("OpenTimeSeriesOutput");
+    CloseTimeSeriesOutput();
+    DEMTimeSeriesDomain domain;
+    domain.LBFX = dT->simParams->LBFX;
+    domain.LBFY = dT->simParams->LBFY;
+    domain.LBFZ = dT->simParams->LBFZ;
+    domain.l = dT->simParams->l;
+    m_time_series_writer = std::make_shared<DEMTimeSeriesFileWriter>(filename, domain, keyframe_interval);
+}
+
+void DEMSolver::WriteTimeSeriesFrame() {
+    if (!m_time_series_writer) {
+        DEME_ERROR("WriteTimeSeriesFrame is called, but no time-series output file is open. Call OpenTimeSeriesOutput "
+                   "first.");
+    }
+    std::shared_ptr<DEMOutputSnapshot> snap = dT->takeOutputSnapshot(false, false);
+    // Frames are delta-encoded, so they must be appended in order; the background writer runs jobs in order
+    std::shared_ptr<DEMTimeSeriesFileWriter> writer = m_time_series_writer;
+    submitOutputJob([snap, writer]() {
+        DEMTimeSeriesFrame frame;
+        snap->fillTimeSeriesFrame(frame);
+        writer->Append(frame);
+    });
+}
+
+void DEMSolver::CloseTimeSeriesOutput() {
+    if (m_time_series_writer) {
+        WaitForPendingOutputs();
+        m_time_series_writer->Close();
+        m_time_series_writer.reset();
+    }
+}
+
+void DEMSolver::WriteCheckpoint(const std::string& filename) {
+    assertSysInit("WriteCheckpoint");
+    DEMCheckpointWriter ckpt;
+    dT->writeCheckpoint(ckpt);
+    ckpt.Write(filename);
+    DEME_DEBUG_PRINTF("Wrote checkpoint file %s.", filename.c_str());
+}
+
+void DEMSolver::ReadCheckpoint(const std::string& filename) {
+    assertSysInit("ReadCheckpoint");
+    DEMCheckpointReader ckpt(filename);
+    // The stored contacts are all coming back, so the contact arrays are sized for them before they are filled
+    reserveContactArrays(ckpt.ReadValue<uint64_t>("nContacts"));
+    dT->readCheckpoint(ckpt);
+    DEME_DEBUG_PRINTF("Loaded checkpoint file %s.", filename.c_str());
+}
+
 void DEMSolver::WriteMeshFile(const std::string& outfilename) const {
     switch (m_mesh_out_format) {
         case (MESH_FORMAT::VTK): {
-            std::ofstream ptFile(outfilename, std::ios::out);
+            std::ofstream ptFile = openOutputFile(outfilename, std::ios::out);
             dT->writeMeshesAsVtk(ptFile);
             break;
         }
+        case (MESH_FORMAT::VTU): {
+            std::ofstream ptFile = openOutputFile(outfilename, std::ios::out | std::ios::binary);
+            dT->writeMeshesAsVtu(ptFile);
+            break;
+        }
         default:
             DEME_ERROR(
                 "Mesh output file format is unknown or not implemented. Please re-set it via SetMeshOutputFormat.");
@@ -1916,6 +2456,8 @@ size_t DEMSolver::ChangeClumpFamily(unsigned int fam_num,
 void DEMSolver::Initialize() {
     // A few checks first
     validateUserInputs();
+    // With several force models, the wildcard arrays and material properties serve them all
+    mergeForceModelRequirements();
 
     // Call the JIT compiler generator to make prep for this simulation
     generateEntityResources();
@@ -1958,6 +2500,11 @@ void DEMSolver::Initialize() {
     // contact pairs), and if the user needs to modify the contact wildcards before simulation starts, this step is
     // meaningful. Dry-run is automatically done if advancing the simulation by 0 or a negative amount of time.
     DoDynamicsThenSync(-1.0);
+
+    // The dry-run gives the contact array that launch configurations are benchmarked on
+    if (autotune_launch_config) {
+        dT->autotuneLaunchConfigs();
+    }
 }
 
 void DEMSolver::ShowTimingStats() {
@@ -1987,6 +2534,16 @@ void DEMSolver::ShowTimingStats() {
     DEME_PRINTF("--------------------------\n");
 }
 
+void DEMSolver::GetTimingStats(std::vector<std::string>& kT_names,
+                               std::vector<double>& kT_seconds,
+                               std::vector<std::string>& dT_names,
+                               std::vector<double>& dT_seconds) {
+    kT_seconds.clear();
+    dT_seconds.clear();
+    kT->getTiming(kT_names, kT_seconds);
+    dT->getTiming(dT_names, dT_seconds);
+}
+
 void DEMSolver::ClearTimingStats() {
     kT->resetTimers();
     dT->resetTimers();
@@ -2004,6 +2561,7 @@ void DEMSolver::ReleaseFlattenedArrays() {
     deallocate_array(m_input_mesh_obj_xyz);
     deallocate_array(m_input_mesh_obj_rot);
     deallocate_array(m_input_mesh_obj_family);
+    deallocate_array(m_input_mesh_obj_use_bvh);
 
     deallocate_array(m_unique_family_prescription);
     deallocate_array(m_input_clump_family);
@@ -2020,6 +2578,7 @@ void DEMSolver::ReleaseFlattenedArrays() {
     deallocate_array(m_mesh_facet_owner);
     deallocate_array(m_mesh_facet_materials);
     deallocate_array(m_mesh_facets);
+    deallocate_array(m_mesh_facet_node_offsets);
 
     deallocate_array(m_template_clump_mass);
     deallocate_array(m_template_clump_moi);
@@ -2054,6 +2613,8 @@ void DEMSolver::resetWorkerThreads() {
     // Finally, reset the thread stats and wait for potential new user calls
     kT->resetUserCallStat();
     dT->resetUserCallStat();
+    // Both threads are idle now, so the clumps inserted since the last kT handoff can go in
+    dT->applyClumpInsertions();
 }
 
 /// When simulation parameters are updated by the user, they can call this method to transfer them to the GPU-side in
@@ -2069,6 +2630,7 @@ void DEMSolver::UpdateSimParams() {
     // Jitify max vel finder, in case the policy there changed
     m_approx_max_vel_func->Initialize(m_subs, true);
     dT->approxMaxVelFunc = m_approx_max_vel_func;
+    dT->approxMaxVelFuncIsDefault = m_approx_max_vel_func_is_default;
 
     // Updating sim environment is critical
     dT->announceCritical();
@@ -2078,6 +2640,10 @@ void DEMSolver::UpdateStepSize(double ts) {
     m_ts_size = ts;
     kT->simParams->h = ts;
     dT->simParams->h = ts;
+    if (adapt_ts_max <= 0.) {
+        dT->simParams->adaptTSMax = ts;
+        dT->simParams->adaptTSMin = DEME_MIN(adapt_ts_min, ts);
+    }
 }
 
 void DEMSolver::UpdateClumps() {
@@ -2092,19 +2658,20 @@ void DEMSolver::UpdateClumps() {
             "point.\nNumber of analytical objects at last initialization: %u\nNumber of analytical objects now: %u",
             nLastTimeExtObjLoad, nExtObjLoad);
     }
-    if (nLastTimeClumpTemplateLoad != nClumpTemplateLoad) {
-        DEME_ERROR(
-            "UpdateClumps cannot be used after loading new clump templates. Consider re-initializing at this "
-            "point.\nNumber of clump templates at last initialization: %zu\nNumber of clump templates now: %zu",
-            nLastTimeClumpTemplateLoad, nClumpTemplateLoad);
-    }
     // DEME_WARNING(
     //     "UpdateClumps will add all currently cached clumps to the simulation.\nYou may want to ClearCache first,"
     //     "then AddClumps, then call this method, so the clumps cached earlier are forgotten before this method takes"
     //     "place.");
 
+    // New clump templates, materials or family prescriptions change the jitified kernel sources
+    const bool new_templates = (nLastTimeClumpTemplateLoad != nClumpTemplateLoad);
+    const bool new_policies = new_templates || (nLastTimeMatNum != m_loaded_materials.size()) ||
+                              (nLastTimeFamilyPreNum != m_input_family_prescription.size());
+
     // This method requires kT and dT are sync-ed
     // resetWorkerThreads();
+    // Clumps inserted since the last kT handoff go in first, so the entity numbers below are right
+    dT->applyClumpInsertions();
 
     // Record the number of entities, before adding to the system
     size_t nOwners_old = nOwnerBodies;
@@ -2114,30 +2681,110 @@ void DEMSolver::UpdateClumps() {
     size_t nFacets_old = nTriGM;
     unsigned int nAnalGM_old = nAnalGM;
     unsigned int nExtObj_old = nExtObj;
+    unsigned int nClumpTopo_old = nDistinctClumpBodyTopologies;
+
+    // With jitified mass properties, the table has clump templates first, then analytical objects and meshes. New
+    // templates go in before the latter two, whose entries are only kept by dT now, so we get them back from there.
+    if (new_templates && jitify_mass_moi) {
+        std::vector<float> mass_types;
+        std::vector<float3> moi_types;
+        dT->getNonClumpMassProperties(mass_types, moi_types);
+        m_ext_obj_mass.assign(mass_types.begin(), mass_types.begin() + nExtObj);
+        m_ext_obj_moi.assign(moi_types.begin(), moi_types.begin() + nExtObj);
+        m_mesh_obj_mass.assign(mass_types.begin() + nExtObj, mass_types.end());
+        m_mesh_obj_moi.assign(moi_types.begin() + nExtObj, moi_types.end());
+    }
 
     preprocessClumps();
-    preprocessClumpTemplates();
+    // Existing clumps refer to the templates by their current marks, so no re-ordering
+    preprocessClumpTemplates(false);
     //// TODO: This method should also work on newly added meshes
     updateTotalEntityNum();
+    if (new_policies) {
+        figureOutFamilyMasks();
+        postResourceGenChecksAndTabKeeping();
+    }
     allocateGPUArrays();
+    if (new_policies) {
+        ClumpTemplateFlatten flattened_clump_templates(m_template_clump_mass, m_template_clump_moi,
+                                                       m_template_sp_mat_ids, m_template_sp_radii,
+                                                       m_template_sp_relPos, m_template_clump_volume);
+        dT->registerMassProperties(flattened_clump_templates, m_ext_obj_mass, m_ext_obj_moi, m_mesh_obj_mass,
+                                   m_mesh_obj_moi);
+        dT->templateNumNameMap = m_template_number_name_map;
+        if (jitify_mass_moi) {
+            dT->shiftNonClumpInertiaOffsets(nOwners_old, nDistinctClumpBodyTopologies - nClumpTopo_old);
+        }
+    }
     // `Update' method needs to know the number of existing clumps and spheres (before this addition)
     updateClumpMeshArrays(nOwners_old, nClumps_old, nSpheres_old, nTriMesh_old, nFacets_old, nExtObj_old, nAnalGM_old);
     packDataPointers();
+    // Only the programs whose substituted sources changed are re-compiled
+    if (new_policies) {
+        rejitifyKernels();
+    }
     ReleaseFlattenedArrays();
     // Updating clumps is very critical
     dT->announceCritical();
 
-    // This method should not introduce new material or clump template or family prescription, let's check that
-    if (nLastTimeMatNum != m_loaded_materials.size() || nLastTimeFamilyPreNum != m_input_family_prescription.size()) {
+    // After Initialize or UpdateClumps, we should clear host-side initialization object cache
+    ClearCache();
+}
+
+std::shared_ptr<DEMTracker> DEMSolver::InsertClumps(DEMClumpBatch& input_batch) {
+    assertSysInit("InsertClumps");
+    if (input_batch.GetNumContacts() > 0) {
         DEME_ERROR(
-            "UpdateClumps should not be used if you introduce new material types or family prescription (which will "
-            "need re-jitification).\nWe used to have %u materials, now we have %zu.\nWe used to have %u family "
-            "prescription, now we have %zu.",
-            nLastTimeMatNum, m_loaded_materials.size(), nLastTimeFamilyPreNum, m_input_family_prescription.size());
+            "InsertClumps does not take batches with contact pairs in them.\nPlease load such a batch via AddClumps, "
+            "then UpdateClumps.");
+    }
+    size_t nSpheres = 0;
+    for (const auto& type : input_batch.types) {
+        if (!type || type->mark >= nDistinctClumpBodyTopologies) {
+            DEME_ERROR(
+                "InsertClumps can only insert clumps whose templates are already in the system.\nTemplates loaded "
+                "after the last Initialize or UpdateClumps can be brought in by loading the clumps via AddClumps, "
+                "then calling UpdateClumps.");
+        }
+        nSpheres += type->nComp;
+    }
+    for (const auto& family : input_batch.families) {
+        if (family > std::numeric_limits<family_t>::max()) {
+            DEME_ERROR("Family number %u of an inserted clump is larger than the max allowed %u.", family,
+                       std::numeric_limits<family_t>::max());
+        }
     }
+    input_batch.nSpheres = nSpheres;
 
-    // After Initialize or UpdateClumps, we should clear host-side initialization object cache
-    ClearCache();
+    // The new clumps go after all existing owners (and the ones inserted earlier but not yet in)
+    DEMTrackedObj tracked_obj;
+    tracked_obj.obj_type = OWNER_TYPE::CLUMP;
+    tracked_obj.ownerID = nOwnerBodies;
+    tracked_obj.nSpanOwners = input_batch.GetNumClumps();
+    tracked_obj.geoID = nSpheresGM;
+    tracked_obj.nGeos = nSpheres;
+    m_tracked_objs.push_back(std::make_shared<DEMTrackedObj>(std::move(tracked_obj)));
+    DEMTracker tracker(this);
+    tracker.obj = m_tracked_objs.back();
+
+    if (input_batch.GetNumClumps() > 0) {
+        dT->queueClumpInsertion(input_batch, nOwnerBodies, nSpheresGM);
+        nOwnerClumps += input_batch.GetNumClumps();
+        nOwnerBodies += input_batch.GetNumClumps();
+        nSpheresGM += nSpheres;
+    }
+    return std::make_shared<DEMTracker>(std::move(tracker));
+}
+
+std::shared_ptr<DEMTracker> DEMSolver::InsertClumps(const std::vector<std::shared_ptr<DEMClumpTemplate>>& input_types,
+                                                    const std::vector<float3>& input_xyz) {
+    if (input_types.size() != input_xyz.size()) {
+        DEME_ERROR("Arrays in the call InsertClumps must all have the same length.");
+    }
+    DEMClumpBatch a_batch(input_types.size());
+    a_batch.SetTypes(input_types);
+    a_batch.SetPos(input_xyz);
+    return InsertClumps(a_batch);
 }
 
 void DEMSolver::ChangeClumpSizes(const std::vector<bodyID_t>& IDs, const std::vector<float>& factors) {
@@ -2164,13 +2811,117 @@ void DEMSolver::ChangeClumpSizes(const std::vector<bodyID_t>& IDs, const std::ve
     dT->announceCritical();
 }
 
-/// Removes all entities associated with a family from the arrays (to save memory space). This method should only be
+/// Removes all clumps associated with a family from the arrays (to save memory space). This method should only be
 /// called periodically because it gives a large overhead. This is only used in long simulations where if the
 /// `phased-out' entities do not get cleared, we won't have enough memory space.
-/// TODO: Implement it.
-void DEMSolver::PurgeFamily(unsigned int family_num) {}
+void DEMSolver::PurgeFamily(unsigned int family_num) {
+    assertSysInit("PurgeFamily");
+    if (family_num > std::numeric_limits<family_t>::max()) {
+        DEME_ERROR("You instructed family number %u to be purged, but family number should not be larger than %u.",
+                   family_num, std::numeric_limits<family_t>::max());
+    }
+    // This method requires kT and dT are sync-ed
+    // resetWorkerThreads();
+    dT->applyClumpInsertions();
+
+    std::vector<bodyID_t> ownerOldToNew, sphereUserOldToNew;
+    size_t nOwnersLeft, nSpheresLeft;
+    dT->purgeClumpsOfFamily(family_num, ownerOldToNew, sphereUserOldToNew, nOwnersLeft, nSpheresLeft);
+    if (nOwnersLeft == nOwnerBodies) {
+        return;
+    }
+
+    // Only clumps are removed, so the other owner numbers stay
+    nOwnerClumps -= nOwnerBodies - nOwnersLeft;
+    nOwnerBodies = nOwnersLeft;
+    nSpheresGM = nSpheresLeft;
+    // The arrays shrink in size, but they keep their capacity, so clumps added later can re-use it
+    allocateGPUArrays();
+    m_owner_mesh_map.clear();
+    packDataPointers();
+
+    // Trackers are remapped. The owners (and spheres) that stay in a tracked batch are still contiguous.
+    for (auto& tracked_obj : m_tracked_objs) {
+        if (tracked_obj->isBroken || tracked_obj->ownerID == NULL_BODYID) {
+            continue;
+        }
+        size_t nLeft = 0;
+        bodyID_t firstLeft = NULL_BODYID;
+        for (size_t i = tracked_obj->ownerID; i < tracked_obj->ownerID + tracked_obj->nSpanOwners; i++) {
+            if (ownerOldToNew[i] != NULL_BODYID) {
+                firstLeft = (nLeft == 0) ? ownerOldToNew[i] : firstLeft;
+                nLeft++;
+            }
+        }
+        if (nLeft == 0) {
+            tracked_obj->isBroken = true;
+            continue;
+        }
+        tracked_obj->ownerID = firstLeft;
+        tracked_obj->nSpanOwners = nLeft;
+        if (tracked_obj->obj_type == OWNER_TYPE::CLUMP) {
+            size_t nGeosLeft = 0;
+            size_t firstGeoLeft = 0;
+            for (size_t i = tracked_obj->geoID; i < tracked_obj->geoID + tracked_obj->nGeos; i++) {
+                if (sphereUserOldToNew[i] != NULL_BODYID) {
+                    firstGeoLeft = (nGeosLeft == 0) ? sphereUserOldToNew[i] : firstGeoLeft;
+                    nGeosLeft++;
+                }
+            }
+            tracked_obj->geoID = firstGeoLeft;
+            tracked_obj->nGeos = nGeosLeft;
+        }
+    }
+
+    // The owners of analytical objects are jitified, so if they moved, the kernels using them are re-built. The other
+    // inputs of those kernels may have been released, so the owner list is replaced in the substitution we have.
+    if (nAnalGM > 0) {
+        std::string objOwner;
+        for (const auto& owner : dT->ownerAnalBody) {
+            objOwner += std::to_string(owner) + ",";
+        }
+        if (objOwner != m_subs["_objOwner_"]) {
+            const std::string old_def = "objOwner[] = {" + m_subs["_objOwner_"] + "}";
+            std::string& defs = m_subs["_analyticalEntityDefs_"];
+            size_t pos = defs.find(old_def);
+            if (pos == std::string::npos) {
+                DEME_ERROR("PurgeFamily could not find the jitified analytical object owner list to update.");
+            }
+            defs.replace(pos, old_def.size(), "objOwner[] = {" + objOwner + "}");
+            m_subs["_objOwner_"] = objOwner;
+            // Only the programs whose substituted sources changed are re-compiled
+            buildJitPrograms();
+        }
+    }
+
+    // Removing entities is critical
+    dT->announceCritical();
+}
 
 void DEMSolver::DoDynamics(double thisCallDuration) {
+    if (!m_perf_report_callback || thisCallDuration <= 0.) {
+        runDynamics(thisCallDuration);
+        return;
+    }
+    // Cut this call at the report times. dT always takes whole steps, so a leftover shorter than half a step is not
+    // run, or the call would overshoot its end by a step.
+    const double half_step = 0.5 * GetTimeStepSize();
+    const double call_end = GetSimTime() + thisCallDuration;
+    double left = thisCallDuration;
+    while (left > half_step) {
+        double till_report = m_next_perf_report_time - GetSimTime();
+        runDynamics((till_report > half_step && till_report < left) ? till_report : left);
+        if (GetSimTime() >= m_next_perf_report_time - half_step) {
+            m_perf_report_callback(GetPerformanceReport());
+            while (m_next_perf_report_time <= GetSimTime() + half_step) {
+                m_next_perf_report_time += m_perf_report_interval;
+            }
+        }
+        left = call_end - GetSimTime();
+    }
+}
+
+void DEMSolver::runDynamics(double thisCallDuration) {
     // Is it needed here??
     // dT->packDataPointers(kT->granData);
 
@@ -2223,13 +2974,57 @@ void DEMSolver::ShowThreadCollaborationStats() {
     //                 (dTkT_InteractionManager->schedulingStats.nDynamicReceives).load());
     // DEME_PRINTF("Number of times kinematic loads buffer: %zu\n",
     //                 (dTkT_InteractionManager->schedulingStats.nKinematicReceives).load());
+    DEME_PRINTF("Number of updates that reused the last contact list: %zu\n",
+                (dTkT_InteractionManager->schedulingStats.nContactListReuses).load());
     DEME_PRINTF("Number of times dynamic held back: %zu\n",
                 (dTkT_InteractionManager->schedulingStats.nTimesDynamicHeldBack).load());
     // DEME_PRINTF("Number of times kinematic held back: %zu\n",
     //             (dTkT_InteractionManager->schedulingStats.nTimesKinematicHeldBack).load());
+    DEME_PRINTF("Time dynamic spent waiting for kinematic: %.7g seconds\n",
+                (double)(dTkT_InteractionManager->schedulingStats.dynamicWaitNanosec).load() * 1e-9);
+    DEME_PRINTF("Time kinematic spent waiting for dynamic: %.7g seconds\n",
+                (double)(dTkT_InteractionManager->schedulingStats.kinematicWaitNanosec).load() * 1e-9);
+    if (dT->solverFlags.autoUpdateFreq && dT->solverFlags.useCostModelDrift) {
+        const uint64_t n_timed = (dTkT_InteractionManager->schedulingStats.nKinematicCDTimed).load();
+        if (n_timed > 0) {
+            DEME_PRINTF("Average GPU time of a kinematic update: %.4g ms\n",
+                        (double)(dTkT_InteractionManager->schedulingStats.kinematicCDNanosec).load() * 1e-6 / n_timed);
+        }
+        DEME_PRINTF("Cost model: dynamic step takes %.4g ms, kinematic update takes %.4g ms\n",
+                    dT->costModelStepSec * 1e3, dT->costModelCDSec * 1e3);
+        DEME_PRINTF("Cost model: chosen future drift %u, current future drift %u\n", dT->costModelDrift,
+                    dT->granData->perhapsIdealFutureDrift);
+    }
     DEME_PRINTF("-----------------------------\n");
 }
 
+void DEMSolver::ShowMemStats() {
+    DEME_PRINTF("\n~~ DEVICE MEMORY STATISTICS ~~\n");
+    const DEMMemoryRegistry* registries[2] = {&kT->m_mem_registry, &dT->m_mem_registry};
+    const char* names[2] = {"kT", "dT"};
+    for (unsigned int i = 0; i < 2; i++) {
+        DEME_PRINTF("%s: %s in use, peak %s\n", names[i], pretty_format_bytes(registries[i]->GetBytesUsed()).c_str(),
+                    pretty_format_bytes(registries[i]->GetPeakBytesUsed()).c_str());
+        for (const auto& sub : registries[i]->GetSubsystemUsage()) {
+            DEME_PRINTF("    %s: %s in use, peak %s\n", sub.first.c_str(),
+                        pretty_format_bytes(sub.second.first).c_str(), pretty_format_bytes(sub.second.second).c_str());
+        }
+    }
+    if (m_mem_budget > 0) {
+        DEME_PRINTF("Memory budget: %s, %.4g%% in use\n", pretty_format_bytes(m_mem_budget).c_str(),
+                    (double)GetDeviceMemUsage() / (double)m_mem_budget * 100.);
+    }
+    DEME_PRINTF("------------------------------\n");
+}
+
+size_t DEMSolver::GetDeviceMemUsage() const {
+    return kT->m_mem_registry.GetBytesUsed() + dT->m_mem_registry.GetBytesUsed();
+}
+
+size_t DEMSolver::GetDeviceMemPeak() const {
+    return kT->m_mem_registry.GetPeakBytesUsed() + dT->m_mem_registry.GetPeakBytesUsed();
+}
+
 void DEMSolver::ShowAnomalies() {
     DEME_PRINTF("\n~~ Simulation anomaly report ~~\n");
     bool there_is_anomaly = goThroughWorkerAnomalies();
@@ -2241,6 +3036,107 @@ void DEMSolver::ShowAnomalies() {
     dT->anomalies.Clear();
 }
 
+DEMBinOccupancyProfile DEMSolver::GetBinOccupancyProfile() {
+    std::lock_guard<std::mutex> lock(kT->binProfileMutex);
+    return kT->binProfile;
+}
+
+void DEMSolver::ShowBinOccupancyProfile() {
+    DEMBinOccupancyProfile profile = GetBinOccupancyProfile();
+    DEME_PRINTF("\n-------- Bin occupancy --------\n");
+    if (!profile.valid) {
+        DEME_PRINTF("No bin occupancy profile has been taken. Call UseBinOccupancyProfiler before Initialize.\n");
+        DEME_PRINTF("-------------------------------\n");
+        return;
+    }
+    DEME_PRINTF("Taken at kT update %llu, bin size %.6g, %zu bins\n", (unsigned long long)profile.kTUpdate,
+                profile.binSize, profile.numBins);
+    DEME_PRINTF("Active bins: %zu (%.4g%% of all), %zu of them touched by triangles\n", profile.numActiveBins,
+                profile.activeBinFraction * 100., profile.numActiveBinsForTri);
+    DEME_PRINTF("Max spheres in a bin: %zu, max triangles in a bin: %zu, bins split over blocks: %zu\n",
+                profile.maxSpheresInBin, profile.maxTrianglesInBin, profile.numDenseBins);
+    DEME_PRINTF("Sphere--sphere contacts: %zu\n", profile.numSphSphContacts);
+    auto show = [this](const char* what, const std::vector<size_t>& hist) {
+        DEME_PRINTF("Bins by number of %s:\n", what);
+        for (size_t i = 0; i < hist.size(); i++) {
+            if (hist[i] == 0)
+                continue;
+            if (i == 0) {
+                DEME_PRINTF("    0: %zu\n", hist[i]);
+            } else if (i + 1 == hist.size()) {
+                DEME_PRINTF("    %llu+: %zu\n", 1ull << (i - 1), hist[i]);
+            } else {
+                DEME_PRINTF("    %llu-%llu: %zu\n", 1ull << (i - 1), (1ull << i) - 1, hist[i]);
+            }
+        }
+    };
+    show("spheres", profile.spheresPerBin);
+    show("triangles", profile.trianglesPerBin);
+    show("sphere--sphere contacts", profile.contactsPerBin);
+    DEME_PRINTF("-------------------------------\n");
+}
+
+DEMPerformanceReport DEMSolver::GetPerformanceReport() {
+    DEMPerformanceReport report;
+    report.simTime = GetSimTime();
+    report.numDynamicSteps = dT->nTotalSteps;
+
+    std::vector<std::string> names;
+    std::vector<double> vals;
+    kT->getTiming(names, vals);
+    for (unsigned int i = 0; i < names.size(); i++) {
+        report.kTTimers.push_back(std::make_pair(names.at(i), vals.at(i)));
+    }
+    names.clear();
+    vals.clear();
+    dT->getTiming(names, vals);
+    for (unsigned int i = 0; i < names.size(); i++) {
+        report.dTTimers.push_back(std::make_pair(names.at(i), vals.at(i)));
+    }
+
+    const auto& stats = dTkT_InteractionManager->schedulingStats;
+    report.nDynamicUpdates = stats.nDynamicUpdates.load();
+    report.nKinematicUpdates = stats.nKinematicUpdates.load();
+    report.nTimesDynamicHeldBack = stats.nTimesDynamicHeldBack.load();
+    report.nTimesKinematicHeldBack = stats.nTimesKinematicHeldBack.load();
+    report.accumKinematicLagSteps = stats.accumKinematicLagSteps.load();
+    report.nContactListReuses = stats.nContactListReuses.load();
+    report.dynamicWaitSec = (double)stats.dynamicWaitNanosec.load() * 1e-9;
+    report.kinematicWaitSec = (double)stats.kinematicWaitNanosec.load() * 1e-9;
+    report.currentFutureDrift = dT->granData->perhapsIdealFutureDrift;
+    report.updateFreq = GetUpdateFreq();
+
+    report.numContacts = GetNumContacts();
+    report.avgContactsPerSphere = GetAvgSphContacts();
+    report.binSize = GetBinSize();
+    report.numBins = GetBinNum();
+    {
+        std::lock_guard<std::mutex> lock(kT->binSizeHistoryMutex);
+        report.binSizeHistory.assign(kT->binSizeHistory.begin(), kT->binSizeHistory.end());
+    }
+    report.binProfile = GetBinOccupancyProfile();
+
+    report.kTMemBytes = kT->m_mem_registry.GetBytesUsed();
+    report.kTMemPeakBytes = kT->m_mem_registry.GetPeakBytesUsed();
+    report.kTMemBySubsystem = kT->m_mem_registry.GetSubsystemUsage();
+    report.dTMemBytes = dT->m_mem_registry.GetBytesUsed();
+    report.dTMemPeakBytes = dT->m_mem_registry.GetPeakBytesUsed();
+    report.dTMemBySubsystem = dT->m_mem_registry.GetSubsystemUsage();
+
+    report.overMaxVel = kT->anomalies.over_max_vel || dT->anomalies.over_max_vel;
+    return report;
+}
+
+void DEMSolver::SetPerformanceReportCallback(const std::function<void(const DEMPerformanceReport&)>& callback,
+                                             double interval) {
+    if (callback && interval <= 0.) {
+        DEME_ERROR("SetPerformanceReportCallback needs a positive report interval, but %.9g was given.", interval);
+    }
+    m_perf_report_callback = callback;
+    m_perf_report_interval = interval;
+    m_next_perf_report_time = GetSimTime() + interval;
+}
+
 void DEMSolver::ClearThreadCollaborationStats() {
     dTkT_InteractionManager->schedulingStats.nDynamicUpdates = 0;
     dTkT_InteractionManager->schedulingStats.nKinematicUpdates = 0;
@@ -2249,10 +3145,15 @@ void DEMSolver::ClearThreadCollaborationStats() {
     dTkT_InteractionManager->schedulingStats.nTimesDynamicHeldBack = 0;
     dTkT_InteractionManager->schedulingStats.nTimesKinematicHeldBack = 0;
     dTkT_InteractionManager->schedulingStats.accumKinematicLagSteps = 0;
+    dTkT_InteractionManager->schedulingStats.nContactListReuses = 0;
+    dTkT_InteractionManager->schedulingStats.dynamicWaitNanosec = 0;
+    dTkT_InteractionManager->schedulingStats.kinematicWaitNanosec = 0;
+    dTkT_InteractionManager->schedulingStats.kinematicCDNanosec = 0;
+    dTkT_InteractionManager->schedulingStats.nKinematicCDTimed = 0;
     dT->nTotalSteps = 0;
 }
 
-float DEMSolver::dTInspectReduce(const std::shared_ptr<jitify::Program>& inspection_kernel,
+float DEMSolver::dTInspectReduce(const std::shared_ptr<JitProgram>& inspection_kernel,
                                  const std::string& kernel_name,
                                  INSPECT_ENTITY_TYPE thing_to_insp,
                                  CUB_REDUCE_FLAVOR reduce_flavor,
@@ -2261,7 +3162,7 @@ float DEMSolver::dTInspectReduce(const std::shared_ptr<jitify::Program>& inspect
     return (float)(*pRes);
 }
 
-float* DEMSolver::dTInspectNoReduce(const std::shared_ptr<jitify::Program>& inspection_kernel,
+float* DEMSolver::dTInspectNoReduce(const std::shared_ptr<JitProgram>& inspection_kernel,
                                     const std::string& kernel_name,
                                     INSPECT_ENTITY_TYPE thing_to_insp,
                                     CUB_REDUCE_FLAVOR reduce_flavor,
@@ -2270,4 +3171,16 @@ float* DEMSolver::dTInspectNoReduce(const std::shared_ptr<jitify::Program>& insp
     return pRes;
 }
 
+std::vector<float> DEMSolver::dTInspectGroupReduce(const std::shared_ptr<JitProgram>& fused_kernel,
+                                                   unsigned int n_owner_slots,
+                                                   unsigned int n_sphere_slots) {
+    return dT->inspectFusedCall(fused_kernel, n_owner_slots, n_sphere_slots);
+}
+
+std::shared_ptr<DEMAsyncResult> DEMSolver::dTInspectGroupReduceAsync(const std::shared_ptr<JitProgram>& fused_kernel,
+                                                                     unsigned int n_owner_slots,
+                                                                     unsigned int n_sphere_slots) {
+    return dT->inspectFusedCallAsync(fused_kernel, n_owner_slots, n_sphere_slots);
+}
+
 }  // namespace deme
@@ -3,6 +3,8 @@
 //
 //	SPDX-License-Identifier: BSD-3-Clause
 
+#include <numeric>
+
 #include <DEM/API.h>
 #include <DEM/AuxClasses.h>
 #include <DEM/HostSideHelpers.hpp>
@@ -10,6 +12,68 @@
 
 namespace deme {
 
+// =============================================================================
+// DEMAsyncResult class
+// =============================================================================
+
+void DEMAsyncResult::assertAlive() const {
+    if (released) {
+        throw std::runtime_error("An asynchronous query result is used after its solver released its buffers.\n");
+    }
+}
+
+bool DEMAsyncResult::IsReady() const {
+    assertAlive();
+    cudaError_t status = cudaEventQuery(done);
+    if (status == cudaErrorNotReady) {
+        return false;
+    }
+    DEME_GPU_CALL(status);
+    return true;
+}
+
+void DEMAsyncResult::Wait() const {
+    assertAlive();
+    DEME_GPU_CALL(cudaEventSynchronize(done));
+}
+
+std::vector<float> DEMAsyncResult::GetValues() const {
+    Wait();
+    if (order.empty()) {
+        return std::vector<float>(pinned, pinned + n);
+    }
+    std::vector<float> res(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        res[i] = pinned[order[i]];
+    }
+    return res;
+}
+
+float DEMAsyncResult::GetValue(size_t i) const {
+    Wait();
+    size_t num = order.empty() ? n : order.size();
+    if (i >= num) {
+        std::stringstream ss;
+        ss << "Value " << i << " of an asynchronous query result is requested, but it only has " << num
+           << " values." << std::endl;
+        throw std::runtime_error(ss.str());
+    }
+    return order.empty() ? pinned[i] : pinned[order[i]];
+}
+
+std::string DEMDeviceArrayView::GetTypeStr() const {
+    const char kinds[] = {'i', 'u', 'f', 'V', 'V'};
+    return std::string("<") + kinds[type_code < 5 ? type_code : 4] + std::to_string(bits / DEME_BITS_PER_BYTE);
+}
+
+size_t DEMDeviceArrayView::GetNumElements() const {
+    size_t num = 1;
+    for (const auto& extent : shape) {
+        num *= extent;
+    }
+    return num;
+}
+
 // =============================================================================
 // DEMInspector class
 // =============================================================================
@@ -175,6 +239,16 @@ float* DEMInspector::GetValues() {
     return reduce_result;
 }
 
+std::shared_ptr<DEMAsyncResult> DEMInspector::GetValueAsync() {
+    assertInit();
+    if (!async_group) {
+        // The group does not own this inspector (the other way around), hence the no-op deleter
+        std::shared_ptr<DEMInspector> self(this, [](DEMInspector*) {});
+        async_group = std::make_shared<DEMInspectorGroup>(sys, dT, std::vector<std::shared_ptr<DEMInspector>>{self});
+    }
+    return async_group->GetValuesAsync();
+}
+
 float* DEMInspector::dT_GetValue() {
     // assertInit(); // This one the user should not use
     return dT->inspectCall(inspection_kernel, kernel_name, thing_to_insp, reduce_flavor, all_domain);
@@ -186,14 +260,7 @@ void DEMInspector::assertInit() {
     }
 }
 
-void DEMInspector::Initialize(const std::unordered_map<std::string, std::string>& Subs, bool force) {
-    if (!(sys->GetInitStatus()) && !force) {
-        std::stringstream ss;
-        ss << "Inspector should only be initialized or used after the simulation system is initialized (because it "
-              "uses device-side data)!"
-           << std::endl;
-        throw std::runtime_error(ss.str());
-    }
+std::string DEMInspector::getInRegionSpecifier() const {
     // We want to make sure if the in_region_code is legit, if it is not an all_domain query
     std::string in_region_specifier = in_region_code, placeholder;
     // But if the in_region_code is all spaces, it's fine, probably they don't care
@@ -212,17 +279,32 @@ void DEMInspector::Initialize(const std::unordered_map<std::string, std::string>
         in_region_specifier += "if (!isInRegion) { not_in_region[" + index_name + "] = 1; return; }\n";
     }
 
+    return in_region_specifier;
+}
+
+void DEMInspector::Initialize(const std::unordered_map<std::string, std::string>& Subs, bool force) {
+    if (!(sys->GetInitStatus()) && !force) {
+        std::stringstream ss;
+        ss << "Inspector should only be initialized or used after the simulation system is initialized (because it "
+              "uses device-side data)!"
+           << std::endl;
+        throw std::runtime_error(ss.str());
+    }
+    std::string in_region_specifier = getInRegionSpecifier();
+
     // Add own substitutions to it
     std::unordered_map<std::string, std::string> my_subs = Subs;
     my_subs["_inRegionPolicy_"] = in_region_specifier;
     my_subs["_quantityQueryProcess_"] = inspection_code;
+    // If re-initialized after the solver re-jitified, the program is rebuilt only if its source is affected
     if (thing_to_insp == INSPECT_ENTITY_TYPE::SPHERE) {
-        inspection_kernel = std::make_shared<jitify::Program>(std::move(
-            JitHelper::buildProgram("DEMSphereQueryKernels", JitHelper::KERNEL_DIR / "DEMSphereQueryKernels.cu",
-                                    my_subs, DEME_JITIFY_OPTIONS)));
+        inspection_kernel =
+            JitHelper::updateProgram(inspection_kernel, "DEMSphereQueryKernels",
+                                     JitHelper::KERNEL_DIR / "DEMSphereQueryKernels.cu", my_subs, DEME_JITIFY_OPTIONS);
     } else if (thing_to_insp == INSPECT_ENTITY_TYPE::CLUMP || thing_to_insp == INSPECT_ENTITY_TYPE::EVERYTHING) {
-        inspection_kernel = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
-            "DEMOwnerQueryKernels", JitHelper::KERNEL_DIR / "DEMOwnerQueryKernels.cu", my_subs, DEME_JITIFY_OPTIONS)));
+        inspection_kernel =
+            JitHelper::updateProgram(inspection_kernel, "DEMOwnerQueryKernels",
+                                     JitHelper::KERNEL_DIR / "DEMOwnerQueryKernels.cu", my_subs, DEME_JITIFY_OPTIONS);
     } else {
         std::stringstream ss;
         ss << "Sorry, an inspector object you are using is not implemented yet.\nConsider letting the developers know "
@@ -231,6 +313,154 @@ void DEMInspector::Initialize(const std::unordered_map<std::string, std::string>
         throw std::runtime_error(ss.str());
     }
     initialized = true;
+    // Its own async group is not known to the solver, so it is brought up to date here
+    if (async_group && async_group->initialized) {
+        async_group->Initialize(Subs, true);
+    }
+}
+
+// =============================================================================
+// DEMInspectorGroup class
+// =============================================================================
+
+DEMInspectorGroup::DEMInspectorGroup(DEMSolver* sim_sys,
+                                     DEMDynamicThread* dT_sys,
+                                     const std::vector<std::shared_ptr<DEMInspector>>& inspectors)
+    : sys(sim_sys), dT(dT_sys) {
+    if (inspectors.empty()) {
+        throw std::runtime_error("An inspector group needs at least one inspector.\n");
+    }
+    std::vector<std::shared_ptr<DEMInspector>> owner_insp, sphere_insp;
+    std::vector<size_t> owner_pos, sphere_pos;
+    for (size_t i = 0; i < inspectors.size(); i++) {
+        const auto& insp = inspectors[i];
+        if (insp->reduce_flavor == CUB_REDUCE_FLAVOR::NONE) {
+            std::stringstream ss;
+            ss << "Inspector " << i << " of an inspector group is not a reduction (such as absv).\nOnly inspectors "
+               << "with a reduced value can be evaluated in a group." << std::endl;
+            throw std::runtime_error(ss.str());
+        }
+        if (insp->thing_to_insp == INSPECT_ENTITY_TYPE::SPHERE) {
+            sphere_insp.push_back(insp);
+            sphere_pos.push_back(i);
+        } else if (insp->thing_to_insp == INSPECT_ENTITY_TYPE::CLUMP ||
+                   insp->thing_to_insp == INSPECT_ENTITY_TYPE::EVERYTHING) {
+            owner_insp.push_back(insp);
+            owner_pos.push_back(i);
+        } else {
+            std::stringstream ss;
+            ss << "Sorry, an inspector object you are using is not implemented yet.\nConsider letting the developers "
+                  "know this and they may help you."
+               << std::endl;
+            throw std::runtime_error(ss.str());
+        }
+    }
+    nOwnerSlots = owner_insp.size();
+    nSphereSlots = sphere_insp.size();
+    slot_of.resize(inspectors.size());
+    for (unsigned int i = 0; i < nOwnerSlots; i++) {
+        slot_inspectors.push_back(owner_insp[i]);
+        slot_of[owner_pos[i]] = i;
+    }
+    for (unsigned int i = 0; i < nSphereSlots; i++) {
+        slot_inspectors.push_back(sphere_insp[i]);
+        slot_of[sphere_pos[i]] = nOwnerSlots + i;
+    }
+}
+
+void DEMInspectorGroup::assertInit() {
+    if (!initialized) {
+        Initialize(sys->GetJitStringSubs());
+    }
+}
+
+void DEMInspectorGroup::Initialize(const std::unordered_map<std::string, std::string>& Subs, bool force) {
+    if (!(sys->GetInitStatus()) && !force) {
+        std::stringstream ss;
+        ss << "Inspector group should only be initialized or used after the simulation system is initialized "
+              "(because it uses device-side data)!"
+           << std::endl;
+        throw std::runtime_error(ss.str());
+    }
+    std::string owner_code, sphere_code;
+    std::string identity_code = "inline __device__ float fusedInspectorIdentity(unsigned int slot) {\n"
+                                "    switch (slot) {\n";
+    std::string op_code = "inline __device__ float fusedInspectorReduceOp(unsigned int slot, float a, float b) {\n"
+                          "    switch (slot) {\n";
+    for (unsigned int slot = 0; slot < slot_inspectors.size(); slot++) {
+        const auto& insp = slot_inspectors[slot];
+        const std::string slot_str = std::to_string(slot);
+        std::string identity, op;
+        switch (insp->reduce_flavor) {
+            case (CUB_REDUCE_FLAVOR::MAX):
+                identity = "-DEME_HUGE_FLOAT";
+                op = "fmaxf(a, b)";
+                break;
+            case (CUB_REDUCE_FLAVOR::MIN):
+                identity = "DEME_HUGE_FLOAT";
+                op = "fminf(a, b)";
+                break;
+            default:
+                identity = "0.f";
+                op = "a + b";
+                break;
+        }
+        identity_code += "        case " + slot_str + ": return " + identity + ";\n";
+        op_code += "        case " + slot_str + ": return " + op + ";\n";
+
+        // Each inspector sees its own slot as quantity and not_in_region, and its code is a lambda so that the return
+        // in a region test only ends this inspector. Entries that are not counted are set to the identity, so the
+        // reduction needs no sort by key.
+        const std::string& idx = insp->index_name;
+        std::string body = "{\n    float* quantity = quantities + " + slot_str + " * slotStride;\n" +
+                           "    deme::notStupidBool_t* not_in_region = not_in_regions + " + slot_str +
+                           " * slotStride;\n    not_in_region[" + idx + "] = 0;\n";
+        std::string lambda = "[&]() {\n{ " + insp->getInRegionSpecifier() + "; }\n{ " + insp->inspection_code +
+                             "; }\n}();\n";
+        if (insp->thing_to_insp == INSPECT_ENTITY_TYPE::SPHERE) {
+            body += lambda;
+        } else {
+            ownerType_t owner_type = (insp->thing_to_insp == INSPECT_ENTITY_TYPE::CLUMP)
+                                         ? OWNER_T_CLUMP
+                                         : (OWNER_T_CLUMP | OWNER_T_MESH | OWNER_T_ANALYTICAL);
+            body += "if (myType & " + std::to_string((unsigned int)owner_type) + ") {\n" + lambda +
+                    "} else { not_in_region[" + idx + "] = 1; }\n";
+        }
+        body += "if (not_in_region[" + idx + "]) { quantity[" + idx + "] = " + identity + "; }\n}\n";
+        if (insp->thing_to_insp == INSPECT_ENTITY_TYPE::SPHERE) {
+            sphere_code += body;
+        } else {
+            owner_code += body;
+        }
+    }
+    identity_code += "    }\n    return 0.f;\n}\n";
+    op_code += "    }\n    return a + b;\n}\n";
+
+    std::unordered_map<std::string, std::string> my_subs = Subs;
+    my_subs["_fusedReduceOps_"] = identity_code + op_code;
+    my_subs["_ownerQueryProcesses_"] = owner_code.empty() ? " " : owner_code;
+    my_subs["_sphereQueryProcesses_"] = sphere_code.empty() ? " " : sphere_code;
+    fused_kernel = JitHelper::updateProgram(fused_kernel, "DEMFusedQueryKernels",
+                                            JitHelper::KERNEL_DIR / "DEMFusedQueryKernels.cu", my_subs,
+                                            DEME_JITIFY_OPTIONS);
+    initialized = true;
+}
+
+std::vector<float> DEMInspectorGroup::GetValues() {
+    assertInit();
+    std::vector<float> slot_res = sys->dTInspectGroupReduce(fused_kernel, nOwnerSlots, nSphereSlots);
+    std::vector<float> res(slot_of.size());
+    for (size_t i = 0; i < slot_of.size(); i++) {
+        res[i] = slot_res[slot_of[i]];
+    }
+    return res;
+}
+
+std::shared_ptr<DEMAsyncResult> DEMInspectorGroup::GetValuesAsync() {
+    assertInit();
+    std::shared_ptr<DEMAsyncResult> res = sys->dTInspectGroupReduceAsync(fused_kernel, nOwnerSlots, nSphereSlots);
+    res->order = slot_of;
+    return res;
 }
 
 // =============================================================================
@@ -324,6 +554,68 @@ std::vector<float> DEMTracker::GetOriQ(size_t offset) {
     return {res.x, res.y, res.z, res.w};
 }
 
+std::vector<float> DEMTracker::getStates(OWNER_QUANTITY quantity, const std::vector<size_t>& offsets) {
+    std::vector<bodyID_t> ids(offsets.size());
+    for (size_t i = 0; i < offsets.size(); i++) {
+        if (offsets[i] >= obj->nSpanOwners) {
+            std::stringstream ss;
+            ss << "Offset " << offsets[i] << " is queried, but this tracker only tracks " << obj->nSpanOwners
+               << " owners." << std::endl;
+            throw std::runtime_error(ss.str());
+        }
+        ids[i] = obj->ownerID + offsets[i];
+    }
+    return sys->GetOwnerStates(quantity, ids);
+}
+std::vector<float> DEMTracker::getAllStates(OWNER_QUANTITY quantity,
+                                            const std::set<unsigned int>& families,
+                                            std::vector<size_t>* offsets) {
+    std::vector<bodyID_t> ids;
+    std::vector<float> res = sys->GetOwnerStates(quantity, obj->ownerID, obj->nSpanOwners, families, &ids);
+    if (offsets) {
+        offsets->resize(ids.size());
+        for (size_t i = 0; i < ids.size(); i++) {
+            (*offsets)[i] = ids[i] - obj->ownerID;
+        }
+    }
+    return res;
+}
+
+std::vector<float> DEMTracker::GetPos(const std::vector<size_t>& offsets) {
+    return getStates(OWNER_QUANTITY::POS, offsets);
+}
+std::vector<float> DEMTracker::GetVel(const std::vector<size_t>& offsets) {
+    return getStates(OWNER_QUANTITY::VEL, offsets);
+}
+std::vector<float> DEMTracker::GetAngVelLocal(const std::vector<size_t>& offsets) {
+    return getStates(OWNER_QUANTITY::ANG_VEL, offsets);
+}
+std::vector<float> DEMTracker::GetOriQ(const std::vector<size_t>& offsets) {
+    return getStates(OWNER_QUANTITY::ORI_Q, offsets);
+}
+
+std::vector<float> DEMTracker::GetAllPos(const std::set<unsigned int>& families, std::vector<size_t>* offsets) {
+    return getAllStates(OWNER_QUANTITY::POS, families, offsets);
+}
+std::vector<float> DEMTracker::GetAllVel(const std::set<unsigned int>& families, std::vector<size_t>* offsets) {
+    return getAllStates(OWNER_QUANTITY::VEL, families, offsets);
+}
+std::vector<float> DEMTracker::GetAllAngVelLocal(const std::set<unsigned int>& families,
+                                                 std::vector<size_t>* offsets) {
+    return getAllStates(OWNER_QUANTITY::ANG_VEL, families, offsets);
+}
+std::vector<float> DEMTracker::GetAllOriQ(const std::set<unsigned int>& families, std::vector<size_t>* offsets) {
+    return getAllStates(OWNER_QUANTITY::ORI_Q, families, offsets);
+}
+
+const float* DEMTracker::GetAllStatesDevice(OWNER_QUANTITY quantity) {
+    return sys->GetOwnerStatesDevice(quantity, obj->ownerID, obj->nSpanOwners);
+}
+
+std::shared_ptr<DEMAsyncResult> DEMTracker::GetAllStatesAsync(OWNER_QUANTITY quantity) {
+    return sys->GetOwnerStatesAsync(quantity, obj->ownerID, obj->nSpanOwners);
+}
+
 unsigned int DEMTracker::GetFamily(size_t offset) {
     return sys->GetOwnerFamily(obj->ownerID + offset);
 }
@@ -468,6 +760,17 @@ size_t DEMTracker::GetContactForcesAndLocalTorque(std::vector<std::vector<float>
     return nPairs;
 }
 
+size_t DEMTracker::GetAllContactForces(std::vector<size_t>& offsets,
+                                       std::vector<float3>& points,
+                                       std::vector<float3>& forces,
+                                       std::vector<float3>& torques,
+                                       bool torque_in_local) {
+    assertThereIsForcePairs("GetAllContactForces");
+    std::vector<bodyID_t> ownerIDs(obj->nSpanOwners);
+    std::iota(ownerIDs.begin(), ownerIDs.end(), obj->ownerID);
+    return sys->GetOwnersContactForces(ownerIDs, offsets, points, forces, torques, torque_in_local);
+}
+
 size_t DEMTracker::GetContactForcesAndGlobalTorque(std::vector<float3>& points,
                                                    std::vector<float3>& forces,
                                                    std::vector<float3>& torques,
@@ -582,6 +885,10 @@ void DEMTracker::UpdateMesh(const std::vector<std::vector<float>>& new_nodes) {
     }
     UpdateMesh(float3_nodes);
 }
+void DEMTracker::UpdateMesh(const float3* device_nodes, cudaStream_t stream) {
+    assertMesh("UpdateMesh");
+    sys->SetTriNodeRelPos(obj->ownerID, obj->geoID, device_nodes, true, stream);
+}
 
 // Deformation is per-node, yet UpdateTriNodeRelPos need per-triangle info.
 void DEMTracker::UpdateMeshByIncrement(const std::vector<float3>& deformation) {
@@ -597,6 +904,10 @@ void DEMTracker::UpdateMeshByIncrement(const std::vector<std::vector<float>>& de
     }
     UpdateMeshByIncrement(float3_nodes);
 }
+void DEMTracker::UpdateMeshByIncrement(const float3* device_deformation, cudaStream_t stream) {
+    assertMesh("UpdateMeshByIncrement");
+    sys->UpdateTriNodeRelPos(obj->ownerID, obj->geoID, device_deformation, true, stream);
+}
 
 std::shared_ptr<DEMMeshConnected>& DEMTracker::GetMesh() {
     assertMesh("GetMesh");
@@ -670,6 +981,7 @@ void DEMForceModel::SetForceModelType(FORCE_MODEL model_type) {
             m_force_model = HERTZIAN_FORCE_MODEL();
             // History-based model uses these history-related arrays
             m_contact_wildcards = {"delta_time", "delta_tan_x", "delta_tan_y", "delta_tan_z"};
+            m_antisymmetric_contact_wildcards = {"delta_tan_x", "delta_tan_y", "delta_tan_z"};
             break;
         case (FORCE_MODEL::HERTZIAN_FRICTIONLESS):
             m_must_have_mat_props = {"E", "nu", "CoR"};
@@ -677,6 +989,7 @@ void DEMForceModel::SetForceModelType(FORCE_MODEL model_type) {
             m_force_model = HERTZIAN_FORCE_MODEL_FRICTIONLESS();
             // No contact history needed for frictionless
             m_contact_wildcards.clear();
+            m_antisymmetric_contact_wildcards.clear();
             break;
         case (FORCE_MODEL::CUSTOM):
             m_must_have_mat_props.clear();
@@ -714,6 +1027,17 @@ void DEMForceModel::SetPerContactWildcards(const std::set<std::string>& wildcard
     m_contact_wildcards = wildcards;
 }
 
+void DEMForceModel::SetContactWildcardPrecision(const std::string& name,
+                                                WILDCARD_PRECISION precision,
+                                                float max_abs,
+                                                float max_error) {
+    DEMContactWildcardStorage storage;
+    storage.precision = precision;
+    storage.max_abs = max_abs;
+    storage.max_error = max_error;
+    m_contact_wildcard_storage[name] = storage;
+}
+
 void DEMForceModel::SetPerOwnerWildcards(const std::set<std::string>& wildcards) {
     for (const auto& a_str : wildcards) {
         if (match_pattern(a_str, " ")) {
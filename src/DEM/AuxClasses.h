@@ -6,14 +6,13 @@
 #ifndef DEME_INSPECTOR_HPP
 #define DEME_INSPECTOR_HPP
 
+#include <set>
 #include <unordered_map>
 #include <core/utils/JitHelper.h>
 #include <DEM/Defines.h>
 
-// Forward declare jitify::Program to avoid downstream dependency
-namespace jitify {
-class Program;
-}
+// Forward declare JitProgram to avoid downstream dependency
+class JitProgram;
 
 namespace deme {
 
@@ -22,9 +21,73 @@ class DEMDynamicThread;
 
 /// A class that the user can construct to inspect a certain property (such as void ratio, maximum Z coordinate...) of
 /// their simulation entites, in a given region.
+// The values of a query that is queued on the device without waiting for it. It runs on dT's stream behind the work
+// already queued there, so it sees the simulation state as of when it was made, and its values land in pinned host
+// memory when the device gets to it. A handle is usable as long as its solver is alive.
+class DEMAsyncResult {
+  private:
+    // Pinned host buffer, owned and eventually freed by dT
+    float* pinned = nullptr;
+    size_t capacity = 0;
+    size_t n = 0;
+    // If not empty, value i is pinned[order[i]]
+    std::vector<unsigned int> order;
+    cudaEvent_t done;
+    // dT sets this when it frees the buffer
+    bool released = false;
+
+    void assertAlive() const;
+
+  public:
+    friend class DEMDynamicThread;
+    friend class DEMInspectorGroup;
+
+    DEMAsyncResult() {}
+    ~DEMAsyncResult() {}
+
+    /// Whether the values have arrived, without waiting.
+    bool IsReady() const;
+    /// Wait until the values arrive.
+    void Wait() const;
+    /// Get all values (waits for them if needed).
+    std::vector<float> GetValues() const;
+    /// Get value i (waits for it if needed).
+    float GetValue(size_t i = 0) const;
+    size_t GetNumValues() const { return n; }
+};
+
+/// A view of a solver array in device memory, described the way a DLPack tensor or a __cuda_array_interface__ needs;
+/// no data is copied to make it. The solver is done with the array when the view is made, so a consumer on any stream
+/// can read it right away. The view is valid until the next simulation call (DoDynamics and the like, or a change to
+/// the system such as UpdateClumps), which may overwrite or move the array. A consumer that writes to a writable view
+/// must synchronize its stream before the next simulation call.
+struct DEMDeviceArrayView {
+    void* data = nullptr;
+    /// Element type, in DLPack type codes: 0 for int, 1 for uint, 2 for float
+    uint8_t type_code = 2;
+    uint8_t bits = 32;
+    /// Row-major and compact, so no strides are needed
+    std::vector<int64_t> shape;
+    /// The CUDA device the array is on
+    int device = 0;
+    /// If it is unified memory (DLPack device type kDLCUDAManaged) rather than plain device memory (kDLCUDA)
+    bool managed = true;
+    bool read_only = true;
+
+    /// DLPack device type
+    int GetDLDeviceType() const { return managed ? 13 : 2; }
+    /// The typestr of __cuda_array_interface__ (such as "<f4"). bfloat has none, so it is raw bytes ("<V2").
+    std::string GetTypeStr() const;
+    size_t GetNumElements() const;
+};
+
+class DEMInspectorGroup;
+
 class DEMInspector {
   private:
-    std::shared_ptr<jitify::Program> inspection_kernel;
+    std::shared_ptr<JitProgram> inspection_kernel;
+    // A group of just this inspector, made at the first GetValueAsync call
+    std::shared_ptr<DEMInspectorGroup> async_group;
 
     std::string inspection_code;
     std::string in_region_code;
@@ -44,12 +107,15 @@ class DEMInspector {
 
     // Based on user input...
     void switch_quantity_type(const std::string& quantity);
+    // The region test as it goes into a query kernel
+    std::string getInRegionSpecifier() const;
 
     void assertInit();
 
   public:
     friend class DEMSolver;
     friend class DEMDynamicThread;
+    friend class DEMInspectorGroup;
 
     DEMInspector(DEMSolver* sim_sys, DEMDynamicThread* dT_sys, const std::string& quantity) : sys(sim_sys), dT(dT_sys) {
         switch_quantity_type(quantity);
@@ -81,6 +147,54 @@ class DEMInspector {
 
     /// Get value directly within dT
     float* dT_GetValue();
+
+    /// @brief Queue the reduced value of the quantity on the device, without waiting for it.
+    /// @return A handle whose GetValue gives the value once it arrives.
+    std::shared_ptr<DEMAsyncResult> GetValueAsync();
+};
+
+// A group of inspectors that are evaluated together: all of them are computed in one pass over owners (and one over
+// spheres, if some of them inspect spheres), then reduced together, and their values come back in one transfer
+class DEMInspectorGroup {
+  private:
+    std::shared_ptr<JitProgram> fused_kernel;
+    // Owner inspectors first, then sphere inspectors; this is their slot order in the fused kernel
+    std::vector<std::shared_ptr<DEMInspector>> slot_inspectors;
+    // For each inspector as the user gave them, its slot
+    std::vector<unsigned int> slot_of;
+    unsigned int nOwnerSlots = 0;
+    unsigned int nSphereSlots = 0;
+
+    bool initialized = false;
+
+    // Its parent DEMSolver and dT system
+    DEMSolver* sys;
+    DEMDynamicThread* dT;
+
+    void assertInit();
+
+  public:
+    friend class DEMSolver;
+    friend class DEMDynamicThread;
+    friend class DEMInspector;
+
+    DEMInspectorGroup(DEMSolver* sim_sys,
+                      DEMDynamicThread* dT_sys,
+                      const std::vector<std::shared_ptr<DEMInspector>>& inspectors);
+    ~DEMInspectorGroup() {}
+
+    // Initialize with the DEM simulation system (user should not call this)
+    void Initialize(const std::unordered_map<std::string, std::string>& Subs, bool force = false);
+
+    /// Get the reduced values of all inspectors in this group, in the order they were given at creation.
+    std::vector<float> GetValues();
+
+    /// @brief Queue the evaluation of this group on the device, without waiting for it.
+    /// @return A handle whose GetValues gives the values once they arrive, in the order inspectors were given.
+    std::shared_ptr<DEMAsyncResult> GetValuesAsync();
+
+    /// Get the number of inspectors in this group.
+    size_t GetNumInspectors() const { return slot_of.size(); }
 };
 
 // A struct to get or set tracked owner entities, mainly for co-simulation
@@ -90,6 +204,10 @@ class DEMTracker {
     void assertGeoSize(size_t input_length, const std::string& func_name, const std::string& geo_type);
     void assertOwnerSize(size_t input_length, const std::string& name);
     void assertThereIsForcePairs(const std::string& name);
+    std::vector<float> getStates(OWNER_QUANTITY quantity, const std::vector<size_t>& offsets);
+    std::vector<float> getAllStates(OWNER_QUANTITY quantity,
+                                    const std::set<unsigned int>& families,
+                                    std::vector<size_t>* offsets);
     // Its parent DEMSolver system
     DEMSolver* sys;
 
@@ -122,6 +240,31 @@ class DEMTracker {
     /// @return A vector of 4 floats. The order is (x, y, z, w). If using Chrono naming convention, then it is (e1, e2,
     /// e3, e0).
     std::vector<float> GetOriQ(size_t offset = 0);
+    /// @brief Get the positions of many tracked owners at once, gathered on the device and copied in one go.
+    /// @param offsets The offsets of the owners to query.
+    /// @return 3 floats per owner, in the order of offsets.
+    std::vector<float> GetPos(const std::vector<size_t>& offsets);
+    std::vector<float> GetVel(const std::vector<size_t>& offsets);
+    std::vector<float> GetAngVelLocal(const std::vector<size_t>& offsets);
+    /// @return 4 floats per owner, in (x, y, z, w) order.
+    std::vector<float> GetOriQ(const std::vector<size_t>& offsets);
+    /// @brief Get the positions of all tracked owners at once.
+    /// @param families If not empty, only the owners that are in one of these families are queried.
+    /// @param offsets If given, the offsets of the queried owners are put in it.
+    /// @return 3 floats per owner.
+    std::vector<float> GetAllPos(const std::set<unsigned int>& families = {}, std::vector<size_t>* offsets = nullptr);
+    std::vector<float> GetAllVel(const std::set<unsigned int>& families = {}, std::vector<size_t>* offsets = nullptr);
+    std::vector<float> GetAllAngVelLocal(const std::set<unsigned int>& families = {},
+                                         std::vector<size_t>* offsets = nullptr);
+    /// @return 4 floats per owner, in (x, y, z, w) order.
+    std::vector<float> GetAllOriQ(const std::set<unsigned int>& families = {}, std::vector<size_t>* offsets = nullptr);
+    /// @brief Get one quantity of all tracked owners, left on the device for consumers that run on the GPU.
+    /// @return A device pointer to 3 floats per owner (4 for quaternions), valid until the next bulk owner state query
+    /// or the next simulation call.
+    const float* GetAllStatesDevice(OWNER_QUANTITY quantity);
+    /// @brief Queue a query of one quantity of all tracked owners on the device, without waiting for it.
+    /// @return A handle whose GetValues gives 3 floats per owner (4 for quaternions) once they arrive.
+    std::shared_ptr<DEMAsyncResult> GetAllStatesAsync(OWNER_QUANTITY quantity);
     /// @brief Get the family number of the tracked object.
     /// @param offset The offset of the entites to get family number out of.
     /// @return The family number.
@@ -210,6 +353,10 @@ class DEMTracker {
     /// nodes in the tracked mesh.
     void UpdateMesh(const std::vector<float3>& new_nodes);
     void UpdateMesh(const std::vector<std::vector<float>>& new_nodes);
+    /// @brief Apply the new mesh node positions, given per mesh node in a device buffer on dT's GPU, on a CUDA stream.
+    /// @details Same as UpdateMesh, without a round trip through the host; but the cached mesh is not updated. See the
+    /// device-buffer DEMSolver::SetTriNodeRelPos for details.
+    void UpdateMesh(const float3* device_nodes, cudaStream_t stream = 0);
     /// @brief Change the coordinates of each mesh node by the given amount.
     /// @details This affects triangle facets' relative positions wrt the mesh center (CoM) only; mesh's overall
     /// position/rotation in simulation is not affected. So if provided input is the mesh deformation with
@@ -220,6 +367,9 @@ class DEMTracker {
     /// nodes in the tracked mesh.
     void UpdateMeshByIncrement(const std::vector<float3>& deformation);
     void UpdateMeshByIncrement(const std::vector<std::vector<float>>& deformation);
+    /// @brief Change the coordinates of each mesh node by the amount given in a device buffer on dT's GPU, on a CUDA
+    /// stream. See UpdateMesh with a device buffer for details.
+    void UpdateMeshByIncrement(const float3* device_deformation, cudaStream_t stream = 0);
     /// @brief Get a handle for the mesh this tracker is tracking.
     /// @return Pointer to the mesh.
     std::shared_ptr<DEMMeshConnected>& GetMesh();
@@ -303,6 +453,19 @@ class DEMTracker {
                                           std::vector<std::vector<float>>& forces,
                                           std::vector<std::vector<float>>& torques,
                                           size_t offset = 0);
+
+    /// @brief Get all contact forces that concern all the entities this tracker tracks, in one go.
+    /// @details It is one query on the device (see DEMSolver::GetOwnersContactForces), so for a batch of clumps it is
+    /// much cheaper than GetContactForces for each offset.
+    /// @param offsets Filled with the number of tracked entities plus 1 numbers: the contacts of the entity at offset i
+    /// are from offsets[i] to offsets[i + 1] (not included) in points, forces and torques.
+    /// @param torque_in_local If true, the torques are in the local frame of each entity; or else, the global frame.
+    /// @return Number of force pairs.
+    size_t GetAllContactForces(std::vector<size_t>& offsets,
+                               std::vector<float3>& points,
+                               std::vector<float3>& forces,
+                               std::vector<float3>& torques,
+                               bool torque_in_local = false);
 };
 
 class DEMForceModel {
@@ -326,6 +489,10 @@ class DEMForceModel {
     // Quatity names that we want to associate each owner with. An array will be allocated for storing this, and it
     // lives and die with its associated geometry representation (most typically a sphere).
     std::set<std::string> m_geo_wildcards;
+    // Contact wildcards that are not stored as plain floats
+    std::unordered_map<std::string, DEMContactWildcardStorage> m_contact_wildcard_storage;
+    // Contact wildcards that change sign when the two geometries of the contact are swapped
+    std::set<std::string> m_antisymmetric_contact_wildcards;
 
   public:
     friend class DEMSolver;
@@ -354,6 +521,27 @@ class DEMForceModel {
     /// initial value of all contact wildcard arrays is automatically 0.
     //// TODO: Maybe allow non-0 initialization?
     void SetPerContactWildcards(const std::set<std::string>& wildcards);
+    /// @brief Mark the contact wildcards that change sign when the two geometries of a contact are swapped, such as
+    /// the components of a tangential displacement vector. When sphere reordering (see SetSphereReorderFreq) has to
+    /// swap the two spheres of a contact, these are negated, along with the contact force.
+    /// @param wildcards Names of those contact wildcards. They must be among the contact wildcards.
+    void SetAntisymmetricContactWildcards(const std::set<std::string>& wildcards) {
+        m_antisymmetric_contact_wildcards = wildcards;
+    }
+    /// @brief Store a contact wildcard in 16 bits instead of as a float, to halve its memory and bandwidth use. It is
+    /// converted to float in the force kernel, so the force model code does not change.
+    /// @details FP16 keeps 11 significant bits up to a magnitude of 65504; BF16 keeps 8 bits but the range of float;
+    /// SCALED_INT16 has the uniform resolution max_abs / 32767 on [-max_abs, max_abs]. Values are saturated at the end
+    /// of the range. The solver checks the declared range at initialization, and if max_error is given, that the
+    /// storage error in that range is no larger than it.
+    /// @param name Name of the contact wildcard.
+    /// @param precision The storage precision.
+    /// @param max_abs The max magnitude this wildcard takes. Needed for FP16 and SCALED_INT16.
+    /// @param max_error The max acceptable absolute storage error. 0 means no requirement.
+    void SetContactWildcardPrecision(const std::string& name,
+                                     WILDCARD_PRECISION precision,
+                                     float max_abs = 0.f,
+                                     float max_error = 0.f);
     /// Set the names for the extra quantities that will be associated with each owner. For example, you can use this to
     /// associate a cohesion parameter to each particle. Only float is supported.
     void SetPerOwnerWildcards(const std::set<std::string>& wildcards);
@@ -256,6 +256,14 @@ class DEMMeshConnected : public DEMInitializer {
     // Position in the m_meshes array
     unsigned int cache_offset = 0;
 
+    // If this mesh is an instance of another mesh (see DEMSolver::AddMeshInstance), that mesh. Instances share their
+    // facet nodes on the device with it.
+    std::shared_ptr<DEMMeshConnected> instance_of;
+    // If this mesh shares its facet nodes with other meshes, and so cannot be deformed
+    bool shares_facets = false;
+    // Where the nodes of this mesh's facets start in the device-side node arrays
+    size_t node_offset = 0;
+
     std::vector<float3> m_vertices;
     std::vector<float3> m_normals;
     std::vector<float3> m_UV;
@@ -317,6 +325,9 @@ class DEMMeshConnected : public DEMInitializer {
     // normals derived from right-hand-rule are the same as the normals in the mesh file
     bool use_mesh_normals = false;
 
+    // If true, this mesh's facets find their contacts with spheres through a BVH, instead of being put into bins
+    bool use_bvh = false;
+
     DEMMeshConnected() { obj_type = OWNER_TYPE::MESH; }
     DEMMeshConnected(std::string input_file) {
         LoadWavefrontMesh(input_file);
@@ -348,6 +359,11 @@ class DEMMeshConnected : public DEMInitializer {
     /// the normals derived from right-hand-rule are the same as the normals in the mesh file
     void UseNormals(bool use = true) { use_mesh_normals = use; }
 
+    /// Instruct that this mesh's contacts with spheres are detected by querying a BVH built over its facets, instead of
+    /// registering its facets into the bins. This is usually faster for large meshes with many small facets, or meshes
+    /// whose facets cover many bins each. The BVH is built in the mesh's own frame so rigid motions only need a refit.
+    void UseBVHContactDetection(bool use = true) { use_bvh = use; }
+
     /// Access the n-th triangle in mesh
     DEMTriangle GetTriangle(size_t index) const {  // No need to wrap (for Shlok)
         return DEMTriangle(m_vertices[m_face_v_indices[index].x], m_vertices[m_face_v_indices[index].y],
@@ -25,6 +25,12 @@ namespace deme {
 // It is better to keep DEME_NUM_SPHERES_PER_CD_BATCH == DEME_KT_CD_NTHREADS_PER_BLOCK for better performance
 #define DEME_NUM_SPHERES_PER_CD_BATCH 512    ///< Can't be larger than DEME_KT_CD_NTHREADS_PER_BLOCK
 #define DEME_NUM_TRIANGLES_PER_CD_BATCH 256  ///< Can't be larger than DEME_KT_CD_NTHREADS_PER_BLOCK
+// Bins with more spheres than this are swept by several blocks, each taking a pair of DEME_NUM_SPHERES_PER_CD_BATCH-sized
+// sphere tiles. Should be a multiple of DEME_NUM_SPHERES_PER_CD_BATCH.
+#define DEME_MAX_SPHERES_PER_BIN_SINGLE_BLOCK DEME_NUM_SPHERES_PER_CD_BATCH
+// Histograms of the bin occupancy profiler have this many buckets: bucket 0 counts bins with none, bucket k counts bins
+// with [2^(k-1), 2^k), and the last bucket also takes all larger counts
+#define DEME_BIN_PROFILE_NUM_BUCKETS 18
 #define DEME_TINY_FLOAT 1e-12
 #define DEME_HUGE_FLOAT 1e15
 #define DEME_BITS_PER_BYTE 8
@@ -33,6 +39,15 @@ namespace deme {
 // In bin--triangle intersection scan, all bins are enlarged by a factor of this following constant, so that no triangle
 // lies in between bins and not picked up by any bins.
 #define DEME_BIN_ENLARGE_RATIO_FOR_FACETS 0.001
+// Max depth of the traversal stack when spheres query the BVHs of meshes. Karras-style LBVHs over 64-bit keys are not
+// deeper than this.
+#define DEME_TRI_BVH_STACK_SIZE 96
+// With bin-local CD coordinates, the single-precision distance pre-check is relaxed by this fraction of the bin size
+// (plus the radii), to cover the round-off of float offsets
+#define DEME_CD_BIN_LOCAL_TOLERANCE 1e-5f
+// Contacts are grouped into these many classes in a type-sorted contact array: non-contacts, sphere--sphere,
+// sphere--mesh and sphere--analytical, in that order
+#define DEME_NUM_CONTACT_CLASSES 4
 
 // A few pre-computed constants
 constexpr double TWO_OVER_THREE = 0.666666666666667;
@@ -51,7 +66,17 @@ constexpr int64_t MAX_SUBVOXEL = (int64_t)1 << VOXEL_RES_POWER2;
 
 #define DEME_NUM_TRIANGLE_PER_BLOCK 512
 #define DEME_MAX_THREADS_PER_BLOCK 1024
+// Number of timed launches for each candidate launch configuration, when the launch configurations are autotuned
+#define DEME_AUTOTUNE_NUM_REPS 5
 #define DEME_INIT_CNT_MULTIPLIER 2
+// Contact arrays sized for the loaded contacts (of clump batches or a checkpoint) get this much room for more contacts
+#define DEME_LOADED_CNT_HEADROOM 1.2
+// When the contact arrays (and kT-to-dT contact buffers) outgrow their size, they grow by at least this factor
+#define DEME_CNT_ARRAY_GROWTH 1.5
+// Under a memory budget, the initial contact arrays of one thread use no more than this share of the remaining budget
+#define DEME_MEM_BUDGET_CNT_SHARE 0.25
+// Under a memory budget, the solver favors larger bins if the memory use is above this fraction of the budget
+#define DEME_MEM_BUDGET_PRESSURE 0.9
 // If there are more than this number of analytical geometry, we may have difficulty jitify them all
 #define DEME_THRESHOLD_TOO_MANY_ANAL_GEO 64
 // If a clump has more than this number of sphere components, it is automatically considered a non-jitifiable big clump
@@ -116,6 +141,12 @@ constexpr unsigned int THRESHOLD_CANT_JITIFY_ALL_COMP =
     DEME_MIN(DEME_MIN(RESERVED_CLUMP_COMPONENT_OFFSET, DEME_THRESHOLD_BIG_CLUMP), DEME_THRESHOLD_TOO_MANY_SPHERE_COMP);
 // Max size change the bin auto-adjust algorithm can apply to the bin size per step
 constexpr float BIN_SIZE_MAX_CHANGE_RATE = 0.2;
+// While an owner sleeps, the high bits of its quiet step count are flags. TOUCHED: an awake owner is in contact with it
+// in this step. CHECK: it was touched in the last step, so in this step all its contacts are resolved (even those with
+// other sleepers), and its net acceleration tells whether it wakes up.
+constexpr unsigned int SLEEP_TOUCHED_FLAG = 1u << 31;
+constexpr unsigned int SLEEP_CHECK_FLAG = 1u << 30;
+constexpr unsigned int SLEEP_COUNT_MASK = SLEEP_CHECK_FLAG - 1;
 
 // Some enums...
 // Verbosity
@@ -155,6 +186,24 @@ enum OUTPUT_CONTENT {
 };
 // Output particles as individual (component) spheres, or as owner clumps (clump CoMs for location, as an example)?
 enum class SPATIAL_DIR { X, Y, Z, NONE };
+// Owner quantities that can be queried in bulk. ANG_VEL is in the owner's local frame; ORI_Q is (x, y, z, w).
+enum class OWNER_QUANTITY { POS, VEL, ANG_VEL, ORI_Q };
+// dT arrays that can be viewed in device memory. The owner ones (VEL, ANG_VEL in the local frame, ACC and ANG_ACC of
+// the last step, and FAMILY) are per owner, and the vector ones are stored by component; the rest are per contact.
+enum class DEVICE_ARRAY {
+    VEL,
+    ANG_VEL,
+    ACC,
+    ANG_ACC,
+    FAMILY,
+    CONTACT_ID_A,
+    CONTACT_ID_B,
+    CONTACT_TYPE,
+    CONTACT_FORCE,
+    CONTACT_TORQUE,
+    CONTACT_POINT_A,
+    CONTACT_POINT_B
+};
 // The info that should be present in the contact pair output files
 enum CNT_OUTPUT_CONTENT {
     CNT_TYPE = 0,    // Owner numbers and contact type
@@ -168,6 +217,21 @@ enum CNT_OUTPUT_CONTENT {
     GEO_ID = 128,
     NICKNAME = 256
 };
+// Storage precision of a contact wildcard. The 16-bit ones take half of a 32-bit contact wildcard array element each.
+enum class WILDCARD_PRECISION { FP32, FP16, BF16, SCALED_INT16 };
+// How a contact wildcard is stored: the precision and the declared range that the user asked for, and where the solver
+// put it in the contact wildcard arrays
+struct DEMContactWildcardStorage {
+    WILDCARD_PRECISION precision = WILDCARD_PRECISION::FP32;
+    // The max magnitude the wildcard is declared to take, and the max storage error acceptable (0 if not given)
+    float max_abs = 0.f;
+    float max_error = 0.f;
+    // The contact wildcard array it is in, and for 16-bit precisions, which half (0 or 1) of the elements
+    unsigned int slot = 0;
+    unsigned int half = 0;
+    // If it changes sign when the two geometries of the contact are swapped
+    bool antisymmetric = false;
+};
 
 // =============================================================================
 // NOW DEFINING SOME GPU-SIDE DATA STRUCTURES
@@ -200,6 +264,8 @@ struct DEMSimParams {
     // Number of clumps, spheres, triangles, mesh-represented objects, analytical components, external objs...
     bodyID_t nSpheresGM;
     bodyID_t nTriGM;
+    // Number of facets whose nodes are stored (instances of a mesh share them)
+    bodyID_t nTriNodeGM;
     objID_t nAnalGM;
     bodyID_t nOwnerBodies;
     bodyID_t nOwnerClumps;
@@ -227,6 +293,26 @@ struct DEMSimParams {
     float h;
     // Time elappsed since start of simulation
     double timeElapsed = 0;
+    // Number of dT steps taken since start of simulation. With multi-rate stepping, it tells which families step now.
+    uint64_t nStepsElapsed = 0;
+    // Whether some families step less often than every dT step (see familyStepRatio)
+    bool useFamilyStepRatio = false;
+    // Owners whose velocity, angular velocity and acceleration stay below these thresholds for sleepNumSteps steps in a
+    // row fall asleep, if sleeping is enabled
+    bool useSleeping = false;
+    float sleepLinVelThres;
+    float sleepAngVelThres;
+    float sleepAccThres;
+    unsigned int sleepNumSteps;
+    // If the step size is adapted on the device, it is limited by the max owner velocity and/or acceleration, so no
+    // owner travels more than adaptTSSafety times adaptTSLength in a step. The result is clamped to
+    // [adaptTSMin, adaptTSMax].
+    bool adaptTSByVel = false;
+    bool adaptTSByAcc = false;
+    float adaptTSSafety;
+    float adaptTSLength;
+    float adaptTSMin;
+    float adaptTSMax;
     // Sphere radii/geometry thickness inflation amount (for safer contact detection)
     float beta;
     // Max velocity, user approximated, we verify during simulation
@@ -245,10 +331,14 @@ struct DEMSimParams {
 
     // The max vel at which the solver errors out
     float errOutVel = DEME_HUGE_FLOAT;
-    // The max num of spheres per bin before solver errors out
+    // The max num of spheres per bin that the bin size adaptation steers clear of (dense bins no longer error out)
     unsigned int errOutBinSphNum = 32768;
     // The max num of triangles per bin before solver errors out
     unsigned int errOutBinTriNum = 32768;
+    // Spheres larger than this are not binned but go to the coarse level of the bin hierarchy
+    float coarseSphereRadius = DEME_HUGE_FLOAT;
+    // Whether the simulation is 2D (in the XZ plane), in which case there is only one layer of bins in Y
+    bool twoDimensional = false;
 };
 
 // A struct that holds pointers to data arrays that dT uses
@@ -266,18 +356,24 @@ struct DEMDataDT {
     subVoxelPos_t* locY;
     subVoxelPos_t* locZ;
 
-    oriQ_t* oriQw;
-    oriQ_t* oriQx;
-    oriQ_t* oriQy;
-    oriQ_t* oriQz;
-
-    float* vX;
-    float* vY;
-    float* vZ;
-
-    float* omgBarX;
-    float* omgBarY;
-    float* omgBarZ;
+    oriQStore_t* oriQw;
+    oriQStore_t* oriQx;
+    oriQStore_t* oriQy;
+    oriQStore_t* oriQz;
+
+    velStore_t* vX;
+    velStore_t* vY;
+    velStore_t* vZ;
+    // Magnitude of each owner's velocity, written by the integration kernel if the fused velocity pass is in use
+    float* ownerAbsVel;
+    // Number of steps in a row that each owner has been quiet, for the sleep mechanism
+    unsigned int* ownerQuietSteps;
+    // Max owner velocity and acceleration magnitudes in this step, for adapting the step size on the device
+    float* adaptTSGauge;
+
+    velStore_t* omgBarX;
+    velStore_t* omgBarY;
+    velStore_t* omgBarZ;
 
     float* aX;
     float* aY;
@@ -299,6 +395,8 @@ struct DEMDataDT {
     notStupidBool_t* familyMasks;
     // Extra margin size
     float* familyExtraMarginSize;
+    // Each family is integrated once every this many dT steps
+    unsigned int* familyStepRatio;
 
     // Some dT's own work array pointers
     float3* contactForces;
@@ -314,6 +412,8 @@ struct DEMDataDT {
     clumpComponentOffsetExt_t* clumpComponentOffsetExt;
     materialsOffset_t* sphereMaterialOffset;
     bodyID_t* ownerMesh;
+    // Where the nodes of a facet are in relPosNode*
+    bodyID_t* triNodeOffset;
     float3* relPosNode1;
     float3* relPosNode2;
     float3* relPosNode3;
@@ -325,6 +425,14 @@ struct DEMDataDT {
     bodyID_t* idGeometryB_buffer;
     contact_t* contactType_buffer;
     contactPairs_t* contactMapping_buffer;
+    // In a delta-encoded update, the first nNewContacts_buffer entries of the buffers above are the contacts new to
+    // this update, and this buffer says where they go in the contact array. Otherwise nNewContacts_buffer equals
+    // nContactPairs_buffer and the buffers hold the entire contact array.
+    size_t nNewContacts_buffer = 0;
+    contactPairs_t* newContactIdx_buffer = NULL;
+    // Where each contact class starts in the (type-sorted) contact array, and the total number of contacts
+    size_t contactClassOffsets_buffer[DEME_NUM_CONTACT_CLASSES + 1] = {0};
+    size_t contactClassOffsets[DEME_NUM_CONTACT_CLASSES + 1] = {0};
 
     // pointer to remote buffer where kinematic thread stores work-order data provided by the dynamic thread
     unsigned int* pKTOwnedBuffer_maxDrift = NULL;
@@ -334,10 +442,10 @@ struct DEMDataDT {
     subVoxelPos_t* pKTOwnedBuffer_locX = NULL;
     subVoxelPos_t* pKTOwnedBuffer_locY = NULL;
     subVoxelPos_t* pKTOwnedBuffer_locZ = NULL;
-    oriQ_t* pKTOwnedBuffer_oriQ0 = NULL;
-    oriQ_t* pKTOwnedBuffer_oriQ1 = NULL;
-    oriQ_t* pKTOwnedBuffer_oriQ2 = NULL;
-    oriQ_t* pKTOwnedBuffer_oriQ3 = NULL;
+    oriQStore_t* pKTOwnedBuffer_oriQ0 = NULL;
+    oriQStore_t* pKTOwnedBuffer_oriQ1 = NULL;
+    oriQStore_t* pKTOwnedBuffer_oriQ2 = NULL;
+    oriQStore_t* pKTOwnedBuffer_oriQ3 = NULL;
     family_t* pKTOwnedBuffer_familyID = NULL;
     float3* pKTOwnedBuffer_relPosNode1 = NULL;
     float3* pKTOwnedBuffer_relPosNode2 = NULL;
@@ -376,10 +484,10 @@ struct DEMDataKT {
     subVoxelPos_t* locX;
     subVoxelPos_t* locY;
     subVoxelPos_t* locZ;
-    oriQ_t* oriQw;
-    oriQ_t* oriQx;
-    oriQ_t* oriQy;
-    oriQ_t* oriQz;
+    oriQStore_t* oriQw;
+    oriQStore_t* oriQx;
+    oriQStore_t* oriQy;
+    oriQStore_t* oriQz;
     // Derived from absv which is for determining contact margin size.
     float* marginSize;
 
@@ -394,10 +502,10 @@ struct DEMDataKT {
     subVoxelPos_t* locX_buffer;
     subVoxelPos_t* locY_buffer;
     subVoxelPos_t* locZ_buffer;
-    oriQ_t* oriQ0_buffer;
-    oriQ_t* oriQ1_buffer;
-    oriQ_t* oriQ2_buffer;
-    oriQ_t* oriQ3_buffer;
+    oriQStore_t* oriQ0_buffer;
+    oriQStore_t* oriQ1_buffer;
+    oriQStore_t* oriQ2_buffer;
+    oriQStore_t* oriQ3_buffer;
     float* absVel_buffer;
     family_t* familyID_buffer;
 
@@ -411,9 +519,13 @@ struct DEMDataKT {
     clumpComponentOffset_t* clumpComponentOffset;
     clumpComponentOffsetExt_t* clumpComponentOffsetExt;
     bodyID_t* ownerMesh;
+    // Where the nodes of a facet are in relPosNode*
+    bodyID_t* triNodeOffset;
     float3* relPosNode1;
     float3* relPosNode2;
     float3* relPosNode3;
+    // If this facet is in a BVH, rather than binned
+    notStupidBool_t* triInBVH;
     // For mesh deformation
     float3* relPosNode1_buffer;
     float3* relPosNode2_buffer;
@@ -439,6 +551,10 @@ struct DEMDataKT {
     bodyID_t* previous_idGeometryB;
     contact_t* previous_contactType;
     contactPairs_t* contactMapping;
+    // Number of contacts shipped to dT in this update: all of them, or only the new ones in a delta-encoded update
+    size_t nNewContacts = 0;
+    // Where each contact class starts in the contact array, found if the contacts are sorted by type
+    size_t contactClassOffsets[DEME_NUM_CONTACT_CLASSES + 1] = {0};
 
     // data pointers that is kT's transfer destination
     size_t* pDTOwnedBuffer_nContactPairs = NULL;
@@ -446,6 +562,9 @@ struct DEMDataKT {
     bodyID_t* pDTOwnedBuffer_idGeometryB = NULL;
     contact_t* pDTOwnedBuffer_contactType = NULL;
     contactPairs_t* pDTOwnedBuffer_contactMapping = NULL;
+    size_t* pDTOwnedBuffer_nNewContacts = NULL;
+    contactPairs_t* pDTOwnedBuffer_newContactIdx = NULL;
+    size_t* pDTOwnedBuffer_contactClassOffsets = NULL;
 
     // The collection of pointers to DEM template arrays such as radiiSphere, still useful when there are template info
     // not directly jitified into the kernels
@@ -469,6 +588,16 @@ const float AN_EXAMPLE_MAX_VEL_FOR_SHOWING_MARGIN_SIZE = 1.f;
 const unsigned int NUM_STEPS_RESERVED_AFTER_CHANGING_BIN_SIZE = 5;
 // Drift tweak step size
 const unsigned int FUTURE_DRIFT_TWEAK_STEP_SIZE = 1;
+// Fixed spheres are binned into the fixed-family bin cache with this multiple of their margin, so the cache outlives
+// the small margin changes from one update to the next
+const float FIXED_BIN_CACHE_MARGIN_MULTIPLE = 2.f;
+// Which spheres the sphere binning kernels work on: all of them, or (with the fixed-family bin cache) only those not
+// in fixed families, or only those in fixed families, for building the cache
+const unsigned int BIN_ALL_SPHERES = 0;
+const unsigned int BIN_NON_FIXED_SPHERES = 1;
+const unsigned int BIN_FIXED_SPHERES = 2;
+// kT keeps the records of this many most recent bin size changes, for the performance report
+const unsigned int MAX_BIN_SIZE_HISTORY_RECORDS = 1000;
 // After purging update freq history, this many dT steps are not included in the performance gauging.
 const unsigned int NUM_STEPS_RESERVED_AFTER_RENEWING_FREQ_TUNER = 10;
 // Default target simulation `world' size.
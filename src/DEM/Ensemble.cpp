@@ -0,0 +1,271 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <DEM/Ensemble.h>
+
+namespace deme {
+
+DEMEnsemble::DEMEnsemble(DEMSolver& sim,
+                         unsigned int num_systems,
+                         const float3& system_size,
+                         float gap,
+                         unsigned int first_family)
+    : m_sys(&sim), m_num_systems(num_systems), m_system_size(system_size), m_gap(gap), m_first_family(first_family) {
+    if (sim.GetInitStatus()) {
+        DEME_ERROR("An ensemble must be laid out before the solver is initialized.");
+    }
+    if (num_systems == 0) {
+        DEME_ERROR("An ensemble needs at least 1 system.");
+    }
+    if (system_size.x <= 0. || system_size.y <= 0. || system_size.z <= 0. || gap < 0.) {
+        DEME_ERROR("The ensemble's system size (%.6g, %.6g, %.6g) must be positive and its gap (%.6g) non-negative.",
+                   system_size.x, system_size.y, system_size.z, gap);
+    }
+    // The last family number is reserved for fixed entities
+    if ((size_t)first_family + num_systems > RESERVED_FAMILY_NUM) {
+        DEME_ERROR("An ensemble of %u systems starting from family %u needs family numbers up to %u, but they must be "
+                   "smaller than %u.",
+                   num_systems, first_family, first_family + num_systems - 1, RESERVED_FAMILY_NUM);
+    }
+    // A near-square grid of cells in X--Y; one layer in Z so each system keeps its own floor
+    m_num_cols = (unsigned int)std::ceil(std::sqrt((double)num_systems));
+    unsigned int num_rows = (num_systems + m_num_cols - 1) / m_num_cols;
+    float3 domain_size = host_make_float3(m_num_cols * system_size.x + (m_num_cols + 1) * gap,
+                                          num_rows * system_size.y + (num_rows + 1) * gap, system_size.z + 2. * gap);
+    m_domain_min = -domain_size / 2.;
+    sim.InstructBoxDomainDimension({m_domain_min.x, -m_domain_min.x}, {m_domain_min.y, -m_domain_min.y},
+                                   {m_domain_min.z, -m_domain_min.z});
+    m_systems.resize(num_systems);
+    // Systems do not interact, even if some clumps escape their cells
+    for (unsigned int i = 0; i < num_systems; i++) {
+        for (unsigned int j = i + 1; j < num_systems; j++) {
+            sim.DisableContactBetweenFamilies(first_family + i, first_family + j);
+        }
+    }
+}
+
+void DEMEnsemble::assertSystem(unsigned int system, const std::string& func_name) const {
+    if (system >= m_num_systems) {
+        DEME_ERROR("%s is called with system %u, but the ensemble has %u systems.", func_name.c_str(), system,
+                   m_num_systems);
+    }
+}
+
+std::pair<float3, float3> DEMEnsemble::getSystemCell(unsigned int system) const {
+    unsigned int col = system % m_num_cols;
+    unsigned int row = system / m_num_cols;
+    float3 cell_min = m_domain_min + host_make_float3(m_gap + col * (m_system_size.x + m_gap),
+                                                      m_gap + row * (m_system_size.y + m_gap), m_gap);
+    return std::make_pair(cell_min, cell_min + m_system_size);
+}
+
+float3 DEMEnsemble::GetSystemOffset(unsigned int system) const {
+    assertSystem(system, "GetSystemOffset");
+    auto cell = getSystemCell(system);
+    return (cell.first + cell.second) / 2.;
+}
+
+unsigned int DEMEnsemble::GetSystemFamily(unsigned int system) const {
+    assertSystem(system, "GetSystemFamily");
+    return m_first_family + system;
+}
+
+unsigned int DEMEnsemble::LocateSystem(const float3& pos) const {
+    float3 rel = pos - m_domain_min - make_float3(m_gap);
+    float3 pitch = m_system_size + make_float3(m_gap);
+    if (rel.x < 0. || rel.y < 0. || rel.z < 0. || rel.z > m_system_size.z) {
+        return m_num_systems;
+    }
+    unsigned int col = (unsigned int)(rel.x / pitch.x);
+    unsigned int row = (unsigned int)(rel.y / pitch.y);
+    // In the gap after a cell
+    if (rel.x - col * pitch.x > m_system_size.x || rel.y - row * pitch.y > m_system_size.y || col >= m_num_cols) {
+        return m_num_systems;
+    }
+    unsigned int system = row * m_num_cols + col;
+    return (system < m_num_systems) ? system : m_num_systems;
+}
+
+std::string DEMEnsemble::getRegionCode(unsigned int system) const {
+    auto cell = getSystemCell(system);
+    char region[512];
+    snprintf(region, sizeof(region),
+             "return (X >= %.9g && X <= %.9g && Y >= %.9g && Y <= %.9g && Z >= %.9g && Z <= %.9g);", cell.first.x,
+             cell.second.x, cell.first.y, cell.second.y, cell.first.z, cell.second.z);
+    return std::string(region);
+}
+
+std::shared_ptr<DEMClumpBatch> DEMEnsemble::AddClumps(
+    unsigned int system,
+    const std::vector<std::shared_ptr<DEMClumpTemplate>>& input_types,
+    const std::vector<float3>& input_xyz) {
+    assertSystem(system, "AddClumps");
+    if (input_types.size() != input_xyz.size()) {
+        DEME_ERROR("AddClumps is given %zu clump types but %zu positions.", input_types.size(), input_xyz.size());
+    }
+    float3 offset = GetSystemOffset(system);
+    float3 half_size = m_system_size / 2.;
+    std::vector<float3> global_xyz(input_xyz.size());
+    for (size_t i = 0; i < input_xyz.size(); i++) {
+        // The whole clump, not only its CoM, has to be in the cell, or it may touch a neighbor system
+        float reach = 0.;
+        for (unsigned int j = 0; j < input_types[i]->nComp; j++) {
+            reach = std::max(reach, length(input_types[i]->relPos[j]) + input_types[i]->radii[j]);
+        }
+        const float3& p = input_xyz[i];
+        if (std::abs(p.x) + reach > half_size.x || std::abs(p.y) + reach > half_size.y ||
+            std::abs(p.z) + reach > half_size.z) {
+            DEME_ERROR("Clump %zu given to AddClumps of system %u, at local position (%.6g, %.6g, %.6g), is not fully "
+                       "inside the system's cell.",
+                       i, system, p.x, p.y, p.z);
+        }
+        global_xyz[i] = p + offset;
+    }
+    auto batch = m_sys->AddClumps(input_types, global_xyz);
+    batch->SetFamily(m_first_family + system);
+    m_systems[system].clump_trackers.push_back(m_sys->Track(batch));
+    m_systems[system].trackers.push_back(m_systems[system].clump_trackers.back());
+    m_systems[system].num_clumps += input_xyz.size();
+    return batch;
+}
+
+std::shared_ptr<DEMMeshConnected> DEMEnsemble::addMesh(unsigned int system, std::shared_ptr<DEMMeshConnected> mesh) {
+    m_meshes.push_back(std::make_pair(mesh, system));
+    m_systems[system].trackers.push_back(m_sys->Track(mesh));
+    return mesh;
+}
+
+std::shared_ptr<DEMMeshConnected> DEMEnsemble::AddWavefrontMeshObject(unsigned int system,
+                                                                      const std::string& filename,
+                                                                      const std::shared_ptr<DEMMaterial>& mat,
+                                                                      bool load_normals,
+                                                                      bool load_uv) {
+    assertSystem(system, "AddWavefrontMeshObject");
+    auto mesh = m_sys->AddWavefrontMeshObject(filename, mat, load_normals, load_uv);
+    mesh->SetInitPos(GetSystemOffset(system));
+    return addMesh(system, mesh);
+}
+
+std::shared_ptr<DEMMeshConnected> DEMEnsemble::AddMeshInstance(unsigned int system,
+                                                               const std::shared_ptr<DEMMeshConnected>& mesh) {
+    assertSystem(system, "AddMeshInstance");
+    auto it = std::find_if(m_meshes.begin(), m_meshes.end(),
+                           [&mesh](const std::pair<std::shared_ptr<DEMMeshConnected>, unsigned int>& rec) {
+                               return rec.first == mesh;
+                           });
+    if (it == m_meshes.end()) {
+        DEME_ERROR("AddMeshInstance of an ensemble needs a mesh that is added via this ensemble.");
+    }
+    auto instance = m_sys->AddMeshInstance(mesh);
+    instance->SetInitPos(mesh->init_pos - GetSystemOffset(it->second) + GetSystemOffset(system));
+    return addMesh(system, instance);
+}
+
+std::shared_ptr<DEMMeshConnected> DEMEnsemble::AddBoxWalls(unsigned int system,
+                                                           const std::shared_ptr<DEMMaterial>& mat,
+                                                           bool open_top) {
+    assertSystem(system, "AddBoxWalls");
+    for (const auto& wall : m_walls) {
+        if (wall.mat == mat && wall.open_top == open_top) {
+            return AddMeshInstance(system, wall.mesh);
+        }
+    }
+
+    // The 8 corners of the cell, corner i being at the + side in X if bit 0 of i is set, Y if bit 1, Z if bit 2
+    DEMMeshConnected box;
+    float3 h = m_system_size / 2.;
+    for (unsigned int i = 0; i < 8; i++) {
+        box.m_vertices.push_back(host_make_float3((i & 1) ? h.x : -h.x, (i & 2) ? h.y : -h.y, (i & 4) ? h.z : -h.z));
+    }
+    // 2 triangles per face, with right-hand-rule normals that point into the cell; the last face is the top
+    const int faces[12][3] = {{0, 1, 3}, {0, 3, 2},   // -Z
+                              {0, 2, 6}, {0, 6, 4},   // -X
+                              {1, 7, 3}, {1, 5, 7},   // +X
+                              {0, 4, 5}, {0, 5, 1},   // -Y
+                              {2, 3, 7}, {2, 7, 6},   // +Y
+                              {4, 7, 5}, {4, 6, 7}};  // +Z
+    const unsigned int nFaces = open_top ? 10 : 12;
+    for (unsigned int i = 0; i < nFaces; i++) {
+        int3 tri;
+        tri.x = faces[i][0];
+        tri.y = faces[i][1];
+        tri.z = faces[i][2];
+        box.m_face_v_indices.push_back(tri);
+    }
+    box.nTri = box.m_face_v_indices.size();
+    box.SetMaterial(mat);
+
+    auto mesh = m_sys->AddWavefrontMeshObject(box);
+    mesh->SetInitPos(GetSystemOffset(system));
+    addMesh(system, mesh);
+    m_walls.push_back(WallRecord{mesh, mat, open_top});
+    return mesh;
+}
+
+std::vector<std::shared_ptr<DEMTracker>> DEMEnsemble::GetSystemTrackers(unsigned int system) const {
+    assertSystem(system, "GetSystemTrackers");
+    return m_systems[system].trackers;
+}
+
+size_t DEMEnsemble::GetNumClumps(unsigned int system) const {
+    assertSystem(system, "GetNumClumps");
+    return m_systems[system].num_clumps;
+}
+
+std::vector<float> DEMEnsemble::GetClumpPositions(unsigned int system) {
+    assertSystem(system, "GetClumpPositions");
+    float3 offset = GetSystemOffset(system);
+    std::vector<float> xyz;
+    xyz.reserve(m_systems[system].num_clumps * 3);
+    for (auto& tracker : m_systems[system].clump_trackers) {
+        std::vector<float> batch_xyz = tracker->GetAllPos();
+        for (size_t i = 0; i + 2 < batch_xyz.size(); i += 3) {
+            xyz.push_back(batch_xyz[i] - offset.x);
+            xyz.push_back(batch_xyz[i + 1] - offset.y);
+            xyz.push_back(batch_xyz[i + 2] - offset.z);
+        }
+    }
+    return xyz;
+}
+
+std::vector<float> DEMEnsemble::GetClumpVelocities(unsigned int system) {
+    assertSystem(system, "GetClumpVelocities");
+    std::vector<float> vel;
+    vel.reserve(m_systems[system].num_clumps * 3);
+    for (auto& tracker : m_systems[system].clump_trackers) {
+        std::vector<float> batch_vel = tracker->GetAllVel();
+        vel.insert(vel.end(), batch_vel.begin(), batch_vel.end());
+    }
+    return vel;
+}
+
+std::shared_ptr<DEMInspector> DEMEnsemble::CreateInspector(unsigned int system, const std::string& quantity) {
+    assertSystem(system, "CreateInspector");
+    return m_sys->CreateInspector(quantity, getRegionCode(system));
+}
+
+void DEMEnsemble::WriteClumpFile(unsigned int system, const std::string& outfilename, unsigned int accuracy) {
+    assertSystem(system, "WriteClumpFile");
+    if (!m_systems[system].out_region) {
+        m_systems[system].out_region = m_sys->CreateOutputRegion(getRegionCode(system));
+    }
+    m_sys->SetOutputRegion(m_systems[system].out_region);
+    m_sys->WriteClumpFile(outfilename, accuracy);
+}
+
+void DEMEnsemble::WriteSphereFile(unsigned int system, const std::string& outfilename) {
+    assertSystem(system, "WriteSphereFile");
+    if (!m_systems[system].out_region) {
+        m_systems[system].out_region = m_sys->CreateOutputRegion(getRegionCode(system));
+    }
+    m_sys->SetOutputRegion(m_systems[system].out_region);
+    m_sys->WriteSphereFile(outfilename);
+}
+
+}  // namespace deme
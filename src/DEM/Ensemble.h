@@ -0,0 +1,143 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DEME_ENSEMBLE_H
+#define DEME_ENSEMBLE_H
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <DEM/API.h>
+
+namespace deme {
+
+/// Many small, independent simulations run as one. Each system gets its own cell of the solver's domain, and is built
+/// in a local frame whose origin is its cell center, through this class. All systems then share one solver: its
+/// arrays, jitified kernels and worker threads, and one bin grid; so a batch of small calibration tests keeps the GPU
+/// busy and pays the initialization cost once.
+///
+/// The clumps of each system are in a family of their own, and contacts between the families of different systems are
+/// disabled, so clumps of different systems never interact, even if they leave their cells. To keep the clumps in, each
+/// system is to be bounded by its own walls (AddBoxWalls, or meshes), because analytical boundaries (BC planes and
+/// InstructBoxDomainBoundingBC) extend through all systems. The cells are gap apart, and the gap should be larger than
+/// twice the largest sphere radius plus the contact margins, so that no clump touches the walls of another system.
+/// Materials are per-object as usual, so each system can use its own. Solver-wide settings such as the time step and
+/// the gravity are shared; systems that need different ones need solvers of their own.
+class DEMEnsemble {
+  public:
+    /// @brief Lay out num_systems cells of size system_size on a grid in the X--Y plane, gap apart, and size the
+    /// solver's domain to fit them.
+    /// @param sim The solver. It must not be initialized yet.
+    /// @param first_family The clumps of system i are in family first_family + i. Pick it so that these families do
+    /// not collide with the other families in use.
+    DEMEnsemble(DEMSolver& sim,
+                unsigned int num_systems,
+                const float3& system_size,
+                float gap,
+                unsigned int first_family = 0);
+    ~DEMEnsemble() {}
+
+    unsigned int GetNumSystems() const { return m_num_systems; }
+    float3 GetSystemSize() const { return m_system_size; }
+    /// The global position of the origin of a system's local frame (the center of its cell)
+    float3 GetSystemOffset(unsigned int system) const;
+    /// The system whose cell contains a global position, or GetNumSystems() if it is in no cell
+    unsigned int LocateSystem(const float3& pos) const;
+    /// The family of the clumps of a system. It can be used to prescribe the motion of a system's clumps.
+    unsigned int GetSystemFamily(unsigned int system) const;
+
+    /// @brief Add clumps to a system. They are put in the system's family. If they are moved to another family later,
+    /// contacts between it and the families of the other systems are to be disabled too.
+    /// @param input_xyz Positions of the clumps, in the system's local frame. They must be inside its cell.
+    std::shared_ptr<DEMClumpBatch> AddClumps(unsigned int system,
+                                             const std::vector<std::shared_ptr<DEMClumpTemplate>>& input_types,
+                                             const std::vector<float3>& input_xyz);
+    std::shared_ptr<DEMClumpBatch> AddClumps(unsigned int system,
+                                             const std::shared_ptr<DEMClumpTemplate>& input_type,
+                                             const std::vector<float3>& input_xyz) {
+        return AddClumps(system, std::vector<std::shared_ptr<DEMClumpTemplate>>(input_xyz.size(), input_type),
+                         input_xyz);
+    }
+    /// Add a mesh to a system, with its frame at the origin of the system's local frame. To place it elsewhere, Move
+    /// it, or give SetInitPos GetSystemOffset(system) plus the local position.
+    std::shared_ptr<DEMMeshConnected> AddWavefrontMeshObject(unsigned int system,
+                                                             const std::string& filename,
+                                                             const std::shared_ptr<DEMMaterial>& mat,
+                                                             bool load_normals = true,
+                                                             bool load_uv = false);
+    /// Add an instance of a mesh of this ensemble to a system, at the same place in that system as the mesh is in its
+    /// own. See DEMSolver::AddMeshInstance.
+    std::shared_ptr<DEMMeshConnected> AddMeshInstance(unsigned int system,
+                                                      const std::shared_ptr<DEMMeshConnected>& mesh);
+    /// @brief Enclose a system with fixed mesh walls on the boundary of its cell, facing inward.
+    /// @details Walls of the same material and openness share their facets (see DEMSolver::AddMeshInstance).
+    /// @param open_top If true, there is no wall at the top (+Z) of the cell, and clumps can fly out of it.
+    std::shared_ptr<DEMMeshConnected> AddBoxWalls(unsigned int system,
+                                                  const std::shared_ptr<DEMMaterial>& mat,
+                                                  bool open_top = false);
+
+    /// @brief Trackers of the clump batches and meshes added to a system, in the order they were added.
+    std::vector<std::shared_ptr<DEMTracker>> GetSystemTrackers(unsigned int system) const;
+    /// Number of clumps added to a system
+    size_t GetNumClumps(unsigned int system) const;
+    /// @brief Get the positions of all clumps of a system, in its local frame.
+    /// @return 3 floats per clump, in the order they were added.
+    std::vector<float> GetClumpPositions(unsigned int system);
+    /// @brief Get the velocities of all clumps of a system.
+    /// @return 3 floats per clump, in the order they were added.
+    std::vector<float> GetClumpVelocities(unsigned int system);
+
+    /// @brief Create an inspector that only considers the entities in a system's cell.
+    /// @details Each such inspector is jitified on its own, so make the ones needed before the solver is initialized,
+    /// and reuse them. For plain positions and velocities, GetClumpPositions and GetClumpVelocities need no JIT.
+    std::shared_ptr<DEMInspector> CreateInspector(unsigned int system, const std::string& quantity = "clump_max_z");
+
+    /// @brief Write the clumps of a system to a file, with global coordinates.
+    /// @details This sets the solver's output region to this system's cell, and leaves it there. The region of each
+    /// system is made once, at the first output of that system.
+    void WriteClumpFile(unsigned int system, const std::string& outfilename, unsigned int accuracy = 10);
+    /// Write the spheres of a system to a file, with global coordinates. See WriteClumpFile.
+    void WriteSphereFile(unsigned int system, const std::string& outfilename);
+
+  private:
+    struct SystemRecord {
+        std::vector<std::shared_ptr<DEMTracker>> clump_trackers;
+        std::vector<std::shared_ptr<DEMTracker>> trackers;
+        size_t num_clumps = 0;
+        std::shared_ptr<DEMInspector> out_region;
+    };
+
+    void assertSystem(unsigned int system, const std::string& func_name) const;
+    // The cell of a system, in global coordinates
+    std::pair<float3, float3> getSystemCell(unsigned int system) const;
+    // The region code of a system's cell, as used by inspectors
+    std::string getRegionCode(unsigned int system) const;
+    std::shared_ptr<DEMMeshConnected> addMesh(unsigned int system, std::shared_ptr<DEMMeshConnected> mesh);
+
+    DEMSolver* m_sys;
+    unsigned int m_num_systems;
+    float3 m_system_size;
+    float m_gap;
+    unsigned int m_first_family;
+    // Cells per row (along X); rows go along Y
+    unsigned int m_num_cols;
+    float3 m_domain_min;
+    std::vector<SystemRecord> m_systems;
+    // Meshes added via this ensemble, and their systems
+    std::vector<std::pair<std::shared_ptr<DEMMeshConnected>, unsigned int>> m_meshes;
+    // Walls made by AddBoxWalls, and what they were made with: instances of them serve other systems
+    struct WallRecord {
+        std::shared_ptr<DEMMeshConnected> mesh;
+        std::shared_ptr<DEMMaterial> mat;
+        bool open_top;
+    };
+    std::vector<WallRecord> m_walls;
+};
+
+}  // namespace deme
+
+#endif
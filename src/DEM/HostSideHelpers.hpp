@@ -165,9 +165,11 @@ inline size_t hostCalcBinNum(binID_t& nbX,
                              double m_binSize,
                              unsigned char nvXp2,
                              unsigned char nvYp2,
-                             unsigned char nvZp2) {
+                             unsigned char nvZp2,
+                             bool two_dimensional = false) {
     nbX = (binID_t)(m_voxelSize * (double)((size_t)1 << nvXp2) / m_binSize) + 1;
-    nbY = (binID_t)(m_voxelSize * (double)((size_t)1 << nvYp2) / m_binSize) + 1;
+    // A 2D (XZ-plane) simulation needs only one layer of bins
+    nbY = two_dimensional ? 1 : (binID_t)(m_voxelSize * (double)((size_t)1 << nvYp2) / m_binSize) + 1;
     nbZ = (binID_t)(m_voxelSize * (double)((size_t)1 << nvZp2) / m_binSize) + 1;
     return (size_t)nbX * (size_t)nbY * (size_t)nbZ;
 }
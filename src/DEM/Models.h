@@ -50,6 +50,15 @@ inline std::string FORCE_REDUCTION_RIGHT_AFTER_CALC_STRAT() {
     return read_file_to_string(sourcefile);
 }
 
+inline std::string FORCE_REDUCTION_RIGHT_AFTER_CALC_WARP_AGG_STRAT() {
+    std::filesystem::path sourcefile =
+        RuntimeDataHelper::data_path / "kernel" / "DEMCustomizablePolicies" / "ForceInKernelReductionStratWarpAgg.cu";
+    if (!std::filesystem::exists(sourcefile)) {
+        DEME_ERROR("A strategy file %s is not found.", sourcefile.string().c_str());
+    }
+    return read_file_to_string(sourcefile);
+}
+
 inline std::string FORCE_INFO_WRITE_BACK_STRAT() {
     std::filesystem::path sourcefile =
         RuntimeDataHelper::data_path / "kernel" / "DEMCustomizablePolicies" / "ContactInfoWriteBack.cu";
@@ -256,7 +265,7 @@ inline void equip_force_model_ingr_acq(std::string& definition,
                                        std::string& acquisition_B,
                                        std::unordered_map<std::string, bool>& added_ingredients) {
     if (added_ingredients["ts"]) {
-        definition += "float ts = simParams->h;\n";
+        definition += "float ts = simParams->h * cntStepMultiple;\n";
     }
     if (added_ingredients["time"]) {
         definition += "float time = simParams->timeElapsed;\n";
@@ -359,18 +368,44 @@ inline void equip_geo_wildcards(std::string& definition,
     }
 }
 
-// Massage contact wildcards (by that I mean those contact history arrays)
+// Massage contact wildcards (by that I mean those contact history arrays). storage is aligned with names, and says
+// which array (and half of it, if the wildcard is 16-bit) each is in.
 inline void equip_contact_wildcards(std::string& acquisition,
                                     std::string& write_back,
                                     std::string& destroy_record,
-                                    const std::set<std::string>& names) {
+                                    const std::set<std::string>& names,
+                                    const std::vector<DEMContactWildcardStorage>& storage) {
     unsigned int i = 0;
     for (const auto& name : names) {
-        // Rigth now, supports float arrays only...
-        // Getting it from global mem
-        acquisition += "float " + name + " = granData->contactWildcards[" + std::to_string(i) + "][myContactID];\n";
-        // Write it back to global mem
-        write_back += "granData->contactWildcards[" + std::to_string(i) + "][myContactID] = " + name + ";\n";
+        const DEMContactWildcardStorage& store = storage.at(i);
+        const std::string word = "granData->contactWildcards[" + std::to_string(store.slot) + "][myContactID]";
+        const std::string half = std::to_string(store.half);
+        // 9 digits get the same float back
+        const std::string scale = "(float)(" + to_string_with_precision(store.max_abs / 32767.f, 9) + ")";
+        // Getting it from global mem, and write it back to global mem; 16-bit ones are converted to float and back
+        switch (store.precision) {
+            case WILDCARD_PRECISION::FP16:
+                acquisition += "float " + name + " = deme::fp16BitsToFloat(deme::unpackWildcardHalf(" + word + ", " +
+                               half + "));\n";
+                write_back += word + " = deme::packWildcardHalf(" + word + ", " + half + ", deme::floatToFP16Bits(" +
+                              name + "));\n";
+                break;
+            case WILDCARD_PRECISION::BF16:
+                acquisition += "float " + name + " = deme::bf16BitsToFloat(deme::unpackWildcardHalf(" + word + ", " +
+                               half + "));\n";
+                write_back += word + " = deme::packWildcardHalf(" + word + ", " + half + ", deme::floatToBF16Bits(" +
+                              name + "));\n";
+                break;
+            case WILDCARD_PRECISION::SCALED_INT16:
+                acquisition += "float " + name + " = deme::scaledInt16BitsToFloat(deme::unpackWildcardHalf(" + word +
+                               ", " + half + "), " + scale + ");\n";
+                write_back += word + " = deme::packWildcardHalf(" + word + ", " + half +
+                              ", deme::floatToScaledInt16Bits(" + name + ", " + scale + "));\n";
+                break;
+            default:
+                acquisition += "float " + name + " = " + word + ";\n";
+                write_back += word + " = " + name + ";\n";
+        }
         // Destroy it (set to 0) if it is a fake contact
         destroy_record += name + " = 0;\n";
         i++;
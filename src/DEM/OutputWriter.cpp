@@ -0,0 +1,1052 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#include <algorithm>
+#include <cmath>
+
+#include <DEM/OutputWriter.h>
+#include <DEM/Structs.h>
+#include <DEM/HostSideHelpers.hpp>
+#include <DEM/utils/BinaryIO.hpp>
+#include <DEM/utils/CsvFormat.hpp>
+#include <DEM/utils/VtkXmlIO.hpp>
+
+namespace deme {
+
+// =============================================================================
+// Snapshot-based file writers
+// =============================================================================
+
+void DEMOutputSnapshot::writeSpheresAsCsv(std::ofstream& ptFile) const {
+    DEMCsvBuffer header;
+    unsigned int num_fields = 4;
+    header.Put(OUTPUT_FILE_X_COL_NAME);
+    header.Field(OUTPUT_FILE_Y_COL_NAME);
+    header.Field(OUTPUT_FILE_Z_COL_NAME);
+    header.Field(OUTPUT_FILE_R_COL_NAME);
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ABSV) {
+        header.Field("absv");
+        num_fields += 1;
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::VEL) {
+        header.Field(OUTPUT_FILE_VEL_X_COL_NAME);
+        header.Field(OUTPUT_FILE_VEL_Y_COL_NAME);
+        header.Field(OUTPUT_FILE_VEL_Z_COL_NAME);
+        num_fields += 3;
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL) {
+        header.Field(OUTPUT_FILE_ANGVEL_X_COL_NAME);
+        header.Field(OUTPUT_FILE_ANGVEL_Y_COL_NAME);
+        header.Field(OUTPUT_FILE_ANGVEL_Z_COL_NAME);
+        num_fields += 3;
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC) {
+        header.Field("abs_acc");
+        num_fields += 1;
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ACC) {
+        header.Field("a_x,a_y,a_z");
+        num_fields += 3;
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC) {
+        header.Field("alpha_x,alpha_y,alpha_z");
+        num_fields += 3;
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY) {
+        header.Field("family");
+        num_fields += 1;
+    }
+    // if (solverFlags.outputFlags & OUTPUT_CONTENT::MAT) {
+    //     header.Field("material");
+    // }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD) {
+        for (const auto& name : m_owner_wildcard_names) {
+            header.Field(name);
+        }
+        num_fields += m_owner_wildcard_names.size();
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::GEO_WILDCARD) {
+        for (const auto& name : m_geo_wildcard_names) {
+            header.Field(name);
+        }
+        num_fields += m_geo_wildcard_names.size();
+    }
+    header.EndRow();
+    ptFile << header.Str();
+
+    // Spheres are written in the user-facing order, even if they are re-ordered in memory
+    writeCsvRows(ptFile, simParams->nSpheresGM, num_fields, 6, [&](DEMCsvBuffer& out, size_t n) {
+        size_t i = getSphereImplID(n);
+        auto this_owner = ownerClumpBody.at(i);
+        family_t this_family = familyID.at(this_owner);
+        // If this (impl-level) family is in the no-output list, skip it
+        if (std::binary_search(familiesNoOutput.begin(), familiesNoOutput.end(), this_family)) {
+            return;
+        }
+
+        float3 CoM;
+        float3 pos;
+        float X, Y, Z;
+        voxelID_t voxel = voxelID.at(this_owner);
+        subVoxelPos_t subVoxX = locX.at(this_owner);
+        subVoxelPos_t subVoxY = locY.at(this_owner);
+        subVoxelPos_t subVoxZ = locZ.at(this_owner);
+        hostVoxelIDToPosition<float, voxelID_t, subVoxelPos_t>(X, Y, Z, voxel, subVoxX, subVoxY, subVoxZ,
+                                                               simParams->nvXp2, simParams->nvYp2, simParams->voxelSize,
+                                                               simParams->l);
+        CoM.x = X + simParams->LBFX;
+        CoM.y = Y + simParams->LBFY;
+        CoM.z = Z + simParams->LBFZ;
+
+        size_t compOffset = (solverFlags.useClumpJitify) ? clumpComponentOffsetExt.at(i) : i;
+        float3 this_sp_deviation;
+        this_sp_deviation.x = relPosSphereX.at(compOffset);
+        this_sp_deviation.y = relPosSphereY.at(compOffset);
+        this_sp_deviation.z = relPosSphereZ.at(compOffset);
+        hostApplyOriQToVector3<float, float>(this_sp_deviation.x, this_sp_deviation.y, this_sp_deviation.z,
+                                             oriQw.at(this_owner), oriQx.at(this_owner), oriQy.at(this_owner),
+                                             oriQz.at(this_owner));
+        pos = CoM + this_sp_deviation;
+        out.Put(pos.x);
+        out.Field(pos.y);
+        out.Field(pos.z);
+        out.Field(radiiSphere.at(compOffset));
+
+        // Only linear velocity
+        float3 vxyz, acc;
+        vxyz.x = vX.at(this_owner);
+        vxyz.y = vY.at(this_owner);
+        vxyz.z = vZ.at(this_owner);
+        acc.x = aX.at(this_owner);
+        acc.y = aY.at(this_owner);
+        acc.z = aZ.at(this_owner);
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ABSV) {
+            out.Field(length(vxyz));
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::VEL) {
+            out.Field(vxyz.x);
+            out.Field(vxyz.y);
+            out.Field(vxyz.z);
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL) {
+            out.Field((float)omgBarX.at(this_owner));
+            out.Field((float)omgBarY.at(this_owner));
+            out.Field((float)omgBarZ.at(this_owner));
+        }
+
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC) {
+            out.Field(length(acc));
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ACC) {
+            out.Field(acc.x);
+            out.Field(acc.y);
+            out.Field(acc.z);
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC) {
+            out.Field(alphaX.at(this_owner));
+            out.Field(alphaY.at(this_owner));
+            out.Field(alphaZ.at(this_owner));
+        }
+
+        // Family number needs to be user number
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY) {
+            out.Field((unsigned int)this_family);
+        }
+
+        // Wildcards
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD) {
+            // The order shouldn't be an issue... the same set is being processed here and in equip_owner_wildcards, see
+            // Model.h
+            for (unsigned int j = 0; j < m_owner_wildcard_names.size(); j++) {
+                out.Field(ownerWildcards[j][this_owner]);
+            }
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::GEO_WILDCARD) {
+            for (unsigned int j = 0; j < m_geo_wildcard_names.size(); j++) {
+                out.Field(sphereWildcards[j][i]);
+            }
+        }
+
+        out.EndRow();
+    });
+}
+
+void DEMOutputSnapshot::writeClumpsAsCsv(std::ofstream& ptFile, unsigned int accuracy) const {
+    // xyz and quaternion are always there
+    DEMCsvBuffer header;
+    unsigned int num_fields = 8;
+    header.Put(OUTPUT_FILE_X_COL_NAME);
+    header.Field(OUTPUT_FILE_Y_COL_NAME);
+    header.Field(OUTPUT_FILE_Z_COL_NAME);
+    header.Field("Qw,Qx,Qy,Qz");
+    header.Field(OUTPUT_FILE_CLUMP_TYPE_NAME);
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ABSV) {
+        header.Field("absv");
+        num_fields += 1;
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::VEL) {
+        header.Field(OUTPUT_FILE_VEL_X_COL_NAME);
+        header.Field(OUTPUT_FILE_VEL_Y_COL_NAME);
+        header.Field(OUTPUT_FILE_VEL_Z_COL_NAME);
+        num_fields += 3;
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL) {
+        header.Field(OUTPUT_FILE_ANGVEL_X_COL_NAME);
+        header.Field(OUTPUT_FILE_ANGVEL_Y_COL_NAME);
+        header.Field(OUTPUT_FILE_ANGVEL_Z_COL_NAME);
+        num_fields += 3;
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC) {
+        header.Field("abs_acc");
+        num_fields += 1;
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ACC) {
+        header.Field("a_x,a_y,a_z");
+        num_fields += 3;
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC) {
+        header.Field("alpha_x,alpha_y,alpha_z");
+        num_fields += 3;
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY) {
+        header.Field("family");
+        num_fields += 1;
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD) {
+        for (const auto& name : m_owner_wildcard_names) {
+            header.Field(name);
+        }
+        num_fields += m_owner_wildcard_names.size();
+    }
+    header.EndRow();
+    ptFile << header.Str();
+
+    writeCsvRows(ptFile, simParams->nOwnerBodies, num_fields, accuracy, [&](DEMCsvBuffer& out, size_t i) {
+        // i is this owner's number. And if it is not a clump, we can move on.
+        if (ownerTypes.at(i) != OWNER_T_CLUMP)
+            return;
+
+        family_t this_family = familyID.at(i);
+        // If this (impl-level) family is in the no-output list, skip it
+        if (std::binary_search(familiesNoOutput.begin(), familiesNoOutput.end(), this_family)) {
+            return;
+        }
+
+        float3 CoM;
+        float X, Y, Z;
+        voxelID_t voxel = voxelID.at(i);
+        subVoxelPos_t subVoxX = locX.at(i);
+        subVoxelPos_t subVoxY = locY.at(i);
+        subVoxelPos_t subVoxZ = locZ.at(i);
+        hostVoxelIDToPosition<float, voxelID_t, subVoxelPos_t>(X, Y, Z, voxel, subVoxX, subVoxY, subVoxZ,
+                                                               simParams->nvXp2, simParams->nvYp2, simParams->voxelSize,
+                                                               simParams->l);
+        CoM.x = X + simParams->LBFX;
+        CoM.y = Y + simParams->LBFY;
+        CoM.z = Z + simParams->LBFZ;
+        // Output position
+        out.Put(CoM.x);
+        out.Field(CoM.y);
+        out.Field(CoM.z);
+
+        // Then quaternions
+        out.Field((float)oriQw.at(i));
+        out.Field((float)oriQx.at(i));
+        out.Field((float)oriQy.at(i));
+        out.Field((float)oriQz.at(i));
+
+        // Then type of clump
+        unsigned int clump_mark = inertiaPropOffsets.at(i);
+        out.Field(templateNumNameMap.at(clump_mark));
+
+        // Only linear velocity
+        float3 vxyz, acc;
+        vxyz.x = vX.at(i);
+        vxyz.y = vY.at(i);
+        vxyz.z = vZ.at(i);
+        acc.x = aX.at(i);
+        acc.y = aY.at(i);
+        acc.z = aZ.at(i);
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ABSV) {
+            out.Field(length(vxyz));
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::VEL) {
+            out.Field(vxyz.x);
+            out.Field(vxyz.y);
+            out.Field(vxyz.z);
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL) {
+            out.Field((float)omgBarX.at(i));
+            out.Field((float)omgBarY.at(i));
+            out.Field((float)omgBarZ.at(i));
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC) {
+            out.Field(length(acc));
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ACC) {
+            out.Field(acc.x);
+            out.Field(acc.y);
+            out.Field(acc.z);
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC) {
+            out.Field(alphaX.at(i));
+            out.Field(alphaY.at(i));
+            out.Field(alphaZ.at(i));
+        }
+
+        // Family number needs to be user number
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY) {
+            out.Field((unsigned int)this_family);
+        }
+
+        // Wildcards
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD) {
+            // The order shouldn't be an issue... the same set is being processed here and in equip_owner_wildcards, see
+            // Model.h
+            for (unsigned int j = 0; j < m_owner_wildcard_names.size(); j++) {
+                out.Field(ownerWildcards[j][i]);
+            }
+        }
+
+        out.EndRow();
+    });
+}
+
+// The XYZ columns of a sphere or clump table become the points of a .vtp file, and the other columns point data
+static void writeTableAsVtp(std::ofstream& ptFile, const DEMBinaryTable& table) {
+    const std::vector<float> X = table.GetFloatColumn(OUTPUT_FILE_X_COL_NAME);
+    const std::vector<float> Y = table.GetFloatColumn(OUTPUT_FILE_Y_COL_NAME);
+    const std::vector<float> Z = table.GetFloatColumn(OUTPUT_FILE_Z_COL_NAME);
+    const size_t n = X.size();
+    std::vector<float> xyz(3 * n);
+    // Each point is a vertex cell, so it shows up in the default representation
+    std::vector<int64_t> verts(n);
+    std::vector<int64_t> offsets(n);
+    for (size_t i = 0; i < n; i++) {
+        xyz[3 * i] = X[i];
+        xyz[3 * i + 1] = Y[i];
+        xyz[3 * i + 2] = Z[i];
+        verts[i] = i;
+        offsets[i] = i + 1;
+    }
+    DEMVtkXmlFile vtp(VTK_XML_TYPE::POLY_DATA);
+    vtp.SetPoints(xyz.data(), n);
+    vtp.SetCells(verts.data(), n, offsets.data(), n);
+    vtp.AddPointDataFromTable(table, {OUTPUT_FILE_X_COL_NAME, OUTPUT_FILE_Y_COL_NAME, OUTPUT_FILE_Z_COL_NAME});
+    vtp.Write(ptFile);
+}
+
+void DEMOutputSnapshot::fillSpheresTable(DEMBinaryTable& table) const {
+    std::vector<unsigned int> pos_cols = {table.AddColumn(OUTPUT_FILE_X_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                                          table.AddColumn(OUTPUT_FILE_Y_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                                          table.AddColumn(OUTPUT_FILE_Z_COL_NAME, BINARY_COL_TYPE::FLOAT32)};
+    unsigned int r_col = table.AddColumn(OUTPUT_FILE_R_COL_NAME, BINARY_COL_TYPE::FLOAT32);
+    unsigned int absv_col = 0, abs_acc_col = 0, family_col = 0;
+    std::vector<unsigned int> vel_cols, ang_vel_cols, acc_cols, ang_acc_cols, owner_w_cols, geo_w_cols;
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ABSV) {
+        absv_col = table.AddColumn("absv", BINARY_COL_TYPE::FLOAT32);
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::VEL) {
+        vel_cols = {table.AddColumn(OUTPUT_FILE_VEL_X_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                    table.AddColumn(OUTPUT_FILE_VEL_Y_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                    table.AddColumn(OUTPUT_FILE_VEL_Z_COL_NAME, BINARY_COL_TYPE::FLOAT32)};
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL) {
+        ang_vel_cols = {table.AddColumn(OUTPUT_FILE_ANGVEL_X_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                        table.AddColumn(OUTPUT_FILE_ANGVEL_Y_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                        table.AddColumn(OUTPUT_FILE_ANGVEL_Z_COL_NAME, BINARY_COL_TYPE::FLOAT32)};
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC) {
+        abs_acc_col = table.AddColumn("abs_acc", BINARY_COL_TYPE::FLOAT32);
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ACC) {
+        acc_cols = {table.AddColumn("a_x", BINARY_COL_TYPE::FLOAT32), table.AddColumn("a_y", BINARY_COL_TYPE::FLOAT32),
+                    table.AddColumn("a_z", BINARY_COL_TYPE::FLOAT32)};
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC) {
+        ang_acc_cols = {table.AddColumn("alpha_x", BINARY_COL_TYPE::FLOAT32),
+                        table.AddColumn("alpha_y", BINARY_COL_TYPE::FLOAT32),
+                        table.AddColumn("alpha_z", BINARY_COL_TYPE::FLOAT32)};
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY) {
+        family_col = table.AddColumn("family", BINARY_COL_TYPE::UINT8);
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD) {
+        for (const auto& name : m_owner_wildcard_names) {
+            owner_w_cols.push_back(table.AddColumn(name, BINARY_COL_TYPE::FLOAT32));
+        }
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::GEO_WILDCARD) {
+        for (const auto& name : m_geo_wildcard_names) {
+            geo_w_cols.push_back(table.AddColumn(name, BINARY_COL_TYPE::FLOAT32));
+        }
+    }
+    for (auto& col : table.columns) {
+        col.Reserve(simParams->nSpheresGM);
+    }
+
+    // Spheres are written in the user-facing order, even if they are re-ordered in memory
+    for (size_t n = 0; n < simParams->nSpheresGM; n++) {
+        size_t i = getSphereImplID(n);
+        auto this_owner = ownerClumpBody.at(i);
+        family_t this_family = familyID.at(this_owner);
+        // If this (impl-level) family is in the no-output list, skip it
+        if (std::binary_search(familiesNoOutput.begin(), familiesNoOutput.end(), this_family)) {
+            continue;
+        }
+
+        float3 CoM;
+        float X, Y, Z;
+        voxelID_t voxel = voxelID.at(this_owner);
+        subVoxelPos_t subVoxX = locX.at(this_owner);
+        subVoxelPos_t subVoxY = locY.at(this_owner);
+        subVoxelPos_t subVoxZ = locZ.at(this_owner);
+        hostVoxelIDToPosition<float, voxelID_t, subVoxelPos_t>(X, Y, Z, voxel, subVoxX, subVoxY, subVoxZ,
+                                                               simParams->nvXp2, simParams->nvYp2, simParams->voxelSize,
+                                                               simParams->l);
+        CoM.x = X + simParams->LBFX;
+        CoM.y = Y + simParams->LBFY;
+        CoM.z = Z + simParams->LBFZ;
+
+        size_t compOffset = (solverFlags.useClumpJitify) ? clumpComponentOffsetExt.at(i) : i;
+        float3 this_sp_deviation;
+        this_sp_deviation.x = relPosSphereX.at(compOffset);
+        this_sp_deviation.y = relPosSphereY.at(compOffset);
+        this_sp_deviation.z = relPosSphereZ.at(compOffset);
+        hostApplyOriQToVector3<float, float>(this_sp_deviation.x, this_sp_deviation.y, this_sp_deviation.z,
+                                             oriQw.at(this_owner), oriQx.at(this_owner), oriQy.at(this_owner),
+                                             oriQz.at(this_owner));
+        float3 pos = CoM + this_sp_deviation;
+        table.Col(pos_cols[0]).Push<float>(pos.x);
+        table.Col(pos_cols[1]).Push<float>(pos.y);
+        table.Col(pos_cols[2]).Push<float>(pos.z);
+        table.Col(r_col).Push<float>(radiiSphere.at(compOffset));
+
+        float3 vxyz, acc;
+        vxyz.x = vX.at(this_owner);
+        vxyz.y = vY.at(this_owner);
+        vxyz.z = vZ.at(this_owner);
+        acc.x = aX.at(this_owner);
+        acc.y = aY.at(this_owner);
+        acc.z = aZ.at(this_owner);
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ABSV) {
+            table.Col(absv_col).Push<float>(length(vxyz));
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::VEL) {
+            table.Col(vel_cols[0]).Push<float>(vxyz.x);
+            table.Col(vel_cols[1]).Push<float>(vxyz.y);
+            table.Col(vel_cols[2]).Push<float>(vxyz.z);
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL) {
+            table.Col(ang_vel_cols[0]).Push<float>(omgBarX.at(this_owner));
+            table.Col(ang_vel_cols[1]).Push<float>(omgBarY.at(this_owner));
+            table.Col(ang_vel_cols[2]).Push<float>(omgBarZ.at(this_owner));
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC) {
+            table.Col(abs_acc_col).Push<float>(length(acc));
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ACC) {
+            table.Col(acc_cols[0]).Push<float>(acc.x);
+            table.Col(acc_cols[1]).Push<float>(acc.y);
+            table.Col(acc_cols[2]).Push<float>(acc.z);
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC) {
+            table.Col(ang_acc_cols[0]).Push<float>(alphaX.at(this_owner));
+            table.Col(ang_acc_cols[1]).Push<float>(alphaY.at(this_owner));
+            table.Col(ang_acc_cols[2]).Push<float>(alphaZ.at(this_owner));
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY) {
+            table.Col(family_col).Push<uint8_t>(this_family);
+        }
+        for (unsigned int j = 0; j < owner_w_cols.size(); j++) {
+            table.Col(owner_w_cols[j]).Push<float>(ownerWildcards[j][this_owner]);
+        }
+        for (unsigned int j = 0; j < geo_w_cols.size(); j++) {
+            table.Col(geo_w_cols[j]).Push<float>(sphereWildcards[j][i]);
+        }
+    }
+}
+
+void DEMOutputSnapshot::writeSpheresAsBinary(std::ofstream& ptFile) const {
+    DEMBinaryTable table;
+    fillSpheresTable(table);
+    table.Write(ptFile);
+}
+
+void DEMOutputSnapshot::writeSpheresAsVtp(std::ofstream& ptFile) const {
+    DEMBinaryTable table;
+    fillSpheresTable(table);
+    writeTableAsVtp(ptFile, table);
+}
+
+void DEMOutputSnapshot::fillTimeSeriesFrame(DEMTimeSeriesFrame& frame) const {
+    const size_t nOwners = simParams->nOwnerBodies;
+    frame.time = simParams->timeElapsed;
+    frame.Resize(nOwners);
+    for (size_t i = 0; i < nOwners; i++) {
+        voxelID_t voxX, voxY, voxZ;
+        hostIDChopper<voxelID_t, voxelID_t>(voxX, voxY, voxZ, voxelID.at(i), simParams->nvXp2, simParams->nvYp2);
+        frame.posX[i] = ((int64_t)voxX << VOXEL_RES_POWER2) + locX.at(i);
+        frame.posY[i] = ((int64_t)voxY << VOXEL_RES_POWER2) + locY.at(i);
+        frame.posZ[i] = ((int64_t)voxZ << VOXEL_RES_POWER2) + locZ.at(i);
+        frame.oriQw[i] = std::lround((double)oriQw.at(i) * DEME_TIME_SERIES_QUAT_SCALE);
+        frame.oriQx[i] = std::lround((double)oriQx.at(i) * DEME_TIME_SERIES_QUAT_SCALE);
+        frame.oriQy[i] = std::lround((double)oriQy.at(i) * DEME_TIME_SERIES_QUAT_SCALE);
+        frame.oriQz[i] = std::lround((double)oriQz.at(i) * DEME_TIME_SERIES_QUAT_SCALE);
+        frame.family[i] = familyID.at(i);
+        frame.type[i] = inertiaPropOffsets.at(i);
+    }
+}
+
+void DEMOutputSnapshot::fillClumpsTable(DEMBinaryTable& table) const {
+    // xyz, quaternion and clump type are always there
+    std::vector<unsigned int> pos_cols = {table.AddColumn(OUTPUT_FILE_X_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                                          table.AddColumn(OUTPUT_FILE_Y_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                                          table.AddColumn(OUTPUT_FILE_Z_COL_NAME, BINARY_COL_TYPE::FLOAT32)};
+    std::vector<unsigned int> q_cols = {table.AddColumn(OUTPUT_FILE_QW_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                                        table.AddColumn(OUTPUT_FILE_QX_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                                        table.AddColumn(OUTPUT_FILE_QY_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                                        table.AddColumn(OUTPUT_FILE_QZ_COL_NAME, BINARY_COL_TYPE::FLOAT32)};
+    unsigned int type_col = table.AddColumn(OUTPUT_FILE_CLUMP_TYPE_NAME, BINARY_COL_TYPE::STRING_ID);
+    unsigned int absv_col = 0, abs_acc_col = 0, family_col = 0;
+    std::vector<unsigned int> vel_cols, ang_vel_cols, acc_cols, ang_acc_cols, owner_w_cols;
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ABSV) {
+        absv_col = table.AddColumn("absv", BINARY_COL_TYPE::FLOAT32);
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::VEL) {
+        vel_cols = {table.AddColumn(OUTPUT_FILE_VEL_X_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                    table.AddColumn(OUTPUT_FILE_VEL_Y_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                    table.AddColumn(OUTPUT_FILE_VEL_Z_COL_NAME, BINARY_COL_TYPE::FLOAT32)};
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL) {
+        ang_vel_cols = {table.AddColumn(OUTPUT_FILE_ANGVEL_X_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                        table.AddColumn(OUTPUT_FILE_ANGVEL_Y_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                        table.AddColumn(OUTPUT_FILE_ANGVEL_Z_COL_NAME, BINARY_COL_TYPE::FLOAT32)};
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC) {
+        abs_acc_col = table.AddColumn("abs_acc", BINARY_COL_TYPE::FLOAT32);
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ACC) {
+        acc_cols = {table.AddColumn("a_x", BINARY_COL_TYPE::FLOAT32), table.AddColumn("a_y", BINARY_COL_TYPE::FLOAT32),
+                    table.AddColumn("a_z", BINARY_COL_TYPE::FLOAT32)};
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC) {
+        ang_acc_cols = {table.AddColumn("alpha_x", BINARY_COL_TYPE::FLOAT32),
+                        table.AddColumn("alpha_y", BINARY_COL_TYPE::FLOAT32),
+                        table.AddColumn("alpha_z", BINARY_COL_TYPE::FLOAT32)};
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY) {
+        family_col = table.AddColumn("family", BINARY_COL_TYPE::UINT8);
+    }
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD) {
+        for (const auto& name : m_owner_wildcard_names) {
+            owner_w_cols.push_back(table.AddColumn(name, BINARY_COL_TYPE::FLOAT32));
+        }
+    }
+    for (auto& col : table.columns) {
+        col.Reserve(simParams->nOwnerBodies);
+    }
+
+    for (size_t i = 0; i < simParams->nOwnerBodies; i++) {
+        // i is this owner's number. And if it is not a clump, we can move on.
+        if (ownerTypes.at(i) != OWNER_T_CLUMP)
+            continue;
+
+        family_t this_family = familyID.at(i);
+        // If this (impl-level) family is in the no-output list, skip it
+        if (std::binary_search(familiesNoOutput.begin(), familiesNoOutput.end(), this_family)) {
+            continue;
+        }
+
+        float X, Y, Z;
+        voxelID_t voxel = voxelID.at(i);
+        subVoxelPos_t subVoxX = locX.at(i);
+        subVoxelPos_t subVoxY = locY.at(i);
+        subVoxelPos_t subVoxZ = locZ.at(i);
+        hostVoxelIDToPosition<float, voxelID_t, subVoxelPos_t>(X, Y, Z, voxel, subVoxX, subVoxY, subVoxZ,
+                                                               simParams->nvXp2, simParams->nvYp2, simParams->voxelSize,
+                                                               simParams->l);
+        table.Col(pos_cols[0]).Push<float>(X + simParams->LBFX);
+        table.Col(pos_cols[1]).Push<float>(Y + simParams->LBFY);
+        table.Col(pos_cols[2]).Push<float>(Z + simParams->LBFZ);
+        table.Col(q_cols[0]).Push<float>(oriQw.at(i));
+        table.Col(q_cols[1]).Push<float>(oriQx.at(i));
+        table.Col(q_cols[2]).Push<float>(oriQy.at(i));
+        table.Col(q_cols[3]).Push<float>(oriQz.at(i));
+        table.Col(type_col).PushString(templateNumNameMap.at(inertiaPropOffsets.at(i)));
+
+        float3 vxyz, acc;
+        vxyz.x = vX.at(i);
+        vxyz.y = vY.at(i);
+        vxyz.z = vZ.at(i);
+        acc.x = aX.at(i);
+        acc.y = aY.at(i);
+        acc.z = aZ.at(i);
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ABSV) {
+            table.Col(absv_col).Push<float>(length(vxyz));
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::VEL) {
+            table.Col(vel_cols[0]).Push<float>(vxyz.x);
+            table.Col(vel_cols[1]).Push<float>(vxyz.y);
+            table.Col(vel_cols[2]).Push<float>(vxyz.z);
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL) {
+            table.Col(ang_vel_cols[0]).Push<float>(omgBarX.at(i));
+            table.Col(ang_vel_cols[1]).Push<float>(omgBarY.at(i));
+            table.Col(ang_vel_cols[2]).Push<float>(omgBarZ.at(i));
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC) {
+            table.Col(abs_acc_col).Push<float>(length(acc));
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ACC) {
+            table.Col(acc_cols[0]).Push<float>(acc.x);
+            table.Col(acc_cols[1]).Push<float>(acc.y);
+            table.Col(acc_cols[2]).Push<float>(acc.z);
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC) {
+            table.Col(ang_acc_cols[0]).Push<float>(alphaX.at(i));
+            table.Col(ang_acc_cols[1]).Push<float>(alphaY.at(i));
+            table.Col(ang_acc_cols[2]).Push<float>(alphaZ.at(i));
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY) {
+            table.Col(family_col).Push<uint8_t>(this_family);
+        }
+        for (unsigned int j = 0; j < owner_w_cols.size(); j++) {
+            table.Col(owner_w_cols[j]).Push<float>(ownerWildcards[j][i]);
+        }
+    }
+}
+
+void DEMOutputSnapshot::writeClumpsAsBinary(std::ofstream& ptFile) const {
+    DEMBinaryTable table;
+    fillClumpsTable(table);
+    table.Write(ptFile);
+}
+
+void DEMOutputSnapshot::writeClumpsAsVtp(std::ofstream& ptFile) const {
+    DEMBinaryTable table;
+    fillClumpsTable(table);
+    writeTableAsVtp(ptFile, table);
+}
+
+inline bodyID_t DEMOutputSnapshot::getOwnerForContactB(const bodyID_t& geoB, const contact_t& type) const {
+    switch (type) {
+        case (SPHERE_SPHERE_CONTACT):
+            return ownerClumpBody.at(geoB);
+        case (SPHERE_MESH_CONTACT):
+            return ownerMesh.at(geoB);
+        default:  // Default is sphere--analytical
+            return ownerAnalBody.at(geoB);
+    }
+}
+
+void DEMOutputSnapshot::writeContactsAsCsv(std::ofstream& ptFile, float force_thres) const {
+    DEMCsvBuffer header;
+    unsigned int num_fields = 1;
+    header.Put(OUTPUT_FILE_CNT_TYPE_NAME);
+    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::OWNER) {
+        header.Field(OUTPUT_FILE_OWNER_1_NAME);
+        header.Field(OUTPUT_FILE_OWNER_2_NAME);
+        num_fields += 2;
+    }
+    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::GEO_ID) {
+        header.Field(OUTPUT_FILE_GEO_ID_1_NAME);
+        header.Field(OUTPUT_FILE_GEO_ID_2_NAME);
+        num_fields += 2;
+    }
+    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::FORCE) {
+        header.Field(OUTPUT_FILE_FORCE_X_NAME);
+        header.Field(OUTPUT_FILE_FORCE_Y_NAME);
+        header.Field(OUTPUT_FILE_FORCE_Z_NAME);
+        num_fields += 3;
+    }
+    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::DEME_POINT) {
+        header.Field(OUTPUT_FILE_X_COL_NAME);
+        header.Field(OUTPUT_FILE_Y_COL_NAME);
+        header.Field(OUTPUT_FILE_Z_COL_NAME);
+        num_fields += 3;
+    }
+    // if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::COMPONENT) {
+    //     header.Field(OUTPUT_FILE_COMP_1_NAME);
+    //     header.Field(OUTPUT_FILE_COMP_2_NAME);
+    // }
+    // if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::NICKNAME) {
+    //     header.Field(OUTPUT_FILE_OWNER_NICKNAME_1_NAME);
+    //     header.Field(OUTPUT_FILE_OWNER_NICKNAME_2_NAME);
+    // }
+    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::NORMAL) {
+        header.Field(OUTPUT_FILE_NORMAL_X_NAME);
+        header.Field(OUTPUT_FILE_NORMAL_Y_NAME);
+        header.Field(OUTPUT_FILE_NORMAL_Z_NAME);
+        num_fields += 3;
+    }
+    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::TORQUE) {
+        header.Field(OUTPUT_FILE_TORQUE_X_NAME);
+        header.Field(OUTPUT_FILE_TORQUE_Y_NAME);
+        header.Field(OUTPUT_FILE_TORQUE_Z_NAME);
+        num_fields += 3;
+    }
+    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::CNT_WILDCARD) {
+        // Write all wildcard names as header
+        for (const auto& w_name : m_contact_wildcard_names) {
+            header.Field(w_name);
+        }
+        num_fields += m_contact_wildcard_names.size();
+    }
+    header.EndRow();
+    ptFile << header.Str();
+
+    const bool needs_point = solverFlags.cntOutFlags & (CNT_OUTPUT_CONTENT::DEME_POINT | CNT_OUTPUT_CONTENT::NORMAL |
+                                                        CNT_OUTPUT_CONTENT::TORQUE);
+    writeCsvRows(ptFile, nContacts, num_fields, 6, [&](DEMCsvBuffer& out, size_t i) {
+        // Geos that are involved in this contact
+        auto geoA = idGeometryA.at(i);
+        auto geoB = idGeometryB.at(i);
+        auto type = contactType.at(i);
+        // We don't output fake contacts; but right now, no contact will be marked fake by kT, so no need to check that
+        // if (type == NOT_A_CONTACT)
+        //     return;
+
+        // If this force+torque is too small, then it's not an active contact (if contacts are filtered on the device,
+        // this is checked already, and forces and torques are only there if they are to be written)
+        if (!contactsFiltered && length(contactForces.at(i) + contactTorque_convToForce.at(i)) < force_thres) {
+            return;
+        }
+
+        // geoA's owner must be a sphere
+        auto ownerA = ownerClumpBody.at(geoA);
+        bodyID_t ownerB;
+        // geoB's owner depends...
+        ownerB = getOwnerForContactB(geoB, type);
+
+        // Type is mapped to SS, SM and such....
+        out.Put(contact_type_out_name_map.at(type));
+
+        // (Internal) ownerID and/or geometry ID
+        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::OWNER) {
+            out.Field(ownerA);
+            out.Field(ownerB);
+        }
+        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::GEO_ID) {
+            // Sphere IDs are written as the user knows them
+            out.Field(getSphereUserID(geoA));
+            out.Field((type == SPHERE_SPHERE_CONTACT) ? getSphereUserID(geoB) : geoB);
+        }
+
+        // Force is already in global...
+        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::FORCE) {
+            float3 forcexyz = contactForces.at(i);
+            out.Field(forcexyz.x);
+            out.Field(forcexyz.y);
+            out.Field(forcexyz.z);
+        }
+
+        // Contact point is in local frame. To make it global, first map that vector to axis-aligned global frame, then
+        // add the location of body A CoM
+        float4 oriQA;
+        float3 CoM, cntPntA, cntPntALocal;
+        if (needs_point) {
+            oriQA.w = oriQw.at(ownerA);
+            oriQA.x = oriQx.at(ownerA);
+            oriQA.y = oriQy.at(ownerA);
+            oriQA.z = oriQz.at(ownerA);
+            voxelID_t voxel = voxelID.at(ownerA);
+            subVoxelPos_t subVoxX = locX.at(ownerA);
+            subVoxelPos_t subVoxY = locY.at(ownerA);
+            subVoxelPos_t subVoxZ = locZ.at(ownerA);
+            hostVoxelIDToPosition<float, voxelID_t, subVoxelPos_t>(CoM.x, CoM.y, CoM.z, voxel, subVoxX, subVoxY,
+                                                                   subVoxZ, simParams->nvXp2, simParams->nvYp2,
+                                                                   simParams->voxelSize, simParams->l);
+            CoM.x += simParams->LBFX;
+            CoM.y += simParams->LBFY;
+            CoM.z += simParams->LBFZ;
+            cntPntA = contactPointGeometryA.at(i);
+            cntPntALocal = cntPntA;
+            hostApplyOriQToVector3(cntPntA.x, cntPntA.y, cntPntA.z, oriQA.w, oriQA.x, oriQA.y, oriQA.z);
+            cntPntA += CoM;
+        }
+        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::DEME_POINT) {
+            // oriQ is updated already... whereas the contact point is effectively last step's... That's unfortunate.
+            // Should we do somthing ahout it?
+            out.Field(cntPntA.x);
+            out.Field(cntPntA.y);
+            out.Field(cntPntA.z);
+        }
+
+        // To get contact normal: it's just contact point - sphereA center, that gives you the outward normal for body A
+        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::NORMAL) {
+            size_t compOffset = (solverFlags.useClumpJitify) ? clumpComponentOffsetExt.at(geoA) : geoA;
+            float3 this_sp_deviation;
+            this_sp_deviation.x = relPosSphereX.at(compOffset);
+            this_sp_deviation.y = relPosSphereY.at(compOffset);
+            this_sp_deviation.z = relPosSphereZ.at(compOffset);
+            hostApplyOriQToVector3<float, float>(this_sp_deviation.x, this_sp_deviation.y, this_sp_deviation.z, oriQA.w,
+                                                 oriQA.x, oriQA.y, oriQA.z);
+            float3 pos = CoM + this_sp_deviation;
+            float3 normal = normalize(cntPntA - pos);
+            out.Field(normal.x);
+            out.Field(normal.y);
+            out.Field(normal.z);
+        }
+
+        // Torque is in global already...
+        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::TORQUE) {
+            float3 torque = contactTorque_convToForce.at(i);
+            // Must derive torque in local...
+            {
+                hostApplyOriQToVector3(torque.x, torque.y, torque.z, oriQA.w, -oriQA.x, -oriQA.y, -oriQA.z);
+                // Force times point...
+                torque = cross(cntPntALocal, torque);
+                // back to global
+                hostApplyOriQToVector3(torque.x, torque.y, torque.z, oriQA.w, oriQA.x, oriQA.y, oriQA.z);
+            }
+            out.Field(torque.x);
+            out.Field(torque.y);
+            out.Field(torque.z);
+        }
+
+        // Contact wildcards
+        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::CNT_WILDCARD) {
+            // The order shouldn't be an issue... the same set is being processed here and in equip_contact_wildcards,
+            // see Model.h
+            for (unsigned int j = 0; j < m_contact_wildcard_names.size(); j++) {
+                out.Field(contactWildcards[j][i]);
+            }
+        }
+
+        out.EndRow();
+    });
+}
+
+void DEMOutputSnapshot::writeContactsAsBinary(std::ofstream& ptFile, float force_thres) const {
+    DEMBinaryTable table;
+    unsigned int type_col = table.AddColumn(OUTPUT_FILE_CNT_TYPE_NAME, BINARY_COL_TYPE::STRING_ID);
+    std::vector<unsigned int> owner_cols, geo_cols, force_cols, point_cols, normal_cols, torque_cols, cnt_w_cols;
+    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::OWNER) {
+        owner_cols = {table.AddColumn(OUTPUT_FILE_OWNER_1_NAME, BINARY_COL_TYPE::UINT32),
+                      table.AddColumn(OUTPUT_FILE_OWNER_2_NAME, BINARY_COL_TYPE::UINT32)};
+    }
+    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::GEO_ID) {
+        geo_cols = {table.AddColumn(OUTPUT_FILE_GEO_ID_1_NAME, BINARY_COL_TYPE::UINT32),
+                    table.AddColumn(OUTPUT_FILE_GEO_ID_2_NAME, BINARY_COL_TYPE::UINT32)};
+    }
+    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::FORCE) {
+        force_cols = {table.AddColumn(OUTPUT_FILE_FORCE_X_NAME, BINARY_COL_TYPE::FLOAT32),
+                      table.AddColumn(OUTPUT_FILE_FORCE_Y_NAME, BINARY_COL_TYPE::FLOAT32),
+                      table.AddColumn(OUTPUT_FILE_FORCE_Z_NAME, BINARY_COL_TYPE::FLOAT32)};
+    }
+    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::DEME_POINT) {
+        point_cols = {table.AddColumn(OUTPUT_FILE_X_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                      table.AddColumn(OUTPUT_FILE_Y_COL_NAME, BINARY_COL_TYPE::FLOAT32),
+                      table.AddColumn(OUTPUT_FILE_Z_COL_NAME, BINARY_COL_TYPE::FLOAT32)};
+    }
+    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::NORMAL) {
+        normal_cols = {table.AddColumn(OUTPUT_FILE_NORMAL_X_NAME, BINARY_COL_TYPE::FLOAT32),
+                       table.AddColumn(OUTPUT_FILE_NORMAL_Y_NAME, BINARY_COL_TYPE::FLOAT32),
+                       table.AddColumn(OUTPUT_FILE_NORMAL_Z_NAME, BINARY_COL_TYPE::FLOAT32)};
+    }
+    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::TORQUE) {
+        torque_cols = {table.AddColumn(OUTPUT_FILE_TORQUE_X_NAME, BINARY_COL_TYPE::FLOAT32),
+                       table.AddColumn(OUTPUT_FILE_TORQUE_Y_NAME, BINARY_COL_TYPE::FLOAT32),
+                       table.AddColumn(OUTPUT_FILE_TORQUE_Z_NAME, BINARY_COL_TYPE::FLOAT32)};
+    }
+    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::CNT_WILDCARD) {
+        for (const auto& w_name : m_contact_wildcard_names) {
+            cnt_w_cols.push_back(table.AddColumn(w_name, BINARY_COL_TYPE::FLOAT32));
+        }
+    }
+
+    const bool needs_point = solverFlags.cntOutFlags & (CNT_OUTPUT_CONTENT::DEME_POINT | CNT_OUTPUT_CONTENT::NORMAL |
+                                                        CNT_OUTPUT_CONTENT::TORQUE);
+    for (size_t i = 0; i < nContacts; i++) {
+        auto geoA = idGeometryA.at(i);
+        auto geoB = idGeometryB.at(i);
+        auto type = contactType.at(i);
+
+        // If this force+torque is too small, then it's not an active contact; see writeContactsAsCsv
+        if (!contactsFiltered && length(contactForces.at(i) + contactTorque_convToForce.at(i)) < force_thres) {
+            continue;
+        }
+
+        auto ownerA = ownerClumpBody.at(geoA);
+        bodyID_t ownerB = getOwnerForContactB(geoB, type);
+
+        table.Col(type_col).PushString(contact_type_out_name_map.at(type));
+        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::OWNER) {
+            table.Col(owner_cols[0]).Push<uint32_t>(ownerA);
+            table.Col(owner_cols[1]).Push<uint32_t>(ownerB);
+        }
+        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::GEO_ID) {
+            // Sphere IDs are written as the user knows them
+            table.Col(geo_cols[0]).Push<uint32_t>(getSphereUserID(geoA));
+            table.Col(geo_cols[1]).Push<uint32_t>((type == SPHERE_SPHERE_CONTACT) ? getSphereUserID(geoB) : geoB);
+        }
+        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::FORCE) {
+            float3 forcexyz = contactForces.at(i);
+            table.Col(force_cols[0]).Push<float>(forcexyz.x);
+            table.Col(force_cols[1]).Push<float>(forcexyz.y);
+            table.Col(force_cols[2]).Push<float>(forcexyz.z);
+        }
+
+        // Contact point is in local frame; see writeContactsAsCsv
+        float4 oriQA;
+        float3 CoM, cntPntA, cntPntALocal;
+        if (needs_point) {
+            oriQA.w = oriQw.at(ownerA);
+            oriQA.x = oriQx.at(ownerA);
+            oriQA.y = oriQy.at(ownerA);
+            oriQA.z = oriQz.at(ownerA);
+            voxelID_t voxel = voxelID.at(ownerA);
+            subVoxelPos_t subVoxX = locX.at(ownerA);
+            subVoxelPos_t subVoxY = locY.at(ownerA);
+            subVoxelPos_t subVoxZ = locZ.at(ownerA);
+            hostVoxelIDToPosition<float, voxelID_t, subVoxelPos_t>(CoM.x, CoM.y, CoM.z, voxel, subVoxX, subVoxY,
+                                                                   subVoxZ, simParams->nvXp2, simParams->nvYp2,
+                                                                   simParams->voxelSize, simParams->l);
+            CoM.x += simParams->LBFX;
+            CoM.y += simParams->LBFY;
+            CoM.z += simParams->LBFZ;
+            cntPntA = contactPointGeometryA.at(i);
+            cntPntALocal = cntPntA;
+            hostApplyOriQToVector3(cntPntA.x, cntPntA.y, cntPntA.z, oriQA.w, oriQA.x, oriQA.y, oriQA.z);
+            cntPntA += CoM;
+        }
+        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::DEME_POINT) {
+            table.Col(point_cols[0]).Push<float>(cntPntA.x);
+            table.Col(point_cols[1]).Push<float>(cntPntA.y);
+            table.Col(point_cols[2]).Push<float>(cntPntA.z);
+        }
+        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::NORMAL) {
+            size_t compOffset = (solverFlags.useClumpJitify) ? clumpComponentOffsetExt.at(geoA) : geoA;
+            float3 this_sp_deviation;
+            this_sp_deviation.x = relPosSphereX.at(compOffset);
+            this_sp_deviation.y = relPosSphereY.at(compOffset);
+            this_sp_deviation.z = relPosSphereZ.at(compOffset);
+            hostApplyOriQToVector3<float, float>(this_sp_deviation.x, this_sp_deviation.y, this_sp_deviation.z, oriQA.w,
+                                                 oriQA.x, oriQA.y, oriQA.z);
+            float3 normal = normalize(cntPntA - (CoM + this_sp_deviation));
+            table.Col(normal_cols[0]).Push<float>(normal.x);
+            table.Col(normal_cols[1]).Push<float>(normal.y);
+            table.Col(normal_cols[2]).Push<float>(normal.z);
+        }
+        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::TORQUE) {
+            float3 torque = contactTorque_convToForce.at(i);
+            hostApplyOriQToVector3(torque.x, torque.y, torque.z, oriQA.w, -oriQA.x, -oriQA.y, -oriQA.z);
+            torque = cross(cntPntALocal, torque);
+            hostApplyOriQToVector3(torque.x, torque.y, torque.z, oriQA.w, oriQA.x, oriQA.y, oriQA.z);
+            table.Col(torque_cols[0]).Push<float>(torque.x);
+            table.Col(torque_cols[1]).Push<float>(torque.y);
+            table.Col(torque_cols[2]).Push<float>(torque.z);
+        }
+        for (unsigned int j = 0; j < cnt_w_cols.size(); j++) {
+            table.Col(cnt_w_cols[j]).Push<float>(contactWildcards[j][i]);
+        }
+    }
+
+    table.Write(ptFile);
+}
+
+// =============================================================================
+// DEMAsyncOutputWriter
+// =============================================================================
+
+std::ofstream openOutputFile(const std::string& filename, std::ios::openmode mode) {
+    std::ofstream ptFile(filename, mode);
+    if (!ptFile) {
+        DEME_ERROR("Failed to open output file %s for writing.", filename.c_str());
+    }
+    return ptFile;
+}
+
+DEMAsyncOutputWriter::~DEMAsyncOutputWriter() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        shouldJoin = true;
+    }
+    cvWork.notify_all();
+    // The worker keeps going till the queue is empty, then quits
+    th.join();
+    try {
+        rethrowIfFailed();
+    } catch (const std::exception& e) {
+        DEME_WARNING("An output file failed to be written in the background:\n%s", e.what());
+    } catch (...) {
+        DEME_WARNING("An output file failed to be written in the background.");
+    }
+}
+
+void DEMAsyncOutputWriter::Submit(std::function<void()>&& job) {
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        while (jobs.size() + (busy ? 1 : 0) >= maxPending) {
+            cvSpace.wait(lock);
+        }
+        jobs.push_back(std::move(job));
+    }
+    cvWork.notify_one();
+    rethrowIfFailed();
+}
+
+void DEMAsyncOutputWriter::WaitAll() {
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        while (!jobs.empty() || busy) {
+            cvDone.wait(lock);
+        }
+    }
+    rethrowIfFailed();
+}
+
+size_t DEMAsyncOutputWriter::NumPending() {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return jobs.size() + (busy ? 1 : 0);
+}
+
+void DEMAsyncOutputWriter::rethrowIfFailed() {
+    std::exception_ptr failure;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        failure = firstFailure;
+        firstFailure = nullptr;
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+void DEMAsyncOutputWriter::workerThread() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            while (jobs.empty() && !shouldJoin) {
+                cvWork.wait(lock);
+            }
+            // Pending jobs are still finished before joining
+            if (jobs.empty() && shouldJoin) {
+                break;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            busy = true;
+        }
+        cvSpace.notify_one();
+        try {
+            job();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (!firstFailure)
+                firstFailure = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            busy = false;
+        }
+        cvSpace.notify_one();
+        cvDone.notify_all();
+    }
+}
+
+}  // namespace deme
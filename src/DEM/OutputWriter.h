@@ -0,0 +1,202 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DEME_OUTPUT_WRITER_H
+#define DEME_OUTPUT_WRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <DEM/Defines.h>
+#include <DEM/VariableTypes.h>
+#include <DEM/utils/BinaryIO.hpp>
+#include <DEM/utils/TimeSeriesIO.hpp>
+#include <nvmath/helper_math.cuh>
+
+namespace deme {
+
+class DEMInspector;
+
+/// Which owners go into a sphere or clump output file. Like the contact filter below, the test is done on the device,
+/// and only the owners (and spheres of owners) that pass it are copied to the host.
+struct DEMOwnerOutputFilter {
+    // If given, only the owners whose CoM is in this inspector's region are written (its quantity is not used)
+    std::shared_ptr<DEMInspector> region;
+    // Only the owners whose IDs are multiples of this are written
+    unsigned int stride = 1;
+    bool IsActive() const { return region || stride > 1; }
+};
+
+/// Which contacts go into a contact output file. The test is done on the device, and only the contacts that pass it
+/// are copied to the host.
+struct DEMContactOutputFilter {
+    // Contacts whose force plus force-like torque is smaller than this are not written
+    float force_thres = DEME_TINY_FLOAT;
+    // If not empty, only contacts that involve an owner of one of these families are written
+    std::vector<unsigned int> families;
+    // If true, only contacts whose contact point is in the box [region_min, region_max] are written
+    bool use_region = false;
+    float3 region_min;
+    float3 region_max;
+};
+
+/// A host-side copy of the dT data needed to write sphere, clump or contact files. Once taken, it does not depend on
+/// the solver state anymore, so the (slow) formatting and writing can happen while the simulation goes on.
+class DEMOutputSnapshot {
+  public:
+    DEMOutputSnapshot() { simParams = &simParamsCopy; }
+    ~DEMOutputSnapshot() {}
+    // simParams points to a member, so copying is not allowed
+    DEMOutputSnapshot(const DEMOutputSnapshot&) = delete;
+    DEMOutputSnapshot& operator=(const DEMOutputSnapshot&) = delete;
+
+    void writeSpheresAsCsv(std::ofstream& ptFile) const;
+    void writeClumpsAsCsv(std::ofstream& ptFile, unsigned int accuracy = 10) const;
+    void writeContactsAsCsv(std::ofstream& ptFile, float force_thres = DEME_TINY_FLOAT) const;
+    void writeSpheresAsBinary(std::ofstream& ptFile) const;
+    void writeClumpsAsBinary(std::ofstream& ptFile) const;
+    void writeContactsAsBinary(std::ofstream& ptFile, float force_thres = DEME_TINY_FLOAT) const;
+    /// Write spheres or clumps as a VTK XML poly data file (.vtp), with the same columns as the binary format
+    void writeSpheresAsVtp(std::ofstream& ptFile) const;
+    void writeClumpsAsVtp(std::ofstream& ptFile) const;
+    /// Put the owner states into a time-series frame, in the quantized form the solver itself uses for positions
+    void fillTimeSeriesFrame(DEMTimeSeriesFrame& frame) const;
+
+    // Sim params at the time of the snapshot
+    DEMSimParams simParamsCopy;
+    const DEMSimParams* simParams;
+    // The output-related solver flags at the time of the snapshot
+    struct {
+        unsigned int outputFlags;
+        unsigned int cntOutFlags;
+        bool useClumpJitify;
+    } solverFlags;
+    size_t nContacts = 0;
+    // If true, the contacts were filtered on the device (see DEMContactOutputFilter) and only the requested columns
+    // were copied, so the writers do not check the force threshold again
+    bool contactsFiltered = false;
+
+    // Owner-related
+    std::vector<ownerType_t> ownerTypes;
+    std::vector<inertiaOffset_t> inertiaPropOffsets;
+    std::vector<family_t> familyID;
+    std::vector<family_t> familiesNoOutput;
+    std::vector<voxelID_t> voxelID;
+    std::vector<subVoxelPos_t> locX;
+    std::vector<subVoxelPos_t> locY;
+    std::vector<subVoxelPos_t> locZ;
+    std::vector<oriQStore_t> oriQw;
+    std::vector<oriQStore_t> oriQx;
+    std::vector<oriQStore_t> oriQy;
+    std::vector<oriQStore_t> oriQz;
+    std::vector<velStore_t> vX;
+    std::vector<velStore_t> vY;
+    std::vector<velStore_t> vZ;
+    std::vector<velStore_t> omgBarX;
+    std::vector<velStore_t> omgBarY;
+    std::vector<velStore_t> omgBarZ;
+    std::vector<float> aX;
+    std::vector<float> aY;
+    std::vector<float> aZ;
+    std::vector<float> alphaX;
+    std::vector<float> alphaY;
+    std::vector<float> alphaZ;
+    std::vector<std::vector<float>> ownerWildcards;
+    std::unordered_map<unsigned int, std::string> templateNumNameMap;
+    std::set<std::string> m_owner_wildcard_names;
+
+    // Sphere-related
+    std::vector<bodyID_t> ownerClumpBody;
+    // The user--impl sphere ID tables of dT (empty if spheres were never re-ordered)
+    std::vector<bodyID_t> sphereUserToImpl;
+    std::vector<bodyID_t> sphereImplToUser;
+    std::vector<clumpComponentOffsetExt_t> clumpComponentOffsetExt;
+    std::vector<float> radiiSphere;
+    std::vector<float> relPosSphereX;
+    std::vector<float> relPosSphereY;
+    std::vector<float> relPosSphereZ;
+    std::vector<std::vector<float>> sphereWildcards;
+    std::set<std::string> m_geo_wildcard_names;
+
+    // Contact-related
+    std::vector<bodyID_t> ownerMesh;
+    std::vector<bodyID_t> ownerAnalBody;
+    std::vector<bodyID_t> idGeometryA;
+    std::vector<bodyID_t> idGeometryB;
+    std::vector<contact_t> contactType;
+    std::vector<float3> contactForces;
+    std::vector<float3> contactTorque_convToForce;
+    std::vector<float3> contactPointGeometryA;
+    std::vector<std::vector<float>> contactWildcards;
+    std::set<std::string> m_contact_wildcard_names;
+
+  private:
+    // Put the columns of the sphere or clump binary output format into a table
+    void fillSpheresTable(DEMBinaryTable& table) const;
+    void fillClumpsTable(DEMBinaryTable& table) const;
+    // Get owner of contact geo B.
+    inline bodyID_t getOwnerForContactB(const bodyID_t& geoB, const contact_t& type) const;
+    inline bodyID_t getSphereImplID(bodyID_t userID) const {
+        return (userID < sphereUserToImpl.size()) ? sphereUserToImpl[userID] : userID;
+    }
+    inline bodyID_t getSphereUserID(bodyID_t implID) const {
+        return (implID < sphereImplToUser.size()) ? sphereImplToUser[implID] : implID;
+    }
+};
+
+/// Open an output file to be written. If it cannot be opened, this throws, like a failed write does, so a background
+/// write job reports it through the writer.
+std::ofstream openOutputFile(const std::string& filename, std::ios::openmode mode);
+
+/// A background thread that writes output files from snapshots, so the user thread can return right after the
+/// snapshot is taken. At most a bounded number of writes can be pending; beyond that, submitting a new one blocks.
+class DEMAsyncOutputWriter {
+  public:
+    DEMAsyncOutputWriter(unsigned int max_pending, VERBOSITY verbose = INFO)
+        : maxPending(max_pending > 0 ? max_pending : 1), verbosity(verbose) {
+        th = std::thread([this]() { this->workerThread(); });
+    }
+    /// Finishes the pending write jobs first. A failure that was not reported through WaitAll is printed as a warning,
+    /// since a destructor should not throw.
+    ~DEMAsyncOutputWriter();
+
+    /// Queue a write job. Blocks if there are already the max number of pending jobs.
+    void Submit(std::function<void()>&& job);
+    /// Block until all queued write jobs are done. If a job failed, its exception is re-thrown here.
+    void WaitAll();
+    /// Number of write jobs queued or being worked on
+    size_t NumPending();
+
+  private:
+    void workerThread();
+    void rethrowIfFailed();
+
+    unsigned int maxPending;
+    VERBOSITY verbosity;
+    std::thread th;
+    std::mutex queueMutex;
+    std::condition_variable cvWork;
+    std::condition_variable cvSpace;
+    std::condition_variable cvDone;
+    std::deque<std::function<void()>> jobs;
+    // Whether the worker is running a job right now (it is already out of the queue)
+    bool busy = false;
+    bool shouldJoin = false;
+    std::exception_ptr firstFailure = nullptr;
+};
+
+}  // namespace deme
+
+#endif
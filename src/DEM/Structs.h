@@ -12,6 +12,7 @@
 #include <core/utils/csv.hpp>
 #include <core/utils/GpuError.h>
 #include <core/utils/Timer.hpp>
+#include <core/utils/NvtxRange.hpp>
 #include <core/utils/RuntimeData.h>
 
 #include <sstream>
@@ -20,6 +21,9 @@
 #include <condition_variable>
 #include <mutex>
 #include <unordered_map>
+#include <tuple>
+#include <map>
+#include <string>
 #include <nvmath/helper_math.cuh>
 #include <DEM/HostSideHelpers.hpp>
 #include <filesystem>
@@ -100,6 +104,88 @@ const std::unordered_map<std::string, bool> force_kernel_ingredient_stats = {
 // NOTE: Data structs here need to be those complex ones (such as needing to include ManagedAllocator.hpp), which may
 // not be jitifiable.
 
+/// <summary>
+/// DEMMemoryRegistry keeps the books of the device-side memory that a worker thread allocates: the current and peak
+/// size of every tracked array and scratch buffer, grouped by subsystem. If a memory budget is set, it covers this
+/// registry and its peer (the other worker thread), and an allocation that would break it errors out before it is
+/// attempted, rather than running out of memory at some point in the simulation.
+/// </summary>
+class DEMMemoryRegistry {
+  public:
+    struct Record {
+        std::string name;
+        std::string subsystem;
+        size_t bytes = 0;
+        size_t peak = 0;
+    };
+
+    // Record that the array (or buffer) at key is about to become bytes large. Errors out if this breaks the budget.
+    inline void Reserve(const void* key, const std::string& name, const std::string& subsystem, size_t bytes);
+    // Same as above, with the subsystem told from the array name
+    void Reserve(const void* key, const std::string& name, size_t bytes) {
+        Reserve(key, name, SubsystemOf(name), bytes);
+    }
+
+    // How many items of bytes_each bytes to allocate, if wanted items are wanted and at least least are needed, using
+    // no more than share of what is left of the budget. Errors out if not even least of them fit.
+    inline size_t FitCount(const std::string& what, size_t wanted, size_t least, size_t bytes_each, double share) const;
+
+    // If the memory use of this registry and its peer is above fraction of the budget (false if there is no budget)
+    bool IsUnderPressure(double fraction) const {
+        return m_budget > 0 && (double)GetCombinedBytesUsed() > fraction * (double)m_budget;
+    }
+
+    void SetLabel(const std::string& label) { m_label = label; }
+    void SetPeer(const DEMMemoryRegistry* peer) { m_peer = peer; }
+    // 0 means there is no budget
+    void SetBudget(size_t bytes) { m_budget = bytes; }
+    size_t GetBudget() const { return m_budget; }
+
+    size_t GetBytesUsed() const { return m_total.load(); }
+    size_t GetPeakBytesUsed() const { return m_peak.load(); }
+    size_t GetCombinedBytesUsed() const { return GetBytesUsed() + (m_peer ? m_peer->GetBytesUsed() : 0); }
+    // Bytes left before hitting the budget (max size_t if there is no budget)
+    size_t GetRoom() const {
+        if (m_budget == 0)
+            return SIZE_MAX;
+        size_t used = GetCombinedBytesUsed();
+        return (used < m_budget) ? m_budget - used : 0;
+    }
+    // The current and peak bytes of each subsystem
+    const std::map<std::string, std::pair<size_t, size_t>>& GetSubsystemUsage() const { return m_subsystems; }
+    const std::map<const void*, Record>& GetRecords() const { return m_records; }
+
+    // The subsystem an array belongs to, told from its name
+    static std::string SubsystemOf(const std::string& name) {
+        auto has = [&name](const char* part) { return name.find(part) != std::string::npos; };
+        if (has("Wildcard"))
+            return "wildcard";
+        if (has("_buffer"))
+            return "buffer";
+        if (has("contact") || has("idGeometry") || has("Contact"))
+            return "contact";
+        if (has("Sphere") || has("clumpComponent"))
+            return "sphere";
+        if (has("tri") || has("Tri") || has("Mesh"))
+            return "mesh";
+        if (has("Anal"))
+            return "analytical";
+        if (has("family") || has("Family"))
+            return "family";
+        return "owner";
+    }
+
+  private:
+    std::string m_label = "solver";
+    std::map<const void*, Record> m_records;
+    std::map<std::string, std::pair<size_t, size_t>> m_subsystems;
+    // The peer thread reads my total when checking the budget, hence atomic
+    std::atomic<size_t> m_total{0};
+    std::atomic<size_t> m_peak{0};
+    size_t m_budget = 0;
+    const DEMMemoryRegistry* m_peer = nullptr;
+};
+
 /// <summary>
 /// DEMSolverStateData contains information that pertains the DEM solver worker threads, at a certain point in time. It
 /// also contains space allocated as system scratch pad and as thread temporary arrays.
@@ -118,7 +204,45 @@ class DEMSolverStateData {
         threadTempVectors;
     // You can keep more temp arrays if you construct this class with a different initializer
 
+    // If the device pool is in use, the scratch space and the temp arrays requested through allocateDeviceTempVector
+    // come from this stream-ordered pool instead. The temp arrays requested through allocateTempVector always come from
+    // the managed vectors above, since the host reads them (scan totals, found-contact flags and the like).
+    bool useDevicePool = false;
+    cudaMemPool_t devicePool;
+    cudaStream_t poolStream = 0;
+    struct PoolBuffer {
+        scratch_t* ptr = nullptr;
+        size_t size = 0;
+    };
+    PoolBuffer poolScratchSpace;
+    std::vector<PoolBuffer> poolTempVectors;
+
+    // Grow a pool buffer geometrically, keeping its content if asked to (as a vector resize would)
+    inline void growPoolBuffer(PoolBuffer& buf, size_t sizeNeeded, bool keepContent, const std::string& name) {
+        size_t newSize = (buf.size * 2 > sizeNeeded) ? buf.size * 2 : sizeNeeded;
+        trackScratch(&buf, name, newSize);
+        scratch_t* newPtr;
+        DEME_GPU_CALL(cudaMallocFromPoolAsync((void**)&newPtr, newSize, devicePool, poolStream));
+        if (buf.ptr) {
+            if (keepContent) {
+                DEME_GPU_CALL(cudaMemcpyAsync(newPtr, buf.ptr, buf.size, cudaMemcpyDeviceToDevice, poolStream));
+            }
+            DEME_GPU_CALL(cudaFreeAsync(buf.ptr, poolStream));
+        }
+        buf.ptr = newPtr;
+        buf.size = newSize;
+    }
+
+    inline void trackScratch(const void* key, const std::string& name, size_t bytes) {
+        if (memRegistry) {
+            memRegistry->Reserve(key, name, "scratch", bytes);
+        }
+    }
+
   public:
+    // The registry of the owner thread, which the scratch space and temp arrays report their sizes to
+    DEMMemoryRegistry* memRegistry = nullptr;
+
     // Temp size_t variables that can be reused
     size_t* pTempSizeVar1;
     size_t* pTempSizeVar2;
@@ -144,6 +268,18 @@ class DEMSolverStateData {
         threadTempVectors.resize(numTempArrays);
     }
     ~DEMSolverStateData() {
+        // The owner thread's stream may be gone by now, so pool buffers are freed synchronously
+        if (useDevicePool) {
+            if (poolScratchSpace.ptr) {
+                DEME_GPU_CALL(cudaFree(poolScratchSpace.ptr));
+            }
+            for (auto& buf : poolTempVectors) {
+                if (buf.ptr) {
+                    DEME_GPU_CALL(cudaFree(buf.ptr));
+                }
+            }
+            DEME_GPU_CALL(cudaMemPoolDestroy(devicePool));
+        }
         DEME_GPU_CALL(cudaFree(pNumContacts));
         DEME_GPU_CALL(cudaFree(pTempSizeVar1));
         DEME_GPU_CALL(cudaFree(pTempSizeVar2));
@@ -158,20 +294,62 @@ class DEMSolverStateData {
         threadTempVectors.clear();
     }
 
+    // From now on, serve the scratch space and large temp arrays from a device memory pool of my own, allocating in
+    // the order of the work on stream. This memory is not host-accessible and never migrates.
+    void enableDevicePool(int device, cudaStream_t stream) {
+        if (useDevicePool) {
+            return;
+        }
+        cudaMemPoolProps props = {};
+        props.allocType = cudaMemAllocationTypePinned;
+        props.location.type = cudaMemLocationTypeDevice;
+        props.location.id = device;
+        DEME_GPU_CALL(cudaMemPoolCreate(&devicePool, &props));
+        // Keep the freed memory reserved in the pool, as the arrays are re-allocated as the simulation goes
+        uint64_t threshold = UINT64_MAX;
+        DEME_GPU_CALL(cudaMemPoolSetAttribute(devicePool, cudaMemPoolAttrReleaseThreshold, &threshold));
+        poolStream = stream;
+        poolTempVectors.resize(numTempArrays);
+        useDevicePool = true;
+    }
+
     // Return raw pointer to swath of device memory that is at least "sizeNeeded" large
     inline scratch_t* allocateScratchSpace(size_t sizeNeeded) {
+        if (useDevicePool) {
+            // The old content of scratch space is never needed
+            if (poolScratchSpace.size < sizeNeeded) {
+                growPoolBuffer(poolScratchSpace, sizeNeeded, false, "cubScratchSpace");
+            }
+            return poolScratchSpace.ptr;
+        }
         if (cubScratchSpace.size() < sizeNeeded) {
+            trackScratch(&cubScratchSpace, "cubScratchSpace", sizeNeeded);
             cubScratchSpace.resize(sizeNeeded);
         }
         return cubScratchSpace.data();
     }
 
+    // Temp array i, in managed memory, so the host can read and write it too
     inline scratch_t* allocateTempVector(unsigned int i, size_t sizeNeeded) {
         if (threadTempVectors.at(i).size() < sizeNeeded) {
+            trackScratch(&threadTempVectors.at(i), "threadTempVectors[" + std::to_string(i) + "]", sizeNeeded);
             threadTempVectors.at(i).resize(sizeNeeded);
         }
         return threadTempVectors.at(i).data();
     }
+
+    // Temp array i, for arrays only device code touches. If the device pool is in use, it comes from the pool, and it
+    // is a different array from temp array i of allocateTempVector; otherwise it is the same one.
+    inline scratch_t* allocateDeviceTempVector(unsigned int i, size_t sizeNeeded) {
+        if (!useDevicePool) {
+            return allocateTempVector(i, sizeNeeded);
+        }
+        PoolBuffer& buf = poolTempVectors.at(i);
+        if (buf.size < sizeNeeded) {
+            growPoolBuffer(buf, sizeNeeded, true, "poolTempVectors[" + std::to_string(i) + "]");
+        }
+        return buf.ptr;
+    }
 };
 
 struct kTStateParams {
@@ -201,6 +379,141 @@ struct kTStateParams {
     float avgCntsPerSphere = 0.;
 };
 
+// Linear BVHs over the facets of meshes that use BVH-based contact detection (see
+// DEMMeshConnected::UseBVHContactDetection), one per mesh. They are built in the mesh's own frame, so rigid motions do
+// not change them; each contact detection only refits the bounding boxes, since the contact margin changes.
+struct DEMTriangleBVH {
+    // Number of meshes and facets (leaves) in BVHs. The number of internal nodes is nLeaves - nMeshes.
+    size_t nMeshes = 0;
+    size_t nLeaves = 0;
+    // If true, the hierarchies are (re)built at the next contact detection, instead of just being refit
+    bool needRebuild = false;
+
+    // For each BVH mesh: its owner, its first leaf, its number of leaves, and its root node. Mesh m's internal nodes
+    // start from meshLeafStart[m] - m; a single-facet mesh has its leaf as its root.
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> meshOwner;
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> meshLeafStart;
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> meshLeafCount;
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> meshRoot;
+    // Bounding box of each BVH mesh in its own frame, which normalizes the Morton codes of its facets
+    std::vector<float3, ManagedAllocator<float3>> meshBoxMin;
+    std::vector<float3, ManagedAllocator<float3>> meshBoxMax;
+
+    // Facet ID of each leaf. The leaves of a mesh are in the Morton order of the facets' centroids.
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> leafTriID;
+    // The BVH mesh each leaf belongs to
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> leafMesh;
+    // Nodes are numbered internal nodes first, then leaves. These are the children of internal nodes.
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> childL;
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> childR;
+    // Parent of each node (NULL_BODYID for roots)
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> parent;
+    // Bounding box of each node, in the frame of the mesh
+    std::vector<float3, ManagedAllocator<float3>> boxMin;
+    std::vector<float3, ManagedAllocator<float3>> boxMax;
+    // Number of children of each internal node already refit, so that the last one to arrive refits the node
+    std::vector<unsigned int, ManagedAllocator<unsigned int>> refitCount;
+};
+
+// Bin touches of the spheres of fixed families. These spheres do not move, so contact detection works their bin touches
+// out once and reuses them, till they move, change family, outgrow the margin the cache is built with, or the bins or
+// sphere IDs change.
+struct DEMFixedSphereBinCache {
+    // If true, the cache is rebuilt at the next contact detection without checking it
+    bool needRebuild = true;
+    // The bin size the cache is built for
+    double binSize = 0.;
+    // The cached pairs
+    size_t nPairs = 0;
+    std::vector<binID_t, ManagedAllocator<binID_t>> binIDs;
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> sphereIDs;
+    // Owner states when the cache is built, and the margin the cached fixed owners are binned with
+    std::vector<double3, ManagedAllocator<double3>> ownerPos;
+    std::vector<float4, ManagedAllocator<float4>> ownerOriQ;
+    std::vector<float, ManagedAllocator<float>> marginSize;
+    std::vector<notStupidBool_t, ManagedAllocator<notStupidBool_t>> ownerIsCached;
+};
+
+// How the spheres, triangles and contacts are spread over the bins at one contact detection, as measured by the bin
+// occupancy profiler (see DEMSolver::UseBinOccupancyProfiler). The histograms have DEME_BIN_PROFILE_NUM_BUCKETS
+// log2-sized buckets over the active bins: entry 0 counts bins with none, entry k counts bins with [2^(k-1), 2^k).
+struct DEMBinOccupancyProfile {
+    // Whether a profile has been taken yet
+    bool valid = false;
+    // The number of kT updates dT had received when it was taken
+    uint64_t kTUpdate = 0;
+    double binSize = 0.;
+    size_t numBins = 0;
+    // Bins touched by at least one sphere, and by at least one triangle
+    size_t numActiveBins = 0;
+    size_t numActiveBinsForTri = 0;
+    double activeBinFraction = 0.;
+    size_t maxSpheresInBin = 0;
+    size_t maxTrianglesInBin = 0;
+    // Bins with more than DEME_MAX_SPHERES_PER_BIN_SINGLE_BLOCK spheres, which are split over several blocks
+    size_t numDenseBins = 0;
+    // Sphere--sphere contacts found, over the sphere-active bins
+    size_t numSphSphContacts = 0;
+    std::vector<size_t> spheresPerBin;
+    std::vector<size_t> trianglesPerBin;
+    std::vector<size_t> contactsPerBin;
+
+    std::string ToJson() const {
+        std::ostringstream js;
+        js.precision(9);
+        auto hist = [&js](const char* key, const std::vector<size_t>& vals) {
+            js << ", \"" << key << "\": [";
+            for (size_t i = 0; i < vals.size(); i++) {
+                js << (i > 0 ? ", " : "") << vals[i];
+            }
+            js << "]";
+        };
+        js << "{\"valid\": " << (valid ? "true" : "false") << ", \"kT_update\": " << kTUpdate
+           << ", \"bin_size\": " << binSize << ", \"num_bins\": " << numBins
+           << ", \"num_active_bins\": " << numActiveBins << ", \"num_active_bins_for_tri\": " << numActiveBinsForTri
+           << ", \"active_bin_fraction\": " << activeBinFraction << ", \"max_spheres_in_bin\": " << maxSpheresInBin
+           << ", \"max_triangles_in_bin\": " << maxTrianglesInBin << ", \"num_dense_bins\": " << numDenseBins
+           << ", \"num_sph_sph_contacts\": " << numSphSphContacts;
+        hist("spheres_per_bin", spheresPerBin);
+        hist("triangles_per_bin", trianglesPerBin);
+        hist("contacts_per_bin", contactsPerBin);
+        js << "}";
+        return js.str();
+    }
+};
+
+// kT's working data of the bin occupancy profiler
+struct DEMBinProfiler {
+    // Set by kT when the coming contact detection should be profiled
+    bool runThisTime = false;
+    // The device histograms: spheres, triangles, then contacts per bin
+    std::vector<unsigned long long, ManagedAllocator<unsigned long long>> counts;
+    // Written by contact detection when it is profiled
+    DEMBinOccupancyProfile result;
+};
+
+// Owner-indexed CSR of the contact array, so contact forces can be collected per owner without sorting. Contact e
+// contributes entry e (its geometry A) and entry e + nContactPairs (its geometry B). It only changes when kT delivers a
+// new contact list, so it is built then and reused for every dT step till the next one.
+struct DEMOwnerCSR {
+    // Number of owners involved in contacts, which is the number of segments
+    size_t nOwnerSegments = 0;
+    // The owner of each segment
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> owner;
+    // Segment i is the entries in [offsets[i], offsets[i + 1])
+    std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>> offsets;
+    // The entries, grouped by owner
+    std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>> entries;
+};
+
+// The contacts grouped by the force model they use, so each model's force kernel only goes through its own contacts
+struct DEMForceModelGroups {
+    // Group i (the contacts of model i) is the entries in [offsets[i], offsets[i + 1])
+    std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>> offsets;
+    // The contact indices, grouped by model
+    std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>> entries;
+};
+
 inline std::string pretty_format_bytes(size_t bytes) {
     // set up byte prefixes
     constexpr size_t KIBI = 1024;
@@ -231,9 +544,9 @@ enum class INSPECT_ENTITY_TYPE { SPHERE, CLUMP, MESH, MESH_FACET, EVERYTHING };
 // Which reduce operation is needed in an inspection
 enum class CUB_REDUCE_FLAVOR { NONE, MAX, MIN, SUM };
 // Format of the output files
-enum class OUTPUT_FORMAT { CSV, BINARY, CHPF };
+enum class OUTPUT_FORMAT { CSV, BINARY, CHPF, VTP };
 // Mesh output format
-enum class MESH_FORMAT { VTK, OBJ };
+enum class MESH_FORMAT { VTK, OBJ, VTU };
 // Adaptive time step size methods
 enum class ADAPT_TS_TYPE { NONE, MAX_VEL, INT_DIFF };
 
@@ -339,37 +652,99 @@ enum class ADAPT_TS_TYPE { NONE, MAX_VEL, INT_DIFF };
 
 // I wasn't able to resolve a decltype problem with vector of vectors, so I have to create another macro for this kind
 // of tracked resize... not ideal.
-#define DEME_TRACKED_RESIZE_FLOAT(vec, newsize, val)               \
-    {                                                              \
-        size_t old_size = vec.size();                              \
-        vec.resize(newsize, val);                                  \
-        size_t new_size = vec.size();                              \
-        size_t byte_delta = sizeof(float) * (new_size - old_size); \
-        m_approx_bytes_used += byte_delta;                         \
+#define DEME_TRACKED_RESIZE_FLOAT(vec, newsize, val)                     \
+    {                                                                    \
+        m_mem_registry.Reserve(&(vec), #vec, sizeof(float) * (newsize)); \
+        vec.resize(newsize, val);                                        \
+    }
+
+#define DEME_TRACKED_RESIZE(vec, newsize, val)                       \
+    {                                                                \
+        size_t item_size = sizeof(decltype(vec)::value_type);        \
+        m_mem_registry.Reserve(&(vec), #vec, item_size * (newsize)); \
+        vec.resize(newsize, val);                                    \
     }
 
-#define DEME_TRACKED_RESIZE(vec, newsize, val)                 \
-    {                                                          \
-        size_t item_size = sizeof(decltype(vec)::value_type);  \
-        size_t old_size = vec.size();                          \
-        vec.resize(newsize, val);                              \
-        size_t new_size = vec.size();                          \
-        size_t byte_delta = item_size * (new_size - old_size); \
-        m_approx_bytes_used += byte_delta;                     \
+// Same as DEME_TRACKED_RESIZE, but when the capacity has to grow, it grows by at least DEME_CNT_ARRAY_GROWTH, for the
+// arrays whose length follows the number of contacts
+#define DEME_TRACKED_GROWING_RESIZE(vec, newsize, val)                                                        \
+    {                                                                                                         \
+        size_t item_size = sizeof(decltype(vec)::value_type);                                                 \
+        if ((size_t)(newsize) > vec.capacity()) {                                                             \
+            size_t new_cap =                                                                                  \
+                DEME_MAX((size_t)(newsize), (size_t)((double)vec.capacity() * DEME_CNT_ARRAY_GROWTH));        \
+            m_mem_registry.Reserve(&(vec), #vec, item_size * new_cap);                                        \
+            vec.reserve(new_cap);                                                                             \
+        }                                                                                                     \
+        vec.resize(newsize, val);                                                                             \
     }
 
 #define DEME_TRACKED_RESIZE_DEBUGPRINT(vec, newsize, name, val)                                                      \
     {                                                                                                                \
         size_t item_size = sizeof(decltype(vec)::value_type);                                                        \
         size_t old_size = vec.size();                                                                                \
+        m_mem_registry.Reserve(&(vec), name, item_size * (newsize));                                                 \
         vec.resize(newsize, val);                                                                                    \
         size_t new_size = vec.size();                                                                                \
         size_t byte_delta = item_size * (new_size - old_size);                                                       \
-        m_approx_bytes_used += byte_delta;                                                                           \
         DEME_DEBUG_PRINTF("Resizing vector %s, old size %zu, new size %zu, byte delta %s", name, old_size, new_size, \
                           pretty_format_bytes(byte_delta).c_str());                                                  \
     }
 
+inline void DEMMemoryRegistry::Reserve(const void* key,
+                                       const std::string& name,
+                                       const std::string& subsystem,
+                                       size_t bytes) {
+    Record& rec = m_records[key];
+    if (rec.name.empty()) {
+        rec.name = name;
+        rec.subsystem = subsystem;
+    }
+    auto& sub = m_subsystems[rec.subsystem];
+    if (bytes > rec.bytes) {
+        size_t delta = bytes - rec.bytes;
+        size_t total = m_total.fetch_add(delta) + delta;
+        size_t combined = total + (m_peer ? m_peer->GetBytesUsed() : 0);
+        if (m_budget > 0 && combined > m_budget) {
+            m_total -= delta;
+            DEME_ERROR(
+                "%s: allocating %s for array %s (%s) would bring the solver's device memory use to %s, over the "
+                "budget of %s.\nConsider reducing the problem size, or raising the budget via SetMemoryBudget.",
+                m_label.c_str(), pretty_format_bytes(bytes).c_str(), rec.name.c_str(), rec.subsystem.c_str(),
+                pretty_format_bytes(combined).c_str(), pretty_format_bytes(m_budget).c_str());
+        }
+        sub.first += delta;
+        if (total > m_peak)
+            m_peak = total;
+    } else {
+        m_total -= rec.bytes - bytes;
+        sub.first -= rec.bytes - bytes;
+    }
+    rec.bytes = bytes;
+    rec.peak = DEME_MAX(rec.peak, bytes);
+    sub.second = DEME_MAX(sub.second, sub.first);
+}
+
+inline size_t DEMMemoryRegistry::FitCount(const std::string& what,
+                                          size_t wanted,
+                                          size_t least,
+                                          size_t bytes_each,
+                                          double share) const {
+    if (m_budget == 0 || bytes_each == 0)
+        return wanted;
+    size_t room = GetRoom();
+    if (least > room / bytes_each) {
+        DEME_ERROR(
+            "%s: the %s need at least %s, but only %s is left of the device memory budget of %s.\nConsider reducing "
+            "the problem size, or raising the budget via SetMemoryBudget.",
+            m_label.c_str(), what.c_str(), pretty_format_bytes(least * bytes_each).c_str(),
+            pretty_format_bytes(room).c_str(), pretty_format_bytes(m_budget).c_str());
+    }
+    size_t fit = (size_t)((double)room * share) / bytes_each;
+    fit = DEME_MAX(fit, least);
+    return (fit < wanted) ? fit : wanted;
+}
+
 //// TODO: this is currently not tracked...
 // ptr being a reference to a pointer is crucial
 template <typename T>
@@ -417,19 +792,235 @@ class WorkerAnomalies {
     void Clear() { over_max_vel = false; }
 };
 
+// One change of the contact detection bin size made by kT
+struct DEMBinSizeRecord {
+    // The number of kT updates dT had received when the change was made
+    uint64_t kTUpdate;
+    double binSize;
+    size_t numBins;
+};
+
+// A snapshot of the solver's performance-related numbers, see DEMSolver::GetPerformanceReport. It holds what
+// ShowTimingStats, ShowThreadCollaborationStats, ShowMemStats and ShowAnomalies print, and it can be written as JSON.
+struct DEMPerformanceReport {
+    double simTime = 0.;
+    uint64_t numDynamicSteps = 0;
+    // Wall time (s) of each timed phase of kT and dT
+    std::vector<std::pair<std::string, double>> kTTimers;
+    std::vector<std::pair<std::string, double>> dTTimers;
+    // kT--dT collaboration
+    uint64_t nDynamicUpdates = 0;
+    uint64_t nKinematicUpdates = 0;
+    uint64_t nTimesDynamicHeldBack = 0;
+    uint64_t nTimesKinematicHeldBack = 0;
+    uint64_t accumKinematicLagSteps = 0;
+    uint64_t nContactListReuses = 0;
+    double dynamicWaitSec = 0.;
+    double kinematicWaitSec = 0.;
+    // The max number of steps dT may now run ahead of kT, and the average steps per kT update
+    unsigned int currentFutureDrift = 0;
+    float updateFreq = 0.;
+    // Contacts and bins
+    size_t numContacts = 0;
+    float avgContactsPerSphere = 0.;
+    double binSize = 0.;
+    size_t numBins = 0;
+    std::vector<DEMBinSizeRecord> binSizeHistory;
+    // The latest bin occupancy profile, if the profiler is on
+    DEMBinOccupancyProfile binProfile;
+    // Current and peak device bytes of each worker, in total and by subsystem
+    size_t kTMemBytes = 0, kTMemPeakBytes = 0;
+    size_t dTMemBytes = 0, dTMemPeakBytes = 0;
+    std::map<std::string, std::pair<size_t, size_t>> kTMemBySubsystem;
+    std::map<std::string, std::pair<size_t, size_t>> dTMemBySubsystem;
+    // Anomalies on record
+    bool overMaxVel = false;
+
+    std::string ToJson() const {
+        std::ostringstream js;
+        js.precision(9);
+        auto timers = [&js](const char* key, const std::vector<std::pair<std::string, double>>& vals) {
+            js << "\"" << key << "\": {";
+            for (size_t i = 0; i < vals.size(); i++) {
+                js << (i > 0 ? ", " : "") << "\"" << vals[i].first << "\": " << vals[i].second;
+            }
+            js << "}, ";
+        };
+        auto mem = [&js](const char* key, size_t bytes, size_t peak,
+                         const std::map<std::string, std::pair<size_t, size_t>>& subs) {
+            js << "\"" << key << "\": {\"bytes\": " << bytes << ", \"peak_bytes\": " << peak << ", \"subsystems\": {";
+            bool first = true;
+            for (const auto& sub : subs) {
+                js << (first ? "" : ", ") << "\"" << sub.first << "\": {\"bytes\": " << sub.second.first
+                   << ", \"peak_bytes\": " << sub.second.second << "}";
+                first = false;
+            }
+            js << "}}, ";
+        };
+        js << "{\"sim_time\": " << simTime << ", \"num_dynamic_steps\": " << numDynamicSteps << ", ";
+        timers("kT_timers", kTTimers);
+        timers("dT_timers", dTTimers);
+        js << "\"num_dynamic_updates\": " << nDynamicUpdates << ", \"num_kinematic_updates\": " << nKinematicUpdates
+           << ", \"num_times_dynamic_held_back\": " << nTimesDynamicHeldBack
+           << ", \"num_times_kinematic_held_back\": " << nTimesKinematicHeldBack
+           << ", \"accum_kinematic_lag_steps\": " << accumKinematicLagSteps
+           << ", \"num_contact_list_reuses\": " << nContactListReuses << ", \"dynamic_wait_sec\": " << dynamicWaitSec
+           << ", \"kinematic_wait_sec\": " << kinematicWaitSec << ", \"current_future_drift\": " << currentFutureDrift
+           << ", \"update_freq\": " << updateFreq << ", \"num_contacts\": " << numContacts
+           << ", \"avg_contacts_per_sphere\": " << avgContactsPerSphere << ", \"bin_size\": " << binSize
+           << ", \"num_bins\": " << numBins << ", \"bin_size_history\": [";
+        for (size_t i = 0; i < binSizeHistory.size(); i++) {
+            js << (i > 0 ? ", " : "") << "{\"kT_update\": " << binSizeHistory[i].kTUpdate
+               << ", \"bin_size\": " << binSizeHistory[i].binSize << ", \"num_bins\": " << binSizeHistory[i].numBins
+               << "}";
+        }
+        js << "], \"bin_profile\": " << binProfile.ToJson() << ", ";
+        mem("kT_memory", kTMemBytes, kTMemPeakBytes, kTMemBySubsystem);
+        mem("dT_memory", dTMemBytes, dTMemPeakBytes, dTMemBySubsystem);
+        js << "\"over_max_vel\": " << (overMaxVel ? "true" : "false") << "}";
+        return js.str();
+    }
+};
+
+// A timer used by kT and dT. By default it measures host wall time. In event mode, it instead records a pair of CUDA
+// events on the worker stream, so timing a kernel does not require the host to wait for that kernel to finish.
+class SolverTimer {
+  private:
+    Timer<double> host_timer;
+    bool use_events = false;
+    cudaStream_t event_stream = 0;
+    cudaEvent_t current_start = nullptr;
+    // Recorded start-stop event pairs whose elapsed time has not been collected yet, in the order they were recorded
+    std::vector<std::pair<cudaEvent_t, cudaEvent_t>> pending;
+    std::vector<cudaEvent_t> spare_events;
+    double event_seconds = 0.;
+    // If named, each start--stop is also an NVTX range of this name
+    const char* range_name = nullptr;
+    bool range_open = false;
+
+    cudaEvent_t getEvent() {
+        cudaEvent_t event;
+        if (spare_events.empty()) {
+            DEME_GPU_CALL(cudaEventCreate(&event));
+        } else {
+            event = spare_events.back();
+            spare_events.pop_back();
+        }
+        return event;
+    }
+    // Add up the elapsed time of recorded event pairs. If not blocking, only the pairs already completed are
+    // collected; since they are recorded on one stream, the first unfinished one means the rest are unfinished too.
+    void collectEvents(bool blocking) {
+        size_t num_done = 0;
+        for (; num_done < pending.size(); num_done++) {
+            const auto& pair = pending[num_done];
+            if (blocking) {
+                DEME_GPU_CALL(cudaEventSynchronize(pair.second));
+            } else if (cudaEventQuery(pair.second) == cudaErrorNotReady) {
+                break;
+            }
+            float ms;
+            DEME_GPU_CALL(cudaEventElapsedTime(&ms, pair.first, pair.second));
+            event_seconds += (double)ms / 1000.;
+            spare_events.push_back(pair.first);
+            spare_events.push_back(pair.second);
+        }
+        pending.erase(pending.begin(), pending.begin() + num_done);
+    }
+
+  public:
+    SolverTimer() {}
+    SolverTimer(const SolverTimer&) = delete;
+    SolverTimer& operator=(const SolverTimer&) = delete;
+    ~SolverTimer() {
+        // No error checking here, as this may run when the CUDA context is already being torn down
+        for (auto& pair : pending) {
+            cudaEventDestroy(pair.first);
+            cudaEventDestroy(pair.second);
+        }
+        for (auto& event : spare_events) {
+            cudaEventDestroy(event);
+        }
+        if (current_start) {
+            cudaEventDestroy(current_start);
+        }
+    }
+
+    /// Switch between host wall time and CUDA event timing on the given stream
+    void UseEvents(bool flag, cudaStream_t stream) {
+        use_events = flag;
+        event_stream = stream;
+    }
+    /// Mark the timed phases with NVTX ranges of this name (the string must outlive the timer)
+    void SetRangeName(const char* name) { range_name = name; }
+
+    void start() {
+        if (range_name && !range_open) {
+            NvtxRangePush(range_name);
+            range_open = true;
+        }
+        if (use_events) {
+            if (!current_start) {
+                current_start = getEvent();
+            }
+            DEME_GPU_CALL(cudaEventRecord(current_start, event_stream));
+        } else {
+            host_timer.start();
+        }
+    }
+    void stop() {
+        if (range_open) {
+            NvtxRangePop();
+            range_open = false;
+        }
+        if (use_events) {
+            if (!current_start) {
+                return;
+            }
+            cudaEvent_t end = getEvent();
+            DEME_GPU_CALL(cudaEventRecord(end, event_stream));
+            pending.push_back(std::make_pair(current_start, end));
+            current_start = nullptr;
+            collectEvents(false);
+        } else {
+            host_timer.stop();
+        }
+    }
+    void reset() {
+        collectEvents(true);
+        event_seconds = 0.;
+        host_timer.reset();
+    }
+    /// Total timed seconds. In event mode, this waits for the recorded events to complete.
+    double GetTimeSeconds() {
+        collectEvents(true);
+        return host_timer.GetTimeSeconds() + event_seconds;
+    }
+};
+
 // Timers used by kT and dT
 class SolverTimers {
   private:
     const unsigned int num_timers;
-    std::unordered_map<std::string, Timer<double>> m_timers;
+    std::unordered_map<std::string, SolverTimer> m_timers;
 
   public:
     SolverTimers(const std::vector<std::string>& names) : num_timers(names.size()) {
         for (unsigned int i = 0; i < num_timers; i++) {
-            m_timers[names.at(i)] = Timer<double>();
+            // Map nodes never move, so the key string can be the NVTX range name
+            auto it = m_timers.emplace(std::piecewise_construct, std::forward_as_tuple(names.at(i)),
+                                       std::forward_as_tuple())
+                          .first;
+            it->second.SetRangeName(it->first.c_str());
+        }
+    }
+    SolverTimer& GetTimer(const std::string& name) { return m_timers.at(name); }
+    /// Make all timers use CUDA events recorded on this stream (or go back to host timing)
+    void UseEvents(bool flag, cudaStream_t stream) {
+        for (auto& timer : m_timers) {
+            timer.second.UseEvents(flag, stream);
         }
     }
-    Timer<double>& GetTimer(const std::string& name) { return m_timers.at(name); }
 };
 
 // Manager of the collabortation between the main thread and worker threads
@@ -485,6 +1076,16 @@ struct familyPrescription_t {
     std::string angAccPre = "none";
     // A switch to mark if there is any prescription going on for this family at all
     bool used = false;
+
+    // Whether this is just what SetFamilyFixed prescribes: all motions dictated, with zero velocities, so the owners of
+    // this family never move
+    bool IsFixed() const {
+        return used && linVelXPrescribed && linVelYPrescribed && linVelZPrescribed && rotVelXPrescribed &&
+               rotVelYPrescribed && rotVelZPrescribed && rotPosPrescribed && linPosXPrescribed && linPosYPrescribed &&
+               linPosZPrescribed && linVelX == "0" && linVelY == "0" && linVelZ == "0" && rotVelX == "0" &&
+               rotVelY == "0" && rotVelZ == "0" && linVelPre == "none" && rotVelPre == "none" &&
+               linPosPre == "none" && linPosX == "none" && linPosY == "none" && linPosZ == "none" && oriQ == "none";
+    }
 };
 
 struct familyPair_t {
@@ -521,6 +1122,8 @@ class ClumpTemplateFlatten {
 struct SolverFlags {
     // Sort contact pair arrays (based on contact type) before sending to dT
     bool should_sort_pairs = true;
+    // Map contact history through a hash table keyed on (idA, idB, contact type), not the sort-based pipeline
+    bool useHashHistoryMapping = false;
     // This run is historyless
     bool isHistoryless = false;
     // This run uses contact detection in an async fashion (kT and dT working at different points in simulation time)
@@ -549,6 +1152,36 @@ struct SolverFlags {
     bool useNoContactRecord = false;
     // Collect force (reduce to acc) right in the force calculation kernel
     bool useForceCollectInPlace = false;
+    // Capture the dT step kernel sequence in a CUDA graph and replay it, instead of launching kernels one by one
+    bool useCudaGraphs = false;
+    // The integration kernel records owner velocity magnitudes, so no separate pass is needed to find them for kT
+    bool useFusedAbsvPass = false;
+    // ChangeFamilyWhen conditions are evaluated in the integration kernel, not in a separate sweep over the owners
+    bool useFamilyChangeInIntegration = false;
+    // Calculate contact forces with one kernel specialized for each contact class, over the type-sorted contact array
+    bool useSegmentedForceCalc = false;
+    // Launch the contact class-specialized force kernels on separate streams, so they can run concurrently
+    bool useSegmentedForceStreams = false;
+    // Do not synchronize the stream after each kernel; only where the host needs a device-computed value
+    bool useNoSyncMode = false;
+    // Solver timers record CUDA events on the worker streams, rather than reading host wall time
+    bool useEventTiming = false;
+    // Advise the driver on where managed arrays are best kept, and prefetch them to the device before each user call
+    bool useManagedMemHints = false;
+    // kT and dT live on different devices with peer access enabled, so their buffers are sent with peer copies
+    bool usePeerTransfer = false;
+    // kT ships only the contacts new to each update (plus the persistent contact map), and dT patches its arrays
+    bool useContactDelta = false;
+    // kT skips contact detection and re-sends the last contact list if no sphere has used up its margin since then
+    bool useContactListReuse = false;
+    // Whether the bin touches of the spheres of fixed families are cached across contact detections
+    bool useFixedBinCache = false;
+    // The extra thickness added to the contact margin when contact detection actually runs, if contact list reuse is on
+    float contactListSkin = 0.f;
+    // Profile the bin occupancy at every this many contact detections (0 means never)
+    unsigned int binProfileFreq = 0;
+    // Re-order sphere components in memory along the Morton curve every this many kT updates (0 means never)
+    unsigned int sphereReorderFreq = 0;
     // Max number of steps dT is allowed to be ahead of kT, even when auto-adapt is enabled
     unsigned int upperBoundFutureDrift = 5000;
     // (targetDriftMoreThanAvg + targetDriftMultipleOfAvg * actual_dT_steps_per_kT_step) is used to calculate contact
@@ -559,6 +1192,9 @@ struct SolverFlags {
     // Whether the solver auto-update those sim params
     bool autoBinSize = true;
     bool autoUpdateFreq = true;
+    // Whether the update frequency is picked from the measured kT contact detection and dT step times, rather than
+    // nudged by the wait/no-wait experience of dT
+    bool useCostModelDrift = false;
 
     // The max number of average contacts per sphere has before the solver errors out. The reason why I didn't use the
     // number of contacts for the sphere that has the most is that, well, we can have a huge sphere and it just will
@@ -566,6 +1202,15 @@ struct SolverFlags {
     float errOutAvgSphCnts = 100.;
 };
 
+// Synchronize a worker stream after a kernel, unless the solver is in no-sync mode. Only use it for syncs that exist
+// for error reporting and timing; syncs before the host reads device results, or reuses a temp buffer, must stay.
+#define DEME_SYNC_UNLESS_NO_SYNC(solverFlags, stream)     \
+    {                                                     \
+        if (!(solverFlags).useNoSyncMode) {               \
+            DEME_GPU_CALL(cudaStreamSynchronize(stream)); \
+        }                                                 \
+    }
+
 class DEMMaterial {
   public:
     // Material name--value pairs
@@ -6,12 +6,149 @@
 #ifndef DEME_VAR_TYPES
 #define DEME_VAR_TYPES
 
+// The jitified kernels get DEME_COMPACT_OWNER_STATE as a compile flag instead
+#ifndef __CUDACC_RTC__
+    #include <core/ApiVersion.h>
+    #include <cuda_runtime_api.h>
+    #include <cstring>
+    #include <cmath>
+#endif
+
 namespace deme {
 
+#if DEME_COMPACT_OWNER_STATE
+/// A value in [-1, 1] (such as a unit quaternion component) stored as a 16-bit signed normalized integer, so the
+/// resolution is about 3e-5 everywhere in the range.
+struct DEMUnitSnorm16 {
+    int16_t bits;
+
+    DEMUnitSnorm16() = default;
+    __host__ __device__ DEMUnitSnorm16(float val) {
+        val = (val > 1.f) ? 1.f : ((val < -1.f) ? -1.f : val);
+        bits = (int16_t)rintf(val * 32767.f);
+    }
+    __host__ __device__ operator float() const { return (float)bits * (1.f / 32767.f); }
+    __host__ __device__ DEMUnitSnorm16& operator+=(float val) { return *this = (float)(*this) + val; }
+    __host__ __device__ DEMUnitSnorm16& operator-=(float val) { return *this = (float)(*this) - val; }
+    __host__ __device__ DEMUnitSnorm16& operator*=(float val) { return *this = (float)(*this) * val; }
+    __host__ __device__ DEMUnitSnorm16& operator/=(float val) { return *this = (float)(*this) / val; }
+};
+#endif
+
+// Bit-level helpers for contact wildcards kept in 16 bits (see DEMForceModel::SetContactWildcardPrecision). Two such
+// wildcards share a 32-bit word of a contact wildcard array, and half 0 is the low 16 bits of it. The words are only
+// ever copied around as a whole, never computed with, so any bit pattern survives.
+__host__ __device__ inline uint32_t wildcardWordToBits(float word) {
+    uint32_t u;
+#ifdef __CUDA_ARCH__
+    u = __float_as_uint(word);
+#else
+    std::memcpy(&u, &word, sizeof(u));
+#endif
+    return u;
+}
+__host__ __device__ inline float wildcardBitsToWord(uint32_t u) {
+#ifdef __CUDA_ARCH__
+    return __uint_as_float(u);
+#else
+    float word;
+    std::memcpy(&word, &u, sizeof(word));
+    return word;
+#endif
+}
+__host__ __device__ inline uint16_t unpackWildcardHalf(float word, unsigned int half) {
+    return (uint16_t)(wildcardWordToBits(word) >> (16 * half));
+}
+__host__ __device__ inline float packWildcardHalf(float word, unsigned int half, uint16_t code) {
+    uint32_t u = wildcardWordToBits(word);
+    u = (u & ~(0xffffu << (16 * half))) | ((uint32_t)code << (16 * half));
+    return wildcardBitsToWord(u);
+}
+
+/// IEEE half precision, rounded to nearest even, and saturated at +-65504 instead of going infinite
+__host__ __device__ inline uint16_t floatToFP16Bits(float val) {
+    uint32_t u = wildcardWordToBits(val);
+    uint32_t sign = (u >> 16) & 0x8000u;
+    uint32_t mag = u & 0x7fffffffu;
+    if (mag > 0x7f800000u) {
+        return (uint16_t)(sign | 0x7e00u);
+    }
+    if (mag >= 0x477ff000u) {
+        return (uint16_t)(sign | 0x7bffu);
+    }
+    if (mag < 0x38800000u) {
+        // Subnormal in half precision (or 0)
+        if (mag < 0x33000000u) {
+            return (uint16_t)sign;
+        }
+        uint32_t shift = 126u - (mag >> 23);
+        uint32_t mant = (mag & 0x7fffffu) | 0x800000u;
+        uint32_t code = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1u);
+        uint32_t halfway = 1u << (shift - 1u);
+        if (rem > halfway || (rem == halfway && (code & 1u))) {
+            code++;
+        }
+        return (uint16_t)(sign | code);
+    }
+    // Re-bias the exponent, then round off the 13 extra mantissa bits; a carry correctly bumps the exponent
+    uint32_t code = (mag - 0x38000000u) >> 13;
+    uint32_t rem = mag & 0x1fffu;
+    if (rem > 0x1000u || (rem == 0x1000u && (code & 1u))) {
+        code++;
+    }
+    return (uint16_t)(sign | code);
+}
+__host__ __device__ inline float fp16BitsToFloat(uint16_t bits) {
+    uint32_t sign = (uint32_t)(bits & 0x8000u) << 16;
+    uint32_t expo = (bits >> 10) & 0x1fu;
+    uint32_t mant = bits & 0x3ffu;
+    if (expo == 0) {
+        // Subnormal: mant * 2^-24
+        float val = (float)mant * 5.9604644775390625e-8f;
+        return sign ? -val : val;
+    }
+    uint32_t u = (expo == 31) ? (sign | 0x7f800000u | (mant << 13)) : (sign | ((expo + 112u) << 23) | (mant << 13));
+    return wildcardBitsToWord(u);
+}
+
+/// bfloat16, rounded to nearest even
+__host__ __device__ inline uint16_t floatToBF16Bits(float val) {
+    uint32_t u = wildcardWordToBits(val);
+    if ((u & 0x7fffffffu) > 0x7f800000u) {
+        return (uint16_t)((u >> 16) | 0x40u);
+    }
+    return (uint16_t)((u + 0x7fffu + ((u >> 16) & 1u)) >> 16);
+}
+__host__ __device__ inline float bf16BitsToFloat(uint16_t bits) {
+    return wildcardBitsToWord((uint32_t)bits << 16);
+}
+
+/// A value in [-32767 scale, 32767 scale] as a multiple of scale, clamped to that range
+__host__ __device__ inline uint16_t floatToScaledInt16Bits(float val, float scale) {
+    float steps = val / scale;
+    steps = (steps > 32767.f) ? 32767.f : ((steps < -32767.f) ? -32767.f : steps);
+    return (uint16_t)(int16_t)rintf(steps);
+}
+__host__ __device__ inline float scaledInt16BitsToFloat(uint16_t bits, float scale) {
+    return (float)(int16_t)bits * scale;
+}
+
 typedef uint16_t subVoxelPos_t;  ///< uint16 or uint32
 
 typedef uint64_t voxelID_t;
-typedef float oriQ_t;
+typedef float oriQ_t;  ///< Type for computing with quaternion components
+// Storage types for the per-owner state arrays. The compact profile (CMake option USE_COMPACT_OWNER_STATE) halves the
+// size of the quaternions, so more owners fit in GPU memory and the bandwidth-bound kernels move fewer bytes. The price
+// is precision: a quaternion component changes in steps of about 3e-5, so per-step rotations smaller than that are
+// lost. Velocities stay in float in either profile, since a 16-bit one would round away the per-step increments (such
+// as g times the step size) that slow particles live on.
+#if DEME_COMPACT_OWNER_STATE
+typedef DEMUnitSnorm16 oriQStore_t;  ///< Storage type of owner quaternion components
+#else
+typedef float oriQStore_t;  ///< Storage type of owner quaternion components
+#endif
+typedef float velStore_t;  ///< Storage type of owner velocities and angular velocities
 typedef unsigned int bodyID_t;
 typedef unsigned int binID_t;
 typedef uint8_t objID_t;
@@ -7,6 +7,9 @@
 #include <iostream>
 #include <thread>
 #include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <type_traits>
 
 #ifdef DEME_USE_CHPF
     #include <chpf.hpp>
@@ -38,6 +41,8 @@ void DEMDynamicThread::packDataPointers() {
     granData->vX = vX.data();
     granData->vY = vY.data();
     granData->vZ = vZ.data();
+    granData->ownerAbsVel = ownerAbsVel.data();
+    granData->ownerQuietSteps = ownerQuietSteps.data();
     granData->oriQw = oriQw.data();
     granData->oriQx = oriQx.data();
     granData->oriQy = oriQy.data();
@@ -55,6 +60,8 @@ void DEMDynamicThread::packDataPointers() {
     granData->contactType = contactType.data();
     granData->familyMasks = familyMaskMatrix.data();
     granData->familyExtraMarginSize = familyExtraMarginSize.data();
+    granData->familyStepRatio = familyStepRatio.data();
+    granData->adaptTSGauge = adaptTSGauge.data();
 
     // granData->idGeometryA_buffer = idGeometryA_buffer.data();
     // granData->idGeometryB_buffer = idGeometryB_buffer.data();
@@ -88,6 +95,7 @@ void DEMDynamicThread::packDataPointers() {
 
     // Mesh-related
     granData->ownerMesh = ownerMesh.data();
+    granData->triNodeOffset = triNodeOffset.data();
     granData->relPosNode1 = relPosNode1.data();
     granData->relPosNode2 = relPosNode2.data();
     granData->relPosNode3 = relPosNode3.data();
@@ -104,6 +112,92 @@ void DEMDynamicThread::packDataPointers() {
     granData->mmiZZ = mmiZZ.data();
 }
 
+void DEMDynamicThread::applyManagedMemHints() {
+    if (!solverFlags.useManagedMemHints) {
+        return;
+    }
+    const int device = streamInfo.device;
+    int concurrent_access = 0;
+    DEME_GPU_CALL(cudaDeviceGetAttribute(&concurrent_access, cudaDevAttrConcurrentManagedAccess, device));
+    // Without concurrent managed access, the driver migrates all managed memory at kernel launch anyway
+    if (!concurrent_access) {
+        return;
+    }
+    cudaStream_t stream = streamInfo.stream;
+    // Arrays the device reads and writes every step
+    auto device_preferred = [&](auto& vec) {
+        advise(vec, ManagedAdvice::PREFERRED_LOC, device);
+        migrate(vec, device, stream);
+    };
+    // Arrays that rarely change after initialization; the host reading them then does not take them off the device
+    auto read_mostly = [&](auto& vec) {
+        advise(vec, ManagedAdvice::READ_MOSTLY, device);
+        migrate(vec, device, stream);
+    };
+
+    device_preferred(familyID);
+    device_preferred(voxelID);
+    device_preferred(locX);
+    device_preferred(locY);
+    device_preferred(locZ);
+    device_preferred(oriQw);
+    device_preferred(oriQx);
+    device_preferred(oriQy);
+    device_preferred(oriQz);
+    device_preferred(vX);
+    device_preferred(vY);
+    device_preferred(vZ);
+    device_preferred(omgBarX);
+    device_preferred(omgBarY);
+    device_preferred(omgBarZ);
+    device_preferred(aX);
+    device_preferred(aY);
+    device_preferred(aZ);
+    device_preferred(alphaX);
+    device_preferred(alphaY);
+    device_preferred(alphaZ);
+    device_preferred(idGeometryA);
+    device_preferred(idGeometryB);
+    device_preferred(contactType);
+    device_preferred(contactForces);
+    device_preferred(contactTorque_convToForce);
+    device_preferred(contactPointGeometryA);
+    device_preferred(contactPointGeometryB);
+    for (auto& wildcard : contactWildcards) {
+        device_preferred(wildcard);
+    }
+    for (auto& wildcard : ownerWildcards) {
+        device_preferred(wildcard);
+    }
+
+    read_mostly(inertiaPropOffsets);
+    read_mostly(ownerTypes);
+    read_mostly(massOwnerBody);
+    read_mostly(mmiXX);
+    read_mostly(mmiYY);
+    read_mostly(mmiZZ);
+    read_mostly(radiiSphere);
+    read_mostly(relPosSphereX);
+    read_mostly(relPosSphereY);
+    read_mostly(relPosSphereZ);
+    read_mostly(relPosEntityX);
+    read_mostly(relPosEntityY);
+    read_mostly(relPosEntityZ);
+    read_mostly(oriEntityX);
+    read_mostly(oriEntityY);
+    read_mostly(oriEntityZ);
+    read_mostly(sizeEntity1);
+    read_mostly(sizeEntity2);
+    read_mostly(sizeEntity3);
+    read_mostly(ownerClumpBody);
+    read_mostly(ownerMesh);
+    read_mostly(clumpComponentOffset);
+    read_mostly(clumpComponentOffsetExt);
+    read_mostly(sphereMaterialOffset);
+    read_mostly(triMaterialOffset);
+    read_mostly(familyMaskMatrix);
+}
+
 void DEMDynamicThread::packTransferPointers(DEMKinematicThread*& kT) {
     // These are the pointers for sending data to dT
     granData->pKTOwnedBuffer_maxDrift = &(kT->granData->maxDrift_buffer);
@@ -181,6 +275,20 @@ void DEMDynamicThread::setSimParams(unsigned char nvXp2,
     m_contact_wildcard_names = contact_wildcards;
     m_owner_wildcard_names = owner_wildcards;
     m_geo_wildcard_names = geo_wildcards;
+    // Plain floats, till told otherwise
+    m_contact_wildcard_storage.assign(contact_wildcards.size(), DEMContactWildcardStorage());
+    for (unsigned int i = 0; i < m_contact_wildcard_storage.size(); i++) {
+        m_contact_wildcard_storage[i].slot = i;
+    }
+}
+
+void DEMDynamicThread::setContactWildcardStorage(const std::vector<DEMContactWildcardStorage>& storage) {
+    m_contact_wildcard_storage = storage;
+    unsigned int n_arrays = 0;
+    for (const auto& store : storage) {
+        n_arrays = std::max(n_arrays, store.slot + 1);
+    }
+    simParams->nContactWildcards = n_arrays;
 }
 
 void DEMDynamicThread::changeOwnerSizes(const std::vector<bodyID_t>& IDs, const std::vector<float>& factors) {
@@ -230,6 +338,7 @@ void DEMDynamicThread::allocateManagedArrays(size_t nOwnerBodies,
                                              size_t nTriMeshes,
                                              size_t nSpheresGM,
                                              size_t nTriGM,
+                                             size_t nTriNodeGM,
                                              unsigned int nAnalGM,
                                              size_t nExtraContacts,
                                              unsigned int nMassProperties,
@@ -243,6 +352,7 @@ void DEMDynamicThread::allocateManagedArrays(size_t nOwnerBodies,
     // Sizes of these arrays
     simParams->nSpheresGM = nSpheresGM;
     simParams->nTriGM = nTriGM;
+    simParams->nTriNodeGM = nTriNodeGM;
     simParams->nAnalGM = nAnalGM;
     simParams->nOwnerBodies = nOwnerBodies;
     simParams->nOwnerClumps = nOwnerClumps;
@@ -267,6 +377,8 @@ void DEMDynamicThread::allocateManagedArrays(size_t nOwnerBodies,
     DEME_TRACKED_RESIZE_DEBUGPRINT(vX, nOwnerBodies, "vX", 0);
     DEME_TRACKED_RESIZE_DEBUGPRINT(vY, nOwnerBodies, "vY", 0);
     DEME_TRACKED_RESIZE_DEBUGPRINT(vZ, nOwnerBodies, "vZ", 0);
+    DEME_TRACKED_RESIZE_DEBUGPRINT(ownerAbsVel, nOwnerBodies, "ownerAbsVel", 0);
+    DEME_TRACKED_RESIZE_DEBUGPRINT(ownerQuietSteps, nOwnerBodies, "ownerQuietSteps", 0);
     DEME_TRACKED_RESIZE_DEBUGPRINT(omgBarX, nOwnerBodies, "omgBarX", 0);
     DEME_TRACKED_RESIZE_DEBUGPRINT(omgBarY, nOwnerBodies, "omgBarY", 0);
     DEME_TRACKED_RESIZE_DEBUGPRINT(omgBarZ, nOwnerBodies, "omgBarZ", 0);
@@ -306,9 +418,11 @@ void DEMDynamicThread::allocateManagedArrays(size_t nOwnerBodies,
 
     // Resize to the number of triangle facets
     DEME_TRACKED_RESIZE_DEBUGPRINT(ownerMesh, nTriGM, "ownerMesh", 0);
-    DEME_TRACKED_RESIZE_DEBUGPRINT(relPosNode1, nTriGM, "relPosNode1", make_float3(0));
-    DEME_TRACKED_RESIZE_DEBUGPRINT(relPosNode2, nTriGM, "relPosNode2", make_float3(0));
-    DEME_TRACKED_RESIZE_DEBUGPRINT(relPosNode3, nTriGM, "relPosNode3", make_float3(0));
+    DEME_TRACKED_RESIZE_DEBUGPRINT(triNodeOffset, nTriGM, "triNodeOffset", 0);
+    // Resize to the number of facets whose nodes are stored
+    DEME_TRACKED_RESIZE_DEBUGPRINT(relPosNode1, nTriNodeGM, "relPosNode1", make_float3(0));
+    DEME_TRACKED_RESIZE_DEBUGPRINT(relPosNode2, nTriNodeGM, "relPosNode2", make_float3(0));
+    DEME_TRACKED_RESIZE_DEBUGPRINT(relPosNode3, nTriNodeGM, "relPosNode3", make_float3(0));
     DEME_TRACKED_RESIZE_DEBUGPRINT(triMaterialOffset, nTriGM, "triMaterialOffset", 0);
 
     // Resize to the number of analytical geometries
@@ -339,9 +453,15 @@ void DEMDynamicThread::allocateManagedArrays(size_t nOwnerBodies,
     {
         // In any case, in this initialization process we should not make contact arrays smaller than it used to be, or
         // we may lose data. Also, if this is a new-boot, we allocate this array for at least
-        // nSpheresGM*DEME_INIT_CNT_MULTIPLIER elements.
-        size_t cnt_arr_size =
-            DEME_MAX(*stateOfSolver_resources.pNumContacts + nExtraContacts, nSpheresGM * DEME_INIT_CNT_MULTIPLIER);
+        // nSpheresGM*DEME_INIT_CNT_MULTIPLIER elements, or for fewer (but at least nSpheresGM) elements if that is what
+        // the memory budget allows.
+        size_t bytes_per_cnt = 2 * sizeof(bodyID_t) + sizeof(contact_t) + sizeof(float) * simParams->nContactWildcards;
+        if (!solverFlags.useNoContactRecord) {
+            bytes_per_cnt += 4 * sizeof(float3);
+        }
+        size_t init_cnt_size = m_mem_registry.FitCount("contact arrays", nSpheresGM * DEME_INIT_CNT_MULTIPLIER,
+                                                       nSpheresGM, bytes_per_cnt, DEME_MEM_BUDGET_CNT_SHARE);
+        size_t cnt_arr_size = DEME_MAX(*stateOfSolver_resources.pNumContacts + nExtraContacts, init_cnt_size);
         DEME_TRACKED_RESIZE_DEBUGPRINT(idGeometryA, cnt_arr_size, "idGeometryA", 0);
         DEME_TRACKED_RESIZE_DEBUGPRINT(idGeometryB, cnt_arr_size, "idGeometryB", 0);
         DEME_TRACKED_RESIZE_DEBUGPRINT(contactType, cnt_arr_size, "contactType", NOT_A_CONTACT);
@@ -413,6 +533,35 @@ void DEMDynamicThread::registerPolicies(const std::unordered_map<unsigned int, s
     // No modification for the arrays in this function. They can only be completely re-constructed.
 
     // Load in mass and MOI template info
+    registerMassProperties(clump_templates, ext_obj_mass_types, ext_obj_moi_types, mesh_obj_mass_types,
+                           mesh_obj_moi_types);
+
+    // Store family mask
+    for (size_t i = 0; i < family_mask_matrix.size(); i++)
+        familyMaskMatrix.at(i) = family_mask_matrix.at(i);
+
+    // Store clump naming map
+    templateNumNameMap = template_number_name_map;
+
+    // Take notes of the families that should not be outputted
+    {
+        std::set<unsigned int>::iterator it;
+        unsigned int i = 0;
+        familiesNoOutput.resize(no_output_families.size());
+        for (it = no_output_families.begin(); it != no_output_families.end(); it++, i++) {
+            familiesNoOutput.at(i) = *it;
+        }
+        std::sort(familiesNoOutput.begin(), familiesNoOutput.end());
+        DEME_DEBUG_PRINTF("Impl-level families that will not be outputted:");
+        DEME_DEBUG_EXEC(displayArray<family_t>(familiesNoOutput.data(), familiesNoOutput.size()));
+    }
+}
+
+void DEMDynamicThread::registerMassProperties(const ClumpTemplateFlatten& clump_templates,
+                                              const std::vector<float>& ext_obj_mass_types,
+                                              const std::vector<float3>& ext_obj_moi_types,
+                                              const std::vector<float>& mesh_obj_mass_types,
+                                              const std::vector<float3>& mesh_obj_moi_types) {
     size_t k = 0;
 
     for (unsigned int i = 0; i < clump_templates.mass.size(); i++) {
@@ -450,25 +599,29 @@ void DEMDynamicThread::registerPolicies(const std::unordered_map<unsigned int, s
         // Currently mesh volume is not used
         k++;
     }
+}
 
-    // Store family mask
-    for (size_t i = 0; i < family_mask_matrix.size(); i++)
-        familyMaskMatrix.at(i) = family_mask_matrix.at(i);
-
-    // Store clump naming map
-    templateNumNameMap = template_number_name_map;
+void DEMDynamicThread::getNonClumpMassProperties(std::vector<float>& mass_types,
+                                                 std::vector<float3>& moi_types) const {
+    mass_types.clear();
+    moi_types.clear();
+    if (!solverFlags.useMassJitify) {
+        return;
+    }
+    for (size_t i = simParams->nDistinctClumpBodyTopologies; i < simParams->nDistinctMassProperties; i++) {
+        mass_types.push_back(massOwnerBody.at(i));
+        moi_types.push_back(make_float3(mmiXX.at(i), mmiYY.at(i), mmiZZ.at(i)));
+    }
+}
 
-    // Take notes of the families that should not be outputted
-    {
-        std::set<unsigned int>::iterator it;
-        unsigned int i = 0;
-        familiesNoOutput.resize(no_output_families.size());
-        for (it = no_output_families.begin(); it != no_output_families.end(); it++, i++) {
-            familiesNoOutput.at(i) = *it;
+void DEMDynamicThread::shiftNonClumpInertiaOffsets(size_t nExistingOwners, unsigned int shift) {
+    if (shift == 0) {
+        return;
+    }
+    for (size_t i = 0; i < nExistingOwners; i++) {
+        if (ownerTypes.at(i) != OWNER_T_CLUMP) {
+            inertiaPropOffsets.at(i) += shift;
         }
-        std::sort(familiesNoOutput.begin(), familiesNoOutput.end());
-        DEME_DEBUG_PRINTF("Impl-level families that will not be outputted:");
-        DEME_DEBUG_EXEC(displayArray<family_t>(familiesNoOutput.data(), familiesNoOutput.size()));
     }
 }
 
@@ -483,6 +636,7 @@ void DEMDynamicThread::populateEntityArrays(const std::vector<std::shared_ptr<DE
                                             const std::vector<unsigned int>& mesh_facet_owner,
                                             const std::vector<materialsOffset_t>& mesh_facet_materials,
                                             const std::vector<DEMTriangle>& mesh_facets,
+                                            const std::vector<bodyID_t>& mesh_facet_node_offsets,
                                             const ClumpTemplateFlatten& clump_templates,
                                             const std::vector<float>& ext_obj_mass_types,
                                             const std::vector<float3>& ext_obj_moi_types,
@@ -506,6 +660,8 @@ void DEMDynamicThread::populateEntityArrays(const std::vector<std::shared_ptr<DE
             prescans_comp.push_back(k);
         }
         prescans_comp.pop_back();
+        // Clumps inserted later use the same offsets
+        templateCompOffsets = prescans_comp;
         k = 0;
 
         for (const auto& elem : clump_templates.spRelPos) {
@@ -693,7 +849,7 @@ void DEMDynamicThread::populateEntityArrays(const std::vector<std::shared_ptr<DE
                 contactType.at(cnt_arr_offset) = SPHERE_SPHERE_CONTACT;  // Only sph--sph cnt for now
                 unsigned int w_num = 0;
                 for (const auto& w_name : m_contact_wildcard_names) {
-                    contactWildcards[w_num].at(cnt_arr_offset) = a_batch->contact_wildcards.at(w_name).at(jj);
+                    setContactWildcard(w_num, cnt_arr_offset, a_batch->contact_wildcards.at(w_name).at(jj));
                     w_num++;
                 }
                 cnt_arr_offset++;
@@ -842,10 +998,13 @@ void DEMDynamicThread::populateEntityArrays(const std::vector<std::shared_ptr<DE
                 break;
             ownerMesh.at(nExistingFacets + k) = owner_offset_for_mesh_obj + this_facet_owner;
             triMaterialOffset.at(nExistingFacets + k) = mesh_facet_materials.at(k);
+            // Instances of a mesh write the same nodes to the same place
+            const bodyID_t node_offset = mesh_facet_node_offsets.at(k);
+            triNodeOffset.at(nExistingFacets + k) = node_offset;
             DEMTriangle this_tri = mesh_facets.at(k);
-            relPosNode1.at(nExistingFacets + k) = this_tri.p1;
-            relPosNode2.at(nExistingFacets + k) = this_tri.p2;
-            relPosNode3.at(nExistingFacets + k) = this_tri.p3;
+            relPosNode1.at(node_offset) = this_tri.p1;
+            relPosNode2.at(node_offset) = this_tri.p2;
+            relPosNode3.at(node_offset) = this_tri.p3;
         }
 
         family_t this_family_num = input_mesh_obj_family.at(i);
@@ -895,6 +1054,10 @@ void DEMDynamicThread::buildTrackedObjs(const std::vector<std::shared_ptr<DEMClu
     // Also note, we just have to process those haven't been processed
     for (unsigned int i = nTrackersProcessed; i < tracked_objs.size(); i++) {
         auto& tracked_obj = tracked_objs.at(i);
+        // Trackers of inserted clumps already know their owners
+        if (tracked_obj->ownerID != NULL_BODYID) {
+            continue;
+        }
         switch (tracked_obj->obj_type) {
             case (OWNER_TYPE::CLUMP):
                 tracked_obj->ownerID = nExistOwners + prescans_batch_size.at(tracked_obj->load_order);
@@ -939,6 +1102,7 @@ void DEMDynamicThread::initManagedArrays(const std::vector<std::shared_ptr<DEMCl
                                          const std::vector<unsigned int>& mesh_facet_owner,
                                          const std::vector<materialsOffset_t>& mesh_facet_materials,
                                          const std::vector<DEMTriangle>& mesh_facets,
+                                         const std::vector<bodyID_t>& mesh_facet_node_offsets,
                                          const std::unordered_map<unsigned int, std::string>& template_number_name_map,
                                          const ClumpTemplateFlatten& clump_templates,
                                          const std::vector<float>& ext_obj_mass_types,
@@ -959,8 +1123,9 @@ void DEMDynamicThread::initManagedArrays(const std::vector<std::shared_ptr<DEMCl
     // For initialization, owner array offset is 0
     populateEntityArrays(input_clump_batches, input_ext_obj_xyz, input_ext_obj_rot, input_ext_obj_family,
                          input_mesh_objs, input_mesh_obj_xyz, input_mesh_obj_rot, input_mesh_obj_family,
-                         mesh_facet_owner, mesh_facet_materials, mesh_facets, clump_templates, ext_obj_mass_types,
-                         ext_obj_moi_types, ext_obj_comp_num, mesh_obj_mass_types, mesh_obj_moi_types, 0, 0, 0);
+                         mesh_facet_owner, mesh_facet_materials, mesh_facets, mesh_facet_node_offsets,
+                         clump_templates, ext_obj_mass_types, ext_obj_moi_types, ext_obj_comp_num, mesh_obj_mass_types,
+                         mesh_obj_moi_types, 0, 0, 0);
 
     buildTrackedObjs(input_clump_batches, ext_obj_comp_num, input_mesh_objs, tracked_objs, 0, 0, 0, 0);
 }
@@ -976,6 +1141,7 @@ void DEMDynamicThread::updateClumpMeshArrays(const std::vector<std::shared_ptr<D
                                              const std::vector<unsigned int>& mesh_facet_owner,
                                              const std::vector<materialsOffset_t>& mesh_facet_materials,
                                              const std::vector<DEMTriangle>& mesh_facets,
+                                             const std::vector<bodyID_t>& mesh_facet_node_offsets,
                                              const ClumpTemplateFlatten& clump_templates,
                                              const std::vector<float>& ext_obj_mass_types,
                                              const std::vector<float3>& ext_obj_moi_types,
@@ -998,9 +1164,9 @@ void DEMDynamicThread::updateClumpMeshArrays(const std::vector<std::shared_ptr<D
     // Analytical objects-related arrays should be empty
     populateEntityArrays(input_clump_batches, input_ext_obj_xyz, input_ext_obj_rot, input_ext_obj_family,
                          input_mesh_objs, input_mesh_obj_xyz, input_mesh_obj_rot, input_mesh_obj_family,
-                         mesh_facet_owner, mesh_facet_materials, mesh_facets, clump_templates, ext_obj_mass_types,
-                         ext_obj_moi_types, ext_obj_comp_num, mesh_obj_mass_types, mesh_obj_moi_types, nExistingOwners,
-                         nExistingSpheres, nExistingFacets);
+                         mesh_facet_owner, mesh_facet_materials, mesh_facets, mesh_facet_node_offsets,
+                         clump_templates, ext_obj_mass_types, ext_obj_moi_types, ext_obj_comp_num, mesh_obj_mass_types,
+                         mesh_obj_moi_types, nExistingOwners, nExistingSpheres, nExistingFacets);
 
     // Make changes to tracked objects (potentially add more)
     buildTrackedObjs(input_clump_batches, ext_obj_comp_num, input_mesh_objs, tracked_objs, nExistingOwners,
@@ -1021,7 +1187,9 @@ void DEMDynamicThread::writeSpheresAsChpf(std::ofstream& ptFile) const {
     }
     size_t num_output_spheres = 0;
 
-    for (size_t i = 0; i < simParams->nSpheresGM; i++) {
+    // Spheres are written in the user-facing order, even if they are re-ordered in memory
+    for (size_t n = 0; n < simParams->nSpheresGM; n++) {
+        size_t i = getSphereImplID(n);
         auto this_owner = ownerClumpBody.at(i);
         family_t this_family = familyID.at(this_owner);
         // If this (impl-level) family is in the no-output list, skip it
@@ -1084,152 +1252,6 @@ void DEMDynamicThread::writeSpheresAsChpf(std::ofstream& ptFile) const {
 }
 #endif
 
-void DEMDynamicThread::writeSpheresAsCsv(std::ofstream& ptFile) const {
-    std::ostringstream outstrstream;
-
-    outstrstream << OUTPUT_FILE_X_COL_NAME + "," + OUTPUT_FILE_Y_COL_NAME + "," + OUTPUT_FILE_Z_COL_NAME + "," +
-                        OUTPUT_FILE_R_COL_NAME;
-
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ABSV) {
-        outstrstream << ",absv";
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::VEL) {
-        outstrstream << "," + OUTPUT_FILE_VEL_X_COL_NAME + "," + OUTPUT_FILE_VEL_Y_COL_NAME + "," +
-                            OUTPUT_FILE_VEL_Z_COL_NAME;
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL) {
-        outstrstream << "," + OUTPUT_FILE_ANGVEL_X_COL_NAME + "," + OUTPUT_FILE_ANGVEL_Y_COL_NAME + "," +
-                            OUTPUT_FILE_ANGVEL_Z_COL_NAME;
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC) {
-        outstrstream << ",abs_acc";
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ACC) {
-        outstrstream << ",a_x,a_y,a_z";
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC) {
-        outstrstream << ",alpha_x,alpha_y,alpha_z";
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY) {
-        outstrstream << ",family";
-    }
-    // if (solverFlags.outputFlags & OUTPUT_CONTENT::MAT) {
-    //     outstrstream << ",material";
-    // }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD) {
-        for (const auto& name : m_owner_wildcard_names) {
-            outstrstream << "," + name;
-        }
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::GEO_WILDCARD) {
-        for (const auto& name : m_geo_wildcard_names) {
-            outstrstream << "," + name;
-        }
-    }
-
-    outstrstream << "\n";
-
-    for (size_t i = 0; i < simParams->nSpheresGM; i++) {
-        auto this_owner = ownerClumpBody.at(i);
-        family_t this_family = familyID.at(this_owner);
-        // If this (impl-level) family is in the no-output list, skip it
-        if (std::binary_search(familiesNoOutput.begin(), familiesNoOutput.end(), this_family)) {
-            continue;
-        }
-
-        float3 CoM;
-        float3 pos;
-        float radius;
-        float X, Y, Z;
-        voxelID_t voxel = voxelID.at(this_owner);
-        subVoxelPos_t subVoxX = locX.at(this_owner);
-        subVoxelPos_t subVoxY = locY.at(this_owner);
-        subVoxelPos_t subVoxZ = locZ.at(this_owner);
-        hostVoxelIDToPosition<float, voxelID_t, subVoxelPos_t>(X, Y, Z, voxel, subVoxX, subVoxY, subVoxZ,
-                                                               simParams->nvXp2, simParams->nvYp2, simParams->voxelSize,
-                                                               simParams->l);
-        CoM.x = X + simParams->LBFX;
-        CoM.y = Y + simParams->LBFY;
-        CoM.z = Z + simParams->LBFZ;
-
-        size_t compOffset = (solverFlags.useClumpJitify) ? clumpComponentOffsetExt.at(i) : i;
-        float3 this_sp_deviation;
-        this_sp_deviation.x = relPosSphereX.at(compOffset);
-        this_sp_deviation.y = relPosSphereY.at(compOffset);
-        this_sp_deviation.z = relPosSphereZ.at(compOffset);
-        float this_sp_rot_0 = oriQw.at(this_owner);
-        float this_sp_rot_1 = oriQx.at(this_owner);
-        float this_sp_rot_2 = oriQy.at(this_owner);
-        float this_sp_rot_3 = oriQz.at(this_owner);
-        hostApplyOriQToVector3<float, float>(this_sp_deviation.x, this_sp_deviation.y, this_sp_deviation.z,
-                                             this_sp_rot_0, this_sp_rot_1, this_sp_rot_2, this_sp_rot_3);
-        pos = CoM + this_sp_deviation;
-        outstrstream << pos.x << "," << pos.y << "," << pos.z;
-
-        radius = radiiSphere.at(compOffset);
-        outstrstream << "," << radius;
-
-        // Only linear velocity
-        float3 vxyz, acc;
-        vxyz.x = vX.at(this_owner);
-        vxyz.y = vY.at(this_owner);
-        vxyz.z = vZ.at(this_owner);
-        acc.x = aX.at(this_owner);
-        acc.y = aY.at(this_owner);
-        acc.z = aZ.at(this_owner);
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ABSV) {
-            outstrstream << "," << length(vxyz);
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::VEL) {
-            outstrstream << "," << vxyz.x << "," << vxyz.y << "," << vxyz.z;
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL) {
-            float3 ang_v;
-            ang_v.x = omgBarX.at(this_owner);
-            ang_v.y = omgBarY.at(this_owner);
-            ang_v.z = omgBarZ.at(this_owner);
-            outstrstream << "," << ang_v.x << "," << ang_v.y << "," << ang_v.z;
-        }
-
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC) {
-            outstrstream << "," << length(acc);
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ACC) {
-            outstrstream << "," << acc.x << "," << acc.y << "," << acc.z;
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC) {
-            float3 ang_acc;
-            ang_acc.x = alphaX.at(this_owner);
-            ang_acc.y = alphaY.at(this_owner);
-            ang_acc.z = alphaZ.at(this_owner);
-            outstrstream << "," << ang_acc.x << "," << ang_acc.y << "," << ang_acc.z;
-        }
-
-        // Family number needs to be user number
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY) {
-            outstrstream << "," << +(this_family);
-        }
-
-        // Wildcards
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD) {
-            // The order shouldn't be an issue... the same set is being processed here and in equip_owner_wildcards, see
-            // Model.h
-            for (unsigned int j = 0; j < m_owner_wildcard_names.size(); j++) {
-                outstrstream << "," << ownerWildcards[j][i];
-            }
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::GEO_WILDCARD) {
-            for (unsigned int j = 0; j < m_geo_wildcard_names.size(); j++) {
-                outstrstream << "," << sphereWildcards[j][i];
-            }
-        }
-
-        outstrstream << "\n";
-    }
-
-    ptFile << outstrstream.str();
-}
-
 #ifdef DEME_USE_CHPF
 void DEMDynamicThread::writeClumpsAsChpf(std::ofstream& ptFile, unsigned int accuracy) const {
     //// TODO: Note using accuracy
@@ -1311,292 +1333,639 @@ void DEMDynamicThread::writeClumpsAsChpf(std::ofstream& ptFile, unsigned int acc
 }
 #endif
 
-void DEMDynamicThread::writeClumpsAsCsv(std::ofstream& ptFile, unsigned int accuracy) const {
-    std::ostringstream outstrstream;
-    outstrstream.precision(accuracy);
+// Copy the first n elements of a dT (managed) array to a host vector. Using cudaMemcpy rather than reading on host
+// avoids migrating the managed pages to host, which dT would have to migrate back soon.
+template <typename T, typename Alloc>
+inline void copyToSnapshot(std::vector<T>& dst, const std::vector<T, Alloc>& src, size_t n) {
+    n = DEME_MIN(n, src.size());
+    dst.resize(n);
+    if (n > 0) {
+        DEME_GPU_CALL(cudaMemcpy(dst.data(), src.data(), n * sizeof(T), cudaMemcpyDefault));
+    }
+}
 
-    // xyz and quaternion are always there
-    outstrstream << OUTPUT_FILE_X_COL_NAME + "," + OUTPUT_FILE_Y_COL_NAME + "," + OUTPUT_FILE_Z_COL_NAME +
-                        ",Qw,Qx,Qy,Qz," + OUTPUT_FILE_CLUMP_TYPE_NAME;
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ABSV) {
-        outstrstream << ",absv";
+// Gather the elements of a per-contact (or per-owner, per-sphere) dT array at the selected IDs to a host vector, using
+// buffer as the device scratch space
+template <typename T, typename IdxT>
+inline void gatherToSnapshot(std::shared_ptr<JitProgram>& misc_kernels,
+                             std::vector<T>& dst,
+                             T* src,
+                             IdxT* selected,
+                             char* buffer,
+                             size_t n,
+                             cudaStream_t& this_stream) {
+    dst.resize(n);
+    if (n == 0) {
+        return;
     }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::VEL) {
-        outstrstream << "," + OUTPUT_FILE_VEL_X_COL_NAME + "," + OUTPUT_FILE_VEL_Y_COL_NAME + "," +
-                            OUTPUT_FILE_VEL_Z_COL_NAME;
+    size_t blocks_needed = (n + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    misc_kernels->kernel(std::is_same<IdxT, contactPairs_t>::value ? "gatherContactsByPermutation"
+                                                                   : "gatherByPermutation")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+        .launch(buffer, (char*)src, selected, (unsigned int)sizeof(T), n);
+    DEME_GPU_CALL(cudaMemcpyAsync(dst.data(), buffer, n * sizeof(T), cudaMemcpyDeviceToHost, this_stream));
+    DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+}
+
+void DEMDynamicThread::copyFilteredContactsToSnapshot(DEMOutputSnapshot& snap, const DEMContactOutputFilter& filter) {
+    const size_t nContacts = *(stateOfSolver_resources.pNumContacts);
+    snap.contactsFiltered = true;
+    snap.nContacts = 0;
+    if (nContacts == 0) {
+        return;
     }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL) {
-        outstrstream << "," + OUTPUT_FILE_ANGVEL_X_COL_NAME + "," + OUTPUT_FILE_ANGVEL_Y_COL_NAME + "," +
-                            OUTPUT_FILE_ANGVEL_Z_COL_NAME;
+    int prev_device;
+    DEME_GPU_CALL(cudaGetDevice(&prev_device));
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+
+    notStupidBool_t* flags =
+        (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(0, nContacts * sizeof(notStupidBool_t));
+    contactPairs_t* selected =
+        (contactPairs_t*)stateOfSolver_resources.allocateTempVector(1, nContacts * sizeof(contactPairs_t));
+    notStupidBool_t* familyPass =
+        (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(2, NUM_AVAL_FAMILIES * sizeof(notStupidBool_t));
+    bodyID_t* analOwners = (bodyID_t*)stateOfSolver_resources.allocateTempVector(
+        3, DEME_MAX(ownerAnalBody.size(), (size_t)1) * sizeof(bodyID_t));
+    const bool filter_family = !filter.families.empty();
+    if (filter_family) {
+        std::vector<notStupidBool_t> pass(NUM_AVAL_FAMILIES, 0);
+        for (const auto& family : filter.families) {
+            pass.at(family) = 1;
+        }
+        DEME_GPU_CALL(cudaMemcpy(familyPass, pass.data(), NUM_AVAL_FAMILIES * sizeof(notStupidBool_t),
+                                 cudaMemcpyHostToDevice));
+        if (ownerAnalBody.size() > 0) {
+            DEME_GPU_CALL(cudaMemcpy(analOwners, ownerAnalBody.data(), ownerAnalBody.size() * sizeof(bodyID_t),
+                                     cudaMemcpyHostToDevice));
+        }
     }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC) {
-        outstrstream << ",abs_acc";
+
+    size_t blocks_needed = (nContacts + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    misc_kernels->kernel("markContactsForOutput")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+        .launch(simParams, granData, flags, familyPass, analOwners, filter.force_thres, filter_family,
+                filter.use_region, filter.region_min, filter.region_max, nContacts);
+    contactIDSelectFlagged(flags, selected, stateOfSolver_resources.pTempSizeVar1, nContacts, streamInfo.stream,
+                           stateOfSolver_resources);
+    const size_t nSelected = *(stateOfSolver_resources.pTempSizeVar1);
+    snap.nContacts = nSelected;
+
+    // Only the columns that are going to be written are gathered and copied
+    char* buffer =
+        (char*)stateOfSolver_resources.allocateTempVector(4, DEME_MAX(nSelected, (size_t)1) * sizeof(float3));
+    const unsigned int flags_out = solverFlags.cntOutFlags;
+    gatherToSnapshot(misc_kernels, snap.idGeometryA, granData->idGeometryA, selected, buffer, nSelected,
+                     streamInfo.stream);
+    gatherToSnapshot(misc_kernels, snap.idGeometryB, granData->idGeometryB, selected, buffer, nSelected,
+                     streamInfo.stream);
+    gatherToSnapshot(misc_kernels, snap.contactType, granData->contactType, selected, buffer, nSelected,
+                     streamInfo.stream);
+    if (flags_out & CNT_OUTPUT_CONTENT::FORCE) {
+        gatherToSnapshot(misc_kernels, snap.contactForces, granData->contactForces, selected, buffer, nSelected,
+                         streamInfo.stream);
     }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ACC) {
-        outstrstream << ",a_x,a_y,a_z";
+    if (flags_out & CNT_OUTPUT_CONTENT::TORQUE) {
+        gatherToSnapshot(misc_kernels, snap.contactTorque_convToForce, granData->contactTorque_convToForce, selected,
+                         buffer, nSelected, streamInfo.stream);
     }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC) {
-        outstrstream << ",alpha_x,alpha_y,alpha_z";
+    if (flags_out & (CNT_OUTPUT_CONTENT::DEME_POINT | CNT_OUTPUT_CONTENT::NORMAL | CNT_OUTPUT_CONTENT::TORQUE)) {
+        gatherToSnapshot(misc_kernels, snap.contactPointGeometryA, granData->contactPointGeometryA, selected, buffer,
+                         nSelected, streamInfo.stream);
     }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY) {
-        outstrstream << ",family";
+    if (flags_out & CNT_OUTPUT_CONTENT::CNT_WILDCARD) {
+        snap.contactWildcards.resize(simParams->nContactWildcards);
+        for (unsigned int i = 0; i < simParams->nContactWildcards; i++) {
+            gatherToSnapshot(misc_kernels, snap.contactWildcards[i], granData->contactWildcards[i], selected, buffer,
+                             nSelected, streamInfo.stream);
+        }
+        unpackContactWildcards(snap.contactWildcards);
     }
+    DEME_GPU_CALL(cudaSetDevice(prev_device));
+}
+
+void DEMDynamicThread::copyFilteredOwnersToSnapshot(DEMOutputSnapshot& snap,
+                                                    bool spheres,
+                                                    const DEMOwnerOutputFilter& filter) {
+    const size_t nOwners = simParams->nOwnerBodies;
+    const size_t nSpheres = simParams->nSpheresGM;
+    snap.simParamsCopy.nOwnerBodies = 0;
+    snap.simParamsCopy.nSpheresGM = 0;
+    if (nOwners == 0) {
+        return;
+    }
+    int prev_device;
+    DEME_GPU_CALL(cudaGetDevice(&prev_device));
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    cudaStream_t& stream = streamInfo.stream;
+
+    // The region test is the inspector's; it marks the owners that are not in the region
+    notStupidBool_t* ownerFlags =
+        (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(0, nOwners * sizeof(notStupidBool_t));
+    DEME_GPU_CALL(cudaMemsetAsync(ownerFlags, 0, nOwners * sizeof(notStupidBool_t), stream));
+    size_t blocks_needed = (nOwners + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    if (filter.region) {
+        filter.region->inspection_kernel->kernel(filter.region->kernel_name)
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, stream)
+            .launch(granData, simParams, (float*)nullptr, ownerFlags, nOwners,
+                    (ownerType_t)(OWNER_T_CLUMP | OWNER_T_MESH | OWNER_T_ANALYTICAL));
+    }
+    misc_kernels->kernel("markOwnersForOutput")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, stream)
+        .launch(ownerFlags, filter.stride, nOwners);
+    bodyID_t* selectedOwners = (bodyID_t*)stateOfSolver_resources.allocateTempVector(1, nOwners * sizeof(bodyID_t));
+    bodyIDSelectFlagged(ownerFlags, selectedOwners, stateOfSolver_resources.pTempSizeVar1, nOwners, stream,
+                        stateOfSolver_resources);
+    const size_t nSelOwners = *(stateOfSolver_resources.pTempSizeVar1);
+
+    // The spheres of the selected owners, kept in the user-facing order. After this, selectedSpheres holds their impl
+    // IDs and newOwners their owners' positions in selectedOwners.
+    size_t nSelSpheres = 0;
+    bodyID_t* selectedSpheres = nullptr;
+    bodyID_t* newOwners = nullptr;
+    if (spheres && nSpheres > 0) {
+        notStupidBool_t* sphereFlags =
+            (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(3, nSpheres * sizeof(notStupidBool_t));
+        bodyID_t* userToImpl = nullptr;
+        if (sphereUserToImpl.size() > 0) {
+            userToImpl = (bodyID_t*)stateOfSolver_resources.allocateTempVector(4, nSpheres * sizeof(bodyID_t));
+            DEME_GPU_CALL(cudaMemcpyAsync(userToImpl, sphereUserToImpl.data(), nSpheres * sizeof(bodyID_t),
+                                          cudaMemcpyHostToDevice, stream));
+        }
+        size_t sphere_blocks = (nSpheres + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+        misc_kernels->kernel("markSpheresForOutput")
+            .instantiate()
+            .configure(dim3(sphere_blocks), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, stream)
+            .launch(granData, ownerFlags, userToImpl, sphereFlags, nSpheres);
+        selectedSpheres = (bodyID_t*)stateOfSolver_resources.allocateTempVector(5, nSpheres * sizeof(bodyID_t));
+        bodyIDSelectFlagged(sphereFlags, selectedSpheres, stateOfSolver_resources.pTempSizeVar2, nSpheres,
+                            stream, stateOfSolver_resources);
+        nSelSpheres = *(stateOfSolver_resources.pTempSizeVar2);
+        newOwners = (bodyID_t*)stateOfSolver_resources.allocateTempVector(6, DEME_MAX(nSelSpheres, (size_t)1) *
+                                                                                 sizeof(bodyID_t));
+        if (nSelSpheres > 0) {
+            sphere_blocks = (nSelSpheres + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+            misc_kernels->kernel("mapSelectedSpheresForOutput")
+                .instantiate()
+                .configure(dim3(sphere_blocks), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, stream)
+                .launch(granData, selectedSpheres, userToImpl, selectedOwners, nSelOwners, newOwners, nSelSpheres);
+        }
+    }
+    snap.simParamsCopy.nOwnerBodies = nSelOwners;
+    snap.simParamsCopy.nSpheresGM = nSelSpheres;
+
+    char* buffer = (char*)stateOfSolver_resources.allocateTempVector(
+        2, DEME_MAX(DEME_MAX(nSelOwners, nSelSpheres), (size_t)1) * sizeof(float3));
+    gatherToSnapshot(misc_kernels, snap.ownerTypes, ownerTypes.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.inertiaPropOffsets, inertiaPropOffsets.data(), selectedOwners, buffer,
+                     nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.familyID, familyID.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.voxelID, voxelID.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.locX, locX.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.locY, locY.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.locZ, locZ.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.oriQw, oriQw.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.oriQx, oriQx.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.oriQy, oriQy.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.oriQz, oriQz.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.vX, vX.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.vY, vY.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.vZ, vZ.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.omgBarX, omgBarX.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.omgBarY, omgBarY.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.omgBarZ, omgBarZ.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.aX, aX.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.aY, aY.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.aZ, aZ.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.alphaX, alphaX.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.alphaY, alphaY.data(), selectedOwners, buffer, nSelOwners, stream);
+    gatherToSnapshot(misc_kernels, snap.alphaZ, alphaZ.data(), selectedOwners, buffer, nSelOwners, stream);
     if (solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD) {
-        for (const auto& name : m_owner_wildcard_names) {
-            outstrstream << "," + name;
+        snap.ownerWildcards.resize(ownerWildcards.size());
+        for (unsigned int i = 0; i < ownerWildcards.size(); i++) {
+            gatherToSnapshot(misc_kernels, snap.ownerWildcards[i], ownerWildcards[i].data(), selectedOwners, buffer,
+                             nSelOwners, stream);
         }
     }
-    outstrstream << "\n";
-
-    for (size_t i = 0; i < simParams->nOwnerBodies; i++) {
-        // i is this owner's number. And if it is not a clump, we can move on.
-        if (ownerTypes.at(i) != OWNER_T_CLUMP)
-            continue;
 
-        family_t this_family = familyID.at(i);
-        // If this (impl-level) family is in the no-output list, skip it
-        if (std::binary_search(familiesNoOutput.begin(), familiesNoOutput.end(), this_family)) {
-            continue;
+    if (spheres) {
+        // The owner IDs of the spheres are already the ones in the snapshot, and the spheres are in the user order
+        snap.ownerClumpBody.resize(nSelSpheres);
+        if (nSelSpheres > 0) {
+            DEME_GPU_CALL(cudaMemcpy(snap.ownerClumpBody.data(), newOwners, nSelSpheres * sizeof(bodyID_t),
+                                     cudaMemcpyDeviceToHost));
+        }
+        if (solverFlags.useClumpJitify) {
+            // Then radii and relPos are per template component, and the spheres point into them
+            gatherToSnapshot(misc_kernels, snap.clumpComponentOffsetExt, clumpComponentOffsetExt.data(),
+                             selectedSpheres, buffer, nSelSpheres, stream);
+            copyToSnapshot(snap.radiiSphere, radiiSphere, radiiSphere.size());
+            copyToSnapshot(snap.relPosSphereX, relPosSphereX, relPosSphereX.size());
+            copyToSnapshot(snap.relPosSphereY, relPosSphereY, relPosSphereY.size());
+            copyToSnapshot(snap.relPosSphereZ, relPosSphereZ, relPosSphereZ.size());
+        } else {
+            gatherToSnapshot(misc_kernels, snap.radiiSphere, radiiSphere.data(), selectedSpheres, buffer, nSelSpheres,
+                             stream);
+            gatherToSnapshot(misc_kernels, snap.relPosSphereX, relPosSphereX.data(), selectedSpheres, buffer,
+                             nSelSpheres, stream);
+            gatherToSnapshot(misc_kernels, snap.relPosSphereY, relPosSphereY.data(), selectedSpheres, buffer,
+                             nSelSpheres, stream);
+            gatherToSnapshot(misc_kernels, snap.relPosSphereZ, relPosSphereZ.data(), selectedSpheres, buffer,
+                             nSelSpheres, stream);
+        }
+        if (solverFlags.outputFlags & OUTPUT_CONTENT::GEO_WILDCARD) {
+            snap.sphereWildcards.resize(sphereWildcards.size());
+            for (unsigned int i = 0; i < sphereWildcards.size(); i++) {
+                gatherToSnapshot(misc_kernels, snap.sphereWildcards[i], sphereWildcards[i].data(), selectedSpheres,
+                                 buffer, nSelSpheres, stream);
+            }
         }
+    }
+    DEME_GPU_CALL(cudaSetDevice(prev_device));
+}
 
-        float3 CoM;
-        float X, Y, Z;
-        voxelID_t voxel = voxelID.at(i);
-        subVoxelPos_t subVoxX = locX.at(i);
-        subVoxelPos_t subVoxY = locY.at(i);
-        subVoxelPos_t subVoxZ = locZ.at(i);
-        hostVoxelIDToPosition<float, voxelID_t, subVoxelPos_t>(X, Y, Z, voxel, subVoxX, subVoxY, subVoxZ,
-                                                               simParams->nvXp2, simParams->nvYp2, simParams->voxelSize,
-                                                               simParams->l);
-        CoM.x = X + simParams->LBFX;
-        CoM.y = Y + simParams->LBFY;
-        CoM.z = Z + simParams->LBFZ;
-        // Output position
-        outstrstream << CoM.x << "," << CoM.y << "," << CoM.z;
+std::shared_ptr<DEMOutputSnapshot> DEMDynamicThread::takeOutputSnapshot(bool spheres,
+                                                                        bool contacts,
+                                                                        const DEMContactOutputFilter* cnt_filter,
+                                                                        const DEMOwnerOutputFilter* owner_filter) {
+    auto snap = std::make_shared<DEMOutputSnapshot>();
+    snap->simParamsCopy = *simParams;
+    snap->solverFlags.outputFlags = solverFlags.outputFlags;
+    snap->solverFlags.cntOutFlags = solverFlags.cntOutFlags;
+    snap->solverFlags.useClumpJitify = solverFlags.useClumpJitify;
+    copyToSnapshot(snap->familiesNoOutput, familiesNoOutput, familiesNoOutput.size());
+    snap->templateNumNameMap = templateNumNameMap;
+    snap->m_owner_wildcard_names = m_owner_wildcard_names;
+    snap->m_geo_wildcard_names = m_geo_wildcard_names;
+
+    // Filtered owners are compacted, so the (owner and sphere ID based) contact info would not make sense with them
+    if (owner_filter && owner_filter->IsActive()) {
+        if (contacts) {
+            DEME_ERROR("Contact info cannot be put in an output snapshot of filtered owners.");
+        }
+        copyFilteredOwnersToSnapshot(*snap, spheres, *owner_filter);
+        return snap;
+    }
 
-        // Then quaternions
-        outstrstream << "," << oriQw.at(i) << "," << oriQx.at(i) << "," << oriQy.at(i) << "," << oriQz.at(i);
+    // Owner info is needed by all kinds of output files
+    size_t nOwners = simParams->nOwnerBodies;
+    copyToSnapshot(snap->ownerTypes, ownerTypes, nOwners);
+    copyToSnapshot(snap->inertiaPropOffsets, inertiaPropOffsets, nOwners);
+    copyToSnapshot(snap->familyID, familyID, nOwners);
+    copyToSnapshot(snap->voxelID, voxelID, nOwners);
+    copyToSnapshot(snap->locX, locX, nOwners);
+    copyToSnapshot(snap->locY, locY, nOwners);
+    copyToSnapshot(snap->locZ, locZ, nOwners);
+    copyToSnapshot(snap->oriQw, oriQw, nOwners);
+    copyToSnapshot(snap->oriQx, oriQx, nOwners);
+    copyToSnapshot(snap->oriQy, oriQy, nOwners);
+    copyToSnapshot(snap->oriQz, oriQz, nOwners);
+    copyToSnapshot(snap->vX, vX, nOwners);
+    copyToSnapshot(snap->vY, vY, nOwners);
+    copyToSnapshot(snap->vZ, vZ, nOwners);
+    copyToSnapshot(snap->omgBarX, omgBarX, nOwners);
+    copyToSnapshot(snap->omgBarY, omgBarY, nOwners);
+    copyToSnapshot(snap->omgBarZ, omgBarZ, nOwners);
+    copyToSnapshot(snap->aX, aX, nOwners);
+    copyToSnapshot(snap->aY, aY, nOwners);
+    copyToSnapshot(snap->aZ, aZ, nOwners);
+    copyToSnapshot(snap->alphaX, alphaX, nOwners);
+    copyToSnapshot(snap->alphaY, alphaY, nOwners);
+    copyToSnapshot(snap->alphaZ, alphaZ, nOwners);
+    if (solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD) {
+        snap->ownerWildcards.resize(ownerWildcards.size());
+        for (unsigned int i = 0; i < ownerWildcards.size(); i++) {
+            copyToSnapshot(snap->ownerWildcards[i], ownerWildcards[i], nOwners);
+        }
+    }
 
-        // Then type of clump
-        unsigned int clump_mark = inertiaPropOffsets.at(i);
-        outstrstream << "," << templateNumNameMap.at(clump_mark);
-
-        // Only linear velocity
-        float3 vxyz, ang_v, acc, ang_acc;
-        vxyz.x = vX.at(i);
-        vxyz.y = vY.at(i);
-        vxyz.z = vZ.at(i);
-        acc.x = aX.at(i);
-        acc.y = aY.at(i);
-        acc.z = aZ.at(i);
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ABSV) {
-            outstrstream << "," << length(vxyz);
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::VEL) {
-            outstrstream << "," << vxyz.x << "," << vxyz.y << "," << vxyz.z;
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL) {
-            ang_v.x = omgBarX.at(i);
-            ang_v.y = omgBarY.at(i);
-            ang_v.z = omgBarZ.at(i);
-            outstrstream << "," << ang_v.x << "," << ang_v.y << "," << ang_v.z;
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC) {
-            outstrstream << "," << length(acc);
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ACC) {
-            outstrstream << "," << acc.x << "," << acc.y << "," << acc.z;
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC) {
-            ang_acc.x = alphaX.at(i);
-            ang_acc.y = alphaY.at(i);
-            ang_acc.z = alphaZ.at(i);
-            outstrstream << "," << ang_acc.x << "," << ang_acc.y << "," << ang_acc.z;
-        }
-
-        // Family number needs to be user number
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY) {
-            outstrstream << "," << +(this_family);
+    // Sphere info is needed by sphere and contact files
+    if (spheres || contacts) {
+        copyToSnapshot(snap->ownerClumpBody, ownerClumpBody, simParams->nSpheresGM);
+        snap->sphereUserToImpl = sphereUserToImpl;
+        snap->sphereImplToUser = sphereImplToUser;
+        copyToSnapshot(snap->clumpComponentOffsetExt, clumpComponentOffsetExt, clumpComponentOffsetExt.size());
+        copyToSnapshot(snap->radiiSphere, radiiSphere, radiiSphere.size());
+        copyToSnapshot(snap->relPosSphereX, relPosSphereX, relPosSphereX.size());
+        copyToSnapshot(snap->relPosSphereY, relPosSphereY, relPosSphereY.size());
+        copyToSnapshot(snap->relPosSphereZ, relPosSphereZ, relPosSphereZ.size());
+    }
+    if (spheres && (solverFlags.outputFlags & OUTPUT_CONTENT::GEO_WILDCARD)) {
+        snap->sphereWildcards.resize(sphereWildcards.size());
+        for (unsigned int i = 0; i < sphereWildcards.size(); i++) {
+            copyToSnapshot(snap->sphereWildcards[i], sphereWildcards[i], simParams->nSpheresGM);
         }
+    }
 
-        // Wildcards
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD) {
-            // The order shouldn't be an issue... the same set is being processed here and in equip_owner_wildcards, see
-            // Model.h
-            for (unsigned int j = 0; j < m_owner_wildcard_names.size(); j++) {
-                outstrstream << "," << ownerWildcards[j][i];
+    if (contacts && cnt_filter) {
+        copyToSnapshot(snap->ownerMesh, ownerMesh, ownerMesh.size());
+        snap->ownerAnalBody = ownerAnalBody;
+        copyFilteredContactsToSnapshot(*snap, *cnt_filter);
+        snap->m_contact_wildcard_names = m_contact_wildcard_names;
+    } else if (contacts) {
+        size_t nContacts = *(stateOfSolver_resources.pNumContacts);
+        snap->nContacts = nContacts;
+        copyToSnapshot(snap->ownerMesh, ownerMesh, ownerMesh.size());
+        snap->ownerAnalBody = ownerAnalBody;
+        copyToSnapshot(snap->idGeometryA, idGeometryA, nContacts);
+        copyToSnapshot(snap->idGeometryB, idGeometryB, nContacts);
+        copyToSnapshot(snap->contactType, contactType, nContacts);
+        copyToSnapshot(snap->contactForces, contactForces, nContacts);
+        copyToSnapshot(snap->contactTorque_convToForce, contactTorque_convToForce, nContacts);
+        copyToSnapshot(snap->contactPointGeometryA, contactPointGeometryA, nContacts);
+        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::CNT_WILDCARD) {
+            snap->contactWildcards.resize(contactWildcards.size());
+            for (unsigned int i = 0; i < contactWildcards.size(); i++) {
+                copyToSnapshot(snap->contactWildcards[i], contactWildcards[i], nContacts);
             }
+            unpackContactWildcards(snap->contactWildcards);
         }
-
-        outstrstream << "\n";
+        snap->m_contact_wildcard_names = m_contact_wildcard_names;
     }
-
-    ptFile << outstrstream.str();
+    return snap;
 }
 
-inline bodyID_t DEMDynamicThread::getOwnerForContactB(const bodyID_t& geoB, const contact_t& type) const {
-    switch (type) {
-        case (SPHERE_SPHERE_CONTACT):
-            return ownerClumpBody.at(geoB);
-        case (SPHERE_MESH_CONTACT):
-            return ownerMesh.at(geoB);
-        default:  // Default is sphere--analytical
-            return ownerAnalBody.at(geoB);
+// Copy the first n elements of a dT (managed) array to a new checkpoint section
+template <typename T, typename Alloc>
+inline void addToCheckpoint(DEMCheckpointWriter& ckpt,
+                            const std::string& name,
+                            const std::vector<T, Alloc>& src,
+                            size_t n) {
+    char* dst = ckpt.AddSection(name, n * sizeof(T));
+    if (n > 0) {
+        DEME_GPU_CALL(cudaMemcpy(dst, src.data(), n * sizeof(T), cudaMemcpyDefault));
     }
 }
 
-void DEMDynamicThread::writeContactsAsCsv(std::ofstream& ptFile, float force_thres) const {
-    std::ostringstream outstrstream;
-
-    outstrstream << OUTPUT_FILE_CNT_TYPE_NAME;
-    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::OWNER) {
-        outstrstream << "," + OUTPUT_FILE_OWNER_1_NAME + "," + OUTPUT_FILE_OWNER_2_NAME;
+// Read a checkpoint section of n elements to the first n elements of a dT (managed) array
+template <typename T, typename Alloc>
+inline void readFromCheckpoint(DEMCheckpointReader& ckpt,
+                               const std::string& name,
+                               std::vector<T, Alloc>& dst,
+                               size_t n) {
+    std::vector<T> host(n);
+    ckpt.Read(name, host.data(), n * sizeof(T));
+    if (n > 0) {
+        DEME_GPU_CALL(cudaMemcpy(dst.data(), host.data(), n * sizeof(T), cudaMemcpyDefault));
     }
-    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::GEO_ID) {
-        outstrstream << "," + OUTPUT_FILE_GEO_ID_1_NAME + "," + OUTPUT_FILE_GEO_ID_2_NAME;
+}
+
+void DEMDynamicThread::writeCheckpoint(DEMCheckpointWriter& ckpt) {
+    const size_t nOwners = simParams->nOwnerBodies;
+    const size_t nSpheres = simParams->nSpheresGM;
+    const size_t nContacts = *(stateOfSolver_resources.pNumContacts);
+    ckpt.AddValue<uint64_t>("nOwnerBodies", nOwners);
+    ckpt.AddValue<uint64_t>("nSpheresGM", nSpheres);
+    ckpt.AddValue<uint64_t>("nTriGM", simParams->nTriGM);
+    ckpt.AddValue<uint64_t>("nContacts", nContacts);
+    ckpt.AddValue<double>("timeElapsed", simParams->timeElapsed);
+    ckpt.AddValue<float>("h", simParams->h);
+    ckpt.AddValue<uint64_t>("nTotalSteps", nTotalSteps);
+
+    // Owner states
+    addToCheckpoint(ckpt, "familyID", familyID, nOwners);
+    addToCheckpoint(ckpt, "voxelID", voxelID, nOwners);
+    addToCheckpoint(ckpt, "locX", locX, nOwners);
+    addToCheckpoint(ckpt, "locY", locY, nOwners);
+    addToCheckpoint(ckpt, "locZ", locZ, nOwners);
+    addToCheckpoint(ckpt, "oriQw", oriQw, nOwners);
+    addToCheckpoint(ckpt, "oriQx", oriQx, nOwners);
+    addToCheckpoint(ckpt, "oriQy", oriQy, nOwners);
+    addToCheckpoint(ckpt, "oriQz", oriQz, nOwners);
+    addToCheckpoint(ckpt, "vX", vX, nOwners);
+    addToCheckpoint(ckpt, "vY", vY, nOwners);
+    addToCheckpoint(ckpt, "vZ", vZ, nOwners);
+    addToCheckpoint(ckpt, "omgBarX", omgBarX, nOwners);
+    addToCheckpoint(ckpt, "omgBarY", omgBarY, nOwners);
+    addToCheckpoint(ckpt, "omgBarZ", omgBarZ, nOwners);
+    addToCheckpoint(ckpt, "aX", aX, nOwners);
+    addToCheckpoint(ckpt, "aY", aY, nOwners);
+    addToCheckpoint(ckpt, "aZ", aZ, nOwners);
+    addToCheckpoint(ckpt, "alphaX", alphaX, nOwners);
+    addToCheckpoint(ckpt, "alphaY", alphaY, nOwners);
+    addToCheckpoint(ckpt, "alphaZ", alphaZ, nOwners);
+    addToCheckpoint(ckpt, "familyMaskMatrix", familyMaskMatrix, familyMaskMatrix.size());
+    // Wildcards are stored by name, so a simulation that has them in a different order can still load them
+    {
+        unsigned int j = 0;
+        for (const auto& name : m_owner_wildcard_names) {
+            addToCheckpoint(ckpt, "ownerWildcard:" + name, ownerWildcards[j++], nOwners);
+        }
     }
-    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::FORCE) {
-        outstrstream << "," + OUTPUT_FILE_FORCE_X_NAME + "," + OUTPUT_FILE_FORCE_Y_NAME + "," +
-                            OUTPUT_FILE_FORCE_Z_NAME;
+
+    // Sphere states, in the user-facing sphere order
+    std::vector<float> implArr(nSpheres);
+    {
+        unsigned int j = 0;
+        for (const auto& name : m_geo_wildcard_names) {
+            copyToSnapshot(implArr, sphereWildcards[j++], nSpheres);
+            float* dst = (float*)ckpt.AddSection("geoWildcard:" + name, nSpheres * sizeof(float));
+            for (size_t n = 0; n < nSpheres; n++) {
+                dst[n] = implArr[getSphereImplID(n)];
+            }
+        }
     }
-    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::DEME_POINT) {
-        outstrstream << "," + OUTPUT_FILE_X_COL_NAME + "," + OUTPUT_FILE_Y_COL_NAME + "," + OUTPUT_FILE_Z_COL_NAME;
+
+    // The contact list and its history, with user-facing sphere IDs
+    std::vector<bodyID_t> idA, idB;
+    std::vector<contact_t> cType;
+    copyToSnapshot(idA, idGeometryA, nContacts);
+    copyToSnapshot(idB, idGeometryB, nContacts);
+    copyToSnapshot(cType, contactType, nContacts);
+    for (size_t i = 0; i < nContacts; i++) {
+        idA[i] = getSphereUserID(idA[i]);
+        if (cType[i] == SPHERE_SPHERE_CONTACT) {
+            idB[i] = getSphereUserID(idB[i]);
+        }
     }
-    // if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::COMPONENT) {
-    //     outstrstream << ","+OUTPUT_FILE_COMP_1_NAME+","+OUTPUT_FILE_COMP_2_NAME;
-    // }
-    // if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::NICKNAME) {
-    //     outstrstream << ","+OUTPUT_FILE_OWNER_NICKNAME_1_NAME+","+OUTPUT_FILE_OWNER_NICKNAME_2_NAME;
-    // }
-    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::NORMAL) {
-        outstrstream << "," + OUTPUT_FILE_NORMAL_X_NAME + "," + OUTPUT_FILE_NORMAL_Y_NAME + "," +
-                            OUTPUT_FILE_NORMAL_Z_NAME;
+    std::memcpy(ckpt.AddSection("idGeometryA", nContacts * sizeof(bodyID_t)), idA.data(), nContacts * sizeof(bodyID_t));
+    std::memcpy(ckpt.AddSection("idGeometryB", nContacts * sizeof(bodyID_t)), idB.data(), nContacts * sizeof(bodyID_t));
+    std::memcpy(ckpt.AddSection("contactType", nContacts * sizeof(contact_t)), cType.data(),
+                nContacts * sizeof(contact_t));
+    {
+        unsigned int j = 0;
+        // Always saved as floats, so a checkpoint does not depend on the storage precision
+        std::vector<float> cntWildcard(nContacts);
+        for (const auto& name : m_contact_wildcard_names) {
+            for (size_t i = 0; i < nContacts; i++) {
+                cntWildcard[i] = getContactWildcard(j, i);
+            }
+            addToCheckpoint(ckpt, "contactWildcard:" + name, cntWildcard, nContacts);
+            j++;
+        }
     }
-    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::TORQUE) {
-        outstrstream << "," + OUTPUT_FILE_TORQUE_X_NAME + "," + OUTPUT_FILE_TORQUE_Y_NAME + "," +
-                            OUTPUT_FILE_TORQUE_Z_NAME;
+}
+
+void DEMDynamicThread::readCheckpoint(DEMCheckpointReader& ckpt) {
+    const size_t nOwners = simParams->nOwnerBodies;
+    const size_t nSpheres = simParams->nSpheresGM;
+    const size_t ckptOwners = ckpt.ReadValue<uint64_t>("nOwnerBodies");
+    const size_t ckptSpheres = ckpt.ReadValue<uint64_t>("nSpheresGM");
+    const size_t ckptTris = ckpt.ReadValue<uint64_t>("nTriGM");
+    if (ckptOwners != nOwners || ckptSpheres != nSpheres || ckptTris != simParams->nTriGM) {
+        DEME_ERROR(
+            "The checkpoint has %zu owners, %zu spheres and %zu triangles, but this simulation has %zu, %zu and "
+            "%zu.\nA checkpoint can only be loaded into a simulation that has the same clumps, meshes and analytical "
+            "objects.",
+            ckptOwners, ckptSpheres, ckptTris, nOwners, nSpheres, (size_t)simParams->nTriGM);
     }
-    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::CNT_WILDCARD) {
-        // Write all wildcard names as header
-        for (const auto& w_name : m_contact_wildcard_names) {
-            outstrstream << "," + w_name;
+    simParams->timeElapsed = ckpt.ReadValue<double>("timeElapsed");
+    simParams->h = ckpt.ReadValue<float>("h");
+    nTotalSteps = ckpt.ReadValue<uint64_t>("nTotalSteps");
+
+    readFromCheckpoint(ckpt, "familyID", familyID, nOwners);
+    readFromCheckpoint(ckpt, "voxelID", voxelID, nOwners);
+    readFromCheckpoint(ckpt, "locX", locX, nOwners);
+    readFromCheckpoint(ckpt, "locY", locY, nOwners);
+    readFromCheckpoint(ckpt, "locZ", locZ, nOwners);
+    readFromCheckpoint(ckpt, "oriQw", oriQw, nOwners);
+    readFromCheckpoint(ckpt, "oriQx", oriQx, nOwners);
+    readFromCheckpoint(ckpt, "oriQy", oriQy, nOwners);
+    readFromCheckpoint(ckpt, "oriQz", oriQz, nOwners);
+    readFromCheckpoint(ckpt, "vX", vX, nOwners);
+    readFromCheckpoint(ckpt, "vY", vY, nOwners);
+    readFromCheckpoint(ckpt, "vZ", vZ, nOwners);
+    readFromCheckpoint(ckpt, "omgBarX", omgBarX, nOwners);
+    readFromCheckpoint(ckpt, "omgBarY", omgBarY, nOwners);
+    readFromCheckpoint(ckpt, "omgBarZ", omgBarZ, nOwners);
+    readFromCheckpoint(ckpt, "aX", aX, nOwners);
+    readFromCheckpoint(ckpt, "aY", aY, nOwners);
+    readFromCheckpoint(ckpt, "aZ", aZ, nOwners);
+    readFromCheckpoint(ckpt, "alphaX", alphaX, nOwners);
+    readFromCheckpoint(ckpt, "alphaY", alphaY, nOwners);
+    readFromCheckpoint(ckpt, "alphaZ", alphaZ, nOwners);
+    readFromCheckpoint(ckpt, "familyMaskMatrix", familyMaskMatrix, familyMaskMatrix.size());
+    // kT does contact detection with these, and it may not get families from dT during the run
+    DEME_GPU_CALL(cudaMemcpy(kT->familyID.data(), familyID.data(), nOwners * sizeof(family_t), cudaMemcpyDefault));
+    DEME_GPU_CALL(cudaMemcpy(kT->familyMaskMatrix.data(), familyMaskMatrix.data(),
+                             familyMaskMatrix.size() * sizeof(notStupidBool_t), cudaMemcpyDefault));
+    {
+        unsigned int j = 0;
+        for (const auto& name : m_owner_wildcard_names) {
+            if (ckpt.Has("ownerWildcard:" + name)) {
+                readFromCheckpoint(ckpt, "ownerWildcard:" + name, ownerWildcards[j], nOwners);
+            } else {
+                DEME_WARNING("Owner wildcard %s is not in the checkpoint, so its current values are kept.",
+                             name.c_str());
+            }
+            j++;
         }
     }
-    outstrstream << "\n";
 
-    for (size_t i = 0; i < *(stateOfSolver_resources.pNumContacts); i++) {
-        // Geos that are involved in this contact
-        auto geoA = idGeometryA.at(i);
-        auto geoB = idGeometryB.at(i);
-        auto type = contactType.at(i);
-        // We don't output fake contacts; but right now, no contact will be marked fake by kT, so no need to check that
-        // if (type == NOT_A_CONTACT)
-        //     continue;
-
-        float3 forcexyz = contactForces.at(i);
-        float3 torque = contactTorque_convToForce.at(i);
-        // If this force+torque is too small, then it's not an active contact
-        if (length(forcexyz + torque) < force_thres) {
-            continue;
+    std::vector<float> userArr(nSpheres), implArr(nSpheres);
+    {
+        unsigned int j = 0;
+        for (const auto& name : m_geo_wildcard_names) {
+            if (ckpt.Has("geoWildcard:" + name)) {
+                ckpt.Read("geoWildcard:" + name, userArr.data(), nSpheres * sizeof(float));
+                for (size_t n = 0; n < nSpheres; n++) {
+                    implArr[getSphereImplID(n)] = userArr[n];
+                }
+                DEME_GPU_CALL(cudaMemcpy(sphereWildcards[j].data(), implArr.data(), nSpheres * sizeof(float),
+                                         cudaMemcpyDefault));
+            } else {
+                DEME_WARNING("Geometry wildcard %s is not in the checkpoint, so its current values are kept.",
+                             name.c_str());
+            }
+            j++;
         }
+    }
 
-        // geoA's owner must be a sphere
-        auto ownerA = ownerClumpBody.at(geoA);
-        bodyID_t ownerB;
-        // geoB's owner depends...
-        ownerB = getOwnerForContactB(geoB, type);
-
-        // Type is mapped to SS, SM and such....
-        outstrstream << contact_type_out_name_map.at(type);
-
-        // (Internal) ownerID and/or geometry ID
-        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::OWNER) {
-            outstrstream << "," << ownerA << "," << ownerB;
+    // The contact list, with sphere IDs turned into the ones of this run
+    const size_t nContacts = ckpt.ReadValue<uint64_t>("nContacts");
+    std::vector<bodyID_t> idA(nContacts), idB(nContacts);
+    std::vector<contact_t> cType(nContacts);
+    ckpt.Read("idGeometryA", idA.data(), nContacts * sizeof(bodyID_t));
+    ckpt.Read("idGeometryB", idB.data(), nContacts * sizeof(bodyID_t));
+    ckpt.Read("contactType", cType.data(), nContacts * sizeof(contact_t));
+    for (size_t i = 0; i < nContacts; i++) {
+        idA[i] = getSphereImplID(idA[i]);
+        if (cType[i] == SPHERE_SPHERE_CONTACT) {
+            idB[i] = getSphereImplID(idB[i]);
         }
-        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::GEO_ID) {
-            outstrstream << "," << geoA << "," << geoB;
+    }
+    // kT wants its previous contact list sorted by geometry A, and sorts it in place if it is not. The list is sorted
+    // here (stably, as kT would), with the history going along, so that kT's sort finds nothing to do.
+    std::vector<contactPairs_t> order(nContacts);
+    for (size_t i = 0; i < nContacts; i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](const contactPairs_t& a, const contactPairs_t& b) { return idA[a] < idA[b]; });
+    auto apply_order = [&](auto& arr) {
+        auto sorted = arr;
+        for (size_t i = 0; i < nContacts; i++) {
+            sorted[i] = arr[order[i]];
         }
-
-        // Force is already in global...
-        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::FORCE) {
-            outstrstream << "," << forcexyz.x << "," << forcexyz.y << "," << forcexyz.z;
+        arr = std::move(sorted);
+    };
+    apply_order(idA);
+    apply_order(idB);
+    apply_order(cType);
+
+    if (nContacts > idGeometryA.size() || nContacts > buffer_size) {
+        contactEventArraysResize(nContacts);
+    }
+    if (nContacts > 0) {
+        DEME_GPU_CALL(cudaMemcpy(idGeometryA.data(), idA.data(), nContacts * sizeof(bodyID_t), cudaMemcpyDefault));
+        DEME_GPU_CALL(cudaMemcpy(idGeometryB.data(), idB.data(), nContacts * sizeof(bodyID_t), cudaMemcpyDefault));
+        DEME_GPU_CALL(cudaMemcpy(contactType.data(), cType.data(), nContacts * sizeof(contact_t), cudaMemcpyDefault));
+    }
+    for (unsigned int i = 0; i < simParams->nContactWildcards; i++) {
+        if (nContacts > contactWildcards[i].size()) {
+            DEME_TRACKED_RESIZE_FLOAT(contactWildcards[i], nContacts, 0);
+            granData->contactWildcards[i] = contactWildcards[i].data();
         }
-
-        // Contact point is in local frame. To make it global, first map that vector to axis-aligned global frame, then
-        // add the location of body A CoM
-        float4 oriQA;
-        float3 CoM, cntPntA, cntPntALocal;
-        {
-            oriQA.w = oriQw.at(ownerA);
-            oriQA.x = oriQx.at(ownerA);
-            oriQA.y = oriQy.at(ownerA);
-            oriQA.z = oriQz.at(ownerA);
-            voxelID_t voxel = voxelID.at(ownerA);
-            subVoxelPos_t subVoxX = locX.at(ownerA);
-            subVoxelPos_t subVoxY = locY.at(ownerA);
-            subVoxelPos_t subVoxZ = locZ.at(ownerA);
-            hostVoxelIDToPosition<float, voxelID_t, subVoxelPos_t>(CoM.x, CoM.y, CoM.z, voxel, subVoxX, subVoxY,
-                                                                   subVoxZ, simParams->nvXp2, simParams->nvYp2,
-                                                                   simParams->voxelSize, simParams->l);
-            CoM.x += simParams->LBFX;
-            CoM.y += simParams->LBFY;
-            CoM.z += simParams->LBFZ;
-            cntPntA = contactPointGeometryA.at(i);
-            cntPntALocal = cntPntA;
-            hostApplyOriQToVector3(cntPntA.x, cntPntA.y, cntPntA.z, oriQA.w, oriQA.x, oriQA.y, oriQA.z);
-            cntPntA += CoM;
-        }
-        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::DEME_POINT) {
-            // oriQ is updated already... whereas the contact point is effectively last step's... That's unfortunate.
-            // Should we do somthing ahout it?
-            outstrstream << "," << cntPntA.x << "," << cntPntA.y << "," << cntPntA.z;
-        }
-
-        // To get contact normal: it's just contact point - sphereA center, that gives you the outward normal for body A
-        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::NORMAL) {
-            size_t compOffset = (solverFlags.useClumpJitify) ? clumpComponentOffsetExt.at(geoA) : geoA;
-            float3 this_sp_deviation;
-            this_sp_deviation.x = relPosSphereX.at(compOffset);
-            this_sp_deviation.y = relPosSphereY.at(compOffset);
-            this_sp_deviation.z = relPosSphereZ.at(compOffset);
-            hostApplyOriQToVector3<float, float>(this_sp_deviation.x, this_sp_deviation.y, this_sp_deviation.z, oriQA.w,
-                                                 oriQA.x, oriQA.y, oriQA.z);
-            float3 pos = CoM + this_sp_deviation;
-            float3 normal = normalize(cntPntA - pos);
-            outstrstream << "," << normal.x << "," << normal.y << "," << normal.z;
-        }
-
-        // Torque is in global already...
-        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::TORQUE) {
-            // Must derive torque in local...
-            {
-                hostApplyOriQToVector3(torque.x, torque.y, torque.z, oriQA.w, -oriQA.x, -oriQA.y, -oriQA.z);
-                // Force times point...
-                torque = cross(cntPntALocal, torque);
-                // back to global
-                hostApplyOriQToVector3(torque.x, torque.y, torque.z, oriQA.w, oriQA.x, oriQA.y, oriQA.z);
-            }
-            outstrstream << "," << torque.x << "," << torque.y << "," << torque.z;
+    }
+    std::vector<float> cntWildcard(nContacts);
+    unsigned int j = 0;
+    for (const auto& name : m_contact_wildcard_names) {
+        if (ckpt.Has("contactWildcard:" + name)) {
+            ckpt.Read("contactWildcard:" + name, cntWildcard.data(), nContacts * sizeof(float));
+            apply_order(cntWildcard);
+        } else {
+            DEME_WARNING("Contact wildcard %s is not in the checkpoint, so it starts from 0 for all contacts.",
+                         name.c_str());
+            std::fill(cntWildcard.begin(), cntWildcard.end(), 0.f);
         }
-
-        // Contact wildcards
-        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::CNT_WILDCARD) {
-            // The order shouldn't be an issue... the same set is being processed here and in equip_contact_wildcards,
-            // see Model.h
-            for (unsigned int j = 0; j < m_contact_wildcard_names.size(); j++) {
-                outstrstream << "," << contactWildcards[j][i];
+        if (m_contact_wildcard_storage[j].precision != WILDCARD_PRECISION::FP32) {
+            for (size_t i = 0; i < nContacts; i++) {
+                setContactWildcard(j, i, cntWildcard[i]);
             }
+        } else if (nContacts > 0) {
+            DEME_GPU_CALL(cudaMemcpy(contactWildcards[m_contact_wildcard_storage[j].slot].data(), cntWildcard.data(),
+                                     nContacts * sizeof(float), cudaMemcpyDefault));
         }
-
-        outstrstream << "\n";
+        j++;
     }
-
-    ptFile << outstrstream.str();
+    *(stateOfSolver_resources.pNumContacts) = nContacts;
+
+    // Then at the start of the next run, kT takes this list as its previous contact list, like user-loaded contacts
+    new_contacts_loaded = (nContacts > 0);
+    kT->contactDeltaBaseValid = false;
+    kT->contactListReusable = false;
+    ownerAbsVelIsValid = false;
+    announceCritical();
+    DEME_DEBUG_PRINTF("Loaded a checkpoint at time %.6g, with %zu contacts.", simParams->timeElapsed, nContacts);
 }
 
-void DEMDynamicThread::writeMeshesAsVtk(std::ofstream& ptFile) {
-    std::ostringstream ostream;
-
+inline bodyID_t DEMDynamicThread::getOwnerForContactB(const bodyID_t& geoB, const contact_t& type) const {
+    switch (type) {
+        case (SPHERE_SPHERE_CONTACT):
+            return ownerClumpBody.at(geoB);
+        case (SPHERE_MESH_CONTACT):
+            return ownerMesh.at(geoB);
+        default:  // Default is sphere--analytical
+            return ownerAnalBody.at(geoB);
+    }
+}
+
+void DEMDynamicThread::writeMeshesAsVtk(std::ofstream& ptFile) {
+    std::ostringstream ostream;
+
     std::vector<size_t> vertexOffset(m_meshes.size() + 1, 0);
     size_t total_f = 0;
     size_t total_v = 0;
@@ -1681,16 +2050,378 @@ void DEMDynamicThread::writeMeshesAsVtk(std::ofstream& ptFile) {
     ptFile << ostream.str();
 }
 
+void DEMDynamicThread::buildMeshOutputConnectivity() {
+    const size_t nTri = simParams->nTriGM;
+    meshOutputVertexOffsets.assign(m_meshes.size() + 1, 0);
+    DEME_TRACKED_RESIZE(meshOutputNodeSlots, 3 * nTri, 0);
+    size_t facet = 0;
+    for (size_t m = 0; m < m_meshes.size(); m++) {
+        const auto& verts = m_meshes[m]->GetCoordsVertices();
+        const auto& faces = m_meshes[m]->GetIndicesVertexes();
+        const size_t vertexOffset = meshOutputVertexOffsets[m];
+        if (facet + faces.size() > nTri) {
+            DEME_ERROR("The meshes cached for output have more facets than the %zu in the simulation.", nTri);
+        }
+        for (const auto& f : faces) {
+            // At initialization, nodes 2 and 3 of a facet may have been swapped to match the mesh normals
+            const float3 node2 = relPosNode2.at(triNodeOffset.at(facet));
+            const bool swapped = length(node2 - verts.at(f.z)) < length(node2 - verts.at(f.y));
+            meshOutputNodeSlots[3 * facet] = vertexOffset + f.x;
+            meshOutputNodeSlots[3 * facet + 1] = vertexOffset + (swapped ? f.z : f.y);
+            meshOutputNodeSlots[3 * facet + 2] = vertexOffset + (swapped ? f.y : f.z);
+            facet++;
+        }
+        meshOutputVertexOffsets[m + 1] = vertexOffset + verts.size();
+    }
+    meshOutputNumFacets = nTri;
+
+    const size_t nVertices = meshOutputVertexOffsets.back();
+    if (nVertices > meshOutputVerticesCapacity) {
+        if (meshOutputVertices) {
+            DEME_GPU_CALL(cudaFreeHost(meshOutputVertices));
+        }
+        DEME_GPU_CALL(cudaMallocHost((void**)&meshOutputVertices, nVertices * sizeof(float3)));
+        meshOutputVerticesCapacity = nVertices;
+    }
+}
+
+void DEMDynamicThread::writeMeshesAsVtu(std::ofstream& ptFile) {
+    const size_t nTri = simParams->nTriGM;
+    int prev_device;
+    DEME_GPU_CALL(cudaGetDevice(&prev_device));
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    if (meshOutputNumFacets != nTri) {
+        buildMeshOutputConnectivity();
+    }
+    // The device writes the global-frame vertices straight into the pinned buffer
+    if (nTri > 0) {
+        size_t blocks_needed = (nTri + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+        misc_kernels->kernel("computeMeshVerticesForOutput")
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(simParams, granData, meshOutputNodeSlots.data(), meshOutputVertices, nTri);
+        DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    }
+    DEME_GPU_CALL(cudaSetDevice(prev_device));
+
+    // May want to jump the families that the user disabled output for. Then the vertices of the meshes that are kept
+    // are gathered, and their connectivity shifted; otherwise, the pinned buffer is written as it is.
+    std::vector<notStupidBool_t> thisMeshSkip(m_meshes.size(), 0);
+    bool anySkip = false;
+    for (size_t m = 0; m < m_meshes.size(); m++) {
+        family_t this_family = familyID.at(m_meshes[m]->owner);
+        if (std::binary_search(familiesNoOutput.begin(), familiesNoOutput.end(), this_family)) {
+            thisMeshSkip[m] = 1;
+            anySkip = true;
+        }
+    }
+    std::vector<float3> keptVertices;
+    std::vector<int64_t> connectivity, offsets;
+    connectivity.reserve(3 * nTri);
+    offsets.reserve(nTri);
+    size_t facet = 0, nKeptVertices = 0;
+    for (size_t m = 0; m < m_meshes.size(); m++) {
+        const size_t meshFacets = m_meshes[m]->GetIndicesVertexes().size();
+        const size_t vStart = meshOutputVertexOffsets[m];
+        const size_t vEnd = meshOutputVertexOffsets[m + 1];
+        if (!thisMeshSkip[m]) {
+            const int64_t shift = (int64_t)nKeptVertices - (int64_t)vStart;
+            for (size_t j = facet; j < facet + meshFacets; j++) {
+                for (unsigned int i = 0; i < 3; i++) {
+                    connectivity.push_back((int64_t)meshOutputNodeSlots[3 * j + i] + shift);
+                }
+                offsets.push_back(connectivity.size());
+            }
+            if (anySkip) {
+                keptVertices.insert(keptVertices.end(), meshOutputVertices + vStart, meshOutputVertices + vEnd);
+            }
+            nKeptVertices += vEnd - vStart;
+        }
+        facet += meshFacets;
+    }
+    // Type 5 is triangles
+    std::vector<uint8_t> types(offsets.size(), 5);
+
+    DEMVtkXmlFile vtu(VTK_XML_TYPE::UNSTRUCTURED_GRID);
+    vtu.SetPoints(reinterpret_cast<const float*>(anySkip ? keptVertices.data() : meshOutputVertices), nKeptVertices);
+    vtu.SetCells(connectivity.data(), connectivity.size(), offsets.data(), offsets.size());
+    vtu.SetCellTypes(types.data(), types.size());
+    vtu.Write(ptFile);
+}
+
+float* DEMDynamicThread::enqueueOwnerStateGather(OWNER_QUANTITY quantity,
+                                                 const bodyID_t* ids,
+                                                 bodyID_t offset,
+                                                 size_t n) {
+    const size_t nComp = (quantity == OWNER_QUANTITY::ORI_Q) ? 4 : 3;
+    const size_t bytes = n * nComp * sizeof(float);
+    if (bytes > ownerStateDeviceBytes) {
+        if (ownerStateDevice) {
+            DEME_GPU_CALL(cudaFree(ownerStateDevice));
+        }
+        DEME_GPU_CALL(cudaMalloc((void**)&ownerStateDevice, bytes));
+        ownerStateDeviceBytes = bytes;
+    }
+    if (n > 0) {
+        size_t blocks_needed = (n + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+        misc_kernels->kernel("gatherOwnerStates")
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(simParams, granData, ids, offset, quantity, ownerStateDevice, n);
+    }
+    return ownerStateDevice;
+}
+
+float* DEMDynamicThread::launchOwnerStateGather(OWNER_QUANTITY quantity,
+                                                const bodyID_t* ids,
+                                                bodyID_t offset,
+                                                size_t n,
+                                                bool to_host) {
+    const size_t nComp = (quantity == OWNER_QUANTITY::ORI_Q) ? 4 : 3;
+    const size_t bytes = n * nComp * sizeof(float);
+    enqueueOwnerStateGather(quantity, ids, offset, n);
+    if (!to_host) {
+        DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+        return ownerStateDevice;
+    }
+    if (bytes > ownerStatePinnedBytes) {
+        if (ownerStatePinned) {
+            DEME_GPU_CALL(cudaFreeHost(ownerStatePinned));
+        }
+        DEME_GPU_CALL(cudaMallocHost((void**)&ownerStatePinned, bytes));
+        ownerStatePinnedBytes = bytes;
+    }
+    if (n > 0) {
+        DEME_GPU_CALL(
+            cudaMemcpyAsync(ownerStatePinned, ownerStateDevice, bytes, cudaMemcpyDeviceToHost, streamInfo.stream));
+    }
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    return ownerStatePinned;
+}
+
+float* DEMDynamicThread::gatherOwnerStates(OWNER_QUANTITY quantity,
+                                           const std::vector<bodyID_t>& ownerIDs,
+                                           bool to_host) {
+    const size_t n = ownerIDs.size();
+    for (const auto& id : ownerIDs) {
+        if (id >= simParams->nOwnerBodies) {
+            DEME_ERROR("Owner %zu is queried, but there are only %zu owners.", (size_t)id,
+                       (size_t)simParams->nOwnerBodies);
+        }
+    }
+    int prev_device;
+    DEME_GPU_CALL(cudaGetDevice(&prev_device));
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    bodyID_t* ids = (bodyID_t*)stateOfSolver_resources.allocateTempVector(0, DEME_MAX(n, (size_t)1) * sizeof(bodyID_t));
+    if (n > 0) {
+        DEME_GPU_CALL(
+            cudaMemcpyAsync(ids, ownerIDs.data(), n * sizeof(bodyID_t), cudaMemcpyHostToDevice, streamInfo.stream));
+    }
+    float* res = launchOwnerStateGather(quantity, ids, 0, n, to_host);
+    DEME_GPU_CALL(cudaSetDevice(prev_device));
+    return res;
+}
+
+float* DEMDynamicThread::gatherOwnerStatesInRange(OWNER_QUANTITY quantity,
+                                                  bodyID_t start,
+                                                  size_t n,
+                                                  const std::set<unsigned int>& families,
+                                                  std::vector<bodyID_t>* selected,
+                                                  bool to_host) {
+    if ((size_t)start + n > simParams->nOwnerBodies) {
+        DEME_ERROR("Owners %zu to %zu are queried, but there are only %zu owners.", (size_t)start,
+                   (size_t)start + n - 1, (size_t)simParams->nOwnerBodies);
+    }
+    int prev_device;
+    DEME_GPU_CALL(cudaGetDevice(&prev_device));
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    cudaStream_t& stream = streamInfo.stream;
+    bodyID_t* ids = nullptr;
+    size_t nSelected = n;
+    if (!families.empty() && n > 0) {
+        std::vector<notStupidBool_t> pass(NUM_AVAL_FAMILIES, 0);
+        for (const auto& family : families) {
+            pass.at(family) = 1;
+        }
+        notStupidBool_t* familyPass = (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(
+            0, NUM_AVAL_FAMILIES * sizeof(notStupidBool_t));
+        DEME_GPU_CALL(cudaMemcpyAsync(familyPass, pass.data(), NUM_AVAL_FAMILIES * sizeof(notStupidBool_t),
+                                      cudaMemcpyHostToDevice, stream));
+        notStupidBool_t* flags =
+            (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(1, n * sizeof(notStupidBool_t));
+        size_t blocks_needed = (n + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+        misc_kernels->kernel("markOwnersInFamilies")
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, stream)
+            .launch(granData, familyPass, start, flags, n);
+        ids = (bodyID_t*)stateOfSolver_resources.allocateTempVector(2, n * sizeof(bodyID_t));
+        bodyIDSelectFlagged(flags, ids, stateOfSolver_resources.pTempSizeVar1, n, stream, stateOfSolver_resources);
+        nSelected = *(stateOfSolver_resources.pTempSizeVar1);
+    }
+    if (selected) {
+        selected->resize(nSelected);
+        if (ids) {
+            DEME_GPU_CALL(cudaMemcpyAsync(selected->data(), ids, nSelected * sizeof(bodyID_t),
+                                          cudaMemcpyDeviceToHost, stream));
+            DEME_GPU_CALL(cudaStreamSynchronize(stream));
+            for (auto& id : *selected) {
+                id += start;
+            }
+        } else {
+            std::iota(selected->begin(), selected->end(), start);
+        }
+    }
+    float* res = launchOwnerStateGather(quantity, ids, start, nSelected, to_host);
+    DEME_GPU_CALL(cudaSetDevice(prev_device));
+    return res;
+}
+
+std::shared_ptr<DEMAsyncResult> DEMDynamicThread::gatherOwnerStatesAsync(OWNER_QUANTITY quantity,
+                                                                         bodyID_t start,
+                                                                         size_t n) {
+    if ((size_t)start + n > simParams->nOwnerBodies) {
+        DEME_ERROR("Owners %zu to %zu are queried, but there are only %zu owners.", (size_t)start,
+                   (size_t)start + n - 1, (size_t)simParams->nOwnerBodies);
+    }
+    int prev_device;
+    DEME_GPU_CALL(cudaGetDevice(&prev_device));
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    const size_t nComp = (quantity == OWNER_QUANTITY::ORI_Q) ? 4 : 3;
+    std::shared_ptr<DEMAsyncResult> result = acquireAsyncResult(n * nComp);
+    // ownerStateDevice may be reused by later queries, but only behind this copy on the same stream
+    float* res = enqueueOwnerStateGather(quantity, nullptr, start, n);
+    if (n > 0) {
+        DEME_GPU_CALL(cudaMemcpyAsync(result->pinned, res, n * nComp * sizeof(float), cudaMemcpyDeviceToHost,
+                                      streamInfo.stream));
+    }
+    DEME_GPU_CALL(cudaEventRecord(result->done, streamInfo.stream));
+    DEME_GPU_CALL(cudaSetDevice(prev_device));
+    return result;
+}
+
+// The DLPack type of a dT array element
+template <typename T>
+inline void describeViewElement(DEMDeviceArrayView& view) {
+    view.type_code = std::is_floating_point<T>::value ? 2 : (std::is_signed<T>::value ? 0 : 1);
+    view.bits = sizeof(T) * DEME_BITS_PER_BYTE;
+}
+
+template <typename T>
+inline DEMDeviceArrayView makeDeviceArrayView(T* data, size_t n, bool read_only) {
+    DEMDeviceArrayView view;
+    view.data = (void*)data;
+    describeViewElement<T>(view);
+    view.shape = {(int64_t)n};
+    view.read_only = read_only;
+    return view;
+}
+
+// float3 arrays are viewed as n by 3 floats
+inline DEMDeviceArrayView makeDeviceArrayView(float3* data, size_t n, bool read_only) {
+    DEMDeviceArrayView view = makeDeviceArrayView((float*)data, n, read_only);
+    view.shape = {(int64_t)n, 3};
+    return view;
+}
+
+DEMDeviceArrayView DEMDynamicThread::getDeviceArrayView(DEVICE_ARRAY array, SPATIAL_DIR dir) {
+    const size_t nOwners = simParams->nOwnerBodies;
+    const size_t nContacts = *stateOfSolver_resources.pNumContacts;
+    const bool is_owner_vector = (array == DEVICE_ARRAY::VEL || array == DEVICE_ARRAY::ANG_VEL ||
+                                  array == DEVICE_ARRAY::ACC || array == DEVICE_ARRAY::ANG_ACC);
+    if (is_owner_vector && dir == SPATIAL_DIR::NONE) {
+        DEME_ERROR("A device view of an owner vector array needs a component (SPATIAL_DIR::X, Y or Z).");
+    }
+    if (solverFlags.useNoContactRecord &&
+        (array == DEVICE_ARRAY::CONTACT_FORCE || array == DEVICE_ARRAY::CONTACT_TORQUE ||
+         array == DEVICE_ARRAY::CONTACT_POINT_A || array == DEVICE_ARRAY::CONTACT_POINT_B)) {
+        DEME_ERROR("Contact forces and points are not recorded in this simulation, so they cannot be viewed.");
+    }
+    const unsigned int d = (dir == SPATIAL_DIR::Y) ? 1 : ((dir == SPATIAL_DIR::Z) ? 2 : 0);
+    DEMDeviceArrayView view;
+    switch (array) {
+        // Velocities are where dT keeps the owner state, so writing to them is like SetOwnerVelocity. The consumer may
+        // write to them, so the owner velocity magnitudes from the last integration can no longer be trusted.
+        case DEVICE_ARRAY::VEL: {
+            velStore_t* arrays[3] = {vX.data(), vY.data(), vZ.data()};
+            view = makeDeviceArrayView(arrays[d], nOwners, false);
+            ownerAbsVelIsValid = false;
+            break;
+        }
+        case DEVICE_ARRAY::ANG_VEL: {
+            velStore_t* arrays[3] = {omgBarX.data(), omgBarY.data(), omgBarZ.data()};
+            view = makeDeviceArrayView(arrays[d], nOwners, false);
+            ownerAbsVelIsValid = false;
+            break;
+        }
+        // The rest are results of the last step, or have copies on kT, so they are read-only
+        case DEVICE_ARRAY::ACC: {
+            float* arrays[3] = {aX.data(), aY.data(), aZ.data()};
+            view = makeDeviceArrayView(arrays[d], nOwners, true);
+            break;
+        }
+        case DEVICE_ARRAY::ANG_ACC: {
+            float* arrays[3] = {alphaX.data(), alphaY.data(), alphaZ.data()};
+            view = makeDeviceArrayView(arrays[d], nOwners, true);
+            break;
+        }
+        case DEVICE_ARRAY::FAMILY:
+            view = makeDeviceArrayView(familyID.data(), nOwners, true);
+            break;
+        case DEVICE_ARRAY::CONTACT_ID_A:
+            view = makeDeviceArrayView(idGeometryA.data(), nContacts, true);
+            break;
+        case DEVICE_ARRAY::CONTACT_ID_B:
+            view = makeDeviceArrayView(idGeometryB.data(), nContacts, true);
+            break;
+        case DEVICE_ARRAY::CONTACT_TYPE:
+            view = makeDeviceArrayView(contactType.data(), nContacts, true);
+            break;
+        case DEVICE_ARRAY::CONTACT_FORCE:
+            view = makeDeviceArrayView(contactForces.data(), nContacts, true);
+            break;
+        case DEVICE_ARRAY::CONTACT_TORQUE:
+            view = makeDeviceArrayView(contactTorque_convToForce.data(), nContacts, true);
+            break;
+        case DEVICE_ARRAY::CONTACT_POINT_A:
+            view = makeDeviceArrayView(contactPointGeometryA.data(), nContacts, true);
+            break;
+        case DEVICE_ARRAY::CONTACT_POINT_B:
+            view = makeDeviceArrayView(contactPointGeometryB.data(), nContacts, true);
+            break;
+    }
+    view.device = streamInfo.device;
+    // Consumers do not know about dT's stream, so whatever is queued on it has to be done first
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    return view;
+}
+
+DEMDeviceArrayView DEMDynamicThread::getOwnerWildcardDeviceView(unsigned int wc_num) {
+    DEMDeviceArrayView view = makeDeviceArrayView(ownerWildcards[wc_num].data(), simParams->nOwnerBodies, false);
+    view.device = streamInfo.device;
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    return view;
+}
+
+DEMDeviceArrayView DEMDynamicThread::getOwnerStatesDeviceView(OWNER_QUANTITY quantity, bodyID_t start, size_t n) {
+    float* res = gatherOwnerStatesInRange(quantity, start, n, {}, nullptr, false);
+    DEMDeviceArrayView view = makeDeviceArrayView(res, n, true);
+    view.shape = {(int64_t)n, (quantity == OWNER_QUANTITY::ORI_Q) ? 4 : 3};
+    view.device = streamInfo.device;
+    view.managed = false;
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    return view;
+}
+
 inline void DEMDynamicThread::contactEventArraysResize(size_t nContactPairs) {
-    DEME_TRACKED_RESIZE(idGeometryA, nContactPairs, 0);
-    DEME_TRACKED_RESIZE(idGeometryB, nContactPairs, 0);
-    DEME_TRACKED_RESIZE(contactType, nContactPairs, NOT_A_CONTACT);
+    DEME_TRACKED_GROWING_RESIZE(idGeometryA, nContactPairs, 0);
+    DEME_TRACKED_GROWING_RESIZE(idGeometryB, nContactPairs, 0);
+    DEME_TRACKED_GROWING_RESIZE(contactType, nContactPairs, NOT_A_CONTACT);
 
     if (!solverFlags.useNoContactRecord) {
-        DEME_TRACKED_RESIZE(contactForces, nContactPairs, make_float3(0));
-        DEME_TRACKED_RESIZE(contactTorque_convToForce, nContactPairs, make_float3(0));
-        DEME_TRACKED_RESIZE(contactPointGeometryA, nContactPairs, make_float3(0));
-        DEME_TRACKED_RESIZE(contactPointGeometryB, nContactPairs, make_float3(0));
+        DEME_TRACKED_GROWING_RESIZE(contactForces, nContactPairs, make_float3(0));
+        DEME_TRACKED_GROWING_RESIZE(contactTorque_convToForce, nContactPairs, make_float3(0));
+        DEME_TRACKED_GROWING_RESIZE(contactPointGeometryA, nContactPairs, make_float3(0));
+        DEME_TRACKED_GROWING_RESIZE(contactPointGeometryB, nContactPairs, make_float3(0));
     }
 
     // Re-pack pointers in case the arrays got reallocated
@@ -1705,6 +2436,37 @@ inline void DEMDynamicThread::contactEventArraysResize(size_t nContactPairs) {
     // DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
 }
 
+void DEMDynamicThread::reserveContactArrays(size_t nContactPairs) {
+    size_t bytes_per_cnt = 2 * sizeof(bodyID_t) + sizeof(contact_t) + sizeof(float) * simParams->nContactWildcards;
+    if (!solverFlags.useNoContactRecord) {
+        bytes_per_cnt += 4 * sizeof(float3);
+    }
+    // Never below what is there already, which fit the budget when it was allocated
+    nContactPairs = m_mem_registry.FitCount("contact arrays", nContactPairs, idGeometryA.size(), bytes_per_cnt,
+                                            DEME_MEM_BUDGET_CNT_SHARE);
+    if (nContactPairs <= idGeometryA.size()) {
+        return;
+    }
+    contactEventArraysResize(nContactPairs);
+    for (unsigned int i = 0; i < simParams->nContactWildcards; i++) {
+        if (nContactPairs > contactWildcards[i].size()) {
+            DEME_TRACKED_RESIZE_FLOAT(contactWildcards[i], nContactPairs, 0);
+            granData->contactWildcards[i] = contactWildcards[i].data();
+        }
+    }
+    DEME_DEBUG_PRINTF("dT contact arrays are sized for %zu contacts.", nContactPairs);
+}
+
+void DEMDynamicThread::createExchangeEvents() {
+    int prev_device;
+    DEME_GPU_CALL(cudaGetDevice(&prev_device));
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    DEME_GPU_CALL(cudaEventCreateWithFlags(&bufferSentEvent, cudaEventDisableTiming));
+    DEME_GPU_CALL(cudaEventCreateWithFlags(&bufferUnpackedEvent, cudaEventDisableTiming));
+    DEME_GPU_CALL(cudaEventCreateWithFlags(&meshNodesAppliedEvent, cudaEventDisableTiming));
+    DEME_GPU_CALL(cudaSetDevice(prev_device));
+}
+
 inline void DEMDynamicThread::unpackMyBuffer() {
     // Make a note on the contact number of the previous time step
     *stateOfSolver_resources.pNumPrevContacts = *stateOfSolver_resources.pNumContacts;
@@ -1712,8 +2474,18 @@ inline void DEMDynamicThread::unpackMyBuffer() {
     pSchedSupport->dynamicMaxFutureDrift = (pSchedSupport->kinematicMaxFutureDrift).load();
     // DEME_DEBUG_PRINTF("dynamicMaxFutureDrift is %u", (pSchedSupport->dynamicMaxFutureDrift).load());
 
-    DEME_GPU_CALL(cudaMemcpy(stateOfSolver_resources.pNumContacts, &(granData->nContactPairs_buffer), sizeof(size_t),
-                             cudaMemcpyDeviceToDevice));
+    // kT queued the copies to my buffer on its own stream, and did not wait for them. So my stream must wait for them
+    // to finish before reading the buffer.
+    DEME_GPU_CALL(cudaStreamWaitEvent(streamInfo.stream, kT->bufferSentEvent, 0));
+    DEME_GPU_CALL(cudaMemcpyAsync(stateOfSolver_resources.pNumContacts, &(granData->nContactPairs_buffer),
+                                  sizeof(size_t), cudaMemcpyDeviceToDevice, streamInfo.stream));
+    DEME_GPU_CALL(cudaMemcpyAsync(granData->contactClassOffsets, granData->contactClassOffsets_buffer,
+                                  sizeof(granData->contactClassOffsets), cudaMemcpyDeviceToDevice, streamInfo.stream));
+    // The number of contacts is used on host right below
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    const size_t nContactPairs = *stateOfSolver_resources.pNumContacts;
+    // If kT sent fewer contacts than there are, it is a delta-encoded update
+    const size_t nNewContacts = granData->nNewContacts_buffer;
 
     // Need to resize those contact event-based arrays before usage
     if (*stateOfSolver_resources.pNumContacts > idGeometryA.size() ||
@@ -1721,70 +2493,132 @@ inline void DEMDynamicThread::unpackMyBuffer() {
         contactEventArraysResize(*stateOfSolver_resources.pNumContacts);
     }
 
-    DEME_GPU_CALL(cudaMemcpy(granData->idGeometryA, granData->idGeometryA_buffer,
-                             *stateOfSolver_resources.pNumContacts * sizeof(bodyID_t), cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->idGeometryB, granData->idGeometryB_buffer,
-                             *stateOfSolver_resources.pNumContacts * sizeof(bodyID_t), cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->contactType, granData->contactType_buffer,
-                             *stateOfSolver_resources.pNumContacts * sizeof(contact_t), cudaMemcpyDeviceToDevice));
     if (!solverFlags.isHistoryless) {
         // Note we don't have to use dedicated memory space for unpacking contactMapping_buffer contents, because we
         // only use it once per kT update, at the time of unpacking. So let us just use a temp vector to store it. Note
         // we cannot use vector 0 since it may hold critical flattened owner ID info.
-        size_t mapping_bytes = (*stateOfSolver_resources.pNumContacts) * sizeof(contactPairs_t);
-        granData->contactMapping = (contactPairs_t*)stateOfSolver_resources.allocateTempVector(1, mapping_bytes);
-        DEME_GPU_CALL(cudaMemcpy(granData->contactMapping, granData->contactMapping_buffer, mapping_bytes,
-                                 cudaMemcpyDeviceToDevice));
+        size_t mapping_bytes = nContactPairs * sizeof(contactPairs_t);
+        granData->contactMapping = (contactPairs_t*)stateOfSolver_resources.allocateDeviceTempVector(1, mapping_bytes);
+        DEME_GPU_CALL(cudaMemcpyAsync(granData->contactMapping, granData->contactMapping_buffer, mapping_bytes,
+                                      cudaMemcpyDeviceToDevice, streamInfo.stream));
+    }
+    if (nNewContacts < nContactPairs) {
+        patchContactArrays(nContactPairs, nNewContacts);
+    } else {
+        DEME_GPU_CALL(cudaMemcpyAsync(granData->idGeometryA, granData->idGeometryA_buffer,
+                                      nContactPairs * sizeof(bodyID_t), cudaMemcpyDeviceToDevice, streamInfo.stream));
+        DEME_GPU_CALL(cudaMemcpyAsync(granData->idGeometryB, granData->idGeometryB_buffer,
+                                      nContactPairs * sizeof(bodyID_t), cudaMemcpyDeviceToDevice, streamInfo.stream));
+        DEME_GPU_CALL(cudaMemcpyAsync(granData->contactType, granData->contactType_buffer,
+                                      nContactPairs * sizeof(contact_t), cudaMemcpyDeviceToDevice, streamInfo.stream));
+    }
+    // Done reading my buffer; kT's next send waits on this event before writing to it
+    DEME_GPU_CALL(cudaEventRecord(bufferUnpackedEvent, streamInfo.stream));
+}
+
+inline void DEMDynamicThread::patchContactArrays(size_t nContactPairs, size_t nNewContacts) {
+    if (nContactPairs > idGeometryA_patched.size()) {
+        DEME_TRACKED_RESIZE(idGeometryA_patched, nContactPairs, 0);
+        DEME_TRACKED_RESIZE(idGeometryB_patched, nContactPairs, 0);
+        DEME_TRACKED_RESIZE(contactType_patched, nContactPairs, NOT_A_CONTACT);
+    }
+    // The old contact arrays are still intact at this point, as the contact mapping refers to them
+    size_t blocks_needed = (nContactPairs + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    prep_force_kernels->kernel("gatherPersistentContacts")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+        .launch(granData->contactMapping, granData->idGeometryA, granData->idGeometryB, granData->contactType,
+                idGeometryA_patched.data(), idGeometryB_patched.data(), contactType_patched.data(), nContactPairs);
+    if (nNewContacts > 0) {
+        blocks_needed = (nNewContacts + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+        prep_force_kernels->kernel("scatterNewContacts")
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(granData->newContactIdx_buffer, granData->idGeometryA_buffer, granData->idGeometryB_buffer,
+                    granData->contactType_buffer, idGeometryA_patched.data(), idGeometryB_patched.data(),
+                    contactType_patched.data(), nNewContacts);
+    }
+    // Swapping, rather than copying back, saves one pass over the contact arrays. The kernels above got their array
+    // pointers as arguments, and no memory is freed in a swap, so this needs no sync.
+    idGeometryA.swap(idGeometryA_patched);
+    idGeometryB.swap(idGeometryB_patched);
+    contactType.swap(contactType_patched);
+    granData->idGeometryA = idGeometryA.data();
+    granData->idGeometryB = idGeometryB.data();
+    granData->contactType = contactType.data();
+}
+
+inline void DEMDynamicThread::copyToTheirBuffer(void* dst, const void* src, size_t bytes) {
+    if (solverFlags.usePeerTransfer) {
+        DEME_GPU_CALL(
+            cudaMemcpyPeerAsync(dst, kT->streamInfo.device, src, streamInfo.device, bytes, streamInfo.stream));
+    } else {
+        DEME_GPU_CALL(cudaMemcpyAsync(dst, src, bytes, cudaMemcpyDeviceToDevice, streamInfo.stream));
     }
 }
 
 inline void DEMDynamicThread::sendToTheirBuffer() {
-    DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_voxelID, granData->voxelID,
-                             simParams->nOwnerBodies * sizeof(voxelID_t), cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_locX, granData->locX,
-                             simParams->nOwnerBodies * sizeof(subVoxelPos_t), cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_locY, granData->locY,
-                             simParams->nOwnerBodies * sizeof(subVoxelPos_t), cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_locZ, granData->locZ,
-                             simParams->nOwnerBodies * sizeof(subVoxelPos_t), cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_oriQ0, granData->oriQw, simParams->nOwnerBodies * sizeof(oriQ_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_oriQ1, granData->oriQx, simParams->nOwnerBodies * sizeof(oriQ_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_oriQ2, granData->oriQy, simParams->nOwnerBodies * sizeof(oriQ_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_oriQ3, granData->oriQz, simParams->nOwnerBodies * sizeof(oriQ_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_absVel, pCycleMaxVel, simParams->nOwnerBodies * sizeof(float),
-                             cudaMemcpyDeviceToDevice));
+    // All copies are queued on my stream and I do not wait for them. But kT may still be reading the last batch I sent
+    // (on its stream), so my stream waits on that first.
+    DEME_GPU_CALL(cudaStreamWaitEvent(streamInfo.stream, kT->bufferUnpackedEvent, 0));
+    copyToTheirBuffer(granData->pKTOwnedBuffer_voxelID, granData->voxelID, simParams->nOwnerBodies * sizeof(voxelID_t));
+    copyToTheirBuffer(granData->pKTOwnedBuffer_locX, granData->locX, simParams->nOwnerBodies * sizeof(subVoxelPos_t));
+    copyToTheirBuffer(granData->pKTOwnedBuffer_locY, granData->locY, simParams->nOwnerBodies * sizeof(subVoxelPos_t));
+    copyToTheirBuffer(granData->pKTOwnedBuffer_locZ, granData->locZ, simParams->nOwnerBodies * sizeof(subVoxelPos_t));
+    copyToTheirBuffer(granData->pKTOwnedBuffer_oriQ0, granData->oriQw, simParams->nOwnerBodies * sizeof(oriQStore_t));
+    copyToTheirBuffer(granData->pKTOwnedBuffer_oriQ1, granData->oriQx, simParams->nOwnerBodies * sizeof(oriQStore_t));
+    copyToTheirBuffer(granData->pKTOwnedBuffer_oriQ2, granData->oriQy, simParams->nOwnerBodies * sizeof(oriQStore_t));
+    copyToTheirBuffer(granData->pKTOwnedBuffer_oriQ3, granData->oriQz, simParams->nOwnerBodies * sizeof(oriQStore_t));
+    copyToTheirBuffer(granData->pKTOwnedBuffer_absVel, pCycleMaxVel, simParams->nOwnerBodies * sizeof(float));
 
     // Send simulation metrics for kT's reference.
-    DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_ts, &(simParams->h), sizeof(float), cudaMemcpyDeviceToDevice));
+    copyToTheirBuffer(granData->pKTOwnedBuffer_ts, &(simParams->h), sizeof(float));
     // Note that perhapsIdealFutureDrift is non-negative, and it will be used to determine the margin size; however, if
     // scheduleHelper is instructed to have negative future drift then perhapsIdealFutureDrift no longer affects them.
-    DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_maxDrift, &(granData->perhapsIdealFutureDrift),
-                             sizeof(unsigned int), cudaMemcpyDeviceToDevice));
+    copyToTheirBuffer(granData->pKTOwnedBuffer_maxDrift, &(granData->perhapsIdealFutureDrift), sizeof(unsigned int));
 
     // Family number is a typical changable quantity on-the-fly. If this flag is on, dT is responsible for sending this
     // info to kT.
     if (solverFlags.canFamilyChange) {
-        DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_familyID, granData->familyID,
-                                 simParams->nOwnerBodies * sizeof(family_t), cudaMemcpyDeviceToDevice));
+        copyToTheirBuffer(granData->pKTOwnedBuffer_familyID, granData->familyID,
+                          simParams->nOwnerBodies * sizeof(family_t));
     }
 
-    // May need to send updated mesh
+    // May need to send updated mesh, but only the node ranges modified since the last send
     if (solverFlags.willMeshDeform) {
-        DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_relPosNode1, granData->relPosNode1,
-                                 simParams->nTriGM * sizeof(float3), cudaMemcpyDeviceToDevice));
-        DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_relPosNode2, granData->relPosNode2,
-                                 simParams->nTriGM * sizeof(float3), cudaMemcpyDeviceToDevice));
-        DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_relPosNode3, granData->relPosNode3,
-                                 simParams->nTriGM * sizeof(float3), cudaMemcpyDeviceToDevice));
-        solverFlags.willMeshDeform = false;
+        std::vector<std::pair<size_t, size_t>> ranges;
+        {
+            std::lock_guard<std::mutex> lock(meshNodeDirtyMutex);
+            ranges.swap(meshNodeDirtyRanges);
+            solverFlags.willMeshDeform = false;
+        }
+        // Coalesce the ranges that overlap or touch
+        std::sort(ranges.begin(), ranges.end());
+        std::vector<std::pair<size_t, size_t>> merged;
+        for (const auto& range : ranges) {
+            if (!merged.empty() && range.first <= merged.back().second) {
+                merged.back().second = DEME_MAX(merged.back().second, range.second);
+            } else {
+                merged.push_back(range);
+            }
+        }
+        for (const auto& range : merged) {
+            const size_t bytes = (range.second - range.first) * sizeof(float3);
+            copyToTheirBuffer(granData->pKTOwnedBuffer_relPosNode1 + range.first, granData->relPosNode1 + range.first,
+                              bytes);
+            copyToTheirBuffer(granData->pKTOwnedBuffer_relPosNode2 + range.first, granData->relPosNode2 + range.first,
+                              bytes);
+            copyToTheirBuffer(granData->pKTOwnedBuffer_relPosNode3 + range.first, granData->relPosNode3 + range.first,
+                              bytes);
+        }
         // kT can't be loading buffer when dT is sending, so it is safe
+        kT->meshNodeDirtyRanges.insert(kT->meshNodeDirtyRanges.end(), merged.begin(), merged.end());
         kT->solverFlags.willMeshDeform = true;
     }
 
+    // kT waits on this event (on its stream) before unpacking
+    DEME_GPU_CALL(cudaEventRecord(bufferSentEvent, streamInfo.stream));
+
     // This subroutine also includes recording the time stamp of this batch ingredient dT sent to kT
     pSchedSupport->kinematicIngredProdDateStamp = (pSchedSupport->currentStampOfDynamic).load();
 }
@@ -1822,7 +2656,7 @@ inline void DEMDynamicThread::migratePersistentContacts() {
                                streamInfo.stream)
                     .launch(granData->contactWildcards[simParams->nContactWildcards - 1], contactSentry,
                             *stateOfSolver_resources.pNumPrevContacts);
-                DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+                DEME_SYNC_UNLESS_NO_SYNC(solverFlags, streamInfo.stream);
             }
         }
     }
@@ -1908,7 +2742,7 @@ inline void DEMDynamicThread::calculateForces() {
                 .configure(dim3(blocks_needed_for_force_prep), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
                 .launch(simParams, granData, nContactPairs);
         }
-        DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+        DEME_SYNC_UNLESS_NO_SYNC(solverFlags, streamInfo.stream);
     }
     timers.GetTimer("Clear force array").stop();
 
@@ -1933,143 +2767,1256 @@ inline void DEMDynamicThread::calculateForces() {
     // or other sources.
     if (blocks_needed_for_contacts > 0) {
         timers.GetTimer("Calculate contact forces").start();
-        // a custom kernel to compute forces
+        // With several force models, each model runs in its own kernel. Otherwise, the class offsets are only usable
+        // if they describe the contact array we have now.
+        if (nForceModels > 1) {
+            launchForceModelKernels(nContactPairs);
+        } else if (solverFlags.useSegmentedForceCalc &&
+                   granData->contactClassOffsets[DEME_NUM_CONTACT_CLASSES] == nContactPairs) {
+            launchSegmentedForceKernels(nContactPairs);
+        } else {
+            // a custom kernel to compute forces
+            cal_force_kernels->kernel("calculateContactForces")
+                .instantiate()
+                .configure(dim3(blocks_needed_for_contacts), dim3(DT_FORCE_CALC_NTHREADS_PER_BLOCK), 0,
+                           streamInfo.stream)
+                .launch(simParams, granData, nContactPairs);
+        }
+        DEME_SYNC_UNLESS_NO_SYNC(solverFlags, streamInfo.stream);
+        // displayFloat3(granData->contactForces, nContactPairs);
+        // displayArray<contact_t>(granData->contactType, nContactPairs);
+        // std::cout << "===========================" << std::endl;
+        timers.GetTimer("Calculate contact forces").stop();
+
+        if (!solverFlags.useForceCollectInPlace) {
+            timers.GetTimer("Collect contact forces").start();
+            // Reflect those body-wise forces on their owner clumps
+            if (solverFlags.useCubForceCollect) {
+                collectContactForcesThruCub(collect_force_kernels, granData, ownerCSR, nContactPairs,
+                                            simParams->nOwnerBodies, contactPairArr_isFresh, streamInfo.stream,
+                                            stateOfSolver_resources, timers);
+            } else {
+                blocks_needed_for_contacts =
+                    (nContactPairs + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+                // This does both acc and ang acc
+                collect_force_kernels->kernel("forceToAcc")
+                    .instantiate()
+                    .configure(dim3(blocks_needed_for_contacts), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+                    .launch(granData, nContactPairs);
+                DEME_SYNC_UNLESS_NO_SYNC(solverFlags, streamInfo.stream);
+            }
+            // displayArray<float>(granData->aZ, simParams->nOwnerBodies);
+            // displayFloat3(granData->contactForces, nContactPairs);
+            // std::cout << nContactPairs << std::endl;
+            timers.GetTimer("Collect contact forces").stop();
+        }
+    }
+}
+
+inline void DEMDynamicThread::integrateOwnerMotions() {
+    size_t blocks_needed_for_clumps =
+        (simParams->nOwnerBodies + DEME_NUM_BODIES_PER_BLOCK - 1) / DEME_NUM_BODIES_PER_BLOCK;
+    integrator_kernels->kernel(solverFlags.useFusedAbsvPass ? "integrateOwnersAndAbsv" : "integrateOwners")
+        .instantiate()
+        .configure(dim3(blocks_needed_for_clumps), dim3(DEME_NUM_BODIES_PER_BLOCK), 0, streamInfo.stream)
+        .launch(simParams, granData);
+    DEME_SYNC_UNLESS_NO_SYNC(solverFlags, streamInfo.stream);
+    ownerAbsVelIsValid = solverFlags.useFusedAbsvPass;
+}
+
+inline void DEMDynamicThread::routineChecks() {
+    if (solverFlags.canFamilyChange && !solverFlags.useFamilyChangeInIntegration &&
+        simParams->nStepsElapsed % familyChangeStride == 0) {
+        size_t blocks_needed_for_clumps =
+            (simParams->nOwnerBodies + DEME_NUM_MODERATORS_PER_BLOCK - 1) / DEME_NUM_MODERATORS_PER_BLOCK;
+        mod_kernels->kernel("applyFamilyChanges")
+            .instantiate()
+            .configure(dim3(blocks_needed_for_clumps), dim3(DEME_NUM_MODERATORS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(simParams, granData, simParams->nOwnerBodies);
+        DEME_SYNC_UNLESS_NO_SYNC(solverFlags, streamInfo.stream);
+    }
+}
+
+inline void DEMDynamicThread::enqueueStepSizeUpdate() {
+    if (!(simParams->adaptTSByVel || simParams->adaptTSByAcc)) {
+        return;
+    }
+    size_t blocks_needed_for_clumps =
+        (simParams->nOwnerBodies + DEME_NUM_BODIES_PER_BLOCK - 1) / DEME_NUM_BODIES_PER_BLOCK;
+    if (blocks_needed_for_clumps > 0) {
+        integrator_kernels->kernel("gaugeStepSizeLimiters")
+            .instantiate()
+            .configure(dim3(blocks_needed_for_clumps), dim3(DEME_NUM_BODIES_PER_BLOCK), 0, streamInfo.stream)
+            .launch(simParams, granData);
+    }
+    // The new step size is written to simParams->h, which the integration kernel then reads, so no host round trip
+    integrator_kernels->kernel("updateAdaptiveStepSize")
+        .instantiate()
+        .configure(dim3(1), dim3(1), 0, streamInfo.stream)
+        .launch(simParams, granData);
+}
+
+inline void DEMDynamicThread::launchSegmentedForceKernels(size_t nContactPairs) {
+    // In the order of contact classes in a type-sorted contact array
+    const char* kernel_names[DEME_NUM_CONTACT_CLASSES] = {"calculateNonContactForces", "calculateSphSphContactForces",
+                                                          "calculateSphMeshContactForces",
+                                                          "calculateSphAnalContactForces"};
+    const size_t* offsets = granData->contactClassOffsets;
+    const bool use_streams = solverFlags.useSegmentedForceStreams;
+    if (use_streams) {
+        if (!forceClassStreamsReady) {
+            for (unsigned int i = 0; i < DEME_NUM_CONTACT_CLASSES; i++) {
+                DEME_GPU_CALL(cudaStreamCreateWithFlags(&forceClassStreams[i], cudaStreamNonBlocking));
+                DEME_GPU_CALL(cudaEventCreateWithFlags(&forceJoinEvents[i], cudaEventDisableTiming));
+            }
+            DEME_GPU_CALL(cudaEventCreateWithFlags(&forceForkEvent, cudaEventDisableTiming));
+            forceClassStreamsReady = true;
+        }
+        // Class streams must not start before force arrays are prepared on my stream
+        DEME_GPU_CALL(cudaEventRecord(forceForkEvent, streamInfo.stream));
+    }
+    for (unsigned int i = 0; i < DEME_NUM_CONTACT_CLASSES; i++) {
+        const size_t startID = offsets[i];
+        const size_t endID = offsets[i + 1];
+        if (endID <= startID) {
+            continue;
+        }
+        size_t blocks_needed =
+            (endID - startID + DT_FORCE_CALC_NTHREADS_PER_BLOCK - 1) / DT_FORCE_CALC_NTHREADS_PER_BLOCK;
+        cudaStream_t this_stream = streamInfo.stream;
+        if (use_streams) {
+            this_stream = forceClassStreams[i];
+            DEME_GPU_CALL(cudaStreamWaitEvent(this_stream, forceForkEvent, 0));
+        }
+        cal_force_kernels->kernel(kernel_names[i])
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DT_FORCE_CALC_NTHREADS_PER_BLOCK), 0, this_stream)
+            .launch(simParams, granData, startID, endID);
+        if (use_streams) {
+            // Force collection that follows on my stream needs all classes to be done
+            DEME_GPU_CALL(cudaEventRecord(forceJoinEvents[i], this_stream));
+            DEME_GPU_CALL(cudaStreamWaitEvent(streamInfo.stream, forceJoinEvents[i], 0));
+        }
+    }
+}
+
+inline void DEMDynamicThread::launchForceModelKernels(size_t nContactPairs) {
+    // The model of a contact only changes with the contact array, or with the families of its owners if family pairs
+    // decide models
+    if (contactPairArr_isFresh || (forceModelsByFamily && solverFlags.canFamilyChange) ||
+        forceModelGroups.offsets.size() != nForceModels + 1 ||
+        forceModelGroups.offsets[nForceModels] != nContactPairs) {
+        groupContactsByForceModel(cal_force_kernels, granData, forceModelGroups, nContactPairs, nForceModels,
+                                  streamInfo.stream, stateOfSolver_resources);
+    }
+    for (unsigned int i = 0; i < nForceModels; i++) {
+        const size_t startID = forceModelGroups.offsets[i];
+        const size_t endID = forceModelGroups.offsets[i + 1];
+        if (endID <= startID) {
+            continue;
+        }
+        size_t blocks_needed =
+            (endID - startID + DT_FORCE_CALC_NTHREADS_PER_BLOCK - 1) / DT_FORCE_CALC_NTHREADS_PER_BLOCK;
+        cal_force_kernels->kernel("calculateContactForcesOfModel" + std::to_string(i))
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DT_FORCE_CALC_NTHREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(simParams, granData, forceModelGroups.entries.data(), startID, endID);
+    }
+}
+
+inline bool DEMDynamicThread::canUseStepGraph() const {
+    // CUB-based force collection does host-side work and synchronizations in the middle of the step, and a variable
+    // step size needs the host to judge each step; neither can go into a graph. Segmented force calculation, and the
+    // per-model force kernels with several force models, have launch sizes that change with each kT update, so they
+    // are not captured either.
+    return solverFlags.useCudaGraphs && !solverFlags.useCubForceCollect && solverFlags.isStepConst &&
+           !solverFlags.useSegmentedForceCalc && nForceModels == 1;
+}
+
+inline void DEMDynamicThread::enqueueStepKernels() {
+    size_t nContactPairs = *stateOfSolver_resources.pNumContacts;
+    size_t blocks_needed_for_force_prep = (nContactPairs + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    size_t blocks_needed_for_acc_prep =
+        (simParams->nOwnerBodies + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    prep_force_kernels->kernel("prepareAccArrays")
+        .instantiate()
+        .configure(dim3(blocks_needed_for_acc_prep), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+        .launch(simParams, granData);
+    if (!solverFlags.useNoContactRecord && blocks_needed_for_force_prep > 0) {
+        prep_force_kernels->kernel("prepareForceArrays")
+            .instantiate()
+            .configure(dim3(blocks_needed_for_force_prep), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(simParams, granData, nContactPairs);
+    }
+
+    size_t blocks_needed_for_contacts =
+        (nContactPairs + DT_FORCE_CALC_NTHREADS_PER_BLOCK - 1) / DT_FORCE_CALC_NTHREADS_PER_BLOCK;
+    if (blocks_needed_for_contacts > 0) {
         cal_force_kernels->kernel("calculateContactForces")
             .instantiate()
             .configure(dim3(blocks_needed_for_contacts), dim3(DT_FORCE_CALC_NTHREADS_PER_BLOCK), 0, streamInfo.stream)
             .launch(simParams, granData, nContactPairs);
+        if (!solverFlags.useForceCollectInPlace) {
+            blocks_needed_for_contacts = (nContactPairs + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+            collect_force_kernels->kernel("forceToAcc")
+                .instantiate()
+                .configure(dim3(blocks_needed_for_contacts), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+                .launch(granData, nContactPairs);
+        }
+    }
+
+    // The step graph is replayed on all steps, so the rules decide on the device whether they are due
+    if (solverFlags.canFamilyChange && !solverFlags.useFamilyChangeInIntegration) {
+        size_t blocks_needed_for_mod =
+            (simParams->nOwnerBodies + DEME_NUM_MODERATORS_PER_BLOCK - 1) / DEME_NUM_MODERATORS_PER_BLOCK;
+        mod_kernels->kernel("applyFamilyChanges")
+            .instantiate()
+            .configure(dim3(blocks_needed_for_mod), dim3(DEME_NUM_MODERATORS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(simParams, granData, simParams->nOwnerBodies);
+    }
+
+    enqueueStepSizeUpdate();
+
+    size_t blocks_needed_for_clumps =
+        (simParams->nOwnerBodies + DEME_NUM_BODIES_PER_BLOCK - 1) / DEME_NUM_BODIES_PER_BLOCK;
+    integrator_kernels->kernel(solverFlags.useFusedAbsvPass ? "integrateOwnersAndAbsv" : "integrateOwners")
+        .instantiate()
+        .configure(dim3(blocks_needed_for_clumps), dim3(DEME_NUM_BODIES_PER_BLOCK), 0, streamInfo.stream)
+        .launch(simParams, granData);
+}
+
+void DEMDynamicThread::autotuneLaunchConfigs() {
+    const size_t nContactPairs = *stateOfSolver_resources.pNumContacts;
+    if (nContactPairs == 0) {
+        DEME_WARNING("There are no contacts to benchmark the force calculation with, so it is not autotuned.");
+        return;
+    }
+    int prev_device;
+    DEME_GPU_CALL(cudaGetDevice(&prev_device));
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+
+    // The best config depends on the GPU and on the register use of the force model, which the source hash covers
+    const std::string entry =
+        "autotune_" + JitHelper::GetGpuArch() + "_" + cal_force_kernels->getSourceHash() + ".launch";
+    std::string cached;
+    if (JitHelper::readCacheEntry(entry, cached)) {
+        unsigned int nTh = std::strtoul(cached.c_str(), nullptr, 10);
+        if (nTh > 0) {
+            DT_FORCE_CALC_NTHREADS_PER_BLOCK = nTh;
+            DEME_DEBUG_PRINTF("dT force calculation uses %u threads per block (autotuned in an earlier run).", nTh);
+            DEME_GPU_CALL(cudaSetDevice(prev_device));
+            return;
+        }
+    }
+
+    // The force kernels may write to the wildcards, and (if forces are collected in place) accumulate into the
+    // accelerations. Benchmarking must not change the simulation, so back those up and restore afterwards.
+    std::vector<std::pair<float*, size_t>> touched;
+    for (unsigned int i = 0; i < simParams->nContactWildcards; i++) {
+        touched.push_back(std::pair<float*, size_t>(granData->contactWildcards[i], nContactPairs));
+    }
+    for (unsigned int i = 0; i < simParams->nOwnerWildcards; i++) {
+        touched.push_back(std::pair<float*, size_t>(granData->ownerWildcards[i], simParams->nOwnerBodies));
+    }
+    for (float* acc :
+         {granData->aX, granData->aY, granData->aZ, granData->alphaX, granData->alphaY, granData->alphaZ}) {
+        touched.push_back(std::pair<float*, size_t>(acc, simParams->nOwnerBodies));
+    }
+    size_t backup_size = 0;
+    for (const auto& arr : touched) {
+        backup_size += arr.second;
+    }
+    float* backup = (float*)stateOfSolver_resources.allocateTempVector(0, backup_size * sizeof(float));
+    size_t pos = 0;
+    for (const auto& arr : touched) {
+        DEME_GPU_CALL(cudaMemcpyAsync(backup + pos, arr.first, arr.second * sizeof(float), cudaMemcpyDeviceToDevice,
+                                      streamInfo.stream));
+        pos += arr.second;
+    }
+
+    int max_nTh;
+    DEME_GPU_CALL(cudaDeviceGetAttribute(&max_nTh, cudaDevAttrMaxThreadsPerBlock, streamInfo.device));
+    const bool segmented = solverFlags.useSegmentedForceCalc &&
+                           granData->contactClassOffsets[DEME_NUM_CONTACT_CLASSES] == nContactPairs;
+    const unsigned int nTh_before = DT_FORCE_CALC_NTHREADS_PER_BLOCK;
+    unsigned int best_nTh = nTh_before;
+    float best_ms = -1.f;
+    cudaEvent_t start, stop;
+    DEME_GPU_CALL(cudaEventCreate(&start));
+    DEME_GPU_CALL(cudaEventCreate(&stop));
+    for (unsigned int nTh : {64, 128, 256, 512, 1024}) {
+        if (nTh > (unsigned int)max_nTh) {
+            break;
+        }
+        DT_FORCE_CALC_NTHREADS_PER_BLOCK = nTh;
+        // The first launch is a warm-up, and it also tells if this kernel can be launched with this many threads (a
+        // heavy force model may use too many registers)
+        CUresult res = CUDA_SUCCESS;
+        if (!segmented) {
+            res = cal_force_kernels->kernel("calculateContactForces")
+                      .instantiate()
+                      .configure(dim3((nContactPairs + nTh - 1) / nTh), dim3(nTh), 0, streamInfo.stream)
+                      .launch(simParams, granData, nContactPairs);
+        } else {
+            launchSegmentedForceKernels(nContactPairs);
+        }
+        if (res != CUDA_SUCCESS || cudaStreamSynchronize(streamInfo.stream) != cudaSuccess) {
+            // Clear the launch error so it does not surface in a later check
+            cudaGetLastError();
+            continue;
+        }
+        DEME_GPU_CALL(cudaEventRecord(start, streamInfo.stream));
+        for (unsigned int rep = 0; rep < DEME_AUTOTUNE_NUM_REPS; rep++) {
+            if (!segmented) {
+                cal_force_kernels->kernel("calculateContactForces")
+                    .instantiate()
+                    .configure(dim3((nContactPairs + nTh - 1) / nTh), dim3(nTh), 0, streamInfo.stream)
+                    .launch(simParams, granData, nContactPairs);
+            } else {
+                launchSegmentedForceKernels(nContactPairs);
+            }
+        }
+        DEME_GPU_CALL(cudaEventRecord(stop, streamInfo.stream));
+        DEME_GPU_CALL(cudaEventSynchronize(stop));
+        float ms;
+        DEME_GPU_CALL(cudaEventElapsedTime(&ms, start, stop));
+        DEME_DEBUG_PRINTF("dT force calculation with %u threads per block: %.6g ms per launch.", nTh,
+                          ms / DEME_AUTOTUNE_NUM_REPS);
+        if (best_ms < 0.f || ms < best_ms) {
+            best_ms = ms;
+            best_nTh = nTh;
+        }
+    }
+    DEME_GPU_CALL(cudaEventDestroy(start));
+    DEME_GPU_CALL(cudaEventDestroy(stop));
+
+    pos = 0;
+    for (const auto& arr : touched) {
+        DEME_GPU_CALL(cudaMemcpyAsync(arr.first, backup + pos, arr.second * sizeof(float), cudaMemcpyDeviceToDevice,
+                                      streamInfo.stream));
+        pos += arr.second;
+    }
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+
+    DT_FORCE_CALC_NTHREADS_PER_BLOCK = best_nTh;
+    if (best_ms >= 0.f) {
+        JitHelper::writeCacheEntry(entry, std::to_string(best_nTh));
+        DEME_DEBUG_PRINTF("dT force calculation autotuned to use %u threads per block.", best_nTh);
+    } else {
+        DEME_WARNING("No candidate launch config worked for the force calculation; keeping %u threads per block.",
+                     nTh_before);
+    }
+    DEME_GPU_CALL(cudaSetDevice(prev_device));
+}
+
+inline void DEMDynamicThread::stepWithCudaGraph() {
+    // All kernels in a step read sim params and data array pointers through simParams and granData, so the graph stays
+    // valid across kT updates as long as the launch dimensions do not change.
+    size_t nContactPairs = *stateOfSolver_resources.pNumContacts;
+    if (stepGraphReady &&
+        (nContactPairs != stepGraphNumContacts || simParams->nOwnerBodies != stepGraphNumOwners ||
+         DT_FORCE_CALC_NTHREADS_PER_BLOCK != stepGraphForceNThreads)) {
+        releaseStepGraph();
+    }
+    if (!stepGraphReady) {
+        // Thread-local capture mode, so that kT, which works concurrently on its own stream, is not affected
+        DEME_GPU_CALL(cudaStreamBeginCapture(streamInfo.stream, cudaStreamCaptureModeThreadLocal));
+        enqueueStepKernels();
+        DEME_GPU_CALL(cudaStreamEndCapture(streamInfo.stream, &stepGraph));
+        DEME_GPU_CALL(cudaGraphInstantiate(&stepGraphExec, stepGraph, NULL, NULL, 0));
+        stepGraphNumContacts = nContactPairs;
+        stepGraphNumOwners = simParams->nOwnerBodies;
+        stepGraphForceNThreads = DT_FORCE_CALC_NTHREADS_PER_BLOCK;
+        stepGraphReady = true;
+        DEME_DEBUG_PRINTF("dT step graph captured with %zu contacts and %zu owners", nContactPairs,
+                          (size_t)simParams->nOwnerBodies);
+    }
+    DEME_GPU_CALL(cudaGraphLaunch(stepGraphExec, streamInfo.stream));
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    // The graph ends with the same integration kernel as integrateOwnerMotions
+    ownerAbsVelIsValid = solverFlags.useFusedAbsvPass;
+}
+
+void DEMDynamicThread::releaseStepGraph() {
+    if (stepGraphReady) {
+        DEME_GPU_CALL(cudaGraphExecDestroy(stepGraphExec));
+        DEME_GPU_CALL(cudaGraphDestroy(stepGraph));
+        stepGraphReady = false;
+    }
+}
+
+inline float* DEMDynamicThread::determineSysVel() {
+    // The integration kernel may have already found the velocity magnitudes, which is what the default inspector
+    // would give. A user-supplied inspector may measure the velocity differently, so it is always called.
+    if (solverFlags.useFusedAbsvPass && ownerAbsVelIsValid && approxMaxVelFuncIsDefault) {
+        return ownerAbsVel.data();
+    }
+    return approxMaxVelFunc->dT_GetValue();
+}
+
+inline void DEMDynamicThread::unpack_impl() {
+    // Use the content of the dynamic-owned transfer buffer. kT does not write to it again before it gets a new work
+    // order, and the GPU-side order is taken care of by the exchange events, so no lock is needed.
+    unpackMyBuffer();
+    // Leave myself a mental note that I just obtained new produce from kT
+    contactPairArr_isFresh = true;
+    // pSchedSupport->schedulingStats.nDynamicReceives++;
+    // dT got the produce, now mark its buffer to be no longer fresh.
+    pSchedSupport->dynamicOwned_Prod2ConsBuffer_isFresh = false;
+    // Used for inspecting on average how stale kT's produce is.
+    pSchedSupport->schedulingStats.accumKinematicLagSteps +=
+        (pSchedSupport->currentStampOfDynamic).load() - (pSchedSupport->stampLastDynamicUpdateProdDate).load();
+    // dT needs to know how fresh the contact pair info is, and that is determined by when kT received this batch of
+    // ingredients.
+    pSchedSupport->stampLastDynamicUpdateProdDate = (pSchedSupport->kinematicIngredProdDateStamp).load();
+
+    // If this is a history-based run, then when contacts are received, we need to migrate the contact
+    // history info, to match the structure of the new contact array
+    if (!solverFlags.isHistoryless) {
+        migratePersistentContacts();
+    }
+}
+
+inline void DEMDynamicThread::ifProduceFreshThenUseIt() {
+    if (pSchedSupport->dynamicOwned_Prod2ConsBuffer_isFresh) {
+        unpack_impl();
+    }
+}
+
+inline void DEMDynamicThread::calibrateParams() {
+    // Unpacking is done; now we can use temp arrays again to derive max velocity and send to kT
+    pCycleMaxVel = determineSysVel();
+
+    if (solverFlags.autoUpdateFreq && solverFlags.useCostModelDrift) {
+        calibrateDriftByCostModel();
+    } else if (solverFlags.autoUpdateFreq) {
+        unsigned int comfortable_drift;
+        if (accumStepUpdater.Query(comfortable_drift)) {
+            // If perhapsIdealFutureDrift needs to increase, then the following value much = perhapsIdealFutureDrift.
+            comfortable_drift =
+                (float)comfortable_drift * solverFlags.targetDriftMultipleOfAvg + solverFlags.targetDriftMoreThanAvg;
+            if (granData->perhapsIdealFutureDrift > comfortable_drift) {
+                granData->perhapsIdealFutureDrift -= FUTURE_DRIFT_TWEAK_STEP_SIZE;
+            } else if (granData->perhapsIdealFutureDrift < comfortable_drift) {
+                granData->perhapsIdealFutureDrift += FUTURE_DRIFT_TWEAK_STEP_SIZE;
+            }
+            granData->perhapsIdealFutureDrift = hostClampBetween<unsigned int, unsigned int>(
+                granData->perhapsIdealFutureDrift, 0, solverFlags.upperBoundFutureDrift);
+
+            DEME_DEBUG_PRINTF("Comfortable future drift is %u", comfortable_drift);
+            DEME_DEBUG_PRINTF("Current future drift is %u", granData->perhapsIdealFutureDrift);
+        }
+    }
+}
+
+inline void DEMDynamicThread::calibrateDriftByCostModel() {
+    // Smoothed, so one unlucky sample does not swing the margins
+    auto smooth = [](double& avg, double sample) { avg = (avg > 0.) ? 0.7 * avg + 0.3 * sample : sample; };
+    // Take in the samples of the last cycle: one dT step, and kT's last contact detection
+    if (stepCostTimingPending) {
+        const double total = stepCostTimer.GetTimeSeconds();
+        smooth(costModelStepSec, total - stepCostTimerTotal);
+        stepCostTimerTotal = total;
+        stepCostTimingPending = false;
+    }
+    const uint64_t cd_ns = pSchedSupport->schedulingStats.lastKinematicCDNanosec.exchange(0);
+    if (cd_ns > 0) {
+        smooth(costModelCDSec, (double)cd_ns * 1e-9);
+    }
+    timeNextStep = true;
+    if (costModelStepSec <= 0. || costModelCDSec <= 0.) {
+        return;
+    }
+
+    // With a future drift of D, dT runs D steps while kT does one contact detection, and then waits for whatever is
+    // left of it. The wall time per step, t_dT + max(0, t_kT - D * t_dT) / D, flattens out at D = t_kT / t_dT, and a
+    // larger D only costs bigger margins. So aim for that, plus the user's slack on top.
+    const double ideal_drift = costModelCDSec / costModelStepSec * solverFlags.targetDriftMultipleOfAvg +
+                               solverFlags.targetDriftMoreThanAvg;
+    costModelDrift = (unsigned int)std::min(std::ceil(ideal_drift), (double)solverFlags.upperBoundFutureDrift);
+    // Go half way there each time
+    unsigned int& drift = granData->perhapsIdealFutureDrift;
+    if (drift < costModelDrift) {
+        drift += (costModelDrift - drift + 1) / 2;
+    } else {
+        drift -= (drift - costModelDrift) / 2;
+    }
+    drift = hostClampBetween<unsigned int, unsigned int>(drift, 0, solverFlags.upperBoundFutureDrift);
+
+    DEME_DEBUG_PRINTF("Cost model: dT step %.4g ms, kT update %.4g ms", costModelStepSec * 1e3, costModelCDSec * 1e3);
+    DEME_DEBUG_PRINTF("Cost model future drift is %u, current future drift is %u", costModelDrift, drift);
+}
+
+inline void DEMDynamicThread::ifProduceFreshThenUseItAndSendNewOrder() {
+    if (pSchedSupport->dynamicOwned_Prod2ConsBuffer_isFresh) {
+        timers.GetTimer("Unpack updates from kT").start();
+        unpack_impl();
+        timers.GetTimer("Unpack updates from kT").stop();
+
+        // kT is idle between sending me its produce and getting a new work order, so this is when the spheres can be
+        // re-ordered on both sides
+        if (solverFlags.sphereReorderFreq > 0 && ++nKTUpdatesSinceReorder >= solverFlags.sphereReorderFreq) {
+            timers.GetTimer("Re-order spheres").start();
+            reorderSpheres();
+            nKTUpdatesSinceReorder = 0;
+            timers.GetTimer("Re-order spheres").stop();
+        }
+        // Clumps the user inserted since the last handoff go in now, so kT sees them in this work order
+        applyClumpInsertions();
+
+        timers.GetTimer("Send to kT buffer").start();
+        // Refresh the work order for the kinematic. The copies are only queued; kT's stream waits for them.
+        calibrateParams();
+        sendToTheirBuffer();
+        pSchedSupport->kinematicOwned_Cons2ProdBuffer_isFresh = true;
+        pSchedSupport->schedulingStats.nKinematicUpdates++;
+        accumStepUpdater.AddUpdate();
+
+        timers.GetTimer("Send to kT buffer").stop();
+        // Signal the kinematic that it has data for a new work order
+        pSchedSupport->cv_KinematicCanProceed.notify_all();
+    }
+}
+
+// Gather a per-sphere array into the new sphere order, in place, using buffer as the scratch space
+template <typename T>
+static void permuteSphereArray(std::shared_ptr<JitProgram>& misc_kernels,
+                               T* arr,
+                               bodyID_t* newToOld,
+                               char* buffer,
+                               size_t n,
+                               cudaStream_t& this_stream) {
+    size_t blocks_needed = (n + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    misc_kernels->kernel("gatherByPermutation")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+        .launch(buffer, (char*)arr, newToOld, (unsigned int)sizeof(T), n);
+    DEME_GPU_CALL(cudaMemcpyAsync(arr, buffer, n * sizeof(T), cudaMemcpyDeviceToDevice, this_stream));
+}
+
+// The same, for a per-contact array
+template <typename T>
+static void permuteContactArray(std::shared_ptr<JitProgram>& misc_kernels,
+                                T* arr,
+                                contactPairs_t* newToOld,
+                                char* buffer,
+                                size_t n,
+                                cudaStream_t& this_stream) {
+    size_t blocks_needed = (n + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    misc_kernels->kernel("gatherContactsByPermutation")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+        .launch(buffer, (char*)arr, newToOld, (unsigned int)sizeof(T), n);
+    DEME_GPU_CALL(cudaMemcpyAsync(arr, buffer, n * sizeof(T), cudaMemcpyDeviceToDevice, this_stream));
+}
+
+size_t DEMDynamicThread::countCanonicalContacts(size_t n) {
+    size_t* pCount = stateOfSolver_resources.pTempSizeVar2;
+    *pCount = 0;
+    misc_kernels->kernel("countCanonicalContacts")
+        .instantiate()
+        .configure(dim3((n + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK),
+                   dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+        .launch(granData->idGeometryA, granData->idGeometryB, granData->contactType, (unsigned long long*)pCount, n);
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    return *pCount;
+}
+
+void DEMDynamicThread::reorderSpheres() {
+    const size_t nSpheres = simParams->nSpheresGM;
+    const size_t nContacts = *stateOfSolver_resources.pNumContacts;
+    if (nSpheres < 2) {
+        return;
+    }
+    size_t blocks_needed = (nSpheres + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    uint64_t* keys = (uint64_t*)stateOfSolver_resources.allocateTempVector(0, nSpheres * sizeof(uint64_t));
+    uint64_t* keys_sorted = (uint64_t*)stateOfSolver_resources.allocateTempVector(1, nSpheres * sizeof(uint64_t));
+    bodyID_t* order = (bodyID_t*)stateOfSolver_resources.allocateTempVector(2, nSpheres * sizeof(bodyID_t));
+    bodyID_t* newToOld = (bodyID_t*)stateOfSolver_resources.allocateTempVector(3, nSpheres * sizeof(bodyID_t));
+    bodyID_t* oldToNew = (bodyID_t*)stateOfSolver_resources.allocateTempVector(4, nSpheres * sizeof(bodyID_t));
+
+    // Spheres are sorted by the Morton code of their owners' voxels. The sort is stable, so a clump's components stay
+    // together and in the original relative order.
+    misc_kernels->kernel("computeSphereMortonKeys")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+        .launch(simParams, granData, keys, order, nSpheres);
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    mortonKeySortByKey(keys, keys_sorted, order, newToOld, nSpheres, streamInfo.stream, stateOfSolver_resources);
+    misc_kernels->kernel("invertPermutation")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+        .launch(newToOld, oldToNew, nSpheres);
+
+    // The keys are no longer needed, so their space holds the permuted arrays before they are copied back. Template
+    // arrays are only per-sphere if clump templates are not jitified.
+    char* buffer = (char*)keys;
+    permuteSphereArray(misc_kernels, ownerClumpBody.data(), newToOld, buffer, nSpheres, streamInfo.stream);
+    permuteSphereArray(misc_kernels, sphereMaterialOffset.data(), newToOld, buffer, nSpheres, streamInfo.stream);
+    permuteSphereArray(misc_kernels, kT->ownerClumpBody.data(), newToOld, buffer, nSpheres, streamInfo.stream);
+    if (solverFlags.useClumpJitify) {
+        permuteSphereArray(misc_kernels, clumpComponentOffset.data(), newToOld, buffer, nSpheres, streamInfo.stream);
+        permuteSphereArray(misc_kernels, clumpComponentOffsetExt.data(), newToOld, buffer, nSpheres,
+                           streamInfo.stream);
+        permuteSphereArray(misc_kernels, kT->clumpComponentOffset.data(), newToOld, buffer, nSpheres,
+                           streamInfo.stream);
+        permuteSphereArray(misc_kernels, kT->clumpComponentOffsetExt.data(), newToOld, buffer, nSpheres,
+                           streamInfo.stream);
+    } else {
+        permuteSphereArray(misc_kernels, radiiSphere.data(), newToOld, buffer, nSpheres, streamInfo.stream);
+        permuteSphereArray(misc_kernels, relPosSphereX.data(), newToOld, buffer, nSpheres, streamInfo.stream);
+        permuteSphereArray(misc_kernels, relPosSphereY.data(), newToOld, buffer, nSpheres, streamInfo.stream);
+        permuteSphereArray(misc_kernels, relPosSphereZ.data(), newToOld, buffer, nSpheres, streamInfo.stream);
+        permuteSphereArray(misc_kernels, kT->radiiSphere.data(), newToOld, buffer, nSpheres, streamInfo.stream);
+        permuteSphereArray(misc_kernels, kT->relPosSphereX.data(), newToOld, buffer, nSpheres, streamInfo.stream);
+        permuteSphereArray(misc_kernels, kT->relPosSphereY.data(), newToOld, buffer, nSpheres, streamInfo.stream);
+        permuteSphereArray(misc_kernels, kT->relPosSphereZ.data(), newToOld, buffer, nSpheres, streamInfo.stream);
+    }
+    for (unsigned int i = 0; i < simParams->nGeoWildcards; i++) {
+        permuteSphereArray(misc_kernels, sphereWildcards[i].data(), newToOld, buffer, nSpheres, streamInfo.stream);
+    }
+
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+
+    // Then the sphere IDs in the contact array are remapped. kT's contact history mapping needs the previous contact
+    // array sorted by geometry A (within each contact type, if contact pairs are type-sorted), so the contacts (and the
+    // contact history that goes with them) are also re-sorted. The number of contacts of each type does not change, so
+    // the contact class offsets stay valid.
+    if (nContacts > 0) {
+        size_t blocks_needed_for_contacts = (nContacts + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+        bodyID_t* idA_sorted = (bodyID_t*)stateOfSolver_resources.allocateTempVector(1, nContacts * sizeof(bodyID_t));
+        contactPairs_t* cnt_order =
+            (contactPairs_t*)stateOfSolver_resources.allocateTempVector(2, nContacts * sizeof(contactPairs_t));
+        contactPairs_t* cnt_newToOld =
+            (contactPairs_t*)stateOfSolver_resources.allocateTempVector(3, nContacts * sizeof(contactPairs_t));
+        buffer = (char*)stateOfSolver_resources.allocateTempVector(0, nContacts * sizeof(float3));
+        notStupidBool_t* swapped =
+            (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(6, nContacts * sizeof(notStupidBool_t));
+        const size_t nCanonicalBefore = countCanonicalContacts(nContacts);
+        misc_kernels->kernel("remapSphereIDsInContacts")
+            .instantiate()
+            .configure(dim3(blocks_needed_for_contacts), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(granData, oldToNew, cnt_order, swapped, nContacts);
+        // A swapped contact's wildcards that change sign with the pair are negated
+        for (unsigned int i = 0; i < m_contact_wildcard_storage.size(); i++) {
+            const DEMContactWildcardStorage& store = m_contact_wildcard_storage[i];
+            if (store.antisymmetric) {
+                misc_kernels->kernel("negateSwappedContactWildcard")
+                    .instantiate()
+                    .configure(dim3(blocks_needed_for_contacts), dim3(DEME_MAX_THREADS_PER_BLOCK), 0,
+                               streamInfo.stream)
+                    .launch(contactWildcards[store.slot].data(), swapped, store.precision, store.half,
+                            store.max_abs / 32767.f, nContacts);
+            }
+        }
         DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
-        // displayFloat3(granData->contactForces, nContactPairs);
-        // displayArray<contact_t>(granData->contactType, nContactPairs);
-        // std::cout << "===========================" << std::endl;
-        timers.GetTimer("Calculate contact forces").stop();
+        // Every contact that the next contact detection could have matched to its history, it still can
+        const size_t nCanonicalAfter = countCanonicalContacts(nContacts);
+        if (nCanonicalAfter != nCanonicalBefore) {
+            DEME_ERROR("After reordering spheres, %zu contacts can be matched to their history, but there were %zu "
+                       "before.\nThis is a bug, please report it.",
+                       nCanonicalAfter, nCanonicalBefore);
+        }
+        contactIDSortByKey(granData->idGeometryA, idA_sorted, cnt_order, cnt_newToOld, nContacts, streamInfo.stream,
+                           stateOfSolver_resources);
+        if (solverFlags.should_sort_pairs) {
+            // A stable sort by type on top of the sort by geometry A
+            contact_t* type_sorted =
+                (contact_t*)stateOfSolver_resources.allocateTempVector(4, nContacts * sizeof(contact_t));
+            contactPairs_t* cnt_typeNewToOld =
+                (contactPairs_t*)stateOfSolver_resources.allocateTempVector(5, nContacts * sizeof(contactPairs_t));
+            permuteContactArray(misc_kernels, granData->contactType, cnt_newToOld, buffer, nContacts,
+                                streamInfo.stream);
+            contactTypeSortByKey(granData->contactType, type_sorted, cnt_newToOld, cnt_typeNewToOld, nContacts,
+                                 streamInfo.stream, stateOfSolver_resources);
+            DEME_GPU_CALL(cudaMemcpyAsync(granData->contactType, type_sorted, nContacts * sizeof(contact_t),
+                                          cudaMemcpyDeviceToDevice, streamInfo.stream));
+            DEME_GPU_CALL(cudaMemcpyAsync(cnt_newToOld, cnt_typeNewToOld, nContacts * sizeof(contactPairs_t),
+                                          cudaMemcpyDeviceToDevice, streamInfo.stream));
+            permuteContactArray(misc_kernels, granData->idGeometryA, cnt_newToOld, buffer, nContacts,
+                                streamInfo.stream);
+        } else {
+            DEME_GPU_CALL(cudaMemcpyAsync(granData->idGeometryA, idA_sorted, nContacts * sizeof(bodyID_t),
+                                          cudaMemcpyDeviceToDevice, streamInfo.stream));
+            permuteContactArray(misc_kernels, granData->contactType, cnt_newToOld, buffer, nContacts,
+                                streamInfo.stream);
+        }
+        permuteContactArray(misc_kernels, granData->idGeometryB, cnt_newToOld, buffer, nContacts, streamInfo.stream);
+        permuteContactArray(misc_kernels, contactForces.data(), cnt_newToOld, buffer, nContacts, streamInfo.stream);
+        permuteContactArray(misc_kernels, contactTorque_convToForce.data(), cnt_newToOld, buffer, nContacts,
+                            streamInfo.stream);
+        permuteContactArray(misc_kernels, contactPointGeometryA.data(), cnt_newToOld, buffer, nContacts,
+                            streamInfo.stream);
+        permuteContactArray(misc_kernels, contactPointGeometryB.data(), cnt_newToOld, buffer, nContacts,
+                            streamInfo.stream);
+        for (unsigned int i = 0; i < simParams->nContactWildcards; i++) {
+            permuteContactArray(misc_kernels, contactWildcards[i].data(), cnt_newToOld, buffer, nContacts,
+                                streamInfo.stream);
+        }
+        DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    }
+
+    // kT's last contact list refers to the old sphere IDs. In history-based runs, kT maps the next contact list to the
+    // previous one, which should now be the remapped dT contact array.
+    if (!solverFlags.isHistoryless) {
+        kT->updatePrevContactArrays(granData, nContacts);
+    }
+    kT->contactDeltaBaseValid = false;
+    kT->contactListReusable = false;
+    kT->fixedSphereBins.needRebuild = true;
+
+    // Compose the new ordering into the persistent user--impl sphere ID tables
+    std::vector<bodyID_t> host_oldToNew(nSpheres);
+    DEME_GPU_CALL(cudaMemcpy(host_oldToNew.data(), oldToNew, nSpheres * sizeof(bodyID_t), cudaMemcpyDeviceToHost));
+    std::vector<bodyID_t> newUserToImpl(nSpheres);
+    for (bodyID_t i = 0; i < nSpheres; i++) {
+        newUserToImpl[i] = host_oldToNew[getSphereImplID(i)];
+    }
+    sphereUserToImpl = std::move(newUserToImpl);
+    sphereImplToUser.resize(nSpheres);
+    for (bodyID_t i = 0; i < nSpheres; i++) {
+        sphereImplToUser[sphereUserToImpl[i]] = i;
+    }
+    DEME_DEBUG_PRINTF("Re-ordered %zu spheres along the Morton curve.", nSpheres);
+}
+
+void DEMDynamicThread::purgeClumpsOfFamily(family_t fam,
+                                           std::vector<bodyID_t>& ownerOldToNew,
+                                           std::vector<bodyID_t>& sphereUserOldToNew,
+                                           size_t& nOwnersLeft,
+                                           size_t& nSpheresLeft) {
+    const size_t nOwners = simParams->nOwnerBodies;
+    const size_t nSpheres = simParams->nSpheresGM;
+    const size_t nContacts = *stateOfSolver_resources.pNumContacts;
+    nOwnersLeft = nOwners;
+    nSpheresLeft = nSpheres;
+    if (nOwners == 0) {
+        return;
+    }
+    int prev_device;
+    DEME_GPU_CALL(cudaGetDevice(&prev_device));
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+
+    // Each temp vector is allocated once, large enough for all its uses below
+    const size_t nMax = DEME_MAX(DEME_MAX(nOwners, nSpheres), nContacts);
+    notStupidBool_t* flags =
+        (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(0, nMax * sizeof(notStupidBool_t));
+    char* newToOld = (char*)stateOfSolver_resources.allocateTempVector(
+        1, nMax * DEME_MAX(sizeof(bodyID_t), sizeof(contactPairs_t)));
+    bodyID_t* dOwnerOldToNew = (bodyID_t*)stateOfSolver_resources.allocateTempVector(2, nOwners * sizeof(bodyID_t));
+    char* buffer = (char*)stateOfSolver_resources.allocateTempVector(
+        3, nMax * DEME_MAX(sizeof(float3), sizeof(voxelID_t)));
+    notStupidBool_t* sphereFlags = (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(
+        4, DEME_MAX(nSpheres, (size_t)1) * sizeof(notStupidBool_t));
+    bodyID_t* dSphereOldToNew =
+        (bodyID_t*)stateOfSolver_resources.allocateTempVector(5, DEME_MAX(nSpheres, (size_t)1) * sizeof(bodyID_t));
+    contactPairs_t* cnt_newToOld = (contactPairs_t*)stateOfSolver_resources.allocateTempVector(
+        6, DEME_MAX(nContacts, (size_t)1) * sizeof(contactPairs_t));
+
+    // The owners that stay, in their original order, so the surviving owners, spheres and contacts keep their relative
+    // order. The ID maps are then monotone, and the contact array stays sorted as kT needs it.
+    size_t blocks_needed = (nOwners + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    misc_kernels->kernel("markOwnersToKeep")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+        .launch(granData, fam, flags, nOwners);
+    bodyIDSelectFlagged(flags, (bodyID_t*)newToOld, stateOfSolver_resources.pTempSizeVar1, nOwners, streamInfo.stream,
+                        stateOfSolver_resources);
+    nOwnersLeft = *(stateOfSolver_resources.pTempSizeVar1);
+    if (nOwnersLeft == nOwners) {
+        DEME_GPU_CALL(cudaSetDevice(prev_device));
+        return;
+    }
+    misc_kernels->kernel("markRemovedIDs")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+        .launch(flags, dOwnerOldToNew, nOwners);
+    if (nOwnersLeft > 0) {
+        misc_kernels->kernel("invertPermutation")
+            .instantiate()
+            .configure(dim3((nOwnersLeft + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK),
+                       dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch((bodyID_t*)newToOld, dOwnerOldToNew, nOwnersLeft);
+    }
+
+    // The spheres of the owners that stay
+    if (nSpheres > 0) {
+        misc_kernels->kernel("markSpheresForOutput")
+            .instantiate()
+            .configure(dim3((nSpheres + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK),
+                       dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(granData, flags, (const bodyID_t*)nullptr, sphereFlags, nSpheres);
+    }
+
+    // Compact the per-owner arrays. The gather used for sphere re-ordering does it, as it writes back only the first
+    // nOwnersLeft elements.
+    {
+        bodyID_t* ownerNewToOld = (bodyID_t*)newToOld;
+        const size_t n = nOwnersLeft;
+        cudaStream_t& s = streamInfo.stream;
+        permuteSphereArray(misc_kernels, familyID.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, voxelID.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, locX.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, locY.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, locZ.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, oriQw.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, oriQx.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, oriQy.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, oriQz.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, vX.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, vY.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, vZ.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, ownerAbsVel.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, ownerQuietSteps.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, omgBarX.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, omgBarY.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, omgBarZ.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, aX.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, aY.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, aZ.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, alphaX.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, alphaY.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, alphaZ.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, accSpecified.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, angAccSpecified.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, ownerTypes.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, inertiaPropOffsets.data(), ownerNewToOld, buffer, n, s);
+        if (!solverFlags.useMassJitify) {
+            permuteSphereArray(misc_kernels, massOwnerBody.data(), ownerNewToOld, buffer, n, s);
+            permuteSphereArray(misc_kernels, mmiXX.data(), ownerNewToOld, buffer, n, s);
+            permuteSphereArray(misc_kernels, mmiYY.data(), ownerNewToOld, buffer, n, s);
+            permuteSphereArray(misc_kernels, mmiZZ.data(), ownerNewToOld, buffer, n, s);
+        }
+        for (unsigned int i = 0; i < simParams->nOwnerWildcards; i++) {
+            permuteSphereArray(misc_kernels, ownerWildcards[i].data(), ownerNewToOld, buffer, n, s);
+        }
+        // kT's last-CD owner states are not compacted; instead, kT is told not to reuse its last contact list
+        permuteSphereArray(misc_kernels, kT->familyID.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, kT->voxelID.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, kT->locX.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, kT->locY.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, kT->locZ.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, kT->oriQw.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, kT->oriQx.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, kT->oriQy.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, kT->oriQz.data(), ownerNewToOld, buffer, n, s);
+        permuteSphereArray(misc_kernels, kT->marginSize.data(), ownerNewToOld, buffer, n, s);
+    }
 
-        if (!solverFlags.useForceCollectInPlace) {
-            timers.GetTimer("Collect contact forces").start();
-            // Reflect those body-wise forces on their owner clumps
-            if (solverFlags.useCubForceCollect) {
-                collectContactForcesThruCub(collect_force_kernels, granData, nContactPairs, simParams->nOwnerBodies,
-                                            contactPairArr_isFresh, streamInfo.stream, stateOfSolver_resources, timers);
+    // Then the per-sphere arrays, the same way as in sphere re-ordering
+    if (nSpheres > 0) {
+        bodyID_t* sphereNewToOld = (bodyID_t*)newToOld;
+        bodyIDSelectFlagged(sphereFlags, sphereNewToOld, stateOfSolver_resources.pTempSizeVar1, nSpheres,
+                            streamInfo.stream, stateOfSolver_resources);
+        nSpheresLeft = *(stateOfSolver_resources.pTempSizeVar1);
+        misc_kernels->kernel("markRemovedIDs")
+            .instantiate()
+            .configure(dim3((nSpheres + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK),
+                       dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(sphereFlags, dSphereOldToNew, nSpheres);
+        const size_t n = nSpheresLeft;
+        cudaStream_t& s = streamInfo.stream;
+        if (n > 0) {
+            misc_kernels->kernel("invertPermutation")
+                .instantiate()
+                .configure(dim3((n + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK),
+                           dim3(DEME_MAX_THREADS_PER_BLOCK), 0, s)
+                .launch(sphereNewToOld, dSphereOldToNew, n);
+            permuteSphereArray(misc_kernels, ownerClumpBody.data(), sphereNewToOld, buffer, n, s);
+            permuteSphereArray(misc_kernels, sphereMaterialOffset.data(), sphereNewToOld, buffer, n, s);
+            permuteSphereArray(misc_kernels, kT->ownerClumpBody.data(), sphereNewToOld, buffer, n, s);
+            if (solverFlags.useClumpJitify) {
+                permuteSphereArray(misc_kernels, clumpComponentOffset.data(), sphereNewToOld, buffer, n, s);
+                permuteSphereArray(misc_kernels, clumpComponentOffsetExt.data(), sphereNewToOld, buffer, n, s);
+                permuteSphereArray(misc_kernels, kT->clumpComponentOffset.data(), sphereNewToOld, buffer, n, s);
+                permuteSphereArray(misc_kernels, kT->clumpComponentOffsetExt.data(), sphereNewToOld, buffer, n, s);
             } else {
-                blocks_needed_for_contacts =
-                    (nContactPairs + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
-                // This does both acc and ang acc
-                collect_force_kernels->kernel("forceToAcc")
-                    .instantiate()
-                    .configure(dim3(blocks_needed_for_contacts), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
-                    .launch(granData, nContactPairs);
-                DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+                permuteSphereArray(misc_kernels, radiiSphere.data(), sphereNewToOld, buffer, n, s);
+                permuteSphereArray(misc_kernels, relPosSphereX.data(), sphereNewToOld, buffer, n, s);
+                permuteSphereArray(misc_kernels, relPosSphereY.data(), sphereNewToOld, buffer, n, s);
+                permuteSphereArray(misc_kernels, relPosSphereZ.data(), sphereNewToOld, buffer, n, s);
+                permuteSphereArray(misc_kernels, kT->radiiSphere.data(), sphereNewToOld, buffer, n, s);
+                permuteSphereArray(misc_kernels, kT->relPosSphereX.data(), sphereNewToOld, buffer, n, s);
+                permuteSphereArray(misc_kernels, kT->relPosSphereY.data(), sphereNewToOld, buffer, n, s);
+                permuteSphereArray(misc_kernels, kT->relPosSphereZ.data(), sphereNewToOld, buffer, n, s);
             }
-            // displayArray<float>(granData->aZ, simParams->nOwnerBodies);
-            // displayFloat3(granData->contactForces, nContactPairs);
-            // std::cout << nContactPairs << std::endl;
-            timers.GetTimer("Collect contact forces").stop();
+            for (unsigned int i = 0; i < simParams->nGeoWildcards; i++) {
+                permuteSphereArray(misc_kernels, sphereWildcards[i].data(), sphereNewToOld, buffer, n, s);
+            }
+            // The spheres that stay belong to owners that stay, so their owner IDs can be remapped
+            blocks_needed = (n + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+            misc_kernels->kernel("remapBodyIDs")
+                .instantiate()
+                .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, s)
+                .launch(ownerClumpBody.data(), dOwnerOldToNew, n);
+            misc_kernels->kernel("remapBodyIDs")
+                .instantiate()
+                .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, s)
+                .launch(kT->ownerClumpBody.data(), dOwnerOldToNew, n);
         }
     }
-}
-
-inline void DEMDynamicThread::integrateOwnerMotions() {
-    size_t blocks_needed_for_clumps =
-        (simParams->nOwnerBodies + DEME_NUM_BODIES_PER_BLOCK - 1) / DEME_NUM_BODIES_PER_BLOCK;
-    integrator_kernels->kernel("integrateOwners")
-        .instantiate()
-        .configure(dim3(blocks_needed_for_clumps), dim3(DEME_NUM_BODIES_PER_BLOCK), 0, streamInfo.stream)
-        .launch(simParams, granData);
-    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
-}
+    // Meshes all stay, but their owners may have moved
+    if (simParams->nTriGM > 0) {
+        blocks_needed = (simParams->nTriGM + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+        misc_kernels->kernel("remapBodyIDs")
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(ownerMesh.data(), dOwnerOldToNew, (size_t)simParams->nTriGM);
+        misc_kernels->kernel("remapBodyIDs")
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(kT->ownerMesh.data(), dOwnerOldToNew, (size_t)simParams->nTriGM);
+    }
 
-inline void DEMDynamicThread::routineChecks() {
-    if (solverFlags.canFamilyChange) {
-        size_t blocks_needed_for_clumps =
-            (simParams->nOwnerBodies + DEME_NUM_MODERATORS_PER_BLOCK - 1) / DEME_NUM_MODERATORS_PER_BLOCK;
-        mod_kernels->kernel("applyFamilyChanges")
+    // The contacts that involve a purged sphere go away, along with their history. The rest keep their order, and
+    // since the sphere ID map is monotone, the contact array stays sorted by geometry A (and by type, if it was).
+    size_t nContactsLeft = 0;
+    if (nContacts > 0) {
+        blocks_needed = (nContacts + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+        misc_kernels->kernel("markContactsOfKeptSpheres")
             .instantiate()
-            .configure(dim3(blocks_needed_for_clumps), dim3(DEME_NUM_MODERATORS_PER_BLOCK), 0, streamInfo.stream)
-            .launch(simParams, granData, simParams->nOwnerBodies);
-        DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(granData, dSphereOldToNew, flags, nContacts);
+        contactIDSelectFlagged(flags, cnt_newToOld, stateOfSolver_resources.pTempSizeVar1, nContacts,
+                               streamInfo.stream, stateOfSolver_resources);
+        nContactsLeft = *(stateOfSolver_resources.pTempSizeVar1);
+    }
+    if (nContactsLeft > 0) {
+        const size_t n = nContactsLeft;
+        cudaStream_t& s = streamInfo.stream;
+        permuteContactArray(misc_kernels, granData->idGeometryA, cnt_newToOld, buffer, n, s);
+        permuteContactArray(misc_kernels, granData->idGeometryB, cnt_newToOld, buffer, n, s);
+        permuteContactArray(misc_kernels, granData->contactType, cnt_newToOld, buffer, n, s);
+        if (!solverFlags.useNoContactRecord) {
+            permuteContactArray(misc_kernels, contactForces.data(), cnt_newToOld, buffer, n, s);
+            permuteContactArray(misc_kernels, contactTorque_convToForce.data(), cnt_newToOld, buffer, n, s);
+            permuteContactArray(misc_kernels, contactPointGeometryA.data(), cnt_newToOld, buffer, n, s);
+            permuteContactArray(misc_kernels, contactPointGeometryB.data(), cnt_newToOld, buffer, n, s);
+        }
+        for (unsigned int i = 0; i < simParams->nContactWildcards; i++) {
+            permuteContactArray(misc_kernels, contactWildcards[i].data(), cnt_newToOld, buffer, n, s);
+        }
+        // The contact order is not needed here, so it goes to a temp vector that is no longer in use. Removing spheres
+        // keeps the order of the rest, so no contact gets its geometries swapped, and no swap flags are needed.
+        misc_kernels->kernel("remapSphereIDsInContacts")
+            .instantiate()
+            .configure(dim3((n + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK),
+                       dim3(DEME_MAX_THREADS_PER_BLOCK), 0, s)
+            .launch(granData, dSphereOldToNew, (contactPairs_t*)newToOld, (notStupidBool_t*)NULL, n);
     }
-}
 
-inline float* DEMDynamicThread::determineSysVel() {
-    return approxMaxVelFunc->dT_GetValue();
-}
+    // Bring the ID maps to the host
+    ownerOldToNew.resize(nOwners);
+    DEME_GPU_CALL(cudaMemcpyAsync(ownerOldToNew.data(), dOwnerOldToNew, nOwners * sizeof(bodyID_t),
+                                  cudaMemcpyDeviceToHost, streamInfo.stream));
+    std::vector<bodyID_t> host_sphereOldToNew(nSpheres);
+    if (nSpheres > 0) {
+        DEME_GPU_CALL(cudaMemcpyAsync(host_sphereOldToNew.data(), dSphereOldToNew, nSpheres * sizeof(bodyID_t),
+                                      cudaMemcpyDeviceToHost, streamInfo.stream));
+    }
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    for (auto& owner : ownerAnalBody) {
+        owner = ownerOldToNew[owner];
+    }
+    for (auto& mmesh : m_meshes) {
+        mmesh->owner = ownerOldToNew[mmesh->owner];
+    }
 
-inline void DEMDynamicThread::unpack_impl() {
-    {
-        // Acquire lock and use the content of the dynamic-owned transfer buffer
-        std::lock_guard<std::mutex> lock(pSchedSupport->dynamicOwnedBuffer_AccessCoordination);
-        unpackMyBuffer();
-        // Leave myself a mental note that I just obtained new produce from kT
-        contactPairArr_isFresh = true;
-        // pSchedSupport->schedulingStats.nDynamicReceives++;
+    // A sphere that stays gets the user ID of its rank among the spheres that stay, in the user-facing order. If the
+    // spheres were re-ordered, the user--impl tables are rebuilt; otherwise both IDs are the new impl ID.
+    sphereUserOldToNew.assign(nSpheres, NULL_BODYID);
+    std::vector<bodyID_t> newUserToImpl;
+    bodyID_t nextUserID = 0;
+    for (bodyID_t i = 0; i < nSpheres; i++) {
+        const bodyID_t newImpl = host_sphereOldToNew[getSphereImplID(i)];
+        if (newImpl != NULL_BODYID) {
+            sphereUserOldToNew[i] = nextUserID++;
+            newUserToImpl.push_back(newImpl);
+        }
+    }
+    if (!sphereUserToImpl.empty()) {
+        sphereUserToImpl = std::move(newUserToImpl);
+        sphereImplToUser.resize(nSpheresLeft);
+        for (bodyID_t i = 0; i < nSpheresLeft; i++) {
+            sphereImplToUser[sphereUserToImpl[i]] = i;
+        }
     }
-    // dT got the produce, now mark its buffer to be no longer fresh.
-    pSchedSupport->dynamicOwned_Prod2ConsBuffer_isFresh = false;
-    // Used for inspecting on average how stale kT's produce is.
-    pSchedSupport->schedulingStats.accumKinematicLagSteps +=
-        (pSchedSupport->currentStampOfDynamic).load() - (pSchedSupport->stampLastDynamicUpdateProdDate).load();
-    // dT needs to know how fresh the contact pair info is, and that is determined by when kT received this batch of
-    // ingredients.
-    pSchedSupport->stampLastDynamicUpdateProdDate = (pSchedSupport->kinematicIngredProdDateStamp).load();
 
-    // If this is a history-based run, then when contacts are received, we need to migrate the contact
-    // history info, to match the structure of the new contact array
+    // The sizes the contact arrays are now known by, before kT takes the compacted contacts as its previous ones. The
+    // rest of the sizes are set when the arrays are re-sized.
+    *stateOfSolver_resources.pNumContacts = nContactsLeft;
+    simParams->nSpheresGM = nSpheresLeft;
+    kT->simParams->nSpheresGM = nSpheresLeft;
     if (!solverFlags.isHistoryless) {
-        migratePersistentContacts();
+        kT->updatePrevContactArrays(granData, nContactsLeft);
     }
+    kT->contactDeltaBaseValid = false;
+    kT->contactListReusable = false;
+    kT->fixedSphereBins.needRebuild = true;
+    // A kT produce that dT has not unpacked yet refers to the old IDs, and its contact mapping to the old contact
+    // array, so it is dropped. The critical update makes dT wait for a new one.
+    pSchedSupport->dynamicOwned_Prod2ConsBuffer_isFresh = false;
+    contactPairArr_isFresh = true;
+    ownerAbsVelIsValid = false;
+    announceCritical();
+
+    DEME_GPU_CALL(cudaSetDevice(prev_device));
+    DEME_DEBUG_PRINTF("Purged %zu owners, %zu spheres and %zu contacts of family %u.", nOwners - nOwnersLeft,
+                      nSpheres - nSpheresLeft, nContacts - nContactsLeft, (unsigned int)fam);
 }
 
-inline void DEMDynamicThread::ifProduceFreshThenUseIt() {
-    if (pSchedSupport->dynamicOwned_Prod2ConsBuffer_isFresh) {
-        unpack_impl();
+void DEMDynamicThread::queueClumpInsertion(const DEMClumpBatch& batch, size_t firstOwner, size_t firstSphere) {
+    const size_t nClumps = batch.GetNumClumps();
+    const size_t nSpheres = batch.GetNumSpheres();
+    ClumpInsertion insertion;
+    insertion.nOwners = nClumps;
+    insertion.nSpheres = nSpheres;
+
+    // The clump (in this batch) each sphere belongs to, and its number in that clump
+    std::vector<size_t> sp_owner(nSpheres);
+    std::vector<unsigned int> sp_comp(nSpheres);
+    {
+        size_t k = 0;
+        for (size_t i = 0; i < nClumps; i++) {
+            for (unsigned int j = 0; j < batch.types[i]->nComp; j++) {
+                sp_owner[k] = i;
+                sp_comp[k] = j;
+                k++;
+            }
+        }
     }
-}
 
-inline void DEMDynamicThread::calibrateParams() {
-    // Unpacking is done; now we can use temp arrays again to derive max velocity and send to kT
-    pCycleMaxVel = determineSysVel();
+    // Owner positions are converted to the voxel system here, so the device side only copies
+    float3 LBF;
+    LBF.x = simParams->LBFX;
+    LBF.y = simParams->LBFY;
+    LBF.z = simParams->LBFZ;
+    std::vector<voxelID_t> vox(nClumps);
+    std::vector<subVoxelPos_t> loc_x(nClumps), loc_y(nClumps), loc_z(nClumps);
+    bool in_domain_msg = false;
+    float3 sus_point;
+    for (size_t i = 0; i < nClumps; i++) {
+        const float3 this_clump_xyz = batch.xyz[i];
+        if (!isBetween(this_clump_xyz, simParams->userBoxMin, simParams->userBoxMax)) {
+            sus_point = this_clump_xyz;
+            in_domain_msg = true;
+        }
+        const float3 this_CoM_coord = this_clump_xyz - LBF;
+        hostPositionToVoxelID<voxelID_t, subVoxelPos_t, double>(
+            vox[i], loc_x[i], loc_y[i], loc_z[i], (double)this_CoM_coord.x, (double)this_CoM_coord.y,
+            (double)this_CoM_coord.z, simParams->nvXp2, simParams->nvYp2, simParams->voxelSize, simParams->l);
+    }
 
-    if (solverFlags.autoUpdateFreq) {
-        unsigned int comfortable_drift;
-        if (accumStepUpdater.Query(comfortable_drift)) {
-            // If perhapsIdealFutureDrift needs to increase, then the following value much = perhapsIdealFutureDrift.
-            comfortable_drift =
-                (float)comfortable_drift * solverFlags.targetDriftMultipleOfAvg + solverFlags.targetDriftMoreThanAvg;
-            if (granData->perhapsIdealFutureDrift > comfortable_drift) {
-                granData->perhapsIdealFutureDrift -= FUTURE_DRIFT_TWEAK_STEP_SIZE;
-            } else if (granData->perhapsIdealFutureDrift < comfortable_drift) {
-                granData->perhapsIdealFutureDrift += FUTURE_DRIFT_TWEAK_STEP_SIZE;
+    // Lay out the columns first, then fill them in the pinned buffer once its size is known
+    std::vector<std::function<void(char*)>> fills;
+    size_t bytes = 0;
+    auto add_column = [&](auto get_array, size_t first, size_t n, auto value) {
+        using T = typename std::decay_t<decltype(get_array())>::value_type;
+        insertion.columns.push_back({[get_array]() { return (void*)get_array().data(); }, first, sizeof(T), n, bytes});
+        fills.push_back([n, value](char* buf) {
+            T* vals = reinterpret_cast<T*>(buf);
+            for (size_t i = 0; i < n; i++) {
+                vals[i] = value(i);
             }
-            granData->perhapsIdealFutureDrift = hostClampBetween<unsigned int, unsigned int>(
-                granData->perhapsIdealFutureDrift, 0, solverFlags.upperBoundFutureDrift);
+        });
+        // Keep every column aligned
+        bytes += (n * sizeof(T) + 15) / 16 * 16;
+    };
+
+    // Owner columns
+    add_column([this]() -> auto& { return ownerTypes; }, firstOwner, nClumps, [](size_t) { return OWNER_T_CLUMP; });
+    add_column([this]() -> auto& { return inertiaPropOffsets; }, firstOwner, nClumps,
+               [&](size_t i) { return batch.types[i]->mark; });
+    if (!solverFlags.useMassJitify) {
+        add_column([this]() -> auto& { return massOwnerBody; }, firstOwner, nClumps,
+                   [&](size_t i) { return batch.types[i]->mass; });
+        add_column([this]() -> auto& { return mmiXX; }, firstOwner, nClumps,
+                   [&](size_t i) { return batch.types[i]->MOI.x; });
+        add_column([this]() -> auto& { return mmiYY; }, firstOwner, nClumps,
+                   [&](size_t i) { return batch.types[i]->MOI.y; });
+        add_column([this]() -> auto& { return mmiZZ; }, firstOwner, nClumps,
+                   [&](size_t i) { return batch.types[i]->MOI.z; });
+    }
+    add_column([this]() -> auto& { return voxelID; }, firstOwner, nClumps, [&](size_t i) { return vox[i]; });
+    add_column([this]() -> auto& { return locX; }, firstOwner, nClumps, [&](size_t i) { return loc_x[i]; });
+    add_column([this]() -> auto& { return locY; }, firstOwner, nClumps, [&](size_t i) { return loc_y[i]; });
+    add_column([this]() -> auto& { return locZ; }, firstOwner, nClumps, [&](size_t i) { return loc_z[i]; });
+    add_column([this]() -> auto& { return oriQw; }, firstOwner, nClumps, [&](size_t i) { return batch.oriQ[i].w; });
+    add_column([this]() -> auto& { return oriQx; }, firstOwner, nClumps, [&](size_t i) { return batch.oriQ[i].x; });
+    add_column([this]() -> auto& { return oriQy; }, firstOwner, nClumps, [&](size_t i) { return batch.oriQ[i].y; });
+    add_column([this]() -> auto& { return oriQz; }, firstOwner, nClumps, [&](size_t i) { return batch.oriQ[i].z; });
+    add_column([this]() -> auto& { return vX; }, firstOwner, nClumps, [&](size_t i) { return batch.vel[i].x; });
+    add_column([this]() -> auto& { return vY; }, firstOwner, nClumps, [&](size_t i) { return batch.vel[i].y; });
+    add_column([this]() -> auto& { return vZ; }, firstOwner, nClumps, [&](size_t i) { return batch.vel[i].z; });
+    add_column([this]() -> auto& { return omgBarX; }, firstOwner, nClumps,
+               [&](size_t i) { return batch.angVel[i].x; });
+    add_column([this]() -> auto& { return omgBarY; }, firstOwner, nClumps,
+               [&](size_t i) { return batch.angVel[i].y; });
+    add_column([this]() -> auto& { return omgBarZ; }, firstOwner, nClumps,
+               [&](size_t i) { return batch.angVel[i].z; });
+    add_column([this]() -> auto& { return familyID; }, firstOwner, nClumps,
+               [&](size_t i) { return batch.families[i]; });
+    // kT only gets the family numbers from the transfer buffer if families can change
+    add_column([this]() -> auto& { return kT->familyID; }, firstOwner, nClumps,
+               [&](size_t i) { return batch.families[i]; });
+
+    // Sphere columns, which go to both dT and kT
+    auto owner_of = [&](size_t k) { return (bodyID_t)(firstOwner + sp_owner[k]); };
+    add_column([this]() -> auto& { return ownerClumpBody; }, firstSphere, nSpheres, owner_of);
+    add_column([this]() -> auto& { return kT->ownerClumpBody; }, firstSphere, nSpheres, owner_of);
+    add_column([this]() -> auto& { return sphereMaterialOffset; }, firstSphere, nSpheres,
+               [&](size_t k) { return batch.types[sp_owner[k]]->materials.at(sp_comp[k])->load_order; });
+    if (solverFlags.useClumpJitify) {
+        auto comp_offset_ext = [&](size_t k) {
+            return templateCompOffsets.at(batch.types[sp_owner[k]]->mark) + sp_comp[k];
+        };
+        // A component offset too large to live in the jitified array gets an indicator
+        auto comp_offset = [&](size_t k) {
+            unsigned int this_comp_offset = comp_offset_ext(k);
+            return (this_comp_offset < simParams->nJitifiableClumpComponents)
+                       ? (clumpComponentOffset_t)this_comp_offset
+                       : (clumpComponentOffset_t)RESERVED_CLUMP_COMPONENT_OFFSET;
+        };
+        add_column([this]() -> auto& { return clumpComponentOffsetExt; }, firstSphere, nSpheres, comp_offset_ext);
+        add_column([this]() -> auto& { return kT->clumpComponentOffsetExt; }, firstSphere, nSpheres,
+                   comp_offset_ext);
+        add_column([this]() -> auto& { return clumpComponentOffset; }, firstSphere, nSpheres, comp_offset);
+        add_column([this]() -> auto& { return kT->clumpComponentOffset; }, firstSphere, nSpheres, comp_offset);
+    } else {
+        auto radius = [&](size_t k) { return batch.types[sp_owner[k]]->radii.at(sp_comp[k]); };
+        auto rel_x = [&](size_t k) { return batch.types[sp_owner[k]]->relPos.at(sp_comp[k]).x; };
+        auto rel_y = [&](size_t k) { return batch.types[sp_owner[k]]->relPos.at(sp_comp[k]).y; };
+        auto rel_z = [&](size_t k) { return batch.types[sp_owner[k]]->relPos.at(sp_comp[k]).z; };
+        add_column([this]() -> auto& { return radiiSphere; }, firstSphere, nSpheres, radius);
+        add_column([this]() -> auto& { return relPosSphereX; }, firstSphere, nSpheres, rel_x);
+        add_column([this]() -> auto& { return relPosSphereY; }, firstSphere, nSpheres, rel_y);
+        add_column([this]() -> auto& { return relPosSphereZ; }, firstSphere, nSpheres, rel_z);
+        add_column([this]() -> auto& { return kT->radiiSphere; }, firstSphere, nSpheres, radius);
+        add_column([this]() -> auto& { return kT->relPosSphereX; }, firstSphere, nSpheres, rel_x);
+        add_column([this]() -> auto& { return kT->relPosSphereY; }, firstSphere, nSpheres, rel_y);
+        add_column([this]() -> auto& { return kT->relPosSphereZ; }, firstSphere, nSpheres, rel_z);
+    }
 
-            DEME_DEBUG_PRINTF("Comfortable future drift is %u", comfortable_drift);
-            DEME_DEBUG_PRINTF("Current future drift is %u", granData->perhapsIdealFutureDrift);
+    // Wildcards. The ones not given are 0.
+    unsigned int w_num = 0;
+    for (const auto& w_name : m_owner_wildcard_names) {
+        auto it = batch.owner_wildcards.find(w_name);
+        if (it == batch.owner_wildcards.end()) {
+            DEME_WARNING(
+                "Owner wildcard %s is needed by force model, yet not specified for a batch of inserted clumps.\nTheir "
+                "initial values are defauled to 0.",
+                w_name.c_str());
+            add_column([this, w_num]() -> auto& { return ownerWildcards[w_num]; }, firstOwner, nClumps,
+                       [](size_t) { return 0.f; });
+        } else {
+            const auto& vals = it->second;
+            add_column([this, w_num]() -> auto& { return ownerWildcards[w_num]; }, firstOwner, nClumps,
+                       [&vals](size_t i) { return vals.at(i); });
+        }
+        w_num++;
+    }
+    w_num = 0;
+    for (const auto& w_name : m_geo_wildcard_names) {
+        auto it = batch.geo_wildcards.find(w_name);
+        if (it == batch.geo_wildcards.end()) {
+            DEME_WARNING(
+                "Geometry wildcard %s is needed by force model, yet not specified for a batch of inserted "
+                "clumps.\nTheir initial values are defauled to 0.",
+                w_name.c_str());
+            add_column([this, w_num]() -> auto& { return sphereWildcards[w_num]; }, firstSphere, nSpheres,
+                       [](size_t) { return 0.f; });
+        } else {
+            const auto& vals = it->second;
+            add_column([this, w_num]() -> auto& { return sphereWildcards[w_num]; }, firstSphere, nSpheres,
+                       [&vals](size_t k) { return vals.at(k); });
         }
+        w_num++;
+    }
+
+    DEME_GPU_CALL(cudaMallocHost((void**)&(insertion.pinned), bytes));
+    for (size_t i = 0; i < fills.size(); i++) {
+        fills[i](insertion.pinned + insertion.columns[i].offset);
+    }
+    if (in_domain_msg) {
+        DEME_WARNING(
+            "At least one inserted clump has a position out of the box domain you specified.\nIt is found at %.5g, "
+            "%.5g, %.5g (this message only shows one such example).",
+            sus_point.x, sus_point.y, sus_point.z);
     }
+
+    std::lock_guard<std::mutex> lock(pendingClumpInsertionsMutex);
+    pendingClumpInsertions.push_back(std::move(insertion));
 }
 
-inline void DEMDynamicThread::ifProduceFreshThenUseItAndSendNewOrder() {
-    if (pSchedSupport->dynamicOwned_Prod2ConsBuffer_isFresh) {
-        timers.GetTimer("Unpack updates from kT").start();
-        unpack_impl();
-        timers.GetTimer("Unpack updates from kT").stop();
+void DEMDynamicThread::applyClumpInsertions() {
+    std::vector<ClumpInsertion> insertions;
+    {
+        std::lock_guard<std::mutex> lock(pendingClumpInsertionsMutex);
+        insertions.swap(pendingClumpInsertions);
+    }
+    if (insertions.empty()) {
+        return;
+    }
+    int prev_device;
+    DEME_GPU_CALL(cudaGetDevice(&prev_device));
 
-        timers.GetTimer("Send to kT buffer").start();
-        // Acquire lock and refresh the work order for the kinematic
-        {
-            calibrateParams();
-            std::lock_guard<std::mutex> lock(pSchedSupport->kinematicOwnedBuffer_AccessCoordination);
-            sendToTheirBuffer();
-        }
-        pSchedSupport->kinematicOwned_Cons2ProdBuffer_isFresh = true;
-        pSchedSupport->schedulingStats.nKinematicUpdates++;
-        accumStepUpdater.AddUpdate();
+    size_t nNewOwners = 0, nNewSpheres = 0;
+    for (const auto& insertion : insertions) {
+        nNewOwners += insertion.nOwners;
+        nNewSpheres += insertion.nSpheres;
+    }
+    // The arrays of both sides grow to fit the new clumps, keeping what they have. No extra contacts come with them.
+    // Growing may re-allocate them, so the copies still queued into them (such as the contact arrays unpacked from
+    // kT's produce) must be done first, on both sides.
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    DEME_GPU_CALL(cudaStreamSynchronize(kT->streamInfo.stream));
+    const size_t nOwners = simParams->nOwnerBodies + nNewOwners;
+    const size_t nClumps = simParams->nOwnerClumps + nNewOwners;
+    const size_t nSpheres = simParams->nSpheresGM + nNewSpheres;
+    allocateManagedArrays(nOwners, nClumps, simParams->nExtObj, simParams->nTriMeshes, nSpheres, simParams->nTriGM,
+                          simParams->nTriNodeGM, simParams->nAnalGM, 0, simParams->nDistinctMassProperties,
+                          simParams->nDistinctClumpBodyTopologies, simParams->nDistinctClumpComponents,
+                          simParams->nJitifiableClumpComponents, simParams->nMatTuples);
+    kT->allocateManagedArrays(nOwners, nClumps, simParams->nExtObj, simParams->nTriMeshes, nSpheres,
+                              simParams->nTriGM, simParams->nTriNodeGM, simParams->nAnalGM, 0,
+                              simParams->nDistinctMassProperties, simParams->nDistinctClumpBodyTopologies,
+                              simParams->nDistinctClumpComponents, simParams->nJitifiableClumpComponents,
+                              simParams->nMatTuples);
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
 
-        timers.GetTimer("Send to kT buffer").stop();
-        // Signal the kinematic that it has data for a new work order
-        pSchedSupport->cv_KinematicCanProceed.notify_all();
+    // One async copy per column
+    for (const auto& insertion : insertions) {
+        for (const auto& col : insertion.columns) {
+            DEME_GPU_CALL(cudaMemcpyAsync((char*)col.dst() + col.first * col.elemBytes, insertion.pinned + col.offset,
+                                          col.n * col.elemBytes, cudaMemcpyHostToDevice, streamInfo.stream));
+        }
+    }
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    for (auto& insertion : insertions) {
+        DEME_GPU_CALL(cudaFreeHost(insertion.pinned));
     }
+
+    // The arrays may have been re-allocated
+    packDataPointers();
+    kT->packDataPointers();
+    packTransferPointers(kT);
+    DEMDynamicThread* self = this;
+    kT->packTransferPointers(self);
+    // Re-allocated arrays lost the advice given to the old ones
+    applyManagedMemHints();
+    kT->applyManagedMemHints();
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    DEME_GPU_CALL(cudaStreamSynchronize(kT->streamInfo.stream));
+    // kT has not seen the new spheres, so its next contact detection starts from scratch. The velocity used for the
+    // margins does not cover the new owners either.
+    kT->contactDeltaBaseValid = false;
+    kT->contactListReusable = false;
+    kT->fixedSphereBins.needRebuild = true;
+    ownerAbsVelIsValid = false;
+
+    DEME_GPU_CALL(cudaSetDevice(prev_device));
+    DEME_DEBUG_PRINTF("Inserted %zu clumps (%zu spheres) in %zu batches.", nNewOwners, nNewSpheres,
+                      insertions.size());
 }
 
 void DEMDynamicThread::workerThread() {
@@ -2090,6 +4037,13 @@ void DEMDynamicThread::workerThread() {
                 break;
             }
         }
+        // The user may have switched no-sync mode or event timing since the last run
+        timers.UseEvents(solverFlags.useNoSyncMode || solverFlags.useEventTiming, streamInfo.stream);
+        stepCostTimer.UseEvents(true, streamInfo.stream);
+        // The user may also have changed velocities since the last run
+        ownerAbsVelIsValid = false;
+        // And the host may have touched the arrays, so bring them back before the first step stalls on page faults
+        applyManagedMemHints();
 
         // There is only 2 situations where dT needs to wait for kT to provide one initial CD result...
         // Those are the `new-boot after previous sync' case, or the user significantly changed the simulation
@@ -2116,11 +4070,9 @@ void DEMDynamicThread::workerThread() {
 
             // In this `new-boot' case, we send kT a work order, b/c dT needs results from CD to proceed. After this one
             // instance, kT and dT may work in an async fashion.
-            {
-                pCycleMaxVel = determineSysVel();
-                std::lock_guard<std::mutex> lock(pSchedSupport->kinematicOwnedBuffer_AccessCoordination);
-                sendToTheirBuffer();
-            }
+            applyClumpInsertions();
+            pCycleMaxVel = determineSysVel();
+            sendToTheirBuffer();
             pSchedSupport->kinematicOwned_Cons2ProdBuffer_isFresh = true;
             contactPairArr_isFresh = true;
             pSchedSupport->schedulingStats.nKinematicUpdates++;
@@ -2129,6 +4081,7 @@ void DEMDynamicThread::workerThread() {
             pSchedSupport->cv_KinematicCanProceed.notify_all();
             // Then dT will wait for kT to finish one initial run
             {
+                WaitTimeRecorder wait_recorder(pSchedSupport->schedulingStats.dynamicWaitNanosec);
                 std::unique_lock<std::mutex> lock(pSchedSupport->dynamicCanProceed);
                 while (!pSchedSupport->dynamicOwned_Prod2ConsBuffer_isFresh) {
                     // loop to avoid spurious wakeups
@@ -2159,10 +4112,13 @@ void DEMDynamicThread::workerThread() {
             if (pSchedSupport->dynamicShouldWait()) {
                 timers.GetTimer("Wait for kT update").start();
                 // Wait for a signal from kT to indicate that kT has caught up
-                std::unique_lock<std::mutex> lock(pSchedSupport->dynamicCanProceed);
-                while (!pSchedSupport->dynamicOwned_Prod2ConsBuffer_isFresh) {
-                    // Loop to avoid spurious wakeups
-                    pSchedSupport->cv_DynamicCanProceed.wait(lock);
+                {
+                    WaitTimeRecorder wait_recorder(pSchedSupport->schedulingStats.dynamicWaitNanosec);
+                    std::unique_lock<std::mutex> lock(pSchedSupport->dynamicCanProceed);
+                    while (!pSchedSupport->dynamicOwned_Prod2ConsBuffer_isFresh) {
+                        // Loop to avoid spurious wakeups
+                        pSchedSupport->cv_DynamicCanProceed.wait(lock);
+                    }
                 }
                 pSchedSupport->schedulingStats.nTimesDynamicHeldBack++;
                 // If dT waits, it is penalized, since waiting means double-wait, very bad.
@@ -2177,19 +4133,41 @@ void DEMDynamicThread::workerThread() {
             // dynamicOwned_Prod2ConsBuffer_isFresh is false so ifProduceFreshThenUseItAndSendNewOrder didn't run, then
             // kT has to be in the process of doing a CD, we still will not be locked here.
 
-            // If using variable ts size, only when a step is accepted can we move on
-            bool step_accepted = false;
-            do {
-                calculateForces();
+            // The cost-model drift controller times the first step after each kT update
+            const bool time_this_step = timeNextStep;
+            if (time_this_step) {
+                stepCostTimer.start();
+                timeNextStep = false;
+            }
+            if (canUseStepGraph()) {
+                timers.GetTimer("Replay step graph").start();
+                stepWithCudaGraph();
+                timers.GetTimer("Replay step graph").stop();
+            } else {
+                // If using variable ts size, only when a step is accepted can we move on
+                bool step_accepted = false;
+                do {
+                    calculateForces();
 
-                routineChecks();
+                    routineChecks();
 
-                timers.GetTimer("Integration").start();
-                integrateOwnerMotions();
-                timers.GetTimer("Integration").stop();
+                    timers.GetTimer("Integration").start();
+                    enqueueStepSizeUpdate();
+                    integrateOwnerMotions();
+                    timers.GetTimer("Integration").stop();
 
-                step_accepted = true;
-            } while ((!solverFlags.isStepConst) || (!step_accepted));
+                    step_accepted = true;
+                } while ((!solverFlags.isStepConst) || (!step_accepted));
+            }
+            if (time_this_step) {
+                stepCostTimer.stop();
+                stepCostTimingPending = true;
+            }
+            // In no-sync mode, the kernels of this step were only queued. The host must wait here once, since it is about
+            // to update simParams (such as timeElapsed) that those kernels read.
+            if (solverFlags.useNoSyncMode) {
+                DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+            }
 
             // CalculateForces is done, set contactPairArr_isFresh to false
             // This will be set to true next time it receives an update from kT
@@ -2205,8 +4183,9 @@ void DEMDynamicThread::workerThread() {
             nTotalSteps++;
             accumStepUpdater.AddStep();
 
-            //// TODO: make changes for variable time step size cases
+            // If the step size is adapted on the device, simParams->h is the size used in the step just taken
             simParams->timeElapsed += (double)simParams->h;
+            simParams->nStepsElapsed++;
         }
 
         // Unless the user did something critical, must we wait for a kT update before next step
@@ -2251,47 +4230,69 @@ void DEMDynamicThread::resetUserCallStat() {
 }
 
 size_t DEMDynamicThread::estimateMemUsage() const {
-    return m_approx_bytes_used;
+    return m_mem_registry.GetBytesUsed();
 }
 
 void DEMDynamicThread::jitifyKernels(const std::unordered_map<std::string, std::string>& Subs) {
+    // A captured step graph refers to the kernels of the old programs
+    releaseStepGraph();
+    // These programs do not depend on each other, so they are built concurrently, each on its own host thread. If this
+    // is a re-jitification, the programs whose substituted sources did not change are kept as they are.
+    const int dev = streamInfo.device;
     // First one is force array preparation kernels
-    {
-        prep_force_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
-            "DEMPrepForceKernels", JitHelper::KERNEL_DIR / "DEMPrepForceKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
-    }
+    auto prep_force_future =
+        JitHelper::updateProgramAsync(prep_force_kernels, dev, "DEMPrepForceKernels",
+                                      JitHelper::KERNEL_DIR / "DEMPrepForceKernels.cu", Subs, DEME_JITIFY_OPTIONS);
     // Then force calculation kernels
-    {
-        cal_force_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
-            "DEMCalcForceKernels", JitHelper::KERNEL_DIR / "DEMCalcForceKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
-    }
+    auto cal_force_future =
+        JitHelper::updateProgramAsync(cal_force_kernels, dev, "DEMCalcForceKernels",
+                                      JitHelper::KERNEL_DIR / "DEMCalcForceKernels.cu", Subs, DEME_JITIFY_OPTIONS);
     // Then force accumulation kernels
+    std::future<std::shared_ptr<JitProgram>> collect_force_future;
     if (solverFlags.useCubForceCollect) {
-        collect_force_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
-            "DEMCollectForceKernels", JitHelper::KERNEL_DIR / "DEMCollectForceKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
+        collect_force_future = JitHelper::updateProgramAsync(collect_force_kernels, dev, "DEMCollectForceKernels",
+                                                             JitHelper::KERNEL_DIR / "DEMCollectForceKernels.cu", Subs,
+                                                             DEME_JITIFY_OPTIONS);
     } else {
-        collect_force_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
-            "DEMCollectForceKernels_Compact", JitHelper::KERNEL_DIR / "DEMCollectForceKernels_Compact.cu", Subs,
-            DEME_JITIFY_OPTIONS)));
+        collect_force_future = JitHelper::updateProgramAsync(
+            collect_force_kernels, dev, "DEMCollectForceKernels_Compact",
+            JitHelper::KERNEL_DIR / "DEMCollectForceKernels_Compact.cu", Subs, DEME_JITIFY_OPTIONS);
     }
     // Then integration kernels
-    {
-        integrator_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
-            "DEMIntegrationKernels", JitHelper::KERNEL_DIR / "DEMIntegrationKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
-    }
+    auto integrator_future =
+        JitHelper::updateProgramAsync(integrator_kernels, dev, "DEMIntegrationKernels",
+                                      JitHelper::KERNEL_DIR / "DEMIntegrationKernels.cu", Subs, DEME_JITIFY_OPTIONS);
     // Then kernels that are... wildcards, which make on-the-fly changes to solver data
-    if (solverFlags.canFamilyChange) {
-        mod_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
-            "DEMModeratorKernels", JitHelper::KERNEL_DIR / "DEMModeratorKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
+    std::future<std::shared_ptr<JitProgram>> mod_future;
+    if (solverFlags.canFamilyChange && !solverFlags.useFamilyChangeInIntegration) {
+        mod_future =
+            JitHelper::updateProgramAsync(mod_kernels, dev, "DEMModeratorKernels",
+                                          JitHelper::KERNEL_DIR / "DEMModeratorKernels.cu", Subs, DEME_JITIFY_OPTIONS);
     }
     // Then misc kernels
-    {
-        misc_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
-            "DEMMiscKernels", JitHelper::KERNEL_DIR / "DEMMiscKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
+    auto misc_future = JitHelper::updateProgramAsync(misc_kernels, dev, "DEMMiscKernels",
+                                                     JitHelper::KERNEL_DIR / "DEMMiscKernels.cu", Subs,
+                                                     DEME_JITIFY_OPTIONS);
+
+    unsigned int n_built = 0, n_rebuilt = 0;
+    auto collect = [&](std::shared_ptr<JitProgram>& prog, std::future<std::shared_ptr<JitProgram>>& fut) {
+        std::shared_ptr<JitProgram> res = fut.get();
+        n_built++;
+        n_rebuilt += (res != prog);
+        prog = res;
+    };
+    collect(prep_force_kernels, prep_force_future);
+    collect(cal_force_kernels, cal_force_future);
+    collect(collect_force_kernels, collect_force_future);
+    collect(integrator_kernels, integrator_future);
+    if (mod_future.valid()) {
+        collect(mod_kernels, mod_future);
     }
+    collect(misc_kernels, misc_future);
+    DEME_DEBUG_PRINTF("dT jitified %u of its %u programs (the rest are unchanged).", n_rebuilt, n_built);
 }
 
-float* DEMDynamicThread::inspectCall(const std::shared_ptr<jitify::Program>& inspection_kernel,
+float* DEMDynamicThread::inspectCall(const std::shared_ptr<JitProgram>& inspection_kernel,
                                      const std::string& kernel_name,
                                      INSPECT_ENTITY_TYPE thing_to_insp,
                                      CUB_REDUCE_FLAVOR reduce_flavor,
@@ -2381,11 +4382,194 @@ float* DEMDynamicThread::inspectCall(const std::shared_ptr<jitify::Program>& ins
     return res;
 }
 
+void DEMDynamicThread::getFusedInspectionSizes(unsigned int n_owner_slots,
+                                               unsigned int n_sphere_slots,
+                                               size_t& stride,
+                                               unsigned int& blocks_per_slot) const {
+    // All slots have the same stride, the longer of the two entity counts
+    stride = std::max(n_owner_slots > 0 ? (size_t)simParams->nOwnerBodies : 0,
+                      n_sphere_slots > 0 ? (size_t)simParams->nSpheresGM : 0);
+    // Each slot is first reduced to a few partial results by this many blocks
+    blocks_per_slot = std::min<size_t>((stride + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK,
+                                       DEME_MAX_THREADS_PER_BLOCK);
+}
+
+void DEMDynamicThread::launchFusedInspection(const std::shared_ptr<JitProgram>& fused_kernel,
+                                             unsigned int n_owner_slots,
+                                             unsigned int n_sphere_slots,
+                                             size_t stride,
+                                             unsigned int blocks_per_slot,
+                                             float* resArr,
+                                             notStupidBool_t* boolArrExclude,
+                                             float* partials,
+                                             float* res) {
+    const size_t nOwners = simParams->nOwnerBodies;
+    const size_t nSpheres = simParams->nSpheresGM;
+    const unsigned int n_slots = n_owner_slots + n_sphere_slots;
+    // The not_in_region flags are reset by the kernels themselves
+    if (n_owner_slots > 0 && nOwners > 0) {
+        size_t blocks_needed = (nOwners + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+        fused_kernel->kernel("inspectOwnerPropertiesFused")
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(granData, simParams, resArr, boolArrExclude, stride, nOwners);
+    }
+    if (n_sphere_slots > 0 && nSpheres > 0) {
+        size_t blocks_needed = (nSpheres + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+        fused_kernel->kernel("inspectSpherePropertiesFused")
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(granData, simParams, resArr, boolArrExclude, stride, nSpheres);
+    }
+    // Both reduction stages handle all slots in one launch; the empty entity type, if any, has length 0
+    fused_kernel->kernel("reduceInspectorSlots")
+        .instantiate()
+        .configure(dim3(blocks_per_slot, n_slots), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+        .launch(resArr, partials, stride, n_owner_slots, nOwners, nSpheres);
+    fused_kernel->kernel("reduceInspectorPartials")
+        .instantiate()
+        .configure(dim3(n_slots), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+        .launch(partials, res, blocks_per_slot);
+}
+
+std::vector<float> DEMDynamicThread::inspectFusedCall(const std::shared_ptr<JitProgram>& fused_kernel,
+                                                      unsigned int n_owner_slots,
+                                                      unsigned int n_sphere_slots) {
+    const unsigned int n_slots = n_owner_slots + n_sphere_slots;
+    size_t stride;
+    unsigned int blocks_per_slot;
+    getFusedInspectionSizes(n_owner_slots, n_sphere_slots, stride, blocks_per_slot);
+    std::vector<float> host_res(n_slots, 0.f);
+    if (n_slots == 0 || stride == 0) {
+        return host_res;
+    }
+    int prev_device;
+    DEME_GPU_CALL(cudaGetDevice(&prev_device));
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    // We can use temp vectors as we please
+    float* resArr = (float*)stateOfSolver_resources.allocateTempVector(1, n_slots * stride * sizeof(float));
+    notStupidBool_t* boolArrExclude =
+        (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(2, n_slots * stride * sizeof(notStupidBool_t));
+    float* partials = (float*)stateOfSolver_resources.allocateTempVector(3, n_slots * blocks_per_slot * sizeof(float));
+    float* res = (float*)stateOfSolver_resources.allocateTempVector(4, n_slots * sizeof(float));
+    launchFusedInspection(fused_kernel, n_owner_slots, n_sphere_slots, stride, blocks_per_slot, resArr,
+                          boolArrExclude, partials, res);
+    DEME_GPU_CALL(cudaMemcpyAsync(host_res.data(), res, n_slots * sizeof(float), cudaMemcpyDeviceToHost,
+                                  streamInfo.stream));
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    DEME_GPU_CALL(cudaSetDevice(prev_device));
+    return host_res;
+}
+
+std::shared_ptr<DEMAsyncResult> DEMDynamicThread::acquireAsyncResult(size_t n) {
+    std::shared_ptr<DEMAsyncResult> res;
+    for (auto& candidate : asyncResults) {
+        if (candidate.use_count() == 1) {
+            res = candidate;
+            break;
+        }
+    }
+    if (!res) {
+        res = std::make_shared<DEMAsyncResult>();
+        DEME_GPU_CALL(cudaEventCreateWithFlags(&(res->done), cudaEventDisableTiming));
+        asyncResults.push_back(res);
+    }
+    if (n > res->capacity) {
+        // Nobody waits for its previous values, but the copy into it may still be pending
+        DEME_GPU_CALL(cudaEventSynchronize(res->done));
+        if (res->pinned) {
+            DEME_GPU_CALL(cudaFreeHost(res->pinned));
+        }
+        DEME_GPU_CALL(cudaMallocHost((void**)&(res->pinned), n * sizeof(float)));
+        res->capacity = n;
+    }
+    res->n = n;
+    res->order.clear();
+    return res;
+}
+
+std::shared_ptr<DEMAsyncResult> DEMDynamicThread::inspectFusedCallAsync(const std::shared_ptr<JitProgram>& fused_kernel,
+                                                                        unsigned int n_owner_slots,
+                                                                        unsigned int n_sphere_slots) {
+    const unsigned int n_slots = n_owner_slots + n_sphere_slots;
+    size_t stride;
+    unsigned int blocks_per_slot;
+    getFusedInspectionSizes(n_owner_slots, n_sphere_slots, stride, blocks_per_slot);
+    int prev_device;
+    DEME_GPU_CALL(cudaGetDevice(&prev_device));
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    std::shared_ptr<DEMAsyncResult> result = acquireAsyncResult(n_slots);
+    if (n_slots > 0 && stride > 0) {
+        // Floats first, then the flags, so every part stays aligned
+        const size_t valBytes = n_slots * stride * sizeof(float);
+        const size_t partialBytes = n_slots * blocks_per_slot * sizeof(float);
+        const size_t resBytes = n_slots * sizeof(float);
+        const size_t bytes = valBytes + partialBytes + resBytes + n_slots * stride * sizeof(notStupidBool_t);
+        if (bytes > asyncInspectBufferBytes) {
+            // This frees memory that earlier queued queries may use, but cudaFree waits for them
+            if (asyncInspectBuffer) {
+                DEME_GPU_CALL(cudaFree(asyncInspectBuffer));
+            }
+            DEME_GPU_CALL(cudaMalloc((void**)&asyncInspectBuffer, bytes));
+            asyncInspectBufferBytes = bytes;
+        }
+        float* resArr = (float*)asyncInspectBuffer;
+        float* partials = (float*)(asyncInspectBuffer + valBytes);
+        float* res = (float*)(asyncInspectBuffer + valBytes + partialBytes);
+        notStupidBool_t* boolArrExclude = (notStupidBool_t*)(asyncInspectBuffer + valBytes + partialBytes + resBytes);
+        launchFusedInspection(fused_kernel, n_owner_slots, n_sphere_slots, stride, blocks_per_slot, resArr,
+                              boolArrExclude, partials, res);
+        DEME_GPU_CALL(cudaMemcpyAsync(result->pinned, res, resBytes, cudaMemcpyDeviceToHost, streamInfo.stream));
+    } else {
+        std::fill(result->pinned, result->pinned + n_slots, 0.f);
+    }
+    DEME_GPU_CALL(cudaEventRecord(result->done, streamInfo.stream));
+    DEME_GPU_CALL(cudaSetDevice(prev_device));
+    return result;
+}
+
 void DEMDynamicThread::initAllocation() {
     DEME_TRACKED_RESIZE_DEBUGPRINT(familyExtraMarginSize, NUM_AVAL_FAMILIES, "familyExtraMarginSize", 0);
+    DEME_TRACKED_RESIZE_DEBUGPRINT(familyStepRatio, NUM_AVAL_FAMILIES, "familyStepRatio", 1);
+    DEME_TRACKED_RESIZE_DEBUGPRINT(adaptTSGauge, 2, "adaptTSGauge", 0);
 }
 
 void DEMDynamicThread::deallocateEverything() {
+    // Handles of asynchronous results may outlive this thread, so they are told their buffers are gone
+    for (auto& result : asyncResults) {
+        DEME_GPU_CALL(cudaEventSynchronize(result->done));
+        if (result->pinned) {
+            DEME_GPU_CALL(cudaFreeHost(result->pinned));
+            result->pinned = nullptr;
+        }
+        DEME_GPU_CALL(cudaEventDestroy(result->done));
+        result->released = true;
+    }
+    asyncResults.clear();
+    if (asyncInspectBuffer) {
+        DEME_GPU_CALL(cudaFree(asyncInspectBuffer));
+        asyncInspectBuffer = nullptr;
+        asyncInspectBufferBytes = 0;
+    }
+    if (ownerStateDevice) {
+        DEME_GPU_CALL(cudaFree(ownerStateDevice));
+        ownerStateDevice = nullptr;
+        ownerStateDeviceBytes = 0;
+    }
+    if (ownerStatePinned) {
+        DEME_GPU_CALL(cudaFreeHost(ownerStatePinned));
+        ownerStatePinned = nullptr;
+        ownerStatePinnedBytes = 0;
+    }
+    if (meshOutputVertices) {
+        DEME_GPU_CALL(cudaFreeHost(meshOutputVertices));
+        meshOutputVertices = nullptr;
+        meshOutputVerticesCapacity = 0;
+    }
+    for (auto& insertion : pendingClumpInsertions) {
+        DEME_GPU_CALL(cudaFreeHost(insertion.pinned));
+    }
+    pendingClumpInsertions.clear();
     for (unsigned int i = 0; i < contactWildcards.size(); i++) {
         contactWildcards.clear();
     }
@@ -2548,6 +4732,151 @@ size_t DEMDynamicThread::getOwnerContactForces(bodyID_t ownerID,
     return numUsefulCnt;
 }
 
+size_t DEMDynamicThread::getOwnersContactForces(const std::vector<bodyID_t>& ownerIDs,
+                                                std::vector<size_t>& offsets,
+                                                std::vector<float3>& points,
+                                                std::vector<float3>& forces,
+                                                std::vector<float3>& torques,
+                                                bool torque_in_local) {
+    const size_t nOwners = simParams->nOwnerBodies;
+    const size_t nContacts = *stateOfSolver_resources.pNumContacts;
+    const size_t nQueried = ownerIDs.size();
+    {
+        std::vector<bodyID_t> sorted_ids = ownerIDs;
+        std::sort(sorted_ids.begin(), sorted_ids.end());
+        if (nQueried > 0 && sorted_ids.back() >= nOwners) {
+            DEME_ERROR("Contact forces of owner %u are queried, but there are only %zu owners.", sorted_ids.back(),
+                       nOwners);
+        }
+        auto dup = std::adjacent_find(sorted_ids.begin(), sorted_ids.end());
+        if (dup != sorted_ids.end()) {
+            DEME_ERROR("Owner %u appears more than once in a bulk contact force query.", *dup);
+        }
+    }
+    offsets.assign(nQueried + 1, 0);
+    points.clear();
+    forces.clear();
+    torques.clear();
+    if (nQueried == 0 || nContacts == 0) {
+        return 0;
+    }
+    int prev_device;
+    DEME_GPU_CALL(cudaGetDevice(&prev_device));
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    cudaStream_t& stream = streamInfo.stream;
+    const size_t nEntries = 2 * nContacts;
+
+    // Where each owner is in the query, for the contacts to look up
+    bodyID_t* queryIdx = (bodyID_t*)stateOfSolver_resources.allocateTempVector(0, nOwners * sizeof(bodyID_t));
+    bodyID_t* ids = (bodyID_t*)stateOfSolver_resources.allocateTempVector(1, nQueried * sizeof(bodyID_t));
+    bodyID_t* analOwners = (bodyID_t*)stateOfSolver_resources.allocateTempVector(
+        2, DEME_MAX(ownerAnalBody.size(), (size_t)1) * sizeof(bodyID_t));
+    DEME_GPU_CALL(cudaMemsetAsync(queryIdx, 0xFF, nOwners * sizeof(bodyID_t), stream));
+    DEME_GPU_CALL(cudaMemcpyAsync(ids, ownerIDs.data(), nQueried * sizeof(bodyID_t), cudaMemcpyHostToDevice, stream));
+    if (ownerAnalBody.size() > 0) {
+        DEME_GPU_CALL(cudaMemcpyAsync(analOwners, ownerAnalBody.data(), ownerAnalBody.size() * sizeof(bodyID_t),
+                                      cudaMemcpyHostToDevice, stream));
+    }
+    size_t blocks_needed = (nQueried + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    misc_kernels->kernel("markQueriedOwners")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, stream)
+        .launch(queryIdx, ids, nQueried);
+
+    // One pass over the contacts to find the entries (contact sides) of the queried owners...
+    bodyID_t* keys = (bodyID_t*)stateOfSolver_resources.allocateTempVector(3, nEntries * sizeof(bodyID_t));
+    notStupidBool_t* flags =
+        (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(4, nEntries * sizeof(notStupidBool_t));
+    contactPairs_t* selected =
+        (contactPairs_t*)stateOfSolver_resources.allocateTempVector(5, nEntries * sizeof(contactPairs_t));
+    blocks_needed = (nContacts + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    misc_kernels->kernel("markOwnerContactEntries")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, stream)
+        .launch(granData, queryIdx, analOwners, keys, flags, nContacts);
+    contactIDSelectFlagged(flags, selected, stateOfSolver_resources.pTempSizeVar1, nEntries, stream,
+                           stateOfSolver_resources);
+    const size_t nSelected = *(stateOfSolver_resources.pTempSizeVar1);
+
+    // ... then group them by owner, in the query order (the sort is stable, so the contact order stays in a group), and
+    // work out what they are
+    if (nSelected > 0) {
+        bodyID_t* selectedKeys = (bodyID_t*)stateOfSolver_resources.allocateTempVector(0, nSelected * sizeof(bodyID_t));
+        bodyID_t* sortedKeys = (bodyID_t*)stateOfSolver_resources.allocateTempVector(2, nSelected * sizeof(bodyID_t));
+        contactPairs_t* sortedEntries =
+            (contactPairs_t*)stateOfSolver_resources.allocateTempVector(4, nSelected * sizeof(contactPairs_t));
+        float* out = (float*)stateOfSolver_resources.allocateTempVector(6, nSelected * 9 * sizeof(float));
+        blocks_needed = (nSelected + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+        misc_kernels->kernel("gatherContactsByPermutation")
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, stream)
+            .launch((char*)selectedKeys, (const char*)keys, selected, (unsigned int)sizeof(bodyID_t), nSelected);
+        contactIDSortByKey(selectedKeys, sortedKeys, selected, sortedEntries, nSelected, stream,
+                           stateOfSolver_resources);
+        misc_kernels->kernel("computeOwnerContactEntries")
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, stream)
+            .launch(simParams, granData, sortedEntries, sortedKeys, ids, out, torque_in_local, nContacts, nSelected);
+
+        // One transfer of the results
+        std::vector<bodyID_t> host_keys(nSelected);
+        std::vector<float> host_out(nSelected * 9);
+        DEME_GPU_CALL(cudaMemcpyAsync(host_keys.data(), sortedKeys, nSelected * sizeof(bodyID_t),
+                                      cudaMemcpyDeviceToHost, stream));
+        DEME_GPU_CALL(cudaMemcpyAsync(host_out.data(), out, nSelected * 9 * sizeof(float), cudaMemcpyDeviceToHost,
+                                      stream));
+        DEME_GPU_CALL(cudaStreamSynchronize(stream));
+        for (const auto& key : host_keys) {
+            offsets[key + 1]++;
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        points.resize(nSelected);
+        forces.resize(nSelected);
+        torques.resize(nSelected);
+        for (size_t i = 0; i < nSelected; i++) {
+            points[i] = host_make_float3(host_out[9 * i], host_out[9 * i + 1], host_out[9 * i + 2]);
+            forces[i] = host_make_float3(host_out[9 * i + 3], host_out[9 * i + 4], host_out[9 * i + 5]);
+            torques[i] = host_make_float3(host_out[9 * i + 6], host_out[9 * i + 7], host_out[9 * i + 8]);
+        }
+    }
+    DEME_GPU_CALL(cudaSetDevice(prev_device));
+    return nSelected;
+}
+
+std::vector<bodyID_t> DEMDynamicThread::getFamilyOwnerIDs(unsigned int N) {
+    const size_t nOwners = simParams->nOwnerBodies;
+    std::vector<bodyID_t> res;
+    if (nOwners == 0) {
+        return res;
+    }
+    int prev_device;
+    DEME_GPU_CALL(cudaGetDevice(&prev_device));
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    cudaStream_t& stream = streamInfo.stream;
+    std::vector<notStupidBool_t> pass(NUM_AVAL_FAMILIES, 0);
+    pass.at(N) = 1;
+    notStupidBool_t* familyPass =
+        (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(0, NUM_AVAL_FAMILIES * sizeof(notStupidBool_t));
+    DEME_GPU_CALL(cudaMemcpyAsync(familyPass, pass.data(), NUM_AVAL_FAMILIES * sizeof(notStupidBool_t),
+                                  cudaMemcpyHostToDevice, stream));
+    notStupidBool_t* flags =
+        (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(1, nOwners * sizeof(notStupidBool_t));
+    bodyID_t* ids = (bodyID_t*)stateOfSolver_resources.allocateTempVector(2, nOwners * sizeof(bodyID_t));
+    size_t blocks_needed = (nOwners + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    misc_kernels->kernel("markOwnersInFamilies")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, stream)
+        .launch(granData, familyPass, (bodyID_t)0, flags, nOwners);
+    bodyIDSelectFlagged(flags, ids, stateOfSolver_resources.pTempSizeVar1, nOwners, stream, stateOfSolver_resources);
+    res.resize(*(stateOfSolver_resources.pTempSizeVar1));
+    if (res.size() > 0) {
+        DEME_GPU_CALL(cudaMemcpyAsync(res.data(), ids, res.size() * sizeof(bodyID_t), cudaMemcpyDeviceToHost, stream));
+        DEME_GPU_CALL(cudaStreamSynchronize(stream));
+    }
+    DEME_GPU_CALL(cudaSetDevice(prev_device));
+    return res;
+}
+
 void DEMDynamicThread::setFamilyContactWildcardValueAny(unsigned int N, unsigned int wc_num, float val) {
     size_t numCnt = *stateOfSolver_resources.pNumContacts;
     for (size_t i = 0; i < numCnt; i++) {
@@ -2561,7 +4890,7 @@ void DEMDynamicThread::setFamilyContactWildcardValueAny(unsigned int N, unsigned
         unsigned int famB = +(familyID.at(ownerB));
 
         if (N == famA || N == famB) {
-            contactWildcards[wc_num].at(i) = val;
+            setContactWildcard(wc_num, i, val);
         }
     }
 }
@@ -2579,7 +4908,7 @@ void DEMDynamicThread::setFamilyContactWildcardValueAll(unsigned int N, unsigned
         unsigned int famB = +(familyID.at(ownerB));
 
         if (N == famA && N == famB) {
-            contactWildcards[wc_num].at(i) = val;
+            setContactWildcard(wc_num, i, val);
         }
     }
 }
@@ -2597,7 +4926,7 @@ void DEMDynamicThread::setFamilyContactWildcardValue(unsigned int N1, unsigned i
         unsigned int famB = +(familyID.at(ownerB));
 
         if ((N1 == famA && N2 == famB) || (N2 == famA && N1 == famB)) {
-            contactWildcards[wc_num].at(i) = val;
+            setContactWildcard(wc_num, i, val);
         }
     }
 }
@@ -2605,7 +4934,66 @@ void DEMDynamicThread::setFamilyContactWildcardValue(unsigned int N1, unsigned i
 void DEMDynamicThread::setContactWildcardValue(unsigned int wc_num, float val) {
     size_t numCnt = *stateOfSolver_resources.pNumContacts;
     for (size_t i = 0; i < numCnt; i++) {
-        contactWildcards[wc_num].at(i) = val;
+        setContactWildcard(wc_num, i, val);
+    }
+}
+
+float DEMDynamicThread::getContactWildcard(unsigned int wc_num, size_t cnt) const {
+    const DEMContactWildcardStorage& store = m_contact_wildcard_storage.at(wc_num);
+    float word = contactWildcards[store.slot].at(cnt);
+    switch (store.precision) {
+        case WILDCARD_PRECISION::FP16:
+            return fp16BitsToFloat(unpackWildcardHalf(word, store.half));
+        case WILDCARD_PRECISION::BF16:
+            return bf16BitsToFloat(unpackWildcardHalf(word, store.half));
+        case WILDCARD_PRECISION::SCALED_INT16:
+            return scaledInt16BitsToFloat(unpackWildcardHalf(word, store.half), store.max_abs / 32767.f);
+        default:
+            return word;
+    }
+}
+
+void DEMDynamicThread::setContactWildcard(unsigned int wc_num, size_t cnt, float val) {
+    const DEMContactWildcardStorage& store = m_contact_wildcard_storage.at(wc_num);
+    float& word = contactWildcards[store.slot].at(cnt);
+    switch (store.precision) {
+        case WILDCARD_PRECISION::FP16:
+            word = packWildcardHalf(word, store.half, floatToFP16Bits(val));
+            break;
+        case WILDCARD_PRECISION::BF16:
+            word = packWildcardHalf(word, store.half, floatToBF16Bits(val));
+            break;
+        case WILDCARD_PRECISION::SCALED_INT16:
+            word = packWildcardHalf(word, store.half, floatToScaledInt16Bits(val, store.max_abs / 32767.f));
+            break;
+        default:
+            word = val;
+    }
+}
+
+void DEMDynamicThread::unpackContactWildcards(std::vector<std::vector<float>>& arrays) const {
+    std::vector<std::vector<float>> packed = std::move(arrays);
+    arrays.resize(m_contact_wildcard_storage.size());
+    for (unsigned int i = 0; i < m_contact_wildcard_storage.size(); i++) {
+        const DEMContactWildcardStorage& store = m_contact_wildcard_storage[i];
+        const std::vector<float>& src = packed.at(store.slot);
+        arrays[i].resize(src.size());
+        for (size_t j = 0; j < src.size(); j++) {
+            uint16_t code = unpackWildcardHalf(src[j], store.half);
+            switch (store.precision) {
+                case WILDCARD_PRECISION::FP16:
+                    arrays[i][j] = fp16BitsToFloat(code);
+                    break;
+                case WILDCARD_PRECISION::BF16:
+                    arrays[i][j] = bf16BitsToFloat(code);
+                    break;
+                case WILDCARD_PRECISION::SCALED_INT16:
+                    arrays[i][j] = scaledInt16BitsToFloat(code, store.max_abs / 32767.f);
+                    break;
+                default:
+                    arrays[i][j] = src[j];
+            }
+        }
     }
 }
 
@@ -2623,7 +5011,7 @@ void DEMDynamicThread::setTriWildcardValue(bodyID_t geoID, unsigned int wc_num,
 
 void DEMDynamicThread::setSphWildcardValue(bodyID_t geoID, unsigned int wc_num, const std::vector<float>& vals) {
     for (size_t i = 0; i < vals.size(); i++) {
-        sphereWildcards[wc_num].at(geoID + i) = vals.at(i);
+        sphereWildcards[wc_num].at(getSphereImplID(geoID + i)) = vals.at(i);
     }
 }
 
@@ -2650,7 +5038,7 @@ void DEMDynamicThread::setFamilyOwnerWildcardValue(unsigned int family_num,
 void DEMDynamicThread::getSphereWildcardValue(std::vector<float>& res, bodyID_t ID, unsigned int wc_num, size_t n) {
     res.resize(n);
     for (size_t i = 0; i < n; i++) {
-        res[i] = sphereWildcards[wc_num].at(ID + i);
+        res[i] = sphereWildcards[wc_num].at(getSphereImplID(ID + i));
     }
 }
 
@@ -2753,6 +5141,8 @@ void DEMDynamicThread::setOwnerAngVel(bodyID_t ownerID, float3 angVel) {
     omgBarX.at(ownerID) = angVel.x;
     omgBarY.at(ownerID) = angVel.y;
     omgBarZ.at(ownerID) = angVel.z;
+    ownerAbsVelIsValid = false;
+    wakeOwner(ownerID);
 }
 
 void DEMDynamicThread::setOwnerPos(bodyID_t ownerID, float3 pos) {
@@ -2764,6 +5154,7 @@ void DEMDynamicThread::setOwnerPos(bodyID_t ownerID, float3 pos) {
     hostPositionToVoxelID<voxelID_t, subVoxelPos_t, double>(voxelID.at(ownerID), locX.at(ownerID), locY.at(ownerID),
                                                             locZ.at(ownerID), X, Y, Z, simParams->nvXp2,
                                                             simParams->nvYp2, simParams->voxelSize, simParams->l);
+    wakeOwner(ownerID);
 }
 
 void DEMDynamicThread::setOwnerOriQ(bodyID_t ownerID, float4 oriQ) {
@@ -2771,28 +5162,84 @@ void DEMDynamicThread::setOwnerOriQ(bodyID_t ownerID, float4 oriQ) {
     oriQx.at(ownerID) = oriQ.x;
     oriQy.at(ownerID) = oriQ.y;
     oriQz.at(ownerID) = oriQ.z;
+    wakeOwner(ownerID);
 }
 
 void DEMDynamicThread::setOwnerVel(bodyID_t ownerID, float3 vel) {
     vX.at(ownerID) = vel.x;
     vY.at(ownerID) = vel.y;
     vZ.at(ownerID) = vel.z;
+    ownerAbsVelIsValid = false;
+    wakeOwner(ownerID);
+}
+
+void DEMDynamicThread::wakeOwner(bodyID_t ownerID) {
+    if (ownerID < ownerQuietSteps.size()) {
+        ownerQuietSteps[ownerID] = 0;
+    }
+}
+
+void DEMDynamicThread::markMeshNodesDirty(size_t start, size_t n) {
+    if (n == 0) {
+        return;
+    }
+    // A mesh that can deform does not share its nodes, so they are contiguous
+    const size_t first = triNodeOffset[start];
+    std::lock_guard<std::mutex> lock(meshNodeDirtyMutex);
+    meshNodeDirtyRanges.emplace_back(first, first + n);
+    solverFlags.willMeshDeform = true;
 }
 
 void DEMDynamicThread::setTriNodeRelPos(size_t start, const std::vector<DEMTriangle>& triangles) {
     for (size_t i = 0; i < triangles.size(); i++) {
-        relPosNode1[start + i] = triangles[i].p1;
-        relPosNode2[start + i] = triangles[i].p2;
-        relPosNode3[start + i] = triangles[i].p3;
+        const bodyID_t node = triNodeOffset[start + i];
+        relPosNode1[node] = triangles[i].p1;
+        relPosNode2[node] = triangles[i].p2;
+        relPosNode3[node] = triangles[i].p3;
     }
+    markMeshNodesDirty(start, triangles.size());
 }
 
 void DEMDynamicThread::updateTriNodeRelPos(size_t start, const std::vector<DEMTriangle>& updates) {
     for (size_t i = 0; i < updates.size(); i++) {
-        relPosNode1[start + i] += updates[i].p1;
-        relPosNode2[start + i] += updates[i].p2;
-        relPosNode3[start + i] += updates[i].p3;
+        const bodyID_t node = triNodeOffset[start + i];
+        relPosNode1[node] += updates[i].p1;
+        relPosNode2[node] += updates[i].p2;
+        relPosNode3[node] += updates[i].p3;
+    }
+    markMeshNodesDirty(start, updates.size());
+}
+
+void DEMDynamicThread::applyTriNodeRelPosFromDevice(size_t mesh_num,
+                                                   size_t start,
+                                                   size_t nTri,
+                                                   const float3* data,
+                                                   bool per_vertex,
+                                                   bool increment,
+                                                   cudaStream_t stream) {
+    if (nTri == 0) {
+        return;
+    }
+    // The facet-to-vertex table of mesh output does the expansion. It is built before any node moves, while the
+    // cached meshes still match the simulation, so the node swaps made at initialization are detected correctly.
+    if (meshOutputNumFacets != simParams->nTriGM) {
+        buildMeshOutputConnectivity();
     }
+    int prev_device;
+    DEME_GPU_CALL(cudaGetDevice(&prev_device));
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    size_t blocks_needed = (nTri + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    misc_kernels->kernel("applyMeshNodesFromDevice")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, stream)
+        .launch(granData, data, per_vertex ? meshOutputNodeSlots.data() : (bodyID_t*)nullptr,
+                meshOutputVertexOffsets.at(mesh_num), start, nTri, increment);
+    // My later work (including sending the nodes to kT) is ordered after the update, and the user's stream is not
+    // blocked by me
+    DEME_GPU_CALL(cudaEventRecord(meshNodesAppliedEvent, stream));
+    DEME_GPU_CALL(cudaStreamWaitEvent(streamInfo.stream, meshNodesAppliedEvent, 0));
+    DEME_GPU_CALL(cudaSetDevice(prev_device));
+    markMeshNodesDirty(start, nTri);
 }
 
 }  // namespace deme
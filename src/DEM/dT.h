@@ -7,6 +7,7 @@
 #define DEME_DT
 
 #include <mutex>
+#include <functional>
 #include <vector>
 #include <thread>
 #include <unordered_map>
@@ -23,13 +24,14 @@
 #include <DEM/Defines.h>
 #include <DEM/Structs.h>
 #include <DEM/AuxClasses.h>
+#include <DEM/OutputWriter.h>
+#include <DEM/utils/Checkpoint.hpp>
+#include <DEM/utils/VtkXmlIO.hpp>
 
 // #include <core/utils/JitHelper.h>
 
-// Forward declare jitify::Program to avoid downstream dependency
-namespace jitify {
-class Program;
-}
+// Forward declare JitProgram to avoid downstream dependency
+class JitProgram;
 
 namespace deme {
 
@@ -64,6 +66,19 @@ class DEMDynamicThread {
     // Object which stores the device and stream IDs for this thread
     GpuManager::StreamInfo streamInfo;
 
+    // Recorded on my stream after I queue copies to my friend's buffer, and after I queue copies out of my own buffer,
+    // respectively. The friend thread makes its stream wait on them, so buffer exchange needs no lock or host sync.
+    cudaEvent_t bufferSentEvent;
+    cudaEvent_t bufferUnpackedEvent;
+    // Recorded on the user's stream after mesh nodes are modified from a device buffer; my stream waits on it
+    cudaEvent_t meshNodesAppliedEvent;
+
+    // Ranges [first, last) of mesh nodes (in relPosNode*) modified since the last send to kT. Only these are sent.
+    std::vector<std::pair<size_t, size_t>> meshNodeDirtyRanges;
+    std::mutex meshNodeDirtyMutex;
+    // Record that the nodes of facets start to start + n of the mesh arrays are modified
+    void markMeshNodesDirty(size_t start, size_t n);
+
     // A class that contains scratch pad and system status data (constructed with the number of temp arrays we need)
     DEMSolverStateData stateOfSolver_resources = DEMSolverStateData(7);
 
@@ -112,6 +127,8 @@ class DEMDynamicThread {
 
     // Triangles (templates) are given a special place (unlike other analytical shapes), b/c we expect them to appear
     // frequently as meshes.
+    // Facets of instances of one mesh share their nodes, so each facet finds its nodes through triNodeOffset
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> triNodeOffset;
     std::vector<float3, ManagedAllocator<float3>> relPosNode1;
     std::vector<float3, ManagedAllocator<float3>> relPosNode2;
     std::vector<float3, ManagedAllocator<float3>> relPosNode3;
@@ -157,20 +174,26 @@ class DEMDynamicThread {
     std::vector<subVoxelPos_t, ManagedAllocator<subVoxelPos_t>> locZ;
 
     // The clump quaternion
-    std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQw;
-    std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQx;
-    std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQy;
-    std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQz;
+    std::vector<oriQStore_t, ManagedAllocator<oriQStore_t>> oriQw;
+    std::vector<oriQStore_t, ManagedAllocator<oriQStore_t>> oriQx;
+    std::vector<oriQStore_t, ManagedAllocator<oriQStore_t>> oriQy;
+    std::vector<oriQStore_t, ManagedAllocator<oriQStore_t>> oriQz;
 
     // Linear velocity
-    std::vector<float, ManagedAllocator<float>> vX;
-    std::vector<float, ManagedAllocator<float>> vY;
-    std::vector<float, ManagedAllocator<float>> vZ;
+    std::vector<velStore_t, ManagedAllocator<velStore_t>> vX;
+    std::vector<velStore_t, ManagedAllocator<velStore_t>> vY;
+    std::vector<velStore_t, ManagedAllocator<velStore_t>> vZ;
+    // Velocity magnitude of owners, found as a by-product of integration (see UseFusedVelocityMagnitudePass)
+    std::vector<float, ManagedAllocator<float>> ownerAbsVel;
+    // Whether ownerAbsVel reflects the current velocities. It does not after the user changes the system between runs.
+    bool ownerAbsVelIsValid = false;
+    // Number of steps in a row each owner has been quiet (see EnableSleeping)
+    std::vector<unsigned int, ManagedAllocator<unsigned int>> ownerQuietSteps;
 
     // Local angular velocity
-    std::vector<float, ManagedAllocator<float>> omgBarX;
-    std::vector<float, ManagedAllocator<float>> omgBarY;
-    std::vector<float, ManagedAllocator<float>> omgBarZ;
+    std::vector<velStore_t, ManagedAllocator<velStore_t>> omgBarX;
+    std::vector<velStore_t, ManagedAllocator<velStore_t>> omgBarY;
+    std::vector<velStore_t, ManagedAllocator<velStore_t>> omgBarZ;
 
     // Linear acceleration
     std::vector<float, ManagedAllocator<float>> aX;
@@ -192,6 +215,10 @@ class DEMDynamicThread {
     std::vector<bodyID_t, ManagedAllocator<bodyID_t>> idGeometryB;
     std::vector<contact_t, ManagedAllocator<contact_t>> contactType;
     // std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>> contactMapping;
+    // A delta-encoded contact update from kT is assembled in these, which are then swapped with the arrays above
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> idGeometryA_patched;
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> idGeometryB_patched;
+    std::vector<contact_t, ManagedAllocator<contact_t>> contactType_patched;
 
     // Some of dT's own work arrays
     // Force of each contact event. It is the force that bodyA feels. They are in global.
@@ -229,6 +256,9 @@ class DEMDynamicThread {
     // Storage for the names of the contact wildcards (whose order agrees with the impl-level wildcard numbering, from 1
     // to n)
     std::set<std::string> m_contact_wildcard_names;
+    // How each contact wildcard is stored (in the same order). 16-bit ones share arrays, so
+    // simParams->nContactWildcards is the number of arrays, which can be fewer than the wildcards.
+    std::vector<DEMContactWildcardStorage> m_contact_wildcard_storage;
     std::set<std::string> m_owner_wildcard_names;
     std::set<std::string> m_geo_wildcard_names;
 
@@ -238,14 +268,27 @@ class DEMDynamicThread {
     // The velocity of the contact points in the global frame: can be useful in determining the time step size
     // std::vector<float3, ManagedAllocator<float3>> contactPointVel;
 
-    size_t m_approx_bytes_used = 0;
+    // Sizes of the arrays (and scratch space) this thread allocated, checked against the memory budget if any
+    DEMMemoryRegistry m_mem_registry;
 
     // dT's total steps run (since last time the collaboration stats cache is cleared)
     uint64_t nTotalSteps = 0;
+    // The family change sweep is needed only on the steps that are multiples of this (the GCD of the numbers of steps
+    // between checks of the ChangeFamilyWhen conditions)
+    unsigned int familyChangeStride = 1;
 
     // If true, dT needs to re-process idA- and idB-related data arrays before collecting forces, as those arrays are
     // freshly obtained from kT.
     bool contactPairArr_isFresh = true;
+    // Owner-indexed CSR of the contact array, for CUB-based force collection. Rebuilt when contactPairArr_isFresh.
+    DEMOwnerCSR ownerCSR;
+    // Number of force models (the main one, plus the extra ones assigned to family or material pairs), and whether
+    // family pairs decide some of them
+    unsigned int nForceModels = 1;
+    bool forceModelsByFamily = false;
+    // Contacts grouped by force model, if there are several models. Rebuilt when contactPairArr_isFresh, and in every
+    // step if families can change on the fly and they decide models.
+    DEMForceModelGroups forceModelGroups;
 
     // If true, something critical (such as new clumps loaded, ts size changed...) just happened, and dT will need a kT
     // update to proceed.
@@ -254,6 +297,24 @@ class DEMDynamicThread {
     // Number of threads per block for dT force calculation kernels
     unsigned int DT_FORCE_CALC_NTHREADS_PER_BLOCK = 256;
 
+    // CUDA graph that holds the kernel sequence of one dT step (force prep, force calc, force collection, family
+    // changes and integration). It is replayed for each step if the user asks for it, and re-captured only if the sizes
+    // it was captured with are no longer valid.
+    cudaGraph_t stepGraph;
+    cudaGraphExec_t stepGraphExec;
+    bool stepGraphReady = false;
+    // The problem sizes the current step graph was captured with
+    size_t stepGraphNumContacts = 0;
+    size_t stepGraphNumOwners = 0;
+    unsigned int stepGraphForceNThreads = 0;
+
+    // Streams (and the events to fork to and join from them) that the contact class-specialized force kernels run on,
+    // if UseSegmentedForceKernels asks for concurrent streams. Created when first used.
+    cudaStream_t forceClassStreams[DEME_NUM_CONTACT_CLASSES];
+    cudaEvent_t forceForkEvent;
+    cudaEvent_t forceJoinEvents[DEME_NUM_CONTACT_CLASSES];
+    bool forceClassStreamsReady = false;
+
     // Template-related arrays in managed memory
     // Belonged-body ID
     std::vector<bodyID_t, ManagedAllocator<bodyID_t>> ownerClumpBody;
@@ -283,14 +344,30 @@ class DEMDynamicThread {
     // that means geometries should be considered in contact when they are physically in contact.
     std::vector<float, ManagedAllocator<float>> familyExtraMarginSize;
 
+    // Each family is integrated once every this many steps, with a step size this many times the time step size.
+    // Default is 1 for all families.
+    std::vector<unsigned int, ManagedAllocator<unsigned int>> familyStepRatio;
+
+    // Max owner velocity and acceleration magnitudes in a step, used when the step size is adapted on the device
+    std::vector<float, ManagedAllocator<float>> adaptTSGauge;
+
     // dT's copy of "clump template and their names" map
     std::unordered_map<unsigned int, std::string> templateNumNameMap;
 
     // dT's timers
     std::vector<std::string> timer_names = {"Clear force array", "Calculate contact forces", "Collect contact forces",
                                             "Integration",       "Unpack updates from kT",   "Send to kT buffer",
-                                            "Wait for kT update"};
+                                            "Wait for kT update", "Replay step graph",        "Re-order spheres"};
     SolverTimers timers = SolverTimers(timer_names);
+    // The cost-model drift controller times the first step after each kT update with events, and keeps smoothed
+    // dT step and kT contact detection times (in seconds), plus the drift it last chose
+    SolverTimer stepCostTimer;
+    double stepCostTimerTotal = 0.;
+    bool timeNextStep = false;
+    bool stepCostTimingPending = false;
+    double costModelStepSec = 0.;
+    double costModelCDSec = 0.;
+    unsigned int costModelDrift = 0;
 
   public:
     friend class DEMSolver;
@@ -305,6 +382,10 @@ class DEMDynamicThread {
 
         // Get a device/stream ID to use from the GPU Manager
         streamInfo = pGpuDistributor->getAvailableStream();
+        createExchangeEvents();
+
+        m_mem_registry.SetLabel("dT");
+        stateOfSolver_resources.memRegistry = &m_mem_registry;
 
         pPagerToMain->userCallDone = false;
         pSchedSupport->dynamicShouldJoin = false;
@@ -321,7 +402,18 @@ class DEMDynamicThread {
         pSchedSupport->dynamicShouldJoin = true;
         startThread();
         th.join();
+        releaseStepGraph();
+        if (forceClassStreamsReady) {
+            for (unsigned int i = 0; i < DEME_NUM_CONTACT_CLASSES; i++) {
+                cudaStreamDestroy(forceClassStreams[i]);
+                cudaEventDestroy(forceJoinEvents[i]);
+            }
+            cudaEventDestroy(forceForkEvent);
+        }
         cudaStreamDestroy(streamInfo.stream);
+        cudaEventDestroy(bufferSentEvent);
+        cudaEventDestroy(bufferUnpackedEvent);
+        cudaEventDestroy(meshNodesAppliedEvent);
 
         deallocateEverything();
 
@@ -356,6 +448,13 @@ class DEMDynamicThread {
                       const std::set<std::string>& contact_wildcards,
                       const std::set<std::string>& owner_wildcards,
                       const std::set<std::string>& geo_wildcards);
+    /// Set how the contact wildcards are stored, which decides the number of contact wildcard arrays
+    void setContactWildcardStorage(const std::vector<DEMContactWildcardStorage>& storage);
+    /// Get and set (as float) contact wildcard wc_num of a contact, on host
+    float getContactWildcard(unsigned int wc_num, size_t cnt) const;
+    void setContactWildcard(unsigned int wc_num, size_t cnt, float val);
+    /// Turn a copy of the contact wildcard arrays into one float array per contact wildcard
+    void unpackContactWildcards(std::vector<std::vector<float>>& arrays) const;
 
     /// @brief Get total number of contacts.
     /// @return Number of contacts.
@@ -383,12 +482,24 @@ class DEMDynamicThread {
     void setOwnerOriQ(bodyID_t ownerID, float4 oriQ);
     /// Set this owner's velocity
     void setOwnerVel(bodyID_t ownerID, float3 vel);
+    /// Reset this owner's quiet step count, so it is awake
+    void wakeOwner(bodyID_t ownerID);
     /// Rewrite the relative positions of the flattened triangle soup, starting from `start', using triangle nodal
     /// positions in `triangles'.
     void setTriNodeRelPos(size_t start, const std::vector<DEMTriangle>& triangles);
     /// Rewrite the relative positions of the flattened triangle soup, starting from `start' by the amount stipulated in
     /// updates.
     void updateTriNodeRelPos(size_t start, const std::vector<DEMTriangle>& updates);
+    /// Rewrite (or add to, if increment) the relative positions of nTri facets of mesh mesh_num, starting from
+    /// `start', using a device buffer on dT's GPU and the user's stream. If per_vertex, data holds the mesh's vertices
+    /// and is expanded to facet nodes on device; otherwise it is the triangle soup, 3 nodes per facet.
+    void applyTriNodeRelPosFromDevice(size_t mesh_num,
+                                      size_t start,
+                                      size_t nTri,
+                                      const float3* data,
+                                      bool per_vertex,
+                                      bool increment,
+                                      cudaStream_t stream);
 
     /// @brief Globally modify a owner wildcard's value.
     void setOwnerWildcardValue(bodyID_t ownerID, unsigned int wc_num, const std::vector<float>& vals);
@@ -455,6 +566,7 @@ class DEMDynamicThread {
                                size_t nTriMeshes,
                                size_t nSpheresGM,
                                size_t nTriGM,
+                               size_t nTriNodeGM,
                                unsigned int nAnalGM,
                                size_t nExtraContacts,
                                unsigned int nMassProperties,
@@ -483,6 +595,7 @@ class DEMDynamicThread {
                               const std::vector<unsigned int>& mesh_facet_owner,
                               const std::vector<materialsOffset_t>& mesh_facet_materials,
                               const std::vector<DEMTriangle>& mesh_facets,
+                              const std::vector<bodyID_t>& mesh_facet_node_offsets,
                               const ClumpTemplateFlatten& clump_templates,
                               const std::vector<float>& ext_obj_mass_types,
                               const std::vector<float3>& ext_obj_moi_types,
@@ -501,6 +614,17 @@ class DEMDynamicThread {
                           const std::vector<std::shared_ptr<DEMMaterial>>& loaded_materials,
                           const std::vector<notStupidBool_t>& family_mask_matrix,
                           const std::set<unsigned int>& no_output_families);
+    /// Load the mass, MOI and volume of each mass property type (clump templates, then analytical objects, then meshes)
+    void registerMassProperties(const ClumpTemplateFlatten& clump_templates,
+                                const std::vector<float>& ext_obj_mass_types,
+                                const std::vector<float3>& ext_obj_moi_types,
+                                const std::vector<float>& mesh_obj_mass_types,
+                                const std::vector<float3>& mesh_obj_moi_types);
+    /// Get the jitified-mode mass property types that are not clump templates (analytical objects', then meshes')
+    void getNonClumpMassProperties(std::vector<float>& mass_types, std::vector<float3>& moi_types) const;
+    /// Shift the mass property offsets of the existing non-clump owners, as new clump templates are inserted in the
+    /// mass property table before them
+    void shiftNonClumpInertiaOffsets(size_t nExistingOwners, unsigned int shift);
 
     /// Initialized managed arrays
     void initManagedArrays(const std::vector<std::shared_ptr<DEMClumpBatch>>& input_clump_batches,
@@ -514,6 +638,7 @@ class DEMDynamicThread {
                            const std::vector<unsigned int>& mesh_facet_owner,
                            const std::vector<materialsOffset_t>& mesh_facet_materials,
                            const std::vector<DEMTriangle>& mesh_facets,
+                           const std::vector<bodyID_t>& mesh_facet_node_offsets,
                            const std::unordered_map<unsigned int, std::string>& template_number_name_map,
                            const ClumpTemplateFlatten& clump_templates,
                            const std::vector<float>& ext_obj_mass_types,
@@ -539,6 +664,7 @@ class DEMDynamicThread {
                                const std::vector<unsigned int>& mesh_facet_owner,
                                const std::vector<materialsOffset_t>& mesh_facet_materials,
                                const std::vector<DEMTriangle>& mesh_facets,
+                               const std::vector<bodyID_t>& mesh_facet_node_offsets,
                                const ClumpTemplateFlatten& clump_templates,
                                const std::vector<float>& ext_obj_mass_types,
                                const std::vector<float3>& ext_obj_moi_types,
@@ -560,18 +686,85 @@ class DEMDynamicThread {
     /// Change radii and relPos info of these owners (if these owners are clumps)
     void changeOwnerSizes(const std::vector<bodyID_t>& IDs, const std::vector<float>& factors);
 
+    /// Remove the clumps of family fam, and their spheres and contacts, from the arrays of both dT and kT by stream
+    /// compaction. The arrays keep their sizes (the caller re-sizes them). ownerOldToNew and sphereUserOldToNew get the
+    /// new IDs of the owners and (user-level) spheres, NULL_BODYID for the removed ones. kT must be idle.
+    void purgeClumpsOfFamily(family_t fam,
+                             std::vector<bodyID_t>& ownerOldToNew,
+                             std::vector<bodyID_t>& sphereUserOldToNew,
+                             size_t& nOwnersLeft,
+                             size_t& nSpheresLeft);
+
+    /// Pack a batch of clumps into pinned host memory, to be appended to the arrays as owners firstOwner onward (and
+    /// spheres firstSphere onward) at the next kT handoff. It does not wait for the device. The templates these clumps
+    /// use must all be in the system already.
+    void queueClumpInsertion(const DEMClumpBatch& batch, size_t firstOwner, size_t firstSphere);
+    /// Append the queued clumps to the arrays of both dT and kT. kT must be idle.
+    void applyClumpInsertions();
+
     /// Put sim data array pointers in place
     void packDataPointers();
+    /// Tag managed arrays as device-preferred or read-mostly, and prefetch them to the device. Called before dT starts
+    /// working on a user call, since the host may have touched them since the last one (trackers, output etc.).
+    void applyManagedMemHints();
     void packTransferPointers(DEMKinematicThread*& kT);
 
 #ifdef DEME_USE_CHPF
     void writeSpheresAsChpf(std::ofstream& ptFile) const;
     void writeClumpsAsChpf(std::ofstream& ptFile, unsigned int accuracy = 10) const;
 #endif
-    void writeSpheresAsCsv(std::ofstream& ptFile) const;
-    void writeClumpsAsCsv(std::ofstream& ptFile, unsigned int accuracy = 10) const;
-    void writeContactsAsCsv(std::ofstream& ptFile, float force_thres = DEME_TINY_FLOAT) const;
+    /// Copy the data needed for writing output files to host, so the writing no longer depends on the solver state.
+    /// Owner info is always included; sphere and contact info only if asked for. If cnt_filter is given, contacts are
+    /// filtered on the device, and only the ones that pass (and only the columns to be written) are copied. The same
+    /// goes for the owners (and their spheres) if an active owner_filter is given; then contacts must not be asked for.
+    std::shared_ptr<DEMOutputSnapshot> takeOutputSnapshot(bool spheres,
+                                                          bool contacts,
+                                                          const DEMContactOutputFilter* cnt_filter = nullptr,
+                                                          const DEMOwnerOutputFilter* owner_filter = nullptr);
     void writeMeshesAsVtk(std::ofstream& ptFile);
+    /// Write all meshes as one binary VTK XML unstructured grid (.vtu). The vertices are moved to the global frame on
+    /// the device, once per vertex shared by facets, rather than on the host for each facet.
+    void writeMeshesAsVtu(std::ofstream& ptFile);
+
+    /// Gather one quantity of these owners on the device: 3 floats per owner, or 4 for quaternions. The result is
+    /// copied to a pinned host buffer in one go if to_host, or else left in a device buffer. Either buffer is returned,
+    /// and is valid until the next such gather.
+    float* gatherOwnerStates(OWNER_QUANTITY quantity, const std::vector<bodyID_t>& ownerIDs, bool to_host);
+    /// Same, for n owners starting from start; if families is not empty, only those in these families are gathered,
+    /// selected on the device. The IDs of the gathered owners are put in selected, if given.
+    float* gatherOwnerStatesInRange(OWNER_QUANTITY quantity,
+                                    bodyID_t start,
+                                    size_t n,
+                                    const std::set<unsigned int>& families,
+                                    std::vector<bodyID_t>* selected,
+                                    bool to_host);
+    /// Queue a gather of n owners starting from start, without waiting for it. The values go into the pinned buffer of
+    /// the returned handle.
+    std::shared_ptr<DEMAsyncResult> gatherOwnerStatesAsync(OWNER_QUANTITY quantity, bodyID_t start, size_t n);
+    /// Get the contact points, forces and torques of many owners in one go. The contacts of ownerIDs[i] are from
+    /// offsets[i] to offsets[i + 1] in the other outputs. Returns the total number of contacts.
+    size_t getOwnersContactForces(const std::vector<bodyID_t>& ownerIDs,
+                                  std::vector<size_t>& offsets,
+                                  std::vector<float3>& points,
+                                  std::vector<float3>& forces,
+                                  std::vector<float3>& torques,
+                                  bool torque_in_local);
+    /// The IDs of the owners in family N, selected on the device
+    std::vector<bodyID_t> getFamilyOwnerIDs(unsigned int N);
+    /// View a dT array in place, after the work queued on dT's stream is done. dir picks the component of owner
+    /// vector arrays, and is ignored for the others.
+    DEMDeviceArrayView getDeviceArrayView(DEVICE_ARRAY array, SPATIAL_DIR dir);
+    /// View an owner wildcard array in place; it is writable
+    DEMDeviceArrayView getOwnerWildcardDeviceView(unsigned int wc_num);
+    /// View the device buffer of a gatherOwnerStatesInRange (not to host) of n owners, after it is filled
+    DEMDeviceArrayView getOwnerStatesDeviceView(OWNER_QUANTITY quantity, bodyID_t start, size_t n);
+
+    /// Put the simulation state (owner states, wildcards, family masks and the contact list with its history) into a
+    /// checkpoint. Sphere IDs are stored in the user-facing order.
+    void writeCheckpoint(DEMCheckpointWriter& ckpt);
+    /// Load the simulation state from a checkpoint into a simulation of the same entities. The contacts are handed to
+    /// kT like user-loaded contacts, so the first contact detection maps onto them and their history carries over.
+    void readCheckpoint(DEMCheckpointReader& ckpt);
 
     /// Called each time when the user calls DoDynamicsThenSync.
     void startThread();
@@ -603,12 +796,24 @@ class DEMDynamicThread {
     // Jitify dT kernels (at initialization) based on existing knowledge of this run
     void jitifyKernels(const std::unordered_map<std::string, std::string>& Subs);
 
+    /// Benchmark candidate numbers of threads per block for the force calculation kernels on the current contact
+    /// array, and use the fastest. The winner is cached per GPU arch and force kernel source (in the JIT cache dir).
+    void autotuneLaunchConfigs();
+
     // Execute this kernel, then return the reduced value
-    float* inspectCall(const std::shared_ptr<jitify::Program>& inspection_kernel,
+    float* inspectCall(const std::shared_ptr<JitProgram>& inspection_kernel,
                        const std::string& kernel_name,
                        INSPECT_ENTITY_TYPE thing_to_insp,
                        CUB_REDUCE_FLAVOR reduce_flavor,
                        bool all_domain);
+    // Execute a fused inspector group kernel, reduce all its slots, then return the value of each slot
+    std::vector<float> inspectFusedCall(const std::shared_ptr<JitProgram>& fused_kernel,
+                                        unsigned int n_owner_slots,
+                                        unsigned int n_sphere_slots);
+    // Same, but only queue it on the stream; the values go into the pinned buffer of the returned handle
+    std::shared_ptr<DEMAsyncResult> inspectFusedCallAsync(const std::shared_ptr<JitProgram>& fused_kernel,
+                                                          unsigned int n_owner_slots,
+                                                          unsigned int n_sphere_slots);
 
   private:
     // Name for this class
@@ -619,8 +824,97 @@ class DEMDynamicThread {
     // contact map for dT.
     bool new_contacts_loaded = false;
 
+    // Sphere components may be re-ordered in memory (see SetSphereReorderFreq). These persistent tables map the sphere
+    // ID the user knows (the order spheres were loaded in) to where the sphere currently is in the sphere arrays, and
+    // back. They are empty if spheres were never re-ordered, and spheres added after the last re-ordering are not in
+    // them, since such spheres are in their original places.
+    std::vector<bodyID_t> sphereUserToImpl;
+    std::vector<bodyID_t> sphereImplToUser;
+    // Number of kT updates since the last sphere re-ordering
+    unsigned int nKTUpdatesSinceReorder = 0;
+    inline bodyID_t getSphereImplID(bodyID_t userID) const {
+        return (userID < sphereUserToImpl.size()) ? sphereUserToImpl[userID] : userID;
+    }
+    inline bodyID_t getSphereUserID(bodyID_t implID) const {
+        return (implID < sphereImplToUser.size()) ? sphereImplToUser[implID] : implID;
+    }
+    // Re-order sphere components (on both dT and kT) along the Morton curve of their owners' voxels, and remap the
+    // contact arrays accordingly. kT must be idle when this is called.
+    void reorderSpheres();
+    // How many of the first n contacts are stored the way contact detection reports them (see countCanonicalContacts
+    // kernel), so the history mapping can recognize them
+    size_t countCanonicalContacts(size_t n);
+
     // Meshes cached on dT side that has corresponding owner number associated. Useful for outputting meshes.
     std::vector<std::shared_ptr<DEMMeshConnected>> m_meshes;
+    // For .vtu mesh output: for each facet, where its 3 nodes go in the vertex list of all meshes (built from the mesh
+    // connectivity, so shared nodes go to one place), and where each mesh's vertices start in that list
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> meshOutputNodeSlots;
+    std::vector<size_t> meshOutputVertexOffsets;
+    // The number of facets the above was built for; it is re-built if meshes are added
+    size_t meshOutputNumFacets = 0;
+    // Pinned host buffer the device writes the global-frame vertices to
+    float3* meshOutputVertices = nullptr;
+    size_t meshOutputVerticesCapacity = 0;
+    // Build the node slots of .vtu mesh output, and make sure the vertex buffer is large enough
+    void buildMeshOutputConnectivity();
+
+    // Device and pinned host buffers of bulk owner state queries
+    float* ownerStateDevice = nullptr;
+    size_t ownerStateDeviceBytes = 0;
+    float* ownerStatePinned = nullptr;
+    size_t ownerStatePinnedBytes = 0;
+    // Gather a quantity of owners offset + ids[i] (offset + i if ids is nullptr) into ownerStateDevice, and return it
+    float* enqueueOwnerStateGather(OWNER_QUANTITY quantity, const bodyID_t* ids, bodyID_t offset, size_t n);
+    // Same, then wait for it, copying it to ownerStatePinned if to_host
+    float* launchOwnerStateGather(OWNER_QUANTITY quantity,
+                                  const bodyID_t* ids,
+                                  bodyID_t offset,
+                                  size_t n,
+                                  bool to_host);
+
+    // Results of asynchronous queries. A result that only this pool holds is free to be reused.
+    std::vector<std::shared_ptr<DEMAsyncResult>> asyncResults;
+    std::shared_ptr<DEMAsyncResult> acquireAsyncResult(size_t n);
+    // Device buffer that asynchronous fused inspections use, since the temp vectors may be reused before they run
+    char* asyncInspectBuffer = nullptr;
+    size_t asyncInspectBufferBytes = 0;
+    // The slot stride and the number of partial results per slot of a fused inspection
+    void getFusedInspectionSizes(unsigned int n_owner_slots,
+                                 unsigned int n_sphere_slots,
+                                 size_t& stride,
+                                 unsigned int& blocks_per_slot) const;
+    void launchFusedInspection(const std::shared_ptr<JitProgram>& fused_kernel,
+                               unsigned int n_owner_slots,
+                               unsigned int n_sphere_slots,
+                               size_t stride,
+                               unsigned int blocks_per_slot,
+                               float* resArr,
+                               notStupidBool_t* boolArrExclude,
+                               float* partials,
+                               float* res);
+
+    // A column of a queued clump insertion: n elements of elemBytes each, at offset of the pinned buffer, that go to
+    // the array dst gives from element first on. The array is looked up when the insertion is applied, as it may have
+    // been re-allocated in between.
+    struct ClumpInsertionColumn {
+        std::function<void*()> dst;
+        size_t first;
+        size_t elemBytes;
+        size_t n;
+        size_t offset;
+    };
+    struct ClumpInsertion {
+        size_t nOwners = 0;
+        size_t nSpheres = 0;
+        char* pinned = nullptr;
+        std::vector<ClumpInsertionColumn> columns;
+    };
+    // Clump insertions queued by the user thread, applied at the next kT handoff
+    std::vector<ClumpInsertion> pendingClumpInsertions;
+    std::mutex pendingClumpInsertionsMutex;
+    // If clump templates are jitified, the component offset of the first sphere of each template
+    std::vector<unsigned int> templateCompOffsets;
 
     // Number of trackers I already processed before (if I see a tracked_obj array longer than this in initialization, I
     // know I have to process the new-comers)
@@ -631,6 +925,8 @@ class DEMDynamicThread {
 
     // The inspector for calculating max vel for this cycle
     std::shared_ptr<DEMInspector> approxMaxVelFunc;
+    // Whether approxMaxVelFunc is the solver's own absv inspector, whose value the fused absv pass can stand in for
+    bool approxMaxVelFuncIsDefault = true;
 
     // Migrate contact history to fit the structure of the newly received contact array
     inline void migratePersistentContacts();
@@ -648,6 +944,8 @@ class DEMDynamicThread {
 
     // Change sim params based on dT's experience, if needed
     inline void calibrateParams();
+    // Choose the future drift from the measured costs of a dT step and a kT contact detection
+    inline void calibrateDriftByCostModel();
 
     // Determine the max vel for this cycle, kT needs it
     inline float* determineSysVel();
@@ -656,12 +954,41 @@ class DEMDynamicThread {
     // mid-step stage)
     inline void routineChecks();
 
+    // Adapt the step size on the device, from the max owner velocity and acceleration of this step
+    inline void enqueueStepSizeUpdate();
+
+    // Calculate contact forces with one kernel per contact class, using the class offsets kT sent
+    inline void launchSegmentedForceKernels(size_t nContactPairs);
+    // Calculate contact forces with one kernel per force model, over the contacts grouped by model
+    inline void launchForceModelKernels(size_t nContactPairs);
+    // Copy the contacts that pass the filter to an output snapshot; see takeOutputSnapshot
+    void copyFilteredContactsToSnapshot(DEMOutputSnapshot& snap, const DEMContactOutputFilter& filter);
+    // Copy the owners (and spheres, if asked for) that pass the filter to an output snapshot; see takeOutputSnapshot
+    void copyFilteredOwnersToSnapshot(DEMOutputSnapshot& snap, bool spheres, const DEMOwnerOutputFilter& filter);
+
+    // Whether this step can be done by replaying a CUDA graph
+    inline bool canUseStepGraph() const;
+    // Do one step by replaying the step CUDA graph (capture it first if it is not ready or no longer valid)
+    inline void stepWithCudaGraph();
+    // Enqueue all kernels of one step to dT's stream, without synchronizing in between. Used for graph capture.
+    inline void enqueueStepKernels();
+    // Destroy the step CUDA graph, so it will be re-captured next time it is needed
+    void releaseStepGraph();
+
     // Bring dT buffer array data to its working arrays
     inline void unpackMyBuffer();
+    // Create the events used in buffer exchange, on the device of this thread
+    void createExchangeEvents();
     // Send produced data to kT-owned biffers
     void sendToTheirBuffer();
+    // Queue a copy from my device to a kT-owned buffer: a peer copy if kT is on another device with peer access
+    void copyToTheirBuffer(void* dst, const void* src, size_t bytes);
+    // Build the contact arrays from a delta-encoded update: persistent contacts from my arrays, new ones from buffer
+    void patchContactArrays(size_t nContactPairs, size_t nNewContacts);
     // Resize some work arrays based on the number of contact pairs provided by kT
     void contactEventArraysResize(size_t nContactPairs);
+    // Grow the contact event-based arrays and contact wildcards to hold at least this many contacts
+    void reserveContactArrays(size_t nContactPairs);
 
     // Deallocate everything
     void deallocateEverything();
@@ -672,13 +999,13 @@ class DEMDynamicThread {
     inline bodyID_t getOwnerForContactB(const bodyID_t& geoB, const contact_t& type) const;
 
     // Just-in-time compiled kernels
-    std::shared_ptr<jitify::Program> prep_force_kernels;
-    std::shared_ptr<jitify::Program> cal_force_kernels;
-    std::shared_ptr<jitify::Program> collect_force_kernels;
-    std::shared_ptr<jitify::Program> integrator_kernels;
-    // std::shared_ptr<jitify::Program> quarry_stats_kernels;
-    std::shared_ptr<jitify::Program> mod_kernels;
-    std::shared_ptr<jitify::Program> misc_kernels;
+    std::shared_ptr<JitProgram> prep_force_kernels;
+    std::shared_ptr<JitProgram> cal_force_kernels;
+    std::shared_ptr<JitProgram> collect_force_kernels;
+    std::shared_ptr<JitProgram> integrator_kernels;
+    // std::shared_ptr<JitProgram> quarry_stats_kernels;
+    std::shared_ptr<JitProgram> mod_kernels;
+    std::shared_ptr<JitProgram> misc_kernels;
 
     // Adjuster for update freq
     class AccumStepUpdater {
@@ -27,6 +27,14 @@ inline void DEMKinematicThread::transferArraysResize(size_t nContactPairs) {
     // DEME_ADVISE_DEVICE(dT->idGeometryB_buffer, dT->streamInfo.device);
     // DEME_ADVISE_DEVICE(dT->contactType_buffer, dT->streamInfo.device);
 
+    // Grow geometrically, so a contact number that creeps up does not get these buffers reallocated at each kT update.
+    // Never shrink them either (we can get here only to add the contact delta buffer).
+    if (nContactPairs > dT->buffer_size) {
+        nContactPairs = DEME_MAX(nContactPairs, (size_t)((double)dT->buffer_size * DEME_CNT_ARRAY_GROWTH));
+    } else {
+        nContactPairs = dT->buffer_size;
+    }
+
     // These buffers are on dT
     DEME_GPU_CALL(cudaSetDevice(dT->streamInfo.device));
     dT->buffer_size = nContactPairs;
@@ -43,6 +51,10 @@ inline void DEMKinematicThread::transferArraysResize(size_t nContactPairs) {
         DEME_DEVICE_PTR_ALLOC(dT->granData->contactMapping_buffer, nContactPairs);
         granData->pDTOwnedBuffer_contactMapping = dT->granData->contactMapping_buffer;
     }
+    if (solverFlags.useContactDelta) {
+        DEME_DEVICE_PTR_ALLOC(dT->granData->newContactIdx_buffer, nContactPairs);
+        granData->pDTOwnedBuffer_newContactIdx = dT->granData->newContactIdx_buffer;
+    }
     // Unset the device change we just made
     DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
 }
@@ -66,6 +78,11 @@ void DEMKinematicThread::calibrateParams() {
                 // If no improvement, revert the direction
                 speed_update = -speed_dir * stateParams.binChangeRateAcc * stateParams.binTopChangeRate;
             }
+            // If the memory use is close to the budget, the bin size should increase, since larger bins mean fewer
+            // bin--sphere pairs to store
+            if (m_mem_registry.IsUnderPressure(DEME_MEM_BUDGET_PRESSURE)) {
+                speed_update = 1.0 * stateParams.binChangeRateAcc * stateParams.binTopChangeRate;
+            }
             // But, if the bin size is going to get too big or too small, a penalty is enforced
             if (stateParams.maxSphFoundInBin > stateParams.binChangeUpperSafety * simParams->errOutBinSphNum ||
                 stateParams.maxTriFoundInBin > stateParams.binChangeUpperSafety * simParams->errOutBinTriNum) {
@@ -93,7 +110,15 @@ void DEMKinematicThread::calibrateParams() {
             // Register the new bin size
             stateParams.numBins =
                 hostCalcBinNum(simParams->nbX, simParams->nbY, simParams->nbZ, simParams->voxelSize, simParams->binSize,
-                               simParams->nvXp2, simParams->nvYp2, simParams->nvZp2);
+                               simParams->nvXp2, simParams->nvYp2, simParams->nvZp2, simParams->twoDimensional);
+
+            {
+                std::lock_guard<std::mutex> lock(binSizeHistoryMutex);
+                binSizeHistory.push_back(DEMBinSizeRecord{pSchedSupport->schedulingStats.nKinematicUpdates.load(),
+                                                          (double)simParams->binSize, stateParams.numBins});
+                if (binSizeHistory.size() > MAX_BIN_SIZE_HISTORY_RECORDS)
+                    binSizeHistory.pop_front();
+            }
 
             DEME_DEBUG_PRINTF("Bin size is now: %.7g", simParams->binSize);
             DEME_DEBUG_PRINTF("Total num of bins is now: %zu", stateParams.numBins);
@@ -102,29 +127,85 @@ void DEMKinematicThread::calibrateParams() {
     }
 }
 
+void DEMKinematicThread::createExchangeEvents() {
+    int prev_device;
+    DEME_GPU_CALL(cudaGetDevice(&prev_device));
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    DEME_GPU_CALL(cudaEventCreateWithFlags(&bufferSentEvent, cudaEventDisableTiming));
+    DEME_GPU_CALL(cudaEventCreateWithFlags(&bufferUnpackedEvent, cudaEventDisableTiming));
+    DEME_GPU_CALL(cudaSetDevice(prev_device));
+}
+
 inline void DEMKinematicThread::unpackMyBuffer() {
-    DEME_GPU_CALL(cudaMemcpy(granData->voxelID, granData->voxelID_buffer, simParams->nOwnerBodies * sizeof(voxelID_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->locX, granData->locX_buffer, simParams->nOwnerBodies * sizeof(subVoxelPos_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->locY, granData->locY_buffer, simParams->nOwnerBodies * sizeof(subVoxelPos_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->locZ, granData->locZ_buffer, simParams->nOwnerBodies * sizeof(subVoxelPos_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->oriQw, granData->oriQ0_buffer, simParams->nOwnerBodies * sizeof(oriQ_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->oriQx, granData->oriQ1_buffer, simParams->nOwnerBodies * sizeof(oriQ_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->oriQy, granData->oriQ2_buffer, simParams->nOwnerBodies * sizeof(oriQ_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->oriQz, granData->oriQ3_buffer, simParams->nOwnerBodies * sizeof(oriQ_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->marginSize, granData->absVel_buffer, simParams->nOwnerBodies * sizeof(float),
-                             cudaMemcpyDeviceToDevice));
-
-    DEME_GPU_CALL(cudaMemcpy(&(granData->ts), &(granData->ts_buffer), sizeof(float), cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(&(granData->maxDrift), &(granData->maxDrift_buffer), sizeof(unsigned int),
-                             cudaMemcpyDeviceToDevice));
+    // dT queued the copies to my buffer on its own stream, and did not wait for them. So my stream must wait for them
+    // to finish before reading the buffer.
+    DEME_GPU_CALL(cudaStreamWaitEvent(streamInfo.stream, dT->bufferSentEvent, 0));
+    DEME_GPU_CALL(cudaMemcpyAsync(granData->voxelID, granData->voxelID_buffer,
+                                  simParams->nOwnerBodies * sizeof(voxelID_t), cudaMemcpyDeviceToDevice,
+                                  streamInfo.stream));
+    DEME_GPU_CALL(cudaMemcpyAsync(granData->locX, granData->locX_buffer,
+                                  simParams->nOwnerBodies * sizeof(subVoxelPos_t), cudaMemcpyDeviceToDevice,
+                                  streamInfo.stream));
+    DEME_GPU_CALL(cudaMemcpyAsync(granData->locY, granData->locY_buffer,
+                                  simParams->nOwnerBodies * sizeof(subVoxelPos_t), cudaMemcpyDeviceToDevice,
+                                  streamInfo.stream));
+    DEME_GPU_CALL(cudaMemcpyAsync(granData->locZ, granData->locZ_buffer,
+                                  simParams->nOwnerBodies * sizeof(subVoxelPos_t), cudaMemcpyDeviceToDevice,
+                                  streamInfo.stream));
+    DEME_GPU_CALL(cudaMemcpyAsync(granData->oriQw, granData->oriQ0_buffer,
+                                  simParams->nOwnerBodies * sizeof(oriQStore_t), cudaMemcpyDeviceToDevice,
+                                  streamInfo.stream));
+    DEME_GPU_CALL(cudaMemcpyAsync(granData->oriQx, granData->oriQ1_buffer,
+                                  simParams->nOwnerBodies * sizeof(oriQStore_t), cudaMemcpyDeviceToDevice,
+                                  streamInfo.stream));
+    DEME_GPU_CALL(cudaMemcpyAsync(granData->oriQy, granData->oriQ2_buffer,
+                                  simParams->nOwnerBodies * sizeof(oriQStore_t), cudaMemcpyDeviceToDevice,
+                                  streamInfo.stream));
+    DEME_GPU_CALL(cudaMemcpyAsync(granData->oriQz, granData->oriQ3_buffer,
+                                  simParams->nOwnerBodies * sizeof(oriQStore_t), cudaMemcpyDeviceToDevice,
+                                  streamInfo.stream));
+    DEME_GPU_CALL(cudaMemcpyAsync(granData->marginSize, granData->absVel_buffer,
+                                  simParams->nOwnerBodies * sizeof(float), cudaMemcpyDeviceToDevice,
+                                  streamInfo.stream));
+
+    DEME_GPU_CALL(cudaMemcpyAsync(&(granData->ts), &(granData->ts_buffer), sizeof(float), cudaMemcpyDeviceToDevice,
+                                  streamInfo.stream));
+    DEME_GPU_CALL(cudaMemcpyAsync(&(granData->maxDrift), &(granData->maxDrift_buffer), sizeof(unsigned int),
+                                  cudaMemcpyDeviceToDevice, streamInfo.stream));
+
+    // Family number is a typical changable quantity on-the-fly. If this flag is on, kT received changes from dT.
+    if (solverFlags.canFamilyChange) {
+        DEME_GPU_CALL(cudaMemcpyAsync(granData->familyID, granData->familyID_buffer,
+                                      simParams->nOwnerBodies * sizeof(family_t), cudaMemcpyDeviceToDevice,
+                                      streamInfo.stream));
+    }
+
+    // If dT received a mesh deformation request from user, then it is now passed to kT. Only the node ranges dT sent
+    // are unpacked.
+    if (solverFlags.willMeshDeform) {
+        for (const auto& range : meshNodeDirtyRanges) {
+            const size_t bytes = (range.second - range.first) * sizeof(float3);
+            DEME_GPU_CALL(cudaMemcpyAsync(granData->relPosNode1 + range.first,
+                                          granData->relPosNode1_buffer + range.first, bytes,
+                                          cudaMemcpyDeviceToDevice, streamInfo.stream));
+            DEME_GPU_CALL(cudaMemcpyAsync(granData->relPosNode2 + range.first,
+                                          granData->relPosNode2_buffer + range.first, bytes,
+                                          cudaMemcpyDeviceToDevice, streamInfo.stream));
+            DEME_GPU_CALL(cudaMemcpyAsync(granData->relPosNode3 + range.first,
+                                          granData->relPosNode3_buffer + range.first, bytes,
+                                          cudaMemcpyDeviceToDevice, streamInfo.stream));
+        }
+        meshNodeDirtyRanges.clear();
+        // dT won't be sending if kT is loading, so it is safe
+        solverFlags.willMeshDeform = false;
+        contactListReusable = false;
+        // Deformed meshes' BVHs are no longer valid, and a refit would not recover their quality
+        triangleBVH.needRebuild = true;
+    }
+    // Done reading my buffer; dT's next send waits on this event before writing to it
+    DEME_GPU_CALL(cudaEventRecord(bufferUnpackedEvent, streamInfo.stream));
+    // maxDrift is used on host right below
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
 
     // Whatever drift value dT says, kT listens; unless kinematicMaxFutureDrift is negative in which case the user
     // explicitly said not caring the future drift.
@@ -159,62 +240,145 @@ inline void DEMKinematicThread::unpackMyBuffer() {
             .instantiate()
             .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
             .launch(simParams, granData, (size_t)simParams->nOwnerBodies);
-        DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+        DEME_SYNC_UNLESS_NO_SYNC(solverFlags, streamInfo.stream);
     } else {  // If isExpandFactorFixed, then just fill in that constant array.
         size_t blocks_needed = (simParams->nOwnerBodies + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
         misc_kernels->kernel("fillMarginValues")
             .instantiate()
             .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
             .launch(simParams, granData, (size_t)simParams->nOwnerBodies);
-        DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+        DEME_SYNC_UNLESS_NO_SYNC(solverFlags, streamInfo.stream);
     }
 
     DEME_DEBUG_PRINTF("kT received a velocity update: %.6g", granData->maxVel);
     // DEME_DEBUG_PRINTF("A margin of thickness %.6g is added", simParams->beta);
+}
 
-    // Family number is a typical changable quantity on-the-fly. If this flag is on, kT received changes from dT.
-    if (solverFlags.canFamilyChange) {
-        DEME_GPU_CALL(cudaMemcpy(granData->familyID, granData->familyID_buffer,
-                                 simParams->nOwnerBodies * sizeof(family_t), cudaMemcpyDeviceToDevice));
+bool DEMKinematicThread::contactListStillValid() {
+    if (!contactListReusable || lastCD_ownerPos.size() != simParams->nOwnerBodies) {
+        return false;
+    }
+    notStupidBool_t* needCD = (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(0, sizeof(notStupidBool_t));
+    *needCD = 0;
+    size_t blocks_needed = (simParams->nSpheresGM + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    if (blocks_needed > 0) {
+        bin_sphere_kernels->kernel("checkSphereMarginUsedUp")
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(simParams, granData, lastCD_ownerPos.data(), lastCD_ownerOriQ.data(), lastCD_marginSize.data(),
+                    lastCD_familyID.data(), needCD);
     }
+    blocks_needed = ((size_t)simParams->nAnalGM + (size_t)simParams->nTriGM + DEME_MAX_THREADS_PER_BLOCK - 1) /
+                    DEME_MAX_THREADS_PER_BLOCK;
+    if (blocks_needed > 0) {
+        bin_sphere_kernels->kernel("checkNonSphereOwnersMoved")
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(simParams, granData, lastCD_ownerPos.data(), lastCD_ownerOriQ.data(), lastCD_familyID.data(),
+                    needCD);
+    }
+    // The result is used on host right below
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    return (*needCD == 0);
+}
 
-    // If dT received a mesh deformation request from user, then it is now passed to kT
-    if (solverFlags.willMeshDeform) {
-        DEME_GPU_CALL(cudaMemcpy(granData->relPosNode1, granData->relPosNode1_buffer,
-                                 simParams->nTriGM * sizeof(float3), cudaMemcpyDeviceToDevice));
-        DEME_GPU_CALL(cudaMemcpy(granData->relPosNode2, granData->relPosNode2_buffer,
-                                 simParams->nTriGM * sizeof(float3), cudaMemcpyDeviceToDevice));
-        DEME_GPU_CALL(cudaMemcpy(granData->relPosNode3, granData->relPosNode3_buffer,
-                                 simParams->nTriGM * sizeof(float3), cudaMemcpyDeviceToDevice));
-        // dT won't be sending if kT is loading, so it is safe
-        solverFlags.willMeshDeform = false;
+void DEMKinematicThread::recordStatesAtCD() {
+    if (lastCD_ownerPos.size() != simParams->nOwnerBodies) {
+        DEME_TRACKED_RESIZE(lastCD_ownerPos, simParams->nOwnerBodies, double3());
+        DEME_TRACKED_RESIZE(lastCD_ownerOriQ, simParams->nOwnerBodies, float4());
+        DEME_TRACKED_RESIZE(lastCD_marginSize, simParams->nOwnerBodies, 0);
+        DEME_TRACKED_RESIZE(lastCD_familyID, simParams->nOwnerBodies, 0);
+    }
+    size_t blocks_needed = (simParams->nOwnerBodies + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    if (blocks_needed > 0) {
+        bin_sphere_kernels->kernel("recordOwnerStatesAtCD")
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(simParams, granData, lastCD_ownerPos.data(), lastCD_ownerOriQ.data(), lastCD_marginSize.data(),
+                    lastCD_familyID.data(), (size_t)simParams->nOwnerBodies);
+        DEME_SYNC_UNLESS_NO_SYNC(solverFlags, streamInfo.stream);
+    }
+    contactListReusable = true;
+}
+
+void DEMKinematicThread::reuseContactList() {
+    // dT's contact arrays are exactly the last list I shipped, so each contact maps onto itself, and previous_* arrays
+    // (the reference of the next real contact detection) stay as they are
+    const size_t nContacts = *stateOfSolver_resources.pNumContacts;
+    if (!solverFlags.isHistoryless && nContacts > 0) {
+        size_t blocks_needed = (nContacts + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+        history_kernels->kernel("lineNumbers")
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+            .launch(granData->contactMapping, nContacts);
+        DEME_SYNC_UNLESS_NO_SYNC(solverFlags, streamInfo.stream);
+    }
+    DEME_DEBUG_PRINTF("kT reuses the last contact list (%zu contacts) since no sphere used up its margin.", nContacts);
+}
+
+inline void DEMKinematicThread::copyToTheirBuffer(void* dst, const void* src, size_t bytes) {
+    if (solverFlags.usePeerTransfer) {
+        DEME_GPU_CALL(
+            cudaMemcpyPeerAsync(dst, dT->streamInfo.device, src, streamInfo.device, bytes, streamInfo.stream));
+    } else {
+        DEME_GPU_CALL(cudaMemcpyAsync(dst, src, bytes, cudaMemcpyDeviceToDevice, streamInfo.stream));
     }
 }
 
 inline void DEMKinematicThread::sendToTheirBuffer() {
-    DEME_GPU_CALL(cudaMemcpy(granData->pDTOwnedBuffer_nContactPairs, stateOfSolver_resources.pNumContacts,
-                             sizeof(size_t), cudaMemcpyDeviceToDevice));
+    const size_t nContacts = *stateOfSolver_resources.pNumContacts;
     // Resize dT owned buffers before usage
-    if (*stateOfSolver_resources.pNumContacts > dT->buffer_size) {
-        transferArraysResize(*stateOfSolver_resources.pNumContacts);
+    if (nContacts > dT->buffer_size || (solverFlags.useContactDelta && !dT->granData->newContactIdx_buffer)) {
+        transferArraysResize(nContacts);
+    }
+    // If dT still holds what I shipped last time, only the contacts that are new to this update need to be sent; dT
+    // takes the persistent ones from its own arrays, using the contact mapping.
+    bool ship_delta = false;
+    granData->nNewContacts = nContacts;
+    if (solverFlags.useContactDelta && contactDeltaBaseValid) {
+        size_t nNewContacts = buildContactDelta(history_kernels, granData, nContacts, newContactIdx,
+                                                newContact_idGeometryA, newContact_idGeometryB, newContact_contactType,
+                                                streamInfo.stream, stateOfSolver_resources);
+        if (nNewContacts < nContacts) {
+            ship_delta = true;
+            granData->nNewContacts = nNewContacts;
+        }
     }
 
-    DEME_GPU_CALL(cudaMemcpy(granData->pDTOwnedBuffer_idGeometryA, granData->idGeometryA,
-                             (*stateOfSolver_resources.pNumContacts) * sizeof(bodyID_t), cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->pDTOwnedBuffer_idGeometryB, granData->idGeometryB,
-                             (*stateOfSolver_resources.pNumContacts) * sizeof(bodyID_t), cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->pDTOwnedBuffer_contactType, granData->contactType,
-                             (*stateOfSolver_resources.pNumContacts) * sizeof(contact_t), cudaMemcpyDeviceToDevice));
+    // All copies are queued on my stream and I do not wait for them. But dT may still be reading the last batch I sent
+    // (on its stream), so my stream waits on that first.
+    DEME_GPU_CALL(cudaStreamWaitEvent(streamInfo.stream, dT->bufferUnpackedEvent, 0));
+    copyToTheirBuffer(granData->pDTOwnedBuffer_nContactPairs, stateOfSolver_resources.pNumContacts, sizeof(size_t));
+    copyToTheirBuffer(granData->pDTOwnedBuffer_nNewContacts, &(granData->nNewContacts), sizeof(size_t));
+    copyToTheirBuffer(granData->pDTOwnedBuffer_contactClassOffsets, granData->contactClassOffsets,
+                      sizeof(granData->contactClassOffsets));
+
+    if (ship_delta) {
+        copyToTheirBuffer(granData->pDTOwnedBuffer_newContactIdx, newContactIdx.data(),
+                          granData->nNewContacts * sizeof(contactPairs_t));
+        copyToTheirBuffer(granData->pDTOwnedBuffer_idGeometryA, newContact_idGeometryA.data(),
+                          granData->nNewContacts * sizeof(bodyID_t));
+        copyToTheirBuffer(granData->pDTOwnedBuffer_idGeometryB, newContact_idGeometryB.data(),
+                          granData->nNewContacts * sizeof(bodyID_t));
+        copyToTheirBuffer(granData->pDTOwnedBuffer_contactType, newContact_contactType.data(),
+                          granData->nNewContacts * sizeof(contact_t));
+    } else {
+        copyToTheirBuffer(granData->pDTOwnedBuffer_idGeometryA, granData->idGeometryA, nContacts * sizeof(bodyID_t));
+        copyToTheirBuffer(granData->pDTOwnedBuffer_idGeometryB, granData->idGeometryB, nContacts * sizeof(bodyID_t));
+        copyToTheirBuffer(granData->pDTOwnedBuffer_contactType, granData->contactType, nContacts * sizeof(contact_t));
+    }
     // DEME_MIGRATE_TO_DEVICE(dT->idGeometryA_buffer, dT->streamInfo.device, streamInfo.stream);
     // DEME_MIGRATE_TO_DEVICE(dT->idGeometryB_buffer, dT->streamInfo.device, streamInfo.stream);
     // DEME_MIGRATE_TO_DEVICE(dT->contactType_buffer, dT->streamInfo.device, streamInfo.stream);
     if (!solverFlags.isHistoryless) {
-        DEME_GPU_CALL(cudaMemcpy(granData->pDTOwnedBuffer_contactMapping, granData->contactMapping,
-                                 (*stateOfSolver_resources.pNumContacts) * sizeof(contactPairs_t),
-                                 cudaMemcpyDeviceToDevice));
+        copyToTheirBuffer(granData->pDTOwnedBuffer_contactMapping, granData->contactMapping,
+                          nContacts * sizeof(contactPairs_t));
         // DEME_MIGRATE_TO_DEVICE(dT->contactMapping_buffer, dT->streamInfo.device, streamInfo.stream);
     }
-    // DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    // dT waits on this event (on its stream) before unpacking
+    DEME_GPU_CALL(cudaEventRecord(bufferSentEvent, streamInfo.stream));
+    // dT always unpacks what I send before giving me a new work order, so next time a delta against it can be sent
+    contactDeltaBaseValid = true;
 }
 
 void DEMKinematicThread::workerThread() {
@@ -235,6 +399,11 @@ void DEMKinematicThread::workerThread() {
                 break;
             }
         }
+        // The user may have switched no-sync mode or event timing since the last run
+        timers.UseEvents(solverFlags.useNoSyncMode || solverFlags.useEventTiming, streamInfo.stream);
+        cdCostTimer.UseEvents(true, streamInfo.stream);
+        // The host may have touched the arrays since the last run
+        applyManagedMemHints();
 
         // Run a while loop producing stuff in each iteration; once produced, it should be made available to the dynamic
         // via memcpy
@@ -243,13 +412,16 @@ void DEMKinematicThread::workerThread() {
             if (!pSchedSupport->kinematicOwned_Cons2ProdBuffer_isFresh) {
                 timers.GetTimer("Wait for dT update").start();
                 pSchedSupport->schedulingStats.nTimesKinematicHeldBack++;
-                std::unique_lock<std::mutex> lock(pSchedSupport->kinematicCanProceed);
-
-                // kT never got locked in here indefinitely because, dT will always send a cv_KinematicCanProceed signal
-                // AFTER setting dynamicDone to true, if dT is about to finish
-                while (!pSchedSupport->kinematicOwned_Cons2ProdBuffer_isFresh) {
-                    // Loop to avoid spurious wakeups
-                    pSchedSupport->cv_KinematicCanProceed.wait(lock);
+                {
+                    WaitTimeRecorder wait_recorder(pSchedSupport->schedulingStats.kinematicWaitNanosec);
+                    std::unique_lock<std::mutex> lock(pSchedSupport->kinematicCanProceed);
+
+                    // kT never got locked in here indefinitely because, dT will always send a cv_KinematicCanProceed
+                    // signal AFTER setting dynamicDone to true, if dT is about to finish
+                    while (!pSchedSupport->kinematicOwned_Cons2ProdBuffer_isFresh) {
+                        // Loop to avoid spurious wakeups
+                        pSchedSupport->cv_KinematicCanProceed.wait(lock);
+                    }
                 }
                 timers.GetTimer("Wait for dT update").stop();
 
@@ -262,12 +434,10 @@ void DEMKinematicThread::workerThread() {
 
             timers.GetTimer("Unpack updates from dT").start();
             // Getting here means that new `work order' data has been provided
-            {
-                // Acquire lock and get the work order
-                std::lock_guard<std::mutex> lock(pSchedSupport->kinematicOwnedBuffer_AccessCoordination);
-                unpackMyBuffer();
-                // pSchedSupport->schedulingStats.nKinematicReceives++;
-            }
+            // Get the work order. dT does not write to my buffer again before it gets my produce, and the GPU-side
+            // order is taken care of by the exchange events, so no lock is needed.
+            unpackMyBuffer();
+            // pSchedSupport->schedulingStats.nKinematicReceives++;
             timers.GetTimer("Unpack updates from dT").stop();
 
             // Make it clear that the data for most recent work order has been used, in case there is interest in
@@ -279,19 +449,63 @@ void DEMKinematicThread::workerThread() {
 
             // kT's main task, contact detection.
             // For auto-adjusting bin size, this part of code is encapsuled in an accumulative timer.
-            CDAccumTimer.Begin();
-            contactDetection(bin_sphere_kernels, bin_triangle_kernels, sphere_contact_kernels, sphTri_contact_kernels,
-                             history_kernels, granData, simParams, solverFlags, verbosity, idGeometryA, idGeometryB,
-                             contactType, previous_idGeometryA, previous_idGeometryB, previous_contactType,
-                             contactMapping, streamInfo.stream, stateOfSolver_resources, timers, stateParams);
-            CDAccumTimer.End();
+            // If no sphere has used up its margin since the last contact detection, the contact list made then still
+            // has all the contacts dT can run into before the next update, and contact detection can be skipped.
+            if (solverFlags.useCostModelDrift) {
+                cdCostTimer.start();
+            }
+            if (solverFlags.useContactListReuse && contactListStillValid()) {
+                reuseContactList();
+                pSchedSupport->schedulingStats.nContactListReuses++;
+            } else {
+                if (solverFlags.useContactListReuse && solverFlags.contactListSkin > 0.) {
+                    // The skin makes this contact list last for more updates
+                    size_t blocks_needed =
+                        (simParams->nOwnerBodies + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+                    misc_kernels->kernel("addToMarginValues")
+                        .instantiate()
+                        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+                        .launch(granData, solverFlags.contactListSkin, (size_t)simParams->nOwnerBodies);
+                    DEME_SYNC_UNLESS_NO_SYNC(solverFlags, streamInfo.stream);
+                }
+                if (solverFlags.binProfileFreq > 0) {
+                    binProfiler.runThisTime = (nCDsSinceBinProfile == 0);
+                    nCDsSinceBinProfile = (nCDsSinceBinProfile + 1) % solverFlags.binProfileFreq;
+                } else {
+                    binProfiler.runThisTime = false;
+                }
+                CDAccumTimer.Begin();
+                contactDetection(bin_sphere_kernels, bin_triangle_kernels, sphere_contact_kernels,
+                                 sphTri_contact_kernels, history_kernels, granData, simParams, solverFlags, verbosity,
+                                 idGeometryA, idGeometryB, contactType, previous_idGeometryA, previous_idGeometryB,
+                                 previous_contactType, contactMapping, triangleBVH, fixedSphereBins, binProfiler,
+                                 streamInfo.stream, stateOfSolver_resources, timers, stateParams);
+                CDAccumTimer.End();
+                if (binProfiler.runThisTime && binProfiler.result.valid) {
+                    std::lock_guard<std::mutex> lock(binProfileMutex);
+                    binProfile = binProfiler.result;
+                    binProfile.kTUpdate = pSchedSupport->schedulingStats.nKinematicUpdates.load();
+                }
+                if (solverFlags.useContactListReuse) {
+                    recordStatesAtCD();
+                }
+            }
+            if (solverFlags.useCostModelDrift) {
+                // Publish how long this update took on the GPU, for dT's cost-model drift controller
+                cdCostTimer.stop();
+                const double total = cdCostTimer.GetTimeSeconds();
+                const uint64_t cd_ns = (uint64_t)((total - cdCostTimerTotal) * 1e9);
+                cdCostTimerTotal = total;
+                pSchedSupport->schedulingStats.lastKinematicCDNanosec = cd_ns;
+                pSchedSupport->schedulingStats.kinematicCDNanosec += cd_ns;
+                pSchedSupport->schedulingStats.nKinematicCDTimed++;
+            }
 
             timers.GetTimer("Send to dT buffer").start();
             {
                 // kT will reflect on how good the choice of parameters is
                 calibrateParams();
-                // Acquire lock and supply the dynamic with fresh produce
-                std::lock_guard<std::mutex> lock(pSchedSupport->dynamicOwnedBuffer_AccessCoordination);
+                // Supply the dynamic with fresh produce. The copies are only queued; dT's stream waits for them.
                 sendToTheirBuffer();
             }
             pSchedSupport->dynamicOwned_Prod2ConsBuffer_isFresh = true;
@@ -326,6 +540,7 @@ void DEMKinematicThread::changeFamily(unsigned int ID_from, unsigned int ID_to)
     family_t ID_to_impl = ID_to;
     std::replace_if(
         familyID.begin(), familyID.end(), [ID_from_impl](family_t& i) { return i == ID_from_impl; }, ID_to_impl);
+    contactListReusable = false;
 }
 
 void DEMKinematicThread::changeOwnerSizes(const std::vector<bodyID_t>& IDs, const std::vector<float>& factors) {
@@ -365,6 +580,9 @@ void DEMKinematicThread::changeOwnerSizes(const std::vector<bodyID_t>& IDs, cons
         .configure(dim3(blocks_needed_for_changing), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
         .launch(granData, idBool, ownerFactors, (size_t)simParams->nSpheresGM);
     DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    // Bigger spheres may have new contacts even if nothing moved
+    contactListReusable = false;
+    fixedSphereBins.needRebuild = true;
 
     // cudaStreamDestroy(new_stream);
 }
@@ -401,7 +619,7 @@ void DEMKinematicThread::resetUserCallStat() {
 }
 
 size_t DEMKinematicThread::estimateMemUsage() const {
-    return m_approx_bytes_used;
+    return m_mem_registry.GetBytesUsed();
 }
 
 // Put sim data array pointers in place
@@ -444,9 +662,11 @@ void DEMKinematicThread::packDataPointers() {
 
     // Mesh-related
     granData->ownerMesh = ownerMesh.data();
+    granData->triNodeOffset = triNodeOffset.data();
     granData->relPosNode1 = relPosNode1.data();
     granData->relPosNode2 = relPosNode2.data();
     granData->relPosNode3 = relPosNode3.data();
+    granData->triInBVH = triInBVH.data();
 
     // Template array pointers
     granData->radiiSphere = radiiSphere.data();
@@ -455,6 +675,65 @@ void DEMKinematicThread::packDataPointers() {
     granData->relPosSphereZ = relPosSphereZ.data();
 }
 
+void DEMKinematicThread::applyManagedMemHints() {
+    if (!solverFlags.useManagedMemHints) {
+        return;
+    }
+    const int device = streamInfo.device;
+    int concurrent_access = 0;
+    DEME_GPU_CALL(cudaDeviceGetAttribute(&concurrent_access, cudaDevAttrConcurrentManagedAccess, device));
+    if (!concurrent_access) {
+        return;
+    }
+    cudaStream_t stream = streamInfo.stream;
+    auto device_preferred = [&](auto& vec) {
+        advise(vec, ManagedAdvice::PREFERRED_LOC, device);
+        migrate(vec, device, stream);
+    };
+    auto read_mostly = [&](auto& vec) {
+        advise(vec, ManagedAdvice::READ_MOSTLY, device);
+        migrate(vec, device, stream);
+    };
+
+    device_preferred(voxelID);
+    device_preferred(locX);
+    device_preferred(locY);
+    device_preferred(locZ);
+    device_preferred(oriQw);
+    device_preferred(oriQx);
+    device_preferred(oriQy);
+    device_preferred(oriQz);
+    device_preferred(marginSize);
+    device_preferred(familyID);
+    device_preferred(idGeometryA);
+    device_preferred(idGeometryB);
+    device_preferred(contactType);
+    device_preferred(previous_idGeometryA);
+    device_preferred(previous_idGeometryB);
+    device_preferred(previous_contactType);
+    device_preferred(contactMapping);
+
+    read_mostly(radiiSphere);
+    read_mostly(relPosSphereX);
+    read_mostly(relPosSphereY);
+    read_mostly(relPosSphereZ);
+    read_mostly(relPosEntityX);
+    read_mostly(relPosEntityY);
+    read_mostly(relPosEntityZ);
+    read_mostly(oriEntityX);
+    read_mostly(oriEntityY);
+    read_mostly(oriEntityZ);
+    read_mostly(sizeEntity1);
+    read_mostly(sizeEntity2);
+    read_mostly(sizeEntity3);
+    read_mostly(ownerClumpBody);
+    read_mostly(ownerMesh);
+    read_mostly(clumpComponentOffset);
+    read_mostly(clumpComponentOffsetExt);
+    read_mostly(familyMaskMatrix);
+    read_mostly(familyExtraMarginSize);
+}
+
 void DEMKinematicThread::packTransferPointers(DEMDynamicThread*& dT) {
     // Set the pointers to dT owned buffers
     granData->pDTOwnedBuffer_nContactPairs = &(dT->granData->nContactPairs_buffer);
@@ -462,6 +741,9 @@ void DEMKinematicThread::packTransferPointers(DEMDynamicThread*& dT) {
     granData->pDTOwnedBuffer_idGeometryB = dT->granData->idGeometryB_buffer;
     granData->pDTOwnedBuffer_contactType = dT->granData->contactType_buffer;
     granData->pDTOwnedBuffer_contactMapping = dT->granData->contactMapping_buffer;
+    granData->pDTOwnedBuffer_nNewContacts = &(dT->granData->nNewContacts_buffer);
+    granData->pDTOwnedBuffer_newContactIdx = dT->granData->newContactIdx_buffer;
+    granData->pDTOwnedBuffer_contactClassOffsets = dT->granData->contactClassOffsets_buffer;
 }
 
 void DEMKinematicThread::setSimParams(unsigned char nvXp2,
@@ -519,6 +801,7 @@ void DEMKinematicThread::allocateManagedArrays(size_t nOwnerBodies,
                                                size_t nTriMeshes,
                                                size_t nSpheresGM,
                                                size_t nTriGM,
+                                               size_t nTriNodeGM,
                                                unsigned int nAnalGM,
                                                size_t nExtraContacts,
                                                unsigned int nMassProperties,
@@ -531,6 +814,7 @@ void DEMKinematicThread::allocateManagedArrays(size_t nOwnerBodies,
     // Sizes of these arrays
     simParams->nSpheresGM = nSpheresGM;
     simParams->nTriGM = nTriGM;
+    simParams->nTriNodeGM = nTriNodeGM;
     simParams->nAnalGM = nAnalGM;
     simParams->nOwnerBodies = nOwnerBodies;
     simParams->nOwnerClumps = nOwnerClumps;
@@ -595,9 +879,9 @@ void DEMKinematicThread::allocateManagedArrays(size_t nOwnerBodies,
             DEME_DEVICE_PTR_ALLOC(granData->familyID_buffer, nOwnerBodies);
         }
 
-        DEME_DEVICE_PTR_ALLOC(granData->relPosNode1_buffer, nTriGM);
-        DEME_DEVICE_PTR_ALLOC(granData->relPosNode2_buffer, nTriGM);
-        DEME_DEVICE_PTR_ALLOC(granData->relPosNode3_buffer, nTriGM);
+        DEME_DEVICE_PTR_ALLOC(granData->relPosNode1_buffer, nTriNodeGM);
+        DEME_DEVICE_PTR_ALLOC(granData->relPosNode2_buffer, nTriNodeGM);
+        DEME_DEVICE_PTR_ALLOC(granData->relPosNode3_buffer, nTriNodeGM);
 
         // Unset the device change we just did
         DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
@@ -608,9 +892,12 @@ void DEMKinematicThread::allocateManagedArrays(size_t nOwnerBodies,
 
     // Resize to the number of triangle facets
     DEME_TRACKED_RESIZE_DEBUGPRINT(ownerMesh, nTriGM, "ownerMesh", 0);
-    DEME_TRACKED_RESIZE_DEBUGPRINT(relPosNode1, nTriGM, "relPosNode1", make_float3(0));
-    DEME_TRACKED_RESIZE_DEBUGPRINT(relPosNode2, nTriGM, "relPosNode2", make_float3(0));
-    DEME_TRACKED_RESIZE_DEBUGPRINT(relPosNode3, nTriGM, "relPosNode3", make_float3(0));
+    DEME_TRACKED_RESIZE_DEBUGPRINT(triNodeOffset, nTriGM, "triNodeOffset", 0);
+    // Resize to the number of facets whose nodes are stored
+    DEME_TRACKED_RESIZE_DEBUGPRINT(relPosNode1, nTriNodeGM, "relPosNode1", make_float3(0));
+    DEME_TRACKED_RESIZE_DEBUGPRINT(relPosNode2, nTriNodeGM, "relPosNode2", make_float3(0));
+    DEME_TRACKED_RESIZE_DEBUGPRINT(relPosNode3, nTriNodeGM, "relPosNode3", make_float3(0));
+    DEME_TRACKED_RESIZE_DEBUGPRINT(triInBVH, nTriGM, "triInBVH", 0);
 
     if (solverFlags.useClumpJitify) {
         DEME_TRACKED_RESIZE_DEBUGPRINT(clumpComponentOffset, nSpheresGM, "clumpComponentOffset", 0);
@@ -634,9 +921,15 @@ void DEMKinematicThread::allocateManagedArrays(size_t nOwnerBodies,
     // The following several arrays will have variable sizes, so here we only used an estimate. My estimate of total
     // contact pairs is 2n, and I think the max is 6n (although I can't prove it). Note the estimate should be large
     // enough to decrease the number of reallocations in the simulation, but not too large that eats too much memory.
+    // Under a memory budget, the estimate is lowered to what the budget allows.
     {
-        size_t cnt_arr_size =
-            DEME_MAX(*stateOfSolver_resources.pNumPrevContacts, nSpheresGM * DEME_INIT_CNT_MULTIPLIER);
+        size_t bytes_per_cnt = 2 * sizeof(bodyID_t) + sizeof(contact_t);
+        if (!solverFlags.isHistoryless) {
+            bytes_per_cnt += 2 * sizeof(bodyID_t) + sizeof(contact_t) + sizeof(contactPairs_t);
+        }
+        size_t init_cnt_size = m_mem_registry.FitCount("contact arrays", nSpheresGM * DEME_INIT_CNT_MULTIPLIER,
+                                                       nSpheresGM, bytes_per_cnt, DEME_MEM_BUDGET_CNT_SHARE);
+        size_t cnt_arr_size = DEME_MAX(*stateOfSolver_resources.pNumPrevContacts, init_cnt_size);
         DEME_TRACKED_RESIZE_DEBUGPRINT(idGeometryA, cnt_arr_size, "idGeometryA", 0);
         DEME_TRACKED_RESIZE_DEBUGPRINT(idGeometryB, cnt_arr_size, "idGeometryB", 0);
         DEME_TRACKED_RESIZE_DEBUGPRINT(contactType, cnt_arr_size, "contactType", NOT_A_CONTACT);
@@ -658,8 +951,10 @@ void DEMKinematicThread::registerPolicies(const std::vector<notStupidBool_t>& fa
 void DEMKinematicThread::populateEntityArrays(const std::vector<std::shared_ptr<DEMClumpBatch>>& input_clump_batches,
                                               const std::vector<unsigned int>& input_ext_obj_family,
                                               const std::vector<unsigned int>& input_mesh_obj_family,
+                                              const std::vector<notStupidBool_t>& input_mesh_obj_use_bvh,
                                               const std::vector<unsigned int>& input_mesh_facet_owner,
                                               const std::vector<DEMTriangle>& input_mesh_facets,
+                                              const std::vector<bodyID_t>& input_mesh_facet_node_offsets,
                                               const ClumpTemplateFlatten& clump_templates,
                                               size_t nExistOwners,
                                               size_t nExistSpheres,
@@ -766,10 +1061,16 @@ void DEMKinematicThread::populateEntityArrays(const std::vector<std::shared_ptr<
             if (input_mesh_facet_owner.at(k) != this_facet_owner)
                 break;
             ownerMesh.at(nExistingFacets + k) = owner_offset_for_mesh_obj + this_facet_owner;
+            const bodyID_t node_offset = input_mesh_facet_node_offsets.at(k);
+            triNodeOffset.at(nExistingFacets + k) = node_offset;
             DEMTriangle this_tri = input_mesh_facets.at(k);
-            relPosNode1.at(nExistingFacets + k) = this_tri.p1;
-            relPosNode2.at(nExistingFacets + k) = this_tri.p2;
-            relPosNode3.at(nExistingFacets + k) = this_tri.p3;
+            relPosNode1.at(node_offset) = this_tri.p1;
+            relPosNode2.at(node_offset) = this_tri.p2;
+            relPosNode3.at(node_offset) = this_tri.p3;
+            triInBVH.at(nExistingFacets + k) = input_mesh_obj_use_bvh.at(i);
+        }
+        if (input_mesh_obj_use_bvh.at(i)) {
+            triangleBVH.needRebuild = true;
         }
 
         family_t this_family_num = input_mesh_obj_family.at(i);
@@ -782,8 +1083,10 @@ void DEMKinematicThread::populateEntityArrays(const std::vector<std::shared_ptr<
 void DEMKinematicThread::initManagedArrays(const std::vector<std::shared_ptr<DEMClumpBatch>>& input_clump_batches,
                                            const std::vector<unsigned int>& input_ext_obj_family,
                                            const std::vector<unsigned int>& input_mesh_obj_family,
+                                           const std::vector<notStupidBool_t>& input_mesh_obj_use_bvh,
                                            const std::vector<unsigned int>& input_mesh_facet_owner,
                                            const std::vector<DEMTriangle>& input_mesh_facets,
+                                           const std::vector<bodyID_t>& input_mesh_facet_node_offsets,
                                            const std::vector<notStupidBool_t>& family_mask_matrix,
                                            const ClumpTemplateFlatten& clump_templates) {
     // Get the info into the managed memory from the host side. Can this process be more efficient? Maybe, but it's
@@ -791,15 +1094,18 @@ void DEMKinematicThread::initManagedArrays(const std::vector<std::shared_ptr<DEM
 
     registerPolicies(family_mask_matrix);
 
-    populateEntityArrays(input_clump_batches, input_ext_obj_family, input_mesh_obj_family, input_mesh_facet_owner,
-                         input_mesh_facets, clump_templates, 0, 0, 0);
+    populateEntityArrays(input_clump_batches, input_ext_obj_family, input_mesh_obj_family, input_mesh_obj_use_bvh,
+                         input_mesh_facet_owner, input_mesh_facets, input_mesh_facet_node_offsets, clump_templates,
+                         0, 0, 0);
 }
 
 void DEMKinematicThread::updateClumpMeshArrays(const std::vector<std::shared_ptr<DEMClumpBatch>>& input_clump_batches,
                                                const std::vector<unsigned int>& input_ext_obj_family,
                                                const std::vector<unsigned int>& input_mesh_obj_family,
+                                               const std::vector<notStupidBool_t>& input_mesh_obj_use_bvh,
                                                const std::vector<unsigned int>& input_mesh_facet_owner,
                                                const std::vector<DEMTriangle>& input_mesh_facets,
+                                               const std::vector<bodyID_t>& input_mesh_facet_node_offsets,
                                                const std::vector<notStupidBool_t>& family_mask_matrix,
                                                const ClumpTemplateFlatten& clump_templates,
                                                size_t nExistingOwners,
@@ -809,52 +1115,101 @@ void DEMKinematicThread::updateClumpMeshArrays(const std::vector<std::shared_ptr
                                                size_t nExistingFacets,
                                                unsigned int nExistingObj,
                                                unsigned int nExistingAnalGM) {
-    populateEntityArrays(input_clump_batches, input_ext_obj_family, input_mesh_obj_family, input_mesh_facet_owner,
-                         input_mesh_facets, clump_templates, nExistingOwners, nExistingSpheres, nExistingFacets);
+    populateEntityArrays(input_clump_batches, input_ext_obj_family, input_mesh_obj_family, input_mesh_obj_use_bvh,
+                         input_mesh_facet_owner, input_mesh_facets, input_mesh_facet_node_offsets, clump_templates,
+                         nExistingOwners, nExistingSpheres, nExistingFacets);
+    contactListReusable = false;
+    fixedSphereBins.needRebuild = true;
 }
 
 void DEMKinematicThread::updatePrevContactArrays(DEMDataDT* dT_data, size_t nContacts) {
     // Store the incoming info in temp arrays
     overwritePrevContactArrays(granData, dT_data, previous_idGeometryA, previous_idGeometryB, previous_contactType,
-                               simParams, stateOfSolver_resources, streamInfo.stream, nContacts);
+                               simParams, solverFlags, stateOfSolver_resources, streamInfo.stream, nContacts);
+    // The contact mapping from the next contact detection refers to this user-loaded (and re-sorted) array, not to
+    // dT's arrays, so dT needs the entire contact array next time
+    contactDeltaBaseValid = false;
+    contactListReusable = false;
     DEME_DEBUG_PRINTF("Number of contacts after a user-manual contact load: %zu", nContacts);
     DEME_DEBUG_PRINTF("Number of spheres after a user-manual contact load: %zu", (size_t)simParams->nSpheresGM);
 }
 
+void DEMKinematicThread::reserveContactArrays(size_t nContactPairs) {
+    size_t bytes_per_cnt = 2 * sizeof(bodyID_t) + sizeof(contact_t);
+    if (!solverFlags.isHistoryless) {
+        bytes_per_cnt += 2 * sizeof(bodyID_t) + sizeof(contact_t) + sizeof(contactPairs_t);
+    }
+    // Never below what is there already, which fit the budget when it was allocated
+    nContactPairs = m_mem_registry.FitCount("contact arrays", nContactPairs, idGeometryA.size(), bytes_per_cnt,
+                                            DEME_MEM_BUDGET_CNT_SHARE);
+    if (nContactPairs > idGeometryA.size()) {
+        DEME_TRACKED_RESIZE_DEBUGPRINT(idGeometryA, nContactPairs, "idGeometryA", 0);
+        DEME_TRACKED_RESIZE_DEBUGPRINT(idGeometryB, nContactPairs, "idGeometryB", 0);
+        DEME_TRACKED_RESIZE_DEBUGPRINT(contactType, nContactPairs, "contactType", NOT_A_CONTACT);
+        granData->idGeometryA = idGeometryA.data();
+        granData->idGeometryB = idGeometryB.data();
+        granData->contactType = contactType.data();
+    }
+    // The contact detection shrinks these to the number of contacts it finds, but their capacity stays
+    if (!solverFlags.isHistoryless && nContactPairs > contactMapping.size()) {
+        DEME_TRACKED_RESIZE_DEBUGPRINT(previous_idGeometryA, nContactPairs, "previous_idGeometryA", 0);
+        DEME_TRACKED_RESIZE_DEBUGPRINT(previous_idGeometryB, nContactPairs, "previous_idGeometryB", 0);
+        DEME_TRACKED_RESIZE_DEBUGPRINT(previous_contactType, nContactPairs, "previous_contactType", NOT_A_CONTACT);
+        DEME_TRACKED_RESIZE_DEBUGPRINT(contactMapping, nContactPairs, "contactMapping", NULL_MAPPING_PARTNER);
+        granData->previous_idGeometryA = previous_idGeometryA.data();
+        granData->previous_idGeometryB = previous_idGeometryB.data();
+        granData->previous_contactType = previous_contactType.data();
+        granData->contactMapping = contactMapping.data();
+    }
+    if (nContactPairs > dT->buffer_size) {
+        transferArraysResize(nContactPairs);
+    }
+    DEME_DEBUG_PRINTF("kT contact arrays are sized for %zu contacts.", nContactPairs);
+}
+
 void DEMKinematicThread::jitifyKernels(const std::unordered_map<std::string, std::string>& Subs) {
+    // These programs do not depend on each other, so they are built concurrently, each on its own host thread. If this
+    // is a re-jitification, the programs whose substituted sources did not change are kept as they are.
+    const int dev = streamInfo.device;
     // First one is bin_sphere_kernels kernels, which figure out the bin--sphere touch pairs
-    {
-        bin_sphere_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
-            "DEMBinSphereKernels", JitHelper::KERNEL_DIR / "DEMBinSphereKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
-    }
+    auto bin_sphere_future =
+        JitHelper::updateProgramAsync(bin_sphere_kernels, dev, "DEMBinSphereKernels",
+                                      JitHelper::KERNEL_DIR / "DEMBinSphereKernels.cu", Subs, DEME_JITIFY_OPTIONS);
     // Then CD kernels
-    {
-        sphere_contact_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
-            "DEMContactKernels_SphereSphere", JitHelper::KERNEL_DIR / "DEMContactKernels_SphereSphere.cu", Subs,
-            DEME_JITIFY_OPTIONS)));
-    }
+    auto sphere_contact_future = JitHelper::updateProgramAsync(
+        sphere_contact_kernels, dev, "DEMContactKernels_SphereSphere",
+        JitHelper::KERNEL_DIR / "DEMContactKernels_SphereSphere.cu", Subs, DEME_JITIFY_OPTIONS);
     // Then triangle--bin intersection-related kernels
-    {
-        bin_triangle_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
-            "DEMBinTriangleKernels", JitHelper::KERNEL_DIR / "DEMBinTriangleKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
-    }
+    auto bin_triangle_future =
+        JitHelper::updateProgramAsync(bin_triangle_kernels, dev, "DEMBinTriangleKernels",
+                                      JitHelper::KERNEL_DIR / "DEMBinTriangleKernels.cu", Subs, DEME_JITIFY_OPTIONS);
     // Then sphere--triangle contact detection-related kernels
-    {
-        sphTri_contact_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
-            "DEMContactKernels_SphereTriangle", JitHelper::KERNEL_DIR / "DEMContactKernels_SphereTriangle.cu", Subs,
-            DEME_JITIFY_OPTIONS)));
-    }
+    auto sphTri_contact_future = JitHelper::updateProgramAsync(
+        sphTri_contact_kernels, dev, "DEMContactKernels_SphereTriangle",
+        JitHelper::KERNEL_DIR / "DEMContactKernels_SphereTriangle.cu", Subs, DEME_JITIFY_OPTIONS);
     // Then contact history mapping kernels
-    {
-        history_kernels = std::make_shared<jitify::Program>(std::move(
-            JitHelper::buildProgram("DEMHistoryMappingKernels", JitHelper::KERNEL_DIR / "DEMHistoryMappingKernels.cu",
-                                    Subs, DEME_JITIFY_OPTIONS)));
-    }
+    auto history_future = JitHelper::updateProgramAsync(history_kernels, dev, "DEMHistoryMappingKernels",
+                                                        JitHelper::KERNEL_DIR / "DEMHistoryMappingKernels.cu", Subs,
+                                                        DEME_JITIFY_OPTIONS);
     // Then misc kernels
-    {
-        misc_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
-            "DEMMiscKernels", JitHelper::KERNEL_DIR / "DEMMiscKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
-    }
+    auto misc_future = JitHelper::updateProgramAsync(misc_kernels, dev, "DEMMiscKernels",
+                                                     JitHelper::KERNEL_DIR / "DEMMiscKernels.cu", Subs,
+                                                     DEME_JITIFY_OPTIONS);
+
+    unsigned int n_built = 0, n_rebuilt = 0;
+    auto collect = [&](std::shared_ptr<JitProgram>& prog, std::future<std::shared_ptr<JitProgram>>& fut) {
+        std::shared_ptr<JitProgram> res = fut.get();
+        n_built++;
+        n_rebuilt += (res != prog);
+        prog = res;
+    };
+    collect(bin_sphere_kernels, bin_sphere_future);
+    collect(sphere_contact_kernels, sphere_contact_future);
+    collect(bin_triangle_kernels, bin_triangle_future);
+    collect(sphTri_contact_kernels, sphTri_contact_future);
+    collect(history_kernels, history_future);
+    collect(misc_kernels, misc_future);
+    DEME_DEBUG_PRINTF("kT jitified %u of its %u programs (the rest are unchanged).", n_rebuilt, n_built);
 }
 
 void DEMKinematicThread::initAllocation() {
@@ -866,6 +1221,7 @@ void DEMKinematicThread::deallocateEverything() {
     DEME_DEVICE_PTR_DEALLOC(dT->granData->idGeometryB_buffer);
     DEME_DEVICE_PTR_DEALLOC(dT->granData->contactType_buffer);
     DEME_DEVICE_PTR_DEALLOC(dT->granData->contactMapping_buffer);
+    DEME_DEVICE_PTR_DEALLOC(dT->granData->newContactIdx_buffer);
 
     DEME_DEVICE_PTR_DEALLOC(granData->voxelID_buffer);
     DEME_DEVICE_PTR_DEALLOC(granData->locX_buffer);
@@ -886,18 +1242,22 @@ void DEMKinematicThread::deallocateEverything() {
 
 void DEMKinematicThread::setTriNodeRelPos(size_t start, const std::vector<DEMTriangle>& triangles) {
     for (size_t i = 0; i < triangles.size(); i++) {
-        relPosNode1[start + i] = triangles[i].p1;
-        relPosNode2[start + i] = triangles[i].p2;
-        relPosNode3[start + i] = triangles[i].p3;
+        const bodyID_t node = triNodeOffset[start + i];
+        relPosNode1[node] = triangles[i].p1;
+        relPosNode2[node] = triangles[i].p2;
+        relPosNode3[node] = triangles[i].p3;
     }
+    contactListReusable = false;
 }
 
 void DEMKinematicThread::updateTriNodeRelPos(size_t start, const std::vector<DEMTriangle>& updates) {
     for (size_t i = 0; i < updates.size(); i++) {
-        relPosNode1[start + i] += updates[i].p1;
-        relPosNode2[start + i] += updates[i].p2;
-        relPosNode3[start + i] += updates[i].p3;
+        const bodyID_t node = triNodeOffset[start + i];
+        relPosNode1[node] += updates[i].p1;
+        relPosNode2[node] += updates[i].p2;
+        relPosNode3[node] += updates[i].p3;
     }
+    contactListReusable = false;
 }
 
 }  // namespace deme
@@ -7,6 +7,7 @@
 #define DEME_KT
 
 #include <mutex>
+#include <deque>
 #include <vector>
 #include <thread>
 #include <unordered_map>
@@ -26,10 +27,8 @@
 
 // #include <core/utils/JitHelper.h>
 
-// Forward declare jitify::Program to avoid downstream dependency
-namespace jitify {
-class Program;
-}
+// Forward declare JitProgram to avoid downstream dependency
+class JitProgram;
 
 namespace deme {
 
@@ -59,10 +58,19 @@ class DEMKinematicThread {
     // Object which stores the device and stream IDs for this thread
     GpuManager::StreamInfo streamInfo;
 
+    // Recorded on my stream after I queue copies to my friend's buffer, and after I queue copies out of my own buffer,
+    // respectively. The friend thread makes its stream wait on them, so buffer exchange needs no lock or host sync.
+    cudaEvent_t bufferSentEvent;
+    cudaEvent_t bufferUnpackedEvent;
+
+    // Ranges [first, last) of mesh nodes that dT sent to my buffer and I have not unpacked yet
+    std::vector<std::pair<size_t, size_t>> meshNodeDirtyRanges;
+
     // A class that contains scratch pad and system status data (constructed with the number of temp arrays we need)
-    DEMSolverStateData stateOfSolver_resources = DEMSolverStateData(15);
+    DEMSolverStateData stateOfSolver_resources = DEMSolverStateData(17);
 
-    size_t m_approx_bytes_used = 0;
+    // Sizes of the arrays (and scratch space) this thread allocated, checked against the memory budget if any
+    DEMMemoryRegistry m_mem_registry;
 
     // kT should break out of its inner loop and return to a state where it awaits a `start' call at the outer loop
     bool kTShouldReset = false;
@@ -111,9 +119,15 @@ class DEMKinematicThread {
 
     // Triangles (templates) are given a special place (unlike other analytical shapes), b/c we expect them to appear
     // frequently as meshes.
+    // Facets of instances of one mesh share their nodes, so each facet finds its nodes through triNodeOffset
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> triNodeOffset;
     std::vector<float3, ManagedAllocator<float3>> relPosNode1;
     std::vector<float3, ManagedAllocator<float3>> relPosNode2;
     std::vector<float3, ManagedAllocator<float3>> relPosNode3;
+    // If this facet's contacts with spheres are found by querying its mesh's BVH, instead of through the bins
+    std::vector<notStupidBool_t, ManagedAllocator<notStupidBool_t>> triInBVH;
+    // The BVHs of the meshes that use BVH-based contact detection
+    DEMTriangleBVH triangleBVH;
 
     // External object's components may need the following arrays to store some extra defining features of them. We
     // assume there are usually not too many of them in a simulation.
@@ -142,10 +156,10 @@ class DEMKinematicThread {
     std::vector<subVoxelPos_t, ManagedAllocator<subVoxelPos_t>> locZ;
 
     // The clump quaternion
-    std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQw;
-    std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQx;
-    std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQy;
-    std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQz;
+    std::vector<oriQStore_t, ManagedAllocator<oriQStore_t>> oriQw;
+    std::vector<oriQStore_t, ManagedAllocator<oriQStore_t>> oriQx;
+    std::vector<oriQStore_t, ManagedAllocator<oriQStore_t>> oriQy;
+    std::vector<oriQStore_t, ManagedAllocator<oriQStore_t>> oriQz;
 
     // dT-supplied system velocity
     std::vector<float, ManagedAllocator<float>> marginSize;
@@ -173,6 +187,26 @@ class DEMKinematicThread {
     std::vector<contact_t, ManagedAllocator<contact_t>> previous_contactType;
     std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>> contactMapping;
 
+    // In delta-encoded contact transfer, the contacts new to this update and where they are in the contact array
+    std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>> newContactIdx;
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> newContact_idGeometryA;
+    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> newContact_idGeometryB;
+    std::vector<contact_t, ManagedAllocator<contact_t>> newContact_contactType;
+    // Whether dT's contact arrays are the ones I shipped last time, so a delta against them can be sent. It is not the
+    // case when contacts are loaded manually by the user.
+    bool contactDeltaBaseValid = false;
+
+    // Owner states at the last contact detection that actually ran, for telling if its contact list can be reused
+    std::vector<double3, ManagedAllocator<double3>> lastCD_ownerPos;
+    std::vector<float4, ManagedAllocator<float4>> lastCD_ownerOriQ;
+    std::vector<float, ManagedAllocator<float>> lastCD_marginSize;
+    std::vector<family_t, ManagedAllocator<family_t>> lastCD_familyID;
+    // Whether the last contact list is a candidate for reuse at all. Changes that the owner states do not show (sphere
+    // sizes, mesh shapes, user-loaded contacts...) void it.
+    bool contactListReusable = false;
+    // Bin touches of the spheres of fixed families, reused across contact detections
+    DEMFixedSphereBinCache fixedSphereBins;
+
     // Sphere-related arrays in managed memory
     // Owner body ID of this component
     std::vector<bodyID_t, ManagedAllocator<bodyID_t>> ownerClumpBody;
@@ -190,8 +224,19 @@ class DEMKinematicThread {
     std::vector<std::string> timer_names = {"Discretize domain",      "Find contact pairs", "Build history map",
                                             "Unpack updates from dT", "Send to dT buffer",  "Wait for dT update"};
     SolverTimers timers = SolverTimers(timer_names);
+    // Event-based timer of contact detection, used by the cost-model drift controller
+    SolverTimer cdCostTimer;
+    double cdCostTimerTotal = 0.;
 
     kTStateParams stateParams;
+    // The most recent bin size changes. The performance report may read them while kT runs, hence the lock.
+    std::deque<DEMBinSizeRecord> binSizeHistory;
+    std::mutex binSizeHistoryMutex;
+    // The bin occupancy profiler, and the latest profile it took (read by the main thread, hence the lock)
+    DEMBinProfiler binProfiler;
+    unsigned int nCDsSinceBinProfile = 0;
+    DEMBinOccupancyProfile binProfile;
+    std::mutex binProfileMutex;
 
   public:
     friend class DEMSolver;
@@ -204,6 +249,10 @@ class DEMKinematicThread {
 
         // Get a device/stream ID to use from the GPU Manager
         streamInfo = pGpuDistributor->getAvailableStream();
+        createExchangeEvents();
+
+        m_mem_registry.SetLabel("kT");
+        stateOfSolver_resources.memRegistry = &m_mem_registry;
 
         pPagerToMain->userCallDone = false;
         pSchedSupport->kinematicShouldJoin = false;
@@ -228,6 +277,8 @@ class DEMKinematicThread {
         th.join();
 
         cudaStreamDestroy(streamInfo.stream);
+        cudaEventDestroy(bufferSentEvent);
+        cudaEventDestroy(bufferUnpackedEvent);
 
         deallocateEverything();
 
@@ -262,6 +313,7 @@ class DEMKinematicThread {
                                size_t nTriMeshes,
                                size_t nSpheresGM,
                                size_t nTriGM,
+                               size_t nTriNodeGM,
                                unsigned int nAnalGM,
                                size_t nExtraContacts,
                                unsigned int nMassProperties,
@@ -275,8 +327,10 @@ class DEMKinematicThread {
     void populateEntityArrays(const std::vector<std::shared_ptr<DEMClumpBatch>>& input_clump_batches,
                               const std::vector<unsigned int>& input_ext_obj_family,
                               const std::vector<unsigned int>& input_mesh_obj_family,
+                              const std::vector<notStupidBool_t>& input_mesh_obj_use_bvh,
                               const std::vector<unsigned int>& input_mesh_facet_owner,
                               const std::vector<DEMTriangle>& input_mesh_facets,
+                              const std::vector<bodyID_t>& input_mesh_facet_node_offsets,
                               const ClumpTemplateFlatten& clump_templates,
                               size_t nExistOwners,
                               size_t nExistSpheres,
@@ -286,8 +340,10 @@ class DEMKinematicThread {
     void initManagedArrays(const std::vector<std::shared_ptr<DEMClumpBatch>>& input_clump_batches,
                            const std::vector<unsigned int>& input_ext_obj_family,
                            const std::vector<unsigned int>& input_mesh_obj_family,
+                           const std::vector<notStupidBool_t>& input_mesh_obj_use_bvh,
                            const std::vector<unsigned int>& input_mesh_facet_owner,
                            const std::vector<DEMTriangle>& input_mesh_facets,
+                           const std::vector<bodyID_t>& input_mesh_facet_node_offsets,
                            const std::vector<notStupidBool_t>& family_mask_matrix,
                            const ClumpTemplateFlatten& clump_templates);
 
@@ -296,8 +352,10 @@ class DEMKinematicThread {
     void updateClumpMeshArrays(const std::vector<std::shared_ptr<DEMClumpBatch>>& input_clump_batches,
                                const std::vector<unsigned int>& input_ext_obj_family,
                                const std::vector<unsigned int>& input_mesh_obj_family,
+                               const std::vector<notStupidBool_t>& input_mesh_obj_use_bvh,
                                const std::vector<unsigned int>& input_mesh_facet_owner,
                                const std::vector<DEMTriangle>& input_mesh_facets,
+                               const std::vector<bodyID_t>& input_mesh_facet_node_offsets,
                                const std::vector<notStupidBool_t>& family_mask_matrix,
                                const ClumpTemplateFlatten& clump_templates,
                                size_t nExistingOwners,
@@ -333,6 +391,8 @@ class DEMKinematicThread {
 
     // Put sim data array pointers in place
     void packDataPointers();
+    // Tag managed arrays as device-preferred or read-mostly, and prefetch them to the device
+    void applyManagedMemHints();
     void packTransferPointers(DEMDynamicThread*& dT);
 
     /// Return timing inforation for this current run
@@ -363,14 +423,26 @@ class DEMKinematicThread {
 
     /// Update (overwrite) kT's previous contact array based on input
     void updatePrevContactArrays(DEMDataDT* dT_data, size_t nContacts);
+    /// Grow the contact arrays, and dT's buffers that kT sends contacts to, to hold at least this many contacts
+    void reserveContactArrays(size_t nContactPairs);
 
   private:
     const std::string Name = "kT";
 
     // Bring kT buffer array data to its working arrays
     inline void unpackMyBuffer();
+    // Create the events used in buffer exchange, on the device of this thread
+    void createExchangeEvents();
     // Send produced data to dT-owned biffers
     void sendToTheirBuffer();
+    // Queue a copy from my device to a dT-owned buffer: a peer copy if dT is on another device with peer access
+    void copyToTheirBuffer(void* dst, const void* src, size_t bytes);
+    // Whether the contact list from the last contact detection is still good for this update
+    bool contactListStillValid();
+    // Record owner states after a contact detection, as the reference for later contact list reuse checks
+    void recordStatesAtCD();
+    // Skip contact detection and hand the last contact list to dT again
+    void reuseContactList();
     // Resize dT's buffer arrays based on the number of contact pairs
     inline void transferArraysResize(size_t nContactPairs);
     // Automatic adjustments to sim params
@@ -381,13 +453,13 @@ class DEMKinematicThread {
     void deallocateEverything();
 
     // Just-in-time compiled kernels
-    // jitify::Program bin_sphere_kernels = JitHelper::buildProgram("bin_sphere_kernels", " ");
-    std::shared_ptr<jitify::Program> bin_sphere_kernels;
-    std::shared_ptr<jitify::Program> bin_triangle_kernels;
-    std::shared_ptr<jitify::Program> sphTri_contact_kernels;
-    std::shared_ptr<jitify::Program> sphere_contact_kernels;
-    std::shared_ptr<jitify::Program> history_kernels;
-    std::shared_ptr<jitify::Program> misc_kernels;
+    // JitProgram bin_sphere_kernels = JitHelper::buildProgram("bin_sphere_kernels", " ");
+    std::shared_ptr<JitProgram> bin_sphere_kernels;
+    std::shared_ptr<JitProgram> bin_triangle_kernels;
+    std::shared_ptr<JitProgram> sphTri_contact_kernels;
+    std::shared_ptr<JitProgram> sphere_contact_kernels;
+    std::shared_ptr<JitProgram> history_kernels;
+    std::shared_ptr<JitProgram> misc_kernels;
 
     // Adjuster for bin size
     class AccumTimer {
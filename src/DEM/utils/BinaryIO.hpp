@@ -0,0 +1,268 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// A small, self-describing, columnar binary format for sphere, clump and contact output files, and its reader.
+//
+// Layout (all integers are little-endian, as written by the host):
+//   char[8]   magic "DEMEBIN"
+//   uint32    format version
+//   uint32    number of columns
+//   uint64    number of rows
+//   For each column (header part):
+//     uint32  name length, then the name (no terminating null)
+//     uint8   data type (see BINARY_COL_TYPE)
+//     uint32  number of dictionary entries (only STRING_ID columns have a non-empty dictionary)
+//     For each dictionary entry: uint32 length, then the string
+//   For each column (data part), in the same order as the header:
+//     number of rows * sizeof(data type) bytes
+
+#ifndef DEME_BINARY_IO_HPP
+#define DEME_BINARY_IO_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace deme {
+
+const char DEME_BINARY_OUTPUT_MAGIC[8] = {'D', 'E', 'M', 'E', 'B', 'I', 'N', '\0'};
+const uint32_t DEME_BINARY_OUTPUT_VERSION = 1;
+
+// Data types a column in a binary output file can have. STRING_ID columns store uint32 indices into the column's own
+// dictionary, and are used for clump type names and contact type names.
+enum class BINARY_COL_TYPE : uint8_t { FLOAT32 = 0, UINT32 = 1, UINT8 = 2, STRING_ID = 3 };
+
+inline size_t binaryColTypeSize(BINARY_COL_TYPE type) {
+    switch (type) {
+        case (BINARY_COL_TYPE::FLOAT32):
+            return sizeof(float);
+        case (BINARY_COL_TYPE::UINT32):
+        case (BINARY_COL_TYPE::STRING_ID):
+            return sizeof(uint32_t);
+        case (BINARY_COL_TYPE::UINT8):
+            return sizeof(uint8_t);
+        default:
+            throw std::runtime_error("Unknown column data type in binary output file.");
+    }
+}
+
+/// One column of a binary output table. Its data is a contiguous byte block, so it can be written in one go.
+class DEMBinaryColumn {
+  public:
+    std::string name;
+    BINARY_COL_TYPE type;
+    std::vector<char> bytes;
+    // Only used by STRING_ID columns
+    std::vector<std::string> dictionary;
+
+    DEMBinaryColumn(const std::string& col_name, BINARY_COL_TYPE col_type) : name(col_name), type(col_type) {}
+
+    size_t Size() const { return bytes.size() / binaryColTypeSize(type); }
+    void Reserve(size_t n) { bytes.reserve(n * binaryColTypeSize(type)); }
+
+    template <typename T>
+    void Push(T val) {
+        size_t offset = bytes.size();
+        bytes.resize(offset + sizeof(T));
+        std::memcpy(bytes.data() + offset, &val, sizeof(T));
+    }
+    /// Push a string to a STRING_ID column. The string is registered in the dictionary of this column if it is new.
+    void PushString(const std::string& str) {
+        auto it = dictionary_lookup.find(str);
+        uint32_t id;
+        if (it == dictionary_lookup.end()) {
+            id = dictionary.size();
+            dictionary.push_back(str);
+            dictionary_lookup[str] = id;
+        } else {
+            id = it->second;
+        }
+        Push<uint32_t>(id);
+    }
+
+    template <typename T>
+    T At(size_t i) const {
+        T val;
+        std::memcpy(&val, bytes.data() + i * sizeof(T), sizeof(T));
+        return val;
+    }
+
+  private:
+    std::unordered_map<std::string, uint32_t> dictionary_lookup;
+};
+
+/// A columnar table that can be written to, or read from a DEME binary output file.
+class DEMBinaryTable {
+  public:
+    std::vector<DEMBinaryColumn> columns;
+
+    DEMBinaryTable() {}
+    ~DEMBinaryTable() {}
+
+    /// Add a column and return its index
+    unsigned int AddColumn(const std::string& name, BINARY_COL_TYPE type) {
+        columns.emplace_back(name, type);
+        return columns.size() - 1;
+    }
+    DEMBinaryColumn& Col(unsigned int i) { return columns.at(i); }
+
+    /// Whether a column with this name exists
+    bool HasColumn(const std::string& name) const {
+        for (const auto& col : columns) {
+            if (col.name == name)
+                return true;
+        }
+        return false;
+    }
+    /// Get the column with this name
+    const DEMBinaryColumn& GetColumn(const std::string& name) const {
+        for (const auto& col : columns) {
+            if (col.name == name)
+                return col;
+        }
+        throw std::runtime_error("Column " + name + " does not exist in this binary output table.");
+    }
+    /// Number of rows in this table
+    size_t NumRows() const { return columns.empty() ? 0 : columns.at(0).Size(); }
+
+    /// Get a FLOAT32 column as a vector
+    std::vector<float> GetFloatColumn(const std::string& name) const {
+        return getTypedColumn<float>(name, BINARY_COL_TYPE::FLOAT32);
+    }
+    /// Get a UINT32 or UINT8 column as a vector
+    std::vector<uint32_t> GetUintColumn(const std::string& name) const {
+        const auto& col = GetColumn(name);
+        if (col.type != BINARY_COL_TYPE::UINT32 && col.type != BINARY_COL_TYPE::UINT8) {
+            throw std::runtime_error("Column " + name +
+                                     " in this binary output table is not an unsigned integer column.");
+        }
+        std::vector<uint32_t> res(col.Size());
+        for (size_t i = 0; i < res.size(); i++) {
+            res[i] = (col.type == BINARY_COL_TYPE::UINT8) ? col.At<uint8_t>(i) : col.At<uint32_t>(i);
+        }
+        return res;
+    }
+    /// Get a STRING_ID column, with the IDs converted back to strings
+    std::vector<std::string> GetStringColumn(const std::string& name) const {
+        const auto& col = GetColumn(name);
+        if (col.type != BINARY_COL_TYPE::STRING_ID) {
+            throw std::runtime_error("Column " + name + " in this binary output table is not a string column.");
+        }
+        std::vector<std::string> res(col.Size());
+        for (size_t i = 0; i < res.size(); i++) {
+            res[i] = col.dictionary.at(col.At<uint32_t>(i));
+        }
+        return res;
+    }
+
+    /// Write this table to a binary stream
+    void Write(std::ofstream& file) const {
+        uint64_t nRows = NumRows();
+        for (const auto& col : columns) {
+            if (col.Size() != nRows) {
+                throw std::runtime_error("Column " + col.name + " has a different length than other columns.");
+            }
+        }
+        file.write(DEME_BINARY_OUTPUT_MAGIC, sizeof(DEME_BINARY_OUTPUT_MAGIC));
+        writePOD<uint32_t>(file, DEME_BINARY_OUTPUT_VERSION);
+        writePOD<uint32_t>(file, columns.size());
+        writePOD<uint64_t>(file, nRows);
+        for (const auto& col : columns) {
+            writeString(file, col.name);
+            writePOD<uint8_t>(file, static_cast<uint8_t>(col.type));
+            writePOD<uint32_t>(file, col.dictionary.size());
+            for (const auto& str : col.dictionary) {
+                writeString(file, str);
+            }
+        }
+        for (const auto& col : columns) {
+            file.write(col.bytes.data(), col.bytes.size());
+        }
+    }
+
+    /// Read a binary output file into a table
+    static DEMBinaryTable Read(const std::string& filename) {
+        std::ifstream file(filename, std::ios::in | std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Binary output file " + filename + " cannot be opened.");
+        }
+        char magic[sizeof(DEME_BINARY_OUTPUT_MAGIC)];
+        file.read(magic, sizeof(magic));
+        if (!file || std::memcmp(magic, DEME_BINARY_OUTPUT_MAGIC, sizeof(magic)) != 0) {
+            throw std::runtime_error("File " + filename + " is not a DEME binary output file.");
+        }
+        uint32_t version = readPOD<uint32_t>(file);
+        if (version > DEME_BINARY_OUTPUT_VERSION) {
+            throw std::runtime_error("File " + filename + " has binary format version " + std::to_string(version) +
+                                     ", which is newer than what this reader supports (" +
+                                     std::to_string(DEME_BINARY_OUTPUT_VERSION) + ").");
+        }
+        uint32_t nCols = readPOD<uint32_t>(file);
+        uint64_t nRows = readPOD<uint64_t>(file);
+        DEMBinaryTable table;
+        for (uint32_t i = 0; i < nCols; i++) {
+            std::string name = readString(file);
+            BINARY_COL_TYPE type = static_cast<BINARY_COL_TYPE>(readPOD<uint8_t>(file));
+            unsigned int j = table.AddColumn(name, type);
+            uint32_t nDict = readPOD<uint32_t>(file);
+            for (uint32_t k = 0; k < nDict; k++) {
+                table.Col(j).dictionary.push_back(readString(file));
+            }
+        }
+        for (auto& col : table.columns) {
+            col.bytes.resize(nRows * binaryColTypeSize(col.type));
+            file.read(col.bytes.data(), col.bytes.size());
+        }
+        if (!file) {
+            throw std::runtime_error("Binary output file " + filename + " is truncated.");
+        }
+        return table;
+    }
+
+  private:
+    template <typename T>
+    std::vector<T> getTypedColumn(const std::string& name, BINARY_COL_TYPE type) const {
+        const auto& col = GetColumn(name);
+        // Same-size types (such as FLOAT32 and UINT32) must not be reinterpreted as each other
+        if (col.type != type) {
+            throw std::runtime_error("Column " + name + " in this binary output table has a different data type.");
+        }
+        std::vector<T> res(col.Size());
+        std::memcpy(res.data(), col.bytes.data(), col.bytes.size());
+        return res;
+    }
+
+    template <typename T>
+    static void writePOD(std::ofstream& file, T val) {
+        file.write(reinterpret_cast<const char*>(&val), sizeof(T));
+    }
+    static void writeString(std::ofstream& file, const std::string& str) {
+        writePOD<uint32_t>(file, str.size());
+        file.write(str.data(), str.size());
+    }
+    template <typename T>
+    static T readPOD(std::ifstream& file) {
+        T val;
+        file.read(reinterpret_cast<char*>(&val), sizeof(T));
+        if (!file) {
+            throw std::runtime_error("Binary output file is truncated.");
+        }
+        return val;
+    }
+    static std::string readString(std::ifstream& file) {
+        uint32_t len = readPOD<uint32_t>(file);
+        std::string str(len, '\0');
+        file.read(&str[0], len);
+        return str;
+    }
+};
+
+}  // namespace deme
+
+#endif
@@ -0,0 +1,201 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// The binary checkpoint file format, and its writer and reader. A checkpoint is a set of named sections, each a raw
+// copy of one solver array (or one value). The section table has fixed-size entries and every section starts at an
+// aligned offset, so the file can be memory-mapped, and an array can be used right where it is in the file.
+//
+// Layout (all integers are little-endian, as written by the host):
+//   char[8]   magic "DEMECKP"
+//   uint32    format version
+//   uint32    number of sections
+//   For each section:
+//     char[DEME_CHECKPOINT_NAME_LEN]  name, padded with nulls
+//     uint64  number of bytes
+//     uint64  offset of the data from the start of the file (a multiple of DEME_CHECKPOINT_ALIGNMENT)
+//   Section data, in the same order, with padding in between
+
+#ifndef DEME_CHECKPOINT_HPP
+#define DEME_CHECKPOINT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace deme {
+
+const char DEME_CHECKPOINT_MAGIC[8] = {'D', 'E', 'M', 'E', 'C', 'K', 'P', '\0'};
+const uint32_t DEME_CHECKPOINT_VERSION = 1;
+const size_t DEME_CHECKPOINT_NAME_LEN = 64;
+const size_t DEME_CHECKPOINT_ALIGNMENT = 64;
+
+/// Collects sections in memory, then writes them to a checkpoint file.
+class DEMCheckpointWriter {
+  public:
+    DEMCheckpointWriter() {}
+    ~DEMCheckpointWriter() {}
+
+    /// Add a section of this many bytes and return its buffer, for the caller to fill
+    char* AddSection(const std::string& name, size_t bytes) {
+        if (name.size() >= DEME_CHECKPOINT_NAME_LEN) {
+            throw std::runtime_error("Checkpoint section name " + name + " is too long.");
+        }
+        if (lookup.find(name) != lookup.end()) {
+            throw std::runtime_error("Checkpoint section " + name + " is added twice.");
+        }
+        lookup[name] = sections.size();
+        sections.push_back({name, std::vector<char>(bytes)});
+        return sections.back().bytes.data();
+    }
+    /// Add a section that holds one value
+    template <typename T>
+    void AddValue(const std::string& name, const T& val) {
+        std::memcpy(AddSection(name, sizeof(T)), &val, sizeof(T));
+    }
+
+    void Write(const std::string& filename) const {
+        std::ofstream file(filename, std::ios::out | std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Checkpoint file " + filename + " cannot be opened for writing.");
+        }
+        file.write(DEME_CHECKPOINT_MAGIC, sizeof(DEME_CHECKPOINT_MAGIC));
+        writePOD<uint32_t>(file, DEME_CHECKPOINT_VERSION);
+        writePOD<uint32_t>(file, sections.size());
+        uint64_t offset = alignUp(sizeof(DEME_CHECKPOINT_MAGIC) + 2 * sizeof(uint32_t) +
+                                  sections.size() * (DEME_CHECKPOINT_NAME_LEN + 2 * sizeof(uint64_t)));
+        std::vector<uint64_t> offsets;
+        for (const auto& sec : sections) {
+            char name[DEME_CHECKPOINT_NAME_LEN] = {0};
+            std::memcpy(name, sec.name.data(), sec.name.size());
+            file.write(name, sizeof(name));
+            writePOD<uint64_t>(file, sec.bytes.size());
+            writePOD<uint64_t>(file, offset);
+            offsets.push_back(offset);
+            offset = alignUp(offset + sec.bytes.size());
+        }
+        for (size_t i = 0; i < sections.size(); i++) {
+            padTo(file, offsets[i]);
+            file.write(sections[i].bytes.data(), sections[i].bytes.size());
+        }
+        if (!file) {
+            throw std::runtime_error("Failed to write checkpoint file " + filename + ".");
+        }
+    }
+
+  private:
+    struct Section {
+        std::string name;
+        std::vector<char> bytes;
+    };
+    std::vector<Section> sections;
+    std::unordered_map<std::string, size_t> lookup;
+
+    static uint64_t alignUp(uint64_t n) {
+        return (n + DEME_CHECKPOINT_ALIGNMENT - 1) / DEME_CHECKPOINT_ALIGNMENT * DEME_CHECKPOINT_ALIGNMENT;
+    }
+    static void padTo(std::ofstream& file, uint64_t offset) {
+        const char zeros[DEME_CHECKPOINT_ALIGNMENT] = {0};
+        uint64_t pos = file.tellp();
+        if (pos < offset) {
+            file.write(zeros, offset - pos);
+        }
+    }
+    template <typename T>
+    static void writePOD(std::ofstream& file, T val) {
+        file.write(reinterpret_cast<const char*>(&val), sizeof(T));
+    }
+};
+
+/// Reads the section table of a checkpoint file on construction; the sections are then read on demand.
+class DEMCheckpointReader {
+  public:
+    DEMCheckpointReader(const std::string& file_name) : filename(file_name) {
+        file.open(filename, std::ios::in | std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Checkpoint file " + filename + " cannot be opened.");
+        }
+        char magic[sizeof(DEME_CHECKPOINT_MAGIC)];
+        file.read(magic, sizeof(magic));
+        if (!file || std::memcmp(magic, DEME_CHECKPOINT_MAGIC, sizeof(magic)) != 0) {
+            throw std::runtime_error("File " + filename + " is not a DEME checkpoint file.");
+        }
+        uint32_t version = readPOD<uint32_t>();
+        if (version > DEME_CHECKPOINT_VERSION) {
+            throw std::runtime_error("Checkpoint file " + filename + " has format version " + std::to_string(version) +
+                                     ", which is newer than what this reader supports (" +
+                                     std::to_string(DEME_CHECKPOINT_VERSION) + ").");
+        }
+        uint32_t nSections = readPOD<uint32_t>();
+        for (uint32_t i = 0; i < nSections; i++) {
+            char name[DEME_CHECKPOINT_NAME_LEN];
+            file.read(name, sizeof(name));
+            name[DEME_CHECKPOINT_NAME_LEN - 1] = '\0';
+            uint64_t bytes = readPOD<uint64_t>();
+            uint64_t offset = readPOD<uint64_t>();
+            table[std::string(name)] = {bytes, offset};
+        }
+        if (!file) {
+            throw std::runtime_error("Checkpoint file " + filename + " is truncated.");
+        }
+    }
+    ~DEMCheckpointReader() {}
+
+    bool Has(const std::string& name) const { return table.find(name) != table.end(); }
+    /// Number of bytes of this section
+    size_t Bytes(const std::string& name) const { return getEntry(name).bytes; }
+
+    /// Read a section, which must be exactly this many bytes, into dst
+    void Read(const std::string& name, void* dst, size_t bytes) {
+        const Entry& entry = getEntry(name);
+        if (entry.bytes != bytes) {
+            throw std::runtime_error("Checkpoint section " + name + " in " + filename + " has " +
+                                     std::to_string(entry.bytes) + " bytes, but " + std::to_string(bytes) +
+                                     " bytes are expected.");
+        }
+        file.seekg(entry.offset);
+        file.read(reinterpret_cast<char*>(dst), bytes);
+        if (!file) {
+            throw std::runtime_error("Checkpoint file " + filename + " is truncated.");
+        }
+    }
+    /// Read a section that holds one value
+    template <typename T>
+    T ReadValue(const std::string& name) {
+        T val;
+        Read(name, &val, sizeof(T));
+        return val;
+    }
+
+  private:
+    struct Entry {
+        uint64_t bytes;
+        uint64_t offset;
+    };
+    std::string filename;
+    std::ifstream file;
+    std::unordered_map<std::string, Entry> table;
+
+    const Entry& getEntry(const std::string& name) const {
+        auto it = table.find(name);
+        if (it == table.end()) {
+            throw std::runtime_error("Checkpoint file " + filename + " has no section " + name + ".");
+        }
+        return it->second;
+    }
+    template <typename T>
+    T readPOD() {
+        T val;
+        file.read(reinterpret_cast<char*>(&val), sizeof(T));
+        return val;
+    }
+};
+
+}  // namespace deme
+
+#endif
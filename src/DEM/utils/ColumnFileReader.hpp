@@ -0,0 +1,394 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// A fast reader of the solver's own output files, for loading large inputs. The file is memory-mapped. A BINARY file
+// (see BinaryIO.hpp) is used where it is, without copying its columns; a CSV file is split into chunks of lines that
+// are parsed by several threads, with std::from_chars, into columns of the same layout as a BINARY file. String
+// columns hold uint32 indices into a dictionary either way, so no string is built per row.
+
+#ifndef DEME_COLUMN_FILE_READER_HPP
+#define DEME_COLUMN_FILE_READER_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32) || defined(_WIN64)
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include <DEM/utils/BinaryIO.hpp>
+
+namespace deme {
+
+/// A read-only memory map of a whole file. Where mmap is not available, the file is read into memory instead.
+class DEMMappedFile {
+  public:
+    DEMMappedFile(const std::string& filename) {
+#if defined(_WIN32) || defined(_WIN64)
+        std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!file) {
+            throw std::runtime_error("File " + filename + " cannot be opened.");
+        }
+        fallback.resize((size_t)file.tellg());
+        file.seekg(0);
+        file.read(fallback.data(), fallback.size());
+        ptr = fallback.data();
+        size = fallback.size();
+#else
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("File " + filename + " cannot be opened.");
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("File " + filename + " cannot be accessed.");
+        }
+        size = st.st_size;
+        if (size > 0) {
+            void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("File " + filename + " cannot be memory-mapped.");
+            }
+            ptr = static_cast<const char*>(addr);
+            madvise(addr, size, MADV_SEQUENTIAL);
+        }
+        close(fd);
+#endif
+    }
+    ~DEMMappedFile() {
+#if defined(_WIN32) || defined(_WIN64)
+#else
+        if (ptr) {
+            munmap(const_cast<char*>(ptr), size);
+        }
+#endif
+    }
+    DEMMappedFile(const DEMMappedFile&) = delete;
+    DEMMappedFile& operator=(const DEMMappedFile&) = delete;
+
+    const char* Data() const { return ptr; }
+    size_t Size() const { return size; }
+
+  private:
+    const char* ptr = nullptr;
+    size_t size = 0;
+#if defined(_WIN32) || defined(_WIN64)
+    std::vector<char> fallback;
+#endif
+};
+
+/// The columns of a BINARY or CSV output file. The format is told from the file's magic bytes.
+class DEMColumnFileReader {
+  public:
+    /// One column. Its rows are data[i * binaryColTypeSize(type)], which may not be aligned.
+    struct Column {
+        std::string name;
+        BINARY_COL_TYPE type;
+        const char* data = nullptr;
+        std::vector<std::string> dictionary;
+
+        /// Get a row of a numeric column as a float
+        float GetFloat(size_t row) const {
+            switch (type) {
+                case (BINARY_COL_TYPE::FLOAT32):
+                    return load<float>(row);
+                case (BINARY_COL_TYPE::UINT32):
+                    return (float)load<uint32_t>(row);
+                case (BINARY_COL_TYPE::UINT8):
+                    return (float)load<uint8_t>(row);
+                default:
+                    throw std::runtime_error("Column " + name + " is not numeric.");
+            }
+        }
+        /// Get the dictionary index of a row of a STRING_ID column
+        uint32_t GetStringID(size_t row) const { return load<uint32_t>(row); }
+
+      private:
+        template <typename T>
+        T load(size_t row) const {
+            T val;
+            std::memcpy(&val, data + row * sizeof(T), sizeof(T));
+            return val;
+        }
+    };
+
+    /// Read a file. In a CSV file, the columns named in string_cols are read as strings, and the rest as numbers.
+    /// parse_threads is the number of threads that parse a CSV file (0 means the number of hardware threads).
+    DEMColumnFileReader(const std::string& filename,
+                        const std::set<std::string>& string_cols,
+                        unsigned int parse_threads = 0)
+        : file(filename), fileName(filename) {
+        if (parse_threads == 0) {
+            parse_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        if (file.Size() >= sizeof(DEME_BINARY_OUTPUT_MAGIC) &&
+            std::memcmp(file.Data(), DEME_BINARY_OUTPUT_MAGIC, sizeof(DEME_BINARY_OUTPUT_MAGIC)) == 0) {
+            mapBinary();
+        } else {
+            parseCsv(string_cols, parse_threads);
+        }
+    }
+    ~DEMColumnFileReader() {}
+
+    size_t NumRows() const { return nRows; }
+    bool HasColumn(const std::string& name) const { return lookup.find(name) != lookup.end(); }
+    const Column& GetColumn(const std::string& name) const {
+        auto it = lookup.find(name);
+        if (it == lookup.end()) {
+            throw std::runtime_error("File " + fileName + " has no column " + name + ".");
+        }
+        return columns.at(it->second);
+    }
+
+    /// Call func(begin, end) for row ranges covering all rows, on this many threads
+    template <typename Func>
+    static void ParallelFor(size_t n, unsigned int n_threads, Func&& func) {
+        n_threads = std::max(1u, std::min<unsigned int>(n_threads, (n + 4095) / 4096));
+        forEachChunk(n_threads, [&](unsigned int t) { func(n * t / n_threads, n * (t + 1) / n_threads); });
+    }
+
+  private:
+    DEMMappedFile file;
+    std::string fileName;
+    size_t nRows = 0;
+    std::vector<Column> columns;
+    std::unordered_map<std::string, size_t> lookup;
+    // Column data parsed from a CSV file (a BINARY file's data stays in the map)
+    std::vector<std::vector<char>> ownedData;
+
+    void addColumn(const std::string& name, BINARY_COL_TYPE type) {
+        lookup[name] = columns.size();
+        columns.push_back(Column());
+        columns.back().name = name;
+        columns.back().type = type;
+    }
+
+    void mapBinary() {
+        const char* p = file.Data();
+        const char* end = file.Data() + file.Size();
+        auto take = [&](size_t bytes) {
+            if ((size_t)(end - p) < bytes) {
+                throw std::runtime_error("Binary output file " + fileName + " is truncated.");
+            }
+            const char* res = p;
+            p += bytes;
+            return res;
+        };
+        auto takeU32 = [&]() {
+            uint32_t val;
+            std::memcpy(&val, take(sizeof(val)), sizeof(val));
+            return val;
+        };
+        auto takeString = [&]() {
+            uint32_t len = takeU32();
+            return std::string(take(len), len);
+        };
+        take(sizeof(DEME_BINARY_OUTPUT_MAGIC));
+        uint32_t version = takeU32();
+        if (version > DEME_BINARY_OUTPUT_VERSION) {
+            throw std::runtime_error("File " + fileName + " has binary format version " + std::to_string(version) +
+                                     ", which is newer than what this reader supports (" +
+                                     std::to_string(DEME_BINARY_OUTPUT_VERSION) + ").");
+        }
+        uint32_t nCols = takeU32();
+        uint64_t rows;
+        std::memcpy(&rows, take(sizeof(rows)), sizeof(rows));
+        nRows = rows;
+        for (uint32_t i = 0; i < nCols; i++) {
+            std::string name = takeString();
+            uint8_t type;
+            std::memcpy(&type, take(sizeof(type)), sizeof(type));
+            addColumn(name, static_cast<BINARY_COL_TYPE>(type));
+            uint32_t nDict = takeU32();
+            for (uint32_t k = 0; k < nDict; k++) {
+                columns.back().dictionary.push_back(takeString());
+            }
+        }
+        for (auto& col : columns) {
+            col.data = take(nRows * binaryColTypeSize(col.type));
+        }
+    }
+
+    static std::string_view trim(std::string_view field) {
+        while (!field.empty() && (field.front() == ' ' || field.front() == '\t')) {
+            field.remove_prefix(1);
+        }
+        while (!field.empty() && (field.back() == ' ' || field.back() == '\t' || field.back() == '\r')) {
+            field.remove_suffix(1);
+        }
+        return field;
+    }
+    static bool isEmptyLine(std::string_view line) { return trim(line).empty(); }
+
+    void parseCsv(const std::set<std::string>& string_cols, unsigned int n_threads) {
+        const char* begin = file.Data();
+        const char* end = file.Data() + file.Size();
+        // Header
+        const char* header_end = std::find(begin, end, '\n');
+        std::string_view header(begin, header_end - begin);
+        size_t pos = 0;
+        while (true) {
+            size_t comma = header.find(',', pos);
+            std::string name(trim(header.substr(pos, comma - pos)));
+            addColumn(name, string_cols.count(name) ? BINARY_COL_TYPE::STRING_ID : BINARY_COL_TYPE::FLOAT32);
+            if (comma == std::string_view::npos)
+                break;
+            pos = comma + 1;
+        }
+        const char* body = (header_end == end) ? end : header_end + 1;
+
+        // Chunks of whole lines, one per thread, and the number of (non-empty) rows in each
+        n_threads = std::max(1u, std::min<unsigned int>(n_threads, (end - body) / (1 << 16) + 1));
+        std::vector<const char*> chunk_starts(n_threads + 1, end);
+        chunk_starts[0] = body;
+        for (unsigned int t = 1; t < n_threads; t++) {
+            const char* guess = body + (end - body) * t / n_threads;
+            guess = std::max(guess, chunk_starts[t - 1]);
+            const char* nl = std::find(guess, end, '\n');
+            chunk_starts[t] = (nl == end) ? end : nl + 1;
+        }
+        std::vector<size_t> chunk_rows(n_threads + 1, 0);
+        forEachChunk(n_threads, [&](unsigned int t) {
+            size_t count = 0;
+            forEachLine(chunk_starts[t], chunk_starts[t + 1], [&](std::string_view) { count++; });
+            chunk_rows[t + 1] = count;
+        });
+        for (unsigned int t = 0; t < n_threads; t++) {
+            chunk_rows[t + 1] += chunk_rows[t];
+        }
+        nRows = chunk_rows[n_threads];
+
+        ownedData.resize(columns.size());
+        for (size_t c = 0; c < columns.size(); c++) {
+            ownedData[c].resize(nRows * binaryColTypeSize(columns[c].type));
+            columns[c].data = ownedData[c].data();
+        }
+        // Each thread keeps its own dictionaries, which are merged afterwards
+        std::vector<std::vector<std::unordered_map<std::string_view, uint32_t>>> dicts(
+            n_threads, std::vector<std::unordered_map<std::string_view, uint32_t>>(columns.size()));
+        forEachChunk(n_threads, [&](unsigned int t) {
+            size_t row = chunk_rows[t];
+            forEachLine(chunk_starts[t], chunk_starts[t + 1], [&](std::string_view line) {
+                parseRow(line, row, dicts[t]);
+                row++;
+            });
+        });
+        for (size_t c = 0; c < columns.size(); c++) {
+            if (columns[c].type != BINARY_COL_TYPE::STRING_ID)
+                continue;
+            std::unordered_map<std::string_view, uint32_t> global;
+            std::vector<std::vector<uint32_t>> remap(n_threads);
+            for (unsigned int t = 0; t < n_threads; t++) {
+                remap[t].resize(dicts[t][c].size());
+                for (const auto& entry : dicts[t][c]) {
+                    auto it = global.find(entry.first);
+                    if (it == global.end()) {
+                        it = global.emplace(entry.first, (uint32_t)columns[c].dictionary.size()).first;
+                        columns[c].dictionary.emplace_back(entry.first);
+                    }
+                    remap[t][entry.second] = it->second;
+                }
+            }
+            uint32_t* ids = reinterpret_cast<uint32_t*>(ownedData[c].data());
+            forEachChunk(n_threads, [&](unsigned int t) {
+                for (size_t row = chunk_rows[t]; row < chunk_rows[t + 1]; row++) {
+                    ids[row] = remap[t][ids[row]];
+                }
+            });
+        }
+    }
+
+    void parseRow(std::string_view line,
+                  size_t row,
+                  std::vector<std::unordered_map<std::string_view, uint32_t>>& dict) {
+        size_t pos = 0;
+        for (size_t c = 0; c < columns.size(); c++) {
+            if (pos > line.size()) {
+                throw std::runtime_error("Line " + std::to_string(row + 2) + " of " + fileName + " has only " +
+                                         std::to_string(c) + " fields.");
+            }
+            size_t comma = line.find(',', pos);
+            std::string_view field = trim(line.substr(pos, comma - pos));
+            pos = (comma == std::string_view::npos) ? line.size() + 1 : comma + 1;
+            char* dst = ownedData[c].data() + row * binaryColTypeSize(columns[c].type);
+            if (columns[c].type == BINARY_COL_TYPE::STRING_ID) {
+                auto it = dict[c].find(field);
+                if (it == dict[c].end()) {
+                    it = dict[c].emplace(field, (uint32_t)dict[c].size()).first;
+                }
+                std::memcpy(dst, &(it->second), sizeof(uint32_t));
+            } else {
+                float val = 0;
+                auto res = std::from_chars(field.data(), field.data() + field.size(), val);
+                if (res.ec != std::errc() || res.ptr != field.data() + field.size()) {
+                    throw std::runtime_error("Field " + std::string(field) + " in column " + columns[c].name +
+                                             " of " + fileName + " is not a number.");
+                }
+                std::memcpy(dst, &val, sizeof(float));
+            }
+        }
+    }
+
+    template <typename Func>
+    static void forEachLine(const char* begin, const char* end, Func&& func) {
+        while (begin < end) {
+            const char* nl = std::find(begin, end, '\n');
+            std::string_view line(begin, nl - begin);
+            if (!isEmptyLine(line)) {
+                func(line);
+            }
+            begin = (nl == end) ? end : nl + 1;
+        }
+    }
+    // Call func(t) for t in [0, n_chunks), each on its own thread. Exceptions are re-thrown after all are done.
+    template <typename Func>
+    static void forEachChunk(unsigned int n_chunks, Func&& func) {
+        if (n_chunks <= 1) {
+            if (n_chunks == 1)
+                func(0u);
+            return;
+        }
+        std::vector<std::thread> threads;
+        std::vector<std::exception_ptr> errors(n_chunks);
+        for (unsigned int t = 0; t < n_chunks; t++) {
+            threads.emplace_back([&, t]() {
+                try {
+                    func(t);
+                } catch (...) {
+                    errors[t] = std::current_exception();
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+        for (const auto& err : errors) {
+            if (err) {
+                std::rethrow_exception(err);
+            }
+        }
+    }
+};
+
+}  // namespace deme
+
+#endif
@@ -0,0 +1,123 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// Fast CSV formatting for sphere, clump and contact output files. Numbers are formatted with std::to_chars instead of
+// iostreams, and the rows are split into chunks that several host threads format into their own buffers. The chunks
+// are then written out in order, so the file is the same as if it was formatted on one thread.
+
+#ifndef DEME_CSV_FORMAT_HPP
+#define DEME_CSV_FORMAT_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace deme {
+
+// Number of rows a host thread formats in one go
+const size_t DEME_CSV_ROWS_PER_CHUNK = 16384;
+// A generous guess of bytes a number takes in a CSV file, used to pre-size the chunk buffers
+const size_t DEME_CSV_BYTES_PER_FIELD = 16;
+
+/// A character buffer that CSV fields are appended to. Floats are written like an iostream of the given precision
+/// would (the %g style), but a lot faster.
+class DEMCsvBuffer {
+  public:
+    DEMCsvBuffer(int float_precision = 6) : precision(float_precision) {}
+
+    void Reserve(size_t n) { data.reserve(n); }
+    void Clear() { data.clear(); }
+    const std::string& Str() const { return data; }
+
+    void Put(float val) {
+        char tmp[64];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), val, std::chars_format::general, precision);
+        data.append(tmp, res.ptr);
+    }
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, bool>::type = true>
+    void Put(T val) {
+        char tmp[32];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), val);
+        data.append(tmp, res.ptr);
+    }
+    void Put(const std::string& str) { data += str; }
+    void Put(const char* str) { data += str; }
+
+    /// A comma, then the value
+    template <typename T>
+    void Field(const T& val) {
+        data.push_back(',');
+        Put(val);
+    }
+    void EndRow() { data.push_back('\n'); }
+
+  private:
+    int precision;
+    std::string data;
+};
+
+/// Format rows [0, num_rows) with format_row(DEMCsvBuffer&, size_t row) and write them to file in order. format_row
+/// may append nothing for the rows it skips. Chunks of rows are formatted concurrently, a batch of (at most) one chunk
+/// per hardware thread at a time, so the memory use is bounded and the buffers are re-used between batches.
+/// Exceptions thrown by format_row are re-thrown here.
+template <typename RowFormatter>
+void writeCsvRows(std::ofstream& file,
+                  size_t num_rows,
+                  unsigned int fields_per_row,
+                  int float_precision,
+                  const RowFormatter& format_row) {
+    const size_t num_chunks = (num_rows + DEME_CSV_ROWS_PER_CHUNK - 1) / DEME_CSV_ROWS_PER_CHUNK;
+    const size_t num_threads = std::min(num_chunks, (size_t)std::max(1u, std::thread::hardware_concurrency()));
+    if (num_threads == 0) {
+        return;
+    }
+    std::vector<DEMCsvBuffer> buffers(num_threads, DEMCsvBuffer(float_precision));
+    for (auto& buf : buffers) {
+        buf.Reserve(DEME_CSV_ROWS_PER_CHUNK * (fields_per_row + 1) * DEME_CSV_BYTES_PER_FIELD);
+    }
+    std::vector<std::exception_ptr> failures(num_threads, nullptr);
+
+    auto format_chunk = [&](size_t chunk, size_t slot) {
+        DEMCsvBuffer& buf = buffers[slot];
+        buf.Clear();
+        const size_t end = std::min(num_rows, (chunk + 1) * DEME_CSV_ROWS_PER_CHUNK);
+        try {
+            for (size_t row = chunk * DEME_CSV_ROWS_PER_CHUNK; row < end; row++) {
+                format_row(buf, row);
+            }
+        } catch (...) {
+            failures[slot] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t first_chunk = 0; first_chunk < num_chunks; first_chunk += num_threads) {
+        const size_t batch_size = std::min(num_threads, num_chunks - first_chunk);
+        // The calling thread formats the first chunk of the batch itself
+        workers.clear();
+        for (size_t slot = 1; slot < batch_size; slot++) {
+            workers.emplace_back(format_chunk, first_chunk + slot, slot);
+        }
+        format_chunk(first_chunk, 0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        for (size_t slot = 0; slot < batch_size; slot++) {
+            if (failures[slot]) {
+                std::rethrow_exception(failures[slot]);
+            }
+            file.write(buffers[slot].Str().data(), buffers[slot].Str().size());
+        }
+    }
+}
+
+}  // namespace deme
+
+#endif
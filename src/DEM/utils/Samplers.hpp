@@ -33,9 +33,12 @@
 #ifndef DEME_SAMPLERS_HPP
 #define DEME_SAMPLERS_HPP
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <list>
 #include <random>
+#include <thread>
 #include <utility>
 #include <vector>
 #include <DEM/HostSideHelpers.hpp>
@@ -92,14 +95,7 @@ class Sampler {
         assertThreeElements(halfDim, "SampleBox", "halfDim");
         m_center = host_make_float3(center[0], center[1], center[2]);
         m_size = host_make_float3(halfDim[0], halfDim[1], halfDim[2]);
-        auto res = Sample(BOX);
-        std::vector<std::vector<float>> xyz(res.size(), std::vector<float>(3, 0.));
-        for (size_t i = 0; i < res.size(); i++) {
-            xyz[i][0] = res[i].x;
-            xyz[i][1] = res[i].y;
-            xyz[i][2] = res[i].z;
-        }
-        return xyz;
+        return toXYZ(Sample(BOX));
     }
 
     /// Return points sampled from the specified spherical volume.
@@ -112,14 +108,7 @@ class Sampler {
         assertThreeElements(center, "SampleSphere", "center");
         m_center = host_make_float3(center[0], center[1], center[2]);
         m_size = host_make_float3(radius, radius, radius);
-        auto res = Sample(SPHERE);
-        std::vector<std::vector<float>> xyz(res.size(), std::vector<float>(3, 0.));
-        for (size_t i = 0; i < res.size(); i++) {
-            xyz[i][0] = res[i].x;
-            xyz[i][1] = res[i].y;
-            xyz[i][2] = res[i].z;
-        }
-        return xyz;
+        return toXYZ(Sample(SPHERE));
     }
 
     /// Return points sampled from the specified X-aligned cylindrical volume.
@@ -132,14 +121,7 @@ class Sampler {
         assertThreeElements(center, "SampleCylinderX", "center");
         m_center = host_make_float3(center[0], center[1], center[2]);
         m_size = host_make_float3(halfHeight, radius, radius);
-        auto res = Sample(CYLINDER_X);
-        std::vector<std::vector<float>> xyz(res.size(), std::vector<float>(3, 0.));
-        for (size_t i = 0; i < res.size(); i++) {
-            xyz[i][0] = res[i].x;
-            xyz[i][1] = res[i].y;
-            xyz[i][2] = res[i].z;
-        }
-        return xyz;
+        return toXYZ(Sample(CYLINDER_X));
     }
 
     /// Return points sampled from the specified Y-aligned cylindrical volume.
@@ -152,14 +134,7 @@ class Sampler {
         assertThreeElements(center, "SampleCylinderY", "center");
         m_center = host_make_float3(center[0], center[1], center[2]);
         m_size = host_make_float3(radius, halfHeight, radius);
-        auto res = Sample(CYLINDER_Y);
-        std::vector<std::vector<float>> xyz(res.size(), std::vector<float>(3, 0.));
-        for (size_t i = 0; i < res.size(); i++) {
-            xyz[i][0] = res[i].x;
-            xyz[i][1] = res[i].y;
-            xyz[i][2] = res[i].z;
-        }
-        return xyz;
+        return toXYZ(Sample(CYLINDER_Y));
     }
 
     /// Return points sampled from the specified Z-aligned cylindrical volume.
@@ -172,14 +147,7 @@ class Sampler {
         assertThreeElements(center, "SampleCylinderZ", "center");
         m_center = host_make_float3(center[0], center[1], center[2]);
         m_size = host_make_float3(radius, radius, halfHeight);
-        auto res = Sample(CYLINDER_Z);
-        std::vector<std::vector<float>> xyz(res.size(), std::vector<float>(3, 0.));
-        for (size_t i = 0; i < res.size(); i++) {
-            xyz[i][0] = res[i].x;
-            xyz[i][1] = res[i].y;
-            xyz[i][2] = res[i].z;
-        }
-        return xyz;
+        return toXYZ(Sample(CYLINDER_Z));
     }
 
     /// Get the current value of the minimum separation.
@@ -188,6 +156,9 @@ class Sampler {
     /// Change the minimum separation for subsequent calls to Sample.
     virtual void SetSeparation(float separation) { m_separation = separation; }
 
+    /// Set the number of host threads that the samplers that can work in parallel use (default: all hardware threads).
+    void SetNumThreads(unsigned int nThreads) { m_nThreads = std::max(nThreads, 1u); }
+
   protected:
     enum VolumeType { BOX, SPHERE, CYLINDER_X, CYLINDER_Y, CYLINDER_Z };
 
@@ -195,6 +166,49 @@ class Sampler {
     /// Implemented by concrete samplers.
     virtual std::vector<float3> Sample(VolumeType t) = 0;
 
+    /// Call func(i) for i in [0, n), splitting the range into contiguous chunks over up to m_nThreads threads.
+    template <typename Func>
+    void parallelFor(size_t n, const Func& func) const {
+        const size_t nThreads = std::min((size_t)m_nThreads, n);
+        if (nThreads <= 1) {
+            for (size_t i = 0; i < n; i++)
+                func(i);
+            return;
+        }
+        const size_t chunk = (n + nThreads - 1) / nThreads;
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < nThreads; t++) {
+            threads.emplace_back([&func, t, chunk, n]() {
+                for (size_t i = t * chunk; i < std::min(n, (t + 1) * chunk); i++)
+                    func(i);
+            });
+        }
+        for (auto& th : threads)
+            th.join();
+    }
+
+    /// Put the point lists generated in parallel together, in order.
+    static std::vector<float3> concatenate(const std::vector<std::vector<float3>>& parts) {
+        size_t n = 0;
+        for (const auto& part : parts)
+            n += part.size();
+        std::vector<float3> out_points;
+        out_points.reserve(n);
+        for (const auto& part : parts)
+            out_points.insert(out_points.end(), part.begin(), part.end());
+        return out_points;
+    }
+
+    static std::vector<std::vector<float>> toXYZ(const std::vector<float3>& res) {
+        std::vector<std::vector<float>> xyz(res.size(), std::vector<float>(3, 0.));
+        for (size_t i = 0; i < res.size(); i++) {
+            xyz[i][0] = res[i].x;
+            xyz[i][1] = res[i].y;
+            xyz[i][2] = res[i].z;
+        }
+        return xyz;
+    }
+
     /// Utility function to check if a point is inside the sampling volume.
     bool accept(VolumeType t, const float3& p) const {
         float3 vec = p - m_center;
@@ -220,6 +234,7 @@ class Sampler {
     float m_separation;  ///< inter-particle separation
     float3 m_center;     ///< center of the sampling volume
     float3 m_size;       ///< half dimensions of the bounding box of the sampling volume
+    unsigned int m_nThreads = std::max(std::thread::hardware_concurrency(), 1u);  ///< host threads to sample with
 };
 
 class PDGrid {
@@ -493,6 +508,126 @@ std::vector<float3> PDLayerSampler_BOX(float3 center,                ///< Center
     return points_full;
 }
 
+/// Poisson Disk sampler that throws darts at the cells of a background grid, many cells at a time. Cells that are at
+/// least 3 cells apart in some direction cannot hold conflicting points, so the cells are visited in 27 (or 9, in 2D)
+/// interleaved phases, and the cells of one phase are processed in parallel. Each cell gets a few darts per pass, and
+/// a few passes fill up most of the gaps. The random numbers are derived from the cell, pass and dart indices, so the
+/// result only depends on the seed, not on the number of threads. The points are not as close to maximal packing as
+/// those of PDSampler, but this sampler scales to very large domains.
+class PDParallelSampler : public Sampler {
+  public:
+    /// Construct a parallel Poisson Disk sampler with specified minimum distance.
+    PDParallelSampler(float separation, int dartsPerCell = m_darts_default, int passes = m_passes_default)
+        : Sampler(separation), m_darts(dartsPerCell), m_passes(passes) {}
+
+    /// Set the seed the random numbers are derived from (default: 0).
+    void SetRandomEngineSeed(unsigned int seed) { m_seed = seed; }
+
+  private:
+    /// Worker function for sampling the given domain.
+    virtual std::vector<float3> Sample(VolumeType t) override {
+        // Same as PDSampler, if the size in one direction is less than the minimum distance, the sampling is 2D, and
+        // all points are on the mid-plane of the domain in that direction
+        if (this->m_size.z < this->m_separation) {
+            this->m_size.z = 0;
+        } else if (this->m_size.y < this->m_separation) {
+            this->m_size.y = 0;
+        } else if (this->m_size.x < this->m_separation) {
+            this->m_size.x = 0;
+        }
+        const bool is2D = (this->m_size.x == 0 || this->m_size.y == 0 || this->m_size.z == 0);
+        const float cellSize = this->m_separation / (float)std::sqrt(is2D ? 2.0 : 3.0);
+        const float3 bl = this->m_center - this->m_size;
+        const int nx = (int)(2 * this->m_size.x / cellSize) + 1;
+        const int ny = (int)(2 * this->m_size.y / cellSize) + 1;
+        const int nz = (int)(2 * this->m_size.z / cellSize) + 1;
+        const size_t nCells = (size_t)nx * ny * nz;
+        auto cellIndex = [ny, nz](int i, int j, int k) { return ((size_t)i * ny + j) * nz + k; };
+
+        // Each cell holds at most one point, as the cell diagonal is no longer than the separation
+        std::vector<float3> cellPoints(nCells);
+        std::vector<unsigned char> cellFull(nCells, 0);
+        const float sep2 = this->m_separation * this->m_separation;
+
+        for (int pass = 0; pass < m_passes; pass++) {
+            for (int phase = 0; phase < 27; phase++) {
+                const int pi = phase / 9, pj = (phase / 3) % 3, pk = phase % 3;
+                if (pi >= nx || pj >= ny || pk >= nz)
+                    continue;
+                const int mx = (nx - pi + 2) / 3, my = (ny - pj + 2) / 3, mz = (nz - pk + 2) / 3;
+                this->parallelFor((size_t)mx * my * mz, [&](size_t m) {
+                    const int i = pi + 3 * (int)(m / ((size_t)my * mz));
+                    const int j = pj + 3 * (int)((m / mz) % my);
+                    const int k = pk + 3 * (int)(m % mz);
+                    const size_t cell = cellIndex(i, j, k);
+                    if (cellFull[cell])
+                        return;
+                    for (int dart = 0; dart < m_darts; dart++) {
+                        uint64_t key = ((uint64_t)cell * m_passes + pass) * m_darts + dart;
+                        float3 q;
+                        q.x = (this->m_size.x == 0) ? this->m_center.x : bl.x + (i + unitRandom(key, 0)) * cellSize;
+                        q.y = (this->m_size.y == 0) ? this->m_center.y : bl.y + (j + unitRandom(key, 1)) * cellSize;
+                        q.z = (this->m_size.z == 0) ? this->m_center.z : bl.z + (k + unitRandom(key, 2)) * cellSize;
+                        if (!this->accept(t, q))
+                            continue;
+                        // Only the 5x5x5 surrounding cells can hold points closer than the separation, and none of them
+                        // is in the same phase, so they are not being written now
+                        bool ok = true;
+                        for (int ii = std::max(i - 2, 0); ok && ii < std::min(i + 3, nx); ii++) {
+                            for (int jj = std::max(j - 2, 0); ok && jj < std::min(j + 3, ny); jj++) {
+                                for (int kk = std::max(k - 2, 0); ok && kk < std::min(k + 3, nz); kk++) {
+                                    const size_t other = cellIndex(ii, jj, kk);
+                                    if (cellFull[other]) {
+                                        float3 dist = q - cellPoints[other];
+                                        ok = (dot(dist, dist) >= sep2);
+                                    }
+                                }
+                            }
+                        }
+                        if (ok) {
+                            cellPoints[cell] = q;
+                            cellFull[cell] = 1;
+                            return;
+                        }
+                    }
+                });
+            }
+        }
+
+        // Collect the points in cell order, again in parallel over slices of constant X
+        std::vector<std::vector<float3>> slices(nx);
+        this->parallelFor(nx, [&](size_t i) {
+            for (size_t cell = i * ny * nz; cell < (i + 1) * ny * nz; cell++) {
+                if (cellFull[cell])
+                    slices[i].push_back(cellPoints[cell]);
+            }
+        });
+        return this->concatenate(slices);
+    }
+
+    /// A random number in [0, 1) derived from the key and the component c (SplitMix64 finalizer).
+    float unitRandom(uint64_t key, unsigned int c) const {
+        uint64_t z = key * 3 + c + ((uint64_t)m_seed << 40) + 0x9e3779b97f4a7c15ULL;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        z = z ^ (z >> 31);
+        return (float)(z >> 40) / (float)(1ULL << 24);
+    }
+
+    int m_darts;              ///< darts thrown at each empty cell per pass
+    int m_passes;             ///< passes over all cells
+    unsigned int m_seed = 0;  ///< seed of the random numbers
+
+    static const int m_darts_default = 8;
+    static const int m_passes_default = 4;
+};
+
+/// A wrapper for a parallel Poisson Disk sampler of a box domain.
+inline std::vector<float3> DEMBoxPDParallelSampler(float3 BoxCenter, float3 HalfDims, float Separation) {
+    PDParallelSampler sampler(Separation);
+    return sampler.SampleBox(BoxCenter, HalfDims);
+}
+
 // HCP
 class HCPSampler : public Sampler {
   public:
@@ -501,8 +636,6 @@ class HCPSampler : public Sampler {
   private:
     /// Worker function for sampling the given domain.
     virtual std::vector<float3> Sample(VolumeType t) override {
-        std::vector<float3> out_points;
-
         float3 bl = this->m_center - this->m_size;  // start corner of sampling domain
 
         float dx = this->m_separation;                                  // distance between two points in X direction
@@ -513,7 +646,12 @@ class HCPSampler : public Sampler {
         int ny = (int)(2 * this->m_size.y / dy) + 1;
         int nz = (int)(2 * this->m_size.z / dz) + 1;
 
-        for (int k = 0; k < nz; k++) {
+        // Layers are generated in parallel, each into its own list, and put together in the serial order
+        std::vector<std::vector<float3>> layers(nz);
+        this->parallelFor(nz, [&](size_t layer) {
+            int k = (int)layer;
+            std::vector<float3>& layer_points = layers[k];
+            layer_points.reserve((size_t)nx * ny);
             // Y offsets for alternate layers
             float offset_y = (k % 2 == 0) ? 0 : dy / 3;
             for (int j = 0; j < ny; j++) {
@@ -522,12 +660,12 @@ class HCPSampler : public Sampler {
                 for (int i = 0; i < nx; i++) {
                     float3 p = bl + host_make_float3(offset_x + i * dx, offset_y + j * dy, k * dz);
                     if (this->accept(t, p))
-                        out_points.push_back(p);
+                        layer_points.push_back(p);
                 }
             }
-        }
+        });
 
-        return out_points;
+        return this->concatenate(layers);
     }
 };
 
@@ -549,25 +687,28 @@ class GridSampler : public Sampler {
   private:
     /// Worker function for sampling the given domain.
     virtual std::vector<float3> Sample(VolumeType t) override {
-        std::vector<float3> out_points;
-
         float3 bl = this->m_center - this->m_size;
 
         int nx = (int)(2 * this->m_size.x / m_sep3D.x) + 1;
         int ny = (int)(2 * this->m_size.y / m_sep3D.y) + 1;
         int nz = (int)(2 * this->m_size.z / m_sep3D.z) + 1;
 
-        for (int i = 0; i < nx; i++) {
+        // Slices of constant X are generated in parallel, and put together in the serial order
+        std::vector<std::vector<float3>> slices(nx);
+        this->parallelFor(nx, [&](size_t slice) {
+            int i = (int)slice;
+            std::vector<float3>& slice_points = slices[i];
+            slice_points.reserve((size_t)ny * nz);
             for (int j = 0; j < ny; j++) {
                 for (int k = 0; k < nz; k++) {
                     float3 p = bl + host_make_float3(i * m_sep3D.x, j * m_sep3D.y, k * m_sep3D.z);
                     if (this->accept(t, p))
-                        out_points.push_back(p);
+                        slice_points.push_back(p);
                 }
             }
-        }
+        });
 
-        return out_points;
+        return this->concatenate(slices);
     }
 
     float3 m_sep3D;
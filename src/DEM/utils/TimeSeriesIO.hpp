@@ -0,0 +1,359 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// A streaming, compressed time-series format for owner states (the frames of a movie), and its writer and reader.
+// Positions are kept in the solver's own quantized form (units of the sub-voxel size l, from the domain's LBF corner)
+// and quaternion components are quantized to int16. Each frame stores, per channel, the differences to the previous
+// frame as zigzag varints, so quiet particles take about a byte per channel. Every so often a keyframe stores the
+// values themselves, which bounds the work of reading a frame in the middle.
+//
+// Layout (all integers are little-endian, as written by the host):
+//   char[8]   magic "DEMETS"
+//   uint32    format version
+//   uint32    keyframe interval
+//   double    LBFX, LBFY, LBFZ, l
+//   For each frame:
+//     uint8   1 if keyframe, 0 if delta frame
+//     uint64  number of owners
+//     double  simulation time
+//     uint64  payload bytes, then the payload: the channels one after another, each a varint per owner
+//   Index (written when the file is closed):
+//     For each frame: uint64 offset of the frame, uint8 keyframe flag
+//     uint64  number of frames
+//     uint64  offset of the index
+//     char[8] magic "DEMETSIX"
+// A file whose writer did not get to close it has no index; the reader then scans the frames instead.
+
+#ifndef DEME_TIME_SERIES_IO_HPP
+#define DEME_TIME_SERIES_IO_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace deme {
+
+const char DEME_TIME_SERIES_MAGIC[8] = {'D', 'E', 'M', 'E', 'T', 'S', '\0', '\0'};
+const char DEME_TIME_SERIES_INDEX_MAGIC[8] = {'D', 'E', 'M', 'E', 'T', 'S', 'I', 'X'};
+const uint32_t DEME_TIME_SERIES_VERSION = 1;
+const double DEME_TIME_SERIES_QUAT_SCALE = 32767.0;
+
+/// The domain info needed to turn quantized positions back into coordinates
+struct DEMTimeSeriesDomain {
+    double LBFX = 0;
+    double LBFY = 0;
+    double LBFZ = 0;
+    double l = 1;
+};
+
+/// One frame of owner states, in quantized form
+struct DEMTimeSeriesFrame {
+    // Number of channels, in the order they are stored in a frame
+    static const unsigned int NUM_CHANNELS = 9;
+
+    double time = 0;
+    // Position, in units of l, from the LBF corner
+    std::vector<int64_t> posX, posY, posZ;
+    // Quaternion components times DEME_TIME_SERIES_QUAT_SCALE
+    std::vector<int64_t> oriQw, oriQx, oriQy, oriQz;
+    std::vector<int64_t> family;
+    // The clump template (mass property) offset
+    std::vector<int64_t> type;
+
+    size_t NumOwners() const { return posX.size(); }
+    void Resize(size_t n) {
+        for (auto* ch : Channels()) {
+            ch->resize(n);
+        }
+    }
+    std::vector<std::vector<int64_t>*> Channels() {
+        return {&posX, &posY, &posZ, &oriQw, &oriQx, &oriQy, &oriQz, &family, &type};
+    }
+    std::vector<const std::vector<int64_t>*> Channels() const {
+        return {&posX, &posY, &posZ, &oriQw, &oriQx, &oriQy, &oriQz, &family, &type};
+    }
+
+    /// Coordinates of owner i
+    void GetPosition(size_t i, const DEMTimeSeriesDomain& domain, double& X, double& Y, double& Z) const {
+        X = domain.LBFX + (double)posX.at(i) * domain.l;
+        Y = domain.LBFY + (double)posY.at(i) * domain.l;
+        Z = domain.LBFZ + (double)posZ.at(i) * domain.l;
+    }
+    /// Orientation quaternion of owner i
+    void GetOriQ(size_t i, float& Qw, float& Qx, float& Qy, float& Qz) const {
+        Qw = (float)(oriQw.at(i) / DEME_TIME_SERIES_QUAT_SCALE);
+        Qx = (float)(oriQx.at(i) / DEME_TIME_SERIES_QUAT_SCALE);
+        Qy = (float)(oriQy.at(i) / DEME_TIME_SERIES_QUAT_SCALE);
+        Qz = (float)(oriQz.at(i) / DEME_TIME_SERIES_QUAT_SCALE);
+    }
+};
+
+namespace time_series_impl {
+
+inline void putVarint(std::vector<char>& out, int64_t val) {
+    // Zigzag, so small negative numbers are small too
+    uint64_t u = ((uint64_t)val << 1) ^ (uint64_t)(val >> 63);
+    while (u >= 0x80) {
+        out.push_back((char)((u & 0x7F) | 0x80));
+        u >>= 7;
+    }
+    out.push_back((char)u);
+}
+
+inline int64_t getVarint(const char*& ptr, const char* end) {
+    uint64_t u = 0;
+    unsigned int shift = 0;
+    while (true) {
+        if (ptr >= end || shift > 63) {
+            throw std::runtime_error("Corrupted frame in time-series file.");
+        }
+        uint8_t byte = (uint8_t)(*ptr++);
+        u |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+        shift += 7;
+    }
+    return (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+}
+
+template <typename T>
+inline void writePOD(std::ofstream& file, T val) {
+    file.write(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+template <typename T>
+inline T readPOD(std::ifstream& file) {
+    T val;
+    file.read(reinterpret_cast<char*>(&val), sizeof(T));
+    return val;
+}
+
+}  // namespace time_series_impl
+
+/// Appends frames to a time-series file. The index is written when it is closed (or destroyed).
+class DEMTimeSeriesFileWriter {
+  public:
+    DEMTimeSeriesFileWriter(const std::string& filename, const DEMTimeSeriesDomain& dom, unsigned int keyframe_interval)
+        : domain(dom), keyInterval(keyframe_interval > 0 ? keyframe_interval : 1) {
+        using namespace time_series_impl;
+        file.open(filename, std::ios::out | std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Time-series file " + filename + " cannot be opened for writing.");
+        }
+        file.write(DEME_TIME_SERIES_MAGIC, sizeof(DEME_TIME_SERIES_MAGIC));
+        writePOD<uint32_t>(file, DEME_TIME_SERIES_VERSION);
+        writePOD<uint32_t>(file, keyInterval);
+        writePOD<double>(file, domain.LBFX);
+        writePOD<double>(file, domain.LBFY);
+        writePOD<double>(file, domain.LBFZ);
+        writePOD<double>(file, domain.l);
+    }
+    ~DEMTimeSeriesFileWriter() { Close(); }
+
+    /// Append a frame. It is a keyframe if it is time for one, or if the number of owners changed.
+    void Append(const DEMTimeSeriesFrame& frame) {
+        using namespace time_series_impl;
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot append a frame to a closed time-series file.");
+        }
+        const size_t n = frame.NumOwners();
+        const bool keyframe = (frameOffsets.size() % keyInterval == 0) || (n != prev.NumOwners());
+        payload.clear();
+        auto channels = frame.Channels();
+        auto prev_channels = prev.Channels();
+        for (unsigned int c = 0; c < DEMTimeSeriesFrame::NUM_CHANNELS; c++) {
+            const auto& ch = *channels[c];
+            if (ch.size() != n) {
+                throw std::runtime_error("Channels of a time-series frame have different lengths.");
+            }
+            for (size_t i = 0; i < n; i++) {
+                putVarint(payload, keyframe ? ch[i] : ch[i] - (*prev_channels[c])[i]);
+            }
+        }
+        frameOffsets.push_back(file.tellp());
+        frameIsKey.push_back(keyframe);
+        writePOD<uint8_t>(file, keyframe);
+        writePOD<uint64_t>(file, n);
+        writePOD<double>(file, frame.time);
+        writePOD<uint64_t>(file, payload.size());
+        file.write(payload.data(), payload.size());
+        file.flush();
+        prev = frame;
+    }
+
+    size_t NumFrames() const { return frameOffsets.size(); }
+
+    /// Write the frame index and close the file
+    void Close() {
+        using namespace time_series_impl;
+        if (!file.is_open()) {
+            return;
+        }
+        uint64_t index_offset = file.tellp();
+        for (size_t i = 0; i < frameOffsets.size(); i++) {
+            writePOD<uint64_t>(file, frameOffsets[i]);
+            writePOD<uint8_t>(file, frameIsKey[i]);
+        }
+        writePOD<uint64_t>(file, frameOffsets.size());
+        writePOD<uint64_t>(file, index_offset);
+        file.write(DEME_TIME_SERIES_INDEX_MAGIC, sizeof(DEME_TIME_SERIES_INDEX_MAGIC));
+        file.close();
+    }
+
+  private:
+    std::ofstream file;
+    DEMTimeSeriesDomain domain;
+    unsigned int keyInterval;
+    DEMTimeSeriesFrame prev;
+    std::vector<char> payload;
+    std::vector<uint64_t> frameOffsets;
+    std::vector<uint8_t> frameIsKey;
+};
+
+/// Random access to the frames of a time-series file
+class DEMTimeSeriesFileReader {
+  public:
+    DEMTimeSeriesFileReader(const std::string& file_name) : filename(file_name) {
+        using namespace time_series_impl;
+        file.open(filename, std::ios::in | std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Time-series file " + filename + " cannot be opened.");
+        }
+        char magic[sizeof(DEME_TIME_SERIES_MAGIC)];
+        file.read(magic, sizeof(magic));
+        if (!file || std::memcmp(magic, DEME_TIME_SERIES_MAGIC, sizeof(magic)) != 0) {
+            throw std::runtime_error("File " + filename + " is not a DEME time-series file.");
+        }
+        uint32_t version = readPOD<uint32_t>(file);
+        if (version > DEME_TIME_SERIES_VERSION) {
+            throw std::runtime_error("Time-series file " + filename + " has format version " +
+                                     std::to_string(version) + ", which is newer than what this reader supports (" +
+                                     std::to_string(DEME_TIME_SERIES_VERSION) + ").");
+        }
+        readPOD<uint32_t>(file);
+        domain.LBFX = readPOD<double>(file);
+        domain.LBFY = readPOD<double>(file);
+        domain.LBFZ = readPOD<double>(file);
+        domain.l = readPOD<double>(file);
+        const uint64_t first_frame = file.tellg();
+        if (!file) {
+            throw std::runtime_error("Time-series file " + filename + " is truncated.");
+        }
+        if (!readIndex()) {
+            scanFrames(first_frame);
+        }
+    }
+    ~DEMTimeSeriesFileReader() {}
+
+    size_t NumFrames() const { return frameOffsets.size(); }
+    const DEMTimeSeriesDomain& GetDomain() const { return domain; }
+
+    /// Read frame i, decoding from the keyframe before it
+    DEMTimeSeriesFrame ReadFrame(size_t i) {
+        using namespace time_series_impl;
+        if (i >= frameOffsets.size()) {
+            throw std::runtime_error("Frame " + std::to_string(i) + " is out of range; time-series file " + filename +
+                                     " has " + std::to_string(frameOffsets.size()) + " frames.");
+        }
+        size_t key = i;
+        while (!frameIsKey[key]) {
+            key--;
+        }
+        DEMTimeSeriesFrame frame;
+        std::vector<char> payload;
+        for (size_t f = key; f <= i; f++) {
+            file.clear();
+            file.seekg(frameOffsets[f]);
+            bool keyframe = readPOD<uint8_t>(file);
+            uint64_t n = readPOD<uint64_t>(file);
+            frame.time = readPOD<double>(file);
+            payload.resize(readPOD<uint64_t>(file));
+            file.read(payload.data(), payload.size());
+            if (!file) {
+                throw std::runtime_error("Time-series file " + filename + " is truncated.");
+            }
+            if (keyframe) {
+                frame.Resize(n);
+            } else if (n != frame.NumOwners()) {
+                throw std::runtime_error("Corrupted delta frame in time-series file " + filename + ".");
+            }
+            const char* ptr = payload.data();
+            const char* end = ptr + payload.size();
+            for (auto* ch : frame.Channels()) {
+                for (size_t j = 0; j < n; j++) {
+                    int64_t val = getVarint(ptr, end);
+                    (*ch)[j] = keyframe ? val : (*ch)[j] + val;
+                }
+            }
+        }
+        return frame;
+    }
+
+  private:
+    std::string filename;
+    std::ifstream file;
+    DEMTimeSeriesDomain domain;
+    std::vector<uint64_t> frameOffsets;
+    std::vector<uint8_t> frameIsKey;
+
+    bool readIndex() {
+        using namespace time_series_impl;
+        const int64_t tail = 2 * sizeof(uint64_t) + sizeof(DEME_TIME_SERIES_INDEX_MAGIC);
+        file.seekg(0, std::ios::end);
+        if ((int64_t)file.tellg() < tail) {
+            return false;
+        }
+        file.seekg(-tail, std::ios::end);
+        uint64_t nFrames = readPOD<uint64_t>(file);
+        uint64_t index_offset = readPOD<uint64_t>(file);
+        char magic[sizeof(DEME_TIME_SERIES_INDEX_MAGIC)];
+        file.read(magic, sizeof(magic));
+        if (!file || std::memcmp(magic, DEME_TIME_SERIES_INDEX_MAGIC, sizeof(magic)) != 0) {
+            file.clear();
+            return false;
+        }
+        file.seekg(index_offset);
+        frameOffsets.resize(nFrames);
+        frameIsKey.resize(nFrames);
+        for (uint64_t i = 0; i < nFrames; i++) {
+            frameOffsets[i] = readPOD<uint64_t>(file);
+            frameIsKey[i] = readPOD<uint8_t>(file);
+        }
+        return (bool)file;
+    }
+
+    // Without an index, walk the frame headers. A frame cut short at the end of the file is left out.
+    void scanFrames(uint64_t offset) {
+        using namespace time_series_impl;
+        frameOffsets.clear();
+        frameIsKey.clear();
+        file.clear();
+        file.seekg(0, std::ios::end);
+        const uint64_t file_size = file.tellg();
+        const uint64_t header_size = sizeof(uint8_t) + 2 * sizeof(uint64_t) + sizeof(double);
+        while (offset + header_size <= file_size) {
+            file.seekg(offset);
+            uint8_t keyframe = readPOD<uint8_t>(file);
+            readPOD<uint64_t>(file);
+            readPOD<double>(file);
+            uint64_t bytes = readPOD<uint64_t>(file);
+            if (!file || offset + header_size + bytes > file_size) {
+                break;
+            }
+            frameOffsets.push_back(offset);
+            frameIsKey.push_back(keyframe);
+            offset += header_size + bytes;
+        }
+        file.clear();
+    }
+};
+
+}  // namespace deme
+
+#endif
@@ -0,0 +1,196 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// A writer of VTK XML files (.vtp for particles, .vtu for meshes) that puts all arrays in one raw appended-data block.
+// The XML part is a small header; each array is then written to the file as one contiguous block of bytes, so no
+// number is formatted as text. The files are little-endian (as written by the host), with UInt64 block headers.
+
+#ifndef DEME_VTK_XML_IO_HPP
+#define DEME_VTK_XML_IO_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <DEM/utils/BinaryIO.hpp>
+
+namespace deme {
+
+/// Which VTK XML dataset a DEMVtkXmlFile is
+enum class VTK_XML_TYPE { POLY_DATA, UNSTRUCTURED_GRID };
+
+/// One array of a VTK XML file. It does not own its data, which must stay alive until the file is written.
+struct DEMVtkXmlArray {
+    std::string name;
+    // VTK type name, such as Float32, Int64 or UInt8
+    std::string type;
+    unsigned int nComp = 1;
+    const void* data = nullptr;
+    size_t bytes = 0;
+};
+
+/// Collects the arrays of one VTK XML piece, then writes them. Points are 3-component Float32; cells (or verts, for
+/// poly data) are given by Int64 connectivity and offsets, and for unstructured grids, UInt8 cell types.
+class DEMVtkXmlFile {
+  public:
+    DEMVtkXmlFile(VTK_XML_TYPE file_type) : type(file_type) {}
+    ~DEMVtkXmlFile() {}
+
+    void SetPoints(const float* xyz, size_t n) {
+        nPoints = n;
+        points = {"Points", "Float32", 3, xyz, n * 3 * sizeof(float)};
+    }
+    void SetCells(const int64_t* connectivity, size_t conn_size, const int64_t* offsets, size_t n) {
+        nCells = n;
+        cellConn = {"connectivity", "Int64", 1, connectivity, conn_size * sizeof(int64_t)};
+        cellOffsets = {"offsets", "Int64", 1, offsets, n * sizeof(int64_t)};
+    }
+    /// Only used by unstructured grids
+    void SetCellTypes(const uint8_t* types, size_t n) { cellTypes = {"types", "UInt8", 1, types, n}; }
+
+    void AddPointData(const std::string& name, const std::string& vtk_type, unsigned int n_comp, const void* data,
+                      size_t bytes) {
+        pointData.push_back({name, vtk_type, n_comp, data, bytes});
+    }
+    void AddCellData(const std::string& name, const std::string& vtk_type, unsigned int n_comp, const void* data,
+                     size_t bytes) {
+        cellData.push_back({name, vtk_type, n_comp, data, bytes});
+    }
+    /// Add all columns of a binary output table as point data, except the ones in skip. STRING_ID columns go in as
+    /// their UInt32 indices, and their dictionaries are listed in an XML comment.
+    void AddPointDataFromTable(const DEMBinaryTable& table, const std::vector<std::string>& skip) {
+        for (const auto& col : table.columns) {
+            bool skip_this = false;
+            for (const auto& name : skip) {
+                skip_this = skip_this || (col.name == name);
+            }
+            if (skip_this)
+                continue;
+            AddPointData(col.name, vtkTypeName(col.type), 1, col.bytes.data(), col.bytes.size());
+            if (col.type == BINARY_COL_TYPE::STRING_ID) {
+                std::string list = col.name + ":";
+                for (size_t i = 0; i < col.dictionary.size(); i++) {
+                    list += " " + std::to_string(i) + "=" + col.dictionary[i];
+                }
+                // Two dashes in a row would end the comment
+                for (size_t pos = list.find("--"); pos != std::string::npos; pos = list.find("--", pos)) {
+                    list.replace(pos, 2, "- -");
+                }
+                comments.push_back(list);
+            }
+        }
+    }
+
+    void Write(std::ofstream& file) const {
+        if (!file) {
+            throw std::runtime_error("VTK XML file cannot be opened for writing.");
+        }
+        const bool poly = (type == VTK_XML_TYPE::POLY_DATA);
+        const std::string dataset = poly ? "PolyData" : "UnstructuredGrid";
+        // The appended block has all arrays in this order
+        std::vector<const DEMVtkXmlArray*> blocks;
+        uint64_t offset = 0;
+        std::string xml;
+        xml += "<?xml version=\"1.0\"?>\n";
+        for (const auto& comment : comments) {
+            xml += "<!-- " + comment + " -->\n";
+        }
+        xml += "<VTKFile type=\"" + dataset +
+               "\" version=\"1.0\" byte_order=\"LittleEndian\" header_type=\"UInt64\">\n";
+        xml += "  <" + dataset + ">\n";
+        if (poly) {
+            xml += "    <Piece NumberOfPoints=\"" + std::to_string(nPoints) + "\" NumberOfVerts=\"" +
+                   std::to_string(nCells) + "\" NumberOfLines=\"0\" NumberOfStrips=\"0\" NumberOfPolys=\"0\">\n";
+        } else {
+            xml += "    <Piece NumberOfPoints=\"" + std::to_string(nPoints) + "\" NumberOfCells=\"" +
+                   std::to_string(nCells) + "\">\n";
+        }
+        addGroup(xml, "PointData", pointersTo(pointData), blocks, offset);
+        addGroup(xml, "CellData", pointersTo(cellData), blocks, offset);
+        addGroup(xml, "Points", {&points}, blocks, offset, true);
+        if (poly) {
+            addGroup(xml, "Verts", {&cellConn, &cellOffsets}, blocks, offset, true);
+        } else {
+            addGroup(xml, "Cells", {&cellConn, &cellOffsets, &cellTypes}, blocks, offset, true);
+        }
+        xml += "    </Piece>\n";
+        xml += "  </" + dataset + ">\n";
+        xml += "  <AppendedData encoding=\"raw\">\n   _";
+        file.write(xml.data(), xml.size());
+        for (const auto& block : blocks) {
+            uint64_t bytes = block->bytes;
+            file.write(reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+            if (bytes > 0) {
+                file.write(reinterpret_cast<const char*>(block->data), bytes);
+            }
+        }
+        const std::string tail = "\n  </AppendedData>\n</VTKFile>\n";
+        file.write(tail.data(), tail.size());
+        if (!file) {
+            throw std::runtime_error("Failed to write VTK XML file.");
+        }
+    }
+
+  private:
+    VTK_XML_TYPE type;
+    size_t nPoints = 0;
+    size_t nCells = 0;
+    DEMVtkXmlArray points;
+    DEMVtkXmlArray cellConn;
+    DEMVtkXmlArray cellOffsets;
+    DEMVtkXmlArray cellTypes;
+    std::vector<DEMVtkXmlArray> pointData;
+    std::vector<DEMVtkXmlArray> cellData;
+    std::vector<std::string> comments;
+
+    static std::string vtkTypeName(BINARY_COL_TYPE col_type) {
+        switch (col_type) {
+            case (BINARY_COL_TYPE::FLOAT32):
+                return "Float32";
+            case (BINARY_COL_TYPE::UINT32):
+            case (BINARY_COL_TYPE::STRING_ID):
+                return "UInt32";
+            case (BINARY_COL_TYPE::UINT8):
+                return "UInt8";
+            default:
+                throw std::runtime_error("Unknown column data type in binary output table.");
+        }
+    }
+
+    static std::vector<const DEMVtkXmlArray*> pointersTo(const std::vector<DEMVtkXmlArray>& arrays) {
+        std::vector<const DEMVtkXmlArray*> res;
+        for (const auto& arr : arrays) {
+            res.push_back(&arr);
+        }
+        return res;
+    }
+
+    // Write the XML tags of a group of arrays, and queue the arrays for the appended block. Empty data groups are
+    // left out, but the geometry groups are required even if empty.
+    static void addGroup(std::string& xml,
+                         const std::string& group,
+                         const std::vector<const DEMVtkXmlArray*>& arrays,
+                         std::vector<const DEMVtkXmlArray*>& blocks,
+                         uint64_t& offset,
+                         bool required = false) {
+        if (arrays.empty() && !required)
+            return;
+        xml += "      <" + group + ">\n";
+        for (const auto& arr : arrays) {
+            xml += "        <DataArray type=\"" + arr->type + "\" Name=\"" + arr->name + "\" NumberOfComponents=\"" +
+                   std::to_string(arr->nComp) + "\" format=\"appended\" offset=\"" + std::to_string(offset) +
+                   "\"/>\n";
+            blocks.push_back(arr);
+            offset += sizeof(uint64_t) + arr->bytes;
+        }
+        xml += "      </" + group + ">\n";
+    }
+};
+
+}  // namespace deme
+
+#endif
@@ -96,16 +96,53 @@ void doubleSortByKey(notStupidBool_t* d_keys_in,
                      size_t n,
                      cudaStream_t& this_stream,
                      DEMSolverStateData& scratchPad);
+// Radix sort is stable, so the spheres sharing a key (those of the same clump, for example) keep their relative order
+void mortonKeySortByKey(uint64_t* d_keys_in,
+                        uint64_t* d_keys_out,
+                        bodyID_t* d_vals_in,
+                        bodyID_t* d_vals_out,
+                        size_t n,
+                        cudaStream_t& this_stream,
+                        DEMSolverStateData& scratchPad);
+void contactIDSortByKey(bodyID_t* d_keys_in,
+                        bodyID_t* d_keys_out,
+                        contactPairs_t* d_vals_in,
+                        contactPairs_t* d_vals_out,
+                        size_t n,
+                        cudaStream_t& this_stream,
+                        DEMSolverStateData& scratchPad);
+// Stable too, so sorting by type after sorting by geometry A gives an array sorted by (type, geometry A)
+void contactTypeSortByKey(contact_t* d_keys_in,
+                          contact_t* d_keys_out,
+                          contactPairs_t* d_vals_in,
+                          contactPairs_t* d_vals_out,
+                          size_t n,
+                          cudaStream_t& this_stream,
+                          DEMSolverStateData& scratchPad);
+// The IDs of the contacts whose flags are non-zero, in increasing order; the number of them goes to d_num_out
+void contactIDSelectFlagged(notStupidBool_t* d_flags,
+                            contactPairs_t* d_out,
+                            size_t* d_num_out,
+                            size_t n,
+                            cudaStream_t& this_stream,
+                            DEMSolverStateData& scratchPad);
+// The same, for owner or sphere IDs
+void bodyIDSelectFlagged(notStupidBool_t* d_flags,
+                         bodyID_t* d_out,
+                         size_t* d_num_out,
+                         size_t n,
+                         cudaStream_t& this_stream,
+                         DEMSolverStateData& scratchPad);
 
 ////////////////////////////////////////////////////////////////////////////////
 // For kT and dT's private usage
 ////////////////////////////////////////////////////////////////////////////////
 
-void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
-                      std::shared_ptr<jitify::Program>& bin_triangle_kernels,
-                      std::shared_ptr<jitify::Program>& sphere_contact_kernels,
-                      std::shared_ptr<jitify::Program>& sphTri_contact_kernels,
-                      std::shared_ptr<jitify::Program>& history_kernels,
+void contactDetection(std::shared_ptr<JitProgram>& bin_sphere_kernels,
+                      std::shared_ptr<JitProgram>& bin_triangle_kernels,
+                      std::shared_ptr<JitProgram>& sphere_contact_kernels,
+                      std::shared_ptr<JitProgram>& sphTri_contact_kernels,
+                      std::shared_ptr<JitProgram>& history_kernels,
                       DEMDataKT* granData,
                       DEMSimParams* simParams,
                       SolverFlags& solverFlags,
@@ -118,13 +155,29 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
                       std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& previous_idGeometryB,
                       std::vector<contact_t, ManagedAllocator<contact_t>>& previous_contactType,
                       std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>>& contactMapping,
+                      DEMTriangleBVH& triangleBVH,
+                      DEMFixedSphereBinCache& fixedSphereBins,
+                      DEMBinProfiler& binProfiler,
                       cudaStream_t& this_stream,
                       DEMSolverStateData& scratchPad,
                       SolverTimers& timers,
                       kTStateParams& stateParams);
 
-void collectContactForcesThruCub(std::shared_ptr<jitify::Program>& collect_force_kernels,
+// Pack the contacts that have no partner in the previous contact array (and their positions in the contact array) into
+// the delta arrays, so only they need to be shipped to dT. Returns the number of such contacts.
+size_t buildContactDelta(std::shared_ptr<JitProgram>& history_kernels,
+                         DEMDataKT* granData,
+                         size_t nContactPairs,
+                         std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>>& newContactIdx,
+                         std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& newContact_idGeometryA,
+                         std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& newContact_idGeometryB,
+                         std::vector<contact_t, ManagedAllocator<contact_t>>& newContact_contactType,
+                         cudaStream_t& this_stream,
+                         DEMSolverStateData& scratchPad);
+
+void collectContactForcesThruCub(std::shared_ptr<JitProgram>& collect_force_kernels,
                                  DEMDataDT* granData,
+                                 DEMOwnerCSR& ownerCSR,
                                  const size_t nContactPairs,
                                  const size_t nClumps,
                                  bool contactPairArr_isFresh,
@@ -132,12 +185,23 @@ void collectContactForcesThruCub(std::shared_ptr<jitify::Program>& collect_force
                                  DEMSolverStateData& scratchPad,
                                  SolverTimers& timers);
 
+// Group the contacts by the force model they use (a stable sort, so a type-sorted contact array stays type-sorted in
+// each group)
+void groupContactsByForceModel(std::shared_ptr<JitProgram>& cal_force_kernels,
+                               DEMDataDT* granData,
+                               DEMForceModelGroups& groups,
+                               const size_t nContactPairs,
+                               const unsigned int nModels,
+                               cudaStream_t& this_stream,
+                               DEMSolverStateData& scratchPad);
+
 void overwritePrevContactArrays(DEMDataKT* kT_data,
                                 DEMDataDT* dT_data,
                                 std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& previous_idGeometryA,
                                 std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& previous_idGeometryB,
                                 std::vector<contact_t, ManagedAllocator<contact_t>>& previous_contactType,
                                 DEMSimParams* simParams,
+                                SolverFlags& solverFlags,
                                 DEMSolverStateData& scratchPad,
                                 cudaStream_t& this_stream,
                                 size_t nContacts);
@@ -17,15 +17,26 @@
 
 namespace deme {
 
-inline void contactEventArraysResize(size_t nContactPairs,
+// Resize the contact arrays to the number of contacts found, reporting the new sizes to the memory registry. When they
+// outgrow their capacity, they grow by at least DEME_CNT_ARRAY_GROWTH, so a creeping contact number does not get them
+// reallocated at each contact detection.
+inline void contactEventArraysResize(DEMSolverStateData& scratchPad,
                                      std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& idGeometryA,
                                      std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& idGeometryB,
                                      std::vector<contact_t, ManagedAllocator<contact_t>>& contactType,
                                      DEMDataKT* granData) {
-    //// TODO: not tracked? Gotta do something on it
-    // DEME_TRACKED_RESIZE(idGeometryA, nContactPairs);
-    // DEME_TRACKED_RESIZE(idGeometryB, nContactPairs);
-    // DEME_TRACKED_RESIZE(contactType, nContactPairs);
+    size_t nContactPairs = *scratchPad.pNumContacts;
+    if (nContactPairs > idGeometryA.capacity()) {
+        size_t new_cap = DEME_MAX(nContactPairs, (size_t)((double)idGeometryA.capacity() * DEME_CNT_ARRAY_GROWTH));
+        if (scratchPad.memRegistry) {
+            scratchPad.memRegistry->Reserve(&idGeometryA, "idGeometryA", sizeof(bodyID_t) * new_cap);
+            scratchPad.memRegistry->Reserve(&idGeometryB, "idGeometryB", sizeof(bodyID_t) * new_cap);
+            scratchPad.memRegistry->Reserve(&contactType, "contactType", sizeof(contact_t) * new_cap);
+        }
+        idGeometryA.reserve(new_cap);
+        idGeometryB.reserve(new_cap);
+        contactType.reserve(new_cap);
+    }
     idGeometryA.resize(nContactPairs);
     idGeometryB.resize(nContactPairs);
     contactType.resize(nContactPairs);
@@ -36,11 +47,489 @@ inline void contactEventArraysResize(size_t nContactPairs,
     granData->contactType = contactType.data();
 }
 
-void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
-                      std::shared_ptr<jitify::Program>& bin_triangle_kernels,
-                      std::shared_ptr<jitify::Program>& sphere_contact_kernels,
-                      std::shared_ptr<jitify::Program>& sphTri_contact_kernels,
-                      std::shared_ptr<jitify::Program>& history_kernels,
+// (Re)build the BVHs of the meshes that use BVH-based contact detection. A mesh's facets are contiguous in the facet
+// arrays, so each run of BVH facets with the same owner gets a BVH. Building only happens when meshes are added or
+// deformed; the boxes are refit at each contact detection instead.
+inline void buildTriangleBVH(std::shared_ptr<JitProgram>& bin_triangle_kernels,
+                             DEMDataKT* granData,
+                             DEMSimParams* simParams,
+                             SolverFlags& solverFlags,
+                             DEMTriangleBVH& bvh,
+                             cudaStream_t& this_stream,
+                             DEMSolverStateData& scratchPad) {
+    // The facet info is read on host
+    DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+    bvh.meshOwner.clear();
+    bvh.meshLeafStart.clear();
+    bvh.meshLeafCount.clear();
+    bvh.meshRoot.clear();
+    bvh.meshBoxMin.clear();
+    bvh.meshBoxMax.clear();
+    bvh.leafTriID.clear();
+    bvh.leafMesh.clear();
+    for (bodyID_t tri = 0; tri < simParams->nTriGM; tri++) {
+        if (!granData->triInBVH[tri])
+            continue;
+        const bodyID_t owner = granData->ownerMesh[tri];
+        if (bvh.meshOwner.empty() || bvh.meshOwner.back() != owner) {
+            bvh.meshOwner.push_back(owner);
+            bvh.meshLeafStart.push_back(bvh.leafTriID.size());
+            bvh.meshLeafCount.push_back(0);
+            bvh.meshBoxMin.push_back(make_float3(DEME_HUGE_FLOAT));
+            bvh.meshBoxMax.push_back(make_float3(-DEME_HUGE_FLOAT));
+        }
+        bvh.meshLeafCount.back()++;
+        bvh.leafTriID.push_back(tri);
+        bvh.leafMesh.push_back(bvh.meshOwner.size() - 1);
+        const bodyID_t node = granData->triNodeOffset[tri];
+        bvh.meshBoxMin.back() = fminf(
+            bvh.meshBoxMin.back(),
+            fminf(fminf(granData->relPosNode1[node], granData->relPosNode2[node]), granData->relPosNode3[node]));
+        bvh.meshBoxMax.back() = fmaxf(
+            bvh.meshBoxMax.back(),
+            fmaxf(fmaxf(granData->relPosNode1[node], granData->relPosNode2[node]), granData->relPosNode3[node]));
+    }
+    bvh.nMeshes = bvh.meshOwner.size();
+    bvh.nLeaves = bvh.leafTriID.size();
+    bvh.needRebuild = false;
+    const size_t nInternal = bvh.nLeaves - bvh.nMeshes;
+    for (size_t mesh = 0; mesh < bvh.nMeshes; mesh++) {
+        bvh.meshRoot.push_back((bvh.meshLeafCount[mesh] == 1) ? nInternal + bvh.meshLeafStart[mesh]
+                                                               : bvh.meshLeafStart[mesh] - mesh);
+    }
+    bvh.childL.resize(nInternal);
+    bvh.childR.resize(nInternal);
+    bvh.refitCount.resize(nInternal);
+    bvh.parent.resize(nInternal + bvh.nLeaves);
+    bvh.boxMin.resize(nInternal + bvh.nLeaves);
+    bvh.boxMax.resize(nInternal + bvh.nLeaves);
+    if (bvh.nLeaves == 0) {
+        return;
+    }
+
+    // Sort the leaves by their keys, then build the internal nodes from them. Temp vectors 8, 9 and 10 are free before
+    // the bin--triangle discretization.
+    size_t key_arr_bytes = bvh.nLeaves * sizeof(uint64_t);
+    uint64_t* keys = (uint64_t*)scratchPad.allocateDeviceTempVector(8, key_arr_bytes);
+    uint64_t* keys_sorted = (uint64_t*)scratchPad.allocateDeviceTempVector(9, key_arr_bytes);
+    bodyID_t* leafTriID_sorted = (bodyID_t*)scratchPad.allocateDeviceTempVector(10, bvh.nLeaves * sizeof(bodyID_t));
+    size_t blocks_needed_for_leaves = (bvh.nLeaves + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    bin_triangle_kernels->kernel("computeTriBVHLeafKeys")
+        .instantiate()
+        .configure(dim3(blocks_needed_for_leaves), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+        .launch(granData, bvh.leafTriID.data(), bvh.leafMesh.data(), bvh.meshBoxMin.data(), bvh.meshBoxMax.data(),
+                keys, bvh.nLeaves);
+    DEME_SYNC_UNLESS_NO_SYNC(solverFlags, this_stream);
+    // The mesh index is in the higher bits of the keys, so the leaves stay in their meshes' segments
+    cubDEMSortByKeys<uint64_t, bodyID_t, DEMSolverStateData>(keys, keys_sorted, bvh.leafTriID.data(), leafTriID_sorted,
+                                                             bvh.nLeaves, this_stream, scratchPad);
+    DEME_GPU_CALL(cudaMemcpyAsync(bvh.leafTriID.data(), leafTriID_sorted, bvh.nLeaves * sizeof(bodyID_t),
+                                  cudaMemcpyDeviceToDevice, this_stream));
+    bin_triangle_kernels->kernel("buildTriBVHInternalNodes")
+        .instantiate()
+        .configure(dim3(blocks_needed_for_leaves), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+        .launch(keys_sorted, bvh.leafMesh.data(), bvh.meshLeafStart.data(), bvh.meshLeafCount.data(),
+                bvh.childL.data(), bvh.childR.data(), bvh.parent.data(), bvh.nLeaves, nInternal);
+    DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+}
+
+// Contacts involving the coarse level of the bin hierarchy. Spheres larger than simParams->coarseSphereRadius are not
+// in the bins; they are sorted into a coarse grid whose cell size is twice the largest of them, and every sphere
+// queries the coarse cells in its reach, which are up to 3 per direction (27 in all). Binned facets, which cannot meet
+// the coarse spheres in bins, are checked against them by brute force, as coarse spheres are few. The contacts found
+// are appended to the contact arrays.
+inline void findCoarseLevelContacts(std::shared_ptr<JitProgram>& sphere_contact_kernels,
+                                    std::shared_ptr<JitProgram>& sphTri_contact_kernels,
+                                    DEMDataKT* granData,
+                                    DEMSimParams* simParams,
+                                    SolverFlags& solverFlags,
+                                    size_t nBinnedTri,
+                                    float3* sandwichANode1,
+                                    float3* sandwichANode2,
+                                    float3* sandwichANode3,
+                                    float3* sandwichBNode1,
+                                    float3* sandwichBNode2,
+                                    float3* sandwichBNode3,
+                                    std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& idGeometryA,
+                                    std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& idGeometryB,
+                                    std::vector<contact_t, ManagedAllocator<contact_t>>& contactType,
+                                    cudaStream_t& this_stream,
+                                    DEMSolverStateData& scratchPad) {
+    // All bin-related temp vectors from 8 on are retired by now
+    const size_t nSpheres = simParams->nSpheresGM;
+    size_t blocks_needed_for_spheres = (nSpheres + DEME_KT_CD_NTHREADS_PER_BLOCK - 1) / DEME_KT_CD_NTHREADS_PER_BLOCK;
+    bodyID_t* isCoarse = (bodyID_t*)scratchPad.allocateTempVector(8, nSpheres * sizeof(bodyID_t));
+    bodyID_t* isCoarseScan = (bodyID_t*)scratchPad.allocateTempVector(9, nSpheres * sizeof(bodyID_t));
+    sphere_contact_kernels->kernel("markCoarseSpheres")
+        .instantiate()
+        .configure(dim3(blocks_needed_for_spheres), dim3(DEME_KT_CD_NTHREADS_PER_BLOCK), 0, this_stream)
+        .launch(simParams, granData, isCoarse);
+    DEME_SYNC_UNLESS_NO_SYNC(solverFlags, this_stream);
+    cubDEMPrefixScan<bodyID_t, bodyID_t, DEMSolverStateData>(isCoarse, isCoarseScan, nSpheres, this_stream,
+                                                             scratchPad);
+    const size_t nCoarse = (size_t)isCoarseScan[nSpheres - 1] + (size_t)isCoarse[nSpheres - 1];
+    if (nCoarse == 0) {
+        return;
+    }
+
+    bodyID_t* coarseIDs = (bodyID_t*)scratchPad.allocateDeviceTempVector(10, nCoarse * sizeof(bodyID_t));
+    float* coarseRadii = (float*)scratchPad.allocateDeviceTempVector(11, nCoarse * sizeof(float));
+    sphere_contact_kernels->kernel("collectCoarseSpheres")
+        .instantiate()
+        .configure(dim3(blocks_needed_for_spheres), dim3(DEME_KT_CD_NTHREADS_PER_BLOCK), 0, this_stream)
+        .launch(simParams, granData, isCoarse, isCoarseScan, coarseIDs, coarseRadii);
+    DEME_SYNC_UNLESS_NO_SYNC(solverFlags, this_stream);
+    float* pMaxCoarseRadius = (float*)scratchPad.pTempSizeVar3;
+    cubDEMMax<float, DEMSolverStateData>(coarseRadii, pMaxCoarseRadius, nCoarse, this_stream, scratchPad);
+    const float maxCoarseRadius = *pMaxCoarseRadius;
+    const double cellSize = 2. * (double)maxCoarseRadius;
+    const uint64_t ncX = (uint64_t)((double)simParams->nbX * simParams->binSize / cellSize) + 1;
+    const uint64_t ncY = (uint64_t)((double)simParams->nbY * simParams->binSize / cellSize) + 1;
+    const uint64_t ncZ = (uint64_t)((double)simParams->nbZ * simParams->binSize / cellSize) + 1;
+
+    // Sort the coarse spheres by their cells
+    uint64_t* keys = (uint64_t*)scratchPad.allocateDeviceTempVector(12, nCoarse * sizeof(uint64_t));
+    uint64_t* keys_sorted = (uint64_t*)scratchPad.allocateDeviceTempVector(13, nCoarse * sizeof(uint64_t));
+    bodyID_t* coarseIDs_sorted = (bodyID_t*)scratchPad.allocateDeviceTempVector(14, nCoarse * sizeof(bodyID_t));
+    size_t blocks_needed_for_coarse = (nCoarse + DEME_KT_CD_NTHREADS_PER_BLOCK - 1) / DEME_KT_CD_NTHREADS_PER_BLOCK;
+    sphere_contact_kernels->kernel("computeCoarseCellKeys")
+        .instantiate()
+        .configure(dim3(blocks_needed_for_coarse), dim3(DEME_KT_CD_NTHREADS_PER_BLOCK), 0, this_stream)
+        .launch(simParams, granData, coarseIDs, keys, cellSize, ncX, ncY, ncZ, nCoarse);
+    DEME_SYNC_UNLESS_NO_SYNC(solverFlags, this_stream);
+    cubDEMSortByKeys<uint64_t, bodyID_t, DEMSolverStateData>(keys, keys_sorted, coarseIDs, coarseIDs_sorted, nCoarse,
+                                                             this_stream, scratchPad);
+
+    // Then count, scan and populate, the same one-two punch as in the bins. coarseIDs and coarseRadii retire now.
+    contactPairs_t* numCoarseContactsEachSphere =
+        (contactPairs_t*)scratchPad.allocateTempVector(10, nSpheres * sizeof(contactPairs_t));
+    contactPairs_t* coarseContactReportOffsets =
+        (contactPairs_t*)scratchPad.allocateTempVector(11, nSpheres * sizeof(contactPairs_t));
+    sphere_contact_kernels->kernel("getNumberOfCoarseLevelContacts")
+        .instantiate()
+        .configure(dim3(blocks_needed_for_spheres), dim3(DEME_KT_CD_NTHREADS_PER_BLOCK), 0, this_stream)
+        .launch(simParams, granData, isCoarse, keys_sorted, coarseIDs_sorted, numCoarseContactsEachSphere, nCoarse,
+                cellSize, ncX, ncY, ncZ, maxCoarseRadius);
+    DEME_SYNC_UNLESS_NO_SYNC(solverFlags, this_stream);
+    cubDEMPrefixScan<contactPairs_t, contactPairs_t, DEMSolverStateData>(
+        numCoarseContactsEachSphere, coarseContactReportOffsets, nSpheres, this_stream, scratchPad);
+    const size_t nCoarseContact =
+        (size_t)numCoarseContactsEachSphere[nSpheres - 1] + (size_t)coarseContactReportOffsets[nSpheres - 1];
+    if (nCoarseContact > 0) {
+        const size_t nContactBefore = *scratchPad.pNumContacts;
+        *scratchPad.pNumContacts += nCoarseContact;
+        if (*scratchPad.pNumContacts > idGeometryA.size()) {
+            contactEventArraysResize(scratchPad, idGeometryA, idGeometryB, contactType, granData);
+        }
+        sphere_contact_kernels->kernel("populateCoarseLevelContacts")
+            .instantiate()
+            .configure(dim3(blocks_needed_for_spheres), dim3(DEME_KT_CD_NTHREADS_PER_BLOCK), 0, this_stream)
+            .launch(simParams, granData, isCoarse, keys_sorted, coarseIDs_sorted, numCoarseContactsEachSphere,
+                    coarseContactReportOffsets, granData->idGeometryA + nContactBefore,
+                    granData->idGeometryB + nContactBefore, granData->contactType + nContactBefore, nCoarse, cellSize,
+                    ncX, ncY, ncZ, maxCoarseRadius);
+        DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+    }
+
+    // Coarse spheres vs binned facets. keys retired after sorting, so temp vector 12 holds the counter.
+    if (nBinnedTri > 0) {
+        contactPairs_t* pCounter = (contactPairs_t*)scratchPad.allocateTempVector(12, sizeof(contactPairs_t));
+        *pCounter = 0;
+        size_t nPairs = nCoarse * (size_t)simParams->nTriGM;
+        size_t blocks_needed_for_pairs = (nPairs + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+        sphTri_contact_kernels->kernel("getNumberOfCoarseSphTriContacts")
+            .instantiate()
+            .configure(dim3(blocks_needed_for_pairs), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+            .launch(simParams, granData, coarseIDs_sorted, sandwichANode1, sandwichANode2, sandwichANode3,
+                    sandwichBNode1, sandwichBNode2, sandwichBNode3, pCounter, nCoarse);
+        DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+        const size_t nCoarseTriContact = *pCounter;
+        if (nCoarseTriContact > 0) {
+            const size_t nContactBefore = *scratchPad.pNumContacts;
+            *scratchPad.pNumContacts += nCoarseTriContact;
+            if (*scratchPad.pNumContacts > idGeometryA.size()) {
+                contactEventArraysResize(scratchPad, idGeometryA, idGeometryB, contactType, granData);
+            }
+            *pCounter = 0;
+            sphTri_contact_kernels->kernel("populateCoarseSphTriContacts")
+                .instantiate()
+                .configure(dim3(blocks_needed_for_pairs), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+                .launch(simParams, granData, coarseIDs_sorted, sandwichANode1, sandwichANode2, sandwichANode3,
+                        sandwichBNode1, sandwichBNode2, sandwichBNode3, pCounter,
+                        granData->idGeometryA + nContactBefore, granData->idGeometryB + nContactBefore,
+                        granData->contactType + nContactBefore, nCoarse, nCoarseTriContact);
+            DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+            // Should the 2 sweeps disagree, the unused slots are marked
+            for (size_t i = *pCounter; i < nCoarseTriContact; i++) {
+                granData->contactType[nContactBefore + i] = NOT_A_CONTACT;
+            }
+        }
+    }
+}
+
+// Figure out how many contacts a sphere in contact typically has, and error out if it is abnormally high
+inline void checkAvgContactsPerSphere(size_t nContacts,
+                                      size_t nSpheresInContact,
+                                      SolverFlags& solverFlags,
+                                      VERBOSITY& verbosity,
+                                      kTStateParams& stateParams) {
+    stateParams.avgCntsPerSphere = (nSpheresInContact > 0) ? (float)nContacts / (float)nSpheresInContact : 0.0;
+
+    DEME_STEP_DEBUG_PRINTF("Average number of contacts for each geometry: %.7g", stateParams.avgCntsPerSphere);
+    if (stateParams.avgCntsPerSphere > solverFlags.errOutAvgSphCnts) {
+        DEME_ERROR(
+            "On average a sphere has %.7g contacts, more than the max allowance (%.7g).\nIf you believe "
+            "this is not abnormal, set the allowance high using SetErrorOutAvgContacts before "
+            "initialization.\nIf you think this is because dT drifting too much ahead of kT so the contact "
+            "margin added is too big, use SetCDMaxUpdateFreq to limit the max dT future drift.\nOtherwise, the "
+            "simulation may have diverged and relaxing the physics may help, such as decreasing the step size "
+            "and modifying material properties.\nIf this happens at the start of simulation, check if there "
+            "are initial penetrations, a.k.a. elements initialized inside walls.",
+            stateParams.avgCntsPerSphere, solverFlags.errOutAvgSphCnts);
+    }
+}
+
+// Map the new contacts to the previous ones through an open-addressing hash table keyed on (idA, idB, contact type).
+// Unlike the sort-based map, this needs neither sorting the contacts by geometry A nor run-length encoding them. The
+// previous contact array is kept in the order it was shipped to dT, so the map needs no re-arrangement either.
+inline void buildHashHistoryMap(std::shared_ptr<JitProgram>& history_kernels,
+                                DEMDataKT* granData,
+                                DEMSimParams* simParams,
+                                SolverFlags& solverFlags,
+                                VERBOSITY& verbosity,
+                                std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& previous_idGeometryA,
+                                std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& previous_idGeometryB,
+                                std::vector<contact_t, ManagedAllocator<contact_t>>& previous_contactType,
+                                std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>>& contactMapping,
+                                cudaStream_t& this_stream,
+                                DEMSolverStateData& scratchPad,
+                                kTStateParams& stateParams) {
+    size_t nContacts = *scratchPad.pNumContacts;
+    size_t nPrevContacts = *scratchPad.pNumPrevContacts;
+    size_t type_arr_bytes = nContacts * sizeof(contact_t);
+    size_t id_arr_bytes = nContacts * sizeof(bodyID_t);
+    size_t blocks_needed_for_contacts = (nContacts + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+
+    // dT potentially benefits from type-sorted contact array. Sort it before building the map, so the map refers to
+    // the order the contacts are shipped in.
+    if (solverFlags.should_sort_pairs) {
+        contact_t* contactType_sorted = (contact_t*)scratchPad.allocateDeviceTempVector(1, type_arr_bytes);
+        bodyID_t* idA_sorted = (bodyID_t*)scratchPad.allocateDeviceTempVector(2, id_arr_bytes);
+        bodyID_t* idB_sorted = (bodyID_t*)scratchPad.allocateDeviceTempVector(3, id_arr_bytes);
+
+        cubDEMSortByKeys<contact_t, bodyID_t, DEMSolverStateData>(granData->contactType, contactType_sorted,
+                                                                  granData->idGeometryB, idB_sorted, nContacts,
+                                                                  this_stream, scratchPad);
+        cubDEMSortByKeys<contact_t, bodyID_t, DEMSolverStateData>(granData->contactType, contactType_sorted,
+                                                                  granData->idGeometryA, idA_sorted, nContacts,
+                                                                  this_stream, scratchPad);
+
+        DEME_GPU_CALL(cudaMemcpy(granData->idGeometryA, idA_sorted, id_arr_bytes, cudaMemcpyDeviceToDevice));
+        DEME_GPU_CALL(cudaMemcpy(granData->idGeometryB, idB_sorted, id_arr_bytes, cudaMemcpyDeviceToDevice));
+        DEME_GPU_CALL(cudaMemcpy(granData->contactType, contactType_sorted, type_arr_bytes, cudaMemcpyDeviceToDevice));
+    }
+
+    // The number of spheres in contact is counted with a flag array, since the contacts are not sorted by geometry A
+    {
+        size_t flag_arr_bytes = simParams->nSpheresGM * sizeof(unsigned int);
+        unsigned int* inContact = (unsigned int*)scratchPad.allocateDeviceTempVector(0, flag_arr_bytes);
+        DEME_GPU_CALL(cudaMemset((void*)inContact, 0, flag_arr_bytes));
+        history_kernels->kernel("markSpheresInContact")
+            .instantiate()
+            .configure(dim3(blocks_needed_for_contacts), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+            .launch(granData->idGeometryA, granData->contactType, inContact, nContacts);
+        DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+        size_t* pNumSpheresInContact = scratchPad.pTempSizeVar1;
+        cubDEMSum<unsigned int, size_t, DEMSolverStateData>(inContact, pNumSpheresInContact, simParams->nSpheresGM,
+                                                            this_stream, scratchPad);
+        checkAvgContactsPerSphere(nContacts, *pNumSpheresInContact, solverFlags, verbosity, stateParams);
+    }
+
+    // Insert the previous contacts to the table, keeping the load factor no larger than 1/2
+    size_t capacity = 2;
+    while (capacity < 2 * nPrevContacts) {
+        capacity <<= 1;
+    }
+    size_t mask = capacity - 1;
+    unsigned long long* hashKeys =
+        (unsigned long long*)scratchPad.allocateDeviceTempVector(0, capacity * sizeof(unsigned long long));
+    contact_t* hashTypes = (contact_t*)scratchPad.allocateDeviceTempVector(1, capacity * sizeof(contact_t));
+    contactPairs_t* hashValues =
+        (contactPairs_t*)scratchPad.allocateDeviceTempVector(2, capacity * sizeof(contactPairs_t));
+    // 0xFF bytes make the empty key
+    DEME_GPU_CALL(cudaMemset((void*)hashKeys, 0xFF, capacity * sizeof(unsigned long long)));
+    size_t blocks_needed_for_prev = (nPrevContacts + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    if (blocks_needed_for_prev > 0) {
+        history_kernels->kernel("insertPrevContactsToHash")
+            .instantiate()
+            .configure(dim3(blocks_needed_for_prev), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+            .launch(granData, hashKeys, hashTypes, hashValues, mask, nPrevContacts);
+        DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+    }
+
+    // Then one pass over the new contacts gives the map
+    if (nContacts > contactMapping.size()) {
+        contactMapping.resize(nContacts);
+        granData->contactMapping = contactMapping.data();
+    }
+    history_kernels->kernel("lookupContactsInHash")
+        .instantiate()
+        .configure(dim3(blocks_needed_for_contacts), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+        .launch(granData, hashKeys, hashTypes, hashValues, granData->contactMapping, mask, nContacts);
+    DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+
+    // Finally, copy new contact array to old contact array for the record, in the shipped order
+    if (nContacts > previous_idGeometryA.size()) {
+        previous_idGeometryA.resize(nContacts);
+        previous_idGeometryB.resize(nContacts);
+        previous_contactType.resize(nContacts);
+
+        granData->previous_idGeometryA = previous_idGeometryA.data();
+        granData->previous_idGeometryB = previous_idGeometryB.data();
+        granData->previous_contactType = previous_contactType.data();
+    }
+    DEME_GPU_CALL(
+        cudaMemcpy(granData->previous_idGeometryA, granData->idGeometryA, id_arr_bytes, cudaMemcpyDeviceToDevice));
+    DEME_GPU_CALL(
+        cudaMemcpy(granData->previous_idGeometryB, granData->idGeometryB, id_arr_bytes, cudaMemcpyDeviceToDevice));
+    DEME_GPU_CALL(
+        cudaMemcpy(granData->previous_contactType, granData->contactType, type_arr_bytes, cudaMemcpyDeviceToDevice));
+}
+
+// Make sure the fixed-family bin cache holds the current bin touches of the fixed spheres: check it against the owner
+// states it was built for, and rebuild it if it no longer holds. Uses temp vectors 0 to 3, before the sphere binning.
+inline void updateFixedSphereBinCache(std::shared_ptr<JitProgram>& bin_sphere_kernels,
+                                      DEMDataKT* granData,
+                                      DEMSimParams* simParams,
+                                      SolverFlags& solverFlags,
+                                      DEMFixedSphereBinCache& cache,
+                                      cudaStream_t& this_stream,
+                                      DEMSolverStateData& scratchPad) {
+    const size_t nOwners = simParams->nOwnerBodies;
+    size_t blocks_needed_for_owners = (nOwners + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    bool rebuild = cache.needRebuild || cache.binSize != simParams->binSize || cache.ownerPos.size() != nOwners;
+    if (!rebuild && blocks_needed_for_owners > 0) {
+        notStupidBool_t* needRebuild = (notStupidBool_t*)scratchPad.allocateTempVector(0, sizeof(notStupidBool_t));
+        *needRebuild = 0;
+        bin_sphere_kernels->kernel("checkFixedBinCacheValid")
+            .instantiate()
+            .configure(dim3(blocks_needed_for_owners), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+            .launch(simParams, granData, cache.ownerPos.data(), cache.ownerOriQ.data(), cache.marginSize.data(),
+                    cache.ownerIsCached.data(), needRebuild, nOwners);
+        // The result is used on host right below
+        DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+        rebuild = (*needRebuild != 0);
+    }
+    if (!rebuild) {
+        return;
+    }
+
+    cache.ownerPos.resize(nOwners);
+    cache.ownerOriQ.resize(nOwners);
+    cache.marginSize.resize(nOwners);
+    cache.ownerIsCached.resize(nOwners);
+    if (blocks_needed_for_owners > 0) {
+        bin_sphere_kernels->kernel("recordFixedBinCacheStates")
+            .instantiate()
+            .configure(dim3(blocks_needed_for_owners), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+            .launch(simParams, granData, cache.ownerPos.data(), cache.ownerOriQ.data(), cache.marginSize.data(),
+                    cache.ownerIsCached.data(), nOwners);
+        DEME_SYNC_UNLESS_NO_SYNC(solverFlags, this_stream);
+    }
+    // Bin the fixed spheres just like the main binning does, only with the cache margins
+    binsSphereTouches_t* numBinsSphereTouches = (binsSphereTouches_t*)scratchPad.allocateTempVector(
+        0, simParams->nSpheresGM * sizeof(binsSphereTouches_t));
+    size_t blocks_needed_for_bodies =
+        (simParams->nSpheresGM + DEME_NUM_BODIES_PER_BLOCK - 1) / DEME_NUM_BODIES_PER_BLOCK;
+    bin_sphere_kernels->kernel("getNumberOfBinsEachSphereTouches")
+        .instantiate()
+        .configure(dim3(blocks_needed_for_bodies), dim3(DEME_NUM_BODIES_PER_BLOCK), 0, this_stream)
+        .launch(simParams, granData, numBinsSphereTouches, (objID_t*)nullptr, BIN_FIXED_SPHERES,
+                cache.marginSize.data());
+    DEME_SYNC_UNLESS_NO_SYNC(solverFlags, this_stream);
+    binSphereTouchPairs_t* numBinsSphereTouchesScan = (binSphereTouchPairs_t*)scratchPad.allocateTempVector(
+        1, (simParams->nSpheresGM + 1) * sizeof(binSphereTouchPairs_t));
+    cubDEMPrefixScan<binsSphereTouches_t, binSphereTouchPairs_t, DEMSolverStateData>(
+        numBinsSphereTouches, numBinsSphereTouchesScan, simParams->nSpheresGM, this_stream, scratchPad);
+    cache.nPairs = (size_t)numBinsSphereTouchesScan[simParams->nSpheresGM - 1] +
+                   (size_t)numBinsSphereTouches[simParams->nSpheresGM - 1];
+    numBinsSphereTouchesScan[simParams->nSpheresGM] = cache.nPairs;
+    cache.binIDs.resize(cache.nPairs);
+    cache.sphereIDs.resize(cache.nPairs);
+    bin_sphere_kernels->kernel("populateBinSphereTouchingPairs")
+        .instantiate()
+        .configure(dim3(blocks_needed_for_bodies), dim3(DEME_NUM_BODIES_PER_BLOCK), 0, this_stream)
+        .launch(simParams, granData, numBinsSphereTouchesScan, (binSphereTouchPairs_t*)nullptr, cache.binIDs.data(),
+                cache.sphereIDs.data(), (bodyID_t*)nullptr, (bodyID_t*)nullptr, (contact_t*)nullptr,
+                BIN_FIXED_SPHERES, cache.marginSize.data());
+    DEME_SYNC_UNLESS_NO_SYNC(solverFlags, this_stream);
+    cache.binSize = simParams->binSize;
+    cache.needRebuild = false;
+    DEME_DEBUG_PRINTF("Fixed-family bin cache rebuilt with %zu bin--sphere pairs", cache.nPairs);
+}
+
+// The bin occupancy profiler: histograms of spheres, triangles and sphere--sphere contacts over the active bins, plus
+// some summary numbers. The per-bin counts must be ready when this is called.
+inline void profileBinOccupancy(std::shared_ptr<JitProgram>& bin_sphere_kernels,
+                                DEMSimParams* simParams,
+                                kTStateParams& stateParams,
+                                DEMBinProfiler& profiler,
+                                spheresBinTouches_t* numSpheresBinTouches,
+                                size_t nActiveBins,
+                                trianglesBinTouches_t* numTrianglesBinTouches,
+                                size_t nActiveBinsForTri,
+                                binContactPairs_t* numSphContactsInEachBin,
+                                size_t nSphSphContacts,
+                                size_t nDenseBins,
+                                cudaStream_t& this_stream) {
+    const unsigned int nBuckets = DEME_BIN_PROFILE_NUM_BUCKETS;
+    profiler.counts.assign(3 * nBuckets, 0);
+    unsigned long long* sphHist = profiler.counts.data();
+    unsigned long long* triHist = sphHist + nBuckets;
+    unsigned long long* cntHist = triHist + nBuckets;
+    size_t blocks_needed_for_bins = (nActiveBins + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    if (blocks_needed_for_bins > 0) {
+        bin_sphere_kernels->kernel("profileSpheresPerBin")
+            .instantiate()
+            .configure(dim3(blocks_needed_for_bins), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+            .launch(numSpheresBinTouches, sphHist, nActiveBins);
+        bin_sphere_kernels->kernel("profileContactsPerBin")
+            .instantiate()
+            .configure(dim3(blocks_needed_for_bins), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+            .launch(numSphContactsInEachBin, cntHist, nActiveBins);
+    }
+    size_t blocks_needed_for_tri_bins =
+        (nActiveBinsForTri + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    if (blocks_needed_for_tri_bins > 0) {
+        bin_sphere_kernels->kernel("profileTrianglesPerBin")
+            .instantiate()
+            .configure(dim3(blocks_needed_for_tri_bins), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+            .launch(numTrianglesBinTouches, triHist, nActiveBinsForTri);
+    }
+    // The host reads the histograms right away
+    DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+
+    DEMBinOccupancyProfile& res = profiler.result;
+    res.valid = true;
+    res.binSize = simParams->binSize;
+    res.numBins = stateParams.numBins;
+    res.numActiveBins = nActiveBins;
+    res.numActiveBinsForTri = nActiveBinsForTri;
+    res.activeBinFraction = (res.numBins > 0) ? (double)nActiveBins / (double)res.numBins : 0.;
+    res.maxSpheresInBin = stateParams.maxSphFoundInBin;
+    res.maxTrianglesInBin = stateParams.maxTriFoundInBin;
+    res.numDenseBins = nDenseBins;
+    res.numSphSphContacts = nSphSphContacts;
+    res.spheresPerBin.assign(sphHist, sphHist + nBuckets);
+    res.trianglesPerBin.assign(triHist, triHist + nBuckets);
+    res.contactsPerBin.assign(cntHist, cntHist + nBuckets);
+}
+
+void contactDetection(std::shared_ptr<JitProgram>& bin_sphere_kernels,
+                      std::shared_ptr<JitProgram>& bin_triangle_kernels,
+                      std::shared_ptr<JitProgram>& sphere_contact_kernels,
+                      std::shared_ptr<JitProgram>& sphTri_contact_kernels,
+                      std::shared_ptr<JitProgram>& history_kernels,
                       DEMDataKT* granData,
                       DEMSimParams* simParams,
                       SolverFlags& solverFlags,
@@ -52,6 +541,9 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
                       std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& previous_idGeometryB,
                       std::vector<contact_t, ManagedAllocator<contact_t>>& previous_contactType,
                       std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>>& contactMapping,
+                      DEMTriangleBVH& triangleBVH,
+                      DEMFixedSphereBinCache& fixedSphereBins,
+                      DEMBinProfiler& binProfiler,
                       cudaStream_t& this_stream,
                       DEMSolverStateData& scratchPad,
                       SolverTimers& timers,
@@ -78,6 +570,14 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
         // Sphere-related discretization & sphere--analytical contact detection
         ////////////////////////////////////////////////////////////////////////////////
 
+        // Fixed spheres are binned from the cache, which is built on the first use and whenever it no longer holds
+        const unsigned int binWhich = solverFlags.useFixedBinCache ? BIN_NON_FIXED_SPHERES : BIN_ALL_SPHERES;
+        if (solverFlags.useFixedBinCache) {
+            updateFixedSphereBinCache(bin_sphere_kernels, granData, simParams, solverFlags, fixedSphereBins,
+                                      this_stream, scratchPad);
+        }
+        const size_t nCachedPairs = solverFlags.useFixedBinCache ? fixedSphereBins.nPairs : 0;
+
         // 1st step: register the number of sphere--bin touching pairs for each sphere for further processing
         CD_temp_arr_bytes = simParams->nSpheresGM * sizeof(binsSphereTouches_t);
         binsSphereTouches_t* numBinsSphereTouches =
@@ -92,8 +592,9 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
         bin_sphere_kernels->kernel("getNumberOfBinsEachSphereTouches")
             .instantiate()
             .configure(dim3(blocks_needed_for_bodies), dim3(DEME_NUM_BODIES_PER_BLOCK), 0, this_stream)
-            .launch(simParams, granData, numBinsSphereTouches, numAnalGeoSphereTouches);
-        DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+            .launch(simParams, granData, numBinsSphereTouches, numAnalGeoSphereTouches, binWhich,
+                    fixedSphereBins.marginSize.data());
+        DEME_SYNC_UNLESS_NO_SYNC(solverFlags, this_stream);
 
         // 2nd step: prefix scan sphere--bin touching pairs
         // The last element of this scanned array is useful: it can be used to check if the 2 sweeps reach the same
@@ -118,24 +619,35 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
                                      (size_t)numAnalGeoSphereTouchesScan[simParams->nSpheresGM - 1];
         numAnalGeoSphereTouchesScan[simParams->nSpheresGM] = *(scratchPad.pNumContacts);
         if (*scratchPad.pNumContacts > idGeometryA.size()) {
-            contactEventArraysResize(*scratchPad.pNumContacts, idGeometryA, idGeometryB, contactType, granData);
+            contactEventArraysResize(scratchPad, idGeometryA, idGeometryB, contactType, granData);
         }
         // std::cout << *pNumBinSphereTouchPairs << std::endl;
         // displayArray<binsSphereTouches_t>(numBinsSphereTouches, simParams->nSpheresGM);
         // displayArray<binSphereTouchPairs_t>(numBinsSphereTouchesScan, simParams->nSpheresGM);
 
         // 3rd step: use a custom kernel to figure out all sphere--bin touching pairs. Note numBinsSphereTouches can
-        // retire now so we allocate on temp vector 0 and re-use vector 2.
-        CD_temp_arr_bytes = (*pNumBinSphereTouchPairs) * sizeof(binID_t);
-        binID_t* binIDsEachSphereTouches = (binID_t*)scratchPad.allocateTempVector(0, CD_temp_arr_bytes);
-        CD_temp_arr_bytes = (*pNumBinSphereTouchPairs) * sizeof(bodyID_t);
-        bodyID_t* sphereIDsEachBinTouches = (bodyID_t*)scratchPad.allocateTempVector(2, CD_temp_arr_bytes);
+        // retire now so we allocate on temp vector 0 and re-use vector 2. The cached pairs of fixed spheres go after
+        // the ones found here.
+        CD_temp_arr_bytes = (*pNumBinSphereTouchPairs + nCachedPairs) * sizeof(binID_t);
+        binID_t* binIDsEachSphereTouches = (binID_t*)scratchPad.allocateDeviceTempVector(0, CD_temp_arr_bytes);
+        CD_temp_arr_bytes = (*pNumBinSphereTouchPairs + nCachedPairs) * sizeof(bodyID_t);
+        bodyID_t* sphereIDsEachBinTouches = (bodyID_t*)scratchPad.allocateDeviceTempVector(2, CD_temp_arr_bytes);
         // This kernel is also responsible of figuring out sphere--analytical geometry pairs
         bin_sphere_kernels->kernel("populateBinSphereTouchingPairs")
             .instantiate()
             .configure(dim3(blocks_needed_for_bodies), dim3(DEME_NUM_BODIES_PER_BLOCK), 0, this_stream)
             .launch(simParams, granData, numBinsSphereTouchesScan, numAnalGeoSphereTouchesScan, binIDsEachSphereTouches,
-                    sphereIDsEachBinTouches, granData->idGeometryA, granData->idGeometryB, granData->contactType);
+                    sphereIDsEachBinTouches, granData->idGeometryA, granData->idGeometryB, granData->contactType,
+                    binWhich, fixedSphereBins.marginSize.data());
+        if (nCachedPairs > 0) {
+            DEME_GPU_CALL(cudaMemcpyAsync(binIDsEachSphereTouches + *pNumBinSphereTouchPairs,
+                                          fixedSphereBins.binIDs.data(), nCachedPairs * sizeof(binID_t),
+                                          cudaMemcpyDeviceToDevice, this_stream));
+            DEME_GPU_CALL(cudaMemcpyAsync(sphereIDsEachBinTouches + *pNumBinSphereTouchPairs,
+                                          fixedSphereBins.sphereIDs.data(), nCachedPairs * sizeof(bodyID_t),
+                                          cudaMemcpyDeviceToDevice, this_stream));
+            *pNumBinSphereTouchPairs += nCachedPairs;
+        }
         DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
         // std::cout << "Unsorted bin IDs: ";
         // displayArray<binID_t>(binIDsEachSphereTouches, *pNumBinSphereTouchPairs);
@@ -146,9 +658,9 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
         // numBinsSphereTouchesScan can retire now so we re-use vector 1 and 3 (analytical contacts have been
         // processed).
         CD_temp_arr_bytes = (*pNumBinSphereTouchPairs) * sizeof(bodyID_t);
-        bodyID_t* sphereIDsEachBinTouches_sorted = (bodyID_t*)scratchPad.allocateTempVector(1, CD_temp_arr_bytes);
+        bodyID_t* sphereIDsEachBinTouches_sorted = (bodyID_t*)scratchPad.allocateDeviceTempVector(1, CD_temp_arr_bytes);
         CD_temp_arr_bytes = (*pNumBinSphereTouchPairs) * sizeof(binID_t);
-        binID_t* binIDsEachSphereTouches_sorted = (binID_t*)scratchPad.allocateTempVector(3, CD_temp_arr_bytes);
+        binID_t* binIDsEachSphereTouches_sorted = (binID_t*)scratchPad.allocateDeviceTempVector(3, CD_temp_arr_bytes);
         // hostSortByKey<binID_t, bodyID_t>(granData->binIDsEachSphereTouches, granData->sphereIDsEachBinTouches,
         //                                  *pNumBinSphereTouchPairs);
         cubDEMSortByKeys<binID_t, bodyID_t, DEMSolverStateData>(binIDsEachSphereTouches, binIDsEachSphereTouches_sorted,
@@ -194,7 +706,7 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
         // spheres. Note binIDsEachSphereTouches_sorted can retire so we allocate on temp vector 3.
         CD_temp_arr_bytes = (*pNumActiveBins) * sizeof(binSphereTouchPairs_t);
         binSphereTouchPairs_t* sphereIDsLookUpTable =
-            (binSphereTouchPairs_t*)scratchPad.allocateTempVector(3, CD_temp_arr_bytes);
+            (binSphereTouchPairs_t*)scratchPad.allocateDeviceTempVector(3, CD_temp_arr_bytes);
         cubDEMPrefixScan<spheresBinTouches_t, binSphereTouchPairs_t, DEMSolverStateData>(
             numSpheresBinTouches, sphereIDsLookUpTable, *pNumActiveBins, this_stream, scratchPad);
         // std::cout << "sphereIDsLookUpTable: ";
@@ -209,29 +721,39 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
         size_t* pNumActiveBinsForTri = scratchPad.pTempSizeVar1;  // TempVar1 is now free (Temp2 is not tho)
         binID_t *mapTriActBinToSphActBin, *activeBinIDsForTri;
         bodyID_t* triIDsEachBinTouches_sorted;
-        trianglesBinTouches_t* numTrianglesBinTouches;
+        trianglesBinTouches_t* numTrianglesBinTouches = NULL;
         binsTriangleTouchPairs_t* triIDsLookUpTable;
         float3 *sandwichANode1, *sandwichANode2, *sandwichANode3, *sandwichBNode1, *sandwichBNode2, *sandwichBNode3;
+        // Facets of meshes using BVHs do not go through the bins
+        size_t nBinnedTri = 0;
+        size_t blocks_needed_for_tri = 0;
         if (simParams->nTriGM > 0) {
             // 0-th step: Make `sandwich' for each triangle (or say, create a prism out of each triangle). This is
             // obviously for our delayed contact detection safety. And finally, if a sphere's distance away from one of
             // the 2 prism surfaces is smaller than its radius, it has contact with this prism, hence potentially with
             // this triangle.
             CD_temp_arr_bytes = simParams->nTriGM * sizeof(float3) * 3;
-            sandwichANode1 = (float3*)scratchPad.allocateTempVector(6, CD_temp_arr_bytes);
+            sandwichANode1 = (float3*)scratchPad.allocateDeviceTempVector(6, CD_temp_arr_bytes);
             sandwichANode2 = sandwichANode1 + simParams->nTriGM;
             sandwichANode3 = sandwichANode2 + simParams->nTriGM;
-            sandwichBNode1 = (float3*)scratchPad.allocateTempVector(7, CD_temp_arr_bytes);
+            sandwichBNode1 = (float3*)scratchPad.allocateDeviceTempVector(7, CD_temp_arr_bytes);
             sandwichBNode2 = sandwichBNode1 + simParams->nTriGM;
             sandwichBNode3 = sandwichBNode2 + simParams->nTriGM;
-            size_t blocks_needed_for_tri =
-                (simParams->nTriGM + DEME_NUM_TRIANGLE_PER_BLOCK - 1) / DEME_NUM_TRIANGLE_PER_BLOCK;
+            blocks_needed_for_tri = (simParams->nTriGM + DEME_NUM_TRIANGLE_PER_BLOCK - 1) / DEME_NUM_TRIANGLE_PER_BLOCK;
             bin_triangle_kernels->kernel("makeTriangleSandwich")
                 .instantiate()
                 .configure(dim3(blocks_needed_for_tri), dim3(DEME_NUM_TRIANGLE_PER_BLOCK), 0, this_stream)
                 .launch(simParams, granData, sandwichANode1, sandwichANode2, sandwichANode3, sandwichBNode1,
                         sandwichBNode2, sandwichBNode3);
-            DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+            DEME_SYNC_UNLESS_NO_SYNC(solverFlags, this_stream);
+
+            if (triangleBVH.needRebuild) {
+                buildTriangleBVH(bin_triangle_kernels, granData, simParams, solverFlags, triangleBVH, this_stream,
+                                 scratchPad);
+            }
+            nBinnedTri = simParams->nTriGM - triangleBVH.nLeaves;
+        }
+        if (nBinnedTri > 0) {
 
             // 1st step: register the number of triangle--bin touching pairs for each triangle for further processing.
             // Because we do a `sandwich' contact detection, we are
@@ -244,7 +766,7 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
                     .configure(dim3(blocks_needed_for_tri), dim3(DEME_NUM_TRIANGLE_PER_BLOCK), 0, this_stream)
                     .launch(simParams, granData, numBinsTriTouches, sandwichANode1, sandwichANode2, sandwichANode3,
                             sandwichBNode1, sandwichBNode2, sandwichBNode3);
-                DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+                DEME_SYNC_UNLESS_NO_SYNC(solverFlags, this_stream);
             }
             // std::cout << "numBinsTriTouches: " << std::endl;
             // displayArray<binsTriangleTouches_t>(numBinsTriTouches, simParams->nTriGM);
@@ -266,9 +788,9 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // 3rd step: use a custom kernel to figure out all sphere--bin touching pairs. Note numBinsTriTouches can
             // retire now so we allocate on temp vector 8.
             CD_temp_arr_bytes = numBinTriTouchPairs * sizeof(binID_t);
-            binID_t* binIDsEachTriTouches = (binID_t*)scratchPad.allocateTempVector(8, CD_temp_arr_bytes);
+            binID_t* binIDsEachTriTouches = (binID_t*)scratchPad.allocateDeviceTempVector(8, CD_temp_arr_bytes);
             CD_temp_arr_bytes = numBinTriTouchPairs * sizeof(bodyID_t);
-            bodyID_t* triIDsEachBinTouches = (bodyID_t*)scratchPad.allocateTempVector(10, CD_temp_arr_bytes);
+            bodyID_t* triIDsEachBinTouches = (bodyID_t*)scratchPad.allocateDeviceTempVector(10, CD_temp_arr_bytes);
             {
                 bin_triangle_kernels->kernel("populateBinTriangleTouchingPairs")
                     .instantiate()
@@ -284,9 +806,9 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // 4th step: allocate and populate SORTED binIDsEachTriTouches and triIDsEachBinTouches. Note
             // numBinsTriTouchesScan can retire now so we re-use vector 9 and allocate 11.
             CD_temp_arr_bytes = numBinTriTouchPairs * sizeof(bodyID_t);
-            triIDsEachBinTouches_sorted = (bodyID_t*)scratchPad.allocateTempVector(9, CD_temp_arr_bytes);
+            triIDsEachBinTouches_sorted = (bodyID_t*)scratchPad.allocateDeviceTempVector(9, CD_temp_arr_bytes);
             CD_temp_arr_bytes = numBinTriTouchPairs * sizeof(binID_t);
-            binID_t* binIDsEachTriTouches_sorted = (binID_t*)scratchPad.allocateTempVector(11, CD_temp_arr_bytes);
+            binID_t* binIDsEachTriTouches_sorted = (binID_t*)scratchPad.allocateDeviceTempVector(11, CD_temp_arr_bytes);
             cubDEMSortByKeys<binID_t, bodyID_t, DEMSolverStateData>(binIDsEachTriTouches, binIDsEachTriTouches_sorted,
                                                                     triIDsEachBinTouches, triIDsEachBinTouches_sorted,
                                                                     numBinTriTouchPairs, this_stream, scratchPad);
@@ -302,7 +824,7 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             CD_temp_arr_bytes = (*pNumActiveBinsForTri) * sizeof(binID_t);
             activeBinIDsForTri = (binID_t*)scratchPad.allocateTempVector(8, CD_temp_arr_bytes);
             CD_temp_arr_bytes = (*pNumActiveBinsForTri) * sizeof(trianglesBinTouches_t);
-            numTrianglesBinTouches = (trianglesBinTouches_t*)scratchPad.allocateTempVector(10, CD_temp_arr_bytes);
+            numTrianglesBinTouches = (trianglesBinTouches_t*)scratchPad.allocateDeviceTempVector(10, CD_temp_arr_bytes);
             cubDEMRunLengthEncode<binID_t, trianglesBinTouches_t, DEMSolverStateData>(
                 binIDsEachTriTouches_sorted, activeBinIDsForTri, numTrianglesBinTouches, pNumActiveBinsForTri,
                 numBinTriTouchPairs, this_stream, scratchPad);
@@ -346,7 +868,7 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // 7th step: scan to find the offsets that are used to index into triIDsEachBinTouches_sorted to obtain
             // bin-wise triangles. Note binIDsEachTriTouches_sorted can retire so we allocate on temp vector 11.
             CD_temp_arr_bytes = (*pNumActiveBinsForTri) * sizeof(binsTriangleTouchPairs_t);
-            triIDsLookUpTable = (binsTriangleTouchPairs_t*)scratchPad.allocateTempVector(11, CD_temp_arr_bytes);
+            triIDsLookUpTable = (binsTriangleTouchPairs_t*)scratchPad.allocateDeviceTempVector(11, CD_temp_arr_bytes);
             cubDEMPrefixScan<trianglesBinTouches_t, binsTriangleTouchPairs_t, DEMSolverStateData>(
                 numTrianglesBinTouches, triIDsLookUpTable, *pNumActiveBinsForTri, this_stream, scratchPad);
         }
@@ -369,18 +891,63 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
         size_t blocks_needed_for_bins_tri = 0;
         // binContactPairs_t also doubles as the type for the number of tri--sph contact pairs
         binContactPairs_t* numTriSphContactsInEachBin;
-        if (simParams->nTriGM > 0) {
+        if (nBinnedTri > 0) {
             blocks_needed_for_bins_tri = *pNumActiveBinsForTri;
             CD_temp_arr_bytes = (*pNumActiveBinsForTri) * sizeof(binContactPairs_t);
             numTriSphContactsInEachBin = (binContactPairs_t*)scratchPad.allocateTempVector(13, CD_temp_arr_bytes);
         }
 
+        // Bins that have too many spheres for one block are split into pairs of sphere tiles, and each tile pair is
+        // one block's work in the dense-bin kernels. If no bin is that dense, which is the usual case, nothing is done.
+        size_t nDenseBinWork = 0;
+        size_t nDenseBins = 0;
+        binID_t* denseWorkBin = NULL;
+        binSphereTouchPairs_t* denseWorkTilePair = NULL;
+        if (stateParams.maxSphFoundInBin > DEME_MAX_SPHERES_PER_BIN_SINGLE_BLOCK) {
+            // numSpheresBinTouches is ready on host since cubDEMMax
+            for (size_t i = 0; i < *pNumActiveBins; i++) {
+                if (numSpheresBinTouches[i] > DEME_MAX_SPHERES_PER_BIN_SINGLE_BLOCK) {
+                    size_t nTiles = ((size_t)numSpheresBinTouches[i] + DEME_NUM_SPHERES_PER_CD_BATCH - 1) /
+                                    DEME_NUM_SPHERES_PER_CD_BATCH;
+                    nDenseBinWork += nTiles * (nTiles + 1) / 2;
+                    nDenseBins++;
+                }
+            }
+            CD_temp_arr_bytes = nDenseBinWork * sizeof(binID_t);
+            denseWorkBin = (binID_t*)scratchPad.allocateTempVector(15, CD_temp_arr_bytes);
+            CD_temp_arr_bytes = nDenseBinWork * sizeof(binSphereTouchPairs_t);
+            denseWorkTilePair = (binSphereTouchPairs_t*)scratchPad.allocateTempVector(16, CD_temp_arr_bytes);
+            size_t work = 0;
+            for (size_t i = 0; i < *pNumActiveBins; i++) {
+                if (numSpheresBinTouches[i] > DEME_MAX_SPHERES_PER_BIN_SINGLE_BLOCK) {
+                    size_t nTiles = ((size_t)numSpheresBinTouches[i] + DEME_NUM_SPHERES_PER_CD_BATCH - 1) /
+                                    DEME_NUM_SPHERES_PER_CD_BATCH;
+                    for (size_t j = 0; j < nTiles * (nTiles + 1) / 2; j++) {
+                        denseWorkBin[work] = i;
+                        denseWorkTilePair[work] = j;
+                        work++;
+                    }
+                }
+            }
+            DEME_DEBUG_PRINTF("%zu bins are too dense for one block each; they are split into %zu tile pairs.",
+                              nDenseBins, nDenseBinWork);
+        }
+
         if (blocks_needed_for_bins_sph > 0) {
             sphere_contact_kernels->kernel("getNumberOfSphereContactsEachBin")
                 .instantiate()
                 .configure(dim3(blocks_needed_for_bins_sph), dim3(DEME_KT_CD_NTHREADS_PER_BLOCK), 0, this_stream)
                 .launch(simParams, granData, sphereIDsEachBinTouches_sorted, activeBinIDs, numSpheresBinTouches,
                         sphereIDsLookUpTable, numSphContactsInEachBin, *pNumActiveBins);
+            // Dense bins' counts are added to what the last kernel marked (0), so it has to come after
+            if (nDenseBinWork > 0) {
+                sphere_contact_kernels->kernel("getNumberOfSphereContactsDenseBins")
+                    .instantiate()
+                    .configure(dim3(nDenseBinWork), dim3(DEME_KT_CD_NTHREADS_PER_BLOCK), 0, this_stream)
+                    .launch(simParams, granData, sphereIDsEachBinTouches_sorted, activeBinIDs, numSpheresBinTouches,
+                            sphereIDsLookUpTable, denseWorkBin, denseWorkTilePair, numSphContactsInEachBin,
+                            nDenseBinWork);
+            }
             DEME_GPU_CALL_WATCH_BETA(cudaStreamSynchronize(this_stream));
 
             if (blocks_needed_for_bins_tri > 0) {
@@ -415,7 +982,7 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             cubDEMPrefixScan<binContactPairs_t, contactPairs_t, DEMSolverStateData>(
                 numSphContactsInEachBin, sphSphContactReportOffsets, *pNumActiveBins, this_stream, scratchPad);
             contactPairs_t* triSphContactReportOffsets;
-            if (simParams->nTriGM > 0) {
+            if (nBinnedTri > 0) {
                 CD_temp_arr_bytes = (*pNumActiveBinsForTri + 1) * sizeof(contactPairs_t);
                 triSphContactReportOffsets = (contactPairs_t*)scratchPad.allocateTempVector(14, CD_temp_arr_bytes);
                 cubDEMPrefixScan<binContactPairs_t, contactPairs_t, DEMSolverStateData>(
@@ -434,9 +1001,15 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             size_t nSphereSphereContact = (size_t)numSphContactsInEachBin[*pNumActiveBins - 1] +
                                           (size_t)sphSphContactReportOffsets[*pNumActiveBins - 1];
             sphSphContactReportOffsets[*pNumActiveBins] = nSphereSphereContact;
+            if (binProfiler.runThisTime) {
+                size_t nActiveBinsForTri = (nBinnedTri > 0) ? *pNumActiveBinsForTri : 0;
+                profileBinOccupancy(bin_sphere_kernels, simParams, stateParams, binProfiler, numSpheresBinTouches,
+                                    *pNumActiveBins, numTrianglesBinTouches, nActiveBinsForTri,
+                                    numSphContactsInEachBin, nSphereSphereContact, nDenseBins, this_stream);
+            }
 
             size_t nTriSphereContact = 0;
-            if (simParams->nTriGM > 0) {
+            if (nBinnedTri > 0) {
                 nTriSphereContact = (size_t)numTriSphContactsInEachBin[*pNumActiveBinsForTri - 1] +
                                     (size_t)triSphContactReportOffsets[*pNumActiveBinsForTri - 1];
                 triSphContactReportOffsets[*pNumActiveBinsForTri] = nTriSphereContact;
@@ -446,19 +1019,32 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
 
             *scratchPad.pNumContacts = nSphereSphereContact + nSphereGeoContact + nTriSphereContact;
             if (*scratchPad.pNumContacts > idGeometryA.size()) {
-                contactEventArraysResize(*scratchPad.pNumContacts, idGeometryA, idGeometryB, contactType, granData);
+                contactEventArraysResize(scratchPad, idGeometryA, idGeometryB, contactType, granData);
             }
 
             // Sphere--sphere contact pairs go after sphere--anal-geo contacts
             bodyID_t* idSphA = (granData->idGeometryA + nSphereGeoContact);
             bodyID_t* idSphB = (granData->idGeometryB + nSphereGeoContact);
             contact_t* dType = (granData->contactType + nSphereGeoContact);
+            // The per-bin contact counts are used up, so the dense bins' entries become the write cursors that the
+            // blocks sharing a dense bin atomically advance
+            for (size_t work = 0; work < nDenseBinWork; work++) {
+                numSphContactsInEachBin[denseWorkBin[work]] = 0;
+            }
             // Then fill in those contacts
             sphere_contact_kernels->kernel("populateSphSphContactPairsEachBin")
                 .instantiate()
                 .configure(dim3(blocks_needed_for_bins_sph), dim3(DEME_KT_CD_NTHREADS_PER_BLOCK), 0, this_stream)
                 .launch(simParams, granData, sphereIDsEachBinTouches_sorted, activeBinIDs, numSpheresBinTouches,
                         sphereIDsLookUpTable, sphSphContactReportOffsets, idSphA, idSphB, dType, *pNumActiveBins);
+            if (nDenseBinWork > 0) {
+                sphere_contact_kernels->kernel("populateSphSphContactPairsDenseBins")
+                    .instantiate()
+                    .configure(dim3(nDenseBinWork), dim3(DEME_KT_CD_NTHREADS_PER_BLOCK), 0, this_stream)
+                    .launch(simParams, granData, sphereIDsEachBinTouches_sorted, activeBinIDs, numSpheresBinTouches,
+                            sphereIDsLookUpTable, denseWorkBin, denseWorkTilePair, sphSphContactReportOffsets,
+                            numSphContactsInEachBin, idSphA, idSphB, dType, nDenseBinWork);
+            }
             DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
 
             // Triangle--sphere contact pairs go after sphere--sphere contacts. Remember to mark their type.
@@ -480,7 +1066,75 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
                 // displayArray<bodyID_t>(granData->idGeometryB, *scratchPad.pNumContacts);
                 // displayArray<contact_t>(granData->contactType, *scratchPad.pNumContacts);
             }
+
+            // Then the spheres query the BVH meshes. Their contacts go last. All tri-related temp vectors except the
+            // sandwiches are free now.
+            if (triangleBVH.nLeaves > 0) {
+                const size_t nInternal = triangleBVH.nLeaves - triangleBVH.nMeshes;
+                if (nInternal > 0) {
+                    DEME_GPU_CALL(cudaMemsetAsync(triangleBVH.refitCount.data(), 0, nInternal * sizeof(unsigned int),
+                                                  this_stream));
+                }
+                size_t blocks_needed_for_leaves =
+                    (triangleBVH.nLeaves + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+                bin_triangle_kernels->kernel("refitTriBVH")
+                    .instantiate()
+                    .configure(dim3(blocks_needed_for_leaves), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+                    .launch(triangleBVH.leafTriID.data(), triangleBVH.childL.data(), triangleBVH.childR.data(),
+                            triangleBVH.parent.data(), triangleBVH.boxMin.data(), triangleBVH.boxMax.data(),
+                            triangleBVH.refitCount.data(), sandwichANode1, sandwichANode2, sandwichANode3,
+                            sandwichBNode1, sandwichBNode2, sandwichBNode3, triangleBVH.nLeaves, nInternal);
+                DEME_SYNC_UNLESS_NO_SYNC(solverFlags, this_stream);
+
+                CD_temp_arr_bytes = simParams->nSpheresGM * sizeof(contactPairs_t);
+                contactPairs_t* numBVHContactsEachSphere =
+                    (contactPairs_t*)scratchPad.allocateTempVector(8, CD_temp_arr_bytes);
+                contactPairs_t* BVHContactReportOffsets =
+                    (contactPairs_t*)scratchPad.allocateTempVector(9, CD_temp_arr_bytes);
+                // Traversal uses a per-thread stack, so smaller blocks are used
+                size_t blocks_needed_for_spheres =
+                    (simParams->nSpheresGM + DEME_KT_CD_NTHREADS_PER_BLOCK - 1) / DEME_KT_CD_NTHREADS_PER_BLOCK;
+                sphTri_contact_kernels->kernel("getNumberOfSphTriContactsInBVHs")
+                    .instantiate()
+                    .configure(dim3(blocks_needed_for_spheres), dim3(DEME_KT_CD_NTHREADS_PER_BLOCK), 0, this_stream)
+                    .launch(simParams, granData, triangleBVH.meshOwner.data(), triangleBVH.meshRoot.data(),
+                            triangleBVH.leafTriID.data(), triangleBVH.childL.data(), triangleBVH.childR.data(),
+                            triangleBVH.boxMin.data(), triangleBVH.boxMax.data(), sandwichANode1, sandwichANode2,
+                            sandwichANode3, sandwichBNode1, sandwichBNode2, sandwichBNode3, numBVHContactsEachSphere,
+                            triangleBVH.nMeshes, nInternal);
+                DEME_SYNC_UNLESS_NO_SYNC(solverFlags, this_stream);
+                cubDEMPrefixScan<contactPairs_t, contactPairs_t, DEMSolverStateData>(
+                    numBVHContactsEachSphere, BVHContactReportOffsets, simParams->nSpheresGM, this_stream, scratchPad);
+                size_t nBVHContact = (size_t)numBVHContactsEachSphere[simParams->nSpheresGM - 1] +
+                                     (size_t)BVHContactReportOffsets[simParams->nSpheresGM - 1];
+                if (nBVHContact > 0) {
+                    size_t nContactBeforeBVH = *scratchPad.pNumContacts;
+                    *scratchPad.pNumContacts += nBVHContact;
+                    if (*scratchPad.pNumContacts > idGeometryA.size()) {
+                        contactEventArraysResize(scratchPad, idGeometryA, idGeometryB, contactType, granData);
+                    }
+                    sphTri_contact_kernels->kernel("populateSphTriContactsInBVHs")
+                        .instantiate()
+                        .configure(dim3(blocks_needed_for_spheres), dim3(DEME_KT_CD_NTHREADS_PER_BLOCK), 0, this_stream)
+                        .launch(simParams, granData, triangleBVH.meshOwner.data(), triangleBVH.meshRoot.data(),
+                                triangleBVH.leafTriID.data(), triangleBVH.childL.data(), triangleBVH.childR.data(),
+                                triangleBVH.boxMin.data(), triangleBVH.boxMax.data(), sandwichANode1, sandwichANode2,
+                                sandwichANode3, sandwichBNode1, sandwichBNode2, sandwichBNode3,
+                                numBVHContactsEachSphere, BVHContactReportOffsets,
+                                granData->idGeometryA + nContactBeforeBVH, granData->idGeometryB + nContactBeforeBVH,
+                                granData->contactType + nContactBeforeBVH, triangleBVH.nMeshes, nInternal);
+                    DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+                }
+            }
         }  // End of bin-wise contact detection subroutine
+
+        // Spheres at the coarse level of the bin hierarchy are in no bins, so their contacts are found separately
+        if (simParams->coarseSphereRadius < DEME_HUGE_FLOAT) {
+            findCoarseLevelContacts(sphere_contact_kernels, sphTri_contact_kernels, granData, simParams, solverFlags,
+                                    nBinnedTri, sandwichANode1, sandwichANode2, sandwichANode3, sandwichBNode1,
+                                    sandwichBNode2, sandwichBNode3, idGeometryA, idGeometryB, contactType, this_stream,
+                                    scratchPad);
+        }
         timers.GetTimer("Find contact pairs").stop();
     }
 
@@ -489,14 +1143,18 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
     ////////////////////////////////////////////////////////////////////////////////
 
     timers.GetTimer("Build history map").start();
-    // Now, sort idGeometryAB by their owners. Needed for identifying persistent contacts in history-based models.
-    if (*scratchPad.pNumContacts > 0) {
+    if (*scratchPad.pNumContacts > 0 && !solverFlags.isHistoryless && solverFlags.useHashHistoryMapping) {
+        buildHashHistoryMap(history_kernels, granData, simParams, solverFlags, verbosity, previous_idGeometryA,
+                            previous_idGeometryB, previous_contactType, contactMapping, this_stream, scratchPad,
+                            stateParams);
+    } else if (*scratchPad.pNumContacts > 0) {
+        // Now, sort idGeometryAB by their owners. Needed for identifying persistent contacts in history-based models.
         // All temp vectors are free now, and all of them are fairly long...
         size_t type_arr_bytes = (*scratchPad.pNumContacts) * sizeof(contact_t);
-        contact_t* contactType_sorted = (contact_t*)scratchPad.allocateTempVector(0, type_arr_bytes);
+        contact_t* contactType_sorted = (contact_t*)scratchPad.allocateDeviceTempVector(0, type_arr_bytes);
         size_t id_arr_bytes = (*scratchPad.pNumContacts) * sizeof(bodyID_t);
-        bodyID_t* idA_sorted = (bodyID_t*)scratchPad.allocateTempVector(1, id_arr_bytes);
-        bodyID_t* idB_sorted = (bodyID_t*)scratchPad.allocateTempVector(2, id_arr_bytes);
+        bodyID_t* idA_sorted = (bodyID_t*)scratchPad.allocateDeviceTempVector(1, id_arr_bytes);
+        bodyID_t* idB_sorted = (bodyID_t*)scratchPad.allocateDeviceTempVector(2, id_arr_bytes);
 
         //// TODO: But do I have to SortByKey twice?? Can I zip these value arrays together??
         // Although it is stupid, do pay attention to that it does leverage the fact that RadixSort is stable.
@@ -533,38 +1191,22 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
 
         // First, identify the new and old idA run-length
         size_t run_length_bytes = nSpheresSafe * sizeof(geoSphereTouches_t);
-        geoSphereTouches_t* new_idA_runlength = (geoSphereTouches_t*)scratchPad.allocateTempVector(0, run_length_bytes);
+        geoSphereTouches_t* new_idA_runlength =
+            (geoSphereTouches_t*)scratchPad.allocateDeviceTempVector(0, run_length_bytes);
         size_t unique_id_bytes = nSpheresSafe * sizeof(bodyID_t);
-        bodyID_t* unique_new_idA = (bodyID_t*)scratchPad.allocateTempVector(1, unique_id_bytes);
+        bodyID_t* unique_new_idA = (bodyID_t*)scratchPad.allocateDeviceTempVector(1, unique_id_bytes);
         size_t* pNumUniqueNewA = scratchPad.pTempSizeVar1;
         cubDEMRunLengthEncode<bodyID_t, geoSphereTouches_t, DEMSolverStateData>(
             granData->idGeometryA, unique_new_idA, new_idA_runlength, pNumUniqueNewA, *scratchPad.pNumContacts,
             this_stream, scratchPad);
         // Now, we do a tab-keeping job: how many contacts on average a sphere has?
-        {
-            // Figure out how many contacts an item in idA array typically has.
-            stateParams.avgCntsPerSphere =
-                (*pNumUniqueNewA > 0) ? (float)(*scratchPad.pNumContacts) / (float)(*pNumUniqueNewA) : 0.0;
-
-            DEME_STEP_DEBUG_PRINTF("Average number of contacts for each geometry: %.7g", stateParams.avgCntsPerSphere);
-            if (stateParams.avgCntsPerSphere > solverFlags.errOutAvgSphCnts) {
-                DEME_ERROR(
-                    "On average a sphere has %.7g contacts, more than the max allowance (%.7g).\nIf you believe "
-                    "this is not abnormal, set the allowance high using SetErrorOutAvgContacts before "
-                    "initialization.\nIf you think this is because dT drifting too much ahead of kT so the contact "
-                    "margin added is too big, use SetCDMaxUpdateFreq to limit the max dT future drift.\nOtherwise, the "
-                    "simulation may have diverged and relaxing the physics may help, such as decreasing the step size "
-                    "and modifying material properties.\nIf this happens at the start of simulation, check if there "
-                    "are initial penetrations, a.k.a. elements initialized inside walls.",
-                    stateParams.avgCntsPerSphere, solverFlags.errOutAvgSphCnts);
-            }
-        }
+        checkAvgContactsPerSphere(*scratchPad.pNumContacts, *pNumUniqueNewA, solverFlags, verbosity, stateParams);
 
         // Only need to proceed if history-based
         if (!solverFlags.isHistoryless) {
             geoSphereTouches_t* old_idA_runlength =
-                (geoSphereTouches_t*)scratchPad.allocateTempVector(2, run_length_bytes);
-            bodyID_t* unique_old_idA = (bodyID_t*)scratchPad.allocateTempVector(3, unique_id_bytes);
+                (geoSphereTouches_t*)scratchPad.allocateDeviceTempVector(2, run_length_bytes);
+            bodyID_t* unique_old_idA = (bodyID_t*)scratchPad.allocateDeviceTempVector(3, unique_id_bytes);
             size_t* pNumUniqueOldA = scratchPad.pTempSizeVar2;
             cubDEMRunLengthEncode<bodyID_t, geoSphereTouches_t, DEMSolverStateData>(
                 granData->previous_idGeometryA, unique_old_idA, old_idA_runlength, pNumUniqueOldA,
@@ -573,9 +1215,9 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // Then, add zeros to run-length arrays such that even if a sphereID is not present in idA, it has a
             // place in the run-length arrays that indicates 0 run-length
             geoSphereTouches_t* new_idA_runlength_full =
-                (geoSphereTouches_t*)scratchPad.allocateTempVector(4, run_length_bytes);
+                (geoSphereTouches_t*)scratchPad.allocateDeviceTempVector(4, run_length_bytes);
             geoSphereTouches_t* old_idA_runlength_full =
-                (geoSphereTouches_t*)scratchPad.allocateTempVector(5, run_length_bytes);
+                (geoSphereTouches_t*)scratchPad.allocateDeviceTempVector(5, run_length_bytes);
             DEME_GPU_CALL(cudaMemset((void*)new_idA_runlength_full, 0, run_length_bytes));
             DEME_GPU_CALL(cudaMemset((void*)old_idA_runlength_full, 0, run_length_bytes));
             size_t blocks_needed_for_mapping =
@@ -604,9 +1246,9 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // Then, prescan to find run-length offsets, in preparation for custom kernels
             size_t scanned_runlength_bytes = nSpheresSafe * sizeof(contactPairs_t);
             contactPairs_t* new_idA_scanned_runlength =
-                (contactPairs_t*)scratchPad.allocateTempVector(0, scanned_runlength_bytes);
+                (contactPairs_t*)scratchPad.allocateDeviceTempVector(0, scanned_runlength_bytes);
             contactPairs_t* old_idA_scanned_runlength =
-                (contactPairs_t*)scratchPad.allocateTempVector(1, scanned_runlength_bytes);
+                (contactPairs_t*)scratchPad.allocateDeviceTempVector(1, scanned_runlength_bytes);
             cubDEMPrefixScan<geoSphereTouches_t, contactPairs_t, DEMSolverStateData>(
                 new_idA_runlength_full, new_idA_scanned_runlength, nSpheresSafe, this_stream, scratchPad);
             cubDEMPrefixScan<geoSphereTouches_t, contactPairs_t, DEMSolverStateData>(
@@ -637,8 +1279,8 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             contactPairs_t* old_arr_unsort_to_sort_map;
             if (solverFlags.should_sort_pairs) {
                 size_t map_arr_bytes = (*scratchPad.pNumPrevContacts) * sizeof(contactPairs_t);
-                old_arr_unsort_to_sort_map = (contactPairs_t*)scratchPad.allocateTempVector(1, map_arr_bytes);
-                contactPairs_t* one_to_n = (contactPairs_t*)scratchPad.allocateTempVector(0, map_arr_bytes);
+                old_arr_unsort_to_sort_map = (contactPairs_t*)scratchPad.allocateDeviceTempVector(1, map_arr_bytes);
+                contactPairs_t* one_to_n = (contactPairs_t*)scratchPad.allocateDeviceTempVector(0, map_arr_bytes);
                 size_t blocks_needed_for_mapping =
                     (*scratchPad.pNumPrevContacts + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
                 if (blocks_needed_for_mapping > 0) {
@@ -648,7 +1290,7 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
                         .launch(one_to_n, *scratchPad.pNumPrevContacts);
                     DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
 
-                    contact_t* old_contactType_sorted = (contact_t*)scratchPad.allocateTempVector(
+                    contact_t* old_contactType_sorted = (contact_t*)scratchPad.allocateDeviceTempVector(
                         2, (*scratchPad.pNumPrevContacts) * sizeof(contact_t));
                     cubDEMSortByKeys<contact_t, contactPairs_t, DEMSolverStateData>(
                         granData->previous_contactType, old_contactType_sorted, one_to_n, old_arr_unsort_to_sort_map,
@@ -686,12 +1328,12 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // dT potentially benefits from type-sorted contact array
             if (solverFlags.should_sort_pairs) {
                 size_t type_arr_bytes = (*scratchPad.pNumContacts) * sizeof(contact_t);
-                contact_t* contactType_sorted = (contact_t*)scratchPad.allocateTempVector(1, type_arr_bytes);
+                contact_t* contactType_sorted = (contact_t*)scratchPad.allocateDeviceTempVector(1, type_arr_bytes);
                 size_t id_arr_bytes = (*scratchPad.pNumContacts) * sizeof(bodyID_t);
-                bodyID_t* idA_sorted = (bodyID_t*)scratchPad.allocateTempVector(2, id_arr_bytes);
-                bodyID_t* idB_sorted = (bodyID_t*)scratchPad.allocateTempVector(3, id_arr_bytes);
+                bodyID_t* idA_sorted = (bodyID_t*)scratchPad.allocateDeviceTempVector(2, id_arr_bytes);
+                bodyID_t* idB_sorted = (bodyID_t*)scratchPad.allocateDeviceTempVector(3, id_arr_bytes);
                 size_t cnt_arr_bytes = (*scratchPad.pNumContacts) * sizeof(contactPairs_t);
-                contactPairs_t* map_sorted = (contactPairs_t*)scratchPad.allocateTempVector(4, cnt_arr_bytes);
+                contactPairs_t* map_sorted = (contactPairs_t*)scratchPad.allocateDeviceTempVector(4, cnt_arr_bytes);
 
                 cubDEMSortByKeys<contact_t, bodyID_t, DEMSolverStateData>(
                     granData->contactType, contactType_sorted, granData->idGeometryB, idB_sorted,
@@ -725,10 +1367,10 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
         } else {  // If historyless, might still want to sort based on type
             if (solverFlags.should_sort_pairs) {
                 size_t type_arr_bytes = (*scratchPad.pNumContacts) * sizeof(contact_t);
-                contact_t* contactType_sorted = (contact_t*)scratchPad.allocateTempVector(1, type_arr_bytes);
+                contact_t* contactType_sorted = (contact_t*)scratchPad.allocateDeviceTempVector(1, type_arr_bytes);
                 size_t id_arr_bytes = (*scratchPad.pNumContacts) * sizeof(bodyID_t);
-                bodyID_t* idA_sorted = (bodyID_t*)scratchPad.allocateTempVector(2, id_arr_bytes);
-                bodyID_t* idB_sorted = (bodyID_t*)scratchPad.allocateTempVector(3, id_arr_bytes);
+                bodyID_t* idA_sorted = (bodyID_t*)scratchPad.allocateDeviceTempVector(2, id_arr_bytes);
+                bodyID_t* idB_sorted = (bodyID_t*)scratchPad.allocateDeviceTempVector(3, id_arr_bytes);
 
                 cubDEMSortByKeys<contact_t, bodyID_t, DEMSolverStateData>(
                     granData->contactType, contactType_sorted, granData->idGeometryB, idB_sorted,
@@ -745,6 +1387,15 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             }
         }
     }  // End of contact sorting--mapping subroutine
+
+    // With a type-sorted contact array, dT can calculate forces by contact class, so tell it where each class starts
+    if (solverFlags.should_sort_pairs) {
+        history_kernels->kernel("findContactClassOffsets")
+            .instantiate()
+            .configure(dim3(1), dim3(DEME_NUM_CONTACT_CLASSES + 1), 0, this_stream)
+            .launch(granData->contactType, granData->contactClassOffsets, *scratchPad.pNumContacts);
+        DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+    }
     timers.GetTimer("Build history map").stop();
 
     // Finally, don't forget to store the number of contacts for the next iteration, even if there is 0 contacts (in
@@ -754,12 +1405,56 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
     *scratchPad.pNumPrevSpheres = simParams->nSpheresGM;
 }
 
+size_t buildContactDelta(std::shared_ptr<JitProgram>& history_kernels,
+                         DEMDataKT* granData,
+                         size_t nContactPairs,
+                         std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>>& newContactIdx,
+                         std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& newContact_idGeometryA,
+                         std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& newContact_idGeometryB,
+                         std::vector<contact_t, ManagedAllocator<contact_t>>& newContact_contactType,
+                         cudaStream_t& this_stream,
+                         DEMSolverStateData& scratchPad) {
+    if (nContactPairs == 0) {
+        return 0;
+    }
+    size_t flag_arr_bytes = nContactPairs * sizeof(contactPairs_t);
+    contactPairs_t* isNew = (contactPairs_t*)scratchPad.allocateTempVector(0, flag_arr_bytes);
+    contactPairs_t* newOffsets = (contactPairs_t*)scratchPad.allocateTempVector(1, flag_arr_bytes);
+    size_t blocks_needed = (nContactPairs + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    history_kernels->kernel("markNewContacts")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+        .launch(granData->contactMapping, isNew, nContactPairs);
+    cubDEMPrefixScan<contactPairs_t, contactPairs_t, DEMSolverStateData>(isNew, newOffsets, nContactPairs, this_stream,
+                                                                         scratchPad);
+    // The scan is exclusive, so the last flag needs to be added. The scan already synced the stream.
+    size_t nNewContacts = (size_t)newOffsets[nContactPairs - 1] + (size_t)isNew[nContactPairs - 1];
+
+    if (nNewContacts > newContactIdx.size()) {
+        newContactIdx.resize(nNewContacts);
+        newContact_idGeometryA.resize(nNewContacts);
+        newContact_idGeometryB.resize(nNewContacts);
+        newContact_contactType.resize(nNewContacts);
+    }
+    if (nNewContacts > 0) {
+        history_kernels->kernel("compactNewContacts")
+            .instantiate()
+            .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, this_stream)
+            .launch(granData, isNew, newOffsets, newContactIdx.data(), newContact_idGeometryA.data(),
+                    newContact_idGeometryB.data(), newContact_contactType.data(), nContactPairs);
+        // The temp vectors are free to be reused after this
+        DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+    }
+    return nNewContacts;
+}
+
 void overwritePrevContactArrays(DEMDataKT* kT_data,
                                 DEMDataDT* dT_data,
                                 std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& previous_idGeometryA,
                                 std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& previous_idGeometryB,
                                 std::vector<contact_t, ManagedAllocator<contact_t>>& previous_contactType,
                                 DEMSimParams* simParams,
+                                SolverFlags& solverFlags,
                                 DEMSolverStateData& scratchPad,
                                 cudaStream_t& this_stream,
                                 size_t nContacts) {
@@ -771,6 +1466,28 @@ void overwritePrevContactArrays(DEMDataKT* kT_data,
     DEME_GPU_CALL(cudaMemcpy(idB, dT_data->idGeometryB, nContacts * sizeof(bodyID_t), cudaMemcpyDeviceToDevice));
     DEME_GPU_CALL(cudaMemcpy(cType, dT_data->contactType, nContacts * sizeof(contact_t), cudaMemcpyDeviceToDevice));
 
+    // The hash-based contact map refers to the previous contact array in the order dT has it, so no sorting needed
+    if (solverFlags.useHashHistoryMapping) {
+        if (nContacts > previous_idGeometryA.size()) {
+            previous_idGeometryA.resize(nContacts);
+            previous_idGeometryB.resize(nContacts);
+            previous_contactType.resize(nContacts);
+
+            kT_data->previous_idGeometryA = previous_idGeometryA.data();
+            kT_data->previous_idGeometryB = previous_idGeometryB.data();
+            kT_data->previous_contactType = previous_contactType.data();
+        }
+        DEME_GPU_CALL(
+            cudaMemcpy(kT_data->previous_idGeometryA, idA, nContacts * sizeof(bodyID_t), cudaMemcpyDeviceToDevice));
+        DEME_GPU_CALL(
+            cudaMemcpy(kT_data->previous_idGeometryB, idB, nContacts * sizeof(bodyID_t), cudaMemcpyDeviceToDevice));
+        DEME_GPU_CALL(cudaMemcpy(kT_data->previous_contactType, cType, nContacts * sizeof(contact_t),
+                                 cudaMemcpyDeviceToDevice));
+        *scratchPad.pNumPrevContacts = nContacts;
+        *scratchPad.pNumPrevSpheres = simParams->nSpheresGM;
+        return;
+    }
+
     // Prev contact arrays actually need to be sorted based on idA
     bodyID_t* idA_sorted = (bodyID_t*)scratchPad.allocateTempVector(3, nContacts * sizeof(bodyID_t));
     bodyID_t* idB_sorted = (bodyID_t*)scratchPad.allocateTempVector(4, nContacts * sizeof(bodyID_t));
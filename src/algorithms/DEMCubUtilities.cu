@@ -166,4 +166,55 @@ void doubleSortByKey(notStupidBool_t* d_keys_in,
                                                                   this_stream, scratchPad);
 }
 
+void mortonKeySortByKey(uint64_t* d_keys_in,
+                        uint64_t* d_keys_out,
+                        bodyID_t* d_vals_in,
+                        bodyID_t* d_vals_out,
+                        size_t n,
+                        cudaStream_t& this_stream,
+                        DEMSolverStateData& scratchPad) {
+    cubDEMSortByKeys<uint64_t, bodyID_t, DEMSolverStateData>(d_keys_in, d_keys_out, d_vals_in, d_vals_out, n,
+                                                             this_stream, scratchPad);
+}
+void contactIDSortByKey(bodyID_t* d_keys_in,
+                        bodyID_t* d_keys_out,
+                        contactPairs_t* d_vals_in,
+                        contactPairs_t* d_vals_out,
+                        size_t n,
+                        cudaStream_t& this_stream,
+                        DEMSolverStateData& scratchPad) {
+    cubDEMSortByKeys<bodyID_t, contactPairs_t, DEMSolverStateData>(d_keys_in, d_keys_out, d_vals_in, d_vals_out, n,
+                                                                   this_stream, scratchPad);
+}
+
+void contactTypeSortByKey(contact_t* d_keys_in,
+                          contact_t* d_keys_out,
+                          contactPairs_t* d_vals_in,
+                          contactPairs_t* d_vals_out,
+                          size_t n,
+                          cudaStream_t& this_stream,
+                          DEMSolverStateData& scratchPad) {
+    cubDEMSortByKeys<contact_t, contactPairs_t, DEMSolverStateData>(d_keys_in, d_keys_out, d_vals_in, d_vals_out, n,
+                                                                    this_stream, scratchPad);
+}
+
+void contactIDSelectFlagged(notStupidBool_t* d_flags,
+                            contactPairs_t* d_out,
+                            size_t* d_num_out,
+                            size_t n,
+                            cudaStream_t& this_stream,
+                            DEMSolverStateData& scratchPad) {
+    cubDEMSelectFlaggedIndices<contactPairs_t, DEMSolverStateData>(d_flags, d_out, d_num_out, n, this_stream,
+                                                                   scratchPad);
+}
+
+void bodyIDSelectFlagged(notStupidBool_t* d_flags,
+                         bodyID_t* d_out,
+                         size_t* d_num_out,
+                         size_t n,
+                         cudaStream_t& this_stream,
+                         DEMSolverStateData& scratchPad) {
+    cubDEMSelectFlaggedIndices<bodyID_t, DEMSolverStateData>(d_flags, d_out, d_num_out, n, this_stream, scratchPad);
+}
+
 }  // namespace deme
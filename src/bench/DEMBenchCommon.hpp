@@ -0,0 +1,157 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// =============================================================================
+// Shared utilities of the benchmark programs. Every benchmark is a parameterized, output-free version of a demo. It is
+// run once for each requested problem size, and each run prints one JSON line (prefixed with `DEME_BENCH ') holding
+// the throughput, peak device memory and the solver timer breakdown, so results are easy to collect from a CI log.
+// Command line options:
+//   --sizes n1,n2,...   Target numbers of particles, one run each
+//   --sim-time t        Simulated time (s) that is timed in each run
+//   --warmup t          Simulated time (s) that is run before timing starts (JIT and first CD are not counted)
+// =============================================================================
+
+#ifndef DEME_BENCH_COMMON_HPP
+#define DEME_BENCH_COMMON_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace deme {
+namespace bench {
+
+struct BenchOptions {
+    std::vector<size_t> sizes;
+    double sim_time = 0.1;
+    double warmup_time = 0.01;
+    // Simulated time covered by each DoDynamics call in the timed run; contact numbers are sampled in between
+    double chunk_time = 0.01;
+};
+
+inline BenchOptions ParseOptions(int argc, char** argv, const std::vector<size_t>& default_sizes) {
+    BenchOptions opt;
+    opt.sizes = default_sizes;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Option %s is not followed by a value.\n", arg.c_str());
+            std::exit(1);
+        }
+        std::string val(argv[++i]);
+        if (arg == "--sizes") {
+            opt.sizes.clear();
+            std::stringstream ss(val);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                if (!item.empty())
+                    opt.sizes.push_back((size_t)std::stod(item));
+            }
+        } else if (arg == "--sim-time") {
+            opt.sim_time = std::stod(val);
+        } else if (arg == "--warmup") {
+            opt.warmup_time = std::stod(val);
+        } else {
+            std::fprintf(stderr, "Unknown option %s. Available: --sizes n1,n2,... --sim-time t --warmup t\n",
+                         arg.c_str());
+            std::exit(1);
+        }
+    }
+    if (opt.chunk_time > opt.sim_time)
+        opt.chunk_time = opt.sim_time;
+    return opt;
+}
+
+// Spacing of a sampler that puts about n points in a region of this volume, if each point takes volume_per_point *
+// spacing^3 of space (1 for a grid, 1/sqrt(2) for HCP)
+inline float SpacingForCount(double volume, size_t n, double volume_per_point = 1.) {
+    return (float)std::cbrt(volume / ((double)n * volume_per_point));
+}
+
+// Keep no more than n points, so a run does not go (much) over its target size
+template <typename T>
+inline void KeepAtMost(std::vector<T>& points, size_t n) {
+    if (points.size() > n)
+        points.resize(n);
+}
+
+inline void QuietSolver(DEMSolver& DEMSim) {
+    DEMSim.SetVerbosity(DEME_ERROR);
+    DEMSim.SetNoForceRecord();
+}
+
+// Run warmup, then time opt.sim_time of simulation on an initialized solver, and print the results as one JSON line
+inline void TimeAndReport(DEMSolver& DEMSim, const std::string& scenario, size_t target_n, const BenchOptions& opt) {
+    DEMSim.DoDynamicsThenSync(opt.warmup_time);
+    DEMSim.ClearThreadCollaborationStats();
+    DEMSim.ClearTimingStats();
+
+    double start_sim_time = DEMSim.GetSimTime();
+    double contact_sum = 0.;
+    size_t n_samples = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (double t = 0.; t < opt.sim_time - 1e-12; t += opt.chunk_time) {
+        DEMSim.DoDynamics(std::min(opt.chunk_time, opt.sim_time - t));
+        contact_sum += (double)DEMSim.GetNumContacts();
+        n_samples++;
+    }
+    DEMSim.DoDynamicsThenSync(0.);
+    auto end = std::chrono::high_resolution_clock::now();
+    double wall = std::chrono::duration<double>(end - start).count();
+    double sim_time = DEMSim.GetSimTime() - start_sim_time;
+    size_t steps = DEMSim.GetNumDynamicSteps();
+    double avg_contacts = (n_samples > 0) ? contact_sum / (double)n_samples : 0.;
+    if (wall <= 0.)
+        wall = DEME_TINY_FLOAT;
+
+    std::vector<std::string> kT_names, dT_names;
+    std::vector<double> kT_vals, dT_vals;
+    DEMSim.GetTimingStats(kT_names, kT_vals, dT_names, dT_vals);
+
+    std::ostringstream js;
+    js.precision(9);
+    js << "{\"scenario\": \"" << scenario << "\", \"target_n\": " << target_n
+       << ", \"num_clumps\": " << DEMSim.GetNumClumps() << ", \"steps\": " << steps << ", \"sim_time\": " << sim_time
+       << ", \"wall_time\": " << wall << ", \"steps_per_sec\": " << (double)steps / wall
+       << ", \"avg_contacts\": " << avg_contacts << ", \"contacts_per_sec\": " << avg_contacts * (double)steps / wall
+       << ", \"sim_sec_per_wall_hour\": " << sim_time / wall * 3600.
+       << ", \"peak_device_mem_bytes\": " << DEMSim.GetDeviceMemPeak();
+    auto write_timers = [&js](const char* key, const std::vector<std::string>& names,
+                              const std::vector<double>& vals) {
+        js << ", \"" << key << "\": {";
+        for (unsigned int i = 0; i < names.size(); i++) {
+            js << (i > 0 ? ", " : "") << "\"" << names.at(i) << "\": " << vals.at(i);
+        }
+        js << "}";
+    };
+    write_timers("kT_timers", kT_names, kT_vals);
+    write_timers("dT_timers", dT_names, dT_vals);
+    js << "}";
+    std::printf("DEME_BENCH %s\n", js.str().c_str());
+    std::fflush(stdout);
+}
+
+// Run one benchmark for each size in opt.sizes. `run' builds, initializes and times a fresh solver of the given target
+// size; every run gets its own solver so the results are independent.
+inline int RunAll(const BenchOptions& opt, const std::function<void(size_t)>& run) {
+    for (size_t n : opt.sizes) {
+        run(n);
+    }
+    return 0;
+}
+
+}  // namespace bench
+}  // namespace deme
+
+#endif
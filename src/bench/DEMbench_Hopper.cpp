@@ -0,0 +1,93 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// =============================================================================
+// Benchmark version of DEMdemo_Hopper_Sphere_Cylinder: spheres discharge from a quasi-2D hopper made of funnel
+// meshes once its gate slides away. Only the sphere filling is kept, and it is sampled in one go instead of being
+// emitted level by level. The hopper is fixed and the sphere size is scaled to get the target number of spheres.
+// =============================================================================
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+#include <DEM/utils/Samplers.hpp>
+
+#include "DEMBenchCommon.hpp"
+
+#include <cmath>
+
+using namespace deme;
+
+void RunHopper(size_t n, const bench::BenchOptions& opt) {
+    DEMSolver DEMSim;
+    bench::QuietSolver(DEMSim);
+    DEMSim.UseFrictionalHertzianModel();
+    DEMSim.SetCollectAccRightAfterForceCalc(true);
+
+    double densitySph = 1592;
+    float plane_bottom = 0.02f;
+    double gateSpeed = -3.5;
+    double hopperW = 0.04;
+    double gateWidth = 0.1295;
+
+    auto mat_type_flume = DEMSim.LoadMaterial({{"E", 10e9}, {"nu", 0.3}, {"CoR", 0.60}});
+    auto mat_type_walls = DEMSim.LoadMaterial({{"E", 10e9}, {"nu", 0.3}, {"CoR", 0.60}});
+    auto mat_spheres = DEMSim.LoadMaterial({{"E", 1.0e7}, {"nu", 0.35}, {"CoR", 0.85}, {"mu", 0.40}, {"Crr", 0.04}});
+    DEMSim.SetMaterialPropertyPair("CoR", mat_type_walls, mat_spheres, 0.7);
+    DEMSim.SetMaterialPropertyPair("Crr", mat_type_walls, mat_spheres, 0.05);
+    DEMSim.SetMaterialPropertyPair("mu", mat_type_walls, mat_spheres, 0.30);
+    DEMSim.SetMaterialPropertyPair("CoR", mat_type_flume, mat_spheres, 0.70);
+    DEMSim.SetMaterialPropertyPair("Crr", mat_type_flume, mat_spheres, 0.05);
+    DEMSim.SetMaterialPropertyPair("mu", mat_type_flume, mat_spheres, 0.30);
+
+    // The fill box of the demo is 0.2 wide, 0.04 deep and (here) 0.5 tall, and spheres are grid-sampled 2.2 radii apart
+    float3 fill_halfdim = make_float3(0.1, 0.02, 0.25);
+    double fill_volume = 8. * fill_halfdim.x * fill_halfdim.y * fill_halfdim.z;
+    float radiusSph = bench::SpacingForCount(fill_volume, n) / 2.2f;
+    float spacing = 2.2f * radiusSph;
+    fill_halfdim -= make_float3(spacing / 2);
+
+    float mass = 4.0 / 3.0 * PI * radiusSph * radiusSph * radiusSph * densitySph;
+    auto sphere_template = DEMSim.LoadSphereType(mass, radiusSph, mat_spheres);
+
+    DEMSim.InstructBoxDomainDimension({-0.10, 0.10}, {-0.02, 0.02}, {-0.50, 1.0});
+    DEMSim.InstructBoxDomainBoundingBC("top_open", mat_type_walls);
+
+    float4 rot = make_float4(0.7071, 0, 0, 0.7071);
+    auto fixed_left = DEMSim.AddWavefrontMeshObject(GetDEMEDataFile("mesh/funnel_left.obj"), mat_type_flume);
+    fixed_left->Move(make_float3(-hopperW / 2.0, 0, -0.01), rot);
+    auto fixed_right = DEMSim.AddWavefrontMeshObject(GetDEMEDataFile("mesh/funnel_left.obj"), mat_type_flume);
+    fixed_right->Move(make_float3(gateWidth + hopperW / 2.0, 0, -0.01), rot);
+    auto gate = DEMSim.AddWavefrontMeshObject(GetDEMEDataFile("mesh/funnel_left.obj"), mat_type_flume);
+    gate->Move(make_float3(gateWidth / 2, 0, -0.011), rot);
+    fixed_left->SetFamily(10);
+    fixed_right->SetFamily(10);
+    gate->SetFamily(3);
+    DEMSim.SetFamilyFixed(10);
+    DEMSim.SetFamilyFixed(3);
+    DEMSim.SetFamilyPrescribedLinVel(4, "0", "0", to_string_with_precision(gateSpeed));
+
+    auto input_xyz =
+        DEMBoxGridSampler(make_float3(0, 0, plane_bottom + spacing + fill_halfdim.z), fill_halfdim, spacing);
+    bench::KeepAtMost(input_xyz, n);
+    auto pile = DEMSim.AddClumps(sphere_template, input_xyz);
+    pile->SetFamily(100);
+
+    DEMSim.SetInitTimeStep(5e-6);
+    DEMSim.SetGravitationalAcceleration(make_float3(0, 0, -9.81));
+    DEMSim.SetMaxVelocity(25.);
+    DEMSim.SetInitBinSize(radiusSph * 4);
+    DEMSim.Initialize();
+
+    // Let the filling settle on the gate (not timed), then open the gate and time the discharge
+    DEMSim.DoDynamicsThenSync(0.1);
+    DEMSim.ChangeFamily(3, 4);
+
+    bench::TimeAndReport(DEMSim, "Hopper", n, opt);
+}
+
+int main(int argc, char** argv) {
+    auto opt = bench::ParseOptions(argc, argv, {20000, 100000, 500000});
+    return bench::RunAll(opt, [&opt](size_t n) { RunHopper(n, opt); });
+}
@@ -0,0 +1,80 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// =============================================================================
+// Benchmark version of DEMdemo_Mixer: a rotating bladed mixer mesh stirs 3-sphere clumps in a cylindrical chamber.
+// The chamber is fixed and the clump size is scaled to get the target number of clumps.
+// =============================================================================
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+#include <DEM/utils/Samplers.hpp>
+
+#include "DEMBenchCommon.hpp"
+
+#include <cmath>
+
+using namespace deme;
+
+void RunMixer(size_t n, const bench::BenchOptions& opt) {
+    DEMSolver DEMSim;
+    bench::QuietSolver(DEMSim);
+
+    auto mat_type_mixer = DEMSim.LoadMaterial({{"E", 1e8}, {"nu", 0.3}, {"CoR", 0.6}, {"mu", 0.5}, {"Crr", 0.0}});
+    auto mat_type_granular = DEMSim.LoadMaterial({{"E", 1e8}, {"nu", 0.3}, {"CoR", 0.6}, {"mu", 0.2}, {"Crr", 0.0}});
+    DEMSim.SetMaterialPropertyPair("mu", mat_type_mixer, mat_type_granular, 0.5);
+
+    const double world_size = 1;
+    const float chamber_height = world_size / 3.;
+    const float fill_height = chamber_height;
+    const float chamber_bottom = -world_size / 2.;
+    const float fill_bottom = chamber_bottom + chamber_height;
+
+    DEMSim.InstructBoxDomainDimension(world_size, world_size, world_size);
+    DEMSim.InstructBoxDomainBoundingBC("all", mat_type_granular);
+    auto walls = DEMSim.AddExternalObject();
+    walls->AddCylinder(make_float3(0), make_float3(0, 0, 1), world_size / 2., mat_type_mixer, 0);
+
+    auto mixer = DEMSim.AddWavefrontMeshObject(GetDEMEDataFile("mesh/internal_mixer.obj"), mat_type_mixer);
+    mixer->Scale(make_float3(world_size / 2, world_size / 2, chamber_height));
+    mixer->SetFamily(10);
+    DEMSim.SetFamilyPrescribedAngVel(10, "0", "0", "3.14159");
+    auto mixer_tracker = DEMSim.Track(mixer);
+
+    // In the demo, clumps are HCP-sampled 3 radii apart
+    const float fill_radius_approx = world_size / 2.;
+    double fill_volume = PI * fill_radius_approx * fill_radius_approx * fill_height;
+    float granular_rad = bench::SpacingForCount(fill_volume, n, 1. / std::sqrt(2.)) / 3.f;
+
+    float mass = 2.6e3 * 5.5886717;
+    float3 MOI = make_float3(2.928, 2.6029, 3.9908) * 2.6e3;
+    auto template_granular =
+        DEMSim.LoadClumpType(mass, MOI, GetDEMEDataFile("clumps/3_clump.csv"), mat_type_granular);
+    template_granular->Scale(granular_rad);
+
+    HCPSampler sampler(3.f * granular_rad);
+    float3 fill_center = make_float3(0, 0, fill_bottom + fill_height / 2);
+    const float fill_radius = world_size / 2. - 2. * granular_rad;
+    auto input_xyz = sampler.SampleCylinderZ(fill_center, fill_radius, fill_height / 2);
+    bench::KeepAtMost(input_xyz, n);
+    DEMSim.AddClumps(template_granular, input_xyz);
+
+    DEMSim.SetInitTimeStep(5e-6);
+    DEMSim.SetGravitationalAcceleration(make_float3(0, 0, -9.81));
+    DEMSim.SetCDUpdateFreq(40);
+    DEMSim.SetExpandSafetyAdder(2.0);
+    DEMSim.SetCDNumStepsMaxDriftMultipleOfAvg(1.2);
+    DEMSim.SetCDNumStepsMaxDriftAheadOfAvg(6);
+    DEMSim.SetErrorOutVelocity(20.);
+    DEMSim.Initialize();
+
+    mixer_tracker->SetPos(make_float3(0, 0, chamber_bottom + chamber_height / 2.0));
+    bench::TimeAndReport(DEMSim, "Mixer", n, opt);
+}
+
+int main(int argc, char** argv) {
+    auto opt = bench::ParseOptions(argc, argv, {50000, 200000, 1000000});
+    return bench::RunAll(opt, [&opt](size_t n) { RunMixer(n, opt); });
+}
@@ -0,0 +1,104 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// =============================================================================
+// Benchmark version of DEMdemo_Repose: random multi-sphere clumps pile up through a funnel mesh. The fill region is
+// fixed and the clump size is scaled to get the target number of clumps.
+// =============================================================================
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+#include <DEM/utils/Samplers.hpp>
+
+#include "DEMBenchCommon.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+using namespace deme;
+
+void RunRepose(size_t n, const bench::BenchOptions& opt) {
+    DEMSolver DEMSim;
+    bench::QuietSolver(DEMSim);
+    DEMSim.UseFrictionalHertzianModel();
+
+    srand(42);
+
+    const float fill_width = 5.f;
+    const float fill_height = 2.f * fill_width;
+    const float funnel_bottom = 0.f;
+    // In the demo, clumps of scaling 1 are sampled 0.08 apart
+    float spacing = bench::SpacingForCount(PI * fill_width * fill_width * fill_height, n);
+    float scaling = spacing / 0.08;
+
+    int num_template = 6;
+    int min_sphere = 1;
+    int max_sphere = 5;
+    float min_rad = 0.01 * scaling;
+    float max_rad = 0.02 * scaling;
+    float min_relpos = -0.01 * scaling;
+    float max_relpos = 0.01 * scaling;
+
+    auto mat_type_walls = DEMSim.LoadMaterial({{"E", 1e8}, {"nu", 0.3}, {"CoR", 0.3}, {"mu", 1}});
+    auto mat_type_particles = DEMSim.LoadMaterial({{"E", 1e9}, {"nu", 0.3}, {"CoR", 0.7}, {"mu", 1}});
+    DEMSim.SetMaterialPropertyPair("CoR", mat_type_walls, mat_type_particles, 0.3);
+
+    auto funnel = DEMSim.AddWavefrontMeshObject(GetDEMEDataFile("mesh/funnel.obj"), mat_type_walls);
+    funnel->Scale(0.15);
+
+    std::vector<std::shared_ptr<DEMClumpTemplate>> clump_types;
+    for (int i = 0; i < num_template; i++) {
+        int num_sphere = rand() % (max_sphere - min_sphere + 1) + 1;
+        float mass = 0.1 * (float)num_sphere * std::pow(scaling, 3);
+        float3 MOI = make_float3(2e-5 * (float)num_sphere, 1.5e-5 * (float)num_sphere, 1.8e-5 * (float)num_sphere) *
+                     50. * std::pow(scaling, 5);
+        std::vector<float> radii;
+        std::vector<float3> relPos;
+        float3 seed_pos = make_float3(0);
+        for (int j = 0; j < num_sphere; j++) {
+            radii.push_back(((float)rand() / RAND_MAX) * (max_rad - min_rad) + min_rad);
+            float3 tmp = make_float3(0);
+            if (j > 0) {
+                tmp.x = ((float)rand() / RAND_MAX) * (max_relpos - min_relpos) + min_relpos;
+                tmp.y = ((float)rand() / RAND_MAX) * (max_relpos - min_relpos) + min_relpos;
+                tmp.z = ((float)rand() / RAND_MAX) * (max_relpos - min_relpos) + min_relpos;
+            }
+            tmp += seed_pos;
+            relPos.push_back(tmp);
+            seed_pos = relPos.at(rand() % (j + 1));
+        }
+        clump_types.push_back(DEMSim.LoadClumpType(mass, MOI, radii, relPos, mat_type_particles));
+    }
+
+    float fill_bottom = funnel_bottom + fill_width + spacing;
+    auto input_xyz = DEMBoxGridSampler(make_float3(0, 0, fill_bottom + fill_height / 2),
+                                       make_float3(fill_width, fill_width, fill_height / 2), spacing);
+    // Keep the ones in the cylinder, like the demo's cylindrical fill
+    std::vector<float3> pile_xyz;
+    for (const auto& p : input_xyz) {
+        if (p.x * p.x + p.y * p.y <= fill_width * fill_width)
+            pile_xyz.push_back(p);
+    }
+    bench::KeepAtMost(pile_xyz, n);
+    std::vector<std::shared_ptr<DEMClumpTemplate>> pile_types;
+    for (size_t i = 0; i < pile_xyz.size(); i++) {
+        pile_types.push_back(clump_types.at(i % num_template));
+    }
+    DEMSim.AddClumps(pile_types, pile_xyz);
+
+    DEMSim.InstructBoxDomainDimension({-10, 10}, {-10, 10}, {funnel_bottom - 10.f, funnel_bottom + 20.f});
+    DEMSim.InstructBoxDomainBoundingBC("top_open", mat_type_walls);
+    DEMSim.SetInitTimeStep(5e-6);
+    DEMSim.SetGravitationalAcceleration(make_float3(0, 0, -9.81));
+    DEMSim.SetMaxVelocity(25.);
+    DEMSim.Initialize();
+
+    bench::TimeAndReport(DEMSim, "Repose", n, opt);
+}
+
+int main(int argc, char** argv) {
+    auto opt = bench::ParseOptions(argc, argv, {50000, 200000, 1000000});
+    return bench::RunAll(opt, [&opt](size_t n) { RunRepose(n, opt); });
+}
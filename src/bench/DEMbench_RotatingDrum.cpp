@@ -0,0 +1,100 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// =============================================================================
+// Benchmark version of DEMdemo_RotatingDrum: ellipsoid-like clumps tumble in a drum made of one big clump. The drum
+// is fixed and the filler size is scaled to get the target number of clumps.
+// =============================================================================
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+#include <DEM/utils/Samplers.hpp>
+
+#include "DEMBenchCommon.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace deme;
+
+void RunRotatingDrum(size_t n, const bench::BenchOptions& opt) {
+    DEMSolver DEMSim;
+    bench::QuietSolver(DEMSim);
+    DEMSim.DisableJitifyClumpTemplates();
+
+    float CylRad = 2.0;
+    float CylHeight = 1.0;
+    float CylMass = 1.0;
+    float CylParticleRad = 0.05;
+    float safe_delta = 0.03;
+    float sample_halfheight = CylHeight / 2.0 - 3.0 * safe_delta;
+    float sample_halfwidth = CylRad / 1.5;
+
+    // In the demo, a filler of scaling s takes a (cbrt(2) * 2.1 s) by (cbrt(2) * 2.1 s) by (2 * 2.1 s) grid cell
+    double cell_ratio = std::cbrt(2.0) * std::cbrt(2.0) * 2.0 * 2.1 * 2.1 * 2.1;
+    double fill_volume = 8. * sample_halfheight * sample_halfwidth * sample_halfwidth;
+    float scaling = bench::SpacingForCount(fill_volume, n, cell_ratio);
+
+    // A general template for ellipsoid with b = c = 1 and a = 2, where Z is the long axis
+    std::vector<float> radii = {1.0, 0.88, 0.64, 0.88, 0.64};
+    std::vector<float3> relPos = {make_float3(0, 0, 0), make_float3(0, 0, 0.86), make_float3(0, 0, 1.44),
+                                  make_float3(0, 0, -0.86), make_float3(0, 0, -1.44)};
+    float mass = 2.6e3 * 4. / 3. * PI * 2 * 1 * 1;
+    float3 MOI = make_float3(1. / 5. * mass * (1 * 1 + 2 * 2), 1. / 5. * mass * (1 * 1 + 2 * 2),
+                             1. / 5. * mass * (1 * 1 + 1 * 1));
+
+    auto mat_type_sand = DEMSim.LoadMaterial({{"E", 1e9}, {"nu", 0.3}, {"CoR", 0.6}, {"mu", 0.4}, {"Crr", 0.01}});
+    auto mat_type_drum = DEMSim.LoadMaterial({{"E", 2e9}, {"nu", 0.3}, {"CoR", 0.6}, {"mu", 0.8}, {"Crr", 0.01}});
+    DEMSim.SetMaterialPropertyPair("mu", mat_type_sand, mat_type_drum, 0.8);
+
+    float this_mass = scaling * scaling * scaling * mass;
+    float3 this_MOI = scaling * scaling * scaling * scaling * scaling * MOI;
+    std::vector<float> this_radii(radii);
+    std::vector<float3> this_relPos(relPos);
+    std::transform(radii.begin(), radii.end(), this_radii.begin(), [scaling](float& r) { return r * scaling; });
+    std::transform(relPos.begin(), relPos.end(), this_relPos.begin(), [scaling](float3& r) { return r * scaling; });
+    auto filler_template = DEMSim.LoadClumpType(this_mass, this_MOI, this_radii, this_relPos, mat_type_sand);
+
+    float3 CylAxis = make_float3(1, 0, 0);
+    float IXX = CylMass * CylRad * CylRad;
+    float IYY = (CylMass / 12) * (3 * CylRad * CylRad + CylHeight * CylHeight);
+    auto Drum_particles = DEMCylSurfSampler(make_float3(0), CylAxis, CylRad, CylHeight, CylParticleRad);
+    auto Drum_template =
+        DEMSim.LoadClumpType(CylMass, make_float3(IXX, IYY, IYY),
+                             std::vector<float>(Drum_particles.size(), CylParticleRad), Drum_particles, mat_type_drum);
+
+    auto input_xyz =
+        DEMBoxGridSampler(make_float3(0), make_float3(sample_halfheight, sample_halfwidth, sample_halfwidth),
+                          scaling * std::cbrt(2.0) * 2.1, scaling * std::cbrt(2.0) * 2.1, scaling * 2 * 2.1);
+    bench::KeepAtMost(input_xyz, n);
+    DEMSim.AddClumps(filler_template, input_xyz);
+
+    auto Drum = DEMSim.AddClumps(Drum_template, make_float3(0));
+    unsigned int drum_family = 100;
+    Drum->SetFamilies(drum_family);
+    DEMSim.SetFamilyPrescribedAngVel(drum_family, "0.1", "0", "0");
+    DEMSim.DisableContactBetweenFamilies(drum_family, drum_family);
+
+    auto top_bot_planes = DEMSim.AddExternalObject();
+    top_bot_planes->AddPlane(make_float3(CylHeight / 2. - safe_delta, 0, 0), make_float3(-1, 0, 0), mat_type_drum);
+    top_bot_planes->AddPlane(make_float3(-CylHeight / 2. + safe_delta, 0, 0), make_float3(1, 0, 0), mat_type_drum);
+    top_bot_planes->SetFamily(drum_family);
+
+    DEMSim.InstructBoxDomainDimension(5, 5, 5);
+    DEMSim.SetInitTimeStep(5e-6);
+    DEMSim.SetGravitationalAcceleration(make_float3(0, 0, -9.8));
+    DEMSim.SetCDNumStepsMaxDriftMultipleOfAvg(1.1);
+    DEMSim.SetCDNumStepsMaxDriftAheadOfAvg(3);
+    DEMSim.SetMaxVelocity(3.);
+    DEMSim.SetInitBinNumTarget(5e5);
+    DEMSim.Initialize();
+
+    bench::TimeAndReport(DEMSim, "RotatingDrum", n, opt);
+}
+
+int main(int argc, char** argv) {
+    auto opt = bench::ParseOptions(argc, argv, {50000, 200000, 1000000});
+    return bench::RunAll(opt, [&opt](size_t n) { RunRotatingDrum(n, opt); });
+}
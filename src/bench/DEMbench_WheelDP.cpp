@@ -0,0 +1,110 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// =============================================================================
+// Benchmark version of DEMdemo_WheelDPSimplified: a loaded rover wheel mesh drives over a bed of flat triangular
+// clumps at a prescribed slip. The bed is fixed in size and the clump size is scaled to get the target number of
+// clumps. The timed part of the run is the drawbar-pull phase.
+// =============================================================================
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+#include <DEM/utils/Samplers.hpp>
+
+#include "DEMBenchCommon.hpp"
+
+#include <cmath>
+
+using namespace deme;
+
+void RunWheelDP(size_t n, const bench::BenchOptions& opt) {
+    DEMSolver DEMSim;
+    bench::QuietSolver(DEMSim);
+
+    auto mat_type_wheel = DEMSim.LoadMaterial({{"E", 1e9}, {"nu", 0.3}, {"CoR", 0.6}, {"mu", 0.5}, {"Crr", 0.01}});
+    auto mat_type_terrain = DEMSim.LoadMaterial({{"E", 1e9}, {"nu", 0.3}, {"CoR", 0.4}, {"mu", 0.5}, {"Crr", 0.01}});
+    DEMSim.SetMaterialPropertyPair("mu", mat_type_wheel, mat_type_terrain, 0.8);
+    DEMSim.SetMaterialPropertyPair("CoR", mat_type_wheel, mat_type_terrain, 0.6);
+
+    float G_mag = 9.81;
+    double world_size_y = 1.;
+    double world_size_x = 2.;
+    double world_size_z = 2.;
+    DEMSim.InstructBoxDomainDimension(world_size_x, world_size_y, world_size_z);
+    DEMSim.InstructBoxDomainBoundingBC("top_open", mat_type_terrain);
+    float bottom = -0.5;
+    DEMSim.AddBCPlane(make_float3(0, 0, bottom), make_float3(0, 0, 1), mat_type_terrain);
+
+    float wheel_rad = 0.25;
+    float wheel_width = 0.2;
+    float wheel_weight = 100.;
+    float wheel_mass = wheel_weight / G_mag;
+    float total_pressure = 200.0;
+    float added_pressure = total_pressure - wheel_weight;
+    float wheel_IYY = wheel_mass * wheel_rad * wheel_rad / 2;
+    float wheel_IXX = (wheel_mass / 12) * (3 * wheel_rad * wheel_rad + wheel_width * wheel_width);
+    auto wheel =
+        DEMSim.AddWavefrontMeshObject(GetDEMEDataFile("mesh/rover_wheels/viper_wheel_right.obj"), mat_type_wheel);
+    wheel->SetMass(wheel_mass);
+    wheel->SetMOI(make_float3(wheel_IXX, wheel_IYY, wheel_IXX));
+    wheel->SetFamily(1);
+    auto wheel_tracker = DEMSim.Track(wheel);
+
+    float sample_halfheight = 0.25;
+    float sample_halfwidth_x = (world_size_x * 0.95) / 2;
+    float sample_halfwidth_y = (world_size_y * 0.95) / 2;
+    // In the demo, clumps of scale s are HCP-sampled 2.7 s apart
+    double bed_volume = 8. * sample_halfheight * sample_halfwidth_x * sample_halfwidth_y;
+    double scale = bench::SpacingForCount(bed_volume, n, 1. / std::sqrt(2.)) / 2.7;
+
+    float terrain_density = 2.6e3;
+    float volume1 = 4.2520508;
+    float mass1 = terrain_density * volume1;
+    float3 MOI1 = make_float3(1.6850426, 1.6375114, 2.1187753) * terrain_density;
+    auto my_template =
+        DEMSim.LoadClumpType(mass1, MOI1, GetDEMEDataFile("clumps/triangular_flat.csv"), mat_type_terrain);
+    my_template->Scale(scale);
+
+    HCPSampler sampler(scale * 2.7);
+    float offset_z = bottom + sample_halfheight + 0.03;
+    auto terrain_xyz = sampler.SampleBox(make_float3(0, 0, offset_z),
+                                         make_float3(sample_halfwidth_x, sample_halfwidth_y, sample_halfheight));
+    bench::KeepAtMost(terrain_xyz, n);
+    auto terrain_particles = DEMSim.AddClumps(my_template, terrain_xyz);
+    terrain_particles->SetVel(make_float3(0.00, 0, -0.05));
+
+    float w_r = PI / 4;
+    float v_ref = w_r * wheel_rad;
+    // Family 1 sinks in freely, family 2 is the drawbar-pull test at slip 0.5
+    DEMSim.SetFamilyPrescribedAngVel(1, "0", to_string_with_precision(w_r), "0", false);
+    DEMSim.AddFamilyPrescribedAcc(1, "none", "none", to_string_with_precision(-added_pressure / wheel_mass));
+    DEMSim.SetFamilyPrescribedAngVel(2, "0", to_string_with_precision(w_r), "0", false);
+    DEMSim.SetFamilyPrescribedLinVel(2, to_string_with_precision(v_ref * 0.5), "0", "none", false);
+    DEMSim.AddFamilyPrescribedAcc(2, "none", "none", to_string_with_precision(-added_pressure / wheel_mass));
+
+    auto max_z_finder = DEMSim.CreateInspector("clump_max_z");
+
+    DEMSim.SetInitTimeStep(5e-6);
+    DEMSim.SetGravitationalAcceleration(make_float3(0, 0, -G_mag));
+    DEMSim.SetMaxVelocity(20.);
+    DEMSim.SetErrorOutVelocity(35.);
+    DEMSim.SetExpandSafetyMultiplier(1.);
+    DEMSim.SetCDUpdateFreq(40);
+    DEMSim.DisableAdaptiveUpdateFreq();
+    DEMSim.Initialize();
+
+    // Put the wheel on the bed, let it sink in a bit (not timed), then switch to the drawbar-pull test
+    float max_z = max_z_finder->GetValue();
+    wheel_tracker->SetPos(make_float3(-0.45, 0, max_z + 0.03 + wheel_rad));
+    DEMSim.DoDynamicsThenSync(0.05);
+    DEMSim.ChangeFamily(1, 2);
+
+    bench::TimeAndReport(DEMSim, "WheelDP", n, opt);
+}
+
+int main(int argc, char** argv) {
+    auto opt = bench::ParseOptions(argc, argv, {50000, 200000, 1000000});
+    return bench::RunAll(opt, [&opt](size_t n) { RunWheelDP(n, opt); });
+}
@@ -102,4 +102,24 @@ void GpuManager::setStreamAvailable(const StreamInfo& info) {
             stream->_impl_active = false;
         }
     }
-}
\ No newline at end of file
+}
+
+bool GpuManager::enablePeerAccess(int device, int peer) {
+    int can_access = 0;
+    DEME_GPU_CALL(cudaDeviceCanAccessPeer(&can_access, device, peer));
+    if (!can_access) {
+        return false;
+    }
+    int current_device;
+    DEME_GPU_CALL(cudaGetDevice(&current_device));
+    DEME_GPU_CALL(cudaSetDevice(device));
+    cudaError_t res = cudaDeviceEnablePeerAccess(peer, 0);
+    DEME_GPU_CALL(cudaSetDevice(current_device));
+    if (res == cudaErrorPeerAccessAlreadyEnabled) {
+        // Not an actual error, but it would otherwise be picked up by the next error check
+        cudaGetLastError();
+        return true;
+    }
+    DEME_GPU_CALL(res);
+    return true;
+}
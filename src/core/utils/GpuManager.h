@@ -38,6 +38,10 @@ class GpuManager {
     // Mark a stream as unused.
     void setStreamAvailable(const StreamInfo&);
 
+    // Let device access the memory of peer device (the current device is left unchanged). Returns false if the
+    // hardware does not support it.
+    bool enablePeerAccess(int device, int peer);
+
     // Return the number of devices detected.
     int getNumDevices() { return ndevices; }
 
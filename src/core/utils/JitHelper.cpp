@@ -7,16 +7,60 @@
 #include <filesystem>
 #include <string>
 #include <regex>
+#include <random>
+#include <thread>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <algorithm>
 
 #include <core/ApiVersion.h>
 #include <core/utils/RuntimeData.h>
 #include <core/utils/JitHelper.h>
 
-jitify::JitCache JitHelper::kcache;
-
 const std::filesystem::path JitHelper::KERNEL_DIR = RuntimeDataHelper::data_path / "kernel";
 const std::filesystem::path JitHelper::KERNEL_INCLUDE_DIR = RuntimeDataHelper::include_path;
 
+std::mutex JitHelper::cache_dir_mutex;
+std::filesystem::path JitHelper::cache_dir;
+bool JitHelper::cache_dir_set = false;
+
+namespace {
+
+// FNV-1a. Unlike std::hash, it gives the same value across processes and platforms, which a disk cache needs.
+inline uint64_t stableHash(const std::string& str, uint64_t h = 14695981039346656037ULL) {
+    for (unsigned char c : str) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+inline std::string toHex(uint64_t val) {
+    std::ostringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << val;
+    return ss.str();
+}
+
+// The compute capability of the current device, such as "sm_80"
+inline std::string currentGpuArch() {
+    int device = 0, major = 0, minor = 0;
+    cudaGetDevice(&device);
+    cudaDeviceGetAttribute(&major, cudaDevAttrComputeCapabilityMajor, device);
+    cudaDeviceGetAttribute(&minor, cudaDevAttrComputeCapabilityMinor, device);
+    return "sm_" + std::to_string(major) + std::to_string(minor);
+}
+
+// Kernel names are used in cache file names, so keep only the safe characters
+inline std::string fileSafe(const std::string& str) {
+    std::string res = str;
+    std::replace_if(
+        res.begin(), res.end(), [](char c) { return !(std::isalnum((unsigned char)c) || c == '_'); }, '_');
+    return res;
+}
+
+}  // namespace
+
 JitHelper::Header::Header(const std::filesystem::path& sourcefile) {
     this->_source = JitHelper::loadSourceFile(sourcefile);
 }
@@ -33,19 +77,220 @@ void JitHelper::Header::substitute(const std::string& symbol, const std::string&
     }
 }
 
-jitify::Program JitHelper::buildProgram(
-    const std::string& name,
-    const std::filesystem::path& source,
-    std::unordered_map<std::string, std::string> substitutions,
-    // std::vector<JitHelper::Header> headers, // THIS PARAMETER PROBABLY WON'T EVER BE USED
-    std::vector<std::string> flags) {
+void JitHelper::SetCacheDir(const std::filesystem::path& dir) {
+    std::lock_guard<std::mutex> lock(cache_dir_mutex);
+    cache_dir = dir;
+    cache_dir_set = true;
+}
+
+std::filesystem::path JitHelper::GetCacheDir() {
+    std::lock_guard<std::mutex> lock(cache_dir_mutex);
+    if (!cache_dir_set) {
+        const char* env_dir = std::getenv("DEME_JIT_CACHE_DIR");
+        cache_dir = (env_dir) ? std::filesystem::path(env_dir) : std::filesystem::path();
+        cache_dir_set = true;
+    }
+    return cache_dir;
+}
+
+std::string JitHelper::GetGpuArch() {
+    return currentGpuArch();
+}
+
+bool JitHelper::readCacheEntry(const std::string& entry, std::string& content) {
+    std::filesystem::path dir = GetCacheDir();
+    if (dir.empty())
+        return false;
+    std::filesystem::path file = dir / entry;
+    std::error_code ec;
+    if (!std::filesystem::exists(file, ec))
+        return false;
+    std::ifstream input(file, std::ios::in | std::ios::binary);
+    if (!input)
+        return false;
+    std::ostringstream ss;
+    ss << input.rdbuf();
+    content = ss.str();
+    return !content.empty();
+}
+
+void JitHelper::writeCacheEntry(const std::string& entry, const std::string& content) {
+    std::filesystem::path dir = GetCacheDir();
+    if (dir.empty())
+        return;
+    // A failure to cache is never fatal; the program is already built
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec)
+        return;
+    // Unique temp name per writer, then atomically rename into place. If two processes race, one of the identical
+    // entries simply wins.
+    std::random_device rd;
+    std::string tmp_name =
+        entry + ".tmp." + toHex(((uint64_t)rd() << 32) ^ rd() ^ std::hash<std::thread::id>()(std::this_thread::get_id()));
+    std::filesystem::path tmp_file = dir / tmp_name;
+    {
+        std::ofstream output(tmp_file, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!output)
+            return;
+        output.write(content.data(), content.size());
+        if (!output) {
+            output.close();
+            std::filesystem::remove(tmp_file, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(tmp_file, dir / entry, ec);
+    if (ec)
+        std::filesystem::remove(tmp_file, ec);
+}
+
+const std::string& JitHelper::kernelDirHash() {
+    static const std::string hash = []() {
+        uint64_t h = stableHash(std::to_string(DEME_API_VERSION));
+        std::vector<std::filesystem::path> files;
+        std::error_code ec;
+        // Kernels include files from the kernel dir and DEM/ headers (Defines.h etc.) from the include dir
+        for (const auto& dir : {KERNEL_DIR, KERNEL_INCLUDE_DIR / "DEM"}) {
+            if (!std::filesystem::is_directory(dir, ec))
+                continue;
+            for (const auto& item : std::filesystem::recursive_directory_iterator(dir, ec)) {
+                if (item.is_regular_file(ec))
+                    files.push_back(item.path());
+            }
+        }
+        // Directory iteration order is unspecified
+        std::sort(files.begin(), files.end());
+        for (const auto& file : files) {
+            h = stableHash(file.string(), h);
+            h = stableHash(loadSourceFile(file), h);
+        }
+        return toHex(h);
+    }();
+    return hash;
+}
+
+JitProgram::JitProgram(jitify::experimental::Program&& program,
+                       const std::string& cache_key,
+                       const std::string& source_hash,
+                       const std::vector<std::string>& kernel_names)
+    : _program(new jitify::experimental::Program(std::move(program))),
+      _cache_key(cache_key),
+      _source_hash(source_hash),
+      _kernel_names(kernel_names),
+      _mutex(new std::mutex) {}
+
+void JitProgram::instantiateAll() {
+    // Each instantiation is a separate NVRTC compile, so they are farmed out to more threads, on the current device
+    int device = 0;
+    cudaGetDevice(&device);
+    std::vector<std::future<void>> tasks;
+    for (const auto& name : _kernel_names) {
+        tasks.push_back(std::async(std::launch::async, [this, device, name]() {
+            cudaSetDevice(device);
+            getInstance(name);
+        }));
+    }
+    for (auto& task : tasks) {
+        task.get();
+    }
+}
+
+const jitify::experimental::KernelInstantiation& JitProgram::getInstance(const std::string& name) {
+    {
+        std::lock_guard<std::mutex> lock(*_mutex);
+        auto it = _instances.find(name);
+        if (it != _instances.end()) {
+            return *(it->second);
+        }
+    }
+
+    // Compile without holding the lock, so other kernels of this program can be compiled at the same time
+    std::unique_ptr<jitify::experimental::KernelInstantiation> instance;
+    std::string entry = _cache_key + "_" + fileSafe(name) + ".kernel";
+    std::string serialized;
+    if (!_cache_key.empty() && JitHelper::readCacheEntry(entry, serialized)) {
+        try {
+            instance.reset(new jitify::experimental::KernelInstantiation(
+                jitify::experimental::KernelInstantiation::deserialize(serialized)));
+        } catch (...) {
+            // Corrupt or incompatible entry; just compile again
+            instance.reset();
+        }
+    }
+    if (!instance) {
+        instance.reset(new jitify::experimental::KernelInstantiation(_program->kernel(name).instantiate()));
+        if (!_cache_key.empty()) {
+            JitHelper::writeCacheEntry(entry, instance->serialize());
+        }
+    }
+    std::lock_guard<std::mutex> lock(*_mutex);
+    // If another thread got here first with the same kernel, keep its instance; references to it may be out already
+    auto res = _instances.emplace(name, std::move(instance));
+    return *(res.first->second);
+}
+
+std::string JitHelper::preprocessSource(const std::string& name,
+                                        const std::filesystem::path& source,
+                                        const std::unordered_map<std::string, std::string>& substitutions,
+                                        std::vector<std::string>& flags) {
     std::string code = name + "\n";
+    // Kernels must agree with the host on the storage types of owner state arrays
+    flags.push_back("-DDEME_COMPACT_OWNER_STATE=" + std::to_string(DEME_COMPACT_OWNER_STATE));
 
     code.append(JitHelper::loadSourceFile(source));
     // Apply the substitutions
     for (auto& subst : substitutions) {
         code = std::regex_replace(code, std::regex(subst.first), subst.second);
     }
+    return code;
+}
+
+uint64_t JitHelper::sourceHash(const std::string& code, const std::vector<std::string>& flags) {
+    uint64_t h = stableHash(code);
+    for (const auto& flag : flags) {
+        h = stableHash(flag, h);
+    }
+    return h;
+}
+
+std::vector<std::string> JitHelper::kernelNames(const std::string& code) {
+    // Drop the comments first, so kernels that are commented out are not picked up
+    std::string stripped;
+    stripped.reserve(code.size());
+    for (size_t i = 0; i < code.size(); i++) {
+        if (code.compare(i, 2, "//") == 0) {
+            i = code.find('\n', i);
+            if (i == std::string::npos)
+                break;
+        } else if (code.compare(i, 2, "/*") == 0) {
+            i = code.find("*/", i + 2);
+            if (i == std::string::npos)
+                break;
+            i++;
+            continue;
+        }
+        stripped.push_back(code[i]);
+    }
+    std::vector<std::string> names;
+    static const std::regex kernel_decl("__global__\\s+void\\s+(\\w+)\\s*\\(");
+    for (auto it = std::sregex_iterator(stripped.begin(), stripped.end(), kernel_decl); it != std::sregex_iterator();
+         ++it) {
+        names.push_back((*it)[1].str());
+    }
+    return names;
+}
+
+JitProgram JitHelper::buildProgram(
+    const std::string& name,
+    const std::filesystem::path& source,
+    std::unordered_map<std::string, std::string> substitutions,
+    // std::vector<JitHelper::Header> headers, // THIS PARAMETER PROBABLY WON'T EVER BE USED
+    std::vector<std::string> flags) {
+    std::string code = preprocessSource(name, source, substitutions, flags);
+    uint64_t h = sourceHash(code, flags);
+    std::string source_hash = toHex(h);
+    std::vector<std::string> kernel_names = kernelNames(code);
 
     std::vector<std::string> header_code;
     // THIS BLOCK IS ONLY NEEDED IF THE headers PARAMETER IS USED
@@ -55,5 +300,74 @@ jitify::Program JitHelper::buildProgram(
     }
     */
 
-    return kcache.program(code, header_code, flags);
+    // No disk cache, then just build it
+    if (GetCacheDir().empty()) {
+        return JitProgram(jitify::experimental::Program(code, header_code, flags), std::string(), source_hash,
+                          kernel_names);
+    }
+
+    // The cache key covers the substituted source, the flags, the target GPU and the kernel files it may include
+    h = stableHash(currentGpuArch(), h);
+    h = stableHash(kernelDirHash(), h);
+    std::string cache_key = fileSafe(name) + "_" + toHex(h);
+
+    std::string serialized;
+    if (readCacheEntry(cache_key + ".program", serialized)) {
+        try {
+            return JitProgram(jitify::experimental::Program::deserialize(serialized), cache_key, source_hash,
+                              kernel_names);
+        } catch (...) {
+            // Corrupt or incompatible entry; fall through and preprocess again
+        }
+    }
+    jitify::experimental::Program program(code, header_code, flags);
+    writeCacheEntry(cache_key + ".program", program.serialize());
+    return JitProgram(std::move(program), cache_key, source_hash, kernel_names);
+}
+
+std::shared_ptr<JitProgram> JitHelper::updateProgram(const std::shared_ptr<JitProgram>& prog,
+                                                     const std::string& name,
+                                                     const std::filesystem::path& source,
+                                                     const std::unordered_map<std::string, std::string>& substitutions,
+                                                     const std::vector<std::string>& flags) {
+    if (prog) {
+        // Substituting is cheap compared with compiling, and the substituted source is exactly what would be compiled
+        std::vector<std::string> full_flags = flags;
+        std::string code = preprocessSource(name, source, substitutions, full_flags);
+        if (toHex(sourceHash(code, full_flags)) == prog->getSourceHash()) {
+            return prog;
+        }
+    }
+    return std::make_shared<JitProgram>(buildProgram(name, source, substitutions, flags));
+}
+
+std::future<std::shared_ptr<JitProgram>> JitHelper::buildProgramAsync(
+    int device,
+    const std::string& name,
+    const std::filesystem::path& source,
+    const std::unordered_map<std::string, std::string>& substitutions,
+    const std::vector<std::string>& flags) {
+    // Arguments are copied into the task, so the caller does not need to keep them alive
+    return std::async(std::launch::async, [=]() {
+        cudaSetDevice(device);
+        auto prog = std::make_shared<JitProgram>(buildProgram(name, source, substitutions, flags));
+        prog->instantiateAll();
+        return prog;
+    });
+}
+
+std::future<std::shared_ptr<JitProgram>> JitHelper::updateProgramAsync(
+    const std::shared_ptr<JitProgram>& prog,
+    int device,
+    const std::string& name,
+    const std::filesystem::path& source,
+    const std::unordered_map<std::string, std::string>& substitutions,
+    const std::vector<std::string>& flags) {
+    return std::async(std::launch::async, [=]() {
+        cudaSetDevice(device);
+        // If prog is kept, its kernels are mostly instantiated already and this is cheap
+        auto res = updateProgram(prog, name, source, substitutions, flags);
+        res->instantiateAll();
+        return res;
+    });
 }
@@ -10,6 +10,9 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <future>
 
 #include <jitify/jitify.hpp>
 
@@ -19,6 +22,50 @@
     #undef strtok_r
 #endif
 
+/// A jitified program. Each kernel is compiled once, on its first instantiation, and then kept in memory. If a JIT
+/// cache directory is set (JitHelper::SetCacheDir), the preprocessed program and the compiled kernels are also stored
+/// on disk and reused by later processes that build the same program for the same GPU architecture.
+class JitProgram {
+  public:
+    class Kernel {
+      public:
+        Kernel(JitProgram* prog, const std::string& name) : _prog(prog), _name(name) {}
+        const jitify::experimental::KernelInstantiation& instantiate() { return _prog->getInstance(_name); }
+
+      private:
+        JitProgram* _prog;
+        std::string _name;
+    };
+
+    JitProgram(jitify::experimental::Program&& program,
+               const std::string& cache_key,
+               const std::string& source_hash = std::string(),
+               const std::vector<std::string>& kernel_names = std::vector<std::string>());
+    JitProgram(JitProgram&& other) = default;
+    JitProgram& operator=(JitProgram&& other) = default;
+
+    Kernel kernel(const std::string& name) { return Kernel(this, name); }
+
+    /// Identifies the substituted source and the flags this program was built from
+    const std::string& getSourceHash() const { return _source_hash; }
+
+    /// Compile (or load from the disk cache) all kernels defined in this program's source now, rather than on their
+    /// first launch
+    void instantiateAll();
+
+  private:
+    const jitify::experimental::KernelInstantiation& getInstance(const std::string& name);
+
+    std::unique_ptr<jitify::experimental::Program> _program;
+    // Identifies this program (source, flags and GPU arch) in the disk cache; empty if disk cache is not used
+    std::string _cache_key;
+    std::string _source_hash;
+    // The __global__ functions found in the source, for instantiateAll
+    std::vector<std::string> _kernel_names;
+    std::unique_ptr<std::mutex> _mutex;
+    std::unordered_map<std::string, std::unique_ptr<jitify::experimental::KernelInstantiation>> _instances;
+};
+
 class JitHelper {
   public:
     class Header {
@@ -31,12 +78,41 @@ class JitHelper {
         std::string _source;
     };
 
-    static jitify::Program buildProgram(
+    static JitProgram buildProgram(
         const std::string& name,
         const std::filesystem::path& source,
         std::unordered_map<std::string, std::string> substitutions = std::unordered_map<std::string, std::string>(),
         std::vector<std::string> flags = std::vector<std::string>());
 
+    /// Same as buildProgram, but runs on its own host thread and returns right away. The build thread sets device to be
+    /// the current device, so the GPU architecture is detected correctly. The thread also compiles all kernels of the
+    /// program (JitProgram::instantiateAll), so the first launches do not wait for NVRTC. Exceptions are re-thrown by
+    /// the future's get.
+    static std::future<std::shared_ptr<JitProgram>> buildProgramAsync(
+        int device,
+        const std::string& name,
+        const std::filesystem::path& source,
+        const std::unordered_map<std::string, std::string>& substitutions,
+        const std::vector<std::string>& flags);
+
+    /// Same as buildProgramAsync, but if prog (built earlier, can be null) was built from the same substituted source
+    /// and flags, nothing is built and the future gives prog itself. So after some substitutions change, only the
+    /// programs whose sources refer to them get re-jitified.
+    static std::future<std::shared_ptr<JitProgram>> updateProgramAsync(
+        const std::shared_ptr<JitProgram>& prog,
+        int device,
+        const std::string& name,
+        const std::filesystem::path& source,
+        const std::unordered_map<std::string, std::string>& substitutions,
+        const std::vector<std::string>& flags);
+
+    /// The synchronous version of updateProgramAsync, building on the current device
+    static std::shared_ptr<JitProgram> updateProgram(const std::shared_ptr<JitProgram>& prog,
+                                                     const std::string& name,
+                                                     const std::filesystem::path& source,
+                                                     const std::unordered_map<std::string, std::string>& substitutions,
+                                                     const std::vector<std::string>& flags);
+
     //// I'm pretty sure C++17 auto-converts this
     // static jitify::Program buildProgram(
     // 	const std::string& name, const std::string& code,
@@ -47,8 +123,34 @@ class JitHelper {
     static const std::filesystem::path KERNEL_DIR;
     static const std::filesystem::path KERNEL_INCLUDE_DIR;
 
+    /// Set the directory for caching jitified programs on disk. An empty path disables the disk cache. If never set,
+    /// the DEME_JIT_CACHE_DIR environment variable is used, if it exists.
+    static void SetCacheDir(const std::filesystem::path& dir);
+    static std::filesystem::path GetCacheDir();
+    /// The compute capability of the current device, such as "sm_80"
+    static std::string GetGpuArch();
+
+    // Used by JitProgram to store and retrieve cache entries. Writes go to a temp file first, then get renamed in
+    // place, so concurrent processes never see partially written entries.
+    static bool readCacheEntry(const std::string& entry, std::string& content);
+    static void writeCacheEntry(const std::string& entry, const std::string& content);
+
   private:
-    static jitify::JitCache kcache;
+    static std::mutex cache_dir_mutex;
+    static std::filesystem::path cache_dir;
+    static bool cache_dir_set;
+
+    // Hash of all kernel source files, so editing an included kernel file also invalidates the cache
+    static const std::string& kernelDirHash();
+
+    // Load the source and apply the substitutions, and add the flags every program needs
+    static std::string preprocessSource(const std::string& name,
+                                        const std::filesystem::path& source,
+                                        const std::unordered_map<std::string, std::string>& substitutions,
+                                        std::vector<std::string>& flags);
+    static uint64_t sourceHash(const std::string& code, const std::vector<std::string>& flags);
+    // Names of the kernels defined in a (substituted) source, skipping commented-out code
+    static std::vector<std::string> kernelNames(const std::string& code);
 
     inline static std::string loadSourceFile(const std::filesystem::path& sourcefile) {
         std::string code;
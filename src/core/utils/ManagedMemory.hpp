@@ -55,6 +55,14 @@ void migrate(const std::vector<T>& data, int device, cudaStream_t stream = 0) {
     __migrate_impl<T>(data.data(), data.size(), device, stream);
 }
 
+// Migrate the data contained in a vector with a custom (such as managed) allocator
+template <class T, class Alloc>
+void migrate(std::vector<T, Alloc>& data, int device, cudaStream_t stream = 0) {
+    if (data.size() > 0) {
+        __migrate_impl<T>(data.data(), data.size(), device, stream);
+    }
+}
+
 // Aliases for cudaMemoryAdvise constants
 enum class ManagedAdvice {
     READ_MOSTLY = cudaMemAdviseSetReadMostly,
@@ -89,6 +97,14 @@ void advise(const std::vector<T>& data, ManagedAdvice advice, int device) {
     __advise_impl(data.data(), data.size(), advice, device);
 }
 
+// Advice for underlying storage of a vector with a custom (such as managed) allocator
+template <class T, class Alloc>
+void advise(const std::vector<T, Alloc>& data, ManagedAdvice advice, int device) {
+    if (data.size() > 0) {
+        __advise_impl(data.data(), data.size(), advice, device);
+    }
+}
+
 }  // END namespace deme
 
 #endif
@@ -0,0 +1,44 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DEME_NVTX_RANGE_HPP
+#define DEME_NVTX_RANGE_HPP
+
+#include <core/ApiVersion.h>
+
+#if DEME_USE_NVTX
+    #include <nvtx3/nvToolsExt.h>
+#endif
+
+namespace deme {
+
+// Push and pop of NVTX ranges, so solver phases show up by name on Nsight Systems timelines. When the solver is not
+// built with USE_NVTX, they are no-ops; when it is but no profiler is attached, they cost next to nothing.
+inline void NvtxRangePush(const char* name) {
+#if DEME_USE_NVTX
+    nvtxRangePushA(name);
+#else
+    (void)name;
+#endif
+}
+
+inline void NvtxRangePop() {
+#if DEME_USE_NVTX
+    nvtxRangePop();
+#endif
+}
+
+// An NVTX range that lasts as long as this object, for phases that are not timed with a SolverTimer
+class NvtxScopedRange {
+  public:
+    explicit NvtxScopedRange(const char* name) { NvtxRangePush(name); }
+    ~NvtxScopedRange() { NvtxRangePop(); }
+    NvtxScopedRange(const NvtxScopedRange&) = delete;
+    NvtxScopedRange& operator=(const NvtxScopedRange&) = delete;
+};
+
+}  // namespace deme
+
+#endif
@@ -7,6 +7,7 @@
 #define DEME_THREAD_MANAGER_H
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 
@@ -18,6 +19,16 @@ class ManagerStatistics {
     std::atomic<uint64_t> nDynamicUpdates;
     std::atomic<uint64_t> nKinematicUpdates;
     std::atomic<uint64_t> accumKinematicLagSteps;
+    // Number of kT updates that reused the last contact list instead of running contact detection
+    std::atomic<uint64_t> nContactListReuses;
+    // Time (in nanoseconds) each side spent waiting on the other side
+    std::atomic<uint64_t> dynamicWaitNanosec;
+    std::atomic<uint64_t> kinematicWaitNanosec;
+    // GPU time (in nanoseconds) of kT's contact detection, timed with events when the cost-model drift controller is
+    // on; the last one is what dT's controller consumes
+    std::atomic<uint64_t> lastKinematicCDNanosec;
+    std::atomic<uint64_t> kinematicCDNanosec;
+    std::atomic<uint64_t> nKinematicCDTimed;
     // std::atomic<uint64_t> nDynamicReceives;
     // std::atomic<uint64_t> nKinematicReceives;
 
@@ -27,6 +38,12 @@ class ManagerStatistics {
         nDynamicUpdates = 0;
         nKinematicUpdates = 0;
         accumKinematicLagSteps = 0;
+        nContactListReuses = 0;
+        dynamicWaitNanosec = 0;
+        kinematicWaitNanosec = 0;
+        lastKinematicCDNanosec = 0;
+        kinematicCDNanosec = 0;
+        nKinematicCDTimed = 0;
         // nDynamicReceives = 0;
         // nKinematicReceives = 0;
     }
@@ -34,6 +51,20 @@ class ManagerStatistics {
     ~ManagerStatistics() {}
 };
 
+// Adds the time between its construction and destruction to an accumulator (in nanoseconds)
+class WaitTimeRecorder {
+  public:
+    WaitTimeRecorder(std::atomic<uint64_t>& accumulator)
+        : acc(accumulator), start(std::chrono::steady_clock::now()) {}
+    ~WaitTimeRecorder() {
+        acc += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+  private:
+    std::atomic<uint64_t>& acc;
+    std::chrono::steady_clock::time_point start;
+};
+
 // class that will be used via an atomic object to coordinate the
 // production-consumption interplay
 class ThreadManager {
@@ -48,11 +79,11 @@ class ThreadManager {
     std::atomic<int64_t> kinematicIngredProdDateStamp;  // dT tags this when sending it to kT
     std::atomic<int64_t> kinematicMaxFutureDrift;       // kT tags this to its produce before shipping
 
+    // The sender sets these right after queuing the copies into the receiver's buffer (no lock, no waiting for the
+    // copies). The order of copies is then enforced on the GPU by the sender's and receiver's CUDA events.
     std::atomic<bool> dynamicOwned_Prod2ConsBuffer_isFresh;
     std::atomic<bool> kinematicOwned_Cons2ProdBuffer_isFresh;
 
-    std::mutex dynamicOwnedBuffer_AccessCoordination;
-    std::mutex kinematicOwnedBuffer_AccessCoordination;
     std::mutex kinematicCanProceed;
     std::mutex dynamicCanProceed;
     std::condition_variable cv_KinematicCanProceed;
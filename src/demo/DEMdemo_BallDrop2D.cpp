@@ -58,6 +58,8 @@ int main() {
     DEMSim.InstructBoxDomainDimension({-world_size / 2., world_size / 2.}, {-world_size / 2., world_size / 2.},
                                       {0, 10 * world_size});
     DEMSim.InstructBoxDomainBoundingBC("top_open", mat_type_terrain);
+    // Entities are in the XZ plane, so the kernels can be specialized for 2D
+    DEMSim.UseTwoDimensionalMode();
 
     auto projectile = DEMSim.AddWavefrontMeshObject((GET_DATA_PATH() / "mesh/sphere.obj").string(), mat_type_ball);
     projectile->Scale(R);
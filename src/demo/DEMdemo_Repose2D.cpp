@@ -68,6 +68,8 @@ int main() {
 
     DEMSim.InstructBoxDomainDimension({-10, 10}, {-10, 10}, {funnel_bottom - 10.f, funnel_bottom + 20.f});
     DEMSim.InstructBoxDomainBoundingBC("top_open", mat_type_walls);
+    // Entities are in the XZ plane, so the kernels can be specialized for 2D
+    DEMSim.UseTwoDimensionalMode();
     DEMSim.SetInitTimeStep(5e-6);
     DEMSim.SetGravitationalAcceleration(make_float3(0, 0, -9.81));
     // Max velocity info is generally just for the solver's reference and the user do not have to set it. The solver
@@ -8,10 +8,57 @@ _clumpTemplateDefs_;
 // Definitions of analytical entites are below
 _analyticalEntityDefs_;
 
+// The bins a sphere touches in one direction (myBin is its center and span its radius, both in bins), as up to 2 ranges
+// [lo[0], hi[0]] and [lo[1], hi[1]]. The second is empty (hi < lo) unless the direction is periodic (periodBins long)
+// and the sphere reaches over one end of it, in which case it also touches the bins at the other end.
+inline __device__ void getSphereBinRanges(int64_t* lo,
+                                          int64_t* hi,
+                                          double myBin,
+                                          const double& span,
+                                          const deme::binID_t& nb,
+                                          bool periodic,
+                                          const double& periodBins) {
+    lo[1] = 0;
+    hi[1] = -1;
+    if (!periodic) {
+        lo[0] = (myBin - span > 0.0) ? (int64_t)(myBin - span) : 0;
+        hi[0] = (myBin + span < (double)nb) ? (int64_t)(myBin + span) : (int64_t)nb - 1;
+        return;
+    }
+    // The bins [0, nbPeriod) cover the period
+    const int64_t nbPeriod = (int64_t)ceil(periodBins);
+    myBin = periodicWrap<double>(myBin, periodBins);
+    lo[0] = (myBin - span > 0.0) ? (int64_t)(myBin - span) : 0;
+    hi[0] = (myBin + span < periodBins) ? (int64_t)(myBin + span) : nbPeriod - 1;
+    // The bins at the other end do not repeat the ones already touched, so no pair is found twice in a bin
+    if (myBin - span < 0.0) {
+        lo[1] = DEME_MAX((int64_t)(myBin - span + periodBins), hi[0] + 1);
+        hi[1] = nbPeriod - 1;
+    } else if (myBin + span >= periodBins) {
+        lo[1] = 0;
+        hi[1] = DEME_MIN((int64_t)(myBin + span - periodBins), lo[0] - 1);
+    }
+}
+
+inline __device__ int64_t numBinsInRanges(const int64_t* lo, const int64_t* hi) {
+    return DEME_MAX(hi[0] - lo[0] + 1, (int64_t)0) + DEME_MAX(hi[1] - lo[1] + 1, (int64_t)0);
+}
+
+// Whether a family is fixed (SetFamilyFixed), so its owners never move
+inline __device__ bool familyIsFixed(const unsigned int& family) {
+    switch (family) {
+        _fixedFamilyCases_;
+        default:
+            return false;
+    }
+}
+
 __global__ void getNumberOfBinsEachSphereTouches(deme::DEMSimParams* simParams,
                                                  deme::DEMDataKT* granData,
                                                  deme::binsSphereTouches_t* numBinsSphereTouches,
-                                                 deme::objID_t* numAnalGeoSphereTouches) {
+                                                 deme::objID_t* numAnalGeoSphereTouches,
+                                                 unsigned int binWhich,
+                                                 const float* fixedCacheMargin) {
     deme::bodyID_t sphereID = blockIdx.x * blockDim.x + threadIdx.x;
     if (sphereID < simParams->nSpheresGM) {
         // Register sphere--analytical geometry contacts
@@ -30,10 +77,19 @@ __global__ void getNumberOfBinsEachSphereTouches(deme::DEMSimParams* simParams,
             // Get my component offset info from either jitified arrays or global memory
             // Outputs myRelPos, myRadius (in CD kernels, radius needs to be expanded)
             // Use an input named exactly `sphereID' which is the id of this sphere component
+            // Fixed spheres go into the fixed-family bin cache, with the margin the cache is built for
+            const bool isFixed = familyIsFixed(sphFamilyNum);
+            const float myMargin =
+                (binWhich == deme::BIN_FIXED_SPHERES) ? fixedCacheMargin[myOwnerID] : granData->marginSize[myOwnerID];
             {
                 _componentAcqStrat_;
-                myRadius += granData->marginSize[myOwnerID];
+                myRadius += myMargin;
             }
+            // Spheres at the coarse level of the bin hierarchy do not go into bins, and neither do those this pass is
+            // not about
+            const bool isCoarse = (myRadius - myMargin > simParams->coarseSphereRadius) ||
+                                  (binWhich == deme::BIN_NON_FIXED_SPHERES && isFixed) ||
+                                  (binWhich == deme::BIN_FIXED_SPHERES && !isFixed);
 
             {
                 voxelIDToPosition<double, deme::voxelID_t, deme::subVoxelPos_t>(
@@ -52,28 +108,33 @@ __global__ void getNumberOfBinsEachSphereTouches(deme::DEMSimParams* simParams,
             {
                 // The bin number that I live in (with fractions)?
                 double myBinX = myPosXYZ.x / simParams->binSize;
-                double myBinY = myPosXYZ.y / simParams->binSize;
+                // In 2D, all spheres are in the only layer of bins in Y
+                double myBinY = _twoDimensional_ ? 0.0 : myPosXYZ.y / simParams->binSize;
                 double myBinZ = myPosXYZ.z / simParams->binSize;
                 // How many bins my radius spans (with fractions)?
                 double myRadiusSpan = myRadius / simParams->binSize;
-                // printf("myRadius: %f\n", myRadiusSpan);
                 // Now, figure out how many bins I touch in each direction
-                numX = ((myBinX + myRadiusSpan < (double)simParams->nbX) ? (unsigned int)(myBinX + myRadiusSpan)
-                                                                         : (unsigned int)simParams->nbX - 1) -
-                       (unsigned int)((myBinX - myRadiusSpan > 0.0) ? myBinX - myRadiusSpan : 0.0) + 1;
-                numY = ((myBinY + myRadiusSpan < (double)simParams->nbY) ? (unsigned int)(myBinY + myRadiusSpan)
-                                                                         : (unsigned int)simParams->nbY - 1) -
-                       (unsigned int)((myBinY - myRadiusSpan > 0.0) ? myBinY - myRadiusSpan : 0.0) + 1;
-                numZ = ((myBinZ + myRadiusSpan < (double)simParams->nbZ) ? (unsigned int)(myBinZ + myRadiusSpan)
-                                                                         : (unsigned int)simParams->nbZ - 1) -
-                       (unsigned int)((myBinZ - myRadiusSpan > 0.0) ? myBinZ - myRadiusSpan : 0.0) + 1;
+                int64_t lo[2], hi[2];
+                getSphereBinRanges(lo, hi, myBinX, myRadiusSpan, simParams->nbX, _periodicX_,
+                                   _periodLenX_ / simParams->binSize);
+                numX = numBinsInRanges(lo, hi);
+                getSphereBinRanges(lo, hi, myBinY, myRadiusSpan, simParams->nbY, _periodicY_,
+                                   _periodLenY_ / simParams->binSize);
+                numY = numBinsInRanges(lo, hi);
+                getSphereBinRanges(lo, hi, myBinZ, myRadiusSpan, simParams->nbZ, _periodicZ_,
+                                   _periodLenZ_ / simParams->binSize);
+                numZ = numBinsInRanges(lo, hi);
                 //// TODO: Add an error message if numX * numY * numZ > MAX(binsSphereTouches_t)
             }
 
             // Write the number of bins this sphere touches back to the global array
-            numBinsSphereTouches[sphereID] = numX * numY * numZ;
+            numBinsSphereTouches[sphereID] = isCoarse ? 0 : numX * numY * numZ;
             // printf("This sp takes num of bins: %u\n", numX * numY * numZ);
         }
+        // Building the fixed-family bin cache is only about the bins
+        if (binWhich == deme::BIN_FIXED_SPHERES) {
+            return;
+        }
 
         // Each sphere entity should also check if it overlaps with an analytical boundary-type geometry
         for (deme::objID_t objB = 0; objB < simParams->nAnalGM; objB++) {
@@ -138,7 +199,9 @@ __global__ void populateBinSphereTouchingPairs(deme::DEMSimParams* simParams,
                                                deme::bodyID_t* sphereIDsEachBinTouches,
                                                deme::bodyID_t* idGeoA,
                                                deme::bodyID_t* idGeoB,
-                                               deme::contact_t* contactType) {
+                                               deme::contact_t* contactType,
+                                               unsigned int binWhich,
+                                               const float* fixedCacheMargin) {
     deme::bodyID_t sphereID = blockIdx.x * blockDim.x + threadIdx.x;
     if (sphereID < simParams->nSpheresGM) {
         double3 myPosXYZ;
@@ -155,10 +218,19 @@ __global__ void populateBinSphereTouchingPairs(deme::DEMSimParams* simParams,
             // Get my component offset info from either jitified arrays or global memory
             // Outputs myRelPos, myRadius (in CD kernels, radius needs to be expanded)
             // Use an input named exactly `sphereID' which is the id of this sphere component
+            // Fixed spheres go into the fixed-family bin cache, with the margin the cache is built for
+            const bool isFixed = familyIsFixed(sphFamilyNum);
+            const float myMargin =
+                (binWhich == deme::BIN_FIXED_SPHERES) ? fixedCacheMargin[myOwnerID] : granData->marginSize[myOwnerID];
             {
                 _componentAcqStrat_;
-                myRadius += granData->marginSize[myOwnerID];
+                myRadius += myMargin;
             }
+            // Spheres at the coarse level of the bin hierarchy do not go into bins, and neither do those this pass is
+            // not about
+            const bool isCoarse = (myRadius - myMargin > simParams->coarseSphereRadius) ||
+                                  (binWhich == deme::BIN_NON_FIXED_SPHERES && isFixed) ||
+                                  (binWhich == deme::BIN_FIXED_SPHERES && !isFixed);
 
             // Get the offset of my spot where I should start writing back to the global bin--sphere pair registration
             // array
@@ -180,26 +252,37 @@ __global__ void populateBinSphereTouchingPairs(deme::DEMSimParams* simParams,
 
             // The bin number that I live in (with fractions)?
             double myBinX = myPosXYZ.x / simParams->binSize;
-            double myBinY = myPosXYZ.y / simParams->binSize;
+            double myBinY = _twoDimensional_ ? 0.0 : myPosXYZ.y / simParams->binSize;
             double myBinZ = myPosXYZ.z / simParams->binSize;
             // How many bins my radius spans (with fractions)?
             double myRadiusSpan = myRadius / simParams->binSize;
+            int64_t loX[2], hiX[2], loY[2], hiY[2], loZ[2], hiZ[2];
+            getSphereBinRanges(loX, hiX, myBinX, myRadiusSpan, simParams->nbX, _periodicX_,
+                               _periodLenX_ / simParams->binSize);
+            getSphereBinRanges(loY, hiY, myBinY, myRadiusSpan, simParams->nbY, _periodicY_,
+                               _periodLenY_ / simParams->binSize);
+            getSphereBinRanges(loZ, hiZ, myBinZ, myRadiusSpan, simParams->nbZ, _periodicZ_,
+                               _periodLenZ_ / simParams->binSize);
             // Now, write the IDs of those bins that I touch, back to the global memory
             deme::binID_t thisBinID;
-            for (deme::binID_t k = (deme::binID_t)((myBinZ - myRadiusSpan > 0.0) ? myBinZ - myRadiusSpan : 0.0);
-                 (k <= (deme::binID_t)(myBinZ + myRadiusSpan)) && (k < simParams->nbZ); k++) {
-                for (deme::binID_t j = (deme::binID_t)((myBinY - myRadiusSpan > 0.0) ? myBinY - myRadiusSpan : 0.0);
-                     (j <= (deme::binID_t)(myBinY + myRadiusSpan)) && (j < simParams->nbY); j++) {
-                    for (deme::binID_t i = (deme::binID_t)((myBinX - myRadiusSpan > 0.0) ? myBinX - myRadiusSpan : 0.0);
-                         (i <= (deme::binID_t)(myBinX + myRadiusSpan)) && (i < simParams->nbX); i++) {
-                        if (myReportOffset >= myReportOffset_end) {
-                            continue;  // No stepping on the next one's domain
+            for (unsigned int rk = 0; !isCoarse && rk < 2; rk++) {
+                for (int64_t k = loZ[rk]; k <= hiZ[rk]; k++) {
+                    for (unsigned int rj = 0; rj < 2; rj++) {
+                        for (int64_t j = loY[rj]; j <= hiY[rj]; j++) {
+                            for (unsigned int ri = 0; ri < 2; ri++) {
+                                for (int64_t i = loX[ri]; i <= hiX[ri]; i++) {
+                                    if (myReportOffset >= myReportOffset_end) {
+                                        continue;  // No stepping on the next one's domain
+                                    }
+                                    thisBinID = binIDFrom3Indices<deme::binID_t>(
+                                        (deme::binID_t)i, (deme::binID_t)j, (deme::binID_t)k, simParams->nbX,
+                                        simParams->nbY, simParams->nbZ);
+                                    binIDsEachSphereTouches[myReportOffset] = thisBinID;
+                                    sphereIDsEachBinTouches[myReportOffset] = sphereID;
+                                    myReportOffset++;
+                                }
+                            }
                         }
-                        thisBinID =
-                            binIDFrom3Indices<deme::binID_t>(i, j, k, simParams->nbX, simParams->nbY, simParams->nbZ);
-                        binIDsEachSphereTouches[myReportOffset] = thisBinID;
-                        sphereIDsEachBinTouches[myReportOffset] = sphereID;
-                        myReportOffset++;
                     }
                 }
             }
@@ -210,6 +293,9 @@ __global__ void populateBinSphereTouchingPairs(deme::DEMSimParams* simParams,
                 sphereIDsEachBinTouches[myReportOffset] = sphereID;
             }
         }
+        if (binWhich == deme::BIN_FIXED_SPHERES) {
+            return;
+        }
 
         deme::binSphereTouchPairs_t mySphereGeoReportOffset = numAnalGeoSphereTouchesScan[sphereID];
         deme::binSphereTouchPairs_t mySphereGeoReportOffset_end = numAnalGeoSphereTouchesScan[sphereID + 1];
@@ -276,3 +362,195 @@ __global__ void populateBinSphereTouchingPairs(deme::DEMSimParams* simParams,
         }
     }
 }
+
+// Record the owner states at a contact detection, so later updates can tell how much the owners have moved since
+__global__ void recordOwnerStatesAtCD(deme::DEMSimParams* simParams,
+                                      deme::DEMDataKT* granData,
+                                      double3* lastCDPos,
+                                      float4* lastCDOriQ,
+                                      float* lastCDMarginSize,
+                                      deme::family_t* lastCDFamilyID,
+                                      size_t n) {
+    deme::bodyID_t ownerID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (ownerID < n) {
+        double3 ownerXYZ;
+        voxelIDToPosition<double, deme::voxelID_t, deme::subVoxelPos_t>(
+            ownerXYZ.x, ownerXYZ.y, ownerXYZ.z, granData->voxelID[ownerID], granData->locX[ownerID],
+            granData->locY[ownerID], granData->locZ[ownerID], _nvXp2_, _nvYp2_, _voxelSize_, _l_);
+        lastCDPos[ownerID] = ownerXYZ;
+        lastCDOriQ[ownerID] = make_float4(granData->oriQx[ownerID], granData->oriQy[ownerID], granData->oriQz[ownerID],
+                                          granData->oriQw[ownerID]);
+        lastCDMarginSize[ownerID] = granData->marginSize[ownerID];
+        lastCDFamilyID[ownerID] = granData->familyID[ownerID];
+    }
+}
+
+// A sphere can keep using the contact list from the last CD if the distance it moved since then, plus the margin it
+// needs for the coming update (marginSize now), stays within the margin it got at the last CD. Any sphere failing that,
+// or changing family, sets the flag.
+__global__ void checkSphereMarginUsedUp(deme::DEMSimParams* simParams,
+                                        deme::DEMDataKT* granData,
+                                        double3* lastCDPos,
+                                        float4* lastCDOriQ,
+                                        float* lastCDMarginSize,
+                                        deme::family_t* lastCDFamilyID,
+                                        deme::notStupidBool_t* needCD) {
+    deme::bodyID_t sphereID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (sphereID < simParams->nSpheresGM) {
+        deme::bodyID_t myOwnerID = granData->ownerClumpBody[sphereID];
+        if (granData->familyID[myOwnerID] != lastCDFamilyID[myOwnerID]) {
+            *needCD = 1;
+            return;
+        }
+        float3 myRelPos;
+        float myRadius;
+        // Get my component offset info from either jitified arrays or global memory
+        // Outputs myRelPos, myRadius
+        // Use an input named exactly `sphereID' which is the id of this sphere component
+        { _componentAcqStrat_; }
+
+        double3 ownerXYZ;
+        voxelIDToPosition<double, deme::voxelID_t, deme::subVoxelPos_t>(
+            ownerXYZ.x, ownerXYZ.y, ownerXYZ.z, granData->voxelID[myOwnerID], granData->locX[myOwnerID],
+            granData->locY[myOwnerID], granData->locZ[myOwnerID], _nvXp2_, _nvYp2_, _voxelSize_, _l_);
+        float3 nowRelPos = myRelPos;
+        applyOriQToVector3<float, deme::oriQ_t>(nowRelPos.x, nowRelPos.y, nowRelPos.z, granData->oriQw[myOwnerID],
+                                                granData->oriQx[myOwnerID], granData->oriQy[myOwnerID],
+                                                granData->oriQz[myOwnerID]);
+        const float4 lastOriQ = lastCDOriQ[myOwnerID];
+        applyOriQToVector3<float, deme::oriQ_t>(myRelPos.x, myRelPos.y, myRelPos.z, lastOriQ.w, lastOriQ.x, lastOriQ.y,
+                                                lastOriQ.z);
+        const double3 moved = (ownerXYZ + to_double3(nowRelPos)) - (lastCDPos[myOwnerID] + to_double3(myRelPos));
+        const double dist = sqrt(moved.x * moved.x + moved.y * moved.y + moved.z * moved.z);
+        if (dist + (double)granData->marginSize[myOwnerID] > (double)lastCDMarginSize[myOwnerID]) {
+            *needCD = 1;
+        }
+    }
+}
+
+// Analytical objects and meshes can be large, so a small rotation may move parts of them a lot. We just ask for a new
+// CD whenever their owners moved at all.
+__global__ void checkNonSphereOwnersMoved(deme::DEMSimParams* simParams,
+                                          deme::DEMDataKT* granData,
+                                          double3* lastCDPos,
+                                          float4* lastCDOriQ,
+                                          deme::family_t* lastCDFamilyID,
+                                          deme::notStupidBool_t* needCD) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < (size_t)simParams->nAnalGM + (size_t)simParams->nTriGM) {
+        deme::bodyID_t myOwnerID =
+            (myID < simParams->nAnalGM) ? objOwner[myID] : granData->ownerMesh[myID - simParams->nAnalGM];
+        double3 ownerXYZ;
+        voxelIDToPosition<double, deme::voxelID_t, deme::subVoxelPos_t>(
+            ownerXYZ.x, ownerXYZ.y, ownerXYZ.z, granData->voxelID[myOwnerID], granData->locX[myOwnerID],
+            granData->locY[myOwnerID], granData->locZ[myOwnerID], _nvXp2_, _nvYp2_, _voxelSize_, _l_);
+        const double3 lastPos = lastCDPos[myOwnerID];
+        const float4 lastOriQ = lastCDOriQ[myOwnerID];
+        if (ownerXYZ.x != lastPos.x || ownerXYZ.y != lastPos.y || ownerXYZ.z != lastPos.z ||
+            granData->oriQw[myOwnerID] != lastOriQ.w || granData->oriQx[myOwnerID] != lastOriQ.x ||
+            granData->oriQy[myOwnerID] != lastOriQ.y || granData->oriQz[myOwnerID] != lastOriQ.z ||
+            granData->familyID[myOwnerID] != lastCDFamilyID[myOwnerID]) {
+            *needCD = 1;
+        }
+    }
+}
+
+// Record the owner states the fixed-family bin cache is built for. The cached owners are binned with a multiple of
+// their margin now, so the cache still holds when their margins grow a bit later.
+__global__ void recordFixedBinCacheStates(deme::DEMSimParams* simParams,
+                                          deme::DEMDataKT* granData,
+                                          double3* cachePos,
+                                          float4* cacheOriQ,
+                                          float* cacheMarginSize,
+                                          deme::notStupidBool_t* ownerIsCached,
+                                          size_t n) {
+    deme::bodyID_t ownerID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (ownerID < n) {
+        double3 ownerXYZ;
+        voxelIDToPosition<double, deme::voxelID_t, deme::subVoxelPos_t>(
+            ownerXYZ.x, ownerXYZ.y, ownerXYZ.z, granData->voxelID[ownerID], granData->locX[ownerID],
+            granData->locY[ownerID], granData->locZ[ownerID], _nvXp2_, _nvYp2_, _voxelSize_, _l_);
+        cachePos[ownerID] = ownerXYZ;
+        cacheOriQ[ownerID] = make_float4(granData->oriQx[ownerID], granData->oriQy[ownerID], granData->oriQz[ownerID],
+                                         granData->oriQw[ownerID]);
+        cacheMarginSize[ownerID] = granData->marginSize[ownerID] * deme::FIXED_BIN_CACHE_MARGIN_MULTIPLE;
+        ownerIsCached[ownerID] = familyIsFixed(granData->familyID[ownerID]);
+    }
+}
+
+// The fixed-family bin cache is void if an owner got into or out of a fixed family, or a cached owner moved (the user
+// can still move fixed owners through trackers) or needs a larger margin than it is cached with
+__global__ void checkFixedBinCacheValid(deme::DEMSimParams* simParams,
+                                        deme::DEMDataKT* granData,
+                                        double3* cachePos,
+                                        float4* cacheOriQ,
+                                        float* cacheMarginSize,
+                                        deme::notStupidBool_t* ownerIsCached,
+                                        deme::notStupidBool_t* needRebuild,
+                                        size_t n) {
+    deme::bodyID_t ownerID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (ownerID < n) {
+        const bool isFixed = familyIsFixed(granData->familyID[ownerID]);
+        if (isFixed != (bool)ownerIsCached[ownerID]) {
+            *needRebuild = 1;
+            return;
+        }
+        if (!isFixed) {
+            return;
+        }
+        double3 ownerXYZ;
+        voxelIDToPosition<double, deme::voxelID_t, deme::subVoxelPos_t>(
+            ownerXYZ.x, ownerXYZ.y, ownerXYZ.z, granData->voxelID[ownerID], granData->locX[ownerID],
+            granData->locY[ownerID], granData->locZ[ownerID], _nvXp2_, _nvYp2_, _voxelSize_, _l_);
+        const double3 lastPos = cachePos[ownerID];
+        const float4 lastOriQ = cacheOriQ[ownerID];
+        if (ownerXYZ.x != lastPos.x || ownerXYZ.y != lastPos.y || ownerXYZ.z != lastPos.z ||
+            granData->oriQw[ownerID] != lastOriQ.w || granData->oriQx[ownerID] != lastOriQ.x ||
+            granData->oriQy[ownerID] != lastOriQ.y || granData->oriQz[ownerID] != lastOriQ.z ||
+            granData->marginSize[ownerID] > cacheMarginSize[ownerID]) {
+            *needRebuild = 1;
+        }
+    }
+}
+
+// Bin occupancy profiler: add the count of each of the n bins to a log2-bucketed histogram. Each block builds its own
+// histogram in shared memory first, so only a few global atomics are needed per block.
+template <typename T>
+inline __device__ void addToBinProfileHistogram(const T* counts, unsigned long long* hist, size_t n) {
+    __shared__ unsigned int blockHist[DEME_BIN_PROFILE_NUM_BUCKETS];
+    for (unsigned int i = threadIdx.x; i < DEME_BIN_PROFILE_NUM_BUCKETS; i += blockDim.x) {
+        blockHist[i] = 0;
+    }
+    __syncthreads();
+    size_t myBin = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myBin < n) {
+        const unsigned int count = (unsigned int)counts[myBin];
+        unsigned int bucket = (count == 0) ? 0 : 32 - __clz(count);
+        if (bucket >= DEME_BIN_PROFILE_NUM_BUCKETS)
+            bucket = DEME_BIN_PROFILE_NUM_BUCKETS - 1;
+        atomicAdd(blockHist + bucket, 1u);
+    }
+    __syncthreads();
+    for (unsigned int i = threadIdx.x; i < DEME_BIN_PROFILE_NUM_BUCKETS; i += blockDim.x) {
+        if (blockHist[i] > 0)
+            atomicAdd(hist + i, (unsigned long long)blockHist[i]);
+    }
+}
+
+__global__ void profileSpheresPerBin(deme::spheresBinTouches_t* numSpheresBinTouches,
+                                     unsigned long long* hist,
+                                     size_t nActiveBins) {
+    addToBinProfileHistogram<deme::spheresBinTouches_t>(numSpheresBinTouches, hist, nActiveBins);
+}
+
+__global__ void profileTrianglesPerBin(deme::trianglesBinTouches_t* numTrianglesBinTouches,
+                                       unsigned long long* hist,
+                                       size_t nActiveBins) {
+    addToBinProfileHistogram<deme::trianglesBinTouches_t>(numTrianglesBinTouches, hist, nActiveBins);
+}
+
+__global__ void profileContactsPerBin(deme::binContactPairs_t* numContactsInEachBin,
+                                      unsigned long long* hist,
+                                      size_t nActiveBins) {
+    addToBinProfileHistogram<deme::binContactPairs_t>(numContactsInEachBin, hist, nActiveBins);
+}
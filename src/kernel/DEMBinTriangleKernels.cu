@@ -30,9 +30,10 @@ __global__ void makeTriangleSandwich(deme::DEMSimParams* simParams,
     deme::bodyID_t triID = blockIdx.x * blockDim.x + threadIdx.x;
     if (triID < simParams->nTriGM) {
         // Get my component offset info from global array
-        const float3 p1 = granData->relPosNode1[triID];
-        const float3 p2 = granData->relPosNode2[triID];
-        const float3 p3 = granData->relPosNode3[triID];
+        const deme::bodyID_t myNode = granData->triNodeOffset[triID];
+        const float3 p1 = granData->relPosNode1[myNode];
+        const float3 p2 = granData->relPosNode2[myNode];
+        const float3 p3 = granData->relPosNode3[myNode];
         const deme::bodyID_t myOwnerID = granData->ownerMesh[triID];
 
         // Get the incenter of this triangle.
@@ -95,6 +96,11 @@ __global__ void getNumberOfBinsEachTriangleTouches(deme::DEMSimParams* simParams
                                                    float3* nodeC2) {
     deme::bodyID_t triID = blockIdx.x * blockDim.x + threadIdx.x;
     if (triID < simParams->nTriGM) {
+        // Facets in BVHs find their contacts without bins
+        if (granData->triInBVH[triID]) {
+            numBinsTriTouches[triID] = 0;
+            return;
+        }
         // 3 vertices of the triangle
         float3 vA1, vB1, vC1, vA2, vB2, vC2;
         deme::binID_t L1[3], L2[3], U1[3], U2[3];
@@ -149,6 +155,9 @@ __global__ void populateBinTriangleTouchingPairs(deme::DEMSimParams* simParams,
                                                  float3* nodeC2) {
     deme::bodyID_t triID = blockIdx.x * blockDim.x + threadIdx.x;
     if (triID < simParams->nTriGM) {
+        // Facets in BVHs take no bin--triangle pairs
+        if (granData->triInBVH[triID])
+            return;
         // 3 vertices of the triangle
         float3 vA1, vB1, vC1, vA2, vB2, vC2;
         deme::binID_t L1[3], L2[3], U1[3], U2[3];
@@ -219,3 +228,168 @@ __global__ void mapTriActiveBinsToSphActiveBins(deme::binID_t* activeBinIDsForTr
         }
     }
 }
+
+// =============================================================================
+// Kernels for building and refitting the BVHs of meshes that do not go through bins
+// =============================================================================
+
+// Spread the lower 10 bits of a number so that there are 2 zero bits between every 2 of them
+inline __device__ unsigned int spreadBitsBy3For30(unsigned int a) {
+    a = (a * 0x00010001u) & 0xFF0000FFu;
+    a = (a * 0x00000101u) & 0x0F00F00Fu;
+    a = (a * 0x00000011u) & 0xC30C30C3u;
+    a = (a * 0x00000005u) & 0x49249249u;
+    return a;
+}
+
+// The key of a BVH leaf is its mesh index (high 32 bits) followed by the 30-bit Morton code of the facet's centroid in
+// the mesh's own frame, so sorting the keys gives each mesh a contiguous, Morton-ordered segment of leaves.
+__global__ void computeTriBVHLeafKeys(deme::DEMDataKT* granData,
+                                      deme::bodyID_t* leafTriID,
+                                      deme::bodyID_t* leafMesh,
+                                      float3* meshBoxMin,
+                                      float3* meshBoxMax,
+                                      uint64_t* keys,
+                                      size_t nLeaves) {
+    size_t leaf = blockIdx.x * blockDim.x + threadIdx.x;
+    if (leaf < nLeaves) {
+        const deme::bodyID_t triID = leafTriID[leaf];
+        const deme::bodyID_t mesh = leafMesh[leaf];
+        const deme::bodyID_t node = granData->triNodeOffset[triID];
+        const float3 centroid =
+            (granData->relPosNode1[node] + granData->relPosNode2[node] + granData->relPosNode3[node]) / 3.f;
+        const float3 extent = fmaxf(meshBoxMax[mesh] - meshBoxMin[mesh], make_float3(DEME_TINY_FLOAT));
+        const float3 normalized = clamp((centroid - meshBoxMin[mesh]) / extent, 0.f, 1.f) * 1023.f;
+        const unsigned int code = spreadBitsBy3For30((unsigned int)normalized.x) |
+                                  (spreadBitsBy3For30((unsigned int)normalized.y) << 1) |
+                                  (spreadBitsBy3For30((unsigned int)normalized.z) << 2);
+        keys[leaf] = ((uint64_t)mesh << 32) | (uint64_t)code;
+    }
+}
+
+// Length of the common prefix of 2 sorted leaf keys of the same mesh, or -1 if j is not a leaf of that mesh. Equal
+// keys use the leaf indices for tie-breaking.
+inline __device__ int triBVHKeyPrefix(const uint64_t* keys, int i, int j, int nLeavesInMesh) {
+    if (j < 0 || j >= nLeavesInMesh)
+        return -1;
+    const uint64_t diff = keys[i] ^ keys[j];
+    if (diff == 0)
+        return 64 + __clz((unsigned int)(i ^ j));
+    return __clzll((long long)diff);
+}
+
+// Build the internal nodes of each mesh's BVH from the sorted leaves, following Karras (2012), "Maximizing
+// parallelism in the construction of BVHs, octrees, and k-d trees". Each thread works on one leaf position, and the
+// positions except the last one of each mesh produce an internal node.
+__global__ void buildTriBVHInternalNodes(uint64_t* keys,
+                                         deme::bodyID_t* leafMesh,
+                                         deme::bodyID_t* meshLeafStart,
+                                         deme::bodyID_t* meshLeafCount,
+                                         deme::bodyID_t* childL,
+                                         deme::bodyID_t* childR,
+                                         deme::bodyID_t* parent,
+                                         size_t nLeaves,
+                                         size_t nInternal) {
+    size_t leaf = blockIdx.x * blockDim.x + threadIdx.x;
+    if (leaf < nLeaves) {
+        const deme::bodyID_t mesh = leafMesh[leaf];
+        const deme::bodyID_t leafStart = meshLeafStart[mesh];
+        const int n = meshLeafCount[mesh];
+        const int i = leaf - leafStart;
+        // Internal nodes of this mesh start here, and its leaf nodes start after all internal nodes
+        const deme::bodyID_t nodeStart = leafStart - mesh;
+        const deme::bodyID_t leafNodeStart = nInternal + leafStart;
+        const uint64_t* myKeys = keys + leafStart;
+        if (i == 0) {
+            // The root has no parent
+            parent[(n == 1) ? leafNodeStart : nodeStart] = deme::NULL_BODYID;
+        }
+        if (i >= n - 1)
+            return;
+
+        // Direction of the range this node covers
+        const int d = (triBVHKeyPrefix(myKeys, i, i + 1, n) - triBVHKeyPrefix(myKeys, i, i - 1, n)) >= 0 ? 1 : -1;
+        // Upper bound of the range length, then the exact other end of the range
+        const int prefixMin = triBVHKeyPrefix(myKeys, i, i - d, n);
+        int lenMax = 2;
+        while (triBVHKeyPrefix(myKeys, i, i + lenMax * d, n) > prefixMin)
+            lenMax *= 2;
+        int len = 0;
+        for (int t = lenMax / 2; t >= 1; t /= 2) {
+            if (triBVHKeyPrefix(myKeys, i, i + (len + t) * d, n) > prefixMin)
+                len += t;
+        }
+        const int j = i + len * d;
+        // Then where the range splits
+        const int prefixNode = triBVHKeyPrefix(myKeys, i, j, n);
+        int s = 0;
+        int t = len;
+        do {
+            t = (t + 1) / 2;
+            if (triBVHKeyPrefix(myKeys, i, i + (s + t) * d, n) > prefixNode)
+                s += t;
+        } while (t > 1);
+        const int split = i + s * d + DEME_MIN(d, 0);
+
+        const deme::bodyID_t me = nodeStart + i;
+        const deme::bodyID_t left = (DEME_MIN(i, j) == split) ? leafNodeStart + split : nodeStart + split;
+        const deme::bodyID_t right = (DEME_MAX(i, j) == split + 1) ? leafNodeStart + split + 1 : nodeStart + split + 1;
+        childL[me] = left;
+        childR[me] = right;
+        parent[left] = me;
+        parent[right] = me;
+    }
+}
+
+// Refit the BVH boxes so that they bound the `sandwich' triangles, which change with the contact margin. Boxes are in
+// the meshes' own frames. Each leaf climbs to the root, and at each internal node, only the second child to arrive
+// carries on.
+__global__ void refitTriBVH(deme::bodyID_t* leafTriID,
+                            deme::bodyID_t* childL,
+                            deme::bodyID_t* childR,
+                            deme::bodyID_t* parent,
+                            float3* boxMin,
+                            float3* boxMax,
+                            unsigned int* refitCount,
+                            float3* sandwichANode1,
+                            float3* sandwichANode2,
+                            float3* sandwichANode3,
+                            float3* sandwichBNode1,
+                            float3* sandwichBNode2,
+                            float3* sandwichBNode3,
+                            size_t nLeaves,
+                            size_t nInternal) {
+    size_t leaf = blockIdx.x * blockDim.x + threadIdx.x;
+    if (leaf < nLeaves) {
+        const deme::bodyID_t triID = leafTriID[leaf];
+        float3 myMin = fminf(fminf(sandwichANode1[triID], sandwichANode2[triID]), sandwichANode3[triID]);
+        float3 myMax = fmaxf(fmaxf(sandwichANode1[triID], sandwichANode2[triID]), sandwichANode3[triID]);
+        myMin = fminf(myMin, fminf(fminf(sandwichBNode1[triID], sandwichBNode2[triID]), sandwichBNode3[triID]));
+        myMax = fmaxf(myMax, fmaxf(fmaxf(sandwichBNode1[triID], sandwichBNode2[triID]), sandwichBNode3[triID]));
+        deme::bodyID_t node = nInternal + leaf;
+        boxMin[node] = myMin;
+        boxMax[node] = myMax;
+
+        node = parent[node];
+        while (node != deme::NULL_BODYID) {
+            // Make my box visible before the other child can see that I have arrived
+            __threadfence();
+            if (atomicAdd(refitCount + node, 1) == 0)
+                return;
+            // The other child's box is read bypassing L1, which may hold it stale
+            const deme::bodyID_t left = childL[node];
+            const deme::bodyID_t right = childR[node];
+            const float* lMin = (const float*)(boxMin + left);
+            const float* lMax = (const float*)(boxMax + left);
+            const float* rMin = (const float*)(boxMin + right);
+            const float* rMax = (const float*)(boxMax + right);
+            myMin = make_float3(fminf(__ldcg(lMin), __ldcg(rMin)), fminf(__ldcg(lMin + 1), __ldcg(rMin + 1)),
+                                fminf(__ldcg(lMin + 2), __ldcg(rMin + 2)));
+            myMax = make_float3(fmaxf(__ldcg(lMax), __ldcg(rMax)), fmaxf(__ldcg(lMax + 1), __ldcg(rMax + 1)),
+                                fmaxf(__ldcg(lMax + 2), __ldcg(rMax + 2)));
+            boxMin[node] = myMin;
+            boxMax[node] = myMax;
+            node = parent[node];
+        }
+    }
+}
@@ -39,227 +39,412 @@ inline __device__ void equipOwnerPosRot(deme::DEMSimParams* simParams,
     bodyPos.z = ownerPos.z + (double)relPos.z;
 }
 
+// The force model of a contact, by the family and material pairs that are assigned extra force models (0 is the main
+// model)
+inline __device__ unsigned int forceModelOfContact(const deme::family_t& AOwnerFamily,
+                                                   const deme::family_t& BOwnerFamily,
+                                                   const deme::materialsOffset_t& bodyAMatType,
+                                                   const deme::materialsOffset_t& bodyBMatType) {
+    unsigned int forceModelID = 0;
+    _forceModelSelection_;
+    return forceModelID;
+}
+
+// Calculate the force of one contact. The template arguments say which contact types this instance handles: the
+// all-in-one kernel handles them all, while each type-segmented kernel handles one, so the code (and the registers) for
+// the other types are compiled out. Contacts of a type an instance does not handle are treated as non-contacts.
+// Likewise, FORCE_MODEL_ID, if not negative, is the only force model this instance runs; it is for contacts known to
+// use that model. A negative one means the model of each contact is picked at run time.
+template <bool HANDLES_SPH_SPH, bool HANDLES_SPH_MESH, bool HANDLES_SPH_ANAL, int FORCE_MODEL_ID>
+inline __device__ void calculateContactForce(deme::DEMSimParams* simParams,
+                                             deme::DEMDataDT* granData,
+                                             const deme::contactPairs_t& myContactID) {
+    // Identify contact type first
+    deme::contact_t myContactType = granData->contactType[myContactID];
+    // With multi-rate stepping, if neither owner is integrated in this step, this contact's force is not needed; nor is
+    // it if both owners are asleep. Its contact history is left as is, and is advanced by all the skipped steps
+    // (cntStepMultiple of h) the next time this contact is evaluated.
+    unsigned int cntStepMultiple = 1;
+    if ((simParams->useFamilyStepRatio || simParams->useSleeping) && myContactType != deme::NOT_A_CONTACT) {
+        deme::bodyID_t idB = granData->idGeometryB[myContactID];
+        deme::bodyID_t ownerA = granData->ownerClumpBody[granData->idGeometryA[myContactID]];
+        deme::bodyID_t ownerB;
+        if (myContactType == deme::SPHERE_SPHERE_CONTACT) {
+            ownerB = granData->ownerClumpBody[idB];
+        } else if (myContactType == deme::SPHERE_MESH_CONTACT) {
+            ownerB = granData->ownerMesh[idB];
+        } else {
+            ownerB = objOwner[idB];
+        }
+        if (ownerStepMultiple(simParams, granData, ownerA) == 0 &&
+            ownerStepMultiple(simParams, granData, ownerB) == 0) {
+            return;
+        }
+        cntStepMultiple = contactStepMultiple(simParams, granData, ownerA, ownerB);
+        if (simParams->useSleeping) {
+            const bool AAsleep = ownerIsAsleep(simParams, granData, ownerA);
+            const bool BAsleep = ownerIsAsleep(simParams, granData, ownerB);
+            // Contacts among sleepers are skipped, unless one of them is checked for waking up, which needs its full
+            // net acceleration. A sleeper touched by an awake owner is checked in the next step.
+            if (AAsleep && BAsleep) {
+                if (!sleeperIsChecked(granData, ownerA) && !sleeperIsChecked(granData, ownerB)) {
+                    return;
+                }
+            } else if (AAsleep) {
+                touchSleeper(granData, ownerA);
+            } else if (BAsleep) {
+                touchSleeper(granData, ownerB);
+            }
+        }
+    }
+    // The following quantities are always calculated, regardless of force model
+    double3 contactPnt;
+    float3 B2A;  // Unit vector pointing from body B to body A (contact normal)
+    double overlapDepth;
+    double3 AOwnerPos, bodyAPos, BOwnerPos, bodyBPos;
+    float AOwnerMass, ARadius, BOwnerMass, BRadius;
+    float4 AOriQ, BOriQ;
+    deme::materialsOffset_t bodyAMatType, bodyBMatType;
+    // The user-specified extra margin size (how much we should be lenient in determining `in-contact')
+    float extraMarginSize = 0.;
+    // Then allocate the optional quantities that will be needed in the force model (note: this one can't be in a
+    // curly bracket, obviously...)
+    _forceModelIngredientDefinition_;
+    // Take care of 2 bodies in order, bodyA first, grab location and velocity to local cache
+    // We know in this kernel, bodyA will be a sphere; B can be something else
+    {
+        deme::bodyID_t sphereID = granData->idGeometryA[myContactID];
+        deme::bodyID_t myOwner = granData->ownerClumpBody[sphereID];
+
+        float3 myRelPos;
+        float myRadius;
+        // Get my component offset info from either jitified arrays or global memory
+        // Outputs myRelPos, myRadius
+        // Use an input named exactly `sphereID' which is the id of this sphere component
+        { _componentAcqStrat_; }
+
+        // Get my mass info from either jitified arrays or global memory
+        // Outputs myMass
+        // Use an input named exactly `myOwner' which is the id of this owner
+        {
+            float myMass;
+            _massAcqStrat_;
+            AOwnerMass = myMass;
+        }
+
+        // Optional force model ingredients are loaded here...
+        _forceModelIngredientAcqForA_;
+
+        equipOwnerPosRot(simParams, granData, myOwner, myRelPos, AOwnerPos, bodyAPos, AOriQ);
+
+        ARadius = myRadius;
+        bodyAMatType = granData->sphereMaterialOffset[sphereID];
+        extraMarginSize = granData->familyExtraMarginSize[AOwnerFamily];
+    }
+
+    // Then B, location and velocity
+    if (HANDLES_SPH_SPH && myContactType == deme::SPHERE_SPHERE_CONTACT) {
+        deme::bodyID_t sphereID = granData->idGeometryB[myContactID];
+        deme::bodyID_t myOwner = granData->ownerClumpBody[sphereID];
+
+        float3 myRelPos;
+        float myRadius;
+        // Get my component offset info from either jitified arrays or global memory
+        // Outputs myRelPos, myRadius
+        // Use an input named exactly `sphereID' which is the id of this sphere component
+        { _componentAcqStrat_; }
+
+        // Get my mass info from either jitified arrays or global memory
+        // Outputs myMass
+        // Use an input named exactly `myOwner' which is the id of this owner
+        {
+            float myMass;
+            _massAcqStrat_;
+            BOwnerMass = myMass;
+        }
+        _forceModelIngredientAcqForB_;
+        _forceModelGeoWildcardAcqForSph_;
+
+        equipOwnerPosRot(simParams, granData, myOwner, myRelPos, BOwnerPos, bodyBPos, BOriQ);
+        // In a periodic direction, B (both the sphere and its owner) is taken as its image nearest to A
+        if (_periodicX_) {
+            const double shift = -_periodLenX_ * rint((bodyBPos.x - bodyAPos.x) / _periodLenX_);
+            bodyBPos.x += shift;
+            BOwnerPos.x += shift;
+        }
+        if (_periodicY_) {
+            const double shift = -_periodLenY_ * rint((bodyBPos.y - bodyAPos.y) / _periodLenY_);
+            bodyBPos.y += shift;
+            BOwnerPos.y += shift;
+        }
+        if (_periodicZ_) {
+            const double shift = -_periodLenZ_ * rint((bodyBPos.z - bodyAPos.z) / _periodLenZ_);
+            bodyBPos.z += shift;
+            BOwnerPos.z += shift;
+        }
+
+        BRadius = myRadius;
+        bodyBMatType = granData->sphereMaterialOffset[sphereID];
+
+        // As the grace margin, the distance (negative overlap) just needs to be within the grace margin. So we pick
+        // the larger of the 2 familyExtraMarginSize.
+        extraMarginSize = (extraMarginSize > granData->familyExtraMarginSize[BOwnerFamily])
+                              ? extraMarginSize
+                              : granData->familyExtraMarginSize[BOwnerFamily];
+
+        checkSpheresOverlap<double, float>(bodyAPos.x, bodyAPos.y, bodyAPos.z, ARadius, bodyBPos.x, bodyBPos.y,
+                                           bodyBPos.z, BRadius, contactPnt.x, contactPnt.y, contactPnt.z, B2A.x,
+                                           B2A.y, B2A.z, overlapDepth);
+        // If overlapDepth is negative then it might still be considered in contact, if the extra margins of A and B
+        // combined is larger than abs(overlapDepth)
+        if (overlapDepth < -extraMarginSize) {
+            myContactType = deme::NOT_A_CONTACT;
+        }
+
+    } else if (HANDLES_SPH_MESH && myContactType == deme::SPHERE_MESH_CONTACT) {
+        // Geometry ID here is called sphereID, although it is not a sphere, it's more like triID. But naming it
+        // sphereID makes the acquisition process cleaner.
+        deme::bodyID_t sphereID = granData->idGeometryB[myContactID];
+        deme::bodyID_t myOwner = granData->ownerMesh[sphereID];
+        //// TODO: Is this OK?
+        BRadius = DEME_HUGE_FLOAT;
+        bodyBMatType = granData->triMaterialOffset[sphereID];
+
+        // As the grace margin, the distance (negative overlap) just needs to be within the grace margin. So we pick
+        // the larger of the 2 familyExtraMarginSize.
+        extraMarginSize = (extraMarginSize > granData->familyExtraMarginSize[BOwnerFamily])
+                              ? extraMarginSize
+                              : granData->familyExtraMarginSize[BOwnerFamily];
+
+        const deme::bodyID_t triNode = granData->triNodeOffset[sphereID];
+        double3 triNode1 = to_double3(granData->relPosNode1[triNode]);
+        double3 triNode2 = to_double3(granData->relPosNode2[triNode]);
+        double3 triNode3 = to_double3(granData->relPosNode3[triNode]);
+
+        // Get my mass info from either jitified arrays or global memory
+        // Outputs myMass
+        // Use an input named exactly `myOwner' which is the id of this owner
+        {
+            float myMass;
+            _massAcqStrat_;
+            BOwnerMass = myMass;
+        }
+        _forceModelIngredientAcqForB_;
+        _forceModelGeoWildcardAcqForTri_;
+
+        // bodyBPos is for a place holder for the outcome triNode1 position
+        equipOwnerPosRot(simParams, granData, myOwner, triNode1, BOwnerPos, bodyBPos, BOriQ);
+        triNode1 = bodyBPos;
+        // Do this to node 2 and 3 as well
+        applyOriQToVector3(triNode2.x, triNode2.y, triNode2.z, BOriQ.w, BOriQ.x, BOriQ.y, BOriQ.z);
+        triNode2 += BOwnerPos;
+        applyOriQToVector3(triNode3.x, triNode3.y, triNode3.z, BOriQ.w, BOriQ.x, BOriQ.y, BOriQ.z);
+        triNode3 += BOwnerPos;
+        // Assign the correct bodyBPos
+        bodyBPos = triangleCentroid<double3>(triNode1, triNode2, triNode3);
+
+        double3 contact_normal;
+        bool in_contact = triangle_sphere_CD<double3, double>(triNode1, triNode2, triNode3, bodyAPos, ARadius,
+                                                              contact_normal, overlapDepth, contactPnt);
+        B2A = to_float3(contact_normal);
+
+        // Sphere--triangle is a bit tricky. Extra margin should only take effect when it comes from the positive
+        // direction of the mesh facet. If not, sphere-setting-on-needle case will give huge penetration since in
+        // that case, overlapDepth is very negative and this will be considered in-contact. So the cases we exclude
+        // are: too far away while at the positive direction; not in contact while at the negative side.
+        if ((overlapDepth > extraMarginSize) || (!in_contact && overlapDepth < 0.)) {
+            myContactType = deme::NOT_A_CONTACT;
+        }
+        overlapDepth = -overlapDepth;  // triangle_sphere_CD gives neg. number for overlapping cases
+    } else if (HANDLES_SPH_ANAL && myContactType > deme::SPHERE_ANALYTICAL_CONTACT) {
+        // Geometry ID here is called sphereID, although it is not a sphere, it's more like analyticalID. But naming
+        // it sphereID makes the acquisition process cleaner.
+        deme::objID_t sphereID = granData->idGeometryB[myContactID];
+        deme::bodyID_t myOwner = objOwner[sphereID];
+        // If B is analytical entity, its owner, relative location, material info is jitified.
+        bodyBMatType = objMaterial[sphereID];
+        BOwnerMass = objMass[sphereID];
+        //// TODO: Is this OK?
+        BRadius = DEME_HUGE_FLOAT;
+        float3 myRelPos;
+        float3 bodyBRot;
+        myRelPos.x = objRelPosX[sphereID];
+        myRelPos.y = objRelPosY[sphereID];
+        myRelPos.z = objRelPosZ[sphereID];
+        _forceModelIngredientAcqForB_;
+        _forceModelGeoWildcardAcqForAnal_;
+
+        equipOwnerPosRot(simParams, granData, myOwner, myRelPos, BOwnerPos, bodyBPos, BOriQ);
+
+        // As the grace margin, the distance (negative overlap) just needs to be within the grace margin. So we pick
+        // the larger of the 2 familyExtraMarginSize.
+        extraMarginSize = (extraMarginSize > granData->familyExtraMarginSize[BOwnerFamily])
+                              ? extraMarginSize
+                              : granData->familyExtraMarginSize[BOwnerFamily];
+
+        // B's orientation (such as plane normal) is rotated with its owner too
+        bodyBRot.x = objRotX[sphereID];
+        bodyBRot.y = objRotY[sphereID];
+        bodyBRot.z = objRotZ[sphereID];
+        applyOriQToVector3<float, deme::oriQ_t>(bodyBRot.x, bodyBRot.y, bodyBRot.z, BOriQ.w, BOriQ.x, BOriQ.y,
+                                                BOriQ.z);
+
+        // Note for this test on dT side we don't enlarge entities
+        checkSphereEntityOverlap<double3, float, double>(bodyAPos, ARadius, objType[sphereID], bodyBPos, bodyBRot,
+                                                         objSize1[sphereID], objSize2[sphereID], objSize3[sphereID],
+                                                         objNormal[sphereID], 0.0, contactPnt, B2A, overlapDepth);
+        // Fix myContactType if needed
+        if (overlapDepth < -extraMarginSize) {
+            myContactType = deme::NOT_A_CONTACT;
+        }
+    } else {
+        // It is NOT_A_CONTACT, or a type this instance does not handle
+        myContactType = deme::NOT_A_CONTACT;
+    }
+
+    _forceModelContactWildcardAcq_;
+    if (myContactType != deme::NOT_A_CONTACT) {
+        float3 force = make_float3(0, 0, 0);
+        float3 torque_only_force = make_float3(0, 0, 0);
+        // Local position of the contact point is always a piece of info we require... regardless of force model
+        float3 locCPA = to_float3(contactPnt - AOwnerPos);
+        float3 locCPB = to_float3(contactPnt - BOwnerPos);
+        // Now map this contact point location to bodies' local ref
+        applyOriQToVector3<float, deme::oriQ_t>(locCPA.x, locCPA.y, locCPA.z, AOriQ.w, -AOriQ.x, -AOriQ.y,
+                                                -AOriQ.z);
+        applyOriQToVector3<float, deme::oriQ_t>(locCPB.x, locCPB.y, locCPB.z, BOriQ.w, -BOriQ.x, -BOriQ.y,
+                                                -BOriQ.z);
+        // The following part, the force model, is user-specifiable
+        // NOTE!! "force" and all wildcards must be properly set by this piece of code
+        { _DEMForceModel_; }
+
+        // Write contact location values back to global memory
+        _contactInfoWrite_;
+
+        // If force model modifies owner wildcards, write them back here
+        _forceModelOwnerWildcardWrite_;
+
+        // Optionally, the forces can be reduced to acc right here (may be faster)
+        _forceCollectInPlaceStrat_;
+    } else {
+        // The contact is no longer active, so we need to destroy its contact history recording
+        _forceModelContactWildcardDestroy_;
+    }
+
+    // Updated contact wildcards need to be write back to global mem. It is here because contact wildcard may need
+    // to be destroyed for non-contact, so it has to go last.
+    _forceModelContactWildcardWrite_;
+}
+
 __global__ void calculateContactForces(deme::DEMSimParams* simParams, deme::DEMDataDT* granData, size_t nContactPairs) {
     deme::contactPairs_t myContactID = blockIdx.x * blockDim.x + threadIdx.x;
     if (myContactID < nContactPairs) {
-        // Identify contact type first
-        deme::contact_t myContactType = granData->contactType[myContactID];
-        // The following quantities are always calculated, regardless of force model
-        double3 contactPnt;
-        float3 B2A;  // Unit vector pointing from body B to body A (contact normal)
-        double overlapDepth;
-        double3 AOwnerPos, bodyAPos, BOwnerPos, bodyBPos;
-        float AOwnerMass, ARadius, BOwnerMass, BRadius;
-        float4 AOriQ, BOriQ;
-        deme::materialsOffset_t bodyAMatType, bodyBMatType;
-        // The user-specified extra margin size (how much we should be lenient in determining `in-contact')
-        float extraMarginSize = 0.;
-        // Then allocate the optional quantities that will be needed in the force model (note: this one can't be in a
-        // curly bracket, obviously...)
-        _forceModelIngredientDefinition_;
-        // Take care of 2 bodies in order, bodyA first, grab location and velocity to local cache
-        // We know in this kernel, bodyA will be a sphere; B can be something else
-        {
-            deme::bodyID_t sphereID = granData->idGeometryA[myContactID];
-            deme::bodyID_t myOwner = granData->ownerClumpBody[sphereID];
-
-            float3 myRelPos;
-            float myRadius;
-            // Get my component offset info from either jitified arrays or global memory
-            // Outputs myRelPos, myRadius
-            // Use an input named exactly `sphereID' which is the id of this sphere component
-            { _componentAcqStrat_; }
-
-            // Get my mass info from either jitified arrays or global memory
-            // Outputs myMass
-            // Use an input named exactly `myOwner' which is the id of this owner
-            {
-                float myMass;
-                _massAcqStrat_;
-                AOwnerMass = myMass;
-            }
+        calculateContactForce<true, true, true, -1>(simParams, granData, myContactID);
+    }
+}
 
-            // Optional force model ingredients are loaded here...
-            _forceModelIngredientAcqForA_;
+// Type-segmented versions. The contact array is sorted by type, and each of these handles the contacts of one type,
+// which are those in [startID, endID).
+__global__ void calculateNonContactForces(deme::DEMSimParams* simParams,
+                                          deme::DEMDataDT* granData,
+                                          size_t startID,
+                                          size_t endID) {
+    deme::contactPairs_t myContactID = startID + blockIdx.x * blockDim.x + threadIdx.x;
+    if (myContactID < endID) {
+        // Nothing but destroying the contact history records
+        calculateContactForce<false, false, false, -1>(simParams, granData, myContactID);
+    }
+}
 
-            equipOwnerPosRot(simParams, granData, myOwner, myRelPos, AOwnerPos, bodyAPos, AOriQ);
+__global__ void calculateSphSphContactForces(deme::DEMSimParams* simParams,
+                                             deme::DEMDataDT* granData,
+                                             size_t startID,
+                                             size_t endID) {
+    deme::contactPairs_t myContactID = startID + blockIdx.x * blockDim.x + threadIdx.x;
+    if (myContactID < endID) {
+        calculateContactForce<true, false, false, -1>(simParams, granData, myContactID);
+    }
+}
 
-            ARadius = myRadius;
-            bodyAMatType = granData->sphereMaterialOffset[sphereID];
-            extraMarginSize = granData->familyExtraMarginSize[AOwnerFamily];
-        }
+__global__ void calculateSphMeshContactForces(deme::DEMSimParams* simParams,
+                                              deme::DEMDataDT* granData,
+                                              size_t startID,
+                                              size_t endID) {
+    deme::contactPairs_t myContactID = startID + blockIdx.x * blockDim.x + threadIdx.x;
+    if (myContactID < endID) {
+        calculateContactForce<false, true, false, -1>(simParams, granData, myContactID);
+    }
+}
 
-        // Then B, location and velocity
-        if (myContactType == deme::SPHERE_SPHERE_CONTACT) {
-            deme::bodyID_t sphereID = granData->idGeometryB[myContactID];
-            deme::bodyID_t myOwner = granData->ownerClumpBody[sphereID];
-
-            float3 myRelPos;
-            float myRadius;
-            // Get my component offset info from either jitified arrays or global memory
-            // Outputs myRelPos, myRadius
-            // Use an input named exactly `sphereID' which is the id of this sphere component
-            { _componentAcqStrat_; }
-
-            // Get my mass info from either jitified arrays or global memory
-            // Outputs myMass
-            // Use an input named exactly `myOwner' which is the id of this owner
-            {
-                float myMass;
-                _massAcqStrat_;
-                BOwnerMass = myMass;
-            }
-            _forceModelIngredientAcqForB_;
-            _forceModelGeoWildcardAcqForSph_;
-
-            equipOwnerPosRot(simParams, granData, myOwner, myRelPos, BOwnerPos, bodyBPos, BOriQ);
-
-            BRadius = myRadius;
-            bodyBMatType = granData->sphereMaterialOffset[sphereID];
-
-            // As the grace margin, the distance (negative overlap) just needs to be within the grace margin. So we pick
-            // the larger of the 2 familyExtraMarginSize.
-            extraMarginSize = (extraMarginSize > granData->familyExtraMarginSize[BOwnerFamily])
-                                  ? extraMarginSize
-                                  : granData->familyExtraMarginSize[BOwnerFamily];
-
-            checkSpheresOverlap<double, float>(bodyAPos.x, bodyAPos.y, bodyAPos.z, ARadius, bodyBPos.x, bodyBPos.y,
-                                               bodyBPos.z, BRadius, contactPnt.x, contactPnt.y, contactPnt.z, B2A.x,
-                                               B2A.y, B2A.z, overlapDepth);
-            // If overlapDepth is negative then it might still be considered in contact, if the extra margins of A and B
-            // combined is larger than abs(overlapDepth)
-            if (overlapDepth < -extraMarginSize) {
-                myContactType = deme::NOT_A_CONTACT;
-            }
+__global__ void calculateSphAnalContactForces(deme::DEMSimParams* simParams,
+                                              deme::DEMDataDT* granData,
+                                              size_t startID,
+                                              size_t endID) {
+    deme::contactPairs_t myContactID = startID + blockIdx.x * blockDim.x + threadIdx.x;
+    if (myContactID < endID) {
+        calculateContactForce<false, false, true, -1>(simParams, granData, myContactID);
+    }
+}
 
-        } else if (myContactType == deme::SPHERE_MESH_CONTACT) {
-            // Geometry ID here is called sphereID, although it is not a sphere, it's more like triID. But naming it
-            // sphereID makes the acquisition process cleaner.
-            deme::bodyID_t sphereID = granData->idGeometryB[myContactID];
-            deme::bodyID_t myOwner = granData->ownerMesh[sphereID];
-            //// TODO: Is this OK?
-            BRadius = DEME_HUGE_FLOAT;
-            bodyBMatType = granData->triMaterialOffset[sphereID];
-
-            // As the grace margin, the distance (negative overlap) just needs to be within the grace margin. So we pick
-            // the larger of the 2 familyExtraMarginSize.
-            extraMarginSize = (extraMarginSize > granData->familyExtraMarginSize[BOwnerFamily])
-                                  ? extraMarginSize
-                                  : granData->familyExtraMarginSize[BOwnerFamily];
-
-            double3 triNode1 = to_double3(granData->relPosNode1[sphereID]);
-            double3 triNode2 = to_double3(granData->relPosNode2[sphereID]);
-            double3 triNode3 = to_double3(granData->relPosNode3[sphereID]);
-
-            // Get my mass info from either jitified arrays or global memory
-            // Outputs myMass
-            // Use an input named exactly `myOwner' which is the id of this owner
-            {
-                float myMass;
-                _massAcqStrat_;
-                BOwnerMass = myMass;
-            }
-            _forceModelIngredientAcqForB_;
-            _forceModelGeoWildcardAcqForTri_;
-
-            // bodyBPos is for a place holder for the outcome triNode1 position
-            equipOwnerPosRot(simParams, granData, myOwner, triNode1, BOwnerPos, bodyBPos, BOriQ);
-            triNode1 = bodyBPos;
-            // Do this to node 2 and 3 as well
-            applyOriQToVector3(triNode2.x, triNode2.y, triNode2.z, BOriQ.w, BOriQ.x, BOriQ.y, BOriQ.z);
-            triNode2 += BOwnerPos;
-            applyOriQToVector3(triNode3.x, triNode3.y, triNode3.z, BOriQ.w, BOriQ.x, BOriQ.y, BOriQ.z);
-            triNode3 += BOwnerPos;
-            // Assign the correct bodyBPos
-            bodyBPos = triangleCentroid<double3>(triNode1, triNode2, triNode3);
-
-            double3 contact_normal;
-            bool in_contact = triangle_sphere_CD<double3, double>(triNode1, triNode2, triNode3, bodyAPos, ARadius,
-                                                                  contact_normal, overlapDepth, contactPnt);
-            B2A = to_float3(contact_normal);
-
-            // Sphere--triangle is a bit tricky. Extra margin should only take effect when it comes from the positive
-            // direction of the mesh facet. If not, sphere-setting-on-needle case will give huge penetration since in
-            // that case, overlapDepth is very negative and this will be considered in-contact. So the cases we exclude
-            // are: too far away while at the positive direction; not in contact while at the negative side.
-            if ((overlapDepth > extraMarginSize) || (!in_contact && overlapDepth < 0.)) {
-                myContactType = deme::NOT_A_CONTACT;
-            }
-            overlapDepth = -overlapDepth;  // triangle_sphere_CD gives neg. number for overlapping cases
-        } else if (myContactType > deme::SPHERE_ANALYTICAL_CONTACT) {
-            // Geometry ID here is called sphereID, although it is not a sphere, it's more like analyticalID. But naming
-            // it sphereID makes the acquisition process cleaner.
-            deme::objID_t sphereID = granData->idGeometryB[myContactID];
-            deme::bodyID_t myOwner = objOwner[sphereID];
-            // If B is analytical entity, its owner, relative location, material info is jitified.
-            bodyBMatType = objMaterial[sphereID];
-            BOwnerMass = objMass[sphereID];
-            //// TODO: Is this OK?
-            BRadius = DEME_HUGE_FLOAT;
-            float3 myRelPos;
-            float3 bodyBRot;
-            myRelPos.x = objRelPosX[sphereID];
-            myRelPos.y = objRelPosY[sphereID];
-            myRelPos.z = objRelPosZ[sphereID];
-            _forceModelIngredientAcqForB_;
-            _forceModelGeoWildcardAcqForAnal_;
-
-            equipOwnerPosRot(simParams, granData, myOwner, myRelPos, BOwnerPos, bodyBPos, BOriQ);
-
-            // As the grace margin, the distance (negative overlap) just needs to be within the grace margin. So we pick
-            // the larger of the 2 familyExtraMarginSize.
-            extraMarginSize = (extraMarginSize > granData->familyExtraMarginSize[BOwnerFamily])
-                                  ? extraMarginSize
-                                  : granData->familyExtraMarginSize[BOwnerFamily];
-
-            // B's orientation (such as plane normal) is rotated with its owner too
-            bodyBRot.x = objRotX[sphereID];
-            bodyBRot.y = objRotY[sphereID];
-            bodyBRot.z = objRotZ[sphereID];
-            applyOriQToVector3<float, deme::oriQ_t>(bodyBRot.x, bodyBRot.y, bodyBRot.z, BOriQ.w, BOriQ.x, BOriQ.y,
-                                                    BOriQ.z);
-
-            // Note for this test on dT side we don't enlarge entities
-            checkSphereEntityOverlap<double3, float, double>(bodyAPos, ARadius, objType[sphereID], bodyBPos, bodyBRot,
-                                                             objSize1[sphereID], objSize2[sphereID], objSize3[sphereID],
-                                                             objNormal[sphereID], 0.0, contactPnt, B2A, overlapDepth);
-            // Fix myContactType if needed
-            if (overlapDepth < -extraMarginSize) {
-                myContactType = deme::NOT_A_CONTACT;
+// Write the force model of each contact, and the contact's index, so contacts can be sorted into groups by model
+__global__ void markContactForceModels(deme::DEMDataDT* granData,
+                                       unsigned int* modelIDs,
+                                       deme::contactPairs_t* contactIDs,
+                                       size_t nContactPairs) {
+    deme::contactPairs_t myContactID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myContactID < nContactPairs) {
+        const deme::contact_t myContactType = granData->contactType[myContactID];
+        unsigned int modelID = 0;
+        // Non-contacts only need their history destroyed, which any model's kernel does
+        if (myContactType != deme::NOT_A_CONTACT) {
+            const deme::bodyID_t idA = granData->idGeometryA[myContactID];
+            const deme::bodyID_t idB = granData->idGeometryB[myContactID];
+            const deme::family_t AOwnerFamily = granData->familyID[granData->ownerClumpBody[idA]];
+            const deme::materialsOffset_t bodyAMatType = granData->sphereMaterialOffset[idA];
+            deme::family_t BOwnerFamily;
+            deme::materialsOffset_t bodyBMatType;
+            if (myContactType == deme::SPHERE_SPHERE_CONTACT) {
+                BOwnerFamily = granData->familyID[granData->ownerClumpBody[idB]];
+                bodyBMatType = granData->sphereMaterialOffset[idB];
+            } else if (myContactType == deme::SPHERE_MESH_CONTACT) {
+                BOwnerFamily = granData->familyID[granData->ownerMesh[idB]];
+                bodyBMatType = granData->triMaterialOffset[idB];
+            } else {
+                BOwnerFamily = granData->familyID[objOwner[idB]];
+                bodyBMatType = objMaterial[idB];
             }
-        }  // else it must be NOT_A_CONTACT
+            modelID = forceModelOfContact(AOwnerFamily, BOwnerFamily, bodyAMatType, bodyBMatType);
+        }
+        modelIDs[myContactID] = modelID;
+        contactIDs[myContactID] = myContactID;
+    }
+}
 
-        _forceModelContactWildcardAcq_;
-        if (myContactType != deme::NOT_A_CONTACT) {
-            float3 force = make_float3(0, 0, 0);
-            float3 torque_only_force = make_float3(0, 0, 0);
-            // Local position of the contact point is always a piece of info we require... regardless of force model
-            float3 locCPA = to_float3(contactPnt - AOwnerPos);
-            float3 locCPB = to_float3(contactPnt - BOwnerPos);
-            // Now map this contact point location to bodies' local ref
-            applyOriQToVector3<float, deme::oriQ_t>(locCPA.x, locCPA.y, locCPA.z, AOriQ.w, -AOriQ.x, -AOriQ.y,
-                                                    -AOriQ.z);
-            applyOriQToVector3<float, deme::oriQ_t>(locCPB.x, locCPB.y, locCPB.z, BOriQ.w, -BOriQ.x, -BOriQ.y,
-                                                    -BOriQ.z);
-            // The following part, the force model, is user-specifiable
-            // NOTE!! "force" and all wildcards must be properly set by this piece of code
-            { _DEMForceModel_; }
-
-            // Write contact location values back to global memory
-            _contactInfoWrite_;
-
-            // If force model modifies owner wildcards, write them back here
-            _forceModelOwnerWildcardWrite_;
-
-            // Optionally, the forces can be reduced to acc right here (may be faster)
-            _forceCollectInPlaceStrat_;
+// Find where each force model's group starts in the model-sorted contact list. Thread k finds the first contact whose
+// model is no smaller than k; the last entry is the total number of contacts.
+__global__ void findForceModelOffsets(unsigned int* modelIDs,
+                                      deme::contactPairs_t* offsets,
+                                      unsigned int nModels,
+                                      size_t nContactPairs) {
+    unsigned int myModel = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myModel > nModels) {
+        return;
+    }
+    if (myModel == nModels) {
+        offsets[myModel] = nContactPairs;
+        return;
+    }
+    size_t left = 0, right = nContactPairs;
+    while (left < right) {
+        size_t mid = left + (right - left) / 2;
+        if (modelIDs[mid] < myModel) {
+            left = mid + 1;
         } else {
-            // The contact is no longer active, so we need to destroy its contact history recording
-            _forceModelContactWildcardDestroy_;
+            right = mid;
         }
-
-        // Updated contact wildcards need to be write back to global mem. It is here because contact wildcard may need
-        // to be destroyed for non-contact, so it has to go last.
-        _forceModelContactWildcardWrite_;
     }
+    offsets[myModel] = left;
 }
+
+// If there are several force models, the kernels that each run one of them are below
+_forceModelKernels_;
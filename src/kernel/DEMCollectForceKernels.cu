@@ -90,10 +90,10 @@ __global__ void forceToAcc(float3* acc,
 // computes cross(a, b) ./ c
 __global__ void forceToAngAcc(float3* angAcc,
                               float3* cntPnt,
-                              deme::oriQ_t* oriQw,
-                              deme::oriQ_t* oriQx,
-                              deme::oriQ_t* oriQy,
-                              deme::oriQ_t* oriQz,
+                              deme::oriQStore_t* oriQw,
+                              deme::oriQStore_t* oriQx,
+                              deme::oriQStore_t* oriQy,
+                              deme::oriQStore_t* oriQz,
                               float3* F,
                               float3* torque_inForceForm,
                               deme::bodyID_t* owner,
@@ -135,3 +135,60 @@ __global__ void stashElem(float* out1, float* out2, float* out3, deme::bodyID_t*
         out3[my_index] += my_value.z;
     }
 }
+
+__global__ void fillEntryIndices(deme::contactPairs_t* idx, size_t n) {
+    deme::contactPairs_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        idx[myID] = myID;
+    }
+}
+
+// Each thread reduces the contact forces acting on one owner, over the owner's segment of a CSR built when the contact
+// array is fresh from kT. Entry e < nContactPairs stands for geometry A of contact e, and entry e >= nContactPairs for
+// geometry B of contact e - nContactPairs. Owners in the CSR are unique, so no atomic operations are needed.
+__global__ void collectOwnerForcesCSR(deme::DEMDataDT* granData,
+                                      deme::bodyID_t* csrOwner,
+                                      deme::contactPairs_t* csrOffsets,
+                                      deme::contactPairs_t* csrEntries,
+                                      size_t nContactPairs,
+                                      size_t nOwnerSegments) {
+    size_t mySegment = blockIdx.x * blockDim.x + threadIdx.x;
+    if (mySegment < nOwnerSegments) {
+        const deme::bodyID_t myOwner = csrOwner[mySegment];
+        const deme::oriQ_t myOriQw = granData->oriQw[myOwner];
+        const deme::oriQ_t myOriQx = granData->oriQx[myOwner];
+        const deme::oriQ_t myOriQy = granData->oriQy[myOwner];
+        const deme::oriQ_t myOriQz = granData->oriQz[myOwner];
+        float3 sumF = make_float3(0, 0, 0);
+        // Torque in the owner's local frame
+        float3 sumT = make_float3(0, 0, 0);
+        for (deme::contactPairs_t i = csrOffsets[mySegment]; i < csrOffsets[mySegment + 1]; i++) {
+            deme::contactPairs_t myEntry = csrEntries[i];
+            const bool isA = (myEntry < nContactPairs);
+            deme::contactPairs_t myContact = isA ? myEntry : myEntry - nContactPairs;
+            const float modifier = isA ? 1.f : -1.f;
+            float3 myCntPnt =
+                isA ? granData->contactPointGeometryA[myContact] : granData->contactPointGeometryB[myContact];
+            float3 F = granData->contactForces[myContact] * modifier;
+            sumF += F;
+            // torque_inForceForm is usually the contribution of rolling resistance and it contributes to torque only
+            float3 myF = F + granData->contactTorque_convToForce[myContact] * modifier;
+            applyOriQToVector3<float, deme::oriQ_t>(myF.x, myF.y, myF.z, myOriQw, -myOriQx, -myOriQy, -myOriQz);
+            sumT += cross(myCntPnt, myF);
+        }
+        float myMass;
+        float3 myMOI;
+        // Get my mass info from either jitified arrays or global memory
+        // Outputs myMass and myMOI
+        // Use an input named exactly `myOwner' which is the id of this owner
+        { _massAcqStrat_; }
+        { _moiAcqStrat_; }
+        granData->aX[myOwner] += sumF.x / myMass;
+        granData->aY[myOwner] += sumF.y / myMass;
+        granData->aZ[myOwner] += sumF.z / myMass;
+        float3 myAlpha = sumT / myMOI;
+        granData->alphaX[myOwner] += myAlpha.x;
+        granData->alphaY[myOwner] += myAlpha.y;
+        granData->alphaZ[myOwner] += myAlpha.z;
+    }
+}
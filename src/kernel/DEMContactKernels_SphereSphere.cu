@@ -12,6 +12,10 @@ _kernelIncludes_
 // If clump templates are jitified, they will be below
 _clumpTemplateDefs_;
 
+// Type of the sphere positions staged in shared memory for the bin-wise sweeps. It is double (global positions) by
+// default, or float (offsets from the lower corner of the bin) if bin-local CD coordinates are in use.
+typedef _cdPositionType_ cdPos_t;
+
 template <typename T1, typename T2>
 inline __device__ void fillSharedMemSpheres(deme::DEMSimParams* simParams,
                                             deme::DEMDataKT* granData,
@@ -23,7 +27,8 @@ inline __device__ void fillSharedMemSpheres(deme::DEMSimParams* simParams,
                                             T1* radii,
                                             T2* bodyX,
                                             T2* bodyY,
-                                            T2* bodyZ) {
+                                            T2* bodyZ,
+                                            const double3& binOrigin = make_double3(0., 0., 0.)) {
     deme::bodyID_t ownerID = granData->ownerClumpBody[sphereID];
     bodyIDs[myThreadID] = sphereID;
     ownerIDs[myThreadID] = ownerID;
@@ -48,12 +53,24 @@ inline __device__ void fillSharedMemSpheres(deme::DEMSimParams* simParams,
     float myOriQy = granData->oriQy[ownerID];
     float myOriQz = granData->oriQz[ownerID];
     applyOriQToVector3<float, deme::oriQ_t>(myRelPos.x, myRelPos.y, myRelPos.z, myOriQw, myOriQx, myOriQy, myOriQz);
-    bodyX[myThreadID] = ownerX + (double)myRelPos.x;
-    bodyY[myThreadID] = ownerY + (double)myRelPos.y;
-    bodyZ[myThreadID] = ownerZ + (double)myRelPos.z;
+    bodyX[myThreadID] = (T2)(ownerX + (double)myRelPos.x - binOrigin.x);
+    bodyY[myThreadID] = (T2)(ownerY + (double)myRelPos.y - binOrigin.y);
+    bodyZ[myThreadID] = (T2)(ownerZ + (double)myRelPos.z - binOrigin.z);
     radii[myThreadID] = myRadius;
 }
 
+// What the staged positions are relative to: the lower corner of the bin if they are float offsets, or the origin of
+// the simulation world if they are global double positions
+inline __device__ double3 getStagingOrigin(deme::DEMSimParams* simParams, const deme::binID_t& binID) {
+    if (sizeof(cdPos_t) == sizeof(double)) {
+        return make_double3(0., 0., 0.);
+    }
+    const deme::binID_t nbXY = simParams->nbX * simParams->nbY;
+    return make_double3((double)(binID % simParams->nbX) * simParams->binSize,
+                        (double)((binID % nbXY) / simParams->nbX) * simParams->binSize,
+                        (double)(binID / nbXY) * simParams->binSize);
+}
+
 inline __device__ bool calcContactPoint(deme::DEMSimParams* simParams,
                                         const double& XA,
                                         const double& YA,
@@ -75,19 +92,93 @@ inline __device__ bool calcContactPoint(deme::DEMSimParams* simParams,
     float normZ;
     double overlapDepth;  // overlapDepth is needed for making artificial contacts not too loose.
 
+    // In a periodic direction, B is taken as its image nearest to A
+    const double imgXB = _periodicX_ ? XA + periodicMinImage<double>(XB - XA, _periodLenX_) : XB;
+    const double imgYB = _periodicY_ ? YA + periodicMinImage<double>(YB - YA, _periodLenY_) : YB;
+    const double imgZB = _periodicZ_ ? ZA + periodicMinImage<double>(ZB - ZA, _periodLenZ_) : ZB;
+
     //// TODO: I guess <float, float> is fine too.
-    in_contact = checkSpheresOverlap<double, float>(XA, YA, ZA, rA, XB, YB, ZB, rB, contactPntX, contactPntY,
+    in_contact = checkSpheresOverlap<double, float>(XA, YA, ZA, rA, imgXB, imgYB, imgZB, rB, contactPntX, contactPntY,
                                                     contactPntZ, normX, normY, normZ, overlapDepth);
 
     // The contact needs to be larger than the smaller articifical margin so that we don't double count the artificially
     // added margin. This is a design choice, to avoid having too many contact pairs when adding artificial margins.
     float artificialMargin = (artificialMarginA < artificialMarginB) ? artificialMarginA : artificialMarginB;
     in_contact = in_contact && (overlapDepth > (double)artificialMargin);
-    binID = getPointBinID<deme::binID_t>(contactPntX, contactPntY, contactPntZ, simParams->binSize, simParams->nbX,
-                                         simParams->nbY);
+    // The contact point is then wrapped back into the domain, so the pair is still assigned to only one bin
+    if (_periodicX_) {
+        contactPntX = periodicWrap<double>(contactPntX, _periodLenX_);
+    }
+    if (_periodicY_) {
+        contactPntY = periodicWrap<double>(contactPntY, _periodLenY_);
+    }
+    if (_periodicZ_) {
+        contactPntZ = periodicWrap<double>(contactPntZ, _periodLenZ_);
+    }
+    // In 2D, there is only one layer of bins in Y
+    binID = getPointBinID<deme::binID_t>(contactPntX, _twoDimensional_ ? 0.0 : contactPntY, contactPntZ,
+                                         simParams->binSize, simParams->nbX, simParams->nbY);
     return in_contact;
 }
 
+// Contact check for 2 spheres staged as global double positions in the bin-wise sweeps
+inline __device__ bool calcContactPoint(deme::DEMSimParams* simParams,
+                                        deme::DEMDataKT* granData,
+                                        const double& XA,
+                                        const double& YA,
+                                        const double& ZA,
+                                        const float& rA,
+                                        const deme::bodyID_t& sphereA,
+                                        const double& XB,
+                                        const double& YB,
+                                        const double& ZB,
+                                        const float& rB,
+                                        const deme::bodyID_t& sphereB,
+                                        deme::binID_t& binID,
+                                        float artificialMarginA,
+                                        float artificialMarginB) {
+    return calcContactPoint(simParams, XA, YA, ZA, rA, XB, YB, ZB, rB, binID, artificialMarginA, artificialMarginB);
+}
+
+// Contact check for 2 spheres staged as float offsets from the bin corner. A single-precision distance test rules out
+// most pairs. The rest are checked with the spheres' global double positions, so the contacts found, and the bins they
+// are assigned to, are the same as those found with double staging.
+inline __device__ bool calcContactPoint(deme::DEMSimParams* simParams,
+                                        deme::DEMDataKT* granData,
+                                        const float& XA,
+                                        const float& YA,
+                                        const float& ZA,
+                                        const float& rA,
+                                        const deme::bodyID_t& sphereA,
+                                        const float& XB,
+                                        const float& YB,
+                                        const float& ZB,
+                                        const float& rB,
+                                        const deme::bodyID_t& sphereB,
+                                        deme::binID_t& binID,
+                                        float artificialMarginA,
+                                        float artificialMarginB) {
+    // The offsets of a sphere registered in a bin through a periodic boundary are about a period off
+    const float dX = _periodicX_ ? periodicMinImage<float>(XA - XB, _periodLenX_) : XA - XB;
+    const float dY = _periodicY_ ? periodicMinImage<float>(YA - YB, _periodLenY_) : YA - YB;
+    const float dZ = _periodicZ_ ? periodicMinImage<float>(ZA - ZB, _periodLenZ_) : ZA - ZB;
+    // The offsets are no larger than a bin plus a radius, so this tolerance well covers their round-off
+    const float reach = (rA + rB) + ((float)simParams->binSize + rA + rB) * DEME_CD_BIN_LOCAL_TOLERANCE;
+    if (dX * dX + dY * dY + dZ * dZ > reach * reach) {
+        return false;
+    }
+    deme::bodyID_t ownerID, bodyID;
+    deme::family_t ownerFamily;
+    float radius;
+    double globalXA, globalYA, globalZA, globalXB, globalYB, globalZB;
+    fillSharedMemSpheres<float, double>(simParams, granData, 0, sphereA, &ownerID, &bodyID, &ownerFamily, &radius,
+                                        &globalXA, &globalYA, &globalZA);
+    fillSharedMemSpheres<float, double>(simParams, granData, 0, sphereB, &ownerID, &bodyID, &ownerFamily, &radius,
+                                        &globalXB, &globalYB, &globalZB);
+    return calcContactPoint(simParams, globalXA, globalYA, globalZA, rA, globalXB, globalYB, globalZB, rB, binID,
+                            artificialMarginA, artificialMarginB);
+}
+
 __global__ void getNumberOfSphereContactsEachBin(deme::DEMSimParams* simParams,
                                                  deme::DEMDataKT* granData,
                                                  deme::bodyID_t* sphereIDsEachBinTouches_sorted,
@@ -98,11 +189,11 @@ __global__ void getNumberOfSphereContactsEachBin(deme::DEMSimParams* simParams,
                                                  size_t nActiveBins) {
     // shared storage for bodies involved in this bin. Pre-allocated so that each threads can easily use.
     __shared__ deme::bodyID_t ownerIDs[DEME_NUM_SPHERES_PER_CD_BATCH];
-    __shared__ deme::bodyID_t bodyIDs[DEME_NUM_SPHERES_PER_CD_BATCH];  // In this kernel, this is not used
+    __shared__ deme::bodyID_t bodyIDs[DEME_NUM_SPHERES_PER_CD_BATCH];  // In this kernel, only used in bin-local mode
     __shared__ float radii[DEME_NUM_SPHERES_PER_CD_BATCH];
-    __shared__ double bodyX[DEME_NUM_SPHERES_PER_CD_BATCH];
-    __shared__ double bodyY[DEME_NUM_SPHERES_PER_CD_BATCH];
-    __shared__ double bodyZ[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyX[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyY[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyZ[DEME_NUM_SPHERES_PER_CD_BATCH];
     __shared__ deme::family_t ownerFamilies[DEME_NUM_SPHERES_PER_CD_BATCH];
     __shared__ deme::binContactPairs_t blockPairCnt;
 
@@ -111,6 +202,7 @@ __global__ void getNumberOfSphereContactsEachBin(deme::DEMSimParams* simParams,
 
     const deme::spheresBinTouches_t nBodiesInBin = numSpheresBinTouches[blockIdx.x];
     const deme::binID_t binID = activeBinIDs[blockIdx.x];
+    const double3 binOrigin = getStagingOrigin(simParams, binID);
     if (nBodiesInBin <= 1 || binID == deme::NULL_BINID) {
         // Important: mark 0 contacts before exiting
         if (threadIdx.x == 0) {
@@ -118,11 +210,13 @@ __global__ void getNumberOfSphereContactsEachBin(deme::DEMSimParams* simParams,
         }
         return;
     }
-    if (threadIdx.x == 0 && nBodiesInBin > simParams->errOutBinSphNum) {
-        DEME_ABORT_KERNEL(
-            "Bin %u contains %u sphere components, exceeding maximum allowance (%u).\nIf you want the solver to run "
-            "despite this, set allowance higher via SetMaxSphereInBin before simulation starts.",
-            blockIdx.x, nBodiesInBin, simParams->errOutBinSphNum);
+    // Bins that are too dense for one block are counted by getNumberOfSphereContactsDenseBins, which adds to the 0 we
+    // mark here
+    if (nBodiesInBin > DEME_MAX_SPHERES_PER_BIN_SINGLE_BLOCK) {
+        if (threadIdx.x == 0) {
+            numContactsInEachBin[blockIdx.x] = 0;
+        }
+        return;
     }
     const deme::spheresBinTouches_t myThreadID = threadIdx.x;
     const deme::binSphereTouchPairs_t thisBodiesTableEntry = sphereIDsLookUpTable[blockIdx.x];
@@ -145,8 +239,8 @@ __global__ void getNumberOfSphereContactsEachBin(deme::DEMSimParams* simParams,
         if (myThreadID < this_batch_active_count) {
             deme::bodyID_t sphereID =
                 sphereIDsEachBinTouches_sorted[thisBodiesTableEntry + processed_count + myThreadID];
-            fillSharedMemSpheres<float, double>(simParams, granData, myThreadID, sphereID, ownerIDs, bodyIDs,
-                                                ownerFamilies, radii, bodyX, bodyY, bodyZ);
+            fillSharedMemSpheres<float, cdPos_t>(simParams, granData, myThreadID, sphereID, ownerIDs, bodyIDs,
+                                                 ownerFamilies, radii, bodyX, bodyY, bodyZ, binOrigin);
         }
         __syncthreads();
 
@@ -182,10 +276,10 @@ __global__ void getNumberOfSphereContactsEachBin(deme::DEMSimParams* simParams,
                 }
 
                 deme::binID_t contactPntBin;
-                bool in_contact = calcContactPoint(simParams, bodyX[bodyA], bodyY[bodyA], bodyZ[bodyA], radii[bodyA],
-                                                   bodyX[bodyB], bodyY[bodyB], bodyZ[bodyB], radii[bodyB],
-                                                   contactPntBin, granData->familyExtraMarginSize[bodyAFamily],
-                                                   granData->familyExtraMarginSize[bodyBFamily]);
+                bool in_contact = calcContactPoint(
+                    simParams, granData, bodyX[bodyA], bodyY[bodyA], bodyZ[bodyA], radii[bodyA], bodyIDs[bodyA],
+                    bodyX[bodyB], bodyY[bodyB], bodyZ[bodyB], radii[bodyB], bodyIDs[bodyB], contactPntBin,
+                    granData->familyExtraMarginSize[bodyAFamily], granData->familyExtraMarginSize[bodyBFamily]);
                 /*
                 if (in_contact) {
                     printf("Contact point I see: %e, %e, %e\n", contactPntX, contactPntY, contactPntZ);
@@ -222,7 +316,7 @@ __global__ void getNumberOfSphereContactsEachBin(deme::DEMSimParams* simParams,
             for (deme::spheresBinTouches_t i = 0; i < leftover_count; i++) {
                 deme::bodyID_t cur_ownerID, cur_bodyID;
                 float cur_radii;
-                double cur_bodyX, cur_bodyY, cur_bodyZ;
+                cdPos_t cur_bodyX, cur_bodyY, cur_bodyZ;
                 deme::family_t cur_ownerFamily;
                 {
                     const deme::spheresBinTouches_t cur_ind = processed_count + DEME_NUM_SPHERES_PER_CD_BATCH + i;
@@ -230,9 +324,9 @@ __global__ void getNumberOfSphereContactsEachBin(deme::DEMSimParams* simParams,
 
                     // Get the info of this sphere in question here. Note this is a broadcast so should be relatively
                     // fast.
-                    fillSharedMemSpheres<float, double>(simParams, granData, 0, cur_sphereID, &cur_ownerID, &cur_bodyID,
-                                                        &cur_ownerFamily, &cur_radii, &cur_bodyX, &cur_bodyY,
-                                                        &cur_bodyZ);
+                    fillSharedMemSpheres<float, cdPos_t>(simParams, granData, 0, cur_sphereID, &cur_ownerID,
+                                                         &cur_bodyID, &cur_ownerFamily, &cur_radii, &cur_bodyX,
+                                                         &cur_bodyY, &cur_bodyZ, binOrigin);
                 }
                 // Then each in-shared-mem sphere compares against it. But first, check if same owner...
                 if (ownerIDs[myThreadID] == cur_ownerID)
@@ -247,10 +341,10 @@ __global__ void getNumberOfSphereContactsEachBin(deme::DEMSimParams* simParams,
                 }
 
                 deme::binID_t contactPntBin;
-                bool in_contact = calcContactPoint(simParams, bodyX[myThreadID], bodyY[myThreadID], bodyZ[myThreadID],
-                                                   radii[myThreadID], cur_bodyX, cur_bodyY, cur_bodyZ, cur_radii,
-                                                   contactPntBin, granData->familyExtraMarginSize[bodyAFamily],
-                                                   granData->familyExtraMarginSize[cur_ownerFamily]);
+                bool in_contact = calcContactPoint(
+                    simParams, granData, bodyX[myThreadID], bodyY[myThreadID], bodyZ[myThreadID], radii[myThreadID],
+                    bodyIDs[myThreadID], cur_bodyX, cur_bodyY, cur_bodyZ, cur_radii, cur_bodyID, contactPntBin,
+                    granData->familyExtraMarginSize[bodyAFamily], granData->familyExtraMarginSize[cur_ownerFamily]);
 
                 if (in_contact && (contactPntBin == binID)) {
                     atomicAdd(&blockPairCnt, 1);
@@ -280,18 +374,18 @@ __global__ void populateSphSphContactPairsEachBin(deme::DEMSimParams* simParams,
     __shared__ deme::bodyID_t ownerIDs[DEME_NUM_SPHERES_PER_CD_BATCH];
     __shared__ deme::bodyID_t bodyIDs[DEME_NUM_SPHERES_PER_CD_BATCH];
     __shared__ float radii[DEME_NUM_SPHERES_PER_CD_BATCH];
-    __shared__ double bodyX[DEME_NUM_SPHERES_PER_CD_BATCH];
-    __shared__ double bodyY[DEME_NUM_SPHERES_PER_CD_BATCH];
-    __shared__ double bodyZ[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyX[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyY[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyZ[DEME_NUM_SPHERES_PER_CD_BATCH];
     __shared__ deme::family_t ownerFamilies[DEME_NUM_SPHERES_PER_CD_BATCH];
     __shared__ deme::binContactPairs_t blockPairCnt;
 
     const deme::spheresBinTouches_t nBodiesInBin = numSpheresBinTouches[blockIdx.x];
     const deme::binID_t binID = activeBinIDs[blockIdx.x];
+    const double3 binOrigin = getStagingOrigin(simParams, binID);
     if (nBodiesInBin <= 1 || binID == deme::NULL_BINID) {
         return;
     }
-    // No need to check max spheres one more time
 
     const deme::spheresBinTouches_t myThreadID = threadIdx.x;
     const deme::binSphereTouchPairs_t thisBodiesTableEntry = sphereIDsLookUpTable[blockIdx.x];
@@ -300,6 +394,16 @@ __global__ void populateSphSphContactPairsEachBin(deme::DEMSimParams* simParams,
     // Get my offset for writing back to the global arrays that contain contact pair info
     const deme::contactPairs_t myReportOffset = contactReportOffsets[blockIdx.x];
     const deme::contactPairs_t myReportOffset_end = contactReportOffsets[blockIdx.x + 1];
+
+    // Dense bins are populated by populateSphSphContactPairsDenseBins, which runs after this kernel. We just mark their
+    // slots as non-contacts for safety, and it will overwrite them.
+    if (nBodiesInBin > DEME_MAX_SPHERES_PER_BIN_SINGLE_BLOCK) {
+        for (deme::contactPairs_t inBlockOffset = myReportOffset + myThreadID; inBlockOffset < myReportOffset_end;
+             inBlockOffset += blockDim.x) {
+            dType[inBlockOffset] = deme::NOT_A_CONTACT;
+        }
+        return;
+    }
     __syncthreads();
 
     // This bin may have more than 256 (default) spheres, so we process it by 256-sphere batch
@@ -317,8 +421,8 @@ __global__ void populateSphSphContactPairsEachBin(deme::DEMSimParams* simParams,
         if (myThreadID < this_batch_active_count) {
             deme::bodyID_t sphereID =
                 sphereIDsEachBinTouches_sorted[thisBodiesTableEntry + processed_count + myThreadID];
-            fillSharedMemSpheres<float, double>(simParams, granData, myThreadID, sphereID, ownerIDs, bodyIDs,
-                                                ownerFamilies, radii, bodyX, bodyY, bodyZ);
+            fillSharedMemSpheres<float, cdPos_t>(simParams, granData, myThreadID, sphereID, ownerIDs, bodyIDs,
+                                                 ownerFamilies, radii, bodyX, bodyY, bodyZ, binOrigin);
         }
         __syncthreads();
 
@@ -354,18 +458,20 @@ __global__ void populateSphSphContactPairsEachBin(deme::DEMSimParams* simParams,
                 }
 
                 deme::binID_t contactPntBin;
-                bool in_contact = calcContactPoint(simParams, bodyX[bodyA], bodyY[bodyA], bodyZ[bodyA], radii[bodyA],
-                                                   bodyX[bodyB], bodyY[bodyB], bodyZ[bodyB], radii[bodyB],
-                                                   contactPntBin, granData->familyExtraMarginSize[bodyAFamily],
-                                                   granData->familyExtraMarginSize[bodyBFamily]);
+                bool in_contact = calcContactPoint(
+                    simParams, granData, bodyX[bodyA], bodyY[bodyA], bodyZ[bodyA], radii[bodyA], bodyIDs[bodyA],
+                    bodyX[bodyB], bodyY[bodyB], bodyZ[bodyB], radii[bodyB], bodyIDs[bodyB], contactPntBin,
+                    granData->familyExtraMarginSize[bodyAFamily], granData->familyExtraMarginSize[bodyBFamily]);
 
                 if (in_contact && (contactPntBin == binID)) {
                     deme::contactPairs_t inBlockOffset = myReportOffset + atomicAdd(&blockPairCnt, 1);
                     // The chance of offset going out-of-bound is very low, lower than sph--bin CD step, but I put it
                     // here anyway
                     if (inBlockOffset < myReportOffset_end) {
-                        idSphA[inBlockOffset] = bodyIDs[bodyA];
-                        idSphB[inBlockOffset] = bodyIDs[bodyB];
+                        // A bin's spheres are not always in increasing ID order (the cached fixed spheres come
+                        // last), so the smaller ID goes first explicitly
+                        idSphA[inBlockOffset] = DEME_MIN(bodyIDs[bodyA], bodyIDs[bodyB]);
+                        idSphB[inBlockOffset] = DEME_MAX(bodyIDs[bodyA], bodyIDs[bodyB]);
                         dType[inBlockOffset] = deme::SPHERE_SPHERE_CONTACT;
                     }
                 }
@@ -379,7 +485,7 @@ __global__ void populateSphSphContactPairsEachBin(deme::DEMSimParams* simParams,
             for (deme::spheresBinTouches_t i = 0; i < leftover_count; i++) {
                 deme::bodyID_t cur_ownerID, cur_bodyID;
                 float cur_radii;
-                double cur_bodyX, cur_bodyY, cur_bodyZ;
+                cdPos_t cur_bodyX, cur_bodyY, cur_bodyZ;
                 deme::family_t cur_ownerFamily;
                 {
                     const deme::spheresBinTouches_t cur_ind = processed_count + DEME_NUM_SPHERES_PER_CD_BATCH + i;
@@ -387,9 +493,9 @@ __global__ void populateSphSphContactPairsEachBin(deme::DEMSimParams* simParams,
 
                     // Get the info of this sphere in question here. Note this is a broadcast so should be relatively
                     // fast.
-                    fillSharedMemSpheres<float, double>(simParams, granData, 0, cur_sphereID, &cur_ownerID, &cur_bodyID,
-                                                        &cur_ownerFamily, &cur_radii, &cur_bodyX, &cur_bodyY,
-                                                        &cur_bodyZ);
+                    fillSharedMemSpheres<float, cdPos_t>(simParams, granData, 0, cur_sphereID, &cur_ownerID,
+                                                         &cur_bodyID, &cur_ownerFamily, &cur_radii, &cur_bodyX,
+                                                         &cur_bodyY, &cur_bodyZ, binOrigin);
                 }
                 // Then each in-shared-mem sphere compares against it. But first, check if same owner...
                 if (ownerIDs[myThreadID] == cur_ownerID)
@@ -404,18 +510,18 @@ __global__ void populateSphSphContactPairsEachBin(deme::DEMSimParams* simParams,
                 }
 
                 deme::binID_t contactPntBin;
-                bool in_contact = calcContactPoint(simParams, bodyX[myThreadID], bodyY[myThreadID], bodyZ[myThreadID],
-                                                   radii[myThreadID], cur_bodyX, cur_bodyY, cur_bodyZ, cur_radii,
-                                                   contactPntBin, granData->familyExtraMarginSize[bodyAFamily],
-                                                   granData->familyExtraMarginSize[cur_ownerFamily]);
+                bool in_contact = calcContactPoint(
+                    simParams, granData, bodyX[myThreadID], bodyY[myThreadID], bodyZ[myThreadID], radii[myThreadID],
+                    bodyIDs[myThreadID], cur_bodyX, cur_bodyY, cur_bodyZ, cur_radii, cur_bodyID, contactPntBin,
+                    granData->familyExtraMarginSize[bodyAFamily], granData->familyExtraMarginSize[cur_ownerFamily]);
 
                 if (in_contact && (contactPntBin == binID)) {
                     deme::contactPairs_t inBlockOffset = myReportOffset + atomicAdd(&blockPairCnt, 1);
                     // The chance of offset going out-of-bound is very low, lower than sph--bin CD step, but I put it
                     // here anyway
                     if (inBlockOffset < myReportOffset_end) {
-                        idSphA[inBlockOffset] = bodyIDs[myThreadID];
-                        idSphB[inBlockOffset] = cur_bodyID;
+                        idSphA[inBlockOffset] = DEME_MIN(bodyIDs[myThreadID], cur_bodyID);
+                        idSphB[inBlockOffset] = DEME_MAX(bodyIDs[myThreadID], cur_bodyID);
                         dType[inBlockOffset] = deme::SPHERE_SPHERE_CONTACT;
                     }
                 }
@@ -435,3 +541,443 @@ __global__ void populateSphSphContactPairsEachBin(deme::DEMSimParams* simParams,
         }
     }
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// Dense bins: bins having more than DEME_MAX_SPHERES_PER_BIN_SINGLE_BLOCK spheres
+////////////////////////////////////////////////////////////////////////////////
+
+// A dense bin's spheres are cut into tiles of DEME_NUM_SPHERES_PER_CD_BATCH spheres, and each block handles one pair of
+// tiles (tileA <= tileB) of one dense bin. This fills the shared memory arrays of one tile.
+inline __device__ void fillSharedMemSphereTile(deme::DEMSimParams* simParams,
+                                               deme::DEMDataKT* granData,
+                                               deme::bodyID_t* sphereIDsEachBinTouches_sorted,
+                                               const deme::binSphereTouchPairs_t& tileEntry,
+                                               const unsigned int& nInTile,
+                                               deme::bodyID_t* ownerIDs,
+                                               deme::bodyID_t* bodyIDs,
+                                               deme::family_t* ownerFamilies,
+                                               float* radii,
+                                               cdPos_t* bodyX,
+                                               cdPos_t* bodyY,
+                                               cdPos_t* bodyZ,
+                                               const double3& binOrigin) {
+    for (unsigned int i = threadIdx.x; i < nInTile; i += blockDim.x) {
+        deme::bodyID_t sphereID = sphereIDsEachBinTouches_sorted[tileEntry + i];
+        fillSharedMemSpheres<float, cdPos_t>(simParams, granData, i, sphereID, ownerIDs, bodyIDs, ownerFamilies, radii,
+                                             bodyX, bodyY, bodyZ, binOrigin);
+    }
+}
+
+// Find out which 2 tiles in the dense bin this block works on, and how many spheres they have
+inline __device__ void getDenseBinTilePair(const deme::spheresBinTouches_t& nBodiesInBin,
+                                           const deme::binSphereTouchPairs_t& tilePair,
+                                           unsigned int& tileA,
+                                           unsigned int& tileB,
+                                           unsigned int& nInTileA,
+                                           unsigned int& nInTileB) {
+    const unsigned int nTiles =
+        ((unsigned int)nBodiesInBin + DEME_NUM_SPHERES_PER_CD_BATCH - 1) / DEME_NUM_SPHERES_PER_CD_BATCH;
+    // Pairs (i, j) with i <= j among n tiles are the pairs (i, j + 1) with i < j + 1 among n + 1 tiles
+    recoverCntPair<unsigned int>(tileA, tileB, (unsigned int)tilePair, nTiles + 1);
+    tileB -= 1;
+    nInTileA =
+        DEME_MIN(DEME_NUM_SPHERES_PER_CD_BATCH, (unsigned int)nBodiesInBin - tileA * DEME_NUM_SPHERES_PER_CD_BATCH);
+    nInTileB =
+        DEME_MIN(DEME_NUM_SPHERES_PER_CD_BATCH, (unsigned int)nBodiesInBin - tileB * DEME_NUM_SPHERES_PER_CD_BATCH);
+}
+
+// Sphere a in tile A and sphere b in tile B. If the 2 tiles are the same, then a < b runs through all n * (n - 1) / 2
+// pairs; otherwise all nInTileA * nInTileB pairs.
+inline __device__ void getDenseBinSpherePair(const unsigned int& ind,
+                                             const bool& sameTile,
+                                             const unsigned int& nInTileA,
+                                             const unsigned int& nInTileB,
+                                             unsigned int& a,
+                                             unsigned int& b) {
+    if (sameTile) {
+        recoverCntPair<unsigned int>(a, b, ind, nInTileA);
+    } else {
+        a = ind / nInTileB;
+        b = ind % nInTileB;
+    }
+}
+
+inline __device__ bool checkDenseBinSpherePair(deme::DEMSimParams* simParams,
+                                               deme::DEMDataKT* granData,
+                                               const deme::binID_t& binID,
+                                               const deme::bodyID_t& ownerA,
+                                               const deme::bodyID_t& sphereA,
+                                               const deme::family_t& familyA,
+                                               const cdPos_t& XA,
+                                               const cdPos_t& YA,
+                                               const cdPos_t& ZA,
+                                               const float& rA,
+                                               const deme::bodyID_t& ownerB,
+                                               const deme::bodyID_t& sphereB,
+                                               const deme::family_t& familyB,
+                                               const cdPos_t& XB,
+                                               const cdPos_t& YB,
+                                               const cdPos_t& ZB,
+                                               const float& rB) {
+    if (ownerA == ownerB)
+        return false;
+    unsigned int bodyAFamily = familyA;
+    unsigned int bodyBFamily = familyB;
+    unsigned int maskMatID = locateMaskPair<unsigned int>(bodyAFamily, bodyBFamily);
+    if (granData->familyMasks[maskMatID] != deme::DONT_PREVENT_CONTACT)
+        return false;
+    deme::binID_t contactPntBin;
+    bool in_contact = calcContactPoint(simParams, granData, XA, YA, ZA, rA, sphereA, XB, YB, ZB, rB, sphereB,
+                                       contactPntBin, granData->familyExtraMarginSize[bodyAFamily],
+                                       granData->familyExtraMarginSize[bodyBFamily]);
+    return in_contact && (contactPntBin == binID);
+}
+
+__global__ void getNumberOfSphereContactsDenseBins(deme::DEMSimParams* simParams,
+                                                   deme::DEMDataKT* granData,
+                                                   deme::bodyID_t* sphereIDsEachBinTouches_sorted,
+                                                   deme::binID_t* activeBinIDs,
+                                                   deme::spheresBinTouches_t* numSpheresBinTouches,
+                                                   deme::binSphereTouchPairs_t* sphereIDsLookUpTable,
+                                                   deme::binID_t* denseWorkBin,
+                                                   deme::binSphereTouchPairs_t* denseWorkTilePair,
+                                                   deme::binContactPairs_t* numContactsInEachBin,
+                                                   size_t nDenseWork) {
+    __shared__ deme::bodyID_t ownerIDsA[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::bodyID_t bodyIDsA[DEME_NUM_SPHERES_PER_CD_BATCH];  // In this kernel, only used in bin-local mode
+    __shared__ float radiiA[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyXA[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyYA[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyZA[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::family_t ownerFamiliesA[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::bodyID_t ownerIDsB[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::bodyID_t bodyIDsB[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ float radiiB[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyXB[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyYB[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyZB[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::family_t ownerFamiliesB[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::binContactPairs_t blockPairCnt;
+
+    const deme::binID_t myActiveBin = denseWorkBin[blockIdx.x];
+    const deme::spheresBinTouches_t nBodiesInBin = numSpheresBinTouches[myActiveBin];
+    const deme::binID_t binID = activeBinIDs[myActiveBin];
+    const double3 binOrigin = getStagingOrigin(simParams, binID);
+    const deme::binSphereTouchPairs_t thisBodiesTableEntry = sphereIDsLookUpTable[myActiveBin];
+    unsigned int tileA, tileB, nInTileA, nInTileB;
+    getDenseBinTilePair(nBodiesInBin, denseWorkTilePair[blockIdx.x], tileA, tileB, nInTileA, nInTileB);
+    const bool sameTile = (tileA == tileB);
+    if (threadIdx.x == 0)
+        blockPairCnt = 0;
+
+    fillSharedMemSphereTile(simParams, granData, sphereIDsEachBinTouches_sorted,
+                            thisBodiesTableEntry + tileA * DEME_NUM_SPHERES_PER_CD_BATCH, nInTileA, ownerIDsA,
+                            bodyIDsA, ownerFamiliesA, radiiA, bodyXA, bodyYA, bodyZA, binOrigin);
+    if (!sameTile) {
+        fillSharedMemSphereTile(simParams, granData, sphereIDsEachBinTouches_sorted,
+                                thisBodiesTableEntry + tileB * DEME_NUM_SPHERES_PER_CD_BATCH, nInTileB, ownerIDsB,
+                                bodyIDsB, ownerFamiliesB, radiiB, bodyXB, bodyYB, bodyZB, binOrigin);
+    }
+    __syncthreads();
+
+    // If it is the same tile, then sphere B also comes from tile A
+    const deme::bodyID_t* ownerB = sameTile ? ownerIDsA : ownerIDsB;
+    const deme::bodyID_t* bodyB = sameTile ? bodyIDsA : bodyIDsB;
+    const deme::family_t* familyB = sameTile ? ownerFamiliesA : ownerFamiliesB;
+    const float* radB = sameTile ? radiiA : radiiB;
+    const cdPos_t* XB = sameTile ? bodyXA : bodyXB;
+    const cdPos_t* YB = sameTile ? bodyYA : bodyYB;
+    const cdPos_t* ZB = sameTile ? bodyZA : bodyZB;
+    const unsigned int nPairsNeedHandling = sameTile ? nInTileA * (nInTileA - 1) / 2 : nInTileA * nInTileB;
+    deme::binContactPairs_t myPairCnt = 0;
+    for (unsigned int ind = threadIdx.x; ind < nPairsNeedHandling; ind += blockDim.x) {
+        unsigned int a, b;
+        getDenseBinSpherePair(ind, sameTile, nInTileA, nInTileB, a, b);
+        if (checkDenseBinSpherePair(simParams, granData, binID, ownerIDsA[a], bodyIDsA[a], ownerFamiliesA[a],
+                                    bodyXA[a], bodyYA[a], bodyZA[a], radiiA[a], ownerB[b], bodyB[b], familyB[b], XB[b],
+                                    YB[b], ZB[b], radB[b])) {
+            myPairCnt++;
+        }
+    }
+    if (myPairCnt > 0) {
+        atomicAdd(&blockPairCnt, myPairCnt);
+    }
+    __syncthreads();
+
+    // Multiple blocks work on the same bin, so their results are merged into the count of this bin
+    if (threadIdx.x == 0 && blockPairCnt > 0) {
+        atomicAdd(numContactsInEachBin + myActiveBin, blockPairCnt);
+    }
+}
+
+__global__ void populateSphSphContactPairsDenseBins(deme::DEMSimParams* simParams,
+                                                    deme::DEMDataKT* granData,
+                                                    deme::bodyID_t* sphereIDsEachBinTouches_sorted,
+                                                    deme::binID_t* activeBinIDs,
+                                                    deme::spheresBinTouches_t* numSpheresBinTouches,
+                                                    deme::binSphereTouchPairs_t* sphereIDsLookUpTable,
+                                                    deme::binID_t* denseWorkBin,
+                                                    deme::binSphereTouchPairs_t* denseWorkTilePair,
+                                                    deme::contactPairs_t* contactReportOffsets,
+                                                    deme::binContactPairs_t* denseBinCursor,
+                                                    deme::bodyID_t* idSphA,
+                                                    deme::bodyID_t* idSphB,
+                                                    deme::contact_t* dType,
+                                                    size_t nDenseWork) {
+    __shared__ deme::bodyID_t ownerIDsA[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::bodyID_t bodyIDsA[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ float radiiA[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyXA[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyYA[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyZA[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::family_t ownerFamiliesA[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::bodyID_t ownerIDsB[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::bodyID_t bodyIDsB[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ float radiiB[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyXB[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyYB[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ cdPos_t bodyZB[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::family_t ownerFamiliesB[DEME_NUM_SPHERES_PER_CD_BATCH];
+
+    const deme::binID_t myActiveBin = denseWorkBin[blockIdx.x];
+    const deme::spheresBinTouches_t nBodiesInBin = numSpheresBinTouches[myActiveBin];
+    const deme::binID_t binID = activeBinIDs[myActiveBin];
+    const double3 binOrigin = getStagingOrigin(simParams, binID);
+    const deme::binSphereTouchPairs_t thisBodiesTableEntry = sphereIDsLookUpTable[myActiveBin];
+    const deme::contactPairs_t myReportOffset = contactReportOffsets[myActiveBin];
+    const deme::contactPairs_t myReportOffset_end = contactReportOffsets[myActiveBin + 1];
+    unsigned int tileA, tileB, nInTileA, nInTileB;
+    getDenseBinTilePair(nBodiesInBin, denseWorkTilePair[blockIdx.x], tileA, tileB, nInTileA, nInTileB);
+    const bool sameTile = (tileA == tileB);
+
+    fillSharedMemSphereTile(simParams, granData, sphereIDsEachBinTouches_sorted,
+                            thisBodiesTableEntry + tileA * DEME_NUM_SPHERES_PER_CD_BATCH, nInTileA, ownerIDsA,
+                            bodyIDsA, ownerFamiliesA, radiiA, bodyXA, bodyYA, bodyZA, binOrigin);
+    if (!sameTile) {
+        fillSharedMemSphereTile(simParams, granData, sphereIDsEachBinTouches_sorted,
+                                thisBodiesTableEntry + tileB * DEME_NUM_SPHERES_PER_CD_BATCH, nInTileB, ownerIDsB,
+                                bodyIDsB, ownerFamiliesB, radiiB, bodyXB, bodyYB, bodyZB, binOrigin);
+    }
+    __syncthreads();
+
+    const deme::bodyID_t* ownerB = sameTile ? ownerIDsA : ownerIDsB;
+    const deme::bodyID_t* bodyB = sameTile ? bodyIDsA : bodyIDsB;
+    const deme::family_t* familyB = sameTile ? ownerFamiliesA : ownerFamiliesB;
+    const float* radB = sameTile ? radiiA : radiiB;
+    const cdPos_t* XB = sameTile ? bodyXA : bodyXB;
+    const cdPos_t* YB = sameTile ? bodyYA : bodyYB;
+    const cdPos_t* ZB = sameTile ? bodyZA : bodyZB;
+    const unsigned int nPairsNeedHandling = sameTile ? nInTileA * (nInTileA - 1) / 2 : nInTileA * nInTileB;
+    for (unsigned int ind = threadIdx.x; ind < nPairsNeedHandling; ind += blockDim.x) {
+        unsigned int a, b;
+        getDenseBinSpherePair(ind, sameTile, nInTileA, nInTileB, a, b);
+        if (checkDenseBinSpherePair(simParams, granData, binID, ownerIDsA[a], bodyIDsA[a], ownerFamiliesA[a],
+                                    bodyXA[a], bodyYA[a], bodyZA[a], radiiA[a], ownerB[b], bodyB[b], familyB[b], XB[b],
+                                    YB[b], ZB[b], radB[b])) {
+            // All blocks working on this bin share one cursor
+            deme::contactPairs_t inBinOffset = myReportOffset + atomicAdd(denseBinCursor + myActiveBin, 1);
+            if (inBinOffset < myReportOffset_end) {
+                idSphA[inBinOffset] = DEME_MIN(bodyIDsA[a], bodyB[b]);
+                idSphB[inBinOffset] = DEME_MAX(bodyIDsA[a], bodyB[b]);
+                dType[inBinOffset] = deme::SPHERE_SPHERE_CONTACT;
+            }
+        }
+    }
+}
+
+// =============================================================================
+// The coarse level of the bin hierarchy: spheres too large for the bins live in a coarse grid, and all spheres query it
+// =============================================================================
+
+__global__ void markCoarseSpheres(deme::DEMSimParams* simParams, deme::DEMDataKT* granData, deme::bodyID_t* isCoarse) {
+    deme::bodyID_t sphereID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (sphereID < simParams->nSpheresGM) {
+        float myRadius;
+        float3 myRelPos;
+        // Outputs myRelPos, myRadius
+        { _componentAcqStrat_; }
+        isCoarse[sphereID] = (myRadius > simParams->coarseSphereRadius) ? 1 : 0;
+    }
+}
+
+__global__ void collectCoarseSpheres(deme::DEMSimParams* simParams,
+                                     deme::DEMDataKT* granData,
+                                     deme::bodyID_t* isCoarse,
+                                     deme::bodyID_t* isCoarseScan,
+                                     deme::bodyID_t* coarseIDs,
+                                     float* coarseRadii) {
+    deme::bodyID_t sphereID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (sphereID < simParams->nSpheresGM && isCoarse[sphereID]) {
+        deme::bodyID_t myOwnerID = granData->ownerClumpBody[sphereID];
+        float myRadius;
+        float3 myRelPos;
+        { _componentAcqStrat_; }
+        coarseIDs[isCoarseScan[sphereID]] = sphereID;
+        coarseRadii[isCoarseScan[sphereID]] = myRadius + granData->marginSize[myOwnerID];
+    }
+}
+
+inline __device__ uint64_t coarseCellIndex(double pos, double cellSize, uint64_t nCells) {
+    const double ind = floor(pos / cellSize);
+    if (ind < 0.)
+        return 0;
+    return ((uint64_t)ind < nCells) ? (uint64_t)ind : nCells - 1;
+}
+
+__global__ void computeCoarseCellKeys(deme::DEMSimParams* simParams,
+                                      deme::DEMDataKT* granData,
+                                      deme::bodyID_t* coarseIDs,
+                                      uint64_t* keys,
+                                      double cellSize,
+                                      uint64_t ncX,
+                                      uint64_t ncY,
+                                      uint64_t ncZ,
+                                      size_t nCoarse) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < nCoarse) {
+        deme::bodyID_t ownerID, bodyID;
+        deme::family_t ownerFamily;
+        float myRadius;
+        double X, Y, Z;
+        fillSharedMemSpheres<float, double>(simParams, granData, 0, coarseIDs[myID], &ownerID, &bodyID, &ownerFamily,
+                                            &myRadius, &X, &Y, &Z);
+        keys[myID] = coarseCellIndex(X, cellSize, ncX) +
+                     ncX * (coarseCellIndex(Y, cellSize, ncY) + ncY * coarseCellIndex(Z, cellSize, ncZ));
+    }
+}
+
+// Find the contacts between a sphere and the coarse-level spheres, by visiting the coarse cells in its reach: up to 3
+// per direction, so up to 3^3 = 27 cells. Coarse--coarse pairs are only reported by the one with the smaller ID. If
+// idSphA is NULL, they are just counted.
+inline __device__ deme::contactPairs_t querySphereInCoarseLevel(deme::DEMSimParams* simParams,
+                                                                deme::DEMDataKT* granData,
+                                                                deme::bodyID_t sphereID,
+                                                                deme::bodyID_t* isCoarse,
+                                                                uint64_t* keys_sorted,
+                                                                deme::bodyID_t* coarseIDs_sorted,
+                                                                size_t nCoarse,
+                                                                double cellSize,
+                                                                uint64_t ncX,
+                                                                uint64_t ncY,
+                                                                uint64_t ncZ,
+                                                                float maxCoarseRadius,
+                                                                deme::bodyID_t* idSphA,
+                                                                deme::bodyID_t* idSphB,
+                                                                deme::contact_t* dType,
+                                                                deme::contactPairs_t myReportOffset,
+                                                                deme::contactPairs_t myReportOffset_end) {
+    deme::bodyID_t ownerA, bodyA;
+    deme::family_t familyA;
+    float radiusA;
+    double XA, YA, ZA;
+    fillSharedMemSpheres<float, double>(simParams, granData, 0, sphereID, &ownerA, &bodyA, &familyA, &radiusA, &XA, &YA,
+                                        &ZA);
+    const bool amCoarse = isCoarse[sphereID];
+    // The cell size is twice the largest coarse sphere radius, and no sphere is larger than that one, so the reach is
+    // at most one cell size. The [pos - reach, pos + reach] box is then at most 2 cells wide, and can touch up to 3
+    // cells per direction (not 2, since it is generally not aligned with the cell boundaries).
+    const double reach = (double)radiusA + (double)maxCoarseRadius;
+    const uint64_t xLo = coarseCellIndex(XA - reach, cellSize, ncX), xHi = coarseCellIndex(XA + reach, cellSize, ncX);
+    const uint64_t yLo = coarseCellIndex(YA - reach, cellSize, ncY), yHi = coarseCellIndex(YA + reach, cellSize, ncY);
+    const uint64_t zLo = coarseCellIndex(ZA - reach, cellSize, ncZ), zHi = coarseCellIndex(ZA + reach, cellSize, ncZ);
+
+    deme::contactPairs_t count = 0;
+    for (uint64_t k = zLo; k <= zHi; k++) {
+        for (uint64_t j = yLo; j <= yHi; j++) {
+            for (uint64_t i = xLo; i <= xHi; i++) {
+                const uint64_t key = i + ncX * (j + ncY * k);
+                // Lower bound of this cell in the sorted keys
+                size_t lo = 0, hi = nCoarse;
+                while (lo < hi) {
+                    size_t mid = (lo + hi) / 2;
+                    if (keys_sorted[mid] < key) {
+                        lo = mid + 1;
+                    } else {
+                        hi = mid;
+                    }
+                }
+                for (; lo < nCoarse && keys_sorted[lo] == key; lo++) {
+                    const deme::bodyID_t otherID = coarseIDs_sorted[lo];
+                    if (otherID == sphereID || (amCoarse && otherID < sphereID))
+                        continue;
+                    deme::bodyID_t ownerB, bodyB;
+                    deme::family_t familyB;
+                    float radiusB;
+                    double XB, YB, ZB;
+                    fillSharedMemSpheres<float, double>(simParams, granData, 0, otherID, &ownerB, &bodyB, &familyB,
+                                                        &radiusB, &XB, &YB, &ZB);
+                    if (ownerA == ownerB)
+                        continue;
+                    unsigned int maskMatID = locateMaskPair<unsigned int>(familyA, familyB);
+                    if (granData->familyMasks[maskMatID] != deme::DONT_PREVENT_CONTACT)
+                        continue;
+                    // The contact point's bin is not needed here: each pair is visited once
+                    deme::binID_t contactPntBin;
+                    bool in_contact = calcContactPoint(simParams, XA, YA, ZA, radiusA, XB, YB, ZB, radiusB,
+                                                       contactPntBin, granData->familyExtraMarginSize[familyA],
+                                                       granData->familyExtraMarginSize[familyB]);
+                    if (in_contact) {
+                        if (idSphA != NULL && myReportOffset + count < myReportOffset_end) {
+                            // Same as the bin-wise sweep: the smaller ID is geometry A
+                            idSphA[myReportOffset + count] = DEME_MIN(sphereID, otherID);
+                            idSphB[myReportOffset + count] = DEME_MAX(sphereID, otherID);
+                            dType[myReportOffset + count] = deme::SPHERE_SPHERE_CONTACT;
+                        }
+                        count++;
+                    }
+                }
+            }
+        }
+    }
+    return count;
+}
+
+__global__ void getNumberOfCoarseLevelContacts(deme::DEMSimParams* simParams,
+                                               deme::DEMDataKT* granData,
+                                               deme::bodyID_t* isCoarse,
+                                               uint64_t* keys_sorted,
+                                               deme::bodyID_t* coarseIDs_sorted,
+                                               deme::contactPairs_t* numCoarseContactsEachSphere,
+                                               size_t nCoarse,
+                                               double cellSize,
+                                               uint64_t ncX,
+                                               uint64_t ncY,
+                                               uint64_t ncZ,
+                                               float maxCoarseRadius) {
+    deme::bodyID_t sphereID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (sphereID < simParams->nSpheresGM) {
+        numCoarseContactsEachSphere[sphereID] =
+            querySphereInCoarseLevel(simParams, granData, sphereID, isCoarse, keys_sorted, coarseIDs_sorted, nCoarse,
+                                     cellSize, ncX, ncY, ncZ, maxCoarseRadius, NULL, NULL, NULL, 0, 0);
+    }
+}
+
+__global__ void populateCoarseLevelContacts(deme::DEMSimParams* simParams,
+                                            deme::DEMDataKT* granData,
+                                            deme::bodyID_t* isCoarse,
+                                            uint64_t* keys_sorted,
+                                            deme::bodyID_t* coarseIDs_sorted,
+                                            deme::contactPairs_t* numCoarseContactsEachSphere,
+                                            deme::contactPairs_t* coarseContactReportOffsets,
+                                            deme::bodyID_t* idSphA,
+                                            deme::bodyID_t* idSphB,
+                                            deme::contact_t* dType,
+                                            size_t nCoarse,
+                                            double cellSize,
+                                            uint64_t ncX,
+                                            uint64_t ncY,
+                                            uint64_t ncZ,
+                                            float maxCoarseRadius) {
+    deme::bodyID_t sphereID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (sphereID < simParams->nSpheresGM) {
+        const deme::contactPairs_t myReportOffset = coarseContactReportOffsets[sphereID];
+        const deme::contactPairs_t myReportOffset_end = myReportOffset + numCoarseContactsEachSphere[sphereID];
+        deme::contactPairs_t count = querySphereInCoarseLevel(
+            simParams, granData, sphereID, isCoarse, keys_sorted, coarseIDs_sorted, nCoarse, cellSize, ncX, ncY, ncZ,
+            maxCoarseRadius, idSphA, idSphB, dType, myReportOffset, myReportOffset_end);
+        // Should the 2 sweeps disagree, the unused slots are marked
+        for (deme::contactPairs_t i = myReportOffset + count; i < myReportOffset_end; i++) {
+            dType[i] = deme::NOT_A_CONTACT;
+        }
+    }
+}
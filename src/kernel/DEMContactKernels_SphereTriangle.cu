@@ -250,8 +250,9 @@ __global__ void getNumberOfSphTriContactsEachBin(deme::DEMSimParams* simParams,
                     // triangles; or we will have double count problems. Use the first triangle as standard.
                     if (in_contact_A || in_contact_B) {
                         snap_to_face(triANode1[ind], triANode2[ind], triANode3[ind], sphXYZ, cntPnt);
-                        deme::binID_t contactPntBin = getPointBinID<deme::binID_t>(
-                            cntPnt.x, cntPnt.y, cntPnt.z, simParams->binSize, simParams->nbX, simParams->nbY);
+                        deme::binID_t contactPntBin =
+                            getPointBinID<deme::binID_t>(cntPnt.x, _twoDimensional_ ? 0.0 : cntPnt.y, cntPnt.z,
+                                                         simParams->binSize, simParams->nbX, simParams->nbY);
                         if (contactPntBin == binID) {
                             atomicAdd(&blockPairCnt, 1);
                         }
@@ -398,8 +399,9 @@ __global__ void populateTriSphContactsEachBin(deme::DEMSimParams* simParams,
                     // triangles; or we will have double count problems. Use the first triangle as standard.
                     if (in_contact_A || in_contact_B) {
                         snap_to_face(triANode1[ind], triANode2[ind], triANode3[ind], sphXYZ, cntPnt);
-                        deme::binID_t contactPntBin = getPointBinID<deme::binID_t>(
-                            cntPnt.x, cntPnt.y, cntPnt.z, simParams->binSize, simParams->nbX, simParams->nbY);
+                        deme::binID_t contactPntBin =
+                            getPointBinID<deme::binID_t>(cntPnt.x, _twoDimensional_ ? 0.0 : cntPnt.y, cntPnt.z,
+                                                         simParams->binSize, simParams->nbX, simParams->nbY);
                         if (contactPntBin == binID) {
                             deme::contactPairs_t inBlockOffset = myReportOffset + atomicAdd(&blockPairCnt, 1);
                             if (inBlockOffset < myReportOffset_end) {
@@ -425,3 +427,294 @@ __global__ void populateTriSphContactsEachBin(deme::DEMSimParams* simParams,
         }
     }
 }
+
+// =============================================================================
+// BVH-based sphere--triangle contact detection, for meshes that do not go through bins
+// =============================================================================
+
+// Find the contacts between a sphere and the facets of all BVH meshes. If idSphA is NULL, they are just counted;
+// otherwise they are written starting from myReportOffset, but not beyond myReportOffset_end.
+inline __device__ deme::contactPairs_t querySphereInTriBVHs(deme::DEMSimParams* simParams,
+                                                            deme::DEMDataKT* granData,
+                                                            deme::bodyID_t sphereID,
+                                                            deme::bodyID_t* meshOwner,
+                                                            deme::bodyID_t* meshRoot,
+                                                            deme::bodyID_t* leafTriID,
+                                                            deme::bodyID_t* childL,
+                                                            deme::bodyID_t* childR,
+                                                            float3* boxMin,
+                                                            float3* boxMax,
+                                                            float3* sandwichANode1,
+                                                            float3* sandwichANode2,
+                                                            float3* sandwichANode3,
+                                                            float3* sandwichBNode1,
+                                                            float3* sandwichBNode2,
+                                                            float3* sandwichBNode3,
+                                                            size_t nMeshes,
+                                                            size_t nInternal,
+                                                            deme::bodyID_t* idSphA,
+                                                            deme::bodyID_t* idTriB,
+                                                            deme::contact_t* dType,
+                                                            deme::contactPairs_t myReportOffset,
+                                                            deme::contactPairs_t myReportOffset_end) {
+    deme::bodyID_t ownerID, bodyID;
+    deme::family_t ownerFamily;
+    float myRadius;
+    float3 sphXYZ;
+    fillSharedMemSpheres<float, float>(simParams, granData, 0, sphereID, &ownerID, &bodyID, &ownerFamily, &myRadius,
+                                       &sphXYZ.x, &sphXYZ.y, &sphXYZ.z);
+
+    deme::contactPairs_t count = 0;
+    deme::bodyID_t stack[DEME_TRI_BVH_STACK_SIZE];
+    for (size_t mesh = 0; mesh < nMeshes; mesh++) {
+        const deme::bodyID_t meshOwnerID = meshOwner[mesh];
+        if (ownerID == meshOwnerID)
+            continue;
+        const deme::family_t meshFamily = granData->familyID[meshOwnerID];
+        unsigned int maskMatID = locateMaskPair<unsigned int>(ownerFamily, meshFamily);
+        if (granData->familyMasks[maskMatID] != deme::DONT_PREVENT_CONTACT)
+            continue;
+        const float artificialMargin =
+            DEME_MIN(granData->familyExtraMarginSize[ownerFamily], granData->familyExtraMarginSize[meshFamily]);
+
+        double3 meshXYZ;
+        voxelIDToPosition<double, deme::voxelID_t, deme::subVoxelPos_t>(
+            meshXYZ.x, meshXYZ.y, meshXYZ.z, granData->voxelID[meshOwnerID], granData->locX[meshOwnerID],
+            granData->locY[meshOwnerID], granData->locZ[meshOwnerID], _nvXp2_, _nvYp2_, _voxelSize_, _l_);
+        const float meshOriQw = granData->oriQw[meshOwnerID];
+        const float meshOriQx = granData->oriQx[meshOwnerID];
+        const float meshOriQy = granData->oriQy[meshOwnerID];
+        const float meshOriQz = granData->oriQz[meshOwnerID];
+        // The BVH is in the mesh's own frame, so bring the sphere there
+        float3 locXYZ = make_float3(sphXYZ.x - meshXYZ.x, sphXYZ.y - meshXYZ.y, sphXYZ.z - meshXYZ.z);
+        applyOriQToVector3<float, deme::oriQ_t>(locXYZ.x, locXYZ.y, locXYZ.z, meshOriQw, -meshOriQx, -meshOriQy,
+                                                -meshOriQz);
+        const float3 sphMin = locXYZ - myRadius;
+        const float3 sphMax = locXYZ + myRadius;
+
+        int top = 0;
+        stack[top++] = meshRoot[mesh];
+        while (top > 0) {
+            const deme::bodyID_t node = stack[--top];
+            const float3 nodeMin = boxMin[node];
+            const float3 nodeMax = boxMax[node];
+            if (sphMax.x < nodeMin.x || sphMin.x > nodeMax.x || sphMax.y < nodeMin.y || sphMin.y > nodeMax.y ||
+                sphMax.z < nodeMin.z || sphMin.z > nodeMax.z)
+                continue;
+            if (node < nInternal) {
+                if (top + 2 > DEME_TRI_BVH_STACK_SIZE) {
+                    DEME_ABORT_KERNEL("Sphere %u overflowed the BVH traversal stack (size %u) of a mesh.\n", sphereID,
+                                      DEME_TRI_BVH_STACK_SIZE);
+                }
+                stack[top++] = childL[node];
+                stack[top++] = childR[node];
+                continue;
+            }
+
+            // A leaf: the same test as in bin-based detection, on the sandwich triangles in the global frame
+            const deme::bodyID_t triID = leafTriID[node - nInternal];
+            float3 triANode1, triANode2, triANode3, triBNode1, triBNode2, triBNode3, tmp;
+            tmp = sandwichANode1[triID];
+            applyOriQToVector3<float, deme::oriQ_t>(tmp.x, tmp.y, tmp.z, meshOriQw, meshOriQx, meshOriQy, meshOriQz);
+            triANode1 = meshXYZ + tmp;
+            tmp = sandwichANode2[triID];
+            applyOriQToVector3<float, deme::oriQ_t>(tmp.x, tmp.y, tmp.z, meshOriQw, meshOriQx, meshOriQy, meshOriQz);
+            triANode2 = meshXYZ + tmp;
+            tmp = sandwichANode3[triID];
+            applyOriQToVector3<float, deme::oriQ_t>(tmp.x, tmp.y, tmp.z, meshOriQw, meshOriQx, meshOriQy, meshOriQz);
+            triANode3 = meshXYZ + tmp;
+            tmp = sandwichBNode1[triID];
+            applyOriQToVector3<float, deme::oriQ_t>(tmp.x, tmp.y, tmp.z, meshOriQw, meshOriQx, meshOriQy, meshOriQz);
+            triBNode1 = meshXYZ + tmp;
+            tmp = sandwichBNode2[triID];
+            applyOriQToVector3<float, deme::oriQ_t>(tmp.x, tmp.y, tmp.z, meshOriQw, meshOriQx, meshOriQy, meshOriQz);
+            triBNode2 = meshXYZ + tmp;
+            tmp = sandwichBNode3[triID];
+            applyOriQToVector3<float, deme::oriQ_t>(tmp.x, tmp.y, tmp.z, meshOriQw, meshOriQx, meshOriQy, meshOriQz);
+            triBNode3 = meshXYZ + tmp;
+
+            float3 cntPnt, normal;
+            float depth;
+            bool in_contact_A, in_contact_B;
+            in_contact_A = triangle_sphere_CD_directional<float3, float>(triANode1, triANode2, triANode3, sphXYZ,
+                                                                         myRadius, normal, depth, cntPnt);
+            in_contact_A = in_contact_A && (-depth > artificialMargin);
+            in_contact_B = triangle_sphere_CD_directional<float3, float>(triBNode1, triBNode2, triBNode3, sphXYZ,
+                                                                         myRadius, normal, depth, cntPnt);
+            in_contact_B = in_contact_B && (-depth > artificialMargin);
+            // No bin owns the contact point here, so each pair is only found once anyway
+            if (in_contact_A || in_contact_B) {
+                if (idSphA != NULL && myReportOffset + count < myReportOffset_end) {
+                    idSphA[myReportOffset + count] = sphereID;
+                    idTriB[myReportOffset + count] = triID;
+                    dType[myReportOffset + count] = deme::SPHERE_MESH_CONTACT;
+                }
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+__global__ void getNumberOfSphTriContactsInBVHs(deme::DEMSimParams* simParams,
+                                                deme::DEMDataKT* granData,
+                                                deme::bodyID_t* meshOwner,
+                                                deme::bodyID_t* meshRoot,
+                                                deme::bodyID_t* leafTriID,
+                                                deme::bodyID_t* childL,
+                                                deme::bodyID_t* childR,
+                                                float3* boxMin,
+                                                float3* boxMax,
+                                                float3* sandwichANode1,
+                                                float3* sandwichANode2,
+                                                float3* sandwichANode3,
+                                                float3* sandwichBNode1,
+                                                float3* sandwichBNode2,
+                                                float3* sandwichBNode3,
+                                                deme::contactPairs_t* numBVHContactsEachSphere,
+                                                size_t nMeshes,
+                                                size_t nInternal) {
+    deme::bodyID_t sphereID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (sphereID < simParams->nSpheresGM) {
+        numBVHContactsEachSphere[sphereID] = querySphereInTriBVHs(
+            simParams, granData, sphereID, meshOwner, meshRoot, leafTriID, childL, childR, boxMin, boxMax,
+            sandwichANode1, sandwichANode2, sandwichANode3, sandwichBNode1, sandwichBNode2, sandwichBNode3, nMeshes,
+            nInternal, NULL, NULL, NULL, 0, 0);
+    }
+}
+
+__global__ void populateSphTriContactsInBVHs(deme::DEMSimParams* simParams,
+                                             deme::DEMDataKT* granData,
+                                             deme::bodyID_t* meshOwner,
+                                             deme::bodyID_t* meshRoot,
+                                             deme::bodyID_t* leafTriID,
+                                             deme::bodyID_t* childL,
+                                             deme::bodyID_t* childR,
+                                             float3* boxMin,
+                                             float3* boxMax,
+                                             float3* sandwichANode1,
+                                             float3* sandwichANode2,
+                                             float3* sandwichANode3,
+                                             float3* sandwichBNode1,
+                                             float3* sandwichBNode2,
+                                             float3* sandwichBNode3,
+                                             deme::contactPairs_t* numBVHContactsEachSphere,
+                                             deme::contactPairs_t* BVHContactReportOffsets,
+                                             deme::bodyID_t* idSphA,
+                                             deme::bodyID_t* idTriB,
+                                             deme::contact_t* dType,
+                                             size_t nMeshes,
+                                             size_t nInternal) {
+    deme::bodyID_t sphereID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (sphereID < simParams->nSpheresGM) {
+        const deme::contactPairs_t myReportOffset = BVHContactReportOffsets[sphereID];
+        const deme::contactPairs_t myReportOffset_end = myReportOffset + numBVHContactsEachSphere[sphereID];
+        deme::contactPairs_t count = querySphereInTriBVHs(
+            simParams, granData, sphereID, meshOwner, meshRoot, leafTriID, childL, childR, boxMin, boxMax,
+            sandwichANode1, sandwichANode2, sandwichANode3, sandwichBNode1, sandwichBNode2, sandwichBNode3, nMeshes,
+            nInternal, idSphA, idTriB, dType, myReportOffset, myReportOffset_end);
+        // Should the 2 sweeps disagree, the unused slots are marked
+        for (deme::contactPairs_t i = myReportOffset + count; i < myReportOffset_end; i++) {
+            dType[i] = deme::NOT_A_CONTACT;
+        }
+    }
+}
+
+// =============================================================================
+// Contacts between binned facets and the coarse-level spheres of the bin hierarchy, which are not in bins
+// =============================================================================
+
+// Test one coarse sphere--facet pair, the same way as bin-based detection does
+inline __device__ bool checkCoarseSphTriPair(deme::DEMSimParams* simParams,
+                                             deme::DEMDataKT* granData,
+                                             deme::bodyID_t sphereID,
+                                             deme::bodyID_t triID,
+                                             float3* sandwichANode1,
+                                             float3* sandwichANode2,
+                                             float3* sandwichANode3,
+                                             float3* sandwichBNode1,
+                                             float3* sandwichBNode2,
+                                             float3* sandwichBNode3) {
+    deme::bodyID_t ownerID, bodyID, triOwnerID, triIDCopy;
+    deme::family_t ownerFamily, triOwnerFamily;
+    float myRadius;
+    float3 sphXYZ, triANode1, triANode2, triANode3, triBNode1, triBNode2, triBNode3;
+    fillSharedMemSpheres<float, float>(simParams, granData, 0, sphereID, &ownerID, &bodyID, &ownerFamily, &myRadius,
+                                       &sphXYZ.x, &sphXYZ.y, &sphXYZ.z);
+    fillSharedMemTriangles(simParams, granData, 0, triID, &triOwnerID, &triIDCopy, &triOwnerFamily, sandwichANode1,
+                           sandwichANode2, sandwichANode3, sandwichBNode1, sandwichBNode2, sandwichBNode3, &triANode1,
+                           &triANode2, &triANode3, &triBNode1, &triBNode2, &triBNode3);
+    if (ownerID == triOwnerID)
+        return false;
+    unsigned int maskMatID = locateMaskPair<unsigned int>(ownerFamily, triOwnerFamily);
+    if (granData->familyMasks[maskMatID] != deme::DONT_PREVENT_CONTACT)
+        return false;
+    const float artificialMargin =
+        DEME_MIN(granData->familyExtraMarginSize[ownerFamily], granData->familyExtraMarginSize[triOwnerFamily]);
+    float3 cntPnt, normal;
+    float depth;
+    bool in_contact_A = triangle_sphere_CD_directional<float3, float>(triANode1, triANode2, triANode3, sphXYZ,
+                                                                      myRadius, normal, depth, cntPnt);
+    in_contact_A = in_contact_A && (-depth > artificialMargin);
+    bool in_contact_B = triangle_sphere_CD_directional<float3, float>(triBNode1, triBNode2, triBNode3, sphXYZ,
+                                                                      myRadius, normal, depth, cntPnt);
+    in_contact_B = in_contact_B && (-depth > artificialMargin);
+    return in_contact_A || in_contact_B;
+}
+
+// Each thread takes one coarse sphere--facet pair. Coarse spheres are few, so brute force is fine.
+__global__ void getNumberOfCoarseSphTriContacts(deme::DEMSimParams* simParams,
+                                                deme::DEMDataKT* granData,
+                                                deme::bodyID_t* coarseIDs,
+                                                float3* sandwichANode1,
+                                                float3* sandwichANode2,
+                                                float3* sandwichANode3,
+                                                float3* sandwichBNode1,
+                                                float3* sandwichBNode2,
+                                                float3* sandwichBNode3,
+                                                deme::contactPairs_t* numContacts,
+                                                size_t nCoarse) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < nCoarse * simParams->nTriGM) {
+        const deme::bodyID_t triID = myID % simParams->nTriGM;
+        if (granData->triInBVH[triID])
+            return;
+        if (checkCoarseSphTriPair(simParams, granData, coarseIDs[myID / simParams->nTriGM], triID, sandwichANode1,
+                                  sandwichANode2, sandwichANode3, sandwichBNode1, sandwichBNode2, sandwichBNode3)) {
+            atomicAdd(numContacts, (deme::contactPairs_t)1);
+        }
+    }
+}
+
+__global__ void populateCoarseSphTriContacts(deme::DEMSimParams* simParams,
+                                             deme::DEMDataKT* granData,
+                                             deme::bodyID_t* coarseIDs,
+                                             float3* sandwichANode1,
+                                             float3* sandwichANode2,
+                                             float3* sandwichANode3,
+                                             float3* sandwichBNode1,
+                                             float3* sandwichBNode2,
+                                             float3* sandwichBNode3,
+                                             deme::contactPairs_t* writeCursor,
+                                             deme::bodyID_t* idSphA,
+                                             deme::bodyID_t* idTriB,
+                                             deme::contact_t* dType,
+                                             size_t nCoarse,
+                                             size_t nSlots) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < nCoarse * simParams->nTriGM) {
+        const deme::bodyID_t triID = myID % simParams->nTriGM;
+        if (granData->triInBVH[triID])
+            return;
+        const deme::bodyID_t sphereID = coarseIDs[myID / simParams->nTriGM];
+        if (checkCoarseSphTriPair(simParams, granData, sphereID, triID, sandwichANode1, sandwichANode2,
+                                  sandwichANode3, sandwichBNode1, sandwichBNode2, sandwichBNode3)) {
+            deme::contactPairs_t slot = atomicAdd(writeCursor, (deme::contactPairs_t)1);
+            if (slot < nSlots) {
+                idSphA[slot] = sphereID;
+                idTriB[slot] = triID;
+                dType[slot] = deme::SPHERE_MESH_CONTACT;
+            }
+        }
+    }
+}
@@ -0,0 +1,42 @@
+// Lanes in a warp that share an owner first sum their contributions, then only one of them does the atomics
+{
+    const unsigned int activeMask = __activemask();
+    const unsigned int lane = threadIdx.x & 31;
+
+    // Take care of A
+    {
+        // torque_inForceForm is usually the contribution of rolling resistance and it contributes to torque
+        // only, not linear velocity
+        float3 myF = (force + torque_only_force);
+        // F is in global frame, but it needs to be in local to coordinate with moi and cntPnt
+        applyOriQToVector3<float, deme::oriQ_t>(myF.x, myF.y, myF.z, AOriQ.w, -AOriQ.x, -AOriQ.y, -AOriQ.z);
+        const unsigned int peers = warpPeersOf(activeMask, AOwner);
+        const float3 acc = warpReducePeers(activeMask, peers, force / AOwnerMass);
+        const float3 angAcc = warpReducePeers(activeMask, peers, cross(locCPA, myF) / AOwnerMOI);
+        if (lane == __ffs(peers) - 1) {
+            atomicAdd(granData->aX + AOwner, acc.x);
+            atomicAdd(granData->aY + AOwner, acc.y);
+            atomicAdd(granData->aZ + AOwner, acc.z);
+            atomicAdd(granData->alphaX + AOwner, angAcc.x);
+            atomicAdd(granData->alphaY + AOwner, angAcc.y);
+            atomicAdd(granData->alphaZ + AOwner, angAcc.z);
+        }
+    }
+
+    // Take care of B
+    {
+        float3 myF = -1.f * (force + torque_only_force);
+        applyOriQToVector3<float, deme::oriQ_t>(myF.x, myF.y, myF.z, BOriQ.w, -BOriQ.x, -BOriQ.y, -BOriQ.z);
+        const unsigned int peers = warpPeersOf(activeMask, BOwner);
+        const float3 acc = warpReducePeers(activeMask, peers, -1.f * force / BOwnerMass);
+        const float3 angAcc = warpReducePeers(activeMask, peers, cross(locCPB, myF) / BOwnerMOI);
+        if (lane == __ffs(peers) - 1) {
+            atomicAdd(granData->aX + BOwner, acc.x);
+            atomicAdd(granData->aY + BOwner, acc.y);
+            atomicAdd(granData->aZ + BOwner, acc.z);
+            atomicAdd(granData->alphaX + BOwner, angAcc.x);
+            atomicAdd(granData->alphaY + BOwner, angAcc.y);
+            atomicAdd(granData->alphaZ + BOwner, angAcc.z);
+        }
+    }
+}
@@ -0,0 +1,145 @@
+// DEM kernels used for evaluating a group of inspectors in one pass, then reducing all their quantities together
+#include <DEM/Defines.h>
+#include <DEMHelperKernels.cu>
+_kernelIncludes_
+
+// If clump templates are jitified, they will be below
+_clumpTemplateDefs_;
+
+// Mass properties are below, if jitified mass properties are in use
+_massDefs_;
+_moiDefs_;
+_volumeDefs_;
+
+// The reduce operation and its identity value of each inspector (slot) in this group
+_fusedReduceOps_;
+
+// Slot s of quantities and not_in_regions starts at s * slotStride. The owner inspectors of this group use the first
+// slots, and each of them is evaluated in its own scope below.
+__global__ void inspectOwnerPropertiesFused(deme::DEMDataDT* granData,
+                                            deme::DEMSimParams* simParams,
+                                            float* quantities,
+                                            deme::notStupidBool_t* not_in_regions,
+                                            size_t slotStride,
+                                            size_t nOwnerBodies) {
+    deme::bodyID_t myOwner = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myOwner < nOwnerBodies) {
+        deme::ownerType_t myType = granData->ownerTypes[myOwner];
+        float oriQw, oriQx, oriQy, oriQz;
+        double ownerX, ownerY, ownerZ;
+        float myMass;
+        float3 myMOI;
+        // Get my mass info from either jitified arrays or global memory
+        // Outputs myMass
+        // Use an input named exactly `myOwner' which is the id of this owner
+        { _massAcqStrat_; }
+
+        // Get my mass info from either jitified arrays or global memory
+        // Outputs myMOI
+        // Use an input named exactly `myOwner' which is the id of this owner
+        { _moiAcqStrat_; }
+
+        voxelIDToPosition<double, deme::voxelID_t, deme::subVoxelPos_t>(
+            ownerX, ownerY, ownerZ, granData->voxelID[myOwner], granData->locX[myOwner], granData->locY[myOwner],
+            granData->locZ[myOwner], _nvXp2_, _nvYp2_, _voxelSize_, _l_);
+        oriQw = granData->oriQw[myOwner];
+        oriQx = granData->oriQx[myOwner];
+        oriQy = granData->oriQy[myOwner];
+        oriQz = granData->oriQz[myOwner];
+
+        float X = ownerX + simParams->LBFX;
+        float Y = ownerY + simParams->LBFY;
+        float Z = ownerZ + simParams->LBFZ;
+
+        // Region test and quantity of each owner inspector
+        { _ownerQueryProcesses_; }
+    }
+}
+
+// The sphere inspectors of this group use the slots after the owner ones
+__global__ void inspectSpherePropertiesFused(deme::DEMDataDT* granData,
+                                             deme::DEMSimParams* simParams,
+                                             float* quantities,
+                                             deme::notStupidBool_t* not_in_regions,
+                                             size_t slotStride,
+                                             size_t nSpheres) {
+    size_t sphereID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (sphereID < nSpheres) {
+        // Get my owner ID
+        deme::bodyID_t myOwner = granData->ownerClumpBody[sphereID];
+        float3 myRelPos;
+        float myRadius;
+        float oriQw, oriQx, oriQy, oriQz;
+        double ownerX, ownerY, ownerZ;
+        // Get my component offset info from either jitified arrays or global memory
+        // Outputs myRelPos, myRadius
+        // Use an input named exactly `sphereID' which is the id of this sphere component
+        { _componentAcqStrat_; }
+
+        voxelIDToPosition<double, deme::voxelID_t, deme::subVoxelPos_t>(
+            ownerX, ownerY, ownerZ, granData->voxelID[myOwner], granData->locX[myOwner], granData->locY[myOwner],
+            granData->locZ[myOwner], _nvXp2_, _nvYp2_, _voxelSize_, _l_);
+        oriQw = granData->oriQw[myOwner];
+        oriQx = granData->oriQx[myOwner];
+        oriQy = granData->oriQy[myOwner];
+        oriQz = granData->oriQz[myOwner];
+        applyOriQToVector3<float, deme::oriQ_t>(myRelPos.x, myRelPos.y, myRelPos.z, oriQw, oriQx, oriQy, oriQz);
+
+        float X = ownerX + myRelPos.x + simParams->LBFX;
+        float Y = ownerY + myRelPos.y + simParams->LBFY;
+        float Z = ownerZ + myRelPos.z + simParams->LBFZ;
+
+        // Region test and quantity of each sphere inspector
+        { _sphereQueryProcesses_; }
+    }
+}
+
+// Reduce all slots at once: blockIdx.y is the slot, and every block writes one partial result of that slot. Entries
+// that are not in the region are already the identity of the slot's reduce operation, so they need no mask here.
+__global__ void reduceInspectorSlots(const float* quantities,
+                                     float* partials,
+                                     size_t slotStride,
+                                     unsigned int nOwnerSlots,
+                                     size_t nOwnerBodies,
+                                     size_t nSpheres) {
+    __shared__ float buffer[DEME_MAX_THREADS_PER_BLOCK];
+    unsigned int slot = blockIdx.y;
+    size_t n = (slot < nOwnerSlots) ? nOwnerBodies : nSpheres;
+    const float* vals = quantities + slot * slotStride;
+    float res = fusedInspectorIdentity(slot);
+    for (size_t i = blockIdx.x * blockDim.x + threadIdx.x; i < n; i += blockDim.x * gridDim.x) {
+        res = fusedInspectorReduceOp(slot, res, vals[i]);
+    }
+    buffer[threadIdx.x] = res;
+    __syncthreads();
+    for (unsigned int half = blockDim.x / 2; half > 0; half /= 2) {
+        if (threadIdx.x < half) {
+            buffer[threadIdx.x] = fusedInspectorReduceOp(slot, buffer[threadIdx.x], buffer[threadIdx.x + half]);
+        }
+        __syncthreads();
+    }
+    if (threadIdx.x == 0) {
+        partials[slot * gridDim.x + blockIdx.x] = buffer[0];
+    }
+}
+
+// Then one block per slot reduces the partial results of that slot
+__global__ void reduceInspectorPartials(const float* partials, float* res, unsigned int nPartials) {
+    __shared__ float buffer[DEME_MAX_THREADS_PER_BLOCK];
+    unsigned int slot = blockIdx.x;
+    float val = fusedInspectorIdentity(slot);
+    for (unsigned int i = threadIdx.x; i < nPartials; i += blockDim.x) {
+        val = fusedInspectorReduceOp(slot, val, partials[slot * nPartials + i]);
+    }
+    buffer[threadIdx.x] = val;
+    __syncthreads();
+    for (unsigned int half = blockDim.x / 2; half > 0; half /= 2) {
+        if (threadIdx.x < half) {
+            buffer[threadIdx.x] = fusedInspectorReduceOp(slot, buffer[threadIdx.x], buffer[threadIdx.x + half]);
+        }
+        __syncthreads();
+    }
+    if (threadIdx.x == 0) {
+        res[slot] = buffer[0];
+    }
+}
@@ -315,6 +315,20 @@ getPointBinID(const double& X, const double& Y, const double& Z, const double& b
     return binIDX + binIDY * nbX + binIDZ * nbX * nbY;
 }
 
+// The minimum image of displacement d in a periodic direction of length len
+template <typename T1>
+inline __device__ T1 periodicMinImage(const T1& d, const double& len) {
+    return d - (T1)(len * rint((double)d / len));
+}
+
+// Wrap coordinate x into [0, len) in a periodic direction of length len
+template <typename T1>
+inline __device__ T1 periodicWrap(const T1& x, const double& len) {
+    T1 res = x - (T1)(len * floor((double)x / len));
+    // Round-off can land a tiny negative x right on len
+    return (res >= (T1)len) ? res - (T1)len : res;
+}
+
 // Compute the binID using its indices in X, Y and Z directions
 template <typename T1>
 inline __device__ T1
@@ -562,4 +576,99 @@ __inline__ __device__ void boundingBoxIntersectBin(deme::binID_t* L,
     U[2] = max_bin.z;
 }
 
+// With multi-rate stepping, an owner is integrated only in the steps that are multiples of its family's step ratio,
+// with a step size that many times h. Returns that multiple for this step, or 0 if the owner skips this step.
+inline __device__ unsigned int ownerStepMultiple(deme::DEMSimParams* simParams,
+                                                 deme::DEMDataDT* granData,
+                                                 const deme::bodyID_t& ownerID) {
+    if (!simParams->useFamilyStepRatio) {
+        return 1;
+    }
+    const unsigned int ratio = granData->familyStepRatio[granData->familyID[ownerID]];
+    return (simParams->nStepsElapsed % ratio == 0) ? ratio : 0;
+}
+
+// With multi-rate stepping, a contact is evaluated only in the steps where at least one of its owners is integrated.
+// Returns the number of steps since it was last evaluated, which is the step size (in h) its history should advance by.
+inline __device__ unsigned int contactStepMultiple(deme::DEMSimParams* simParams,
+                                                   deme::DEMDataDT* granData,
+                                                   const deme::bodyID_t& ownerA,
+                                                   const deme::bodyID_t& ownerB) {
+    // Step counts are 64-bit like nStepsElapsed, so long runs do not wrap them; only the difference is small
+    const uint64_t s = simParams->nStepsElapsed;
+    if (!simParams->useFamilyStepRatio || s == 0) {
+        return 1;
+    }
+    const unsigned int ratioA = granData->familyStepRatio[granData->familyID[ownerA]];
+    const unsigned int ratioB = granData->familyStepRatio[granData->familyID[ownerB]];
+    // The last step before this one in which either owner was integrated
+    const uint64_t prevA = (s - 1) - (s - 1) % ratioA;
+    const uint64_t prevB = (s - 1) - (s - 1) % ratioB;
+    return (unsigned int)(s - DEME_MAX(prevA, prevB));
+}
+
+// If sleeping is enabled, an owner that has been quiet for long enough is asleep, and is not integrated till a neighbor
+// pushes it hard enough to wake it up
+inline __device__ bool ownerIsAsleep(deme::DEMSimParams* simParams,
+                                     deme::DEMDataDT* granData,
+                                     const deme::bodyID_t& ownerID) {
+    return simParams->useSleeping &&
+           (granData->ownerQuietSteps[ownerID] & deme::SLEEP_COUNT_MASK) >= simParams->sleepNumSteps;
+}
+
+// Whether a sleeping owner is checked for waking up in this step, so all its contacts are to be resolved
+inline __device__ bool sleeperIsChecked(deme::DEMDataDT* granData, const deme::bodyID_t& ownerID) {
+    return granData->ownerQuietSteps[ownerID] & deme::SLEEP_CHECK_FLAG;
+}
+
+// Flag a sleeping owner as touched by an awake one, so it is checked for waking up in the next step
+inline __device__ void touchSleeper(deme::DEMDataDT* granData, const deme::bodyID_t& ownerID) {
+    if (!(granData->ownerQuietSteps[ownerID] & deme::SLEEP_TOUCHED_FLAG)) {
+        atomicOr(granData->ownerQuietSteps + ownerID, deme::SLEEP_TOUCHED_FLAG);
+    }
+}
+
+// Among the lanes in mask, find those holding the same key as me (a bit mask of lanes, which includes me). All lanes in
+// mask must call it.
+inline __device__ unsigned int warpPeersOf(unsigned int mask, deme::bodyID_t key) {
+#if __CUDA_ARCH__ >= 700
+    return __match_any_sync(mask, key);
+#else
+    unsigned int peers = 0;
+    unsigned int remaining = mask;
+    while (remaining) {
+        deme::bodyID_t leaderKey = __shfl_sync(mask, key, __ffs(remaining) - 1);
+        unsigned int same = __ballot_sync(mask, key == leaderKey);
+        if (key == leaderKey) {
+            peers = same;
+        }
+        remaining &= ~same;
+    }
+    return peers;
+#endif
+}
+
+// Sum a value over each group of peer lanes (see warpPeersOf), with a tree reduction that takes log2 of the group size
+// rounds. The sum is valid on the lowest lane of each group. All lanes in mask must call it.
+inline __device__ float3 warpReducePeers(unsigned int mask, unsigned int peers, float3 val) {
+    const unsigned int lane = threadIdx.x & 31;
+    // My rank in my group, and the peers ranked after me
+    unsigned int rank = __popc(peers & ((1u << lane) - 1));
+    peers &= ~((2u << lane) - 1);
+    while (__any_sync(mask, peers)) {
+        const int next = __ffs(peers);
+        float3 other;
+        other.x = __shfl_sync(mask, val.x, next - 1);
+        other.y = __shfl_sync(mask, val.y, next - 1);
+        other.z = __shfl_sync(mask, val.z, next - 1);
+        if ((rank & 1) == 0 && next) {
+            val += other;
+        }
+        // Lanes of odd rank have passed their values on, so they drop out of the groups
+        peers &= __ballot_sync(mask, (rank & 1) == 0);
+        rank >>= 1;
+    }
+    return val;
+}
+
 #endif
@@ -87,3 +87,155 @@ __global__ void rearrangeMapping(deme::contactPairs_t* map_sorted,
             map_sorted[myID] = old_arr_unsort_to_sort_map[map_to];
     }
 }
+
+// Mark the contacts that have no partner in the previous contact array, since only they need to be shipped to dT in a
+// delta-encoded update
+__global__ void markNewContacts(deme::contactPairs_t* mapping, deme::contactPairs_t* isNew, size_t n) {
+    deme::contactPairs_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        isNew[myID] = (mapping[myID] == deme::NULL_MAPPING_PARTNER) ? 1 : 0;
+    }
+}
+
+// Pack the new contacts, and where they are in the contact array, to the front of the delta arrays
+__global__ void compactNewContacts(deme::DEMDataKT* granData,
+                                   deme::contactPairs_t* isNew,
+                                   deme::contactPairs_t* newOffsets,
+                                   deme::contactPairs_t* newContactIdx,
+                                   deme::bodyID_t* newIdA,
+                                   deme::bodyID_t* newIdB,
+                                   deme::contact_t* newType,
+                                   size_t n) {
+    deme::contactPairs_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n && isNew[myID]) {
+        deme::contactPairs_t slot = newOffsets[myID];
+        newContactIdx[slot] = myID;
+        newIdA[slot] = granData->idGeometryA[myID];
+        newIdB[slot] = granData->idGeometryB[myID];
+        newType[slot] = granData->contactType[myID];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Hash-based persistent contact map
+////////////////////////////////////////////////////////////////////////////////
+
+// An empty slot in the history hash table. The host memsets the key array with 0xFF, and no real contact can have
+// NULL_BODYID as both of its geometries.
+#define DEME_HISTORY_HASH_EMPTY_KEY 0xFFFFFFFFFFFFFFFFull
+
+inline __device__ unsigned long long historyHashKey(deme::bodyID_t idA, deme::bodyID_t idB) {
+    return ((unsigned long long)idA << 32) | (unsigned long long)idB;
+}
+
+// Mix the key and contact type bits (murmur3 finalizer) and fold them into the table, whose capacity is a power of 2
+inline __device__ size_t historyHashSlot(unsigned long long key, deme::contact_t type, size_t mask) {
+    unsigned long long h = key ^ ((unsigned long long)type << 56);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return (size_t)(h & mask);
+}
+
+// Each thread inserts one previous contact. The previous contact array has no duplicate (idA, idB, type) entries, so
+// an insertion just claims the first empty slot it probes; the type and value are read only after this kernel ends.
+__global__ void insertPrevContactsToHash(deme::DEMDataKT* granData,
+                                         unsigned long long* hashKeys,
+                                         deme::contact_t* hashTypes,
+                                         deme::contactPairs_t* hashValues,
+                                         size_t mask,
+                                         size_t nPrevContacts) {
+    deme::contactPairs_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < nPrevContacts) {
+        deme::contact_t type = granData->previous_contactType[myID];
+        if (type == deme::NOT_A_CONTACT) {
+            return;
+        }
+        unsigned long long key =
+            historyHashKey(granData->previous_idGeometryA[myID], granData->previous_idGeometryB[myID]);
+        size_t slot = historyHashSlot(key, type, mask);
+        while (atomicCAS(hashKeys + slot, DEME_HISTORY_HASH_EMPTY_KEY, key) != DEME_HISTORY_HASH_EMPTY_KEY) {
+            slot = (slot + 1) & mask;
+        }
+        hashTypes[slot] = type;
+        hashValues[slot] = myID;
+    }
+}
+
+// Each thread looks up one new contact, and writes where it was in the previous contact array to the mapping
+__global__ void lookupContactsInHash(deme::DEMDataKT* granData,
+                                     unsigned long long* hashKeys,
+                                     deme::contact_t* hashTypes,
+                                     deme::contactPairs_t* hashValues,
+                                     deme::contactPairs_t* mapping,
+                                     size_t mask,
+                                     size_t nContacts) {
+    deme::contactPairs_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < nContacts) {
+        deme::contact_t type = granData->contactType[myID];
+        deme::contactPairs_t my_partner = deme::NULL_MAPPING_PARTNER;
+        if (type != deme::NOT_A_CONTACT) {
+            unsigned long long key = historyHashKey(granData->idGeometryA[myID], granData->idGeometryB[myID]);
+            size_t slot = historyHashSlot(key, type, mask);
+            unsigned long long slot_key;
+            while ((slot_key = hashKeys[slot]) != DEME_HISTORY_HASH_EMPTY_KEY) {
+                if (slot_key == key && hashTypes[slot] == type) {
+                    my_partner = hashValues[slot];
+                    break;
+                }
+                slot = (slot + 1) & mask;
+            }
+        }
+        mapping[myID] = my_partner;
+    }
+}
+
+// Flag the spheres that appear as geometry A in the contact array, so the number of spheres in contact can be counted
+// without sorting the contact array
+__global__ void markSpheresInContact(deme::bodyID_t* idGeometryA,
+                                     deme::contact_t* contactType,
+                                     unsigned int* inContact,
+                                     size_t nContacts) {
+    deme::contactPairs_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < nContacts && contactType[myID] != deme::NOT_A_CONTACT) {
+        inContact[idGeometryA[myID]] = 1;
+    }
+}
+
+// The class a contact type falls into in a type-sorted contact array: 0 for non-contact, 1 for sphere--sphere, 2 for
+// sphere--mesh, 3 for sphere--analytical
+inline __device__ unsigned int contactClassOf(deme::contact_t type) {
+    if (type == deme::NOT_A_CONTACT) {
+        return 0;
+    } else if (type == deme::SPHERE_SPHERE_CONTACT) {
+        return 1;
+    } else if (type == deme::SPHERE_MESH_CONTACT) {
+        return 2;
+    }
+    return 3;
+}
+
+// Find where each contact class starts in a type-sorted contact array. Thread k finds the first contact whose class is
+// no smaller than k; the last entry is the total number of contacts.
+__global__ void findContactClassOffsets(deme::contact_t* contactType, size_t* offsets, size_t nContacts) {
+    unsigned int myClass = threadIdx.x;
+    if (myClass > DEME_NUM_CONTACT_CLASSES) {
+        return;
+    }
+    if (myClass == DEME_NUM_CONTACT_CLASSES) {
+        offsets[myClass] = nContacts;
+        return;
+    }
+    size_t left = 0, right = nContacts;
+    while (left < right) {
+        size_t mid = left + (right - left) / 2;
+        if (contactClassOf(contactType[mid]) < myClass) {
+            left = mid + 1;
+        } else {
+            right = mid;
+        }
+    }
+    offsets[myClass] = left;
+}
@@ -3,6 +3,57 @@
 #include <DEM/Defines.h>
 _kernelIncludes_
 
+// Mass properties are below, if jitified mass properties are in use
+_massDefs_;
+_moiDefs_;
+
+// The ChangeFamilyWhen rules, applied to one owner, when they are evaluated here rather than in the applyFamilyChanges
+// sweep. It runs before the owner is integrated, so the rules see the same states as that sweep does.
+inline __device__ void applyFamilyChangesToOwner(deme::DEMSimParams* simParams,
+                                                 deme::DEMDataDT* granData,
+                                                 deme::bodyID_t myOwner) {
+    // The user may make references to owner positions, velocities, accelerations and simulation time
+    double3 pos;
+    float3 vel, acc;
+    float mass;
+    deme::family_t family_code = granData->familyID[myOwner];
+    {
+        float myMass;
+        _massAcqStrat_;
+        mass = myMass;
+    }
+    voxelIDToPosition<double, deme::voxelID_t, deme::subVoxelPos_t>(
+        pos.x, pos.y, pos.z, granData->voxelID[myOwner], granData->locX[myOwner], granData->locY[myOwner],
+        granData->locZ[myOwner], _nvXp2_, _nvYp2_, _voxelSize_, _l_);
+    pos.x += simParams->LBFX;
+    pos.y += simParams->LBFY;
+    pos.z += simParams->LBFZ;
+
+    vel.x = granData->vX[myOwner];
+    vel.y = granData->vY[myOwner];
+    vel.z = granData->vZ[myOwner];
+    acc.x = granData->aX[myOwner];
+    acc.y = granData->aY[myOwner];
+    acc.z = granData->aZ[myOwner];
+
+    // Standardize names...
+    double X = pos.x;
+    double Y = pos.y;
+    double Z = pos.z;
+    float vX = vel.x;
+    float vY = vel.y;
+    float vZ = vel.z;
+    float accX = acc.x;
+    float accY = acc.y;
+    float accZ = acc.z;
+
+    float h = simParams->h;
+    float t = simParams->timeElapsed;
+
+    // Carry out user's instructions
+    { _familyChangeRules_; }
+}
+
 // Apply presecibed velocity and report whether the `true' physics should be skipped, rather than added on top of
 // that
 template <typename T1, typename T2, typename T3, typename T4>
@@ -97,6 +148,31 @@ inline __device__ void applyAddedAcceleration(T1& accX,
     }
 }
 
+// Whether a family is fixed (SetFamilyFixed), so its owners never move
+inline __device__ bool familyIsFixed(const deme::family_t& family) {
+    switch (family) {
+        _fixedFamilyCases_;
+        default:
+            return false;
+    }
+}
+
+// Owners of fixed families skip the integration. Their velocities are just held at zero, which is all the prescription
+// would do to them. To the sleep mechanism they are always asleep, so sleepers resting on them are left alone.
+inline __device__ void holdFixedOwner(deme::DEMSimParams* simParams,
+                                      deme::DEMDataDT* granData,
+                                      const deme::bodyID_t& ownerID) {
+    if (simParams->useSleeping) {
+        granData->ownerQuietSteps[ownerID] = simParams->sleepNumSteps;
+    }
+    granData->vX[ownerID] = 0;
+    granData->vY[ownerID] = 0;
+    granData->vZ[ownerID] = 0;
+    granData->omgBarX[ownerID] = 0;
+    granData->omgBarY[ownerID] = 0;
+    granData->omgBarZ[ownerID] = 0;
+}
+
 inline __device__ void integrateVelPos(deme::bodyID_t ownerID,
                                        deme::DEMSimParams* simParams,
                                        deme::DEMDataDT* granData,
@@ -138,6 +214,41 @@ inline __device__ void integrateVelPos(deme::bodyID_t ownerID,
                            granData->vZ[ownerID], granData->omgBarX[ownerID], granData->omgBarY[ownerID],
                            granData->omgBarZ[ownerID], ownerID, family_code, (float)t);
     }
+    const bool motionPrescribed = LinVelXPrescribed || LinVelYPrescribed || LinVelZPrescribed || RotVelXPrescribed ||
+                                  RotVelYPrescribed || RotVelZPrescribed || LinXPrescribed || LinYPrescribed ||
+                                  LinZPrescribed || RotPrescribed;
+    // A sleeping owner stays where it is, unless it is checked for waking up in this step (all its contacts were
+    // resolved) and its net acceleration is no longer small. Owners with prescribed motion are always integrated, so
+    // their prescription keeps working.
+    if (!motionPrescribed && ownerIsAsleep(simParams, granData, ownerID)) {
+        const unsigned int quietSteps = granData->ownerQuietSteps[ownerID];
+        bool wakeUp = false;
+        if (quietSteps & deme::SLEEP_CHECK_FLAG) {
+            float3 extra_acc = make_float3(0, 0, 0), extra_angAcc = make_float3(0, 0, 0);
+            applyAddedAcceleration(extra_acc.x, extra_acc.y, extra_acc.z, extra_angAcc.x, extra_angAcc.y,
+                                   extra_angAcc.z, X, Y, Z, granData->oriQw[ownerID], granData->oriQx[ownerID],
+                                   granData->oriQy[ownerID], granData->oriQz[ownerID], granData->vX[ownerID],
+                                   granData->vY[ownerID], granData->vZ[ownerID], granData->omgBarX[ownerID],
+                                   granData->omgBarY[ownerID], granData->omgBarZ[ownerID], ownerID, family_code,
+                                   (float)t);
+            float3 netAcc;
+            netAcc.x = granData->aX[ownerID] + extra_acc.x + simParams->Gx;
+            netAcc.y = _twoDimensional_ ? 0.f : granData->aY[ownerID] + extra_acc.y + simParams->Gy;
+            netAcc.z = granData->aZ[ownerID] + extra_acc.z + simParams->Gz;
+            wakeUp = length(netAcc) >= simParams->sleepAccThres;
+        }
+        if (wakeUp) {
+            // Integrated from this step on, and it has to be quiet for a while again to fall asleep
+            granData->ownerQuietSteps[ownerID] = 0;
+        } else {
+            // Touched in this step means checked in the next
+            granData->ownerQuietSteps[ownerID] = (quietSteps & deme::SLEEP_COUNT_MASK) |
+                                                 ((quietSteps & deme::SLEEP_TOUCHED_FLAG) ? deme::SLEEP_CHECK_FLAG : 0);
+            v = make_float3(0, 0, 0);
+            omgBar = make_float3(0, 0, 0);
+            return;
+        }
+    }
 
     // Operation phase...
 
@@ -158,9 +269,15 @@ inline __device__ void integrateVelPos(deme::bodyID_t ownerID,
         } else {
             old_v.x = granData->vX[ownerID];
         }
+        // In 2D (XZ plane), owners have no Y velocity and rotate about the Y axis only, unless prescribed so
         if (!LinVelYPrescribed) {
-            v_update.y = (granData->aY[ownerID] + extra_acc.y + simParams->Gy) * h;
-            granData->vY[ownerID] += v_update.y;
+            if (_twoDimensional_) {
+                old_v.y = 0.f;
+                granData->vY[ownerID] = 0.f;
+            } else {
+                v_update.y = (granData->aY[ownerID] + extra_acc.y + simParams->Gy) * h;
+                granData->vY[ownerID] += v_update.y;
+            }
         } else {
             old_v.y = granData->vY[ownerID];
         }
@@ -172,8 +289,13 @@ inline __device__ void integrateVelPos(deme::bodyID_t ownerID,
         }
 
         if (!RotVelXPrescribed) {
-            omgBar_update.x = (granData->alphaX[ownerID] + extra_angAcc.x) * h;
-            granData->omgBarX[ownerID] += omgBar_update.x;
+            if (_twoDimensional_) {
+                old_omgBar.x = 0.f;
+                granData->omgBarX[ownerID] = 0.f;
+            } else {
+                omgBar_update.x = (granData->alphaX[ownerID] + extra_angAcc.x) * h;
+                granData->omgBarX[ownerID] += omgBar_update.x;
+            }
         } else {
             old_omgBar.x = granData->omgBarX[ownerID];
         }
@@ -184,14 +306,51 @@ inline __device__ void integrateVelPos(deme::bodyID_t ownerID,
             old_omgBar.y = granData->omgBarY[ownerID];
         }
         if (!RotVelZPrescribed) {
-            omgBar_update.z = (granData->alphaZ[ownerID] + extra_angAcc.z) * h;
-            granData->omgBarZ[ownerID] += omgBar_update.z;
+            if (_twoDimensional_) {
+                old_omgBar.z = 0.f;
+                granData->omgBarZ[ownerID] = 0.f;
+            } else {
+                omgBar_update.z = (granData->alphaZ[ownerID] + extra_angAcc.z) * h;
+                granData->omgBarZ[ownerID] += omgBar_update.z;
+            }
         } else {
             old_omgBar.z = granData->omgBarZ[ownerID];
         }
 
         // We need to set v and omgBar, and they will be used in position/quaternion update
         _integrationVelocityPassOnStrategy_;
+
+        // Count how many steps in a row this owner has been quiet. Prescribed motion components do not count towards
+        // the acceleration.
+        if (simParams->useSleeping) {
+            float3 netAcc;
+            netAcc.x = LinVelXPrescribed ? 0.f : granData->aX[ownerID] + extra_acc.x + simParams->Gx;
+            netAcc.y = (LinVelYPrescribed || _twoDimensional_) ? 0.f
+                                                                : granData->aY[ownerID] + extra_acc.y + simParams->Gy;
+            netAcc.z = LinVelZPrescribed ? 0.f : granData->aZ[ownerID] + extra_acc.z + simParams->Gz;
+            float3 newV = make_float3(granData->vX[ownerID], granData->vY[ownerID], granData->vZ[ownerID]);
+            float3 newOmgBar =
+                make_float3(granData->omgBarX[ownerID], granData->omgBarY[ownerID], granData->omgBarZ[ownerID]);
+            unsigned int quietSteps = granData->ownerQuietSteps[ownerID];
+            if (length(newV) < simParams->sleepLinVelThres && length(newOmgBar) < simParams->sleepAngVelThres &&
+                length(netAcc) < simParams->sleepAccThres) {
+                if (quietSteps < simParams->sleepNumSteps) {
+                    quietSteps++;
+                }
+                // Falling asleep, so come to a full stop
+                if (quietSteps == simParams->sleepNumSteps && !motionPrescribed) {
+                    granData->vX[ownerID] = 0;
+                    granData->vY[ownerID] = 0;
+                    granData->vZ[ownerID] = 0;
+                    granData->omgBarX[ownerID] = 0;
+                    granData->omgBarY[ownerID] = 0;
+                    granData->omgBarZ[ownerID] = 0;
+                }
+            } else {
+                quietSteps = 0;
+            }
+            granData->ownerQuietSteps[ownerID] = quietSteps;
+        }
     }
 
     // With v and omgBar. update pos now...
@@ -210,11 +369,37 @@ inline __device__ void integrateVelPos(deme::bodyID_t ownerID,
         X -= (double)simParams->LBFX;
         Y -= (double)simParams->LBFY;
         Z -= (double)simParams->LBFZ;
+        // An owner leaving through a periodic boundary enters from the other end (the period starts at LBF)
+        if (_periodicX_) {
+            X = periodicWrap<double>(X, _periodLenX_);
+        }
+        if (_periodicY_) {
+            Y = periodicWrap<double>(Y, _periodLenY_);
+        }
+        if (_periodicZ_) {
+            Z = periodicWrap<double>(Z, _periodLenZ_);
+        }
         positionToVoxelID<deme::voxelID_t, deme::subVoxelPos_t, double>(
             granData->voxelID[ownerID], granData->locX[ownerID], granData->locY[ownerID], granData->locZ[ownerID], X, Y,
             Z, _nvXp2_, _nvYp2_, _voxelSize_, _l_);
 
-        if (!RotPrescribed) {
+        if (!RotPrescribed && _twoDimensional_) {
+            // In 2D the rotation is about Y only, so the delta rotation (to 1st order) is (1, 0, ha, 0) in wxyz, and
+            // the product of the old quaternion with it (Quat * deltaRot, as in 3D) is a few terms only
+            const float ha = 0.5 * h * omgBar.y;
+            const float4 oldQ = make_float4(granData->oriQx[ownerID], granData->oriQy[ownerID],
+                                            granData->oriQz[ownerID], granData->oriQw[ownerID]);
+            float4 oriQ;
+            oriQ.w = oldQ.w - oldQ.y * ha;
+            oriQ.x = oldQ.x - oldQ.z * ha;
+            oriQ.y = oldQ.y + oldQ.w * ha;
+            oriQ.z = oldQ.z + oldQ.x * ha;
+            oriQ /= length(oriQ);
+            granData->oriQw[ownerID] = oriQ.w;
+            granData->oriQx[ownerID] = oriQ.x;
+            granData->oriQy[ownerID] = oriQ.y;
+            granData->oriQz[ownerID] = oriQ.z;
+        } else if (!RotPrescribed) {
             // Then integrate the quaternion
             // 1st Taylor series multiplier. First use it to record delta rotation...
             // Refer to
@@ -256,9 +441,86 @@ inline __device__ void integrateVelPos(deme::bodyID_t ownerID,
 __global__ void integrateOwners(deme::DEMSimParams* simParams, deme::DEMDataDT* granData) {
     deme::bodyID_t ownerID = blockIdx.x * blockDim.x + threadIdx.x;
     if (ownerID < simParams->nOwnerBodies) {
+        if (_familyChangeInIntegration_) {
+            applyFamilyChangesToOwner(simParams, granData, ownerID);
+        }
+        if (familyIsFixed(granData->familyID[ownerID])) {
+            holdFixedOwner(simParams, granData, ownerID);
+            return;
+        }
+        const unsigned int stepMultiple = ownerStepMultiple(simParams, granData, ownerID);
+        if (stepMultiple == 0) {
+            return;
+        }
         // These 2 quantities mean the velocity and ang vel used for updating position/quaternion for this step.
         // Depending on the integration scheme in use, they can be different.
         float3 v, omgBar;
-        integrateVelPos(ownerID, simParams, granData, v, omgBar, simParams->h, simParams->timeElapsed);
+        integrateVelPos(ownerID, simParams, granData, v, omgBar, simParams->h * stepMultiple, simParams->timeElapsed);
+    }
+}
+
+// The same, but also records the magnitude of the updated velocity of each owner, which kT needs for the contact
+// margins. This spares a separate pass over the owner velocities.
+__global__ void integrateOwnersAndAbsv(deme::DEMSimParams* simParams, deme::DEMDataDT* granData) {
+    deme::bodyID_t ownerID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (ownerID < simParams->nOwnerBodies) {
+        if (_familyChangeInIntegration_) {
+            applyFamilyChangesToOwner(simParams, granData, ownerID);
+        }
+        if (familyIsFixed(granData->familyID[ownerID])) {
+            holdFixedOwner(simParams, granData, ownerID);
+            granData->ownerAbsVel[ownerID] = 0;
+            return;
+        }
+        const unsigned int stepMultiple = ownerStepMultiple(simParams, granData, ownerID);
+        if (stepMultiple > 0) {
+            float3 v, omgBar;
+            integrateVelPos(ownerID, simParams, granData, v, omgBar, simParams->h * stepMultiple,
+                            simParams->timeElapsed);
+        }
+        double myVX = granData->vX[ownerID];
+        double myVY = granData->vY[ownerID];
+        double myVZ = granData->vZ[ownerID];
+        granData->ownerAbsVel[ownerID] = sqrt(myVX * myVX + myVY * myVY + myVZ * myVZ);
+    }
+}
+
+// Find the max owner velocity and acceleration magnitudes of this step, for adapting the step size
+__global__ void gaugeStepSizeLimiters(deme::DEMSimParams* simParams, deme::DEMDataDT* granData) {
+    deme::bodyID_t ownerID = blockIdx.x * blockDim.x + threadIdx.x;
+    float absv = 0.f, absa = 0.f;
+    if (ownerID < simParams->nOwnerBodies) {
+        float3 vel = make_float3(granData->vX[ownerID], granData->vY[ownerID], granData->vZ[ownerID]);
+        float3 acc = make_float3(granData->aX[ownerID] + simParams->Gx, granData->aY[ownerID] + simParams->Gy,
+                                 granData->aZ[ownerID] + simParams->Gz);
+        absv = length(vel);
+        absa = length(acc);
+    }
+    // Max within the warp first, so only one atomic operation per warp reaches the global memory
+    for (int offset = warpSize / 2; offset > 0; offset /= 2) {
+        absv = fmaxf(absv, __shfl_down_sync(0xffffffff, absv, offset));
+        absa = fmaxf(absa, __shfl_down_sync(0xffffffff, absa, offset));
+    }
+    if ((threadIdx.x & (warpSize - 1)) == 0) {
+        // Non-negative floats compare the same way as their bit patterns do as ints
+        atomicMax((int*)&(granData->adaptTSGauge[0]), __float_as_int(absv));
+        atomicMax((int*)&(granData->adaptTSGauge[1]), __float_as_int(absa));
+    }
+}
+
+// Write the new step size to simParams, then reset the gauge for the next step. Launched with one thread.
+__global__ void updateAdaptiveStepSize(deme::DEMSimParams* simParams, deme::DEMDataDT* granData) {
+    const float maxVel = granData->adaptTSGauge[0];
+    const float maxAcc = granData->adaptTSGauge[1];
+    const float travel = simParams->adaptTSSafety * simParams->adaptTSLength;
+    float h = simParams->adaptTSMax;
+    if (simParams->adaptTSByVel && maxVel > 0.f) {
+        h = fminf(h, travel / maxVel);
+    }
+    if (simParams->adaptTSByAcc && maxAcc > 0.f) {
+        h = fminf(h, sqrtf(2.f * travel / maxAcc));
     }
+    simParams->h = fmaxf(h, simParams->adaptTSMin);
+    granData->adaptTSGauge[0] = 0.f;
+    granData->adaptTSGauge[1] = 0.f;
 }
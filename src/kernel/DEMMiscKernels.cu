@@ -1,4 +1,5 @@
 // DEM misc. kernels
+#include <DEMHelperKernels.cu>
 #include <DEM/Defines.h>
 
 __global__ void markOwnerToChange(deme::notStupidBool_t* idBool,
@@ -74,3 +75,533 @@ __global__ void fillMarginValues(deme::DEMSimParams* simParams, deme::DEMDataKT*
         granData->marginSize[ownerID] = simParams->beta + granData->familyExtraMarginSize[my_family];
     }
 }
+
+__global__ void addToMarginValues(deme::DEMDataKT* granData, float extra, size_t n) {
+    size_t ownerID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (ownerID < n) {
+        granData->marginSize[ownerID] += extra;
+    }
+}
+
+// Spread the lower 21 bits of a number out, so there are 2 zero bits between every 2 of them
+inline __device__ uint64_t spreadBitsBy3(uint64_t a) {
+    a &= 0x1fffff;
+    a = (a | a << 32) & 0x1f00000000ffff;
+    a = (a | a << 16) & 0x1f0000ff0000ff;
+    a = (a | a << 8) & 0x100f00f00f00f00f;
+    a = (a | a << 4) & 0x10c30c30c30c30c3;
+    a = (a | a << 2) & 0x1249249249249249;
+    return a;
+}
+
+__global__ void computeSphereMortonKeys(deme::DEMSimParams* simParams,
+                                        deme::DEMDataDT* granData,
+                                        uint64_t* keys,
+                                        deme::bodyID_t* order,
+                                        size_t n) {
+    size_t sphereID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (sphereID < n) {
+        deme::bodyID_t myOwner = granData->ownerClumpBody[sphereID];
+        uint64_t X, Y, Z;
+        IDChopper<uint64_t, deme::voxelID_t>(X, Y, Z, granData->voxelID[myOwner], simParams->nvXp2, simParams->nvYp2);
+        // Only the 21 most significant bits of each voxel index fit in the key
+        X >>= DEME_MAX(0, (int)simParams->nvXp2 - 21);
+        Y >>= DEME_MAX(0, (int)simParams->nvYp2 - 21);
+        Z >>= DEME_MAX(0, (int)simParams->nvZp2 - 21);
+        keys[sphereID] = spreadBitsBy3(X) | (spreadBitsBy3(Y) << 1) | (spreadBitsBy3(Z) << 2);
+        order[sphereID] = sphereID;
+    }
+}
+
+__global__ void invertPermutation(deme::bodyID_t* newToOld, deme::bodyID_t* oldToNew, size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        oldToNew[newToOld[myID]] = myID;
+    }
+}
+
+// Place element newToOld[i] of in at location i of out. Element type does not matter, only its size.
+__global__ void gatherByPermutation(char* out,
+                                    const char* in,
+                                    deme::bodyID_t* newToOld,
+                                    unsigned int elemBytes,
+                                    size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        const size_t src = (size_t)newToOld[myID] * elemBytes;
+        const size_t dst = myID * elemBytes;
+        if (elemBytes % sizeof(unsigned int) == 0) {
+            for (unsigned int i = 0; i < elemBytes / sizeof(unsigned int); i++) {
+                ((unsigned int*)(out + dst))[i] = ((const unsigned int*)(in + src))[i];
+            }
+        } else {
+            for (unsigned int i = 0; i < elemBytes; i++) {
+                out[dst + i] = in[src + i];
+            }
+        }
+    }
+}
+
+// Place element newToOld[i] of in at location i of out, for per-contact arrays
+__global__ void gatherContactsByPermutation(char* out,
+                                            const char* in,
+                                            deme::contactPairs_t* newToOld,
+                                            unsigned int elemBytes,
+                                            size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        const size_t src = (size_t)newToOld[myID] * elemBytes;
+        const size_t dst = myID * elemBytes;
+        if (elemBytes % sizeof(unsigned int) == 0) {
+            for (unsigned int i = 0; i < elemBytes / sizeof(unsigned int); i++) {
+                ((unsigned int*)(out + dst))[i] = ((const unsigned int*)(in + src))[i];
+            }
+        } else {
+            for (unsigned int i = 0; i < elemBytes; i++) {
+                out[dst + i] = in[src + i];
+            }
+        }
+    }
+}
+
+// Remap the sphere IDs in the contact array. Contact detection reports a sphere--sphere contact with the smaller ID as
+// geometry A, and the history mapping only recognizes a contact if it is stored that way, so a remapped pair that is
+// no longer in that order gets its geometries swapped. Then the force, the torque-as-force and the contact points are
+// swapped along (the recorded contact arrays are skipped if granData does not have them), and swapped (if not NULL)
+// gets the flag, so the contact wildcards that change sign can be negated too.
+__global__ void remapSphereIDsInContacts(deme::DEMDataDT* granData,
+                                         deme::bodyID_t* oldToNew,
+                                         deme::contactPairs_t* order,
+                                         deme::notStupidBool_t* swapped,
+                                         size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        order[myID] = myID;
+        bool swap = false;
+        deme::contact_t type = granData->contactType[myID];
+        if (type != deme::NOT_A_CONTACT) {
+            // Geometry A is always a sphere
+            deme::bodyID_t idA = oldToNew[granData->idGeometryA[myID]];
+            deme::bodyID_t idB = granData->idGeometryB[myID];
+            if (type == deme::SPHERE_SPHERE_CONTACT) {
+                idB = oldToNew[idB];
+                swap = (idA > idB);
+            }
+            granData->idGeometryA[myID] = swap ? idB : idA;
+            granData->idGeometryB[myID] = swap ? idA : idB;
+        }
+        if (swap && granData->contactForces) {
+            granData->contactForces[myID] *= -1.f;
+            granData->contactTorque_convToForce[myID] *= -1.f;
+            float3 cntPntA = granData->contactPointGeometryA[myID];
+            granData->contactPointGeometryA[myID] = granData->contactPointGeometryB[myID];
+            granData->contactPointGeometryB[myID] = cntPntA;
+        }
+        if (swapped) {
+            swapped[myID] = swap;
+        }
+    }
+}
+
+// Negate a contact wildcard (stored in the given precision, in the given half of the array elements if 16-bit) in the
+// contacts whose geometries are swapped
+__global__ void negateSwappedContactWildcard(float* wildcard,
+                                             const deme::notStupidBool_t* swapped,
+                                             deme::WILDCARD_PRECISION precision,
+                                             unsigned int half,
+                                             float scale,
+                                             size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n && swapped[myID]) {
+        float word = wildcard[myID];
+        uint16_t code = deme::unpackWildcardHalf(word, half);
+        switch (precision) {
+            case deme::WILDCARD_PRECISION::FP16:
+            case deme::WILDCARD_PRECISION::BF16:
+                // The sign bit
+                word = deme::packWildcardHalf(word, half, (uint16_t)(code ^ 0x8000u));
+                break;
+            case deme::WILDCARD_PRECISION::SCALED_INT16:
+                word = deme::packWildcardHalf(word, half, (uint16_t)(-(int16_t)code));
+                break;
+            default:
+                word = -word;
+        }
+        wildcard[myID] = word;
+    }
+}
+
+// Count the contacts that contact detection could report as they are: the non-sphere--sphere ones, and the
+// sphere--sphere ones with the smaller ID as geometry A
+__global__ void countCanonicalContacts(deme::bodyID_t* idGeometryA,
+                                       deme::bodyID_t* idGeometryB,
+                                       deme::contact_t* contactType,
+                                       unsigned long long* count,
+                                       size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        deme::contact_t type = contactType[myID];
+        if (type != deme::NOT_A_CONTACT &&
+            (type != deme::SPHERE_SPHERE_CONTACT || idGeometryA[myID] < idGeometryB[myID])) {
+            atomicAdd(count, 1ull);
+        }
+    }
+}
+
+// Mark the contacts that go into a contact output file: those whose force plus force-like torque is no smaller than
+// forceThres, that involve an owner whose family is marked in familyPass (if filterFamily), and whose contact point is
+// in the box [regionMin, regionMax] (if filterRegion). analOwners gives the owners of analytical geometries.
+__global__ void markContactsForOutput(deme::DEMSimParams* simParams,
+                                      deme::DEMDataDT* granData,
+                                      deme::notStupidBool_t* flags,
+                                      const deme::notStupidBool_t* familyPass,
+                                      const deme::bodyID_t* analOwners,
+                                      float forceThres,
+                                      bool filterFamily,
+                                      bool filterRegion,
+                                      float3 regionMin,
+                                      float3 regionMax,
+                                      size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        bool pass = length(granData->contactForces[myID] + granData->contactTorque_convToForce[myID]) >= forceThres;
+        const deme::bodyID_t ownerA = granData->ownerClumpBody[granData->idGeometryA[myID]];
+        if (pass && filterFamily) {
+            const deme::contact_t type = granData->contactType[myID];
+            const deme::bodyID_t geoB = granData->idGeometryB[myID];
+            deme::bodyID_t ownerB;
+            if (type == deme::SPHERE_SPHERE_CONTACT) {
+                ownerB = granData->ownerClumpBody[geoB];
+            } else if (type == deme::SPHERE_MESH_CONTACT) {
+                ownerB = granData->ownerMesh[geoB];
+            } else {
+                ownerB = analOwners[geoB];
+            }
+            pass = familyPass[granData->familyID[ownerA]] || familyPass[granData->familyID[ownerB]];
+        }
+        if (pass && filterRegion) {
+            // The global contact point is the local one rotated, then added to owner A's CoM
+            double X, Y, Z;
+            voxelIDToPosition<double, deme::voxelID_t, deme::subVoxelPos_t>(
+                X, Y, Z, granData->voxelID[ownerA], granData->locX[ownerA], granData->locY[ownerA],
+                granData->locZ[ownerA], simParams->nvXp2, simParams->nvYp2, simParams->voxelSize, simParams->l);
+            float3 pnt = granData->contactPointGeometryA[myID];
+            float oriQw = granData->oriQw[ownerA];
+            float oriQx = granData->oriQx[ownerA];
+            float oriQy = granData->oriQy[ownerA];
+            float oriQz = granData->oriQz[ownerA];
+            applyOriQToVector3<float, float>(pnt.x, pnt.y, pnt.z, oriQw, oriQx, oriQy, oriQz);
+            pnt.x += X + simParams->LBFX;
+            pnt.y += Y + simParams->LBFY;
+            pnt.z += Z + simParams->LBFZ;
+            pass = (pnt.x >= regionMin.x && pnt.x <= regionMax.x && pnt.y >= regionMin.y && pnt.y <= regionMax.y &&
+                    pnt.z >= regionMin.z && pnt.z <= regionMax.z);
+        }
+        flags[myID] = pass;
+    }
+}
+
+// Turn the not-in-region marks of the owners (0 if not marked) into output marks: an owner goes into an output file if
+// it is in the region and its ID is a multiple of stride
+__global__ void markOwnersForOutput(deme::notStupidBool_t* flags, unsigned int stride, size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        flags[myID] = (flags[myID] == 0) && (myID % stride == 0);
+    }
+}
+
+// Mark the spheres (in the user-facing order) whose owners are marked in ownerFlags. userToImpl is the user--impl
+// sphere ID table, or nullptr if spheres are not re-ordered.
+__global__ void markSpheresForOutput(deme::DEMDataDT* granData,
+                                     const deme::notStupidBool_t* ownerFlags,
+                                     const deme::bodyID_t* userToImpl,
+                                     deme::notStupidBool_t* flags,
+                                     size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        const deme::bodyID_t implID = (userToImpl) ? userToImpl[myID] : myID;
+        flags[myID] = ownerFlags[granData->ownerClumpBody[implID]];
+    }
+}
+
+// For the selected spheres (given by user ID, turned into impl ID in place), find the position of their owners in the
+// (sorted) selected owner list, which is the owner ID they have in the output
+__global__ void mapSelectedSpheresForOutput(deme::DEMDataDT* granData,
+                                            deme::bodyID_t* selected,
+                                            const deme::bodyID_t* userToImpl,
+                                            const deme::bodyID_t* selectedOwners,
+                                            size_t nSelectedOwners,
+                                            deme::bodyID_t* newOwners,
+                                            size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        const deme::bodyID_t implID = (userToImpl) ? userToImpl[selected[myID]] : selected[myID];
+        const deme::bodyID_t owner = granData->ownerClumpBody[implID];
+        size_t left = 0, right = nSelectedOwners;
+        while (left < right) {
+            size_t mid = (left + right) / 2;
+            if (selectedOwners[mid] < owner) {
+                left = mid + 1;
+            } else {
+                right = mid;
+            }
+        }
+        selected[myID] = implID;
+        newOwners[myID] = left;
+    }
+}
+
+// Move the nodes of each mesh facet to the global frame, and write them to the mesh output vertex list. nodeSlots has 3
+// entries per facet: where its nodes go in that list. A node shared by several facets is written by each of them, with
+// the same value, so the list has each vertex once.
+__global__ void computeMeshVerticesForOutput(deme::DEMSimParams* simParams,
+                                             deme::DEMDataDT* granData,
+                                             const deme::bodyID_t* nodeSlots,
+                                             float3* vertices,
+                                             size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        const deme::bodyID_t owner = granData->ownerMesh[myID];
+        double X, Y, Z;
+        voxelIDToPosition<double, deme::voxelID_t, deme::subVoxelPos_t>(
+            X, Y, Z, granData->voxelID[owner], granData->locX[owner], granData->locY[owner], granData->locZ[owner],
+            simParams->nvXp2, simParams->nvYp2, simParams->voxelSize, simParams->l);
+        const float oriQw = granData->oriQw[owner];
+        const float oriQx = granData->oriQx[owner];
+        const float oriQy = granData->oriQy[owner];
+        const float oriQz = granData->oriQz[owner];
+        const deme::bodyID_t myNode = granData->triNodeOffset[myID];
+        const float3 nodes[3] = {granData->relPosNode1[myNode], granData->relPosNode2[myNode],
+                                 granData->relPosNode3[myNode]};
+        for (unsigned int i = 0; i < 3; i++) {
+            float3 pnt = nodes[i];
+            applyOriQToVector3<float, float>(pnt.x, pnt.y, pnt.z, oriQw, oriQx, oriQy, oriQz);
+            pnt.x += X + simParams->LBFX;
+            pnt.y += Y + simParams->LBFY;
+            pnt.z += Z + simParams->LBFZ;
+            vertices[nodeSlots[3 * myID + i]] = pnt;
+        }
+    }
+}
+
+// Write (or add, if increment) n facets' node relative positions, starting from facet start, from a device buffer.
+// If nodeSlots is given, data holds the mesh's vertices and facet node i takes vertex nodeSlots[3 * facet + i] -
+// vertexOffset; otherwise data is the triangle soup, 3 nodes per facet.
+__global__ void applyMeshNodesFromDevice(deme::DEMDataDT* granData,
+                                         const float3* data,
+                                         const deme::bodyID_t* nodeSlots,
+                                         size_t vertexOffset,
+                                         size_t start,
+                                         size_t n,
+                                         bool increment) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        const size_t myFacet = start + myID;
+        const deme::bodyID_t myNode = granData->triNodeOffset[myFacet];
+        float3* nodes[3] = {granData->relPosNode1 + myNode, granData->relPosNode2 + myNode,
+                            granData->relPosNode3 + myNode};
+        for (unsigned int i = 0; i < 3; i++) {
+            const float3 val = nodeSlots ? data[nodeSlots[3 * myFacet + i] - vertexOffset] : data[3 * myID + i];
+            if (increment) {
+                nodes[i]->x += val.x;
+                nodes[i]->y += val.y;
+                nodes[i]->z += val.z;
+            } else {
+                *(nodes[i]) = val;
+            }
+        }
+    }
+}
+
+// Gather one quantity of owners into out: 3 floats per owner, or 4 for quaternions. Owner i is offset + ids[i], or
+// offset + i if ids is nullptr.
+__global__ void gatherOwnerStates(deme::DEMSimParams* simParams,
+                                  deme::DEMDataDT* granData,
+                                  const deme::bodyID_t* ids,
+                                  deme::bodyID_t offset,
+                                  deme::OWNER_QUANTITY quantity,
+                                  float* out,
+                                  size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        const deme::bodyID_t owner = offset + ((ids) ? ids[myID] : myID);
+        switch (quantity) {
+            case (deme::OWNER_QUANTITY::POS): {
+                double X, Y, Z;
+                voxelIDToPosition<double, deme::voxelID_t, deme::subVoxelPos_t>(
+                    X, Y, Z, granData->voxelID[owner], granData->locX[owner], granData->locY[owner],
+                    granData->locZ[owner], simParams->nvXp2, simParams->nvYp2, simParams->voxelSize, simParams->l);
+                out[3 * myID] = X + simParams->LBFX;
+                out[3 * myID + 1] = Y + simParams->LBFY;
+                out[3 * myID + 2] = Z + simParams->LBFZ;
+                break;
+            }
+            case (deme::OWNER_QUANTITY::VEL):
+                out[3 * myID] = granData->vX[owner];
+                out[3 * myID + 1] = granData->vY[owner];
+                out[3 * myID + 2] = granData->vZ[owner];
+                break;
+            case (deme::OWNER_QUANTITY::ANG_VEL):
+                out[3 * myID] = granData->omgBarX[owner];
+                out[3 * myID + 1] = granData->omgBarY[owner];
+                out[3 * myID + 2] = granData->omgBarZ[owner];
+                break;
+            case (deme::OWNER_QUANTITY::ORI_Q):
+                out[4 * myID] = granData->oriQx[owner];
+                out[4 * myID + 1] = granData->oriQy[owner];
+                out[4 * myID + 2] = granData->oriQz[owner];
+                out[4 * myID + 3] = granData->oriQw[owner];
+                break;
+        }
+    }
+}
+
+// Mark the owners offset to offset + n - 1 whose families are marked in familyPass
+__global__ void markOwnersInFamilies(deme::DEMDataDT* granData,
+                                     const deme::notStupidBool_t* familyPass,
+                                     deme::bodyID_t offset,
+                                     deme::notStupidBool_t* flags,
+                                     size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        flags[myID] = familyPass[granData->familyID[offset + myID]];
+    }
+}
+
+// Mark the owners that stay when the clumps of family purgeFamily are purged. Analytical objects and meshes stay.
+__global__ void markOwnersToKeep(deme::DEMDataDT* granData,
+                                 deme::family_t purgeFamily,
+                                 deme::notStupidBool_t* flags,
+                                 size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        flags[myID] = !(granData->familyID[myID] == purgeFamily && granData->ownerTypes[myID] == deme::OWNER_T_CLUMP);
+    }
+}
+
+// Mark the contacts whose geometries all stay after a purge, given the old-to-new sphere ID map
+__global__ void markContactsOfKeptSpheres(deme::DEMDataDT* granData,
+                                          const deme::bodyID_t* sphereOldToNew,
+                                          deme::notStupidBool_t* flags,
+                                          size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        const deme::contact_t type = granData->contactType[myID];
+        bool keep = (type != deme::NOT_A_CONTACT) && (sphereOldToNew[granData->idGeometryA[myID]] != deme::NULL_BODYID);
+        if (keep && type == deme::SPHERE_SPHERE_CONTACT) {
+            keep = (sphereOldToNew[granData->idGeometryB[myID]] != deme::NULL_BODYID);
+        }
+        flags[myID] = keep;
+    }
+}
+
+// Of the n entities, the ones not flagged are removed, so their old-to-new ID is NULL_BODYID. The new IDs of the rest
+// are filled in by invertPermutation.
+__global__ void markRemovedIDs(const deme::notStupidBool_t* flags, deme::bodyID_t* oldToNew, size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n && !flags[myID]) {
+        oldToNew[myID] = deme::NULL_BODYID;
+    }
+}
+
+// Replace the n IDs in ids with their new values given by oldToNew
+__global__ void remapBodyIDs(deme::bodyID_t* ids, const deme::bodyID_t* oldToNew, size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        ids[myID] = oldToNew[ids[myID]];
+    }
+}
+
+// Set queryIdx[ids[i]] to i, so the owners of a bulk contact force query know their places in it
+__global__ void markQueriedOwners(deme::bodyID_t* queryIdx, const deme::bodyID_t* ids, size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        queryIdx[ids[myID]] = myID;
+    }
+}
+
+// For a bulk contact force query, entry i (i < n) is the geometry A side of contact i, and entry n + i is its geometry
+// B side. The key of an entry is the place of that side's owner in the query (NULL_BODYID if not queried), and it is
+// flagged if the owner is queried and the contact has a non-trivial force or torque.
+__global__ void markOwnerContactEntries(deme::DEMDataDT* granData,
+                                        const deme::bodyID_t* queryIdx,
+                                        const deme::bodyID_t* analOwners,
+                                        deme::bodyID_t* keys,
+                                        deme::notStupidBool_t* flags,
+                                        size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        const bool significant =
+            length(granData->contactForces[myID]) + length(granData->contactTorque_convToForce[myID]) >=
+            DEME_TINY_FLOAT;
+        const deme::bodyID_t ownerA = granData->ownerClumpBody[granData->idGeometryA[myID]];
+        const deme::contact_t type = granData->contactType[myID];
+        const deme::bodyID_t geoB = granData->idGeometryB[myID];
+        deme::bodyID_t ownerB;
+        if (type == deme::SPHERE_SPHERE_CONTACT) {
+            ownerB = granData->ownerClumpBody[geoB];
+        } else if (type == deme::SPHERE_MESH_CONTACT) {
+            ownerB = granData->ownerMesh[geoB];
+        } else {
+            ownerB = analOwners[geoB];
+        }
+        const deme::bodyID_t keyA = queryIdx[ownerA];
+        const deme::bodyID_t keyB = queryIdx[ownerB];
+        keys[myID] = keyA;
+        keys[n + myID] = keyB;
+        flags[myID] = significant && (keyA != deme::NULL_BODYID);
+        flags[n + myID] = significant && (keyB != deme::NULL_BODYID);
+    }
+}
+
+// Fill in the contact point (global), the force and the torque of the n entries of a bulk contact force query, 9
+// floats each. The force and torque are flipped for a geometry B side entry. The torque is the one that the force-like
+// torque makes about the owner's CoM, given in the owner's local frame if torqueInLocal.
+__global__ void computeOwnerContactEntries(deme::DEMSimParams* simParams,
+                                           deme::DEMDataDT* granData,
+                                           const deme::contactPairs_t* entries,
+                                           const deme::bodyID_t* keys,
+                                           const deme::bodyID_t* ids,
+                                           float* out,
+                                           bool torqueInLocal,
+                                           size_t nContacts,
+                                           size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        const deme::contactPairs_t entry = entries[myID];
+        const bool isA = (entry < nContacts);
+        const size_t cnt = isA ? entry : entry - nContacts;
+        const deme::bodyID_t owner = ids[keys[myID]];
+        float3 pnt = isA ? granData->contactPointGeometryA[cnt] : granData->contactPointGeometryB[cnt];
+        float3 force = granData->contactForces[cnt];
+        float3 torque = granData->contactTorque_convToForce[cnt];
+        if (!isA) {
+            force = -force;
+            torque = -torque;
+        }
+        float oriQw = granData->oriQw[owner];
+        float oriQx = granData->oriQx[owner];
+        float oriQy = granData->oriQy[owner];
+        float oriQz = granData->oriQz[owner];
+        // Force-like torque to local, then times the (local) contact point
+        applyOriQToVector3<float, float>(torque.x, torque.y, torque.z, oriQw, -oriQx, -oriQy, -oriQz);
+        torque = cross(pnt, torque);
+        if (!torqueInLocal) {
+            applyOriQToVector3<float, float>(torque.x, torque.y, torque.z, oriQw, oriQx, oriQy, oriQz);
+        }
+        double X, Y, Z;
+        voxelIDToPosition<double, deme::voxelID_t, deme::subVoxelPos_t>(
+            X, Y, Z, granData->voxelID[owner], granData->locX[owner], granData->locY[owner], granData->locZ[owner],
+            simParams->nvXp2, simParams->nvYp2, simParams->voxelSize, simParams->l);
+        applyOriQToVector3<float, float>(pnt.x, pnt.y, pnt.z, oriQw, oriQx, oriQy, oriQz);
+        out[9 * myID] = pnt.x + X + simParams->LBFX;
+        out[9 * myID + 1] = pnt.y + Y + simParams->LBFY;
+        out[9 * myID + 2] = pnt.z + Z + simParams->LBFZ;
+        out[9 * myID + 3] = force.x;
+        out[9 * myID + 4] = force.y;
+        out[9 * myID + 5] = force.z;
+        out[9 * myID + 6] = torque.x;
+        out[9 * myID + 7] = torque.y;
+        out[9 * myID + 8] = torque.z;
+    }
+}
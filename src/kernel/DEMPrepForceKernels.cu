@@ -79,3 +79,42 @@ __global__ void markAliveContacts(float* wildcard, deme::notStupidBool_t* sentry
         }
     }
 }
+
+// In a delta-encoded contact update, persistent contacts are copied from where they were in the current contact
+// arrays...
+__global__ void gatherPersistentContacts(deme::contactPairs_t* contactMapping,
+                                         deme::bodyID_t* old_idGeometryA,
+                                         deme::bodyID_t* old_idGeometryB,
+                                         deme::contact_t* old_contactType,
+                                         deme::bodyID_t* idGeometryA,
+                                         deme::bodyID_t* idGeometryB,
+                                         deme::contact_t* contactType,
+                                         size_t nContactPairs) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < nContactPairs) {
+        deme::contactPairs_t map_from = contactMapping[myID];
+        if (map_from != deme::NULL_MAPPING_PARTNER) {
+            idGeometryA[myID] = old_idGeometryA[map_from];
+            idGeometryB[myID] = old_idGeometryB[map_from];
+            contactType[myID] = old_contactType[map_from];
+        }
+    }
+}
+
+// ...and the new contacts are placed from the transfer buffer
+__global__ void scatterNewContacts(deme::contactPairs_t* newContactIdx,
+                                   deme::bodyID_t* new_idGeometryA,
+                                   deme::bodyID_t* new_idGeometryB,
+                                   deme::contact_t* new_contactType,
+                                   deme::bodyID_t* idGeometryA,
+                                   deme::bodyID_t* idGeometryB,
+                                   deme::contact_t* contactType,
+                                   size_t nNewContacts) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < nNewContacts) {
+        deme::contactPairs_t map_to = newContactIdx[myID];
+        idGeometryA[map_to] = new_idGeometryA[myID];
+        idGeometryB[map_to] = new_idGeometryB[myID];
+        contactType[map_to] = new_contactType[myID];
+    }
+}